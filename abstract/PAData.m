@@ -10,7 +10,7 @@ classdef PAData < PABaseWithSettings
         pathname;
         filename;
         
-        EXPORT_FORMATS = {'csv','xls','mat'};
+        EXPORT_FORMATS = {'csv','xls','mat','bin'};
     end
     methods(Abstract)
        didExport = exportToDisk(this); 
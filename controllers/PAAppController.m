@@ -61,6 +61,17 @@ classdef PAAppController < PAFigureController
         Padaco_loading_file_flag; %boolean set to true when initially loading a src file
         Padaco_mainaxes_ylim;
         Padaco_mainaxes_xlim;
+
+        %> Instance of PAStudyLoader - loads raw .bin files in the
+        %> background (see openInBackground), or empty.
+        StudyLoader;
+    end
+
+    properties(Access=private)
+        %> Timer polling the background load (see pollBackgroundLoad).
+        loadTimerH;
+        %> True once the overview of the background load is shown.
+        showedLoadOverview;
     end
     
     methods
@@ -142,6 +153,10 @@ classdef PAAppController < PAFigureController
         %% Shutdown functions
         %> Destructor
         function close(obj)
+            obj.stopBackgroundLoad();
+            if(~isempty(obj.StudyLoader))
+                obj.StudyLoader.delete();
+            end
             obj.saveAppSettings(); %requires AppSettings variable
             obj.AppSettings = [];
             if(~isempty(obj.StatTool))
@@ -231,6 +246,10 @@ classdef PAAppController < PAFigureController
             safeset(figHandles,'menu_file_open_mims',menuCbKey,@obj.menuFileOpenMimsCb);
             safeset(figHandles,'menu_file_open_actigraph',menuCbKey,@obj.menuFileOpenActigraphCallback);
             safeset(figHandles,'menu_file_open_featurespath',menuCbKey,@obj.menuFileOpenFeaturesPathCallback);
+            if(isfield(figHandles,'menu_file_open') && ishandle(figHandles.menu_file_open))
+                obj.handles.menu_file_cancel_load = uimenu(figHandles.menu_file_open,'label','Cancel loading',...
+                    'tag','menu_file_cancel_load','separator','on','enable','off',menuCbKey,@obj.menuFileCancelLoadCallback);
+            end
             
             safeset(figHandles,'menu_file_openGENEActiv',menuCbKey,@obj.openGENEActivFileCb);
             % import
@@ -597,6 +616,9 @@ classdef PAAppController < PAFigureController
                     obj.SingleStudy.setSetting('pathname', pathname);
                     obj.SingleStudy.setSetting('filename', strcat(basename,baseext));
                     
+                    if(obj.openInBackground(f))
+                        return;
+                    end
                     obj.SensorData = PASensorData(f,obj.AppSettings.SensorData);
                     
 
@@ -620,6 +642,104 @@ classdef PAAppController < PAFigureController
             end
         end
         
+        % --------------------------------------------------------------------
+        %> @brief Starts loading a raw .bin file in the background and
+        %> queues the studies following it in its folder (prefetchCount
+        %> setting).  Progress is polled by pollBackgroundLoad, which shows
+        %> the hourly overview as soon as it is ready and the study once it
+        %> is loaded.
+        %> @param obj Instance of PAAppController
+        %> @param f Full filename of the study to open.
+        %> @retval didStart True if the load was started; false if the
+        %> file should be loaded in the foreground instead.
+        % --------------------------------------------------------------------
+        function didStart = openInBackground(obj, f)
+            didStart = false;
+            sensorSettings = obj.AppSettings.SensorData;
+            if(~isfield(sensorSettings,'loadInBackground') || ~logical(sensorSettings.loadInBackground) || ~PAStudyLoader.canLoad(f))
+                return;
+            end
+            obj.stopBackgroundLoad();
+            if(isempty(obj.StudyLoader))
+                obj.StudyLoader = PAStudyLoader();
+            end
+            if(obj.StudyLoader.open(f))
+                if(isfield(sensorSettings,'prefetchCount'))
+                    obj.StudyLoader.prefetchFolder(f, double(sensorSettings.prefetchCount));
+                end
+                obj.showedLoadOverview = false;
+                safeset(obj.handles,'menu_file_cancel_load','enable','on');
+                obj.loadTimerH = timer('timerfcn',@obj.pollBackgroundLoad,'executionmode','fixedspacing',...
+                    'period',0.25,'busymode','drop');
+                start(obj.loadTimerH);
+                didStart = true;
+            end
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief Timer callback reporting the background load's progress.
+        %> @param obj Instance of PAAppController
+        % --------------------------------------------------------------------
+        function pollBackgroundLoad(obj, varargin)
+            try
+                status = obj.StudyLoader.getStatus();
+                if(isempty(status))
+                    obj.stopBackgroundLoad();
+                    return;
+                end
+                if(status.hasOverview && ~obj.showedLoadOverview)
+                    obj.SingleStudy.showLoadOverview(obj.StudyLoader.getOverview());
+                    obj.showedLoadOverview = true;
+                end
+                switch(status.state)
+                    case 'done'
+                        obj.stopBackgroundLoad();
+                        f = obj.StudyLoader.filename;
+                        % Picks up the finished load (see PASensorData.loadBackgroundStudy)
+                        obj.SensorData = PASensorData(f,obj.AppSettings.SensorData);
+                        obj.StudyLoader.close();
+                        if ~strcmpi(obj.getViewMode(),'timeseries')
+                            obj.setViewMode('timeseries');  % Call initAccelDataView as well
+                        else
+                            obj.initAccelDataView(); % calls show obj.SingleStudy.showReady() Ready...
+                        end
+                    case {'cancelled','failed'}
+                        obj.stopBackgroundLoad();
+                        if(strcmp(status.state,'failed'))
+                            obj.logWarning('Could not load %s (%s)',obj.StudyLoader.filename,status.message);
+                        end
+                        obj.StudyLoader.close();
+                        obj.SingleStudy.showReady('all');
+                        obj.setStatus('Loading %s',status.state);
+                    otherwise
+                        obj.showBusy(sprintf('Loading (%s %d%%)',status.state,round(100*status.progress)),'all');
+                end
+            catch me
+                obj.stopBackgroundLoad();
+                showME(me);
+                obj.SingleStudy.showReady('all');
+            end
+        end
+
+        function stopBackgroundLoad(obj)
+            if(~isempty(obj.loadTimerH) && isvalid(obj.loadTimerH))
+                stop(obj.loadTimerH);
+                delete(obj.loadTimerH);
+            end
+            obj.loadTimerH = [];
+            safeset(obj.handles,'menu_file_cancel_load','enable','off');
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief Menubar callback for cancelling a background load.
+        %> @param obj Instance of PAAppController
+        % --------------------------------------------------------------------
+        function menuFileCancelLoadCallback(obj, varargin)
+            if(~isempty(obj.StudyLoader))
+                obj.StudyLoader.cancel();   % the next poll reports it
+            end
+        end
+
         % --------------------------------------------------------------------
         %> @brief Menubar callback for opening a text file
         %> @param obj Instance of PAAppController
@@ -197,6 +197,7 @@ classdef  PAAppSettings < PASettings
             x.clusterMethod = 'Clustering method';
             x.useDefaultRandomizer = {'Turn off randomizer','(1 for reproducibility)'};
             x.initClusterWithPermutation = 'Initialize clusters with permutation';           
+            x.reducedDimensions = {'Reduced dimensions','(0 to cluster load shapes directly)'};
             
             x.featureFcnName = 'Feature function';
             x.signalTagLine = 'Signal label';
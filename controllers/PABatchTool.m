@@ -230,41 +230,98 @@ classdef PABatchTool < PAFigureFcnController
                end
            end
            
-           %get the file count and update the file count text field.
-           %            rawFileCount = numel(getFilenamesi(sourcePathname,'.raw'));
-           %            binFileCount = numel(getFilenamesi(sourcePathname,'.bin'));
-           %            csvFileCount = numel(getFilenamesi(sourcePathname,'.csv'));
-
-           % ignore "hidden" files which begin with a '.'
-           rawFileCount = sum(cellfun(@(c)c(1)~='.',getFilenamesi(sourcePathname,'.raw')));
-           binFileCount = sum(cellfun(@(c)c(1)~='.',getFilenamesi(sourcePathname,'.bin')));
-           csvFileCount = sum(cellfun(@(c)c(1)~='.',getFilenamesi(sourcePathname,'.csv')));
-
-           msg = '';
-           if(rawFileCount==0 && csvFileCount==0 && binFileCount==0)
-               msg = '0 files found.';
+           [filenames, ~, accelType, catalogMsg] = this.getBatchFiles(sourcePathname);
+           if(isempty(filenames))
+               msg = ['0 files found.', catalogMsg];
                set(this.handles.button_go,'enable','off','tooltipstring','No files found!');
            else
-              if(rawFileCount>0)
-                  msg = sprintf('%s%u .raw file(s) found.\n',msg,rawFileCount);
-              end
-              if(csvFileCount>0)
-                  msg = sprintf('%s%u .csv file(s) found.',msg,csvFileCount);
-              end
-              if(binFileCount>0)
-                  msg = sprintf('%s%u .bin file(s) found.',msg,binFileCount);
-              end
-              
-              if(binFileCount+rawFileCount>0 && csvFileCount>0)
-                 msg = sprintf('%s Only .csv file(s) will be processed; place .raw/.bin files in a separate directory for processing.',msg);
-              end
-              
-              set(this.handles.button_go,'enable','on','tooltipstring','');
+               [~,~,ext] = cellfun(@fileparts,filenames,'uniformoutput',false);
+               msg = '';
+               for e={'.raw','.csv','.bin'}
+                   fileCount = sum(strcmpi(ext,e{1}));
+                   if(fileCount>0)
+                       msg = sprintf('%s%u %s file(s) found.\n',msg,fileCount,e{1});
+                   end
+               end
+               if(strcmp(accelType,'count') && (~isempty(getFilenamesi(sourcePathname,'.raw')) || ~isempty(getFilenamesi(sourcePathname,'.bin'))))
+                   msg = sprintf('%sOnly .csv file(s) will be processed; place .raw/.bin files in a separate directory for processing.\n',msg);
+               end
+               msg = [msg, catalogMsg];
+               set(this.handles.button_go,'enable','on','tooltipstring','');
            end
            set(text_filesFound_h,'string',msg);
         end
         
                
+        % --------------------------------------------------------------------
+        %> @brief Selects the actigraph files of the source path to batch
+        %> process from its recording catalog (see getRecordingCatalog).
+        %> Count (.csv) files are processed when any are found, otherwise
+        %> raw (.bin, .raw) files.  Recordings whose header is not
+        %> recognised, which are shorter than minRecordingHours, or which
+        %> start outside of firstStartDate and lastStartDate are skipped.
+        %> "Hidden" files, which begin with a '.', are ignored.
+        %> @param this Instance of PABatchTool
+        %> @param sourcePathname Directory to search (not its subdirectories).
+        %> @retval filenames Cell of filenames selected.
+        %> @retval fullFilenames Cell of full filenames selected.
+        %> @retval accelType 'count' or 'raw'.
+        %> @retval msg Summary of the recording time selected and of the
+        %> files skipped; empty when no catalog is available, in which case
+        %> every file is selected.
+        % --------------------------------------------------------------------
+        function [filenames, fullFilenames, accelType, msg] = getBatchFiles(this, sourcePathname)
+            msg = '';
+            catalog = getRecordingCatalog(sourcePathname);
+            if(isempty(catalog))
+                [filenames, fullFilenames] = getFilenamesi(sourcePathname,'.csv');
+                accelType = 'count';
+                if(isempty(filenames))
+                    [filenames, fullFilenames] = getFilenamesi(sourcePathname,{'.bin','.raw'});
+                    accelType = 'raw';
+                end
+                isVisible = ~startsWith(filenames,'.');
+                filenames = filenames(isVisible);
+                fullFilenames = fullFilenames(isVisible);
+            else
+                [folders, names, exts] = cellfun(@fileparts,catalog.path,'uniformoutput',false);
+                isCandidate = strcmp(folders,regexprep(sourcePathname,'[\\/]+$',''));
+                if(any(isCandidate & strcmp(catalog.type,'csv')))
+                    accelType = 'count';
+                    isCandidate = isCandidate & strcmp(catalog.type,'csv');
+                else
+                    accelType = 'raw';
+                    isCandidate = isCandidate & ismember(catalog.type,{'bin','raw'});
+                end
+                
+                isUnrecognised = isCandidate & catalog.isValid~=1;
+                isTooShort = isCandidate & ~isUnrecognised & catalog.durationSec<this.getSetting('minRecordingHours')*3600;
+                isOutOfRange = false(size(isCandidate));
+                firstStartDate = this.getSetting('firstStartDate');
+                if(~isempty(firstStartDate))
+                    isOutOfRange = isOutOfRange | floor(catalog.startDatenum)<datenum(firstStartDate,'yyyy-mm-dd');
+                end
+                lastStartDate = this.getSetting('lastStartDate');
+                if(~isempty(lastStartDate))
+                    isOutOfRange = isOutOfRange | floor(catalog.startDatenum)>datenum(lastStartDate,'yyyy-mm-dd');
+                end
+                isOutOfRange = isOutOfRange & isCandidate & ~isUnrecognised & ~isTooShort;
+                isSelected = isCandidate & ~isUnrecognised & ~isTooShort & ~isOutOfRange;
+                
+                filenames = strcat(names(isSelected),exts(isSelected));
+                fullFilenames = catalog.path(isSelected);
+                if(any(isSelected))
+                    msg = sprintf('%0.1f days of recordings selected.',sum(catalog.durationSec(isSelected))/86400);
+                end
+                skipped = [sum(isUnrecognised), sum(isTooShort), sum(isOutOfRange)];
+                reasons = {'with an unrecognised header','shorter than %g hours','starting outside of the dates given'};
+                reasons{2} = sprintf(reasons{2},this.getSetting('minRecordingHours'));
+                for r=find(skipped)
+                    msg = sprintf('%s\n%u file(s) %s skipped.',msg,skipped(r),reasons{r});
+                end
+            end
+        end
+        
         % --------------------------------------------------------------------
         %> @brief Determines the number of actigraph files located in the
         %> specified source path and updates the GUI's count display.
@@ -345,22 +402,7 @@ classdef PABatchTool < PAFigureFcnController
                 
                 
                 % initialize batch processing file management
-                [countFilenames, countFullFilenames] = getFilenamesi(this.getSourcePath(),'.csv');
-                
-                if(numel(countFilenames)>0)
-                    accelType = 'count';
-                    filenames = countFilenames;
-                    fullFilenames = countFullFilenames;
-                else
-                    accelType = 'raw';
-                    [rawFilenames, rawFullFilenames] = getFilenamesi(this.getSourcePath(),{'.bin','.raw'});
-                    filenames = rawFilenames;
-                    fullFilenames = rawFullFilenames;
-                end
-                
-                % exclude "hidden" files which start with a '.'
-                fullFilenames = fullFilenames(~startsWith(filenames,'.'));
-                filenames = filenames(~startsWith(filenames,'.'));
+                [filenames, fullFilenames, accelType] = this.getBatchFiles(this.getSourcePath());
                 
                 failedFiles = {};
                 fileCount = numel(fullFilenames);
@@ -1078,6 +1120,9 @@ classdef PABatchTool < PAFigureFcnController
             pStruct.frameDurationMinutes = PANumericParam('default',15,'Description','Duration of frame in minutes','min',0,'max',24*60);
             
             pStruct.numDaysAllowed = PANumericParam('default',7,'Description','Maximum number of days allowed/used','min',0);
+            pStruct.minRecordingHours = PANumericParam('default',0,'Description','Minimum duration of a recording to process (hours)','min',0);
+            pStruct.firstStartDate = PAStringParam('default','','description','Skip recordings starting before this date (yyyy-mm-dd); empty for no limit');
+            pStruct.lastStartDate = PAStringParam('default','','description','Skip recordings starting after this date (yyyy-mm-dd); empty for no limit');
 
             pStruct.featureLabel = PAStringParam('default','All','description','Feature selection');
             
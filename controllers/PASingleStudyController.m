@@ -520,7 +520,7 @@ classdef PASingleStudyController < PAViewController
             startStopDatenums = zeros(numSections,2);
             for i=1:numSections
                 meanLumens(i) = mean(luxData(indices(i):indices(i+1)));
-                startStopDatenums(i,:) = [paDataObj.dateTimeNum(indices(i)),paDataObj.dateTimeNum(indices(i+1))];
+                startStopDatenums(i,:) = [paDataObj.getDatenum(indices(i)),paDataObj.getDatenum(indices(i+1))];
             end
         end
         
@@ -545,8 +545,8 @@ classdef PASingleStudyController < PAViewController
                 paDataObj = obj.accelObj;
             end
             
-            indices = ceil(linspace(1,numel(paDataObj.dateTimeNum),numSections+1));
-            startStopDatenums = [paDataObj.dateTimeNum(indices(1:end-1)),paDataObj.dateTimeNum(indices(2:end))];
+            indices = ceil(linspace(1,paDataObj.getDurationSamples(),numSections+1));
+            startStopDatenums = [paDataObj.getDatenum(indices(1:end-1)),paDataObj.getDatenum(indices(2:end))];
             [y,mo,d,H,MI,S] = datevec(mean(startStopDatenums,2));
             dayTime = [H,MI,S]*[1; 1/60; 1/3600];
             %             dayTime = [[H(:,1),MI(:,1),S(:,1)]*[1;1/60;1/3600], [H(:,2),MI(:,2),S(:,2)]*[1;1/60;1/3600]];
@@ -671,9 +671,9 @@ classdef PASingleStudyController < PAViewController
             startStopDatenums = zeros(numSections,2);
             
             if(strcmpi(featureFcnName,'psd'))
-                indices = ceil(linspace(1,numel(paDataObj.dateTimeNum),numSections+1));
+                indices = ceil(linspace(1,paDataObj.getDurationSamples(),numSections+1));
                 for i=1:numSections
-                    startStopDatenums(i,:) = [paDataObj.dateTimeNum(indices(i)),paDataObj.dateTimeNum(indices(i+1))];
+                    startStopDatenums(i,:) = [paDataObj.getDatenum(indices(i)),paDataObj.getDatenum(indices(i+1))];
                 end
             else
                 timeSeriesStruct = paDataObj.getStruct('all','timeSeries');
@@ -681,7 +681,7 @@ classdef PASingleStudyController < PAViewController
                 
                 indices = ceil(linspace(1,numel(fieldData),numSections+1));
                 for i=1:numSections
-                    startStopDatenums(i,:) = [paDataObj.dateTimeNum(indices(i)),paDataObj.dateTimeNum(indices(i+1))];
+                    startStopDatenums(i,:) = [paDataObj.getDatenum(indices(i)),paDataObj.getDatenum(indices(i+1))];
                 end
             end
             
@@ -851,7 +851,12 @@ classdef PASingleStudyController < PAViewController
                 height = remainingHeight/itemsToDisplay;
                 
                 usageVec = obj.getUsageState();
-                obj.addWeartimeToSecondaryAxes(usageVec,obj.accelObj.dateTimeNum,height,heightOffset);
+                % Only the samples either side of each change of state are
+                % drawn, so the datenum of every sample is not generated.
+                numSamples = numel(usageVec);
+                changeIndices = find(diff(usageVec(:))~=0);
+                sampleIndices = unique([1; changeIndices; changeIndices+1; max(1,numSamples-1); numSamples]);
+                obj.addWeartimeToSecondaryAxes(usageVec(sampleIndices),obj.accelObj.getDatenum(sampleIndices),height,heightOffset);
                 % if(obj.accelObj.getSampleRate()<=1)
                     
                     % usageVec = obj.getUsageState();
@@ -1212,6 +1217,33 @@ classdef PASingleStudyController < PAViewController
 %             datetick(obj.axeshandle.secondary,'x','ddd HH:MM')
         end
         
+        % --------------------------------------------------------------------
+        %> @brief Draws the hourly overview of a study still loading in the
+        %> background (see PAStudyLoader) on the secondary axes: the range
+        %> and mean of its vector magnitude per bin.  Replaced when the
+        %> study is shown (see createLineAndLabelHandles).
+        %> @param obj Instance of PASingleStudyController
+        %> @param overview Struct with fields startDatenum, secondsPerBin
+        %> and minimums, maximums and means (columns x, y, z and vecMag).
+        % --------------------------------------------------------------------
+        function showLoadOverview(obj, overview)
+            if(isempty(overview) || isempty(overview.means))
+                return;
+            end
+            axesH = obj.axeshandle.secondary;
+            delete(findobj(axesH,'tag','loadOverview'));
+            numBins = size(overview.means,1);
+            binDatenums = overview.startDatenum+(0:numBins-1)'*overview.secondsPerBin/(24*60*60);
+            minVecMag = double(overview.minimums(:,4));
+            maxVecMag = double(overview.maximums(:,4));
+            scale = max([maxVecMag;eps]);
+            patch('xdata',[binDatenums;flipud(binDatenums)],'ydata',[minVecMag;flipud(maxVecMag)]/scale,...
+                'parent',axesH,'tag','loadOverview','hittest','off','facecolor',[0.75 0.85 1],'edgecolor','none');
+            line('xdata',binDatenums,'ydata',double(overview.means(:,4))/scale,...
+                'parent',axesH,'tag','loadOverview','hittest','off','color',[0 0 0.6]);
+            set(axesH,'xlim',[binDatenums(1), binDatenums(end)+overview.secondsPerBin/(24*60*60)],'ylim',[0 1]);
+        end
+
         % --------------------------------------------------------------------
         %> @brief Create the line handles and text handles that describe the lines,
         %> that will be displayed by the view.
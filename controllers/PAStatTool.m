@@ -44,6 +44,7 @@ classdef PAStatTool < PAViewController
         %> - @c clusterMethod Cluster method employed {'kmeans','kmedoids'}
         %> - @c useDefaultRandomizer = widgetSettings.useDefaultRandomizer;
         %> - @c initClusterWithPermutation = settings.initClusterWithPermutation;
+        %> - @c reducedDimensions = settings.reducedDimensions;
         %> @note Initialized in the setWidgetSettings() method
         clusterSettings;
 
@@ -93,9 +94,10 @@ classdef PAStatTool < PAViewController
         %> filtering).
         originalFeatureStruct;        
         
-        bootstrapParamNames = {'bootstrapIterations','bootstrapSampleName'};
+        bootstrapParamNames = {'bootstrapIterations','bootstrapSampleName','bootstrapSeed'};
         bootstrapIterations;
         bootstrapSampleName;
+        bootstrapSeed;
         
         %> structure containing Usage Activity feature output by padaco's batch tool.
         %> This is used to obtain removal indices when loading data (i.e.
@@ -139,6 +141,11 @@ classdef PAStatTool < PAViewController
         %> These are initialized in the initWidgets() method.
         previousState;
         
+        %> Cluster object the study store's person-day rows were last
+        %> written from, and its number of load shapes then (see
+        %> isStudyStoreCurrent).
+        studyStoreCluster = [];
+        studyStoreNumLoadShapes = 0;
     end
     
     properties(Access=private)
@@ -313,6 +320,7 @@ classdef PAStatTool < PAViewController
                 this.useOutcomes = this.getSetting('useOutcomes');
                 this.bootstrapIterations =  this.getSetting('bootstrapIterations');
                 this.bootstrapSampleName = this.getSetting('bootstrapSampleName');
+                this.bootstrapSeed = this.getSetting('bootstrapSeed');
                 this.maxNumDaysAllowed = this.getSetting('maxNumDaysAllowed');
                 this.minNumDaysAllowed = this.getSetting('minNumDaysAllowed');
                 
@@ -321,7 +329,7 @@ classdef PAStatTool < PAViewController
                 % this.useCache = this.getSetting('useCache');                
                 this.cacheDirectory = this.getSetting('cacheDirectory');
                 
-                clusterFields = {'clusterMethod', 'distanceMetric', 'useDefaultRandomizer', 'initClusterWithPermutation'};
+                clusterFields = {'clusterMethod', 'distanceMetric', 'useDefaultRandomizer', 'initClusterWithPermutation', 'reducedDimensions'};
                 for c=1:numel(clusterFields)
                     fname = clusterFields{c};
                     this.clusterSettings.(fname) = this.getSetting(fname);
@@ -428,6 +436,7 @@ classdef PAStatTool < PAViewController
                                 
                                 this.clusterObj.setExportPath(exportPathname);
                                 this.clusterObj.addlistener('DefaultParameterChange',@this.clusterParameterChangeCb);
+                                this.updateStudyStore();
                             end
                             
                             % updates our features and start/stop times
@@ -614,6 +623,7 @@ classdef PAStatTool < PAViewController
                             error('Import file (%s) is malformed and does not include ''nonwear'' field', importFilename);
                         end                        
                         nonwearStruct = this.matchExclusionsToContent(nonwearStruct, this.originalFeatureStruct);
+                        nonwearStruct = this.restoreExclusionIndex(nonwearStruct, this.originalFeatureStruct);
                         
                         this.nonwear.imported_file = nonwearStruct;
                         this.nonwear.imported_file.filename = importFilename;
@@ -689,6 +699,11 @@ classdef PAStatTool < PAViewController
                         end
                     end
                     
+                    if isfield(exclusionsStruct, 'index')
+                        exclusionsStruct.index = exclusionsStruct.index.selectTags([fieldsToKeep(:); strcat(fieldsToKeep(:),'_malfunction')]);
+                    end
+                    exclusionsStruct = this.saveableExclusionIndex(exclusionsStruct);
+                    
                     exportPath = curCluster.getExportPath();
                     description = strjoin(fieldsToKeep,'_and_');
                     exclusionsStruct.description = description;
@@ -1097,7 +1112,16 @@ classdef PAStatTool < PAViewController
                 end
                 
                 this.nonwear.choi = tmpChoiStruct;
-                
+                % The structs cover the whole day and all rows until they
+                % are cut to the time window below.
+                this.nonwear.startEndTimes = [];
+                this.nonwear.indicesToUse = [];
+                
+                % Pack the nonwear epochs once per load so time window
+                % queries below do not rescan the shapes.
+                if loadFileRequired || this.nonwearRequiresUpdate || ~isfield(this.nonwear,'index')
+                    this.nonwear.index = PAExclusionIndex.fromNonwearStruct(this.nonwear, this.originalFeatureStruct);
+                end
                 
                 % update to here to make sure we are covered for the one
                 % week case now.  So we can exclude based on the days
@@ -1177,6 +1201,12 @@ classdef PAStatTool < PAViewController
                 this.nonwear.choi = tmpChoiStruct;                
                 nonwearMethods = this.getSetting('discardMethod');
                 startEndTimes = this.originalFeatureStruct.startTimes([startTimeSelection, stopTimeSelection]);
+                % The index covers the whole day and all rows; these let it
+                % answer for the structs as cut above (see getNonwearRows).
+                if(startTimeSelection ~= stopTimeSelection)
+                    this.nonwear.startEndTimes = startEndTimes;
+                end
+                this.nonwear.indicesToUse = indicesToUse;
                 [this.nonwear.rows, malfunctionRows] = this.getNonwearRows(nonwearMethods, this.nonwear, startEndTimes);
                 % this.nonwear.rows = this.nonwear.rows | malfunctionRows;
                 if this.isShowingWeekLong(pSettings)
@@ -1315,34 +1345,12 @@ classdef PAStatTool < PAViewController
                     numChunks = double(pSettings.numChunks);  
                     
                     if pSettings.chunkShapes && numChunks>1
-                        % The other transformation will reduce the number
-                        % of columns, so we need to account for that here.
-                        [numRows, numCols] = size(loadFeatures);
-                        if(~strcmpi(pSettings.preclusterReduction,'sort'))
-                            numCols = numChunks;
-                        end
-                        splitLoadFeatures = nan(numRows,numCols);
-                        
-                        % 1. Reshape the loadFeatures by segments
-                        % 2. Sort the loadfeatures
-                        % 3. Resahpe the load features back to the original                        % 
-                        % way
-                        
-                        % Or make a for loop and sort along the way ...
+                        % Reduce (or sort) consecutive, non-overlapping
+                        % sections of columns; one output column per
+                        % section for reductions, and the section's
+                        % columns for sorting.
                         sections = round(linspace(0,size(loadFeatures,2), numChunks+1));  %Round to give integer indices
-                        for s=1:numel(sections)-1
-                            sectionInd = sections(s)+1:sections(s+1); % Create consecutive, non-overlapping sections of column indices.
-                            if(numCols == numChunks)
-                                % Case 1: we are we reducing the output, so
-                                % only 1 column per s
-                                splitLoadFeatures(:,s) = PAStatTool.featureSetAdjustment(loadFeatures(:,sectionInd),pSettings.preclusterReduction);
-                            else
-                                % otherwise do not reduce the output
-                                splitLoadFeatures(:,sectionInd) = PAStatTool.featureSetAdjustment(loadFeatures(:,sectionInd),pSettings.preclusterReduction);
-                            end
-                            %                             sort(loadFeatures(:,sectionInd),2,'descend');
-                        end
-                        loadFeatures = splitLoadFeatures;
+                        loadFeatures = PAStatTool.featureSetAdjustment(loadFeatures,pSettings.preclusterReduction,sections);
                     else
                         if ~strcmpi(pSettings.preclusterReduction,'sort') || pSettings.chunkShapes
                             loadFeatures = PAStatTool.featureSetAdjustment(loadFeatures,pSettings.preclusterReduction);
@@ -1688,6 +1696,68 @@ classdef PAStatTool < PAViewController
             fullFilename = fullfile(this.cacheDirectory,this.RESULTS_CACHE_FILENAME);
         end
         
+        function fullFilename = getFullStudyStoreFilename(this)
+            fullFilename = fullfile(this.cacheDirectory,PAStudyStore.DEFAULT_FILENAME);
+        end
+        
+        % ======================================================================
+        %> @brief Writes the current cluster's person-days (and the outcomes
+        %> subjects table, when loaded) to the study store used as the
+        %> database.  Does nothing when the database is not a PAStudyStore.
+        %> @retval didUpdate True if the store was written.
+        % ======================================================================
+        function didUpdate = updateStudyStore(this)
+            didUpdate = false;
+            if(isa(this.databaseObj,'PAStudyStore') && (isdir(this.cacheDirectory) || mkdir(this.cacheDirectory)))
+                outcomesTable = [];
+                if(isa(this.outcomesObj,'PAOutcomesTableData') && this.outcomesObj.isValid)
+                    outcomesTable = this.outcomesObj.subjects;
+                end
+                clusterObj = [];
+                if(this.hasValidCluster())
+                    clusterObj = this.getClusterObj();
+                end
+                didUpdate = this.databaseObj.update(clusterObj, outcomesTable);
+                if(didUpdate && ~isempty(clusterObj))
+                    this.studyStoreCluster = clusterObj;
+                    this.studyStoreNumLoadShapes = numel(clusterObj.loadShapeIDs);
+                end
+            end
+        end
+
+        % ======================================================================
+        %> @brief Checks if the study store holds the person-days of the
+        %> current clusters.  Memberships change only when the clusters are
+        %> recalculated (a new cluster object) or load shapes are assigned
+        %> to them (more load shapes).
+        %> @param this Instance of PAStatTool
+        %> @retval isCurrent True if the store's persondays table is current.
+        % ======================================================================
+        function isCurrent = isStudyStoreCurrent(this)
+            isCurrent = isa(this.databaseObj,'PAStudyStore') && this.hasValidCluster() && ...
+                ~isempty(this.studyStoreCluster) && this.studyStoreCluster==this.clusterObj && ...
+                this.studyStoreNumLoadShapes==numel(this.clusterObj.loadShapeIDs) && this.databaseObj.exists();
+        end
+
+        % ======================================================================
+        %> @brief Covariates of the current clusters (see
+        %> PACluster.getCovariateStruct).  Membership counts come from the
+        %> study store's indexed person-day rows when it is current.
+        %> @param this Instance of PAStatTool
+        %> @retval covariateStruct Covariate struct of the clusters.
+        % ======================================================================
+        function covariateStruct = getClusterCovariateStruct(this)
+            centroidIDCount = [];
+            if(this.isStudyStoreCurrent())
+                try
+                    centroidIDCount = this.databaseObj.getMembershipCounts(this.clusterObj.getNumClusters(),this.clusterObj.getUniqueLoadShapeIDs());
+                catch me
+                    this.logError(me,'Could not count cluster memberships in the study store');
+                end
+            end
+            covariateStruct = this.clusterObj.getCovariateStruct([],centroidIDCount);
+        end
+        
         % ======================================================================
         %> @brief Checks if a cluster object member (instance of
         %> PACluster) exists and converged.
@@ -1868,7 +1938,12 @@ classdef PAStatTool < PAViewController
             try
                 if(this.useDatabase)
                     databaseValue = this.getSetting('databaseClass');
-                    this.databaseObj = feval(databaseValue);
+                    if(strcmp(databaseValue,'PAStudyStore'))
+                        this.databaseObj = PAStudyStore(this.getFullStudyStoreFilename());
+                        this.updateStudyStore();
+                    else
+                        this.databaseObj = feval(databaseValue);
+                    end
                     %this.databaseObj = feval(this.originalSettings.databaseClass.value);
                     
                     if isunix
@@ -2680,7 +2755,7 @@ classdef PAStatTool < PAViewController
         
         function analysisFigurePlotHistogramCb(this, hObject,eventData)
             %  this.setTimedStatus(5,'Plotting!');
-            cs = this.clusterObj.getCovariateStruct();
+            cs = this.getClusterCovariateStruct();
             pData = this.getProfileData(cs.memberIDs,this.getProfileFieldSelection());
             fname = fieldnames(pData);
             figName = 'Covariate distribution';
@@ -2730,7 +2805,7 @@ classdef PAStatTool < PAViewController
                 %                'bmi_zscore+'  %for logistic regression modeling
                 %
                 % --all--
-                covariateStruct = this.clusterObj.getCovariateStruct();
+                covariateStruct = this.getClusterCovariateStruct();
                 covariateStruct.id.memberIDs = covariateStruct.memberIDs;
                 
                 % current selection
@@ -3704,6 +3779,8 @@ classdef PAStatTool < PAViewController
         %> - originalFeatureStruct
         %> - usageStateStruct
         %> - featuresDirectory
+        %> - clusterModel (see PAClusterModel.toStruct), which
+        %> assignToCachedClusters assigns new studies with
         function didCache = cacheCluster(this)
             didCache = false;
             if(this.useCache)
@@ -3717,8 +3794,13 @@ classdef PAStatTool < PAViewController
                         tmpStruct.choiNonwearStruct = this.choiNonwearStruct;
                         tmpStruct.featuresDirectory = this.featuresDirectory;
                         tmpStruct.nonwear = this.nonwear;
+                        clusterModel = tmpStruct.clusterObj.getClusterModel(this.getClusterSettings());
+                        if(~isempty(clusterModel))
+                            tmpStruct.clusterModel = clusterModel.toStruct();
+                        end
                         fnames = fieldnames(tmpStruct);
                         save(this.getFullClusterCacheFilename(),'-mat','-struct','tmpStruct',fnames{:});
+                        this.updateStudyStore();
                         didCache = true;
                     catch me
                         showME(me);
@@ -3728,6 +3810,62 @@ classdef PAStatTool < PAViewController
             end
         end
         
+        % ======================================================================
+        %> @brief Adds the load shapes of studies that are new since the
+        %> cached clustering to its clusters with the cached cluster model
+        %> (see PACluster.assignLoadShapes), instead of reclustering.
+        %> @param this Instance of PAStatTool
+        %> @param newClusterObj PACluster of every load shape, not yet
+        %> calculated.
+        %> @param cSettings Cluster settings the load shapes were prepared with.
+        %> @retval didAssign True if clusterObj is now the cached clustering
+        %> with the new load shapes assigned.  False when the load shapes
+        %> must be clustered: there is no cached cluster model, it was made
+        %> with other settings, or a cached study's load shapes changed.
+        % ======================================================================
+        function didAssign = assignToCachedClusters(this, newClusterObj, cSettings)
+            didAssign = false;
+            cacheFilename = this.getFullClusterCacheFilename();
+            if(~this.useCache || ~exist(cacheFilename,'file'))
+                return;
+            end
+            try
+                tmpStruct = load(cacheFilename,'-mat','clusterObj','clusterModel','featuresDirectory');
+                if(~all(isfield(tmpStruct,{'clusterObj','clusterModel','featuresDirectory'})) || ...
+                        ~isa(tmpStruct.clusterObj,'PACluster') || ~strcmpi(tmpStruct.featuresDirectory,this.featuresDirectory))
+                    return;
+                end
+                cachedObj = tmpStruct.clusterObj;
+                clusterModel = PAClusterModel.loadFromFile(tmpStruct.clusterModel);
+                if(isempty(clusterModel) || cachedObj.failedToConverge() || ~isequal(clusterModel.settings,paparamsToValues(cSettings)))
+                    return;
+                end
+
+                % Every cached load shape must still be there, unchanged and
+                % in the same order, ahead of or among the new ones.
+                isCached = ismember(newClusterObj.loadShapeIDs,cachedObj.uniqueLoadShapeIDs);
+                if(sum(isCached)~=size(cachedObj.loadShapes,1) || ~isequal(newClusterObj.loadShapes(isCached,:),cachedObj.loadShapes))
+                    return;
+                end
+                isNew = ~isCached;
+                if(any(isNew))
+                    newNonwearRows = [];
+                    if(~isempty(newClusterObj.nonwearRows))
+                        newNonwearRows = newClusterObj.nonwearRows(isNew);
+                    end
+                    cachedObj.assignLoadShapes(newClusterObj.loadShapes(isNew,:),newClusterObj.loadShapeIDs(isNew),...
+                        newClusterObj.loadShapeDayOfWeek(isNew,:),clusterModel,newNonwearRows);
+                end
+                cachedObj.setExportPath(this.getSetting('exportPathname'));
+                cachedObj.addlistener('DefaultParameterChange',@this.clusterParameterChangeCb);
+                this.clusterObj = cachedObj;
+                this.setStatus(sprintf('%d new load shapes assigned to the cached clusters',sum(isNew)));
+                didAssign = true;
+            catch me
+                showME(me);
+            end
+        end
+
         function featureStruct = getFeatureStruct(this)
             featureStruct = this.featureStruct;
         end
@@ -3783,6 +3921,10 @@ classdef PAStatTool < PAViewController
             if(nargin<2)
                 numBootstraps = this.bootstrapIterations;
             end
+            if(this.canBootstrapNatively())
+                this.bootstrapNatively(numBootstraps);
+                return;
+            end
             % configure progress bar
             didCancel = false;
             function cbFcn(hObject,evtData)
@@ -3855,28 +3997,7 @@ classdef PAStatTool < PAViewController
                     end
                     
                     
-                    CI = 95;  %i.e. we want the 95% confidence interval
-                    CI_alpha = 100-CI;
-                    CI_range = [CI_alpha/2, 100-CI_alpha/2];  %[2.5, 97.5]
-                    
-                    message = cell(numel(paramNames)+1,1);
-                    message{1} = sprintf('95%% Confidence Interval(s) using\n\tbootstrap iterations = %i\n\tsample size = %i\nComputation Time: %s\n',n,sample_size,getTimeElapsedStr(startTime));
-                    for f=1:numel(paramNames)
-                        pName = paramNames{f};
-                        values = params.(pName)(1:n);
-                        param_CI_percentile = prctile(values,CI_range);
-                        stdVal = std(values);
-                        meanVal = mean(values);
-                        stdCI = meanVal+stdVal*[-1.96, +1.96];
-                        message{f+1} = sprintf('%s mean = %0.4f\tSD = %0.4f\tMean+/-1.96*SD = [%0.4f, %0.4f]\t95%% CI = [%0.4f, %0.4f]' ,pName,meanVal,stdVal, stdCI(1), stdCI(2),param_CI_percentile(1),param_CI_percentile(2));
-                    end
-                    
-                    for m=1:numel(message)
-                        fprintf(1,'%s\n',message{m});
-                    end
-                    
-                    msgbox(message,'Bootstrap results');
-                    %message{k+1} = [paramCell(k).label,' [ ',num2str(config_CI_percentile(1,k),decimal_format),', ',num2str(config_CI_percentile(2,k),decimal_format),']'];
+                    this.showBootstrapResults(params, n, sample_size, startTime);
                 end
                 
             catch me
@@ -3892,6 +4013,160 @@ classdef PAStatTool < PAViewController
             
         end
         
+        % ======================================================================
+        %> @brief Checks if bootstrap replicates can be run by the
+        %> bootstrapclusters mex file, which supports adaptive k-means with
+        %> squared euclidean distance.
+        %> @param this Instance of PAStatTool
+        %> @retval canIt True if bootstrapclusters is compiled and the
+        %> cluster settings are supported.
+        % ======================================================================
+        function canIt = canBootstrapNatively(this)
+            canIt = false;
+            if(exist('bootstrapclusters','file')==3)
+                cSettings = this.getClusterSettings();
+                % the mex clusters the load shapes as they are, without PAShapeProjection
+                canIt = strcmpi(cSettings.clusterMethod,'kmeans') && strcmpi(cSettings.distanceMetric,'sqeuclidean') ...
+                    && cSettings.reducedDimensions==0;
+            end
+        end
+
+        % ======================================================================
+        %> @brief Runs bootstrap replicates on all cores with the
+        %> bootstrapclusters mex file.  The load shapes are clustered once
+        %> as shown, and every replicate then resamples those shapes (by
+        %> study or by day) as weights on one shared copy, rather than
+        %> reloading and copying them.  Results stream into a results file
+        %> in the export path as replicates finish; a cancelled run is
+        %> resumed when the same bootstrap is started again.
+        %> @param this Instance of PAStatTool
+        %> @param numBootstraps Number of bootstrap replicates.
+        % ======================================================================
+        function bootstrapNatively(this, numBootstraps)
+            didCancel = false;
+            function cbFcn(hObject,evtData)
+                waitbar(1,h,'Cancelling ...');
+                didCancel = true;
+            end
+
+            h = waitbar(0,'Preparing for bootstrap','CreateCancelBtn',@cbFcn);
+            startTime = now;
+            try
+                allowUserCancel = false;
+                if(~this.refreshClustersAndPlot(allowUserCancel) || ~this.hasValidCluster())
+                    throw(MException('PAStatTool:Bootstrap','The load shapes could not be clustered.'));
+                end
+                loadShapes = this.clusterObj.loadShapes;
+                if(~isempty(this.clusterObj.shapeProjection))
+                    loadShapes = this.clusterObj.shapeProjection.project(loadShapes);
+                end
+                [~,~,studyIndices] = unique(this.clusterObj.loadShapeIDs);
+
+                bootSettings.numBootstraps = numBootstraps;
+                bootSettings.bootstrapSampleName = char(this.bootstrapSampleName);
+                bootSettings.minClusters = double(this.clusterObj.getSetting('minClusters'));
+                bootSettings.clusterThreshold = double(this.clusterObj.getSetting('clusterThreshold'));
+                bootSettings.initClusterWithPermutation = logical(this.clusterObj.getSetting('initClusterWithPermutation'));
+                bootSettings.seed = double(this.bootstrapSeed);
+
+                pSettings = this.getPlotSettings();
+                resultsFilename = fullfile(this.getSetting('exportPathname'),sprintf('bootstrap.%s.%s.%s.csv',pSettings.baseFeature,pSettings.curSignal,this.bootstrapSampleName));
+                try
+                    numResumed = bootstrapclusters('start',double(loadShapes),double(studyIndices(:)),bootSettings,resultsFilename);
+                catch me
+                    if(~strcmp(me.identifier,'PadacoToolbox:bootstrapclusters:start') || ~exist(resultsFilename,'file'))
+                        rethrow(me);
+                    end
+                    % Results of different shapes or settings; keep them aside.
+                    [pathname,basename] = fileparts(resultsFilename);
+                    previousFilename = fullfile(pathname,sprintf('%s.%s.csv',basename,datestr(now,'yyyymmddTHHMMSS')));
+                    movefile(resultsFilename,previousFilename);
+                    this.logWarning('%s (moved to %s)',me.message,previousFilename);
+                    numResumed = bootstrapclusters('start',double(loadShapes),double(studyIndices(:)),bootSettings,resultsFilename);
+                end
+                if(numResumed>0)
+                    fprintf(1,'Resuming bootstrap with %d of %d replicates from %s\n',numResumed,numBootstraps,resultsFilename);
+                end
+
+                status = bootstrapclusters('status');
+                while(status.isRunning)
+                    if(didCancel || ~ishandle(h))
+                        bootstrapclusters('cancel');
+                        bootstrapclusters('wait');
+                    else
+                        msg = sprintf('Bootstrapping %d of %d done  (%s)',status.numDone,numBootstraps,getTimeElapsedStr(startTime));
+                        waitbar(status.numDone/numBootstraps,h,msg);
+                        this.setStatus(msg);
+                        pause(0.5);
+                    end
+                    status = bootstrapclusters('status');
+                end
+                results = bootstrapclusters('results');
+                bootstrapclusters('clear');
+
+                if(ishandle(h))
+                    delete(h);
+                end
+                if(status.numDone<numBootstraps)
+                    fprintf(1,'Bootstrap cancelled with %d of %d replicates in %s; start it again to resume.\n',status.numDone,numBootstraps,resultsFilename);
+                end
+                if(status.numDone>1)
+                    if(strcmpi(this.bootstrapSampleName,'days'))
+                        sample_size = size(loadShapes,1);
+                    else
+                        sample_size = max(studyIndices);
+                    end
+                    this.showBootstrapResults(results, status.numDone, sample_size, startTime);
+                end
+            catch me
+                showME(me);
+                if(exist('bootstrapclusters','file')==3)
+                    bootstrapclusters('clear');
+                end
+            end
+            if(ishandle(h))
+                delete(h);
+            end
+            this.clearStatus();
+        end
+
+        % ======================================================================
+        %> @brief Reports the 95% confidence intervals of bootstrap
+        %> replicates' cluster counts, silhouette and Calinski indices.
+        %> @param this Instance of PAStatTool
+        %> @param params Struct with clusterCount, silhouetteIndex and
+        %> calinskiIndex vectors, one value per replicate (NaN when it did
+        %> not converge).
+        %> @param numBootstraps Number of replicates.
+        %> @param sample_size Number of studies (or days) resampled.
+        %> @param startTime datenum the bootstrap started.
+        % ======================================================================
+        function showBootstrapResults(this, params, numBootstraps, sample_size, startTime)
+            paramNames = {'clusterCount','silhouetteIndex','calinskiIndex'};
+            CI = 95;  %i.e. we want the 95% confidence interval
+            CI_alpha = 100-CI;
+            CI_range = [CI_alpha/2, 100-CI_alpha/2];  %[2.5, 97.5]
+
+            message = cell(numel(paramNames)+1,1);
+            message{1} = sprintf('95%% Confidence Interval(s) using\n\tbootstrap iterations = %i\n\tsample size = %i\nComputation Time: %s\n',numBootstraps,sample_size,getTimeElapsedStr(startTime));
+            for f=1:numel(paramNames)
+                pName = paramNames{f};
+                values = params.(pName)(1:numBootstraps);
+                values = values(~isnan(values));  % replicates that did not converge
+                param_CI_percentile = prctile(values,CI_range);
+                stdVal = std(values);
+                meanVal = mean(values);
+                stdCI = meanVal+stdVal*[-1.96, +1.96];
+                message{f+1} = sprintf('%s mean = %0.4f\tSD = %0.4f\tMean+/-1.96*SD = [%0.4f, %0.4f]\t95%% CI = [%0.4f, %0.4f]' ,pName,meanVal,stdVal, stdCI(1), stdCI(2),param_CI_percentile(1),param_CI_percentile(2));
+            end
+
+            for m=1:numel(message)
+                fprintf(1,'%s\n',message{m});
+            end
+
+            msgbox(message,'Bootstrap results');
+        end
+
         function refreshClustersAndPlotCb(this, varargin)
             try
                 enableUserCancel = true;
@@ -4095,8 +4370,12 @@ classdef PAStatTool < PAViewController
                     if(enableUserCancel)
                         this.enableClusterCancellation();
                     end
-                    this.clusterObj = tmpClusterObj;
-                    this.clusterObj.calculateClusters();
+                    % Studies added since the cached clustering join its
+                    % clusters instead of reclustering every study.
+                    if(~isempty(varargin) || ~this.assignToCachedClusters(tmpClusterObj, cSettings))
+                        this.clusterObj = tmpClusterObj;
+                        this.clusterObj.calculateClusters();
+                    end
                     
                     if(this.clusterObj.failedToConverge())
                         warnMsg = {'Failed to converge.',[]};
@@ -4117,7 +4396,9 @@ classdef PAStatTool < PAViewController
                     else
                         this.refreshGlobalProfile();
                         this.clusterObj.featureStruct = this.featureStruct;
-                        this.cacheCluster();
+                        if(~this.cacheCluster())
+                            this.updateStudyStore();
+                        end
                     end
                 end
             else
@@ -4889,6 +5170,7 @@ classdef PAStatTool < PAViewController
             userSettings.distanceMetric = this.clusterSettings.distanceMetric;
             userSettings.initClusterWithPermutation = this.clusterSettings.initClusterWithPermutation;
             userSettings.useDefaultRandomizer = this.clusterSettings.useDefaultRandomizer;
+            userSettings.reducedDimensions = this.clusterSettings.reducedDimensions;
             
             % Cluster reduction settings
             userSettings.preclusterReductionSelection = get(this.handles.menu_precluster_reduction,'value');
@@ -5018,7 +5300,7 @@ classdef PAStatTool < PAViewController
                     % This gets the memberIDs attached to each cluster.
                     % This gives us all values with clusters interpreted
                     % in sort order (1 is most popular)
-                    globalStruct = this.clusterObj.getCovariateStruct();
+                    globalStruct = this.getClusterCovariateStruct();
                     
                     % globalProfile is an Nx3 mat, where N is the number of
                     % profile fields (one per row), and the columns are
@@ -5236,6 +5518,36 @@ classdef PAStatTool < PAViewController
             end
         end
         
+        % ======================================================================
+        %> @brief Restores the exclusion indices saved by exportExclusions,
+        %> realigned to the rows of the loaded features.
+        %> @param exclusions Imported exclusions struct.
+        %> @param contentToMatch Feature struct to align to.
+        %> @retval exclusions Struct with index (and imported_file.index)
+        %> fields as PAExclusionIndex objects.
+        % ======================================================================
+        function exclusions = restoreExclusionIndex(exclusions, contentToMatch)
+            if isfield(exclusions, 'index') && isstruct(exclusions.index)
+                [exclusions.index, numMatched] = PAExclusionIndex.fromStruct(exclusions.index).alignTo(contentToMatch);
+                fprintf(1, 'Exclusion index matched %d of %d feature rows.\n', numMatched, exclusions.index.getRowCount());
+                % rows of the exporting session's subset no longer apply
+                exclusions.indicesToUse = [];
+            end
+            if isfield(exclusions, 'imported_file') && isstruct(exclusions.imported_file)
+                exclusions.imported_file = PAStatTool.restoreExclusionIndex(exclusions.imported_file, contentToMatch);
+            end
+        end
+        
+        % Inverse of restoreExclusionIndex: plain structs for save().
+        function exclusions = saveableExclusionIndex(exclusions)
+            if isfield(exclusions, 'index') && isa(exclusions.index, 'PAExclusionIndex')
+                exclusions.index = exclusions.index.toStruct();
+            end
+            if isfield(exclusions, 'imported_file') && isstruct(exclusions.imported_file)
+                exclusions.imported_file = PAStatTool.saveableExclusionIndex(exclusions.imported_file);
+            end
+        end
+        
         % ======================================================================
         function [featureStruct, discardedFeatureStruct] = discardNonwearFeatures(featureStructIn,nonwearRows)
             %         function featureStruct = getValidFeatureStruct(originalFeatureStruct,usageStateStruct)
@@ -5256,6 +5568,11 @@ classdef PAStatTool < PAViewController
         % nonwearStruct - struct with field names keyed on the nonwearMethod
         %  - 'import' == nonwearStruct that was imported.
         %  - 'padaco' == usageStage struct (from Padaco)
+        %  - 'index' == (optional) PAExclusionIndex of the whole day and all
+        %  rows, with the startEndTimes and indicesToUse the padaco and choi
+        %  structs were cut to (see calcFeatureStruct).
+        % startEndTimes - (optional) 'HH:MM' start and end time of the
+        % window.  Default is the window the structs were cut to.
         % nonwearRows = logical vector indicating which feature vectors of the second argument
         % are considered as nonwear or having data from a malfunctioning device.
         % malfunctionRows = logical vector indicating which feature vectors of the second argument
@@ -5265,7 +5582,8 @@ classdef PAStatTool < PAViewController
         function [nonwearRows, malfunctionRows] = getNonwearRows(nonwearMethod, nonwearStruct, startEndTimes)
             nonwearRows = [];
             malfunctionRows = [];
-            if nargin<3
+            hasWindow = nargin>2;
+            if ~hasWindow
                 startEndTimes = {'0:00','24:00'};
             end
             
@@ -5273,6 +5591,28 @@ classdef PAStatTool < PAViewController
                 startEndTimes = duration(startEndTimes,'inputformat','hh:mm');
             end
             
+            % Indexed methods are answered from the packed bits, which also
+            % handles windows that wrap past midnight.  Imported exclusions
+            % keep their own index (or rows) in the imported_file field.
+            if isstruct(nonwearStruct) && isfield(nonwearStruct,'index') && isa(nonwearStruct.index,'PAExclusionIndex')
+                indexTimes = startEndTimes;
+                if ~hasWindow && isfield(nonwearStruct,'startEndTimes') && ~isempty(nonwearStruct.startEndTimes)
+                    indexTimes = nonwearStruct.startEndTimes;
+                end
+                [nonwearRows, malfunctionRows] = nonwearStruct.index.getNonwearRows(nonwearMethod, indexTimes);
+                if any(ismember(lower(cellstr(nonwearMethod)),{'import','imported_file'}))
+                    importedRows = PAStatTool.getNonwearRows('imported_file', rmfield(nonwearStruct,'index'), startEndTimes);
+                    if ~isempty(importedRows)
+                        nonwearRows = nonwearRows | importedRows;
+                    end
+                end
+                if isfield(nonwearStruct,'indicesToUse') && ~isempty(nonwearStruct.indicesToUse)
+                    nonwearRows = nonwearRows(nonwearStruct.indicesToUse);
+                    malfunctionRows = malfunctionRows(nonwearStruct.indicesToUse);
+                end
+                return;
+            end
+            
             if iscell(nonwearMethod)
                 for c=1:numel(nonwearMethod)
                     [tmpNonwearRows, tmpMalfunctionRows] = PAStatTool.getNonwearRows(nonwearMethod{c}, nonwearStruct, startEndTimes);
@@ -5446,11 +5786,15 @@ classdef PAStatTool < PAViewController
             end
             
             % normalize our results...
-            loadShapes = loadShapes-min(loadShapes,[],2);
-            a= sum(loadShapes,2);
-            nzi = a~=0;
-            loadShapes(nzi,:) = loadShapes(nzi,:)./max(loadShapes(nzi,:),[],2);
-            normalizedLoadShapes = loadShapes;
+            if(exist('featurereduce','file')==3)
+                [normalizedLoadShapes, nzi] = featurereduce(double(loadShapes),'normalize');
+            else
+                loadShapes = loadShapes-min(loadShapes,[],2);
+                a= sum(loadShapes,2);
+                nzi = a~=0;
+                loadShapes(nzi,:) = loadShapes(nzi,:)./max(loadShapes(nzi,:),[],2);
+                normalizedLoadShapes = loadShapes;
+            end
             
         end
         
@@ -5465,11 +5809,44 @@ classdef PAStatTool < PAViewController
         %> - 'sum'
         %> - 'mean'
         %> - 'median'
+        %> @param sections (optional) Column edges [0, ..., M] of consecutive
+        %> sections to reduce separately; the results are concatenated
+        %> by section.  Default is a single section.
         %> @param featureSet NxK array of N feature sets, each of dimension
         %> K, where K is 1 when reductionMethod is 'mean','median', or 'sum', and K is
         %> equal to M otherwise (eg. 'sort','none', or unrecognized)
+        %> @note The featurereduce mex file computes the reductions it
+        %> supports for all sections in a single pass when compiled.
+        % ======================================================================
+        function featureSet = featureSetAdjustment(featureSet, reductionMethod, sections)
+            if(nargin<3)
+                sections = [];
+            end
+            if(strncmpi(reductionMethod,'romanzini',9))
+                fprintf(1,'Romanzini cutpoints assume Vector Magnitude counts calculated with a 1 minute epoch.\n');
+            end
+            [nativeReduction, bands] = PAStatTool.getNativeReduction(reductionMethod);
+            if(~isempty(nativeReduction) && exist('featurereduce','file')==3)
+                featureSet = featurereduce(double(featureSet), nativeReduction, sections, bands);
+            elseif(~isempty(sections))
+                reducedSections = cell(1, numel(sections)-1);
+                for s=1:numel(sections)-1
+                    reducedSections{s} = PAStatTool.reduceFeatureRows(featureSet(:,sections(s)+1:sections(s+1)),reductionMethod);
+                end
+                featureSet = [reducedSections{:}];
+            else
+                featureSet = PAStatTool.reduceFeatureRows(featureSet,reductionMethod);
+            end
+        end
+        
+        % ======================================================================
+        %> @brief MATLAB reductions of featureSetAdjustment, applied along
+        %> each row of a single section.
+        %> @param featureSet NxM array of N feature sets, each of dimension M.
+        %> @param reductionMethod See featureSetAdjustment.
+        %> @retval featureSet NxK array of reduced feature sets.
         % ======================================================================
-        function featureSet = featureSetAdjustment(featureSet, reductionMethod)
+        function featureSet = reduceFeatureRows(featureSet, reductionMethod)
             switch(lower(reductionMethod))
                 case 'sort'
                     featureSet = sort(featureSet,2,'descend'); %sort rows from high to low
@@ -5490,7 +5867,6 @@ classdef PAStatTool < PAViewController
                 case 'above_1000'
                     featureSet = sum(featureSet>1000,2);
                 case {'romanzini_sb','romanzini_lpa','romanzini_mvpa','romanzini_mpa','romanzini_vpa','romanzini_all'}
-                    fprintf(1,'Romanzini cutpoints assume Vector Magnitude counts calculated with a 1 minute epoch.\n');
                     [rziStruct, fnames, cutpoints] = getRomanziniCutpoints();
                     if strcmpi(reductionMethod, 'romanzini_all')
                         % Activity categories are ordered as [sedentary, light, moderate, vigorous]
@@ -5543,6 +5919,32 @@ classdef PAStatTool < PAViewController
             end
         end
         
+        % ======================================================================
+        %> @brief Maps a featureSetAdjustment reduction method to the
+        %> featurereduce mex file's reduction.
+        %> @param reductionMethod See featureSetAdjustment.
+        %> @retval nativeReduction Reduction name for featurereduce, or
+        %> empty when the method is only available in MATLAB.
+        %> @retval bands Kx2 [low, high] cutpoints for the 'bands' reduction.
+        % ======================================================================
+        function [nativeReduction, bands] = getNativeReduction(reductionMethod)
+            bands = [];
+            nativeReduction = lower(reductionMethod);
+            switch(nativeReduction)
+                case {'sort','mean','sum','median','max','above_50','above_100','above_500','above_1000'}
+                case {'romanzini_sb','romanzini_lpa','romanzini_mvpa','romanzini_mpa','romanzini_vpa','romanzini_all'}
+                    [rziStruct, ~, cutpoints] = getRomanziniCutpoints();
+                    if strcmpi(reductionMethod, 'romanzini_all')
+                        bands = cell2mat(cutpoints(:));
+                    else
+                        bands = rziStruct.(nativeReduction);
+                    end
+                    nativeReduction = 'bands';
+                otherwise
+                    nativeReduction = '';
+            end
+        end
+        
         % ======================================================================
         %> @brief Gets parameters for default initialization of a
         %> PAStatTool object.
@@ -5646,14 +6048,15 @@ classdef PAStatTool < PAViewController
             paramStruct.clusterDistributionType = PAEnumParam('default','loadshape_membership','categories',{{'loadshape_membership','participant_membership','nonwear_membership','weekday_scores','performance_progression','weekday_membership'}},'description','Cluster distribution selection');
             
             paramStruct.useOutcomes = PABoolParam('default',false,'description','Use outcomes table');
-            paramStruct.useDatabase = PABoolParam('default',false,'description','Use MySQL database');
+            paramStruct.useDatabase = PABoolParam('default',false,'description','Use study store or database');
             
-            paramStruct.databaseClass = PAStringParam('default','CLASS_database_goals','description','Database classname');
+            paramStruct.databaseClass = PAStringParam('default','PAStudyStore','description','Database classname','help','PAStudyStore keeps cluster membership and outcomes in an indexed file in the cache directory; CLASS_database_goals uses a MySQL server.');
             paramStruct.profileFieldSelection = PAIndexParam('default',1,'description','Profile field selection');
             paramStruct.profileFieldIndex =     PAIndexParam('default',1,'description','Profile field index'); % is one for database and the other for outcomes table?  looks redundant.
             
             paramStruct.bootstrapIterations = PANumericParam('default',100,'description','Bootstrap iterations');
             paramStruct.bootstrapSampleName = PAEnumParam('default','studyID','categories',{'studyID','days'},'description','Bootstrap sample name');
+            paramStruct.bootstrapSeed = PANumericParam('default',0,'min',0,'description','Bootstrap seed','help','Seeds the random stream of each bootstrap replicate when the bootstrapclusters mex file is used, so a run can be repeated or resumed.');
             paramStruct.exportPathname =      PAPathParam('default',getSavePath(),'Description','Export path');
             paramStruct.exportShowNonwear = PABoolParam('default',true,'description','Include nonwear with export');
             
@@ -85,7 +85,7 @@ classdef PAClassifyCounts < PAClassifyUsage
             shortRunningActivitySum = obj.movingSummer(countActivity,shortFilterLength);
 
             %            usageVec = zeros(size(datetimeNums));
-            usageVec = repmat(tagStruct.UNKNOWN,(size(datetimeNums)));
+            usageVec = repmat(tagStruct.UNKNOWN,(size(countActivity)));
 
             % This is good for determining where the study has ended... using a 15 minute duration minimum
             % (essentially 1 count allowed per minute or 15 counts per 900 samples )
@@ -147,7 +147,7 @@ classdef PAClassifyCounts < PAClassifyUsage
 
             % Akin to obj.getDurationSamples() or obj.durSamples -> see
             % PASensorData.m
-            numSamples = numel(datetimeNums);
+            numSamples = numel(countActivity);
              
             % Round the study over events to the end of the study if it is
             % within 4 hours of the end of the study.
@@ -172,7 +172,7 @@ classdef PAClassifyCounts < PAClassifyUsage
 
             nonwear_events = obj.thresholdcrossings(nonwearVec,0);
             if(~isempty(nonwear_events))
-                nonwearStartStopDateNums = [datetimeNums(nonwear_events(:,1)),datetimeNums(nonwear_events(:,2))];
+                nonwearStartStopDateNums = [obj.getSampleDatenums(datetimeNums,nonwear_events(:,1)),obj.getSampleDatenums(datetimeNums,nonwear_events(:,2))];
                 %durationOff = nonwear(:,2)-nonwear(:,1);
                 %durationOffInHours = (nonwear(:,2)-nonwear(:,1))/3600;
             else
@@ -188,7 +188,7 @@ classdef PAClassifyCounts < PAClassifyUsage
                 wearState = nonwearState;
                 startStopDateNums = nonwearStartStopDateNums;
             else
-                wearStartStopDateNums = [datetimeNums(wear(:,1)),datetimeNums(wear(:,2))];
+                wearStartStopDateNums = [obj.getSampleDatenums(datetimeNums,wear(:,1)),obj.getSampleDatenums(datetimeNums,wear(:,2))];
                 wearState = repmat(tagStruct.WEAR,size(wear,1),1);
 
                 wearState = [nonwearState;wearState];
@@ -62,7 +62,7 @@ classdef PAClassifyGravities < PAClassifyUsage
             longSum = obj.movingSummer(gravityVec,longFilterLength);
             shortSum = obj.movingSummer(gravityVec,shortFilterLength);
 
-            usageVec = repmat(tagStruct.UNKNOWN,(size(datetimeNums)));
+            usageVec = repmat(tagStruct.UNKNOWN,(size(gravityVec)));
             
             isStuck = diff(shortSum)==0 & shortSum(2:end)~=0;
             isStuckEvents = obj.thresholdcrossings(isStuck, 0);
@@ -105,7 +105,7 @@ classdef PAClassifyGravities < PAClassifyUsage
 
             % Akin to obj.getDurationSamples() or obj.durSamples -> see
             % PASensorData.m
-            numSamples = numel(datetimeNums);
+            numSamples = numel(gravityVec);
              
             % Round the study over events to the end of the study if it is
             % within 4 hours of the end of the study.
@@ -142,8 +142,8 @@ classdef PAClassifyGravities < PAClassifyUsage
             studyOverVec = obj.unrollEvents(studyover_events,numel(usageVec));
             studyNotStartedVec = obj.unrollEvents(study_not_started_events,numel(usageVec));
 
-            if ~isempty(isNotWorkingEvents) && ~isempty(datetimeNums)
-                nonwearStartStopDateNums = [datetimeNums(isNotWorkingEvents(:,1)),datetimeNums(isNotWorkingEvents(:,2))];
+            if ~isempty(isNotWorkingEvents) && obj.hasSampleTimes(datetimeNums)
+                nonwearStartStopDateNums = [obj.getSampleDatenums(datetimeNums,isNotWorkingEvents(:,1)),obj.getSampleDatenums(datetimeNums,isNotWorkingEvents(:,2))];
             else
                 nonwearStartStopDateNums = [];
             end
@@ -157,8 +157,8 @@ classdef PAClassifyGravities < PAClassifyUsage
                 wearState = nonwearState;
                 startStopDateNums = nonwearStartStopDateNums;
             else
-                if ~isempty(datetimeNums)
-                    wearStartStopDateNums = [datetimeNums(wear(:,1)),datetimeNums(wear(:,2))];
+                if obj.hasSampleTimes(datetimeNums)
+                    wearStartStopDateNums = [obj.getSampleDatenums(datetimeNums,wear(:,1)),obj.getSampleDatenums(datetimeNums,wear(:,2))];
                 else
                     wearStartStopDateNums = [];
                 end
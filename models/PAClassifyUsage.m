@@ -14,6 +14,12 @@ classdef PAClassifyUsage < PADataAnalysis
         
         % vector of datenum's which correspond to date and time of vector.
         datenumVec;
+
+        %> PATimeBase the sample times come from when datenumVec is empty,
+        %> so they are generated only for the events found.
+        timeBase;
+        %> Sample of timeBase the classified vector starts at.
+        firstSample = 1;
         
         %> @brief Mode of usage state vector (i.e. taken from getUsageActivity) for current frame rate.
         usageFrames;
@@ -45,6 +51,24 @@ classdef PAClassifyUsage < PADataAnalysis
 
         function setDatenumVec(obj, datenums)
             obj.datenumVec = datenums;
+            obj.timeBase = [];
+        end
+
+        % ======================================================================
+        %> @brief Takes sample times from a time base instead of a datenum
+        %> per sample.
+        %> @param obj Instance of PAClassifyUsage.
+        %> @param timeBase PATimeBase of the recording.
+        %> @param firstSample (optional) Sample of timeBase the vectors
+        %> classified start at.  Default is 1.
+        % ======================================================================
+        function setTimeBase(obj, timeBase, firstSample)
+            if(nargin<3)
+                firstSample = 1;
+            end
+            obj.timeBase = timeBase;
+            obj.firstSample = firstSample;
+            obj.datenumVec = [];
         end
         
         %> @brief Updates the usage state rules with an input struct.
@@ -91,6 +115,31 @@ classdef PAClassifyUsage < PADataAnalysis
         end
     end
 
+    methods(Access=protected)
+        % ======================================================================
+        %> @brief Datenums of the samples given, from datetimeNums when it
+        %> is not empty and from the time base otherwise.
+        %> @param obj Instance of PAClassifyUsage.
+        %> @param datetimeNums Datenum of each sample, or empty.
+        %> @param sampleIndices Column of sample indices (1-based).
+        %> @retval dateNums Column of datenums, or empty if no sample times
+        %> are available.
+        % ======================================================================
+        function dateNums = getSampleDatenums(obj, datetimeNums, sampleIndices)
+            if(~isempty(datetimeNums))
+                dateNums = datetimeNums(sampleIndices);
+            elseif(~isempty(obj.timeBase))
+                dateNums = obj.timeBase.sample2datenum(sampleIndices(:)+obj.firstSample-1);
+            else
+                dateNums = [];
+            end
+        end
+
+        function hasTimes = hasSampleTimes(obj, datetimeNums)
+            hasTimes = ~isempty(datetimeNums) || ~isempty(obj.timeBase);
+        end
+    end
+
     methods(Static)
         % ======================================================================
         %> @brief Returns a structure of PAClassifyUsage's default parameters as a struct.
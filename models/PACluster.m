@@ -158,6 +158,10 @@ classdef PACluster < PAData
         % Nx1 logical vector with 1 indicating loadshapes identified having
         % nonwear.
         nonwearRows;
+        
+        %> PAShapeProjection the load shapes were clustered in when the
+        %> reducedDimensions setting is used; empty otherwise.
+        shapeProjection;
     end
     
     properties
@@ -295,7 +299,76 @@ classdef PACluster < PAData
                 didSet = false;
             end
         end
-         
+
+        % ======================================================================
+        %> @brief Freezes the current clustering into a PAClusterModel,
+        %> which can be saved and used to assign new load shapes later.
+        %> @param this Instance of PACluster
+        %> @param settings (optional) Settings used to produce the load shapes.
+        %> @retval clusterModel Instance of PAClusterModel or empty when
+        %> there are no centroids yet.
+        % ======================================================================
+        function clusterModel = getClusterModel(this, settings)
+            clusterModel = [];
+            if(~isempty(this.centroidShapes))
+                if(nargin<2)
+                    settings = [];
+                end
+                clusterModel = PAClusterModel(this, settings);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Adds load shapes to the existing clusters without
+        %> reclustering.  Each new load shape joins its nearest centroid, and
+        %> the histograms, sort orders, covariates and exports
+        %> (getCovariateStruct, exportToDisk) reflect the new members.
+        %> @param this Instance of PACluster
+        %> @param newLoadShapes NxM load shapes, prepared as the existing ones were.
+        %> @param newLoadShapeIDs Nx1 parent identifiers of the new load shapes.
+        %> @param newLoadShapeDayOfWeek Nx1 day of week ([0,6]) of the new load shapes.
+        %> @param clusterModel (optional) PAClusterModel to assign with.
+        %> Default is getClusterModel(), which must match the centroids.
+        %> @param newNonwearRows (optional) Nx1 nonwear flags of the new
+        %> load shapes.  Default is false.
+        %> @retval idx Nx1 centroid index of each new load shape.  Shapes
+        %> without a nearest centroid (NaN, see PAClusterModel.assign) are
+        %> not added.
+        %> @retval drift Struct of drift statistics (see PAClusterModel.getDrift).
+        % ======================================================================
+        function [idx, drift] = assignLoadShapes(this, newLoadShapes, newLoadShapeIDs, newLoadShapeDayOfWeek, clusterModel, newNonwearRows)
+            if(nargin<5 || isempty(clusterModel))
+                clusterModel = this.getClusterModel();
+            end
+            if(isempty(clusterModel) || clusterModel.getNumClusters()~=this.getNumClusters())
+                throw(MException('PACluster:AssignLoadShapes','The cluster model does not match the current clusters.'));
+            end
+            numNew = size(newLoadShapes,1);
+            if(nargin<6 || isempty(newNonwearRows))
+                newNonwearRows = false(numNew,1);
+            end
+            [idx, distances] = clusterModel.assign(newLoadShapes);
+            drift = clusterModel.getDrift(idx, distances);
+
+            % Week long load shapes have a day of week per day.
+            newLoadShapeDayOfWeek = reshape(newLoadShapeDayOfWeek,numNew,[]);
+            isAssigned = ~isnan(idx);
+            this.loadShapes = [this.loadShapes; newLoadShapes(isAssigned,:)];
+            this.loadShapeIDs = [this.loadShapeIDs; reshape(newLoadShapeIDs(isAssigned),[],1)];
+            this.loadShapeDayOfWeek = [this.loadShapeDayOfWeek; newLoadShapeDayOfWeek(isAssigned,:)];
+            this.uniqueLoadShapeIDs = unique(this.loadShapeIDs);
+            this.loadshapeIndex2centroidIndexMap = [this.loadshapeIndex2centroidIndexMap(:); idx(isAssigned)];
+            if(~isempty(this.nonwearRows))
+                this.nonwearRows = [this.nonwearRows; reshape(newNonwearRows(isAssigned),[],1)];
+            end
+            this.updateMembership();
+            this.setCOISortOrder(1);
+
+            if(drift.needsRecluster)
+                this.logWarning('%0.1f%% of the new load shapes are outliers and cluster membership shifted by %0.2f; consider reclustering.',100*drift.outlierFraction,drift.membershipShift);
+            end
+        end
+
         % returns the popularity of each cluster, ordered by original
         % index.  Nx1 array with popularity(1) referring to the popularity
         % of cluster index 1.
@@ -359,82 +432,33 @@ classdef PACluster < PAData
                     msg = sprintf('Unable to create export path for current configuration.  Nothing done.\nExport path: %s',exportPath);
                 else
                     
-                    [covHeader, covDataStr] = this.exportFrequencyCovariates();
-                    [weekdayCovHeader, weekdayCovDataStr] = this.exportWeekDayCovariates(nonwearStruct);
-                    [clusterShapesHeaderStr, clusterShapesStr] = this.exportClusterShapes();
-                    [loadShapesHeaderStr, loadShapesStr] =       this.exportLoadShapes();
-                    
-                    [summaryHeaderStr, summaryStr] = this.exportClusterSummary();
-                    
-                    timeStamp = datestr(now,'DDmmmYYYY');
+                    exports = struct('name',{'Cluster frequency data','Cluster by weekday data','Cluster shapes','Load shapes','Cluster summary'},...
+                        'basename',{'cluster_frequency','cluster_by_weekday','cluster_shapes','load_shapes','cluster_summary'},...
+                        'header',[],'values',[],'columnNames',[]);
+                    [exports(1).header, exports(1).values, exports(1).columnNames] = this.exportFrequencyCovariates();
+                    [exports(2).header, exports(2).values, exports(2).columnNames] = this.exportWeekDayCovariates(nonwearStruct);
+                    [exports(3).header, exports(3).values, exports(3).columnNames] = this.exportClusterShapes();
+                    [exports(4).header, exports(4).values, exports(4).columnNames] = this.exportLoadShapes();
+                    [exports(5).header, exports(5).values, exports(5).columnNames] = this.exportClusterSummary();
                     
                     if(strcmpi(exportFmt,'xls'))
                         % default is to export as csv files (with a txt config file)
                     else
-                        % Timestamps
-                        cov2Filename = fullfile(exportPath,sprintf('cluster_by_weekday_%s.csv',timeStamp));
-                        covFilename = fullfile(exportPath,sprintf('cluster_frequency_%s.csv',timeStamp));
-                        clusterShapesFilename = fullfile(exportPath,sprintf('cluster_shapes_%s.csv',timeStamp));
-                        loadShapesFilename = fullfile(exportPath,sprintf('load_shapes_%s.csv',timeStamp));
-                        summaryFilename = fullfile(exportPath,sprintf('cluster_summary_%s.csv',timeStamp));
-                        settingsFilename = fullfile(exportPath,sprintf('padaco_config_%s.txt',timeStamp));
-                        
-                        % No timestamps
-                        cov2Filename = fullfile(exportPath,sprintf('cluster_by_weekday.csv'));
-                        covFilename = fullfile(exportPath,sprintf('cluster_frequency.csv'));
-                        clusterShapesFilename = fullfile(exportPath,sprintf('cluster_shapes.csv'));
-                        loadShapesFilename = fullfile(exportPath,sprintf('load_shapes.csv'));
-
-                        summaryFilename = fullfile(exportPath,sprintf('cluster_summary.csv'));
-                        settingsFilename = fullfile(exportPath,sprintf('padaco_config.txt'));
-                        
-                        covFid = fopen(covFilename,'w');
-                        
-                        if(covFid>1)
-                            fprintf(covFid,'%s\n',covHeader);
-                            fprintf(covFid,covDataStr);
-                            msg = sprintf('Cluster frequency data saved to:\n\t%s\n',covFilename);
-                            fclose(covFid);
-                        else
-                            msg = sprintf('Cluster frequency data NOT saved.  Could not open file (%s) for writing!\n ',covFilename);
-                        end
-                        
-                        cov2Fid = fopen(cov2Filename,'w');
-                        
-                        if(cov2Fid>1)
-                            fprintf(cov2Fid,'%s\n',weekdayCovHeader);
-                            fprintf(cov2Fid,weekdayCovDataStr);
-                            msg = sprintf('%sCluster by weekday data saved to:\n\t%s\n',msg,cov2Filename);
-                            fclose(cov2Fid);
-                        else
-                            msg = sprintf('%sCluster by weekday data NOT saved.  Could not open file (%s) for writing!\n ',msg,cov2Filename);
-                        end
-                        
-                        clusterShapesFid = fopen(clusterShapesFilename,'w');
-                        if(clusterShapesFid>1)
-                            fprintf(clusterShapesFid,'%s\n%s',clusterShapesHeaderStr,clusterShapesStr);
-                            msg = sprintf('%sCluster shapes saved to:\n\t%s\n',msg,clusterShapesFilename);
-                            fclose(clusterShapesFid);
+                        % Timestamps can be added with datestr(now,'DDmmmYYYY')
+                        if(strcmpi(exportFmt,'bin'))
+                            dataExt = 'pcol';  % columnar, see tools/r_scripts/read_padaco_columns.R
                         else
-                            msg = sprintf('%sCluster shapes NOT saved.  Could not open file (%s) for writing!\n ',msg,clusterShapesFilename);
+                            dataExt = 'csv';
                         end
-                        
-                        loadShapesFid = fopen(loadShapesFilename,'w');
-                        if(loadShapesFid>1)
-                            fprintf(loadShapesFid,'%s\n%s',loadShapesHeaderStr,loadShapesStr);
-                            msg = sprintf('%sLosf shapes saved to:\n\t%s\n',msg,loadShapesFilename);
-                            fclose(loadShapesFid);
-                        else
-                            msg = sprintf('%sLoad shapes NOT saved.  Could not open file (%s) for writing!\n ',msg,loadShapesFilename);
-                        end                       
-                        
-                        summaryFid = fopen(summaryFilename,'w');
-                        if(summaryFid>1)
-                            fprintf(summaryFid,'%s\n%s',summaryHeaderStr,summaryStr);
-                            msg = sprintf('%sCluster summary saved to:\n\t%s\n',msg,summaryFilename);
-                            fclose(summaryFid);
-                        else
-                            msg = sprintf('%sCluster summary NOT saved.  Could not open file (%s) for writing!\n ',msg,summaryFilename);
+                        settingsFilename = fullfile(exportPath,sprintf('padaco_config.txt'));
+                        msg = '';
+                        for e=1:numel(exports)
+                            exportFilename = fullfile(exportPath,sprintf('%s.%s',exports(e).basename,dataExt));
+                            if(PACluster.writeExportFile(exportFilename,exports(e).header,exports(e).values,exports(e).columnNames,dataExt))
+                                msg = sprintf('%s%s saved to:\n\t%s\n',msg,exports(e).name,exportFilename);
+                            else
+                                msg = sprintf('%s%s NOT saved.  Could not open file (%s) for writing!\n ',msg,exports(e).name,exportFilename);
+                            end
                         end
                         
                         settingsFid = fopen(settingsFilename,'w');
@@ -455,14 +479,14 @@ classdef PACluster < PAData
             resultMsg = msg;
         end
         
-        function [headerStr, dataStr] = exportWeekDayCovariates(this, nwStruct)
+        function [headerStr, csMat, columnNames] = exportWeekDayCovariates(this, nwStruct)
             csMat = this.getCovariateMat();
             headerStr = sprintf('# memberID, Day of week (Sun=0 to Sat=6), Cluster index, cluster popularity (1 is most and %d is least)',max(csMat(:,end)));
-            strFmt = ['%i',repmat(', %i',1,size(csMat,2)-1),'\n'];  % Make rows ('\n') of comma separated integers (', %i')
+            columnNames = {'memberID','dayOfWeek','clusterIndex','clusterPopularity'};
             
             if(nargin>1 && ~isempty(nwStruct) && isstruct(nwStruct) && ~isempty(nwStruct.rows))
                headerStr = sprintf('%s, Contains nonwear (%s)',headerStr,nwStruct.method); 
-               strFmt = [strFmt(1:end-2),',%d\n'];               
+               columnNames{end+1} = 'nonwear';
                if(isfield(nwStruct,'featureStruct') && ~isempty(nwStruct.featureStruct))
                    nwFeatureStruct = nwStruct.featureStruct;
                    missingValues = zeros(size(nwFeatureStruct.studyIDs,1),2);
@@ -477,10 +501,9 @@ classdef PACluster < PAData
                end
                csMat = [csMat, nonwearFlags];
             end
-            dataStr = sprintf(strFmt,csMat'); % Need to transpose here because arguments to sprintf are taken in column order, but I am output by row.
         end
         
-        function [headerStr, membersStr] = exportFrequencyCovariates(this,frequencyOf)
+        function [headerStr, allData, columnNames] = exportFrequencyCovariates(this,frequencyOf)
             cs = this.getCovariateStruct();
             if(nargin<2 || isempty(frequencyOf))
                 frequencyOf = 'id';
@@ -490,80 +513,74 @@ classdef PACluster < PAData
             else
                headerStr = sprintf('# Cluster frequency (by popularity) for members listed in first column.  ''Popularity #'' refers to the popularity of the centroid ID listed in the companion text file.  The values in these columns represent the number of times the subject ID was a member of the cluster with that popularity.\n');
             end
-            
-            for c=1:numel(cs.(frequencyOf).colnames)
-                colName = cs.(frequencyOf).colnames{c};
-                headerStr = sprintf('%s, %s', headerStr, colName);
-            end
+            headerStr = [headerStr, sprintf(', %s',cs.(frequencyOf).colnames{:})];
             
             %id (index) or popularity;
             allData = [cs.memberIDs,cs.(frequencyOf).values];
-            
-            strFmt = ['%i',repmat(', %i',1,size(allData,2)-1),'\n'];  % Make rows ('\n') of comma separated integers (', %i') 
-            membersStr = sprintf(strFmt,allData'); % Need to transpose here because arguments to sprintf are taken in column order, but I am output by row.
+            columnNames = [{'memberID'}, cs.(frequencyOf).varnames(:)'];
         end
         
-        %> @brief Returns centroid shape in comma separated value (csv) format.
+        %> @brief Returns centroid shapes for export in comma separated
+        %> value (csv) or columnar format (see writeExportFile).
         %> @param this Instance of PACluster
         %> @retval headerStr Header line; helpful to place at the top of a
         %> file.  Contains centroid index and popularity followed by
         %> time stamps corresponding to centroid shape values.
-        %> @retval centroidStr String containg N lines for N centroids.
-        %> The nth line describes the nth centroid
-        function [headerStr, shapeStr] = exportClusterShapes(this)
-            shapeStr = '';
-            
+        %> @retval shapes Matrix with N rows for N centroids.  The nth
+        %> row describes the nth most popular centroid.
+        %> @retval columnNames Names of the columns of shapes.
+        function [headerStr, shapes, columnNames] = exportClusterShapes(this)
+            shapes = [];
+            columnNames = {};
             if(this.getNumClusters<=0)
                 headerStr = '# No clusters found!';
             else
                 shapeTimesInCSV = cell2str(this.loadShapeTimes,',');
                 headerStr = sprintf('# Cluster index, Popularity (1 = highest), %s',shapeTimesInCSV);
+                columnNames = [{'clusterIndex','popularity'}, this.loadShapeTimes(:)'];
                 
+                shapes = zeros(this.getNumClusters(),2+size(this.loadShapes,2));
                 for sortOrder=1:this.getNumClusters()
                     coi = this.getClusterOfInterest(sortOrder);
-                    coiStr = sprintf('%i, %i',coi.index,coi.sortOrder);
-                    coiShapeStr = sprintf(', %f',coi.shape);
-                    shapeStr = sprintf('%s%s%s\n',shapeStr,coiStr,coiShapeStr);
+                    shapes(sortOrder,:) = [coi.index, coi.sortOrder, coi.shape(:)'];
                 end                
             end
         end
         
-        %> @brief Returns load shapes (features) in comma separated value (csv) format.
+        %> @brief Returns load shapes (features) for export in comma
+        %> separated value (csv) or columnar format (see writeExportFile).
         %> @param this Instance of PACluster
         %> @retval headerStr Header line; helpful to place at the top of a
-        %> file.  Contains centroid index and popularity followed by
-        %> time stamps corresponding to centroid shape values.
-        %> @retval shapesStr String containg N lines for N load shapes.
-        %> The nth line describes the nth centroid
-        function [headerStr, shapeStr] = exportLoadShapes(this)
-            shapeStr = '';
-            
+        %> file.  Contains study ID and day of week followed by
+        %> time stamps corresponding to load shape values.
+        %> @retval shapes Matrix with N rows for N load shapes.
+        %> @retval columnNames Names of the columns of shapes.
+        function [headerStr, shapes, columnNames] = exportLoadShapes(this)
+            shapes = [];
+            columnNames = {};
             if(this.getNumClusters<=0)
                 headerStr = '# No feature vectors found!';
             else                
                 shapeTimesInCSV = cell2str(this.loadShapeTimes,',');
                 headerStr = sprintf('# studyID, Day (0 = Sunday), %s',shapeTimesInCSV);
-                nRows = size(this.loadShapes,1);
-                for r=1:nRows
-                    curHeaderStr = sprintf('%i, %i', this.loadShapeIDs(r), this.loadShapeDayOfWeek(r));
-                    curShapeStr = sprintf(', %f',this.loadShapes(r,:));
-                    shapeStr = sprintf('%s%s%s\n',shapeStr,curHeaderStr,curShapeStr);
-                end                
+                columnNames = [{'studyID','dayOfWeek'}, this.loadShapeTimes(:)'];
+                shapes = [this.loadShapeIDs(:), this.loadShapeDayOfWeek(:), this.loadShapes];
             end
         end        
                 
         
-        %> @brief Returns text summarizing centroid membership distributions
-        %> in a comma separated value (csv) format.
+        %> @brief Returns a summary of centroid membership distributions
+        %> for export in comma separated value (csv) or columnar format.
         %> @param this Instance of PACluster
         %> @retval headerStr Header line; helpful to place at the top of a
         %> file.  
-        %> @retval summaryStr String containg N lines for N centroids.
-        %> The nth line describes the nth centroid according to the descriptions given
+        %> @retval summary Matrix with N rows for N centroids.
+        %> The nth row describes the nth centroid according to the descriptions given
         %> by the header string.
-        function [headerStr, summaryStr] = exportClusterSummary(this)            
-            summaryStr = '';
-            
+        %> @retval columnNames Names of the columns of summary.
+        function [headerStr, summary, columnNames] = exportClusterSummary(this)            
+            summary = [];
+            columnNames = {};
             if(this.getNumClusters<=0)
                 headerStr = '# No clusters found!';
             else
@@ -572,12 +589,12 @@ classdef PACluster < PAData
                 for d=1:numel(this.WEEKDAY_ORDER)
                     headerStr = sprintf('%s, %s (%d)',headerStr,this.WEEKDAY_LABELS{d},this.WEEKDAY_ORDER(d));
                 end
+                columnNames = [{'clusterIndex','popularity','loadShapes','uniqueParticipants','weekdayScore'}, this.WEEKDAY_LABELS];
 
+                summary = zeros(this.getNumClusters(),5+numel(this.WEEKDAY_ORDER));
                 for sortOrder=1:this.getNumClusters()
                     coi = this.getClusterOfInterest(sortOrder);
-                    coiStr = sprintf('%i, %i, %i, %i, %+0.3f',coi.index,coi.sortOrder,coi.numMembers,coi.numUniqueParticipants, coi.weekdayScore);
-                    dayStr = sprintf(', %i',coi.dayOfWeek.count);
-                    summaryStr = sprintf('%s%s%s\n',summaryStr,coiStr,dayStr);
+                    summary(sortOrder,:) = [coi.index,coi.sortOrder,coi.numMembers,coi.numUniqueParticipants, coi.weekdayScore, coi.dayOfWeek.count(:)'];
                 end
             end
         end
@@ -1203,6 +1220,21 @@ classdef PACluster < PAData
                 end
                 inputSettings = paparamsToValues(inputSettings);
                 
+                % Cluster in a reduced space when asked; centroids are
+                % mapped back to load shapes below.
+                this.shapeProjection = [];
+                clusterShapes = inputLoadShapes;
+                if(isfield(inputSettings,'reducedDimensions') && inputSettings.reducedDimensions>0 && inputSettings.reducedDimensions<size(inputLoadShapes,2))
+                    % Principal components preserve euclidean distances
+                    % only; other metrics would cluster different shapes.
+                    if(~strcmpi(inputSettings.distanceMetric,'sqeuclidean'))
+                        throw(MException('PACluster:CaculateClusters','Reduced dimensions can only be clustered with the squared euclidean (''sqeuclidean'') distance metric, not ''%s''.',inputSettings.distanceMetric));
+                    end
+                    this.shapeProjection = PAShapeProjection(inputLoadShapes,inputSettings.reducedDimensions);
+                    clusterShapes = this.shapeProjection.project(inputLoadShapes);
+                    fprintf(1,'Clustering in %u dimensions, which explain %0.1f%% of the load shape variance.\n',this.shapeProjection.getNumComponents(),100*sum(this.shapeProjection.explainedVariance));
+                end
+                
                 %             inputSettings.clusterMethod = 'kmedians';
                 % inputSettings.clusterMethod = 'kmedoids';
                 if(strcmpi(inputSettings.clusterMethod,'kmedians'))
@@ -1215,7 +1247,11 @@ classdef PACluster < PAData
                     if(ishandle(this.statusTextHandle))
                         set(this.statusTextHandle ,'string',{sprintf('Performing %s clustering of %u loadshapes with a threshold of %0.3f',inputSettings.clusterMethod,this.numLoadShapes(),this.getSetting('clusterThreshold'))});
                     end
-                    [this.loadshapeIndex2centroidIndexMap, this.centroidShapes, this.performanceMeasure, this.performanceProgression, this.sumD] = this.adaptiveKclusters(inputLoadShapes,inputSettings,this.performanceAxesHandle,this.statusTextHandle);
+                    [this.loadshapeIndex2centroidIndexMap, this.centroidShapes, this.performanceMeasure, this.performanceProgression, this.sumD] = this.adaptiveKclusters(clusterShapes,inputSettings,this.performanceAxesHandle,this.statusTextHandle);
+                end
+                clusterCentroids = this.centroidShapes;
+                if(~isempty(this.shapeProjection) && ~isempty(this.centroidShapes))
+                    this.centroidShapes = this.mapCentroidsToShapes(inputLoadShapes,clusterShapes,clusterCentroids,inputSettings.clusterMethod);
                 end
                 %             elseif(strcmpi(inputSettings.clusterMethod,'kmedoids'))
                 %                 if(ishandle(this.statusTextHandle))
@@ -1256,59 +1292,14 @@ classdef PACluster < PAData
                     % centroid shapes and load shape map vector.
                     if(numUnassigned>0 && min(unassignedIndices)>max(uniqueIndices))
                         this.centroidShapes(unassignedIndices,:)=[];
+                        clusterCentroids(unassignedIndices,:)=[];
                         msg = sprintf('Removing %d unassigned centroids.', numUnassigned);
                         if(ishandle(this.statusTextHandle))
                             set(this.statusTextHandle ,'string',{msg});
                         end
                         fprintf(1,'%s\n',msg);
                     end
-                    [this.histogram.loadshapes, this.centroidSortMap] = this.calculateAndSortDistribution(this.loadshapeIndex2centroidIndexMap);%  was -->       calculateAndSortDistribution(this.loadshapeIndex2centroidIndexMap);
-                    this.histogram.participants = zeros(size(this.histogram.loadshapes));
-                    this.histogram.nonwear = zeros(size(this.histogram.loadshapes));
-                                        
-                    this.coiSortOrder2Index = this.centroidSortMap;  % coiSortOrder2Index(c) contains the original centroid index that corresponds to the c_th most popular position
-                    [~,this.coiIndex2SortOrder] = sort(this.centroidSortMap,1,'ascend');
-                    
-                    K = this.getNumClusters();
-                    
-                    % May need to look into a sparse matrix at some point here ...
-                    this.clusterMemberIndices = false(K,this.getNumLoadShapes());
-                    
-                    this.histogram_ids.loadshapes = cell(K,1);
-                    this.histogram_ids.participants = cell(K,1);
-                    this.histogram_ids.nonwear = cell(K,1);
-                    
-                    this.weekdayScores = nan(K,1);
-                    for k = 1:K
-                        memberIndices = k==this.loadshapeIndex2centroidIndexMap;
-                        this.clusterMemberIndices(k,:) = memberIndices;
-                        startDay.value = this.loadShapeDayOfWeek(memberIndices,1);
-                        % startDay.value = this.loadShapeDayOfWeek(this.clusterMemberIndices(k,:),1);
-                        startDay.count = histc(startDay.value,this.WEEKDAY_ORDER);
-                        %                     this.weekdayScores(k) = this.WEEKDAY_WEIGHT*dayOfWeek.count(:)/sum(dayOfWeek.count);
-                        this.weekdayScores(k) = (this.WEEKDAY_SCORE.*this.WEEKDAY_WEIGHT*startDay.count(:))/(this.WEEKDAY_WEIGHT*startDay.count(:));
-                        
-                        startDay.memberIDs = this.loadShapeIDs(this.clusterMemberIndices(k,:));
-                        this.histogram_ids.loadshapes{this.coiIndex2SortOrder(k)} = startDay.memberIDs;
-                        
-                        % Keep it in the same order as histogram.loadshapes
-                        participant_ids = unique(startDay.memberIDs);
-                        this.histogram_ids.participants{this.coiIndex2SortOrder(k)} = participant_ids;
-                        this.histogram.participants(this.coiIndex2SortOrder(k)) = numel(participant_ids);
-                        
-                        if(~isempty(this.nonwearRows))
-                            % Keep it in the same order as histogram.loadshapes
-                            % nonwear_indices = this.nonwearRows(memberIndices);
-                            nonwear_ids = this.loadShapeIDs(this.nonwearRows & memberIndices);
-                            this.histogram.nonwear(this.coiIndex2SortOrder(k)) = numel(nonwear_ids);
-                            this.histogram_ids.nonwear{this.coiIndex2SortOrder(k)} = nonwear_ids;
-                        end
-
-                        dayOfWeek.values = this.loadShapeDayOfWeek(memberIndices,:);
-                        dayOfWeek.counts = histc(dayOfWeek.values(:),this.WEEKDAY_ORDER);
-                        this.weekdayScores(k) = (this.WEEKDAY_SCORE.*this.WEEKDAY_WEIGHT*dayOfWeek.counts(:))/(this.WEEKDAY_WEIGHT*dayOfWeek.counts(:));
-                        
-                    end
+                    this.updateMembership();
                     
                     %this.weekdayScores =
                     
@@ -1337,12 +1328,13 @@ classdef PACluster < PAData
                     
                     idx = this.loadshapeIndex2centroidIndexMap;
                     if(strcmpi(this.performanceCriterion,'silhouette'))
-                        this.calinskiIndex = this.getCalinskiHarabaszIndex(idx,this.centroidShapes,this.sumD);
+                        % sumD was measured in the space clustered
+                        this.calinskiIndex = this.getCalinskiHarabaszIndex(idx,clusterCentroids,this.sumD);
                         this.silhouetteIndex = this.performanceMeasure;
                         fprintf('Calinski Index = %0.2f\n',this.calinskiIndex);
                     else
                         this.calinskiIndex = this.performanceMeasure;
-                        this.silhouetteIndex = mean(silhouette(this.loadShapes,idx));
+                        this.silhouetteIndex = mean(silhouette(clusterShapes,idx));
                         fprintf('Silhouette Index = %0.4f\n',this.silhouetteIndex);
                     end
                 end
@@ -1356,6 +1348,96 @@ classdef PACluster < PAData
             end
         end
         
+        % ======================================================================
+        %> @brief Recomputes the cluster histograms, popularity sort maps,
+        %> member indices and weekday scores from the current load shape
+        %> to centroid map.  Called after clustering and after new load
+        %> shapes are assigned to the existing centroids.
+        %> @param this Instance of PACluster
+        % ======================================================================
+        function updateMembership(this)
+            [this.histogram.loadshapes, this.centroidSortMap] = this.calculateAndSortDistribution(this.loadshapeIndex2centroidIndexMap);%  was -->       calculateAndSortDistribution(this.loadshapeIndex2centroidIndexMap);
+            this.histogram.participants = zeros(size(this.histogram.loadshapes));
+            this.histogram.nonwear = zeros(size(this.histogram.loadshapes));
+                                
+            this.coiSortOrder2Index = this.centroidSortMap;  % coiSortOrder2Index(c) contains the original centroid index that corresponds to the c_th most popular position
+            [~,this.coiIndex2SortOrder] = sort(this.centroidSortMap,1,'ascend');
+            
+            K = this.getNumClusters();
+            
+            % May need to look into a sparse matrix at some point here ...
+            this.clusterMemberIndices = false(K,this.getNumLoadShapes());
+            
+            this.histogram_ids.loadshapes = cell(K,1);
+            this.histogram_ids.participants = cell(K,1);
+            this.histogram_ids.nonwear = cell(K,1);
+            
+            this.weekdayScores = nan(K,1);
+            for k = 1:K
+                memberIndices = k==this.loadshapeIndex2centroidIndexMap;
+                this.clusterMemberIndices(k,:) = memberIndices;
+                startDay.value = this.loadShapeDayOfWeek(memberIndices,1);
+                % startDay.value = this.loadShapeDayOfWeek(this.clusterMemberIndices(k,:),1);
+                startDay.count = histc(startDay.value,this.WEEKDAY_ORDER);
+                %                     this.weekdayScores(k) = this.WEEKDAY_WEIGHT*dayOfWeek.count(:)/sum(dayOfWeek.count);
+                this.weekdayScores(k) = (this.WEEKDAY_SCORE.*this.WEEKDAY_WEIGHT*startDay.count(:))/(this.WEEKDAY_WEIGHT*startDay.count(:));
+                
+                startDay.memberIDs = this.loadShapeIDs(this.clusterMemberIndices(k,:));
+                this.histogram_ids.loadshapes{this.coiIndex2SortOrder(k)} = startDay.memberIDs;
+                
+                % Keep it in the same order as histogram.loadshapes
+                participant_ids = unique(startDay.memberIDs);
+                this.histogram_ids.participants{this.coiIndex2SortOrder(k)} = participant_ids;
+                this.histogram.participants(this.coiIndex2SortOrder(k)) = numel(participant_ids);
+                
+                if(~isempty(this.nonwearRows))
+                    % Keep it in the same order as histogram.loadshapes
+                    % nonwear_indices = this.nonwearRows(memberIndices);
+                    nonwear_ids = this.loadShapeIDs(this.nonwearRows & memberIndices);
+                    this.histogram.nonwear(this.coiIndex2SortOrder(k)) = numel(nonwear_ids);
+                    this.histogram_ids.nonwear{this.coiIndex2SortOrder(k)} = nonwear_ids;
+                end
+
+                dayOfWeek.values = this.loadShapeDayOfWeek(memberIndices,:);
+                dayOfWeek.counts = histc(dayOfWeek.values(:),this.WEEKDAY_ORDER);
+                this.weekdayScores(k) = (this.WEEKDAY_SCORE.*this.WEEKDAY_WEIGHT*dayOfWeek.counts(:))/(this.WEEKDAY_WEIGHT*dayOfWeek.counts(:));
+                
+            end
+        end
+        
+        % ======================================================================
+        %> @brief Maps centroids found in the reduced space back to load
+        %> shapes.  k-means centroids become the mean of their members'
+        %> load shapes, which is what clustering the load shapes directly
+        %> produces; k-medoids centroids become their medoid's load shape.
+        %> @param this Instance of PACluster
+        %> @param loadShapes NxM load shapes that were clustered.
+        %> @param clusterShapes NxK scores of the load shapes.
+        %> @param clusterCentroids CxK centroids found.
+        %> @param clusterMethod 'kmeans' or 'kmedoids'
+        %> @retval centroidShapes CxM
+        % ======================================================================
+        function centroidShapes = mapCentroidsToShapes(this, loadShapes, clusterShapes, clusterCentroids, clusterMethod)
+            idx = this.loadshapeIndex2centroidIndexMap;
+            numCentroids = size(clusterCentroids,1);
+            centroidShapes = this.shapeProjection.reconstruct(clusterCentroids);
+            if(strcmpi(clusterMethod,'kmedoids'))
+                for k=1:numCentroids
+                    members = find(idx==k);
+                    if(~isempty(members))
+                        [~, nearest] = min(sum((clusterShapes(members,:)-clusterCentroids(k,:)).^2,2));
+                        centroidShapes(k,:) = loadShapes(members(nearest),:);
+                    end
+                end
+            else
+                membership = sparse(idx(:),(1:numel(idx))',1,numCentroids,numel(idx));
+                memberCounts = full(sum(membership,2));
+                hasMembers = memberCounts>0;
+                memberSums = membership*double(loadShapes);
+                centroidShapes(hasMembers,:) = memberSums(hasMembers,:)./memberCounts(hasMembers);
+            end
+        end
+        
         % Returns the distributions of the clusters (participant,
         % loadshape, and nonwear counts)
         function [histograms, member_ids] = getDistributions(this)
@@ -1405,6 +1487,10 @@ classdef PACluster < PAData
         %> @param Instance of PACluster.
         %> @param Optional coi sort order index - index or indices to retrieve
         %> covariate structures of.
+        %> @param centroidIDCount Optional NxK number of load shapes of each
+        %> unique load shape ID in each centroid, e.g. from the indexed
+        %> person-day rows of a PAStudyStore.  Counted from the load shapes
+        %> when not given.
         %> @retval Struct with fields defining dependent variables to use in the
         %> model.  Fields include:
         %> - @c values NxM array of counts for M centroids (the covariate index) for N subject
@@ -1412,39 +1498,26 @@ classdef PACluster < PAData
         %> order).  Thus the first centroid is the most popular.
         %> - @c memberIDs Nx1 array of unique keys corresponding to each row.
         %> - @c colnames 1xM cell string of names describing the covariate columns.
-        function covariateStruct = getCovariateStruct(this,optionalCOISortOder)
+        function covariateStruct = getCovariateStruct(this,optionalCOISortOder,centroidIDCount)
             subjectIDs = this.getUniqueLoadShapeIDs(); %    unique(this.loadShapeIDs);
             numSubjects = numel(subjectIDs);
             
-            centroidPopularityCount = zeros(numSubjects,this.numClusters);
-            centroidIDCount = centroidPopularityCount;
-            
-            for row=1:numSubjects
-                try
-                    curSubject = subjectIDs(row);
-                    try
-                        centroidIDForSubject = this.loadshapeIndex2centroidIndexMap(this.loadShapeIDs==curSubject);
-                        centroidSortOrderForSubject = this.coiIndex2SortOrder(centroidIDForSubject);
-                        %centroidSortOrderForSubject = this.coiIndex2SortOrder(this.loadshapeIndex2centroidIndexMap(this.loadShapeIDs==curSubject));
-                    catch me
-                        showME(me);
-                    end
-                    for c=1:numel(centroidSortOrderForSubject)
-                        coiSO = centroidSortOrderForSubject(c);
-                        coiID = centroidIDForSubject(c);
-                        centroidPopularityCount(row,coiSO) = centroidPopularityCount(row,coiSO)+1;
-                        centroidIDCount(row, coiID) = centroidIDCount(row,coiID)+1;
-                    end
-                catch me
-                    showME(me);
-                    rethrow(me);
-                end
+            if(nargin<3 || isempty(centroidIDCount))
+                % Group load shapes by subject through an index of their
+                % position in subjectIDs instead of scanning all load shapes
+                % once per subject.
+                [~, subjectRows] = ismember(this.loadShapeIDs, subjectIDs);
+                centroidIDs = this.loadshapeIndex2centroidIndexMap(:);
+                isMember = subjectRows(:)>0;
+                centroidIDCount = accumarray([subjectRows(isMember),centroidIDs(isMember)],1,[numSubjects,this.numClusters]);
             end
+            centroidPopularityCount = zeros(numSubjects,this.numClusters);
+            centroidPopularityCount(:,this.coiIndex2SortOrder(1:this.numClusters)) = centroidIDCount;
             
             % This *used* to state that the columns should be in sorted order with #1
             % first (on the left) and #K on the end (far right).  This *was*
             % okay because we have converted centroid indices to centroid
-            % sort order indices in the above for loop.
+            % sort order indices above.
             
             idOrder = 1:this.numClusters;
             sortOrder = this.coiIndex2SortOrder(idOrder);
@@ -1872,6 +1945,52 @@ classdef PACluster < PAData
     
     methods(Static)
         
+        % ======================================================================
+        %> @brief Writes an export table with the exportmatrix mex file when
+        %> it is compiled (round trip numbers, formatted across
+        %> cores), or with fprintf otherwise.
+        %> @param filename Full filename to write to.
+        %> @param headerStr Text written ahead of the rows (csv), or kept
+        %> as the header attribute (pcol).
+        %> @param values NxM numeric matrix.
+        %> @param columnNames 1xM cell of column names (may be empty).
+        %> @param dataFmt 'csv' (default) or 'pcol' for the binary columnar
+        %> format read by tools/r_scripts/read_padaco_columns.R.
+        %> @retval didWrite True on success.
+        % ======================================================================
+        function didWrite = writeExportFile(filename, headerStr, values, columnNames, dataFmt)
+            if(nargin<5 || ~strcmpi(dataFmt,'pcol'))
+                dataFmt = 'csv';
+            else
+                dataFmt = 'bin';
+            end
+            if(isempty(columnNames) || numel(columnNames)~=size(values,2))
+                columnNames = {};
+            end
+            didWrite = false;
+            try
+                if(exist('exportmatrix','file')==3)
+                    exportmatrix(filename,double(values),headerStr,columnNames,{},dataFmt);
+                    didWrite = true;
+                elseif(strcmp(dataFmt,'csv'))
+                    fid = fopen(filename,'w');
+                    if(fid>1)
+                        fprintf(fid,'%s\n',headerStr);
+                        if(~isempty(values))
+                            strFmt = ['%.15g',repmat(', %.15g',1,size(values,2)-1),'\n'];
+                            fprintf(fid,strFmt,values');  % arguments are taken in column order
+                        end
+                        fclose(fid);
+                        didWrite = true;
+                    end
+                else
+                    fprintf(1,'The exportmatrix mex file is needed to export the columnar format (%s).\n',filename);
+                end
+            catch me
+                showME(me);
+            end
+        end
+        
         %> @brief Retrieve a struct of default settings for the PACluster
         %> class.
         %> @retval Struct with field value pairs as follows:
@@ -1880,6 +1999,7 @@ classdef PACluster < PAData
         %> - @c clusterMethod = 'kmeans'   {'kmeans','kmedoids'}
         %> - @c useDefaultRandomizer = false;
         %> - @c initClusterWithPermutation = false;            
+        %> - @c reducedDimensions = 0;  (0 clusters the load shapes directly)
         %> @note Higher thresholds result in fewer clusters (and vice versa).
         function settings = getDefaults()
             settings = PAData.getDefaults();
@@ -1894,6 +2014,8 @@ classdef PACluster < PAData
             settings.distanceMetric = PAEnumParam('default','sqeuclidean','categories', PACluster.getDistanceMetrics(),'description','Clustering distance metric','help', 'Distance metric used with clustering.  Default is squared euclidean (''sqeuclidean'')');
             settings.useDefaultRandomizer = PABoolParam('default',false,'description','Use default randomizer');
             settings.initClusterWithPermutation = PABoolParam('default',false,'description','Initialize clusters with permutation');            
+            settings.reducedDimensions = PAIndexParam('default',0,'min',0,'description','Reduced dimensions',...
+                'help','Number of principal components (randomized PCA) to cluster load shapes in, with the squared euclidean distance metric only.  Enter 0 to cluster the load shapes directly.');
         end
         
         function methods = getClusterMethods()
@@ -0,0 +1,232 @@
+% ======================================================================
+%> @file PAClusterModel.m
+%> @brief Frozen cluster model for assigning new load shapes without
+%> reclustering.
+% ======================================================================
+%> @brief PAClusterModel keeps what is needed to place new load shapes
+%> among the clusters of an existing PACluster: the centroids (and the
+%> reduced space projection, if the clusters were found in one), the
+%> distance metric, and a summary of how far the training load shapes sat
+%> from their centroids.  New shapes are scored against the frozen
+%> centroids with the assigncentroids mex file when it is compiled (or
+%> pdist2 otherwise), and getDrift compares them to the training summary
+%> to flag when a full recluster is warranted.
+%>
+%> Models are saved as a plain struct named clusterModel in a .mat file
+%> (see saveToFile and loadFromFile).
+% ======================================================================
+classdef PAClusterModel
+
+    properties(Constant)
+        FORMAT_VERSION = 1;
+        %> Training shapes farther than this percentile of their
+        %> cluster's distances count as outliers.
+        OUTLIER_PERCENTILE = 95;
+        %> Drift limits beyond which reclustering is recommended: outlier
+        %> fraction (0.05 is expected) and total variation distance
+        %> between new and training cluster proportions.
+        OUTLIER_FRACTION_LIMIT = 0.15;
+        MEMBERSHIP_SHIFT_LIMIT = 0.25;
+    end
+
+    properties(SetAccess=protected)
+        formatVersion = PAClusterModel.FORMAT_VERSION;
+        %> CxM centroid load shapes.
+        centroidShapes = [];
+        %> CxK centroids in the space the shapes were clustered in (equal
+        %> to centroidShapes without a projection).
+        clusterCentroids = [];
+        %> Struct of a PAShapeProjection (see toStruct) or empty.
+        projection = [];
+        distanceMetric = 'sqeuclidean';
+        clusterMethod = 'kmeans';
+        %> 1xM cell of 'HH:MM' start times of the load shape dimensions.
+        loadShapeTimes = {};
+        %> Cx1 number of training load shapes per centroid.
+        trainingCounts = [];
+        %> Cx1 OUTLIER_PERCENTILE of each centroid's training distances.
+        distanceLimits = [];
+        %> Median training distance to the assigned centroid.
+        medianDistance = NaN;
+        %> Settings the load shapes were prepared and clustered with.
+        settings = struct();
+        created = '';
+    end
+
+    methods
+        % ======================================================================
+        %> @brief Constructor
+        %> @param clusterObj (optional) Converged instance of PACluster.
+        %> @param settings (optional) Struct of the settings used to produce
+        %> the load shapes (e.g. PAStatTool's cluster settings).
+        %> @retval this Instance of PAClusterModel
+        % ======================================================================
+        function this = PAClusterModel(clusterObj, settings)
+            if(nargin==0 || isempty(clusterObj))
+                return;
+            end
+            if(nargin>1 && ~isempty(settings))
+                this.settings = paparamsToValues(settings);
+            end
+            this.centroidShapes = clusterObj.centroidShapes;
+            this.clusterCentroids = this.centroidShapes;
+            if(~isempty(clusterObj.shapeProjection))
+                this.projection = clusterObj.shapeProjection.toStruct();
+                % kmeans centroids are member means and medoids are members,
+                % so projecting them gives the centroids that were found.
+                this.clusterCentroids = clusterObj.shapeProjection.project(this.centroidShapes);
+            end
+            this.distanceMetric = clusterObj.getSetting('distanceMetric');
+            this.clusterMethod = clusterObj.getSetting('clusterMethod');
+            this.loadShapeTimes = clusterObj.loadShapeTimes;
+            this.created = datestr(now);
+
+            [idx, distances] = this.assign(clusterObj.loadShapes);
+            isAssigned = ~isnan(idx);
+            idx = idx(isAssigned);
+            distances = distances(isAssigned);
+            numCentroids = size(this.centroidShapes,1);
+            this.trainingCounts = accumarray(idx(:),1,[numCentroids,1]);
+            this.distanceLimits = inf(numCentroids,1);
+            for k=1:numCentroids
+                if(any(idx==k))
+                    this.distanceLimits(k) = prctile(distances(idx==k),this.OUTLIER_PERCENTILE);
+                end
+            end
+            this.medianDistance = median(distances);
+        end
+
+        function numClusters = getNumClusters(this)
+            numClusters = size(this.centroidShapes,1);
+        end
+
+        % ======================================================================
+        %> @brief Assigns load shapes to their nearest centroid.
+        %> @param this Instance of PAClusterModel
+        %> @param loadShapes NxM load shapes, prepared as the training shapes were.
+        %> @retval idx Nx1 centroid index (rows of centroidShapes).  NaN
+        %> for shapes of zero length under the cosine or correlation
+        %> metrics, which have no nearest centroid.
+        %> @retval distances Nx1 distance to the assigned centroid, in
+        %> the space the shapes were clustered in (NaN if unassigned).
+        % ======================================================================
+        function [idx, distances] = assign(this, loadShapes)
+            if(size(loadShapes,2)~=size(this.centroidShapes,2))
+                error('PadacoToolbox:PAClusterModel:dimension','Load shapes have %d dimensions, but the cluster model has %d.',size(loadShapes,2),size(this.centroidShapes,2));
+            end
+            clusterShapes = double(loadShapes);
+            if(~isempty(this.projection))
+                clusterShapes = PAShapeProjection.fromStruct(this.projection).project(clusterShapes);
+            end
+            if(exist('assigncentroids','file')==3)
+                [idx, distances] = assigncentroids(clusterShapes, this.clusterCentroids, this.distanceMetric);
+            else
+                [distances, idx] = pdist2(this.clusterCentroids, clusterShapes, this.getPdistMetric(), 'smallest', 1);
+                idx = idx(:);
+                distances = distances(:);
+                if(strcmpi(this.distanceMetric,'sqeuclidean'))
+                    distances = distances.^2;
+                end
+                idx(isnan(distances)) = NaN;
+                numUnassigned = sum(isnan(idx));
+                if(numUnassigned>0)
+                    warning('PadacoToolbox:PAClusterModel:zeroLength','%u load shapes have zero length under the %s metric and were not assigned.',numUnassigned,this.distanceMetric);
+                end
+            end
+        end
+
+        % ======================================================================
+        %> @brief Compares newly assigned load shapes to the training shapes.
+        %> @param this Instance of PAClusterModel
+        %> @param idx Nx1 centroid indices from assign().  Unassigned
+        %> (NaN) shapes are left out.
+        %> @param distances Nx1 distances from assign().
+        %> @retval drift Struct with fields
+        %> - @c distanceRatio Median new distance over the median training distance.
+        %> - @c outlierFraction Fraction of new shapes beyond their
+        %> centroid's training distance limit (about 0.05 without drift).
+        %> - @c membershipShift Total variation distance between the new
+        %> and training cluster proportions (0 to 1).
+        %> - @c needsRecluster True when either limit is exceeded.
+        % ======================================================================
+        function drift = getDrift(this, idx, distances)
+            isAssigned = ~isnan(idx(:));
+            idx = idx(isAssigned);
+            distances = distances(isAssigned);
+            numCentroids = this.getNumClusters();
+            newCounts = accumarray(idx(:),1,[numCentroids,1]);
+            drift.distanceRatio = median(distances)/this.medianDistance;
+            drift.outlierFraction = mean(distances(:)>this.distanceLimits(idx(:)));
+            drift.membershipShift = 0.5*sum(abs(newCounts/max(1,sum(newCounts))-this.trainingCounts/max(1,sum(this.trainingCounts))));
+            drift.needsRecluster = drift.outlierFraction>this.OUTLIER_FRACTION_LIMIT || drift.membershipShift>this.MEMBERSHIP_SHIFT_LIMIT;
+        end
+
+        % ======================================================================
+        %> @brief Saves the model as a struct named clusterModel.
+        %> @param this Instance of PAClusterModel
+        %> @param filename Full filename of the .mat file.
+        %> @retval didSave True on success.
+        % ======================================================================
+        function didSave = saveToFile(this, filename)
+            didSave = false;
+            try
+                clusterModel = this.toStruct(); %#ok<NASGU>
+                save(filename,'clusterModel');
+                didSave = true;
+            catch me
+                showME(me);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Plain struct of the model.
+        % ======================================================================
+        function modelStruct = toStruct(this)
+            fields = {'formatVersion','centroidShapes','clusterCentroids','projection','distanceMetric','clusterMethod',...
+                'loadShapeTimes','trainingCounts','distanceLimits','medianDistance','settings','created'};
+            modelStruct = struct();
+            for f=1:numel(fields)
+                modelStruct.(fields{f}) = this.(fields{f});
+            end
+        end
+    end
+
+    methods(Access=protected)
+        % pdist2 names the square root of sqeuclidean 'euclidean'.
+        function metric = getPdistMetric(this)
+            metric = this.distanceMetric;
+            if(strcmpi(metric,'sqeuclidean'))
+                metric = 'euclidean';
+            end
+        end
+    end
+
+    methods(Static)
+        % ======================================================================
+        %> @brief Restores a model saved with saveToFile or toStruct.
+        %> @param filenameOrStruct .mat filename or model struct.
+        %> @retval this Instance of PAClusterModel, or empty on failure.
+        % ======================================================================
+        function this = loadFromFile(filenameOrStruct)
+            this = [];
+            modelStruct = filenameOrStruct;
+            if(ischar(filenameOrStruct))
+                tmp = load(filenameOrStruct,'clusterModel');
+                if(~isfield(tmp,'clusterModel'))
+                    fprintf(1,'%s does not contain a cluster model.\n',filenameOrStruct);
+                    return;
+                end
+                modelStruct = tmp.clusterModel;
+            end
+            if(modelStruct.formatVersion>PAClusterModel.FORMAT_VERSION)
+                fprintf(1,'Cluster model format %d is newer than this version of Padaco supports (%d).\n',modelStruct.formatVersion,PAClusterModel.FORMAT_VERSION);
+                return;
+            end
+            this = PAClusterModel();
+            fields = fieldnames(modelStruct);
+            for f=1:numel(fields)
+                this.(fields{f}) = modelStruct.(fields{f});
+            end
+        end
+    end
+end
@@ -0,0 +1,336 @@
+% ======================================================================
+%> @file PAExclusionIndex.m
+%> @brief Packed bitmap index of nonwear and malfunction epochs per person-day.
+% ======================================================================
+%> @brief PAExclusionIndex keeps, for each state tag (e.g. Padaco nonwear,
+%> Padaco malfunction, Choi nonwear, an imported exclusion file), one bit per
+%> time of day column of each person-day row, packed 64 columns to a
+%> uint64 word.  Each row also keeps a block word whose bits are the OR of
+%> its words, so asking which rows have a tagged epoch within a time
+%> window touches at most three words per row regardless of the window
+%> length.  Windows that wrap past midnight (e.g. 22:00 to 04:00) are
+%> supported.
+%>
+%> The exclusionindex mex file is used for packing and queries when it is
+%> compiled; otherwise equivalent MATLAB code is used.
+% ======================================================================
+classdef PAExclusionIndex
+
+    properties(Constant)
+        BITS_PER_WORD = 64;
+    end
+
+    properties(SetAccess=protected)
+        %> Cell of tag names, one per page of words.
+        tags = {};
+        %> numRows x numWords x numTags uint64 packed bits.
+        words = uint64([]);
+        %> numRows x numTags uint64; bit w-1 is set when words(row,w,tag) is non-zero.
+        blocks = uint64([]);
+        %> Row keys, as found in the feature structs of PAStatTool.
+        studyIDs = [];
+        startDatenums = [];
+        startDaysOfWeek = [];
+        %> Cell of 'HH:MM' start times of the time of day columns.
+        startTimes = {};
+        srcDataType = '';
+    end
+
+    properties(SetAccess=protected, Transient)
+        columnMinutes = [];
+        hasMex = false;
+    end
+
+    methods
+        % ======================================================================
+        %> @brief Constructor
+        %> @param featureStruct Struct with fields studyIDs, startDatenums,
+        %> startDaysOfWeek and startTimes (e.g. PAStatTool's originalFeatureStruct).
+        %> @retval this Instance of PAExclusionIndex
+        % ======================================================================
+        function this = PAExclusionIndex(featureStruct)
+            if(nargin==0)
+                return;
+            end
+            this.studyIDs = featureStruct.studyIDs(:);
+            this.startDatenums = featureStruct.startDatenums(:);
+            this.startDaysOfWeek = featureStruct.startDaysOfWeek(:);
+            this.startTimes = featureStruct.startTimes;
+            if(isfield(featureStruct,'srcDataType'))
+                this.srcDataType = featureStruct.srcDataType;
+            end
+            numWords = ceil(numel(this.startTimes)/this.BITS_PER_WORD);
+            this.words = zeros(numel(this.studyIDs),numWords,0,'uint64');
+            this.blocks = zeros(numel(this.studyIDs),0,'uint64');
+            this = this.initTransients();
+        end
+
+        function numRows = getRowCount(this)
+            numRows = numel(this.studyIDs);
+        end
+
+        function numColumns = getColumnCount(this)
+            numColumns = numel(this.startTimes);
+        end
+
+        function hasIt = hasTag(this, tagName)
+            hasIt = any(strcmpi(this.tags, tagName));
+        end
+
+        % ======================================================================
+        %> @brief Adds (or replaces) a tag.
+        %> @param this Instance of PAExclusionIndex
+        %> @param tagName Name of the tag.
+        %> @param bits numRows x numColumns logical matrix.
+        %> @retval this Instance of PAExclusionIndex
+        % ======================================================================
+        function this = addTag(this, tagName, bits)
+            if(~isequal(size(bits),[this.getRowCount(), this.getColumnCount()]))
+                error('PadacoToolbox:PAExclusionIndex:size','Bits for %s must be %d x %d.',tagName,this.getRowCount(),this.getColumnCount());
+            end
+            bits = logical(bits);
+            if(this.hasMex)
+                [tagWords, tagBlocks] = exclusionindex('pack', bits);
+            else
+                [tagWords, tagBlocks] = PAExclusionIndex.packBits(bits);
+            end
+            this = this.setTagWords(tagName, tagWords, tagBlocks);
+        end
+
+        % ======================================================================
+        %> @brief Adds (or replaces) a tag holding the OR of other tags.
+        %> @param this Instance of PAExclusionIndex
+        %> @param tagName Name of the tag.
+        %> @param sourceTags Cell of tag names to combine.  Missing tags are ignored.
+        %> @retval this Instance of PAExclusionIndex
+        % ======================================================================
+        function this = addUnionTag(this, tagName, sourceTags)
+            tagWords = zeros(size(this.words,1),size(this.words,2),'uint64');
+            tagBlocks = zeros(size(this.blocks,1),1,'uint64');
+            for t=find(ismember(lower(this.tags),lower(sourceTags)))
+                tagWords = bitor(tagWords,this.words(:,:,t));
+                tagBlocks = bitor(tagBlocks,this.blocks(:,t));
+            end
+            this = this.setTagWords(tagName, tagWords, tagBlocks);
+        end
+
+        % ======================================================================
+        %> @brief Returns the rows with any of the given tags set in a time window.
+        %> @param this Instance of PAExclusionIndex
+        %> @param tagNames String or cell of tag names.  Unknown tags are ignored.
+        %> @param startColumn (optional) First column of the window (1-based).  Default is 1.
+        %> @param stopColumn (optional) Last column of the window.  Default
+        %> is the last column.  startColumn > stopColumn wraps past midnight.
+        %> @param weekdays (optional) Days of the week (0 for Sunday, as in
+        %> startDaysOfWeek) to keep; rows on other days are false.
+        %> @retval rows numRows x 1 logical vector.
+        % ======================================================================
+        function rows = getRows(this, tagNames, startColumn, stopColumn, weekdays)
+            if(nargin<3 || isempty(startColumn))
+                startColumn = 1;
+            end
+            if(nargin<4 || isempty(stopColumn))
+                stopColumn = this.getColumnCount();
+            end
+            tagIndices = find(ismember(lower(this.tags),lower(cellstr(tagNames))));
+            if(isempty(tagIndices) || this.getColumnCount()==0)
+                rows = false(this.getRowCount(),1);
+            elseif(this.hasMex)
+                rows = exclusionindex('query', this.words, this.blocks, this.getColumnCount(), startColumn, stopColumn, tagIndices);
+            else
+                rows = this.queryBits(tagIndices, startColumn, stopColumn);
+            end
+            if(nargin>4 && ~isempty(weekdays))
+                rows = rows & ismember(this.startDaysOfWeek, weekdays);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Nonwear and malfunction rows for PAStatTool's nonwear methods.
+        %> @param this Instance of PAExclusionIndex
+        %> @param nonwearMethods String or cell of methods ('padaco', 'choi',
+        %> 'imported_file').  A method's malfunction epochs are indexed
+        %> under '<method>_malfunction' and also count as nonwear.
+        %> @param startEndTimes (optional) 'HH:MM' start and end time (cell) or
+        %> start and stop column indices of the window.
+        %> @retval nonwearRows numRows x 1 logical vector
+        %> @retval malfunctionRows numRows x 1 logical vector
+        % ======================================================================
+        function [nonwearRows, malfunctionRows] = getNonwearRows(this, nonwearMethods, startEndTimes)
+            nonwearMethods = lower(cellstr(nonwearMethods));
+            nonwearMethods(strcmp(nonwearMethods,'import')) = {'imported_file'};
+            startColumn = 1;
+            stopColumn = this.getColumnCount();
+            if(nargin>2 && ~isempty(startEndTimes))
+                [startColumn, stopColumn] = this.getWindowColumns(startEndTimes);
+            end
+            if(isempty(startColumn))
+                nonwearRows = false(this.getRowCount(),1);
+                malfunctionRows = nonwearRows;
+                return;
+            end
+            malfunctionRows = this.getRows(strcat(nonwearMethods,'_malfunction'), startColumn, stopColumn);
+            nonwearRows = this.getRows(nonwearMethods, startColumn, stopColumn) | malfunctionRows;
+        end
+
+        % ======================================================================
+        %> @brief Columns of a time window given as 'HH:MM' strings or columns.
+        %> Both are empty when no column falls within the window.
+        % ======================================================================
+        function [startColumn, stopColumn] = getWindowColumns(this, startEndTimes)
+            if(isnumeric(startEndTimes))
+                startColumn = startEndTimes(1);
+                stopColumn = startEndTimes(2);
+            else
+                if(isa(startEndTimes,'duration'))
+                    windowMinutes = minutes(startEndTimes);
+                else
+                    windowMinutes = PAExclusionIndex.time2minutes(startEndTimes);
+                end
+                startColumn = find(this.columnMinutes>=windowMinutes(1),1,'first');
+                stopColumn = find(this.columnMinutes<=windowMinutes(2),1,'last');
+                if(isempty(startColumn) || isempty(stopColumn))
+                    startColumn = [];  % no columns within the window
+                    stopColumn = [];
+                end
+            end
+        end
+
+        % ======================================================================
+        %> @brief Realigns the index to another set of rows, matched on study
+        %> ID and start datenum.  Rows that are not found have no bits set.
+        %> @param this Instance of PAExclusionIndex
+        %> @param featureStruct Struct with the row keys to align to (see constructor).
+        %> @retval alignedIndex Instance of PAExclusionIndex
+        %> @retval numMatched Number of rows of featureStruct that were found.
+        % ======================================================================
+        function [alignedIndex, numMatched] = alignTo(this, featureStruct)
+            alignedIndex = PAExclusionIndex(featureStruct);
+            if(~isequal(alignedIndex.startTimes,this.startTimes))
+                error('PadacoToolbox:PAExclusionIndex:startTimes','The start times of the exclusions do not match the features.');
+            end
+            [found, loc] = ismember([alignedIndex.studyIDs, alignedIndex.startDatenums], [this.studyIDs, this.startDatenums], 'rows');
+            numMatched = sum(found);
+            alignedIndex.tags = this.tags;
+            alignedIndex.words = zeros(alignedIndex.getRowCount(),size(this.words,2),numel(this.tags),'uint64');
+            alignedIndex.blocks = zeros(alignedIndex.getRowCount(),numel(this.tags),'uint64');
+            alignedIndex.words(found,:,:) = this.words(loc(found),:,:);
+            alignedIndex.blocks(found,:) = this.blocks(loc(found),:);
+        end
+
+        % ======================================================================
+        %> @brief Keeps only the tags given (e.g. the methods being exported).
+        % ======================================================================
+        function this = selectTags(this, tagNames)
+            keep = ismember(lower(this.tags),lower(cellstr(tagNames)));
+            this.tags = this.tags(keep);
+            this.words = this.words(:,:,keep);
+            this.blocks = this.blocks(:,keep);
+        end
+
+        % ======================================================================
+        %> @brief Plain struct of the index, for saving to .mat files.
+        % ======================================================================
+        function indexStruct = toStruct(this)
+            fields = {'tags','words','blocks','studyIDs','startDatenums','startDaysOfWeek','startTimes','srcDataType'};
+            indexStruct = struct();
+            for f=1:numel(fields)
+                indexStruct.(fields{f}) = this.(fields{f});
+            end
+        end
+    end
+
+    methods(Access=protected)
+        function this = initTransients(this)
+            this.columnMinutes = PAExclusionIndex.time2minutes(this.startTimes);
+            this.hasMex = exist('exclusionindex','file')==3;
+        end
+
+        function this = setTagWords(this, tagName, tagWords, tagBlocks)
+            t = find(strcmpi(this.tags, tagName),1);
+            if(isempty(t))
+                t = numel(this.tags)+1;
+                this.tags{t} = tagName;
+            end
+            this.words(:,:,t) = tagWords;
+            this.blocks(:,t) = tagBlocks;
+        end
+
+        % MATLAB equivalent of exclusionindex('query',...): a column mask per word.
+        function rows = queryBits(this, tagIndices, startColumn, stopColumn)
+            numColumns = this.getColumnCount();
+            if(startColumn<=stopColumn)
+                inWindow = (1:numColumns)>=startColumn & (1:numColumns)<=stopColumn;
+            else
+                inWindow = (1:numColumns)>=startColumn | (1:numColumns)<=stopColumn;
+            end
+            maskWords = PAExclusionIndex.packBits(inWindow);
+            rows = false(this.getRowCount(),1);
+            for t=tagIndices(:)'
+                rows = rows | any(bitand(this.words(:,:,t),repmat(maskWords,this.getRowCount(),1))~=0,2);
+            end
+        end
+    end
+
+    methods(Static)
+        % ======================================================================
+        %> @brief Builds the index of PAStatTool's nonwear struct.
+        %> @param nonwearStruct Struct with fields padaco (usage states) and
+        %> choi, each with shapes aligned to featureStruct.
+        %> @param featureStruct Features the nonwear rows belong to.
+        %> @retval this Instance of PAExclusionIndex with tags 'padaco',
+        %> 'padaco_malfunction' and 'choi' as available.
+        % ======================================================================
+        function this = fromNonwearStruct(nonwearStruct, featureStruct)
+            this = PAExclusionIndex(featureStruct);
+            if(isfield(nonwearStruct,'padaco') && isstruct(nonwearStruct.padaco) && isfield(nonwearStruct.padaco,'shapes'))
+                tagStruct = PASensorData.getActivityTags();
+                usageStates = nonwearStruct.padaco.shapes;
+                if(strcmpi(nonwearStruct.padaco.srcDataType,'count'))
+                    this = this.addTag('padaco', usageStates<=tagStruct.NONWEAR);
+                elseif(strcmpi(nonwearStruct.padaco.srcDataType,'raw'))
+                    this = this.addTag('padaco', usageStates==tagStruct.NOT_WORKING | usageStates==tagStruct.STUDY_NOT_STARTED | usageStates==tagStruct.STUDYOVER);
+                    this = this.addTag('padaco_malfunction', usageStates==tagStruct.SENSOR_STUCK | usageStates==tagStruct.SENSOR_BURST);
+                end
+            end
+            if(isfield(nonwearStruct,'choi') && isstruct(nonwearStruct.choi) && isfield(nonwearStruct.choi,'shapes') && strcmpi(nonwearStruct.choi.srcDataType,'count'))
+                this = this.addTag('choi', nonwearStruct.choi.shapes~=0);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Restores an index saved with toStruct().
+        % ======================================================================
+        function this = fromStruct(indexStruct)
+            this = PAExclusionIndex();
+            fields = fieldnames(indexStruct);
+            for f=1:numel(fields)
+                this.(fields{f}) = indexStruct.(fields{f});
+            end
+            this = this.initTransients();
+        end
+
+        % ======================================================================
+        %> @brief MATLAB equivalent of exclusionindex('pack',bits).
+        % ======================================================================
+        function [packedWords, packedBlocks] = packBits(bits)
+            [numRows, numColumns] = size(bits);
+            numWords = ceil(numColumns/PAExclusionIndex.BITS_PER_WORD);
+            packedWords = zeros(numRows,numWords,'uint64');
+            for w=1:numWords
+                columns = (w-1)*PAExclusionIndex.BITS_PER_WORD+1:min(w*PAExclusionIndex.BITS_PER_WORD,numColumns);
+                % distinct bits, so the sum is exact
+                packedWords(:,w) = sum(uint64(bits(:,columns)).*bitshift(uint64(1),0:numel(columns)-1),2,'native');
+            end
+            packedBlocks = sum(uint64(packedWords~=0).*bitshift(uint64(1),0:numWords-1),2,'native');
+        end
+
+        function minutesOfDay = time2minutes(timeStrings)
+            minutesOfDay = zeros(1,numel(timeStrings));
+            for t=1:numel(timeStrings)
+                hourMinute = sscanf(timeStrings{t},'%d:%d');
+                minutesOfDay(t) = hourMinute(1)*60+hourMinute(2);
+            end
+        end
+    end
+end
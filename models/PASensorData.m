@@ -82,9 +82,14 @@ classdef PASensorData < PAData
         %> Durtion of the sampled data in seconds.
         durationSec;
         %> @brief The numeric value for each date time sample provided by
-        %> the file name.
+        %> the file name.  Generated on request from timeBase when the
+        %> samples are regularly spaced (see getDatenum()).
         dateTimeNum;
 
+        %> @brief PATimeBase instance describing the sample times of
+        %> regularly sampled data, or empty when dateTimeNum holds them.
+        timeBase;
+
         %> @brief Numeric values for date time sample for the start of
         %> extracted features.
         startDatenums;
@@ -178,6 +183,62 @@ classdef PASensorData < PAData
         
         nonwearAlgorithm;
         
+        %> @brief Struct describing the growing file being followed (see
+        %> followFile) with fields sourceFilename, binFilename and
+        %> byteOffset (next unread byte of a followed .mims file).
+        followState;
+
+        %> @brief When true, raw accelerations are corrected against
+        %> gravity after they are loaded (see calibrateRaw).
+        autoCalibrate;
+
+        %> @brief Struct describing the auto-calibration of the raw
+        %> accelerations (see calibrateRaw) or empty when none was tried.
+        calibration;
+
+        %> @brief When true, raw files are loaded through a running padacod
+        %> study server (see loadSharedStudy) so sessions share one decoded copy.
+        useStudyServer;
+
+        %> @brief Info struct returned by sharedstudy('open',...) for the
+        %> study loaded through the study server, or empty.  Cleared when
+        %> the raw data no longer matches the server's copy.
+        sharedStudy;
+
+        %> @brief When true, raw .bin files are loaded through the
+        %> background loader (see loadBackgroundStudy and PAStudyLoader)
+        %> when the asyncload mex file is compiled.
+        loadInBackground;
+
+        %> @brief Number of studies following an opened one in its folder
+        %> to load in the background ahead of time.
+        prefetchCount;
+
+        %> @brief Nx4 int8 usage states (x, y, z and vecMag) classified by
+        %> the study server or background loader as they decoded the raw
+        %> data (see applyLoadedStudy), or empty.  Cleared when the raw data
+        %> changes.
+        loadedUsage;
+
+        %> @brief Per second summary of the raw accelerations, read from
+        %> the sidecar rawcsv2rawbin -e writes next to a .bin file (see
+        %> loadEpochSummary), or empty.  Cleared when the raw data changes.
+        epochSummary;
+
+        %> @brief When true, the frame features that merge exactly (see
+        %> getMergedFrameFeatures) come from per minute summaries of the
+        %> signal when the framesummary mex file is compiled.
+        useFrameSummary;
+
+        %> @brief Per minute summary (see framesummary.c) of the signal
+        %> last framed, with its signalTagLine and signalVersion, or empty.
+        %> Lets frame duration changes skip a pass over the samples.
+        frameSummary;
+
+        %> @brief Incremented whenever accel changes, so summaries of a
+        %> signal can tell they are stale without reading it.
+        signalVersion = 0;
+
         % Flags for determining if counts and or raw data is loaded.
         hasCounts
         hasRaw;        
@@ -342,7 +403,14 @@ classdef PASensorData < PAData
                         
                         fprintf(fid,'#-------------------\n');                        
                         fprintf(fid,'# time stamp, x, y, z, vecMag\n');
-                        fprintf(fid,'%f, %2d, %2d, %2d, %2d\n',[obj.dateTimeNum,obj.usage.x,obj.usage.y,obj.usage.z,obj.usage.vecMag]');
+                        % Written a block at a time so the datenum of every
+                        % sample is not generated at once.
+                        numSamples = numel(obj.usage.x);
+                        samplesPerBlock = 1e6;
+                        for blockStart=1:samplesPerBlock:numSamples
+                            indices = (blockStart:min(numSamples,blockStart+samplesPerBlock-1))';
+                            fprintf(fid,'%f, %2d, %2d, %2d, %2d\n',[obj.getDatenum(indices),obj.usage.x(indices),obj.usage.y(indices),obj.usage.z(indices),obj.usage.vecMag(indices)]');
+                        end
                         fclose(fid);
                         msg = sprintf('Export saved to %s.',exportFilename);
                         
@@ -1095,7 +1163,77 @@ classdef PASensorData < PAData
         %> - startstopnum(2) The datenum of the study's end.
         % --------------------------------------------------------------------
         function startstopnum =  getStartStopDatenum(obj)
-            startstopnum = [obj.dateTimeNum(1), obj.dateTimeNum(end)];
+            if(~isempty(obj.timeBase))
+                startstopnum = obj.timeBase.getStartStopDatenum();
+            else
+                startstopnum = [obj.dateTimeNum(1), obj.dateTimeNum(end)];
+            end
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief Returns the datenums of the samples given without
+        %> generating the datenum of every sample when a time base is
+        %> available.
+        %> @param obj Instance of PASensorData
+        %> @param sampleIndices Sample indices (1-based)
+        %> @retval dateNum Datenums of sampleIndices.
+        % --------------------------------------------------------------------
+        function dateNum = getDatenum(obj, sampleIndices)
+            if(~isempty(obj.timeBase))
+                dateNum = obj.timeBase.sample2datenum(sampleIndices);
+                if(isvector(dateNum))
+                    dateNum = dateNum(:);  % column, as indexing dateTimeNum returns
+                end
+            else
+                dateNum = obj.dateTimeNum(sampleIndices);
+            end
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief Returns the index of the sample recorded at the datenum given.
+        %> @param obj Instance of PASensorData
+        %> @param dateNum Scalar datenum
+        %> @retval sampleIndex Index of the sample, or empty if no sample
+        %> was recorded at dateNum.
+        % --------------------------------------------------------------------
+        function sampleIndex = datenum2sample(obj, dateNum)
+            if(~isempty(obj.timeBase))
+                [sampleIndex, isSample] = obj.timeBase.datenum2sample(dateNum);
+                if(~isSample)
+                    sampleIndex = [];
+                end
+            else
+                sampleIndex = find(obj.dateTimeNum==dateNum, 1);
+            end
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief dateTimeNum is generated from the time base when it was
+        %> not loaded explicitly.
+        % --------------------------------------------------------------------
+        function dateTimeNum = get.dateTimeNum(obj)
+            dateTimeNum = obj.dateTimeNum;
+            if(isempty(dateTimeNum) && ~isempty(obj.timeBase))
+                dateTimeNum = obj.timeBase.sample2datenum();
+            end
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief Any change to the accelerations is a new signal version.
+        % --------------------------------------------------------------------
+        function set.accel(obj, accel)
+            obj.accel = accel;
+            obj.signalVersion = obj.signalVersion+1; %#ok<MCSUP>
+        end
+
+        % --------------------------------------------------------------------
+        %> @brief Explicit sample times replace the time base.
+        % --------------------------------------------------------------------
+        function set.dateTimeNum(obj, dateTimeNum)
+            obj.dateTimeNum = dateTimeNum;
+            if(~isempty(dateTimeNum))
+                obj.timeBase = []; %#ok<MCSUP>
+            end
         end
 
         % ======================================================================
@@ -1301,6 +1439,61 @@ classdef PASensorData < PAData
 
         end
 
+        % ======================================================================
+        %> @brief Picks up the samples appended to a raw .csv or .mims file
+        %> that is still being recorded, without rereading what was already
+        %> loaded.  Raw .csv files are converted by the followraw mex file,
+        %> which parses only the rows written since its last call and
+        %> appends them to a Padaco .bin file; the new records are then read
+        %> from the end of the .bin file.  Usage states and frame features
+        %> are updated only for the samples affected by the new data.
+        %> @param obj Instance of PASensorData.
+        %> @param sourceFilename Full filename of the growing .csv or .mims file.
+        %> @param binFilename (Optional, .csv only) Full filename of the .bin
+        %> file to append to.  Default is sourceFilename with a .bin extension.
+        %> @retval numNewSamples Number of samples added.
+        % ======================================================================
+        function numNewSamples = followFile(obj, sourceFilename, binFilename)
+            numNewSamples = 0;
+            firstNewSample = 1;
+            [pathName, baseName, ext] = fileparts(sourceFilename);
+            try
+                if(strcmpi(ext,'.mims'))
+                    [numNewSamples, firstNewSample] = obj.followMimsFile(sourceFilename);
+                else
+                    if(exist('followraw','file')~=3)
+                        obj.logWarning('Following raw .csv files requires the followraw mex file (see src/followraw.c).');
+                        return;
+                    end
+                    if(nargin<3 || isempty(binFilename))
+                        binFilename = fullfile(pathName,[baseName,'.bin']);
+                    end
+                    [firstRecord, numRecords, restarted] = followraw(sourceFilename, binFilename);
+                    isFollowing = isstruct(obj.followState) && strcmp(obj.followState.binFilename,binFilename) && obj.hasRaw;
+                    if(restarted || ~isFollowing || firstRecord~=obj.getDurationSamples()+1)
+                        obj.followState = struct('sourceFilename',sourceFilename,'binFilename',binFilename,'byteOffset',0);
+                        obj.studyID = obj.getStudyIDFromBasename(baseName);
+                        [obj.hasRaw, numNewSamples] = obj.loadPadacoRawBinFile(binFilename);
+                        if(~obj.hasRaw)
+                            numNewSamples = 0;
+                            return;
+                        end
+                        obj.accelType = 'raw';
+                    elseif(numRecords>=firstRecord)
+                        firstNewSample = firstRecord;
+                        numNewSamples = numRecords-firstRecord+1;
+                        obj.appendRawXYZ(obj.loadPadacoRawBinRecords(binFilename, firstRecord, numNewSamples));
+                    end
+                end
+                if(numNewSamples>0)
+                    [~, firstChangedSample] = obj.classifyUsageForAllAxes(firstNewSample);
+                    obj.updateFeatures(firstChangedSample);
+                end
+            catch me
+                showME(me);
+            end
+        end
+
         % Format String
         % %e - elapsed seconds
         % %x - x-axis
@@ -1312,6 +1505,16 @@ classdef PASensorData < PAData
                     fmtStruct = obj.getDefaultCustomFmtStruct();
                 end
 
+                if(exist('loadcustomraw','file')==3) % If the mex file exists and is compiled
+                    try
+                        [micros, xyz] = loadcustomraw(fullfilename, fmtStruct);
+                        didLoad = obj.setCustomRawSamples(micros, xyz, fullfilename);
+                        return;
+                    catch me
+                        obj.logWarning('Could not parse %s natively (%s).  Trying textscan instead.', fullfilename, me.message);
+                    end
+                end
+
                 fid = fopen(fullfilename);
                 if(fid>1)
                     fmtStr = '';
@@ -1375,6 +1578,59 @@ classdef PASensorData < PAData
             end
         end
 
+        % ======================================================================
+        %> @brief Places samples parsed by loadcustomraw on an evenly spaced
+        %> time axis, filling samples without a timestamp with the missing
+        %> value setting, as mergedCell does for textscan's output.
+        %> @param obj Instance of PASensorData.
+        %> @param micros Nx1 int64 wall clock microseconds of each sample.
+        %> @param xyz Nx3 single x, y and z accelerations.
+        %> @param fullfilename File the samples were parsed from.
+        %> @retval didLoad True if at least two samples were parsed.
+        % ======================================================================
+        function didLoad = setCustomRawSamples(obj, micros, xyz, fullfilename)
+            didLoad = false;
+            if(numel(micros)<2)
+                obj.logWarning('Fewer than two samples could be parsed from %s', fullfilename);
+                return;
+            end
+
+            % Integer offsets keep the sample period exact at any recording length.
+            elapsedMicros = double(micros-micros(1));
+            periodMicros = round(median(diff(elapsedMicros)));
+            if(periodMicros<=0)
+                obj.logWarning('Timestamps in %s do not increase', fullfilename);
+                return;
+            end
+            obj.sampleRate = 1e6/periodMicros;
+            sampleIndices = round(elapsedMicros/periodMicros)+1;
+            isOnAxis = sampleIndices>=1;
+            sampleIndices = sampleIndices(isOnAxis);
+            numSamples = max(sampleIndices);
+
+            startDatenum = datenum(1970,1,1)+double(micros(1))/(24*3600*1e6);
+            stopDatenum = startDatenum+(numSamples-1)*periodMicros/(24*3600*1e6);
+            obj.startDate = datestr(startDatenum,'mm/dd/yyyy');
+            obj.startTime = datestr(startDatenum,'HH:MM:SS.FFF');
+            obj.stopDate = datestr(stopDatenum,'mm/dd/yyyy');
+            obj.stopTime = datestr(stopDatenum,'HH:MM:SS.FFF');
+
+            % Sample times are implied by the start and the sample period.
+            periodGCD = gcd(periodMicros,1e6);
+            obj.dateTimeNum = [];
+            obj.timeBase = PATimeBase(startDatenum,[periodMicros,1e6]/periodGCD,numSamples);
+
+            axesCell = repmat({repmat(obj.getSetting('missingValue'),numSamples,1)},1,3);
+            for c=1:3
+                axesCell{c}(sampleIndices) = double(xyz(isOnAxis,c));
+            end
+            obj.durSamples = numSamples;
+            obj.durationSec = floor(obj.getDurationSamples()/obj.sampleRate);
+            obj.setRawXYZ(axesCell{1},axesCell{2},axesCell{3});
+            obj.printLoadStatusMsg(numel(sampleIndices), fullfilename);
+            didLoad = true;
+        end
+
         function printLoadStatusMsg(obj, samplesFound, fullFilename)
             if(obj.getDurationSamples()==samplesFound)
                 fprintf('%d rows loaded from %s\n',samplesFound,fullFilename);
@@ -1395,10 +1651,12 @@ classdef PASensorData < PAData
             didLoad = obj.loadCustomRawFile(fullfilename, fmtStruct);
         end
         
-        % writes an actigraph .csv file with raw acceleration values
+        % writes an actigraph .csv file with raw acceleration values (natively
+        % when the writerawcsv mex file is available; see src/rawcsvwriter.h)
         function didWrite = writeActigraphRawCSV(obj, outputFilename, varargin)
-            defaults.start_datenum = obj.dateTimeNum(1);
-            defaults.stop_datenum = obj.dateTimeNum(end);            
+            startStopDatenum = obj.getStartStopDatenum();
+            defaults.start_datenum = startStopDatenum(1);
+            defaults.stop_datenum = startStopDatenum(2);            
             defaults.include_header = true;
             defaults.dry_run = false;
             defaults.actilife_version = '';
@@ -1406,11 +1664,11 @@ classdef PASensorData < PAData
             params = parse_pv_pairs(defaults, varargin);
             
             if isempty(params.start_datenum)
-                params.start_datenum = obj.dateTimeNum(1);
+                params.start_datenum = startStopDatenum(1);
             end
             
             if isempty(params.stop_datenum)
-                params.stop_datenum = obj.dateTimeNum(end);
+                params.stop_datenum = startStopDatenum(2);
             end
             
             didWrite = false;
@@ -1425,6 +1683,19 @@ classdef PASensorData < PAData
                 params.export_timestamp = isVerLessThan(params.actilife_version, 'v6.12.0');
             end
             
+            % The writerawcsv mex file formats rows natively, without a
+            % datestr per sample; it needs samples on a regular grid.
+            if exist('writerawcsv','file')==3 && (isempty(obj.timeBase) || isempty(obj.timeBase.gaps))
+                try
+                    numRows = writerawcsv(outputFilename, obj.accel.raw.x, obj.accel.raw.y, obj.accel.raw.z, obj.sampleRate, startStopDatenum(1), params);
+                    fprintf(1,'%u rows written to %s\n', numRows, outputFilename);
+                    didWrite = true;
+                    return;
+                catch me
+                    obj.logWarning('Could not write %s with writerawcsv (%s).  Writing it with fprintf instead.', outputFilename, me.message);
+                end
+            end
+            
             if params.dry_run
                 fid = 1;
             elseif params.include_header
@@ -1447,9 +1718,9 @@ classdef PASensorData < PAData
                     % ZERO FILL
                     % This could fill your hard drive :(
                     datenum_delta = datenum(0, 0, 0, 0, 0, 1/obj.sampleRate);
-                    if params.start_datenum < obj.dateTimeNum(1)
+                    if params.start_datenum < startStopDatenum(1)
                         % zero pad the file until you are ready
-                        time_stamps = params.start_datenum:datenum_delta:obj.dateTimeNum(1)-datenum_delta;
+                        time_stamps = params.start_datenum:datenum_delta:startStopDatenum(1)-datenum_delta;
                         
                         if params.export_timestamp
                             fprintf(1,'Creating timestamps for %0.2f days\n', numel(time_stamps)/obj.sampleRate/3600/24);                        
@@ -1485,17 +1756,17 @@ classdef PASensorData < PAData
                             end
                             fprintf(1,'\n');                            
                         end
-                        cur_timestamp = obj.dateTimeNum(1);
+                        cur_timestamp = startStopDatenum(1);
                     else
                         cur_timestamp = params.start_datenum;
                     end
                     
                     % TRANSFER
-                    start_index = find(obj.dateTimeNum==cur_timestamp, 1);
-                    if params.stop_datenum > obj.dateTimeNum(end)
-                        stop_index = numel(obj.dateTimeNum);
+                    start_index = obj.datenum2sample(cur_timestamp);
+                    if params.stop_datenum > startStopDatenum(2)
+                        stop_index = obj.getDurationSamples();
                     elseif params.stop_datenum > params.start_datenum
-                        stop_index = find(obj.dateTimeNum==params.stop_datenum, 1);
+                        stop_index = obj.datenum2sample(params.stop_datenum);
                     else
                         stop_index = [];
                     end
@@ -1504,7 +1775,7 @@ classdef PASensorData < PAData
                     if params.export_timestamp
                         fprintf(1,'Creating timestamps for %0.2f days\n', numel(indices)/obj.sampleRate/3600/24);
                         tic
-                        time_stamps_str = datestr(obj.dateTimeNum(indices), 'mm/dd/YYYY HH:MM:SS.FFF');
+                        time_stamps_str = datestr(obj.getDatenum(indices), 'mm/dd/YYYY HH:MM:SS.FFF');
                         toc
                     end
                     
@@ -1534,7 +1805,7 @@ classdef PASensorData < PAData
                         end
                         fprintf(1,'\n');
                     end
-                    cur_timestamp = obj.dateTimeNum(stop_index)+datenum_delta;                    
+                    cur_timestamp = obj.getDatenum(stop_index)+datenum_delta;                    
                         
                     if params.stop_datenum > cur_timestamp
                         % zero pad the until you reach the end
@@ -1683,6 +1954,11 @@ classdef PASensorData < PAData
 
         function didLoad = loadActigraphFile(obj, fullfilename)
             didLoad = false;
+            obj.calibration = [];
+            obj.sharedStudy = [];
+            obj.loadedUsage = [];
+            obj.epochSummary = [];
+            obj.frameSummary = [];
 
             % Have one file version for counts...
             if(exist(fullfilename,'file'))
@@ -1845,6 +2121,9 @@ classdef PASensorData < PAData
                     obj.accelType = [];
                 end
 
+                if(obj.hasRaw && obj.autoCalibrate)
+                    obj.calibrateRaw();
+                end
                 if(obj.hasCounts || obj.hasRaw)
                     obj.classifyUsageForAllAxes();
                 end
@@ -2058,8 +2337,8 @@ classdef PASensorData < PAData
 
                     if(loadFastOption)
                         %stopDateNum = datenum(strcat(obj.stopDate,{' '},obj.stopTime),'mm/dd/yyyy HH:MM:SS');
-                        stopDateNum = startDateNum + (samplesFound-1)/obj.sampleRate/24/3600; % or startDateNum+windowDateNumDelta*samplesFound
-                        obj.dateTimeNum = datespace(startDateNum,stopDateNum,windowDateNumDelta);                        
+                        obj.dateTimeNum = [];
+                        obj.timeBase = PATimeBase(startDateNum,obj.sampleRate,samplesFound);
                     else
                         zeroTimes = sum(dateVecFound,2)==0;
                         numZero = sum(zeroTimes);
@@ -2084,7 +2363,11 @@ classdef PASensorData < PAData
                         
                     end
 
-                    obj.durSamples = numel(obj.dateTimeNum);
+                    if(isempty(obj.timeBase))
+                        obj.durSamples = numel(obj.dateTimeNum);
+                    else
+                        obj.durSamples = obj.timeBase.numSamples;
+                    end
                     obj.durationSec = floor(obj.durSamples/obj.sampleRate);                    
 
                     obj.setRawXYZ(tmpDataCell{1},tmpDataCell{2},tmpDataCell{3});
@@ -2271,10 +2554,15 @@ classdef PASensorData < PAData
                 structType = 'timeSeries';
             end
 
-            startstopDatenum = obj.getStartStopDatenum();
-            elapsed_time = datenumSample - startstopDatenum(1);
-            [y,m,d,h,mi,s] = datevec(elapsed_time);
-            elapsedSec = [d, h, mi, s] * [24*60; 60; 1;1/60]*60;
+            if(~isempty(obj.timeBase))
+                % whole sample periods, so no datevec round off
+                elapsedSec = obj.timeBase.datenum2elapsedSec(datenumSample);
+            else
+                startstopDatenum = obj.getStartStopDatenum();
+                elapsed_time = datenumSample - startstopDatenum(1);
+                [y,m,d,h,mi,s] = datevec(elapsed_time);
+                elapsedSec = [d, h, mi, s] * [24*60; 60; 1;1/60]*60;
+            end
             %            windowSamplerate = obj.getWindowSamplerate(structType);
             window = ceil(elapsedSec/obj.getSetting('windowDurSec'));
         end
@@ -2297,27 +2585,127 @@ classdef PASensorData < PAData
 
 
         % ======================================================================
-        %> @brief Prefilters accelerometer data.
-        %> @note Not currently implemented.
+        %> @brief Per second summary of the raw accelerations (see
+        %> loadEpochSummary), for classifiers and cohort summaries that work
+        %> in one second blocks.
+        %> @param obj Instance of PASensorData.
+        %> @retval epochSummary Struct or empty when no sidecar matches the
+        %> raw data loaded.
+        % ======================================================================
+        function epochSummary = getEpochSummary(obj)
+            if(obj.hasEpochSummary())
+                epochSummary = obj.epochSummary;
+            else
+                epochSummary = [];
+            end
+        end
+
+        %> @brief True when the epoch summary covers each whole second of
+        %> the raw data loaded, from its first sample on.
+        function hasIt = hasEpochSummary(obj)
+            hasIt = isstruct(obj.epochSummary) && obj.hasRaw && obj.epochSummary.samplerate==obj.sampleRate && ...
+                size(obj.epochSummary.std,1)==floor(numel(obj.accel.raw.x)/obj.sampleRate) && ...
+                abs(obj.epochSummary.startDatenum-obj.getDatenum(1))*24*60*60<1;
+        end
+
+        % ======================================================================
+        %> @brief Auto-calibrates the raw accelerations against gravity.
+        %> Still 10 second windows (standard deviation below 13 mg on each
+        %> axis) should measure 1 g, so each axis' offset and scale are fit
+        %> to bring their means onto the unit sphere.  The correction is only
+        %> applied when the still windows cover the sphere and the fit
+        %> leaves less than 10 mg of error.  The calibrateraw mex file is
+        %> used when it is compiled and available.  Nothing is done when
+        %> the loaded .bin file was already calibrated by rawcsv2rawbin -k.
+        %> @param obj Instance of PASensorData.
+        %> @retval didCalibrate True if the raw accelerations were corrected.
+        % ======================================================================
+        function didCalibrate = calibrateRaw(obj)
+            didCalibrate = false;
+            if(~obj.hasRaw || ~isempty(obj.calibration))
+                return;
+            end
+            xyz = [obj.accel.raw.x(:), obj.accel.raw.y(:), obj.accel.raw.z(:)];
+            try
+                if(exist('calibrateraw','file')==3)
+                    [xyz, obj.calibration] = calibrateraw(single(xyz), obj.getSampleRate());
+                else
+                    [xyz, obj.calibration] = PASensorData.fitCalibration(xyz, obj.getSampleRate());
+                end
+                didCalibrate = obj.calibration.didCalibrate;
+                if(didCalibrate)
+                    obj.setRawXYZ(xyz);
+                    obj.sharedStudy = [];
+                    obj.loadedUsage = [];
+                    obj.epochSummary = [];
+                    obj.frameSummary = [];
+                    obj.logStatus('Raw accelerations calibrated using %d still windows (error %0.4f g -> %0.4f g)',...
+                        obj.calibration.numWindows, obj.calibration.errorBefore, obj.calibration.errorAfter);
+                else
+                    obj.logWarning('Raw accelerations were not calibrated (%d still windows, error %0.4f g)',...
+                        obj.calibration.numWindows, obj.calibration.errorBefore);
+                end
+            catch me
+                showME(me);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Prefilters accelerometer data by aggregating the vector
+        %> magnitude into numBins consecutive bins of aggregateDurMin
+        %> minutes each.  The prefiltersignal mex file is used when it is
+        %> compiled and available.
         %> @param obj Instance of PASensorData.
         %> @param method String name of the prefilter method.
         % ======================================================================
         function obj = prefilter(obj,method)
-            fprintf('Prefiltering is not currently implemented\n');
             currentNumBins = floor((obj.durationSec/60)/obj.aggregateDurMin);
             if(currentNumBins~=obj.numBins)
                 obj.numBins = currentNumBins;
                 obj.bins = nan(obj.numBins,1);
             end
 
-            switch(lower(method))
+            if(obj.hasRaw)
+                signal = single(obj.accel.raw.vecMag(:));
+            elseif(obj.hasCounts)
+                signal = single(obj.accel.count.vecMag(:));
+            else
+                signal = single([]);
+            end
+            samplesPerBin = round(obj.aggregateDurMin*60*obj.getSampleRate());
+            numFullBins = min(obj.numBins,floor(numel(signal)/max(samplesPerBin,1)));
+            method = lower(method);
+            switch(method)
                 case 'none'
-                case 'rms'
-                case 'median'
-                case 'mean'
+                    return;
+                case {'rms','median','mean','sum'}
+                    if(numFullBins<1)
+                        return;
+                    end
                 case 'hash'
+                    fprintf(1,'The hash prefilter is not implemented\n');
+                    return;
                 otherwise
                     fprintf(1,'Unknown method (%s)\n',method);
+                    return;
+            end
+
+            if(exist('prefiltersignal','file')==3) % If the mex file exists and is compiled
+                obj.bins = double(prefiltersignal(signal,method,obj.getSampleRate(),'bins',samplesPerBin,obj.numBins));
+            else
+                binMat = double(reshape(signal(1:numFullBins*samplesPerBin),samplesPerBin,numFullBins));
+                switch(method)
+                    case 'rms'
+                        binValues = sqrt(mean(binMat.^2));
+                    case 'median'
+                        binValues = median(binMat);
+                    case 'mean'
+                        binValues = mean(binMat);
+                    case 'sum'
+                        binValues = sum(binMat);
+                end
+                obj.bins = nan(obj.numBins,1);
+                obj.bins(1:numFullBins) = binValues(:);
             end
         end
         
@@ -2389,7 +2777,7 @@ classdef PASensorData < PAData
                 dateNumIndices = 1:numColumns:frameableSamples;
 
                 %take the first part
-                obj.startDatenums = obj.dateTimeNum(dateNumIndices(1:end));
+                obj.startDatenums = obj.getDatenum(dateNumIndices(1:end));
 
                 %% This was another approach for calculating start and stop datenums,
                 % but unfortunately it had complications when calculating
@@ -2408,43 +2796,59 @@ classdef PASensorData < PAData
                 % otherwise just use the original
             end
 
-            obj.usageFrames =  reshape(usageVec(1:frameableSamples), [], obj.numFrames);  %each frame consists of a column of data.  Consecutive columns represent consecutive frames.
-
-            obj.frames =  reshape(data(1:frameableSamples), [], obj.numFrames);  %each frame consists of a column of data.  Consecutive columns represent consecutive frames.
             % Frames are stored in consecutive columns.  Thus the rows
             % represent the consecutive samples of data for that frame
             % Feature functions operate along columns (i.e. down the rows) and the output is then
             % transposed to produce a final, feature vector (1 row)
-            data = obj.frames;
+            % They are only built for the features that are not merged
+            % from the frame summary.
+            signal = data;
+            obj.frames = [];
+            obj.usageFrames = [];
             obj.frames_signalTagLine = signalTagLine;
 
             switch(lower(method))
                 case 'none'
+                    obj.frames =  reshape(signal(1:frameableSamples), [], obj.numFrames);
+                    obj.usageFrames =  reshape(usageVec(1:frameableSamples), [], obj.numFrames);
                 case {'all', 'all_sans_psd', 'all_sans_psd_usagestate'}
-                    obj.features.rms = sqrt(mean(data.^2))';
-                    obj.features.mean = mean(data)';
-                    obj.features.meanad = mean_abs_dev(data);
-                    obj.features.medianad = median_abs_dev(data)';
-                    % obj.features.meanad = mad(data,0)';
-                    % obj.features.medianad = mad(data,1)';
-                    obj.features.median = median(data)';
-                    obj.features.sum = sum(data)';
-                    obj.features.var = var(data)';
-                    obj.features.std = std(data)';
-                    obj.features.mode = mode(data)';
+                    featureNames = {'rms','mean','meanad','medianad','median','sum','var','std','mode'};
+                    mergedFeatures = obj.getMergedFrameFeatures(signalTagLine,signal,featureNames);
+                    for f=1:numel(featureNames)
+                        if(isfield(mergedFeatures,featureNames{f}))
+                            obj.features.(featureNames{f}) = mergedFeatures.(featureNames{f});
+                        else
+                            if(isempty(obj.frames))
+                                obj.frames =  reshape(signal(1:frameableSamples), [], obj.numFrames);
+                            end
+                            obj.features.(featureNames{f}) = obj.calcFeatureVectorFromFrames(obj.frames,featureNames{f});
+                        end
+                    end
                     if ~strcmpi(method, 'all_sans_psd_usagestate')
+                        obj.usageFrames =  reshape(usageVec(1:frameableSamples), [], obj.numFrames);
                         obj.features.usagestate = mode(obj.usageFrames)';
                     end
                     if strcmpi(method, 'all')
+                        if(isempty(obj.frames))
+                            obj.frames =  reshape(signal(1:frameableSamples), [], obj.numFrames);
+                        end
                         obj.calculatePSD(signalTagLine);
                     end
                     %                    obj.features.count = obj.getCount(data)';
                 case 'psd'
+                    obj.frames =  reshape(signal(1:frameableSamples), [], obj.numFrames);
                     obj.calculatePSD(signalTagLine);
                 case 'usagestate'
+                    obj.usageFrames =  reshape(usageVec(1:frameableSamples), [], obj.numFrames);
                     obj.features.usagestate = mode(obj.usageFrames)';
                 otherwise
-                    featureVector = obj.calcFeatureVectorFromFrames(data,method);
+                    mergedFeatures = obj.getMergedFrameFeatures(signalTagLine,signal,lower(method));
+                    if(isfield(mergedFeatures,lower(method)))
+                        featureVector = mergedFeatures.(lower(method));
+                    else
+                        obj.frames =  reshape(signal(1:frameableSamples), [], obj.numFrames);
+                        featureVector = obj.calcFeatureVectorFromFrames(obj.frames,method);
+                    end
                     if(~isempty(featureVector))
                         obj.features.(method) = featureVector;
                     else
@@ -2454,6 +2858,106 @@ classdef PASensorData < PAData
         end
 
 
+        % ======================================================================
+        %> @brief Merges frame features from per minute summaries of the
+        %> signal (see framesummary.c) rather than from its frames, building
+        %> the summary on first use.  Frames must be a whole number of
+        %> minutes long.  Only the features that merge exactly (rms, mean,
+        %> sum, var and std) are merged; medians, absolute deviations,
+        %> modes, usagestate and psd come from the frames.
+        %> @param obj Instance of PASensorData.
+        %> @param signalTagLine Tag of the signal (see extractFeature).
+        %> @param signal The signal's samples.
+        %> @param featureNames Feature name or cell of them.
+        %> @retval mergedFeatures Struct with one numFrames x 1 field for
+        %> each feature that could be merged; empty struct when the
+        %> summary is not used.
+        % ======================================================================
+        function mergedFeatures = getMergedFrameFeatures(obj,signalTagLine,signal,featureNames)
+            mergedFeatures = struct();
+            featureNames = intersect(cellstr(featureNames),{'rms','mean','sum','var','std'},'stable');
+            if(~obj.useFrameSummary || isempty(featureNames) || exist('framesummary','file')~=3 || isempty(obj.numFrames) || obj.numFrames<1)
+                return;
+            end
+            try
+                samplesPerBase = 60*obj.getSampleRate();
+                basesPerFrame = obj.getFrameableSampleCount()/obj.numFrames/samplesPerBase;
+                if(samplesPerBase<1 || samplesPerBase~=round(samplesPerBase) || basesPerFrame<1 || basesPerFrame~=round(basesPerFrame))
+                    return;
+                end
+                numBases = floor(numel(signal)/samplesPerBase);
+                summary = obj.frameSummary;
+                if(~isstruct(summary) || ~strcmp(summary.signalTagLine,signalTagLine) || summary.samplesPerBase~=samplesPerBase || ...
+                        summary.numBases~=numBases || summary.signalVersion~=obj.signalVersion)
+                    summary = framesummary(signal(:),samplesPerBase);
+                    summary.signalTagLine = signalTagLine;
+                    summary.signalVersion = obj.signalVersion;
+                    obj.frameSummary = summary;
+                end
+                for f=1:numel(featureNames)
+                    featureVec = framesummary(summary,featureNames{f},basesPerFrame,obj.numFrames);
+                    if(~isempty(featureVec))
+                        mergedFeatures.(featureNames{f}) = featureVec;
+                    end
+                end
+            catch me
+                showME(me);
+                mergedFeatures = struct();
+            end
+        end
+
+        % ======================================================================
+        %> @brief Updates the frames and the features already extracted (see
+        %> extractFeature) after samples were appended or reclassified,
+        %> recomputing only the frames from the one holding firstSample on.
+        %> PSD bands are recalculated for all frames.
+        %> @param obj Instance of PASensorData.
+        %> @param firstSample First sample whose value or usage state changed.
+        % ======================================================================
+        function updateFeatures(obj, firstSample)
+            if(isempty(obj.features) || isempty(obj.frames_signalTagLine) || isempty(obj.numFrames))
+                return;
+            end
+            [currentNumFrames, frameableSamples] = obj.getFrameCount();
+            if(currentNumFrames<1)
+                return;
+            end
+            samplesPerFrame = frameableSamples/currentNumFrames;
+            firstFrame = min(floor((firstSample-1)/samplesPerFrame)+1, obj.numFrames+1);
+            if(firstFrame>currentNumFrames)
+                return;
+            end
+
+            data = obj.getSignalFromTagLine(obj.frames_signalTagLine);
+            tagParts = strsplit(obj.frames_signalTagLine,'.');
+            axisName = tagParts{end};
+            obj.numFrames = currentNumFrames;
+            obj.startDatenums = obj.getDatenum(1:samplesPerFrame:frameableSamples);
+            obj.frames = reshape(data(1:frameableSamples), samplesPerFrame, obj.numFrames);
+            if isstruct(obj.usage) && isfield(obj.usage, axisName)
+                obj.usageFrames = reshape(obj.usage.(axisName)(1:frameableSamples), samplesPerFrame, obj.numFrames);
+            end
+
+            newFrames = obj.frames(:,firstFrame:end);
+            hasPSD = false;
+            featureNames = fieldnames(obj.features);
+            for f=1:numel(featureNames)
+                featureName = featureNames{f};
+                if(strncmp(featureName,'psd_band',8))
+                    hasPSD = true;
+                    continue;
+                elseif(strcmpi(featureName,'usagestate'))
+                    featureVec = mode(obj.usageFrames(:,firstFrame:end))';
+                else
+                    featureVec = obj.calcFeatureVectorFromFrames(newFrames,featureName);
+                end
+                obj.features.(featureName) = [obj.features.(featureName)(1:firstFrame-1); featureVec];
+            end
+            if(hasPSD)
+                obj.calculatePSD();
+            end
+        end
+
         %> @brief Calculates the PSD for the current frames and assigns the
         %> result to obj.psd.frames.  Will also assign
         %> obj.frames_signalTagLine to the signalTagLine argument when
@@ -2632,31 +3136,22 @@ classdef PASensorData < PAData
             else
                 featureVec = featureStruct.(featureFcn);
 
-                % get frame duration
-                frameDurationVec = [0 0 0 obj.frameDurHour obj.frameDurMin 0];
-
-                % find the first Start Time
-                startDateVecs = datevec(obj.startDatenums);
-                elapsedStartHours = startDateVecs*[0; 0; 0; 1; 1/60; 1/3600];
-                startIndex = find(elapsedStartHours==elapsedStartHour,1,'first');
+                % Frames are consecutive and of equal duration, so the
+                % aligned intervals follow from the first frame that starts
+                % at elapsedStartHour without converting to datevecs.
+                frameDurationHours = obj.frameDurHour+obj.frameDurMin/60;
+                framesPerInterval = round(intervalDurationHours/frameDurationHours);
 
-                startDateVec = startDateVecs(startIndex,:);
-                stopDateVecs = startDateVecs+repmat(frameDurationVec,size(startDateVecs,1),1);
-                lastStopDateVec = stopDateVecs(end,:);
+                % find the first Start Time (to the second, to ignore datenum round off)
+                startSecOfDay = round(mod(obj.startDatenums(:),1)*24*3600);
+                startIndex = find(startSecOfDay==round(elapsedStartHour*3600),1,'first');
 
-                % A convoluted processes - need to convert datevecs back to
-                % datenum to handle switching across months.
-                remainingDurationHours = datevec(datenum(lastStopDateVec)-datenum(startDateVec))*[0; 0; 24; 1; 1/60; 1/3600];
-
-                numIntervals = floor(remainingDurationHours/intervalDurationHours);
-
-                intervalStartDateVecs = repmat(startDateVec,numIntervals,1)+(0:numIntervals-1)'*[0, 0, 0, intervalDurationHours, 0, 0];
-                alignedStartDateVecs = intervalStartDateVecs;
-                durationDateVec = [0 0 0 numIntervals*intervalDurationHours 0 0];
-                stopIndex = find(datenum(stopDateVecs)==datenum(startDateVec+durationDateVec),1,'first');
+                numIntervals = floor((numel(featureVec)-startIndex+1)/framesPerInterval);
+                intervalStartDatenums = obj.startDatenums(startIndex)+(0:numIntervals-1)'*intervalDurationHours/24;
+                alignedStartDateVecs = datevec(intervalStartDatenums);
+                stopIndex = startIndex+numIntervals*framesPerInterval-1;
 
                 % reshape the result and return as alignedFeatureVec
-
                 clippedFeatureVecs = featureVec(startIndex:stopIndex);
                 alignedFeatureVecs = reshape(clippedFeatureVecs,[],numIntervals)';
             end
@@ -2667,9 +3162,20 @@ classdef PASensorData < PAData
         %> @brief Classifies the usage state for each axis using count data from
         %> each axis.
         %> @param obj Instance of PASensorData.
+        %> @param firstSample (optional) First sample that changed since the
+        %> last classification (e.g. the first sample appended by
+        %> followFile).  Only samples from a lookback span before it, long
+        %> enough to cover the merge and minimum duration spans of the
+        %> usage rules, are reclassified.  Default is 1 (classify all).
         %> @retval didClassify True/False depending on success.
+        %> @retval firstChangedSample First sample whose usage state was
+        %> reclassified.
         % ======================================================================
-        function didClassify = classifyUsageForAllAxes(obj)
+        function [didClassify, firstChangedSample] = classifyUsageForAllAxes(obj, firstSample)
+            if(nargin<2 || isempty(firstSample))
+                firstSample = 1;
+            end
+            firstChangedSample = 1;
             try
                 if(obj.hasCounts || obj.hasRaw || obj.hasMims)
                     dataStruct = obj.getStruct('all');
@@ -2683,22 +3189,78 @@ classdef PASensorData < PAData
                         classifyObj = PAClassifyCounts();% %obj.classifyUsageState(dataStruct.(axesName));
                         dataStruct = dataStruct.accel.count;
                     end
+                    axesNames = fieldnames(dataStruct);
                     
-                    classifyObj.setDatenumVec(obj.dateTimeNum);
-                    obj.usage = struct();
-                    obj.bai = struct();
-                    
-                    axesNames = fieldnames(dataStruct);                    
+                    % Reclassify the tail when the earlier samples are unchanged.
+                    % The classified segment starts a further lookback span
+                    % earlier so the start of the segment is not mistaken for
+                    % the start of the study.
+                    isUpdate = firstSample>1 && isstruct(obj.usage) && all(isfield(obj.usage,axesNames));
+                    if(isUpdate)
+                        lookbackSamples = obj.getUsageLookbackSamples(classifyObj);
+                        writeStart = max(1,firstSample-lookbackSamples);
+                        segmentStart = max(1,writeStart-lookbackSamples);
+                        isUpdate = segmentStart>1;
+                    end
+                    if(isUpdate)
+                        firstChangedSample = writeStart;
+                        if(~isempty(obj.timeBase))
+                            classifyObj.setTimeBase(obj.timeBase,segmentStart);
+                        else
+                            classifyObj.setDatenumVec(obj.dateTimeNum(segmentStart:end));
+                        end
+                    else
+                        if(~isempty(obj.timeBase))
+                            classifyObj.setTimeBase(obj.timeBase);
+                        else
+                            classifyObj.setDatenumVec(obj.dateTimeNum);
+                        end
+                        obj.usage = struct();
+                        obj.bai = struct();
+                    end
 
                     if strcmpi(obj.accelType,'raw') && obj.hasRaw
-                        [obj.bai.vecMag, obj.bai.x, obj.bai.y, obj.bai.z] = classifyObj.classifiyBaiActivity(dataStruct.x, dataStruct.y, dataStruct.z, obj.sampleRate);
+                        if(isUpdate && isstruct(obj.bai) && isfield(obj.bai,'vecMag'))
+                            % one value per whole second
+                            fs = obj.sampleRate;
+                            firstSecond = floor((writeStart-1)/fs)+1;
+                            tailIndices = ((firstSecond-1)*fs+1):numel(dataStruct.x);
+                            [baiTail.vecMag, baiTail.x, baiTail.y, baiTail.z] = classifyObj.classifiyBaiActivity(dataStruct.x(tailIndices), dataStruct.y(tailIndices), dataStruct.z(tailIndices), fs);
+                            baiFields = fieldnames(baiTail);
+                            for b=1:numel(baiFields)
+                                obj.bai.(baiFields{b}) = [obj.bai.(baiFields{b})(1:firstSecond-1); baiTail.(baiFields{b})];
+                            end
+                        elseif(obj.hasEpochSummary())
+                            % Same per second standard deviations, computed at conversion
+                            obj.bai.vecMag = double(obj.epochSummary.baiSigma);
+                            obj.bai.x = double(obj.epochSummary.std(:,1));
+                            obj.bai.y = double(obj.epochSummary.std(:,2));
+                            obj.bai.z = double(obj.epochSummary.std(:,3));
+                        else
+                            [obj.bai.vecMag, obj.bai.x, obj.bai.y, obj.bai.z] = classifyObj.classifiyBaiActivity(dataStruct.x, dataStruct.y, dataStruct.z, obj.sampleRate);
+                        end
                     end
                     % As long as you don't run into an exception, it passes.
                     didClassify = true;
+                    % The study server and background loader classify raw
+                    % signals with the same default rules when they decode
+                    % them (see applyLoadedStudy).
+                    if(~isUpdate && strcmpi(obj.accelType,'raw') && size(obj.loadedUsage,1)==numel(dataStruct.x))
+                        loadedNames = {'x','y','z','vecMag'};
+                        for a=1:numel(loadedNames)
+                            obj.usage.(loadedNames{a}) = double(obj.loadedUsage(:,a));
+                        end
+                        axesNames = setdiff(axesNames,loadedNames);
+                    end
                     for a=1:numel(axesNames)
                         try
                             axesName=axesNames{a};
-                            obj.usage.(axesName) = classifyObj.classifyUsageState(dataStruct.(axesName)); %obj.classifyUsageState(dataStruct.(axesName));
+                            if(isUpdate)
+                                segmentUsage = classifyObj.classifyUsageState(dataStruct.(axesName)(segmentStart:end));
+                                obj.usage.(axesName) = [obj.usage.(axesName)(1:writeStart-1); segmentUsage(writeStart-segmentStart+1:end)];
+                            else
+                                obj.usage.(axesName) = classifyObj.classifyUsageState(dataStruct.(axesName)); %obj.classifyUsageState(dataStruct.(axesName));
+                            end
                         catch me
                             showME(me);
                             didClassify = false;
@@ -2987,24 +3549,56 @@ classdef PASensorData < PAData
         function [didLoad,recordCount] = loadPadacoRawBinFile(obj,fullBinFilename)
             didLoad = false;
             recordCount = 0;
-            if(exist(fullBinFilename,'file'))
+            if(exist(fullBinFilename,'file') && obj.loadSharedStudy(fullBinFilename))
+                recordCount = obj.sharedStudy.numRecords;
+                fid = fopen(fullBinFilename,'r','n');
+                if(fid>0)
+                    obj.calibration = obj.loadPadacoRawBinCalibration(fid, obj.loadPadacoRawBinFileHeader(fid));
+                    fclose(fid);
+                end
+                didLoad = true;
+            elseif(exist(fullBinFilename,'file') && obj.loadBackgroundStudy(fullBinFilename))
+                recordCount = size(obj.loadedUsage,1);
+                fid = fopen(fullBinFilename,'r','n');
+                if(fid>0)
+                    obj.calibration = obj.loadPadacoRawBinCalibration(fid, obj.loadPadacoRawBinFileHeader(fid));
+                    fclose(fid);
+                end
+                didLoad = true;
+            elseif(exist(fullBinFilename,'file'))
                 fid = fopen(fullBinFilename,'r','n');  %Let's go with native format...
 
                 if(fid>0)
                     binHeader = obj.loadPadacoRawBinFileHeader(fid);
-                    recordCount1 = binHeader.sz_remaining/binHeader.num_signals/binHeader.sz_per_signal;
-                    recordCount2 = binHeader.samplerate*binHeader.duration_sec;
-                    if(recordCount1~=recordCount2)
-                        fprintf(1,'A mismatch exists for record count as specified in the binary file %s',fullBinFilename);
-                        recordCount = max(recordCount1,recordCount2); % Take the largest of the two for pre-allocation.
+                    % A sz_per_signal of 0 marks a compressed payload (see src/rawcodec.h)
+                    if(binHeader.sz_per_signal==0)
+                        fclose(fid);
+                        if(exist('loadrawbin','file')~=3)
+                            fprintf(1,'%s has a compressed payload.  Compile the loadrawbin mex file or expand it with rawbinpack -d to load it.\n',fullBinFilename);
+                            return;
+                        end
+                        xyzData = loadrawbin(fullBinFilename);
+                        recordCount = size(xyzData,1);
+                        fid = fopen(fullBinFilename,'r','n');
+                        obj.calibration = obj.loadPadacoRawBinCalibration(fid, binHeader);
+                        fclose(fid);
                     else
-                        recordCount = recordCount1;
+                        recordCount1 = binHeader.sz_remaining/binHeader.num_signals/binHeader.sz_per_signal;
+                        recordCount2 = binHeader.samplerate*binHeader.duration_sec;
+                        if(recordCount1~=recordCount2)
+                            fprintf(1,'A mismatch exists for record count as specified in the binary file %s',fullBinFilename);
+                            recordCount = max(recordCount1,recordCount2); % Take the largest of the two for pre-allocation.
+                        else
+                            recordCount = recordCount1;
+                        end
+                        %                     curPos = ftell(fid);
+                        %                     a=fread(fid, [binHeader.num_signals,inf],'*float')';
+                        %                     fseek(fid,curPos,'bof');
+                        %                     tic
+                        xyzData=fread(fid, [binHeader.num_signals,recordCount],'*float')';
+                        obj.calibration = obj.loadPadacoRawBinCalibration(fid, binHeader);
+                        fclose(fid);
                     end
-                    %                     curPos = ftell(fid);
-                    %                     a=fread(fid, [binHeader.num_signals,inf],'*float')';
-                    %                     fseek(fid,curPos,'bof');
-                    %                     tic
-                    xyzData=fread(fid, [binHeader.num_signals,recordCount],'*float')';
                     obj.setRawXYZ(xyzData);
 
                     obj.sampleRate = binHeader.samplerate;
@@ -3020,12 +3614,255 @@ classdef PASensorData < PAData
                     obj.stopDate = datestr(stopDatenum,'mm/dd/yyyy');
                     obj.stopTime = datestr(stopDatenum,'HH:MM:SS');
 
-                    datenumDelta = datenum([0,0,0,0,0,1/obj.sampleRate]);
-                    obj.dateTimeNum = datespace(startDatenum,stopDatenum,datenumDelta);
+                    % Sample times are implied by the start and sample rate.
+                    obj.dateTimeNum = [];
+                    obj.timeBase = PATimeBase(startDatenum,obj.sampleRate,size(xyzData,1));
 
                     didLoad = true;
                 end
             end
+            if(didLoad)
+                obj.epochSummary = PASensorData.loadEpochSummary(fullBinFilename);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Loads a raw file through the padacod study server, which
+        %> decodes each file once and shares it with every session on the
+        %> machine (see src/padacod.c).  Nothing is loaded when the
+        %> useStudyServer setting is off, the sharedstudy mex file is not
+        %> compiled or no server is running.
+        %> @param obj Instance of PASensorData.
+        %> @param fullFilename Full filename of the raw .bin or .csv file.
+        %> @retval didLoad True if the raw data was loaded from the server.
+        % ======================================================================
+        function didLoad = loadSharedStudy(obj, fullFilename)
+            didLoad = false;
+            obj.sharedStudy = [];
+            if(~obj.useStudyServer || exist('sharedstudy','file')~=3)
+                return;
+            end
+            try
+                info = sharedstudy('open', fullFilename);
+                if(~isempty(info) && info.numRecords>0)
+                    info.signals = sharedstudy('window', info.handle, 1, info.numRecords);
+                    info.usage = sharedstudy('usage', info.handle, 1, info.numRecords);
+                    obj.applyLoadedStudy(info);
+                    obj.sharedStudy = rmfield(info,{'signals','usage'});
+                    didLoad = true;
+                end
+            catch me
+                showME(me);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Loads a raw .bin file through the background loader (see
+        %> PAStudyLoader), reusing a load that already finished or was
+        %> prefetched and waiting on one underway.  The loader classifies
+        %> usage states as it decodes (see applyLoadedStudy).  Nothing is loaded when the
+        %> loadInBackground setting is off or the asyncload mex file is not
+        %> compiled.
+        %> @param obj Instance of PASensorData.
+        %> @param fullFilename Full filename of the raw .bin file.
+        %> @retval didLoad True if the raw data was loaded.
+        % ======================================================================
+        function didLoad = loadBackgroundStudy(obj, fullFilename)
+            didLoad = false;
+            obj.loadedUsage = [];
+            if(~obj.loadInBackground || ~PAStudyLoader.canLoad(fullFilename))
+                return;
+            end
+            try
+                study = PAStudyLoader.fetch(fullFilename);
+                if(~isempty(study) && study.numRecords>0)
+                    obj.applyLoadedStudy(study);
+                    didLoad = true;
+                end
+            catch me
+                showME(me);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Takes on a study decoded by the study server or the
+        %> background loader: its raw accelerations, sample rate, start and
+        %> stop and the usage states classified as it was decoded, which
+        %> classifyUsageForAllAxes uses instead of classifying them again.
+        %> @param obj Instance of PASensorData.
+        %> @param study Struct with fields signals (numRecords x 4 single:
+        %> x, y, z and vecMag), usage (numRecords x 4 int8), samplerate,
+        %> durationSec, startDatenum and numRecords.
+        % ======================================================================
+        function applyLoadedStudy(obj, study)
+            obj.setRawXYZ(study.signals(:,1:3));
+
+            obj.sampleRate = study.samplerate;
+            obj.durationSec = study.durationSec;
+            startDatenum = study.startDatenum;
+            obj.startDate = datestr(startDatenum,'mm/dd/yyyy');
+            obj.startTime = datestr(startDatenum,'HH:MM:SS');
+            stopDatenum = startDatenum+(obj.durationSec-1/obj.sampleRate)/(24*60*60);
+            obj.stopDate = datestr(stopDatenum,'mm/dd/yyyy');
+            obj.stopTime = datestr(stopDatenum,'HH:MM:SS');
+            obj.dateTimeNum = [];
+            obj.timeBase = PATimeBase(startDatenum,obj.sampleRate,study.numRecords);
+
+            obj.loadedUsage = study.usage;
+        end
+
+        % ======================================================================
+        %> @brief Reads records of a Padaco .bin file without loading the rest
+        %> of the payload.
+        %> @param obj Instance of PASensorData.
+        %> @param fullBinFilename Full filename of the .bin file.
+        %> @param startRecord First record to read (1 based).
+        %> @param numRecords Number of records to read.
+        %> @retval xyzData numRecords x num_signals single matrix.  When the
+        %> loaded samples were calibrated after loading (see calibrateRaw),
+        %> the records are given the same correction; payloads calibrated by
+        %> rawcsv2rawbin -k are read as they are.
+        % ======================================================================
+        function xyzData = loadPadacoRawBinRecords(obj, fullBinFilename, startRecord, numRecords)
+            fid = fopen(fullBinFilename,'r','n');
+            if(fid<0)
+                throw(MException('MATLAB:Padaco:FileIO','Could not open %s for reading',fullBinFilename));
+            end
+            binHeader = obj.loadPadacoRawBinFileHeader(fid);
+            isPayloadCalibrated = ~isempty(obj.loadPadacoRawBinCalibration(fid, binHeader));
+            if(exist('loadrawbin','file')==3)
+                fclose(fid);
+                xyzData = loadrawbin(fullBinFilename, startRecord, numRecords);
+            elseif(binHeader.sz_per_signal==0)
+                % A sz_per_signal of 0 marks a compressed payload (see src/rawcodec.h)
+                fclose(fid);
+                throw(MException('MATLAB:Padaco:FileIO','%s has a compressed payload.  Compile the loadrawbin mex file or expand it with rawbinpack -d to load it.',fullBinFilename));
+            else
+                % sizeof(bin_header_t)
+                headerSize = 2+24+10+20+4+1+1+8;
+                fseek(fid,headerSize+(startRecord-1)*binHeader.num_signals*binHeader.sz_per_signal,'bof');
+                xyzData = fread(fid, [binHeader.num_signals,numRecords],'*float')';
+                fclose(fid);
+            end
+            if(~isPayloadCalibrated && isstruct(obj.calibration) && obj.calibration.didCalibrate)
+                xyzData(:,1:3) = cast(obj.calibration.offset+obj.calibration.scale.*double(xyzData(:,1:3)),'like',xyzData);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Appends raw records and extends the duration and time base.
+        %> @param obj Instance of PASensorData.
+        %> @param xyzData Nx3 matrix of x, y, z accelerations.
+        % ======================================================================
+        function appendRawXYZ(obj, xyzData)
+            obj.sharedStudy = [];
+            obj.loadedUsage = [];
+            obj.epochSummary = [];
+            obj.frameSummary = [];
+            obj.accel.raw.x = [obj.accel.raw.x; xyzData(:,1)];
+            obj.accel.raw.y = [obj.accel.raw.y; xyzData(:,2)];
+            obj.accel.raw.z = [obj.accel.raw.z; xyzData(:,3)];
+            obj.accel.raw.vecMag = [obj.accel.raw.vecMag; sqrt(sum(xyzData(:,1:3).^2,2))];
+            obj.durSamples = numel(obj.accel.raw.x);
+            obj.durationSec = floor(obj.durSamples/obj.sampleRate);
+            obj.timeBase = obj.timeBase.setNumSamples(obj.durSamples);
+            stopDatenum = obj.getDatenum(obj.durSamples);
+            obj.stopDate = datestr(stopDatenum,'mm/dd/yyyy');
+            obj.stopTime = datestr(stopDatenum,'HH:MM:SS');
+        end
+
+        % ======================================================================
+        %> @brief Loads the rows appended to a .mims file since the last call
+        %> (see followFile).  The first call loads the whole file.
+        %> @param obj Instance of PASensorData.
+        %> @param fullfilename Full filename of the .mims file.
+        %> @retval numNewSamples Number of samples appended, including
+        %> missing values filled in for skipped seconds.
+        %> @retval firstNewSample Index of the first appended sample.
+        % ======================================================================
+        function [numNewSamples, firstNewSample] = followMimsFile(obj, fullfilename)
+            numNewSamples = 0;
+            firstNewSample = 1;
+            isFollowing = isstruct(obj.followState) && strcmp(obj.followState.sourceFilename,fullfilename) && obj.hasMims;
+            fid = fopen(fullfilename,'r');
+            if(fid<3)
+                obj.logWarning('Unable to load file %s', fullfilename);
+                return;
+            end
+            if(~isFollowing)
+                fclose(fid);
+                if(obj.loadMimsFile(fullfilename))
+                    % A partial last row is read again (and skipped) next time.
+                    fid = fopen(fullfilename,'r');
+                    A = fread(fid,'*char')';
+                    fclose(fid);
+                    obj.followState = struct('sourceFilename',fullfilename,'binFilename','','byteOffset',find(A==newline,1,'last'));
+                    numNewSamples = obj.getDurationSamples();
+                end
+                return;
+            end
+            fseek(fid,obj.followState.byteOffset,'bof');
+            A = fread(fid,'*char')';
+            fclose(fid);
+            lastNewline = find(A==newline,1,'last');
+            if(isempty(lastNewline))
+                return;
+            end
+            obj.followState.byteOffset = obj.followState.byteOffset+lastNewline;
+            tmpDataCell = textscan(A(1:lastNewline), '%{yyyy-MM-dd HH:mm:ss.SSS}D%f%f%f%f', 'delimiter',',');
+
+            % Keep rows after the last sample loaded and fill skipped
+            % seconds with the missing value, as loadMimsFile does.
+            windowDateNumDelta = datenum([0,0,0,0,0,obj.countPeriodSec]);
+            lastDatenum = obj.dateTimeNum(end);
+            datetimeFound = tmpDataCell{1};
+            dateNumFound = datenum(datetimeFound);
+            isNew = dateNumFound>lastDatenum+windowDateNumDelta/2;
+            if(~any(isNew))
+                return;
+            end
+            dateNumFound = dateNumFound(isNew);
+            [dataCell, newDateNums] = obj.mergedCell(dateNumFound(1),max(dateNumFound),windowDateNumDelta,datetimeFound(isNew),...
+                cellfun(@(values)values(isNew),tmpDataCell(3:5),'uniformoutput',false),obj.getSetting('missingValue'));
+            numMissing = max(0,round((dateNumFound(1)-lastDatenum)/windowDateNumDelta)-1);
+            missingDateNums = lastDatenum+(1:numMissing)'*windowDateNumDelta;
+            missingValues = repmat(obj.getSetting('missingValue'),numMissing,1);
+
+            firstNewSample = obj.getDurationSamples()+1;
+            obj.accel.mims.x = [obj.accel.mims.x; missingValues; dataCell{1}];
+            obj.accel.mims.y = [obj.accel.mims.y; missingValues; dataCell{2}];
+            obj.accel.mims.z = [obj.accel.mims.z; missingValues; dataCell{3}];
+            obj.accel.mims.vecMag = sqrt(obj.accel.mims.x.^2+obj.accel.mims.y.^2+obj.accel.mims.z.^2);
+            obj.dateTimeNum = [obj.dateTimeNum(:); missingDateNums; newDateNums(:)];
+            obj.durSamples = numel(obj.dateTimeNum);
+            obj.durationSec = floor(obj.getDurationSamples()*obj.countPeriodSec);
+            numNewSamples = obj.durSamples-firstNewSample+1;
+        end
+
+        % ======================================================================
+        %> @brief Number of samples before a change in the signal whose usage
+        %> state can change with it: the sum of the merge and minimum
+        %> duration spans of the classifier's rules.
+        %> @param obj Instance of PASensorData.
+        %> @param classifyObj Instance of PAClassifyUsage.
+        %> @retval lookbackSamples
+        % ======================================================================
+        function lookbackSamples = getUsageLookbackSamples(~, classifyObj)
+            rules = paparamsToValues(classifyObj.getUsageClassificationRules());
+            ruleNames = fieldnames(rules);
+            lookbackHours = 0;
+            for r=1:numel(ruleNames)
+                value = rules.(ruleNames{r});
+                if(~isnumeric(value) || ~isscalar(value))
+                    continue;
+                end
+                if(~isempty(strfind(ruleNames{r},'Hours')))
+                    lookbackHours = lookbackHours+value;
+                elseif(~isempty(strfind(ruleNames{r},'Minutes')))
+                    lookbackHours = lookbackHours+value/60;
+                end
+            end
+            lookbackSamples = ceil(lookbackHours*3600*classifyObj.getSampleRate());
         end
 
         % ======================================================================
@@ -3543,6 +4380,151 @@ classdef PASensorData < PAData
             end
         end
 
+        %> @brief Reads the auto-calibration record that rawcsv2rawbin -k
+        %> writes after the payload of a Padaco .bin file (see src/calibrate.h).
+        %> @param fid File identifier of the open .bin file.
+        %> @param binHeader Header struct from loadPadacoRawBinFileHeader.
+        %> @retval calibration Struct as returned by calibrateRaw, or empty
+        %> when the file has no calibration record.
+        function calibration = loadPadacoRawBinCalibration(fid, binHeader)
+            calibration = [];
+            % sizeof(bin_header_t)
+            headerSize = 2+24+10+20+4+1+1+8;
+            if(fseek(fid,headerSize+double(binHeader.sz_remaining),'bof')==0)
+                magic = fread(fid,[1,8],'*char');
+                version = fread(fid,1,'uint32');
+                if(numel(magic)==8 && strncmp(magic,'PZCAL1',6) && isequal(version,1))
+                    calibration.didCalibrate = fread(fid,1,'uint8')~=0;
+                    calibration.usesTemperature = fread(fid,1,'uint8')~=0;
+                    calibration.numWindows = fread(fid,1,'uint32');
+                    calibration.numIterations = fread(fid,1,'uint32');
+                    calibration.offset = fread(fid,[1,3],'double');
+                    calibration.scale = fread(fid,[1,3],'double');
+                    calibration.temperatureCoef = fread(fid,[1,3],'double');
+                    calibration.meanTemperature = fread(fid,1,'double');
+                    calibration.errorBefore = fread(fid,1,'double');
+                    calibration.errorAfter = fread(fid,1,'double');
+                    if(feof(fid))
+                        calibration = [];
+                    end
+                end
+            end
+        end
+
+        %> @brief Reads the per second summary that rawcsv2rawbin -e writes
+        %> next to a .bin file as <name>.sec (see src/epochsummary.h).
+        %> @param fullBinFilename Full filename of the .bin file (or of the
+        %> .sec file itself).
+        %> @retval epochSummary Struct with fields samplerate, startDatenum,
+        %> clipG and, one row per second, mean, std, min, max, clipCount and
+        %> stuckCount (Nx3, x y z) and enmo and baiSigma (Nx1); empty when
+        %> there is no summary or the .bin file's size or modification time
+        %> differ from those it was summarized at.
+        function epochSummary = loadEpochSummary(fullBinFilename)
+            epochSummary = [];
+            [pathName, baseName] = fileparts(fullBinFilename);
+            sidecarFilename = fullfile(pathName,[baseName,'.sec']);
+            binInfo = dir(fullfile(pathName,[baseName,'.bin']));
+            fid = fopen(sidecarFilename,'r','n');
+            if(fid<0)
+                return;
+            end
+            try
+                magic = fread(fid,[1,8],'*char');
+                version = fread(fid,1,'uint32');
+                samplerate = fread(fid,1,'uint16');
+                numAxes = fread(fid,1,'uint16');
+                numSeconds = fread(fid,1,'uint32');
+                clipG = fread(fid,1,'single');
+                startDatenum = fread(fid,1,'double');
+                binSize = fread(fid,1,'uint64');
+                binModifiedDatenum = fread(fid,1,'double');
+                isCurrent = numel(binInfo)==1 && isequal(binSize,binInfo.bytes) && abs(binModifiedDatenum-binInfo.datenum)*24*60*60<=1;
+                if(strncmp(magic,'PZSEC1',6) && isequal(version,2) && isequal(numAxes,3) && isCurrent)
+                    % 14 singles then 6 uint16 per second
+                    records = fread(fid,[68,numSeconds],'*uint8');
+                    if(size(records,2)==numSeconds)
+                        values = reshape(typecast(reshape(records(1:56,:),[],1),'single'),14,[])';
+                        counts = reshape(typecast(reshape(records(57:68,:),[],1),'uint16'),6,[])';
+                        epochSummary = struct('samplerate',samplerate,'startDatenum',startDatenum,'clipG',clipG,...
+                            'mean',values(:,1:3),'std',values(:,4:6),'min',values(:,7:9),'max',values(:,10:12),...
+                            'enmo',values(:,13),'baiSigma',values(:,14),'clipCount',counts(:,1:3),'stuckCount',counts(:,4:6));
+                    end
+                end
+            catch me
+                showME(me);
+            end
+            fclose(fid);
+        end
+
+        %> @brief MATLAB version of the calibrateraw mex file: fits per axis
+        %> offset and scale to the means of still windows by iterative
+        %> sphere fitting and applies them when accepted (see src/calibrate.h).
+        %> @param xyz Nx3 matrix of raw x, y, z accelerations (g).
+        %> @param sampleRate Samples per second.
+        %> @retval xyz The corrected (or unchanged) accelerations.
+        %> @retval calibration Struct with the same fields as the .bin
+        %> calibration record (see loadPadacoRawBinCalibration).
+        function [xyz, calibration] = fitCalibration(xyz, sampleRate)
+            windowSec = 10;
+            stdThreshold = 0.013;
+            minWindows = 10;
+            sphereCoverage = 0.3;
+            maxError = 0.01;
+
+            calibration = struct('didCalibrate',false,'usesTemperature',false,'numWindows',0,'numIterations',0,...
+                'offset',zeros(1,3),'scale',ones(1,3),'temperatureCoef',zeros(1,3),'meanTemperature',0,...
+                'errorBefore',nan,'errorAfter',nan);
+
+            samplesPerWindow = round(windowSec*sampleRate);
+            numWindows = floor(size(xyz,1)/samplesPerWindow);
+            means = zeros(numWindows,3);
+            isStill = true(numWindows,1);
+            for a=1:3
+                windows = reshape(double(xyz(1:numWindows*samplesPerWindow,a)),samplesPerWindow,numWindows);
+                means(:,a) = mean(windows)';
+                isStill = isStill & std(windows)'<stdThreshold;
+            end
+            means = means(isStill,:);
+            calibration.numWindows = size(means,1);
+            if(calibration.numWindows<minWindows)
+                return;
+            end
+            calibration.errorBefore = mean(abs(sqrt(sum(means.^2,2))-1));
+            calibration.errorAfter = calibration.errorBefore;
+            if(any(min(means)>=-sphereCoverage) || any(max(means)<=sphereCoverage))
+                return;
+            end
+
+            offset = zeros(1,3);
+            scale = ones(1,3);
+            previousError = calibration.errorBefore;
+            for iteration=1:1000
+                corrected = offset+scale.*means;
+                closest = corrected./sqrt(sum(corrected.^2,2));
+                weights = min(1./sqrt(sum((corrected-closest).^2,2)),100);
+                for a=1:3
+                    coef = lscov([ones(size(corrected,1),1), corrected(:,a)], closest(:,a), weights);
+                    offset(a) = coef(1)+coef(2)*offset(a);
+                    scale(a) = scale(a)*coef(2);
+                end
+                corrected = offset+scale.*means;
+                curError = mean(abs(sqrt(sum(corrected.^2,2))-1));
+                calibration.numIterations = iteration;
+                if(abs(previousError-curError)<1e-10)
+                    break;
+                end
+                previousError = curError;
+            end
+            calibration.errorAfter = curError;
+            if(curError<maxError && curError<calibration.errorBefore)
+                calibration.didCalibrate = true;
+                calibration.offset = offset;
+                calibration.scale = scale;
+                xyz = cast(offset+scale.*double(xyz),'like',xyz);
+            end
+        end
+
         % ======================================================================
         %> @brief Parses the information found in input file name and returns
         %> the result as a struct of field-value pairs.
@@ -3773,6 +4755,11 @@ classdef PASensorData < PAData
             pStruct.aggregateDurMin = PANumericParam('default',3,'Description','Aggregatate duration (minutes)','help','This value is not currently used');
             pStruct.windowDurSec = PANumericParam('default',60*60,'Description','Window display duration','help','This can be adjusted by the user, and is 1 hour by default.'); % set to 1 hour
            
+            pStruct.useStudyServer = PABoolParam('default',true,'description','Use the study server','help','Loads raw files through a running padacod study server, which shares decoded studies between sessions, when the sharedstudy mex file is compiled');
+            pStruct.loadInBackground = PABoolParam('default',true,'description','Load raw files in the background','help','Decodes and classifies raw .bin files on background threads, showing progress and an hourly overview while they load, when the asyncload mex file is compiled');
+            pStruct.prefetchCount = PANumericParam('default',0,'min',0,'description','Studies to prefetch','help','Number of studies following an opened .bin file in its folder to load in the background ahead of time.  Each prefetched study is held in memory (about 20 bytes per sample) until it is opened or the folder changes.');
+            pStruct.useFrameSummary = PABoolParam('default',true,'description','Merge frame features from minute summaries','help','The rms, mean, sum, variance and standard deviation of frames whose duration is a whole number of minutes are merged exactly from per minute summaries of the signal when the framesummary mex file is compiled.  Other features are calculated from the frames.');
+            pStruct.autoCalibrate = PABoolParam('default',false,'description','Auto-calibrate raw accelerations','help','Corrects the offset and scale of each raw axis so still periods measure 1 g');
             pStruct.nonwearAlgorithm = PAEnumParam('default','padaco','categories',{'padaco','choi','none'},'description','Nonwear classification algorithm');  
 
             usageState.longClassificationMinimumDurationOfMinutes=15;
@@ -0,0 +1,134 @@
+% ======================================================================
+%> @file PAShapeProjection.m
+%> @brief Low dimensional projection of load shapes for clustering.
+% ======================================================================
+%> @brief PAShapeProjection fits a truncated principal component
+%> projection of a cohort's load shapes with a randomized SVD: the
+%> centered shapes are multiplied by a seeded Gaussian test matrix, a few
+%> power iterations sharpen the captured range, and the SVD of the small
+%> projected matrix gives the leading components.  This costs a handful
+%> of passes over the N x M shapes instead of a full M x M eigen
+%> decomposition.  Shapes are clustered in the K dimensional score space
+%> (K << M) and centroids are mapped back to load shapes afterward.
+% ======================================================================
+classdef PAShapeProjection
+
+    properties(Constant)
+        DEFAULT_OVERSAMPLES = 10;
+        DEFAULT_POWER_ITERATIONS = 2;
+    end
+
+    properties(SetAccess=protected)
+        %> 1xM mean load shape removed before projecting.
+        mu = [];
+        %> MxK orthonormal principal directions.
+        components = [];
+        %> Kx1 singular values of the centered shapes.
+        singularValues = [];
+        %> Kx1 fraction of the total variance explained by each component.
+        explainedVariance = [];
+        %> Seed of the Gaussian test matrix, so a cohort's fit is repeatable.
+        seed = 0;
+    end
+
+    methods
+        % ======================================================================
+        %> @brief Constructor
+        %> @param shapes NxM matrix of N load shapes to fit.
+        %> @param numComponents Number of components (K) to keep.
+        %> @param seed (optional) Random seed.  Default is 0.
+        %> @param oversamples (optional) Extra test vectors.  Default is 10.
+        %> @param powerIterations (optional) Default is 2.
+        %> @retval this Instance of PAShapeProjection
+        % ======================================================================
+        function this = PAShapeProjection(shapes, numComponents, seed, oversamples, powerIterations)
+            if(nargin==0)
+                return;
+            end
+            if(nargin>2 && ~isempty(seed))
+                this.seed = seed;
+            end
+            if(nargin<4 || isempty(oversamples))
+                oversamples = this.DEFAULT_OVERSAMPLES;
+            end
+            if(nargin<5 || isempty(powerIterations))
+                powerIterations = this.DEFAULT_POWER_ITERATIONS;
+            end
+            shapes = double(shapes);
+            [numShapes, numDims] = size(shapes);
+            numComponents = min([numComponents, numShapes, numDims]);
+            numSamples = min(numComponents+oversamples, min(numShapes, numDims));
+
+            this.mu = mean(shapes,1);
+            centered = shapes-this.mu;
+            stream = RandStream('mt19937ar','Seed',this.seed);
+            [Q, ~] = qr(centered*randn(stream,numDims,numSamples),0);
+            for p=1:powerIterations
+                [Q, ~] = qr(centered'*Q,0);
+                [Q, ~] = qr(centered*Q,0);
+            end
+            [~, S, V] = svd(Q'*centered,'econ');
+            s = diag(S);
+            this.components = V(:,1:numComponents);
+            this.singularValues = s(1:numComponents);
+            totalVariance = sum(centered(:).^2);
+            if(totalVariance>0)
+                this.explainedVariance = this.singularValues.^2/totalVariance;
+            else
+                this.explainedVariance = zeros(numComponents,1);
+            end
+        end
+
+        function numComponents = getNumComponents(this)
+            numComponents = size(this.components,2);
+        end
+
+        function numDims = getDimension(this)
+            numDims = size(this.components,1);
+        end
+
+        % ======================================================================
+        %> @brief Scores of load shapes in the projected space.
+        %> @param this Instance of PAShapeProjection
+        %> @param shapes NxM load shapes.
+        %> @retval scores NxK
+        % ======================================================================
+        function scores = project(this, shapes)
+            scores = (double(shapes)-this.mu)*this.components;
+        end
+
+        % ======================================================================
+        %> @brief Load shapes of points (e.g. centroids) in the projected space.
+        %> @param this Instance of PAShapeProjection
+        %> @param scores NxK
+        %> @retval shapes NxM
+        % ======================================================================
+        function shapes = reconstruct(this, scores)
+            shapes = scores*this.components'+this.mu;
+        end
+
+        % ======================================================================
+        %> @brief Plain struct of the projection, for saving to .mat files.
+        % ======================================================================
+        function projectionStruct = toStruct(this)
+            fields = {'mu','components','singularValues','explainedVariance','seed'};
+            projectionStruct = struct();
+            for f=1:numel(fields)
+                projectionStruct.(fields{f}) = this.(fields{f});
+            end
+        end
+    end
+
+    methods(Static)
+        % ======================================================================
+        %> @brief Restores a projection saved with toStruct().
+        % ======================================================================
+        function this = fromStruct(projectionStruct)
+            this = PAShapeProjection();
+            fields = fieldnames(projectionStruct);
+            for f=1:numel(fields)
+                this.(fields{f}) = projectionStruct.(fields{f});
+            end
+        end
+    end
+end
@@ -0,0 +1,171 @@
+% ======================================================================
+%> @file PAStudyLoader.m
+%> @brief Loads raw studies in the background with the asyncload mex file.
+% ======================================================================
+%> @brief PAStudyLoader starts loads of raw .bin files on native worker
+%> threads (see src/studyloader.h) and reports their progress, so the
+%> session stays responsive while a study loads.  A load is decoded,
+%> summarized into an hourly overview (available before the rest of the
+%> load finishes) and classified into usage states.  Loads can be
+%> cancelled, and the next studies of a folder can be prefetched so they
+%> are ready when opened.  Finished loads are picked up by PASensorData
+%> (see loadBackgroundStudy).
+% ======================================================================
+classdef PAStudyLoader < PABase
+
+    properties(Constant)
+        %> Extensions the loader decodes.
+        EXTENSIONS = {'.bin'};
+    end
+
+    properties(SetAccess=protected)
+        %> Full filename of the study last opened, or empty.
+        filename;
+        %> asyncload handle of the study last opened, or empty.
+        handle;
+    end
+
+    methods
+
+        % ======================================================================
+        %> @brief Starts loading a study in the background, closing the
+        %> study opened before it.
+        %> @param this Instance of PAStudyLoader
+        %> @param filename Full filename of a raw .bin file.
+        %> @retval didOpen True if the load was started (or found done).
+        % ======================================================================
+        function didOpen = open(this, filename)
+            didOpen = false;
+            this.close();
+            try
+                this.handle = asyncload('open', filename);
+                this.filename = filename;
+                didOpen = true;
+            catch me
+                this.logError(me,'Could not load %s in the background',filename);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Queues background loads of the studies that follow a file
+        %> in its folder (sorted by name, same extension).
+        %> @param this Instance of PAStudyLoader
+        %> @param filename Full filename of the study being opened.
+        %> @param numNext Number of following studies to prefetch.
+        %> @retval nextFilenames Cell of the full filenames queued.
+        % ======================================================================
+        function nextFilenames = prefetchFolder(this, filename, numNext)
+            nextFilenames = PAStudyLoader.getNextFilenames(filename, numNext);
+            if(~isempty(nextFilenames))
+                try
+                    asyncload('prefetch', nextFilenames);
+                catch me
+                    this.logError(me,'Could not prefetch the studies following %s',filename);
+                end
+            end
+        end
+
+        % ======================================================================
+        %> @brief Status of the study last opened.
+        %> @param this Instance of PAStudyLoader
+        %> @retval status Struct with fields state ('queued', 'decoding',
+        %> 'summarizing', 'classifying', 'done', 'cancelled' or 'failed'),
+        %> progress (0 to 1), hasOverview and message; empty if no study is
+        %> open.
+        % ======================================================================
+        function status = getStatus(this)
+            status = [];
+            if(~isempty(this.handle))
+                status = asyncload('status', this.handle);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Hourly overview of the study last opened.
+        %> @param this Instance of PAStudyLoader
+        %> @retval overview Struct with fields startDatenum, secondsPerBin
+        %> and minimums, maximums and means (one row per bin; columns x, y,
+        %> z and vecMag), or empty until the study is summarized.
+        % ======================================================================
+        function overview = getOverview(this)
+            overview = [];
+            if(~isempty(this.handle))
+                overview = asyncload('overview', this.handle);
+            end
+        end
+
+        function cancel(this)
+            if(~isempty(this.handle))
+                asyncload('cancel', this.handle);
+            end
+        end
+
+        function close(this)
+            if(~isempty(this.handle))
+                try
+                    asyncload('close', this.handle);
+                catch me
+                    showME(me);
+                end
+            end
+            this.handle = [];
+            this.filename = [];
+        end
+
+        function delete(this)
+            this.close();
+        end
+    end
+
+    methods(Static)
+
+        function isIt = isAvailable()
+            isIt = exist('asyncload','file')==3;
+        end
+
+        function canIt = canLoad(filename)
+            [~,~,ext] = fileparts(filename);
+            canIt = PAStudyLoader.isAvailable() && any(strcmpi(ext,PAStudyLoader.EXTENSIONS));
+        end
+
+        % ======================================================================
+        %> @brief Loads a study in the foreground through the background
+        %> loader, so a load already finished (or prefetched) is reused and
+        %> one underway is waited on.
+        %> @param filename Full filename of a raw .bin file.
+        %> @retval study Struct with fields samplerate, startDatenum,
+        %> durationSec, numRecords, serialID, signals (Nx4 single: x, y, z
+        %> and vecMag) and usage (Nx4 int8), or empty if the load was
+        %> cancelled or failed.
+        % ======================================================================
+        function study = fetch(filename)
+            handle = asyncload('open', filename);
+            try
+                study = asyncload('fetch', handle, true);
+            catch me
+                asyncload('close', handle);
+                rethrow(me);
+            end
+            asyncload('close', handle);
+        end
+
+        function nextFilenames = getNextFilenames(filename, numNext)
+            nextFilenames = {};
+            if(numNext<1)
+                return;
+            end
+            [pathname, basename, ext] = fileparts(filename);
+            listing = dir(fullfile(pathname,['*',ext]));
+            listing = listing(~[listing.isdir]);
+            names = sort({listing.name});
+            index = find(strcmp(names,[basename,ext]),1);
+            if(~isempty(index))
+                names = names(index+1:min(index+numNext,end));
+                nextFilenames = fullfile(pathname,names);
+                if(ischar(nextFilenames))
+                    nextFilenames = {nextFilenames};
+                end
+            end
+        end
+    end
+end
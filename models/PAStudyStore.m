@@ -0,0 +1,480 @@
+% ======================================================================
+%> @file PAStudyStore.m
+%> @brief Embedded, file based store of study level data: person-day
+%> cluster membership, nonwear flags, outcomes and covariates.
+% ======================================================================
+%> @brief PAStudyStore keeps the tables PAStatTool joins against in a
+%> single indexed file (see src/columnstore.h for the layout), in place of
+%> a database server.  Tables hold numeric columns and are keyed on
+%> studyID; each is written with an index on studyID, and tables with a
+%> dayOfWeek column get a weekday index as well, so that profile and
+%> membership queries are indexed look ups rather than scans.  Two tables
+%> are used by Padaco:
+%> - @c persondays One row per load shape: studyID, dayOfWeek, cluster
+%> (centroid index) and nonwear.
+%> - @c subjects Outcomes and covariates, one row per study (imported from
+%> the outcomes subjects table, ID_KID becoming studyID).
+%>
+%> The studystore mex file is used when it is compiled; otherwise the file
+%> is read and written here with the same layout.  It can stand in for
+%> the databaseClass of PAStatTool (see getSubjectInfoSummary and
+%> getColumnNames).
+% ======================================================================
+classdef PAStudyStore < PABase
+
+    properties(Constant)
+        MAGIC = 'PASTORE1';
+        VERSION = 1;
+        KEY_NAME = 'studyID';
+        WEEKDAY_NAME = 'dayOfWeek';
+        PERSONDAYS_TABLE = 'persondays';
+        SUBJECTS_TABLE = 'subjects';
+        DEFAULT_FILENAME = 'study.store';
+        %> Name of the outcomes' primary key (see PAOutcomesTableData).
+        OUTCOMES_KEY_NAME = 'ID_KID';
+        SZ_TABLE_NAME = 32;
+        SZ_NAME = 64;
+    end
+
+    properties(SetAccess=protected)
+        filename;
+    end
+
+    properties(Access=protected)
+        %> Tables read by the MATLAB fallback, with the file's datenum and
+        %> bytes they were read from.
+        cachedTables = [];
+        cachedFileInfo = [];
+    end
+
+    methods
+
+        % ======================================================================
+        %> @brief Constructor
+        %> @param filename Study store file.  Default is
+        %> PAStudyStore.DEFAULT_FILENAME in the current directory.
+        %> @retval this Instance of PAStudyStore
+        % ======================================================================
+        function this = PAStudyStore(filename)
+            if(nargin<1 || isempty(filename))
+                filename = PAStudyStore.DEFAULT_FILENAME;
+            end
+            this.filename = filename;
+        end
+
+        function doesIt = exists(this)
+            doesIt = exist(this.filename,'file')==2;
+        end
+
+        % ======================================================================
+        %> @brief Writes tables to the store, replacing its contents.
+        %> @param this Instance of PAStudyStore
+        %> @param tables Struct whose fields are tables; each table is a
+        %> struct of equal length numeric column vectors including studyID.
+        %> @retval didWrite True on success
+        % ======================================================================
+        function didWrite = write(this, tables)
+            didWrite = false;
+            try
+                tableNames = fieldnames(tables);
+                for t=1:numel(tableNames)
+                    columnNames = fieldnames(tables.(tableNames{t}));
+                    for c=1:numel(columnNames)
+                        tables.(tableNames{t}).(columnNames{c}) = double(tables.(tableNames{t}).(columnNames{c})(:));
+                    end
+                end
+                if(exist('studystore','file')==3)
+                    studystore('write',this.filename,tables);
+                else
+                    PAStudyStore.writeStoreFile(this.filename,tables);
+                end
+                this.cachedTables = [];
+                didWrite = true;
+            catch me
+                this.logError(me,'Could not write study store %s',this.filename);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Replaces the persondays table with the load shapes of a
+        %> cluster and, when given, the subjects table with outcomes.
+        %> Tables not given are kept.
+        %> @param this Instance of PAStudyStore
+        %> @param clusterObj Instance of PACluster
+        %> @param outcomesTable Optional table of outcomes keyed by ID_KID
+        %> (e.g. PAOutcomesTableData subjects).  Non numeric columns are
+        %> left out.
+        %> @retval didUpdate True on success
+        % ======================================================================
+        function didUpdate = update(this, clusterObj, outcomesTable)
+            tables = struct();
+            if(this.exists())
+                try
+                    tables = PAStudyStore.getColumnStructs(this.readTables());
+                catch me
+                    this.logError(me,'Could not read %s; it will be replaced',this.filename);
+                end
+            end
+            if(~isempty(clusterObj))
+                covariateMat = clusterObj.getCovariateMat();
+                personDays.(this.KEY_NAME) = covariateMat(:,1);
+                personDays.(this.WEEKDAY_NAME) = covariateMat(:,2);
+                personDays.cluster = covariateMat(:,3);
+                nonwearRows = clusterObj.nonwearRows;
+                if(isempty(nonwearRows))
+                    nonwearRows = false(size(personDays.cluster));
+                end
+                personDays.nonwear = nonwearRows;
+                tables.(this.PERSONDAYS_TABLE) = personDays;
+            end
+            if(nargin>2 && istable(outcomesTable) && ismember(this.OUTCOMES_KEY_NAME,outcomesTable.Properties.VariableNames))
+                subjects.(this.KEY_NAME) = outcomesTable.(this.OUTCOMES_KEY_NAME);
+                variableNames = setdiff(outcomesTable.Properties.VariableNames,this.OUTCOMES_KEY_NAME,'stable');
+                for v=1:numel(variableNames)
+                    values = outcomesTable.(variableNames{v});
+                    if((isnumeric(values) || islogical(values)) && isvector(values))
+                        subjects.(variableNames{v}) = values;
+                    end
+                end
+                tables.(this.SUBJECTS_TABLE) = subjects;
+            end
+            didUpdate = this.write(tables);
+        end
+
+        % ======================================================================
+        %> @brief Column names of a table.  subjectinfo_t and subjectInfo_t
+        %> (database table names) refer to the subjects table, less its key.
+        %> @param this Instance of PAStudyStore
+        %> @param tableName Name of the table
+        %> @retval columnNames Cell of column names; empty when the table
+        %> is not in the store.
+        % ======================================================================
+        function columnNames = getColumnNames(this, tableName)
+            columnNames = {};
+            isSubjectInfo = strcmpi(tableName,'subjectinfo_t');
+            if(isSubjectInfo)
+                tableName = this.SUBJECTS_TABLE;
+            end
+            if(this.exists())
+                try
+                    if(exist('studystore','file')==3)
+                        columnNames = studystore('columns',this.filename,tableName);
+                    else
+                        tables = this.readTables();
+                        columnNames = tables.(tableName).columnNames;
+                    end
+                catch me
+                    this.logError(me,'Could not read the columns of %s from %s',tableName,this.filename);
+                end
+            end
+            if(isSubjectInfo)
+                columnNames = setdiff(columnNames,this.KEY_NAME,'stable');
+            end
+            columnNames = columnNames(:)';
+        end
+
+        % ======================================================================
+        %> @brief Subject outcomes and covariates for the given study IDs,
+        %> joined through the subjects table's studyID index.
+        %> @param this Instance of PAStudyStore
+        %> @param primaryKeys Study IDs
+        %> @param fieldNames Column name or cell of column names
+        %> @param stat Optional statistic to calculate for each field:
+        %> 'AVG', 'MIN', 'MAX', 'SUM', 'STD' or 'COUNT'.
+        %> @retval dataSummaryStruct summarizeStruct of dataStruct
+        %> @retval statStruct Field names with stat of each, or an empty
+        %> struct when stat is not given.
+        %> @retval dataStruct Field names with the values for each study ID
+        %> found (study IDs without a row are left out).
+        % ======================================================================
+        function [dataSummaryStruct, statStruct, dataStruct] = getSubjectInfoSummary(this, primaryKeys, fieldNames, stat)
+            if(nargin<4)
+                stat = [];
+            end
+            if(~iscell(fieldNames))
+                fieldNames = {fieldNames};
+            end
+            values = this.join(this.SUBJECTS_TABLE,primaryKeys,[{this.KEY_NAME},fieldNames(:)']);
+            values = values(~isnan(values(:,1)),2:end);
+            dataStruct = struct();
+            statStruct = struct();
+            for f=1:numel(fieldNames)
+                dataStruct.(fieldNames{f}) = values(:,f);
+                if(~isempty(stat))
+                    statStruct.(fieldNames{f}) = PAStudyStore.calcStat(values(:,f),stat);
+                end
+            end
+            if(isempty(fieldNames))
+                dataSummaryStruct = [];
+            else
+                dataSummaryStruct = summarizeStruct(dataStruct);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Values of the named columns at the first row of each study
+        %> ID given.
+        %> @param this Instance of PAStudyStore
+        %> @param tableName Name of the table
+        %> @param keys Nx1 study IDs
+        %> @param columnNames Cell of M column names
+        %> @retval values NxM values; NaN where a study ID has no row.
+        % ======================================================================
+        function values = join(this, tableName, keys, columnNames)
+            keys = double(keys(:));
+            if(exist('studystore','file')==3)
+                values = studystore('join',this.filename,tableName,keys,columnNames);
+            else
+                tables = this.readTables();
+                table = tables.(tableName);
+                [isColumn, columnIndices] = ismember(columnNames,table.columnNames);
+                if(~all(isColumn))
+                    throw(MException('PA:StudyStore:Column','Table %s has no column named %s',tableName,strjoin(columnNames(~isColumn),', ')));
+                end
+                values = nan(numel(keys),numel(columnNames));
+                [isFound, keyIndices] = ismember(keys,table.keys);
+                firstRows = table.keyRows(table.runStarts(keyIndices(isFound))+1)+1;
+                values(isFound,:) = table.columns(firstRows,columnIndices);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Number of person-days each study spent in each cluster,
+        %> counted through the persondays table's indexes.
+        %> @param this Instance of PAStudyStore
+        %> @param numClusters Number of clusters (columns of counts)
+        %> @param keys Study IDs to count, or [] for all studies in the store.
+        %> @param weekdays Days of the week to include (0 to 6).  Default
+        %> is all.
+        %> @param excludeNonwear When true, person-days flagged as nonwear
+        %> are not counted.  Default is false.
+        %> @retval counts NxnumClusters counts for each study ID.
+        %> @retval keys Nx1 study IDs of counts' rows.
+        % ======================================================================
+        function [counts, keys] = getMembershipCounts(this, numClusters, keys, weekdays, excludeNonwear)
+            if(nargin<3)
+                keys = [];
+            end
+            if(nargin<4 || isempty(weekdays))
+                weekdays = 0:6;
+            end
+            if(nargin<5)
+                excludeNonwear = false;
+            end
+            if(exist('studystore','file')==3)
+                [counts, keys] = studystore('memberships',this.filename,numClusters,double(keys(:)),double(weekdays),excludeNonwear);
+            else
+                tables = this.readTables();
+                table = tables.(this.PERSONDAYS_TABLE);
+                if(isempty(keys))
+                    keys = table.keys;
+                end
+                keys = double(keys(:));
+                % rows of the selected days from the weekday index
+                weekdays = unique(weekdays(weekdays>=0 & weekdays<=6));
+                if(isempty(table.weekdayStarts))
+                    rows = table.keyRows+1;
+                else
+                    rows = cell(numel(weekdays),1);
+                    for d=1:numel(weekdays)
+                        rows{d} = table.weekdayRows(table.weekdayStarts(weekdays(d)+1)+1:table.weekdayStarts(weekdays(d)+2))+1;
+                    end
+                    rows = cell2mat(rows);
+                end
+                clusters = table.columns(rows,strcmp(table.columnNames,'cluster'));
+                isCounted = clusters>=1 & clusters<=numClusters;
+                if(excludeNonwear)
+                    isCounted = isCounted & table.columns(rows,strcmp(table.columnNames,'nonwear'))==0;
+                end
+                [isFound, keyRows] = ismember(table.columns(rows,table.keyColumn),keys);
+                isCounted = isCounted & isFound;
+                counts = accumarray([keyRows(isCounted),clusters(isCounted)],1,[numel(keys),numClusters]);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Reads every table of the store (MATLAB fallback), reusing
+        %> the last read while the file is unchanged.
+        %> @retval tables Struct of tables, each with fields columnNames,
+        %> columns (numRows x numColumns), keyColumn (1 based), keys,
+        %> runStarts, keyRows, weekdayStarts and weekdayRows (0 based, as
+        %> stored).
+        % ======================================================================
+        function tables = readTables(this)
+            fileInfo = dir(this.filename);
+            if(isempty(fileInfo))
+                throw(MException('PA:StudyStore:Missing','Study store not found (%s)',this.filename));
+            end
+            if(isempty(this.cachedTables) || fileInfo.datenum~=this.cachedFileInfo.datenum || fileInfo.bytes~=this.cachedFileInfo.bytes)
+                this.cachedTables = PAStudyStore.readStoreFile(this.filename);
+                this.cachedFileInfo = fileInfo;
+            end
+            tables = this.cachedTables;
+        end
+    end
+
+    methods(Static)
+
+        function value = calcStat(values, stat)
+            values = values(~isnan(values));
+            switch(upper(stat))
+                case 'AVG'
+                    value = mean(values);
+                case 'MIN'
+                    value = min(values);
+                case 'MAX'
+                    value = max(values);
+                case 'SUM'
+                    value = sum(values);
+                case 'STD'
+                    value = std(values);
+                case 'COUNT'
+                    value = numel(values);
+                otherwise
+                    throw(MException('PA:StudyStore:Stat','Unsupported statistic (%s)',stat));
+            end
+        end
+
+        % ======================================================================
+        %> @brief Writes tables with their indexes (MATLAB fallback for
+        %> the studystore mex file).
+        % ======================================================================
+        function writeStoreFile(filename, tables)
+            tableNames = fieldnames(tables);
+            fid = fopen(filename,'w','native');
+            if(fid<0)
+                throw(MException('PA:StudyStore:Write','Could not open %s for writing',filename));
+            end
+            try
+                fwrite(fid,PAStudyStore.MAGIC,'char*1');
+                fwrite(fid,[PAStudyStore.VERSION,numel(tableNames)],'uint32');
+                for t=1:numel(tableNames)
+                    table = tables.(tableNames{t});
+                    columnNames = fieldnames(table);
+                    columns = cellfun(@(name)table.(name),columnNames,'uniformoutput',false);
+                    columns = [columns{:}];
+                    numColumns = numel(columnNames);
+                    numRows = size(columns,1);
+                    keyColumn = find(strcmp(columnNames,PAStudyStore.KEY_NAME));
+                    weekdayColumn = find(strcmp(columnNames,PAStudyStore.WEEKDAY_NAME));
+                    if(isempty(keyColumn))
+                        throw(MException('PA:StudyStore:Key','Table %s needs a %s column',tableNames{t},PAStudyStore.KEY_NAME));
+                    end
+
+                    % key index: stable sort by key, NaN keys left out
+                    keyValues = columns(:,keyColumn);
+                    [sortedKeys, keyRows] = sort(keyValues);
+                    keyRows = keyRows(~isnan(sortedKeys));
+                    sortedKeys = sortedKeys(~isnan(sortedKeys));
+                    [keys, runStarts] = unique(sortedKeys,'first');
+                    runStarts = [runStarts(:)-1; numel(sortedKeys)];
+
+                    dataOffset = ftell(fid)+72+numColumns*PAStudyStore.SZ_NAME;
+                    fwrite(fid,PAStudyStore.padName(tableNames{t},PAStudyStore.SZ_TABLE_NAME),'char*1');
+                    fwrite(fid,numRows,'uint64');
+                    fwrite(fid,numColumns,'uint32');
+                    if(isempty(weekdayColumn))
+                        fwrite(fid,[keyColumn-1,-1],'int32');
+                    else
+                        fwrite(fid,[keyColumn-1,weekdayColumn-1],'int32');
+                    end
+                    fwrite(fid,0,'uint32');
+                    fwrite(fid,[numel(keys),dataOffset],'uint64');
+                    for c=1:numColumns
+                        fwrite(fid,PAStudyStore.padName(columnNames{c},PAStudyStore.SZ_NAME),'char*1');
+                    end
+                    fwrite(fid,columns,'double');
+                    fwrite(fid,keys,'double');
+                    fwrite(fid,runStarts,'uint64');
+                    fwrite(fid,keyRows-1,'uint32');
+                    if(~isempty(weekdayColumn))
+                        days = columns(:,weekdayColumn);
+                        weekdayRows = find(days>=0 & days<=6 & days==fix(days));
+                        [~, order] = sort(days(weekdayRows));
+                        weekdayRows = weekdayRows(order);
+                        weekdayStarts = [0; cumsum(accumarray(days(weekdayRows)+1,1,[7,1]))];
+                        fwrite(fid,weekdayStarts,'uint64');
+                        fwrite(fid,weekdayRows-1,'uint32');
+                    end
+                end
+                fclose(fid);
+            catch me
+                fclose(fid);
+                rethrow(me);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Reads every table and index of a study store (MATLAB
+        %> fallback for the studystore mex file).  See readTables.
+        % ======================================================================
+        function tables = readStoreFile(filename)
+            fid = fopen(filename,'r','native');
+            if(fid<0)
+                throw(MException('PA:StudyStore:Read','Could not open %s',filename));
+            end
+            try
+                magic = fread(fid,[1,8],'char*1=>char');
+                header = fread(fid,2,'uint32');
+                if(~strcmp(magic,PAStudyStore.MAGIC) || numel(header)<2 || header(1)~=PAStudyStore.VERSION)
+                    throw(MException('PA:StudyStore:Format','%s is not a study store',filename));
+                end
+                tables = struct();
+                for t=1:header(2)
+                    tableName = PAStudyStore.unpadName(fread(fid,[1,PAStudyStore.SZ_TABLE_NAME],'char*1=>char'));
+                    numRows = fread(fid,1,'uint64');
+                    numColumns = fread(fid,1,'uint32');
+                    indexColumns = fread(fid,2,'int32');
+                    fread(fid,1,'uint32');
+                    numKeys = fread(fid,1,'uint64');
+                    dataOffset = fread(fid,1,'uint64');
+                    table.columnNames = cell(1,numColumns);
+                    for c=1:numColumns
+                        table.columnNames{c} = PAStudyStore.unpadName(fread(fid,[1,PAStudyStore.SZ_NAME],'char*1=>char'));
+                    end
+                    fseek(fid,dataOffset,'bof');
+                    table.columns = fread(fid,[numRows,numColumns],'double');
+                    table.keyColumn = indexColumns(1)+1;
+                    table.keys = fread(fid,numKeys,'double');
+                    table.runStarts = fread(fid,numKeys+1,'uint64');
+                    table.keyRows = fread(fid,table.runStarts(end),'uint32');
+                    if(indexColumns(2)>=0)
+                        table.weekdayStarts = fread(fid,8,'uint64');
+                        table.weekdayRows = fread(fid,table.weekdayStarts(end),'uint32');
+                    else
+                        table.weekdayStarts = [];
+                        table.weekdayRows = [];
+                    end
+                    tables.(tableName) = table;
+                end
+                fclose(fid);
+            catch me
+                fclose(fid);
+                rethrow(me);
+            end
+        end
+
+        %> @brief Converts tables as read (see readTables) to the structs
+        %> of column vectors that write takes.
+        function columnStructs = getColumnStructs(tables)
+            columnStructs = struct();
+            tableNames = fieldnames(tables);
+            for t=1:numel(tableNames)
+                table = tables.(tableNames{t});
+                for c=1:numel(table.columnNames)
+                    columnStructs.(tableNames{t}).(table.columnNames{c}) = table.columns(:,c);
+                end
+            end
+        end
+
+        function padded = padName(name, numChars)
+            padded = zeros(1,numChars);
+            numChars = min(numel(name),numChars-1);
+            padded(1:numChars) = double(name(1:numChars));
+        end
+
+        function name = unpadName(padded)
+            name = strtok(padded,char(0));
+        end
+    end
+end
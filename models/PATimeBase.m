@@ -0,0 +1,291 @@
+% ======================================================================
+%> @file PATimeBase.m
+%> @brief Implicit time axis for regularly sampled recordings.
+% ======================================================================
+%> @brief PATimeBase maps sample indices to time and back without storing
+%> a timestamp per sample.  A recording is described by an integer start
+%> epoch, an exact rational sample period, the gaps where no samples were
+%> recorded, and the time zone rules of the device clock.  Sample times
+%> are counted in ticks (whole sample periods) from the start epoch, so
+%> index to time conversion is O(1) without gaps and O(log gaps) with
+%> them, and datenum vectors are only generated for the indices asked
+%> for.
+%>
+%> Times are wall clock times as the device recorded them, which is what
+%> the datenums elsewhere in Padaco hold.  The time zone rules are only
+%> used to convert to UTC.
+% ======================================================================
+classdef PATimeBase
+
+    properties(Constant)
+        %> MATLAB datenum of 01-Jan-1970 00:00:00
+        DATENUM_1970 = 719529;
+        SECONDS_PER_DAY = 86400;
+    end
+
+    properties(SetAccess=protected)
+        %> Wall clock seconds since 01-Jan-1970 of the whole second at or before the first sample.
+        startEpoch = int64(0);
+        %> Ticks from startEpoch to the first sample, for recordings that do not start on a whole second.
+        startTick = 0;
+        %> Sample period in seconds is periodNum/periodDen exactly.
+        periodNum = 1;
+        periodDen = 1;
+        %> Number of samples in the recording.
+        numSamples = 0;
+        %> Nx2 [sampleIndex, missingTicks] sorted by sampleIndex; missingTicks
+        %> sample periods are missing just before sampleIndex.
+        gaps = zeros(0,2);
+        %> Standard offset of the device clock from UTC, in seconds.
+        utcOffsetSec = 0;
+        %> Mx2 [wallclockEpoch, offsetSec] sorted by wallclockEpoch; from
+        %> wallclockEpoch onwards the clock runs offsetSec ahead of UTC
+        %> (e.g. daylight savings transitions).
+        dstRules = zeros(0,2);
+    end
+
+    properties(Access=protected)
+        %> gaps(:,1) and the cumulative missing ticks after each gap, kept
+        %> for the binary searches.
+        gapSamples = zeros(0,1);
+        gapTicks = zeros(0,1);
+        %> Tick of the first sample after each gap.
+        gapStartTicks = zeros(0,1);
+    end
+
+    methods
+        % ======================================================================
+        %> @brief Constructor
+        %> @param startDatenum Datenum of the first sample.
+        %> @param sampleRate Samples per second.  A period given as a
+        %> 1x2 [numerator, denominator] in seconds is also accepted.
+        %> @param numSamples Number of samples.
+        %> @param gaps (optional) Nx2 [sampleIndex, missingTicks]; see gaps property.
+        %> @retval this Instance of PATimeBase
+        % ======================================================================
+        function this = PATimeBase(startDatenum, sampleRate, numSamples, gaps)
+            if(nargin==0)
+                return;
+            end
+            if(numel(sampleRate)==2)
+                this.periodNum = sampleRate(1);
+                this.periodDen = sampleRate(2);
+            else
+                % rat gives exact fractions for the rates devices use (e.g. 30, 40, 80, 1/60 Hz)
+                [this.periodNum, this.periodDen] = rat(1/sampleRate);
+            end
+            startSec = (startDatenum-this.DATENUM_1970)*this.SECONDS_PER_DAY;
+            % datenums only resolve ~10 microseconds, so round to the millisecond first
+            startSec = round(startSec*1000)/1000;
+            this.startEpoch = int64(floor(startSec));
+            this.startTick = round((startSec-floor(startSec))*this.periodDen/this.periodNum);
+            this.numSamples = numSamples;
+            if(nargin>3 && ~isempty(gaps))
+                this = this.setGaps(gaps);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Sets the number of samples, e.g. as a recording that is
+        %> still being written grows.
+        %> @param this Instance of PATimeBase
+        %> @param numSamples Number of samples.
+        %> @retval this Instance of PATimeBase
+        % ======================================================================
+        function this = setNumSamples(this, numSamples)
+            this.numSamples = numSamples;
+        end
+
+        % ======================================================================
+        %> @brief Sets the gaps of the recording.
+        %> @param this Instance of PATimeBase
+        %> @param gaps Nx2 [sampleIndex, missingTicks]
+        %> @retval this Instance of PATimeBase
+        % ======================================================================
+        function this = setGaps(this, gaps)
+            gaps = sortrows(gaps(gaps(:,2)>0,:),1);
+            this.gaps = gaps;
+            this.gapSamples = gaps(:,1);
+            this.gapTicks = cumsum(gaps(:,2));
+            this.gapStartTicks = this.startTick+this.gapSamples-1+this.gapTicks;
+        end
+
+        % ======================================================================
+        %> @brief Sets the time zone rules used for UTC conversion.
+        %> @param this Instance of PATimeBase
+        %> @param utcOffsetSec Standard offset from UTC in seconds (e.g. -8*3600 for PST).
+        %> @param dstRules (optional) Mx2 [wallclockDatenum, offsetSec] transitions.
+        %> @retval this Instance of PATimeBase
+        % ======================================================================
+        function this = setTimeZone(this, utcOffsetSec, dstRules)
+            this.utcOffsetSec = utcOffsetSec;
+            if(nargin>2 && ~isempty(dstRules))
+                dstRules(:,1) = round((dstRules(:,1)-this.DATENUM_1970)*this.SECONDS_PER_DAY);
+                this.dstRules = sortrows(dstRules,1);
+            else
+                this.dstRules = zeros(0,2);
+            end
+        end
+
+        % ======================================================================
+        %> @brief Sample rate in samples per second.
+        % ======================================================================
+        function sampleRate = getSampleRate(this)
+            sampleRate = this.periodDen/this.periodNum;
+        end
+
+        % ======================================================================
+        %> @brief Ticks (sample periods) from startEpoch for the sample indices given.
+        %> @param this Instance of PATimeBase
+        %> @param sampleIndices Indices (1-based) of samples.
+        %> @retval ticks Same size as sampleIndices.
+        % ======================================================================
+        function ticks = sample2tick(this, sampleIndices)
+            ticks = this.startTick+sampleIndices-1;
+            if(~isempty(this.gapSamples))
+                gapIndex = this.findLast(this.gapSamples, sampleIndices);
+                hasGap = gapIndex>0;
+                ticks(hasGap) = ticks(hasGap)+this.gapTicks(gapIndex(hasGap));
+            end
+        end
+
+        % ======================================================================
+        %> @brief Sample indices for the ticks given.
+        %> @param this Instance of PATimeBase
+        %> @param ticks Ticks from startEpoch (whole numbers).
+        %> @retval sampleIndices Index of the sample at each tick, or of
+        %> the last sample before it when the tick falls in a gap.
+        %> @retval isSample True where the tick holds a sample.
+        % ======================================================================
+        function [sampleIndices, isSample] = tick2sample(this, ticks)
+            sampleIndices = ticks-this.startTick+1;
+            isSample = true(size(ticks));
+            if(~isempty(this.gapSamples))
+                gapIndex = this.findLast(this.gapStartTicks, ticks);
+                hasGap = gapIndex>0;
+                sampleIndices(hasGap) = ticks(hasGap)-this.gapStartTicks(gapIndex(hasGap))+this.gapSamples(gapIndex(hasGap));
+                % ticks before a gap's first sample but after the previous segment fall in that gap
+                nextGap = min(gapIndex+1,numel(this.gapSamples));
+                inGap = gapIndex<numel(this.gapSamples) & sampleIndices>=this.gapSamples(nextGap);
+                sampleIndices(inGap) = this.gapSamples(nextGap(inGap))-1;
+                isSample(inGap) = false;
+            end
+            isSample = isSample & sampleIndices>=1 & sampleIndices<=this.numSamples;
+        end
+
+        % ======================================================================
+        %> @brief Datenums of the sample indices given, generated on demand.
+        %> @param this Instance of PATimeBase
+        %> @param sampleIndices (optional) Indices (1-based).  Default is all samples.
+        %> @retval dateNum Datenums, same size as sampleIndices (column vector by default).
+        % ======================================================================
+        function dateNum = sample2datenum(this, sampleIndices)
+            if(nargin<2)
+                sampleIndices = (1:this.numSamples)';
+            end
+            ticks = this.sample2tick(sampleIndices);
+            % whole seconds and the remaining ticks are added separately to keep the seconds exact
+            wholeSec = floor(ticks*this.periodNum/this.periodDen);
+            fractionSec = (ticks*this.periodNum-wholeSec*this.periodDen)/this.periodDen;
+            dateNum = this.DATENUM_1970+(double(this.startEpoch)+wholeSec)/this.SECONDS_PER_DAY+fractionSec/this.SECONDS_PER_DAY;
+        end
+
+        % ======================================================================
+        %> @brief Sample indices for the datenums given.
+        %> @param this Instance of PATimeBase
+        %> @param dateNum Datenums
+        %> @param roundingMode (optional) @c nearest (default), @c floor or @c ceil
+        %> applied to fractions of a sample period.
+        %> @retval sampleIndices Index of the sample at (or last sample before) each datenum.
+        %> @retval isSample True where a sample was recorded at that time.
+        % ======================================================================
+        function [sampleIndices, isSample] = datenum2sample(this, dateNum, roundingMode)
+            if(nargin<3)
+                roundingMode = 'nearest';
+            end
+            ticks = this.datenum2tick(dateNum, roundingMode);
+            [sampleIndices, isSample] = this.tick2sample(ticks);
+        end
+
+        % ======================================================================
+        %> @brief Seconds elapsed since the first sample for the datenums given,
+        %> rounded to whole sample periods.
+        % ======================================================================
+        function elapsedSec = datenum2elapsedSec(this, dateNum)
+            elapsedSec = (this.datenum2tick(dateNum,'nearest')-this.startTick)*this.periodNum/this.periodDen;
+        end
+
+        % ======================================================================
+        %> @brief Start and stop datenums (first and last sample).
+        % ======================================================================
+        function startStop = getStartStopDatenum(this)
+            startStop = this.sample2datenum([1, max(this.numSamples,1)]);
+        end
+
+        % ======================================================================
+        %> @brief Index of the first sample at or after the given hour of the day.
+        %> @param this Instance of PATimeBase
+        %> @param hourOfDay Hour of the day (e.g. 0 for midnight, 7.5 for 07:30).
+        %> @retval sampleIndex First sample at or after that time of day; may
+        %> be larger than numSamples for short recordings.
+        % ======================================================================
+        function sampleIndex = getAlignedSample(this, hourOfDay)
+            firstDatenum = this.sample2datenum(1);
+            alignedDatenum = floor(firstDatenum)+hourOfDay/24;
+            if(this.datenum2tick(alignedDatenum,'ceil')<this.startTick)
+                alignedDatenum = alignedDatenum+1;
+            end
+            [sampleIndex, isSample] = this.datenum2sample(alignedDatenum,'ceil');
+            if(~isSample && sampleIndex<this.numSamples)
+                sampleIndex = sampleIndex+1;
+            end
+        end
+
+        % ======================================================================
+        %> @brief UTC datenums of the sample indices given, using the time
+        %> zone rules set with setTimeZone.
+        % ======================================================================
+        function utcDatenum = sample2utcDatenum(this, sampleIndices)
+            dateNum = this.sample2datenum(sampleIndices);
+            offsetSec = repmat(this.utcOffsetSec,size(dateNum));
+            if(~isempty(this.dstRules))
+                wallclock = floor((dateNum-this.DATENUM_1970)*this.SECONDS_PER_DAY+0.5);
+                ruleIndex = this.findLast(this.dstRules(:,1), wallclock);
+                hasRule = ruleIndex>0;
+                offsetSec(hasRule) = this.dstRules(ruleIndex(hasRule),2);
+            end
+            utcDatenum = dateNum-offsetSec/this.SECONDS_PER_DAY;
+        end
+    end
+
+    methods(Access=protected)
+        function ticks = datenum2tick(this, dateNum, roundingMode)
+            elapsedSec = (dateNum-this.DATENUM_1970)*this.SECONDS_PER_DAY-double(this.startEpoch);
+            exactTicks = elapsedSec*this.periodDen/this.periodNum;
+            % datenums of recent dates resolve ~10 microseconds, so times
+            % within 20 microseconds (and at least 1e-3 ticks) of a tick are
+            % taken to be on it
+            tolerance = min(0.499, max(1e-3, 2e-5*this.periodDen/this.periodNum));
+            switch(lower(roundingMode))
+                case 'floor'
+                    ticks = floor(exactTicks+tolerance);
+                case 'ceil'
+                    ticks = ceil(exactTicks-tolerance);
+                otherwise
+                    ticks = round(exactTicks);
+            end
+        end
+    end
+
+    methods(Static, Access=protected)
+        % Index of the last element of sortedValues that is <= each value, or 0.
+        function index = findLast(sortedValues, values)
+            index = zeros(size(values));
+            if(isempty(sortedValues))
+                return;
+            end
+            index(:) = discretize(values(:),[sortedValues(:);inf]);
+            index(isnan(index)) = 0;
+        end
+    end
+end
@@ -0,0 +1,79 @@
+/*
+ * assigncentroids.c - assigns load shapes to the nearest frozen centroid of a saved cluster
+ * model (see nearestcentroid.h).  Used by PAClusterModel.
+ *
+ * The calling syntax is:
+ *
+ *		[idx, distances] = assigncentroids(loadShapes, centroids, distanceMetric)
+ *
+ * loadShapes is an N x M double matrix and centroids a K x M double matrix.
+ * distanceMetric is one of 'sqeuclidean', 'cityblock', 'cosine', 'correlation' or
+ * 'hamming', as used by kmeans.  idx is the N x 1 (1 based) index of each shape's nearest
+ * centroid and distances the N x 1 distance to it.  Shapes of zero length under 'cosine' or
+ * 'correlation' have no nearest centroid: their idx and distance are NaN, with a warning
+ * giving how many there are.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O assigncentroids.c nearestcentroid.c in_parallel.c
+ */
+
+#include "mex.h"
+#include "nearestcentroid.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * metricName;
+    centroid_metric_t metric;
+    unsigned int numShapes, numDims, numCentroids, numUnassigned, n;
+    uint32_t * assignments;
+    double * idx, * distances = NULL;
+
+    if(nrhs != 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:assigncentroids:nrhs",
+                "Load shapes, centroids and a distance metric are required.");
+    }
+    if(nlhs > 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:assigncentroids:nlhs",
+                "At most two outputs are produced.");
+    }
+    if(!mxIsDouble(prhs[0]) || !mxIsDouble(prhs[1])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:assigncentroids:notDouble",
+                "Load shapes and centroids must be double matrices.");
+    }
+    numShapes = (unsigned int)mxGetM(prhs[0]);
+    numDims = (unsigned int)mxGetN(prhs[0]);
+    numCentroids = (unsigned int)mxGetM(prhs[1]);
+    if(mxGetN(prhs[1]) != numDims || numCentroids == 0) {
+        mexErrMsgIdAndTxt("PadacoToolbox:assigncentroids:dims",
+                "Centroids must have as many columns (%u) as the load shapes.", numDims);
+    }
+    metricName = mxArrayToString(prhs[2]);
+    metric = metricName==NULL ? CENTROID_UNKNOWN : getCentroidMetric(metricName);
+    mxFree(metricName);
+    if(metric == CENTROID_UNKNOWN) {
+        mexErrMsgIdAndTxt("PadacoToolbox:assigncentroids:metric",
+                "Unsupported distance metric.");
+    }
+
+    plhs[0] = mxCreateDoubleMatrix(numShapes, 1, mxREAL);
+    if(nlhs > 1) {
+        plhs[1] = mxCreateDoubleMatrix(numShapes, 1, mxREAL);
+        distances = mxGetPr(plhs[1]);
+    }
+    assignments = mxMalloc((numShapes+1)*sizeof(uint32_t));
+    assignNearestCentroids(mxGetPr(prhs[0]), numShapes, numDims, mxGetPr(prhs[1]), numCentroids, metric,
+                           assignments, distances, 0, &numUnassigned);
+    idx = mxGetPr(plhs[0]);
+    for(n=0; n<numShapes; n++) {
+        idx[n] = assignments[n]==CENTROID_UNASSIGNED ? mxGetNaN() : assignments[n]+1;
+    }
+    mxFree(assignments);
+    if(numUnassigned > 0) {
+        mexWarnMsgIdAndTxt("PadacoToolbox:assigncentroids:zeroLength",
+                "%u load shapes have zero length under the %s metric and were not assigned.",
+                numUnassigned, CENTROID_METRIC_NAMES[metric]);
+    }
+}
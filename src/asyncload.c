@@ -0,0 +1,224 @@
+/*
+ * asyncload.c - loads raw studies in the background (see studyloader.h) so the caller can
+ * show progress and an hourly overview while a study loads, cancel it, and have the next
+ * studies of a folder prefetched.
+ *
+ * The calling syntax is:
+ *
+ *		handle = asyncload('open', filename)
+ *		asyncload('prefetch', filenames)
+ *		status = asyncload('status', handle)
+ *		overview = asyncload('overview', handle)
+ *		study = asyncload('fetch', handle, wait)
+ *		asyncload('cancel', handle)
+ *		asyncload('close', handle)
+ *		asyncload('shutdown')
+ *
+ * filename is a Padaco .bin or ActiGraph raw .csv file and filenames a cell of them.
+ * status is a struct with fields state ('queued', 'decoding', 'summarizing',
+ * 'classifying', 'done', 'cancelled' or 'failed'), progress (0 to 1), hasOverview and
+ * message.  overview is empty until the study is summarized; then a struct with fields
+ * startDatenum, secondsPerBin and minimums, maximums and means (single, one row per bin and
+ * four columns: x, y, z and vecMag).  study is empty if the load is not done (wait defaults
+ * to true, which blocks until it finishes); otherwise a struct with fields samplerate,
+ * startDatenum, durationSec, numRecords, serialID, signals (single) and usage (int8, the
+ * default PAClassifyGravities rules), each with the four columns above.  Handles must be
+ * closed; a closed load that was not cancelled finishes and is kept like a prefetch.
+ * 'shutdown' cancels every load and lets the mex file be cleared.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O asyncload.c studyloader.c classifyusage.c prefilter.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "studyloader.h"
+
+#define MAX_LOAD_HANDLES 256
+#define MAX_KEPT_STUDIES 4
+#define SZ_COMMAND 16
+
+static const char * STATUS_FIELDS[] = {"state","progress","hasOverview","message"};
+static const char * OVERVIEW_FIELDS[] = {"startDatenum","secondsPerBin","minimums","maximums","means"};
+static const char * STUDY_FIELDS[] = {"samplerate","startDatenum","durationSec","numRecords","serialID","signals","usage"};
+
+static study_loader_t * loader = NULL;
+static loaded_study_t * handles[MAX_LOAD_HANDLES];
+
+static void shutdownLoader(void){
+    unsigned int h;
+    if(loader!=NULL){
+        for(h=0;h<MAX_LOAD_HANDLES;h++){
+            handles[h] = NULL;
+        }
+        freeStudyLoader(loader);
+        loader = NULL;
+        mexUnlock();
+    }
+}
+
+static study_loader_t * getLoader(void){
+    if(loader==NULL){
+        loader = createStudyLoader(0,MAX_KEPT_STUDIES);
+        // worker threads run in the background, so the mex file must stay loaded
+        mexLock();
+        mexAtExit(shutdownLoader);
+    }
+    return loader;
+}
+
+static unsigned int getHandle(int nrhs, const mxArray *prhs[]){
+    double value = nrhs>1 && mxIsNumeric(prhs[1]) && mxGetNumberOfElements(prhs[1])==1 ? mxGetScalar(prhs[1]) : 0;
+    if(value<1 || value>MAX_LOAD_HANDLES || value!=(unsigned int)value || loader==NULL || handles[(unsigned int)value-1]==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:asyncload:handle",
+                "Invalid or closed study handle.");
+    }
+    return (unsigned int)value-1;
+}
+
+// Copies LOAD_NUM_SIGNALS arrays of numRows values, stored signal by signal, into the
+// columns of a new matrix.
+static mxArray * createSignalMatrix(const void * values, uint64_t numRows, mxClassID classID, size_t sz_value){
+    mxArray * matrix = mxCreateNumericMatrix((mwSize)numRows,LOAD_NUM_SIGNALS,classID,mxREAL);
+    memcpy(mxGetData(matrix),values,(size_t)numRows*LOAD_NUM_SIGNALS*sz_value);
+    return matrix;
+}
+
+static mxArray * createStatus(const loaded_study_t * study){
+    mxArray * status = mxCreateStructMatrix(1,1,4,STATUS_FIELDS);
+    load_state_t state;
+    double progress;
+    bool hasOverview;
+    getStudyLoadStatus(loader,study,&state,&progress,&hasOverview);
+    mxSetField(status,0,"state",mxCreateString(LOAD_STATE_NAMES[state]));
+    mxSetField(status,0,"progress",mxCreateDoubleScalar(progress));
+    mxSetField(status,0,"hasOverview",mxCreateLogicalScalar(hasOverview));
+    // the message is only written before a failed load is published
+    mxSetField(status,0,"message",mxCreateString(state==LOAD_FAILED ? study->errorMsg : ""));
+    return status;
+}
+
+static mxArray * createOverview(const loaded_study_t * study){
+    mxArray * overview;
+    load_state_t state;
+    double progress;
+    bool hasOverview;
+    getStudyLoadStatus(loader,study,&state,&progress,&hasOverview);
+    if(!hasOverview) {
+        return mxCreateDoubleMatrix(0,0,mxREAL);
+    }
+    overview = mxCreateStructMatrix(1,1,5,OVERVIEW_FIELDS);
+    mxSetField(overview,0,"startDatenum",mxCreateDoubleScalar(wallclock2datenum((double)study->info.start)));
+    mxSetField(overview,0,"secondsPerBin",mxCreateDoubleScalar(study->overview.secondsPerBin));
+    mxSetField(overview,0,"minimums",createSignalMatrix(study->overview.minimums,study->overview.numBins,mxSINGLE_CLASS,sizeof(float)));
+    mxSetField(overview,0,"maximums",createSignalMatrix(study->overview.maximums,study->overview.numBins,mxSINGLE_CLASS,sizeof(float)));
+    mxSetField(overview,0,"means",createSignalMatrix(study->overview.means,study->overview.numBins,mxSINGLE_CLASS,sizeof(float)));
+    return overview;
+}
+
+static mxArray * createStudy(const loaded_study_t * study){
+    mxArray * result = mxCreateStructMatrix(1,1,7,STUDY_FIELDS);
+    char serialID[SZ_SERIALID+1];
+    memcpy(serialID,study->info.serialID,SZ_SERIALID);
+    serialID[SZ_SERIALID] = '\0';
+    mxSetField(result,0,"samplerate",mxCreateDoubleScalar(study->info.samplerate));
+    mxSetField(result,0,"startDatenum",mxCreateDoubleScalar(wallclock2datenum((double)study->info.start)));
+    mxSetField(result,0,"durationSec",mxCreateDoubleScalar(study->info.duration_sec));
+    mxSetField(result,0,"numRecords",mxCreateDoubleScalar(study->info.recordCount));
+    mxSetField(result,0,"serialID",mxCreateString(serialID));
+    mxSetField(result,0,"signals",createSignalMatrix(study->signals,study->info.recordCount,mxSINGLE_CLASS,sizeof(float)));
+    mxSetField(result,0,"usage",createSignalMatrix(study->usage,study->info.recordCount,mxINT8_CLASS,sizeof(int8_t)));
+    return result;
+}
+
+static void prefetchStudies(const mxArray * filenames){
+    char * filename, errorMsg[SZ_LOAD_ERROR_MSG];
+    size_t f;
+    if(!mxIsCell(filenames)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:asyncload:prefetch",
+                "Filenames to prefetch must be a cell of strings.");
+    }
+    for(f=0;f<mxGetNumberOfElements(filenames);f++) {
+        if((filename=mxArrayToString(mxGetCell(filenames,f)))!=NULL) {
+            requestStudyLoad(getLoader(),filename,true,errorMsg,SZ_LOAD_ERROR_MSG);
+            mxFree(filename);
+        }
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char command[SZ_COMMAND], * filename, errorMsg[SZ_LOAD_ERROR_MSG];
+    loaded_study_t * study;
+    load_state_t state;
+    double progress;
+    unsigned int h;
+    bool wait, isDone, hasOverview;
+
+    if(nrhs<1 || !mxIsChar(prhs[0]) || mxGetString(prhs[0],command,SZ_COMMAND)!=0) {
+        mexErrMsgIdAndTxt("PadacoToolbox:asyncload:nrhs",
+                "The first input must be a command (see asyncload.c).");
+    }
+    if(strcmp(command,"open")==0) {
+        if(nrhs<2 || (filename=mxArrayToString(prhs[1]))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:asyncload:open",
+                    "A filename is required.");
+        }
+        for(h=0;h<MAX_LOAD_HANDLES && handles[h]!=NULL;h++);
+        if(h==MAX_LOAD_HANDLES) {
+            mexErrMsgIdAndTxt("PadacoToolbox:asyncload:open",
+                    "Too many open studies; close some first.");
+        }
+        study = requestStudyLoad(getLoader(),filename,false,errorMsg,SZ_LOAD_ERROR_MSG);
+        mxFree(filename);
+        if(study==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:asyncload:open",
+                    "%s",errorMsg);
+        }
+        handles[h] = study;
+        plhs[0] = mxCreateDoubleScalar(h+1);
+    }
+    else if(strcmp(command,"prefetch")==0) {
+        if(nrhs<2) {
+            mexErrMsgIdAndTxt("PadacoToolbox:asyncload:prefetch",
+                    "Filenames to prefetch are required.");
+        }
+        prefetchStudies(prhs[1]);
+    }
+    else if(strcmp(command,"status")==0) {
+        plhs[0] = createStatus(handles[getHandle(nrhs,prhs)]);
+    }
+    else if(strcmp(command,"overview")==0) {
+        plhs[0] = createOverview(handles[getHandle(nrhs,prhs)]);
+    }
+    else if(strcmp(command,"fetch")==0) {
+        study = handles[getHandle(nrhs,prhs)];
+        wait = nrhs<3 || mxIsEmpty(prhs[2]) || mxGetScalar(prhs[2])!=0;
+        if(wait) {
+            isDone = waitForStudyLoad(loader,study);
+        }
+        else {
+            getStudyLoadStatus(loader,study,&state,&progress,&hasOverview);
+            isDone = state==LOAD_DONE;
+        }
+        plhs[0] = isDone ? createStudy(study) : mxCreateDoubleMatrix(0,0,mxREAL);
+    }
+    else if(strcmp(command,"cancel")==0) {
+        cancelStudyLoad(loader,handles[getHandle(nrhs,prhs)]);
+    }
+    else if(strcmp(command,"close")==0) {
+        h = getHandle(nrhs,prhs);
+        releaseStudyLoad(loader,handles[h]);
+        handles[h] = NULL;
+    }
+    else if(strcmp(command,"shutdown")==0) {
+        shutdownLoader();
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:asyncload:command",
+                "Unknown command (%s).",command);
+    }
+}
@@ -0,0 +1,81 @@
+//
+//  bitindex.c
+//  Packed time of day bitsets per row.  See bitindex.h.
+//
+#include <string.h>
+#include "bitindex.h"
+
+unsigned int getBitIndexWordCount(unsigned int numColumns){
+    return (numColumns+BITINDEX_BITS_PER_WORD-1)/BITINDEX_BITS_PER_WORD;
+}
+
+// Bits first through last (inclusive, 0..63) set.
+static inline uint64_t bitRange(unsigned int first, unsigned int last){
+    uint64_t upper = last==BITINDEX_BITS_PER_WORD-1 ? ~(uint64_t)0 : (((uint64_t)1<<(last+1))-1);
+    return upper & ~(((uint64_t)1<<first)-1);
+}
+
+// @brief Packs bits (numRows x numColumns, column-major as MATLAB logical arrays) into words
+// (numRows x numWords, column-major) and blocks (numRows).
+bool packBitRows(const bool * bits, unsigned int numRows, unsigned int numColumns, uint64_t * words, uint64_t * blocks){
+    unsigned int numWords = getBitIndexWordCount(numColumns), r, c, w;
+    uint64_t * word;
+    if(numColumns>BITINDEX_MAX_COLUMNS){
+        return false;
+    }
+    memset(words,0,(size_t)numRows*numWords*sizeof(uint64_t));
+    memset(blocks,0,(size_t)numRows*sizeof(uint64_t));
+    for(c=0;c<numColumns;c++){
+        word = words+(size_t)(c/BITINDEX_BITS_PER_WORD)*numRows;
+        for(r=0;r<numRows;r++){
+            word[r] |= (uint64_t)(bits[(size_t)c*numRows+r]!=0)<<(c%BITINDEX_BITS_PER_WORD);
+        }
+    }
+    for(w=0;w<numWords;w++){
+        word = words+(size_t)w*numRows;
+        for(r=0;r<numRows;r++){
+            blocks[r] |= (uint64_t)(word[r]!=0)<<w;
+        }
+    }
+    return true;
+}
+
+static void queryRange(const uint64_t * words, const uint64_t * blocks, unsigned int numRows, unsigned int startColumn, unsigned int stopColumn, bool * rowMask){
+    unsigned int startWord = startColumn/BITINDEX_BITS_PER_WORD, stopWord = stopColumn/BITINDEX_BITS_PER_WORD, r;
+    uint64_t startMask, stopMask, blockMask;
+    const uint64_t * first = words+(size_t)startWord*numRows, * last = words+(size_t)stopWord*numRows;
+    if(startWord==stopWord){
+        startMask = bitRange(startColumn%BITINDEX_BITS_PER_WORD,stopColumn%BITINDEX_BITS_PER_WORD);
+        for(r=0;r<numRows;r++){
+            rowMask[r] |= (first[r]&startMask)!=0;
+        }
+        return;
+    }
+    startMask = bitRange(startColumn%BITINDEX_BITS_PER_WORD,BITINDEX_BITS_PER_WORD-1);
+    stopMask = bitRange(0,stopColumn%BITINDEX_BITS_PER_WORD);
+    blockMask = stopWord>startWord+1 ? bitRange(startWord+1,stopWord-1) : 0;
+    for(r=0;r<numRows;r++){
+        rowMask[r] |= (first[r]&startMask)!=0 || (last[r]&stopMask)!=0 || (blocks[r]&blockMask)!=0;
+    }
+}
+
+// @brief ORs into rowMask whether each row has a bit set in columns startColumn..stopColumn
+// (0 based, inclusive; wrapping when startColumn > stopColumn).
+void queryBitRows(const uint64_t * words, const uint64_t * blocks, unsigned int numRows, unsigned int numColumns,
+                  unsigned int startColumn, unsigned int stopColumn, bool * rowMask){
+    if(numColumns==0 || numRows==0){
+        return;
+    }
+    if(stopColumn>=numColumns){
+        stopColumn = numColumns-1;
+    }
+    if(startColumn<=stopColumn){
+        queryRange(words,blocks,numRows,startColumn,stopColumn,rowMask);
+    }
+    else{
+        if(startColumn<numColumns){
+            queryRange(words,blocks,numRows,startColumn,numColumns-1,rowMask);
+        }
+        queryRange(words,blocks,numRows,0,stopColumn,rowMask);
+    }
+}
@@ -0,0 +1,27 @@
+//
+//  bitindex.h
+//  Packed bitsets over the time of day columns of person-day rows (e.g. "was nonwear at
+//  this epoch"), queried for "is any bit set within a time window" per row.
+//
+//  Bits are packed 64 columns to a word.  Words are stored column-major, numRows x numWords,
+//  as MATLAB lays out a uint64 matrix, and each row also keeps a block word whose bit w is the
+//  OR of its word w.  A window query therefore touches at most three words per row: the
+//  masked first and last words and the block word for the whole words in between.
+//  Windows with start > stop wrap past midnight.
+//
+
+#ifndef in_bitindex_h
+#define in_bitindex_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BITINDEX_BITS_PER_WORD 64
+#define BITINDEX_MAX_COLUMNS (BITINDEX_BITS_PER_WORD*BITINDEX_BITS_PER_WORD)
+
+unsigned int getBitIndexWordCount(unsigned int numColumns);
+bool packBitRows(const bool * bits, unsigned int numRows, unsigned int numColumns, uint64_t * words, uint64_t * blocks);
+void queryBitRows(const uint64_t * words, const uint64_t * blocks, unsigned int numRows, unsigned int numColumns,
+                  unsigned int startColumn, unsigned int stopColumn, bool * rowMask);
+
+#endif /* in_bitindex_h */
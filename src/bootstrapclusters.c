@@ -0,0 +1,226 @@
+/*
+ * bootstrapclusters.c - runs bootstrap replicates of PACluster's adaptive k-means on all
+ * cores in the background (see clusterbootstrap.h).  Used by PAStatTool.bootstrap.
+ *
+ * The calling syntax is:
+ *
+ *		numResumed = bootstrapclusters('start', loadShapes, studyIndices, settings, resultsFilename)
+ *		status = bootstrapclusters('status')
+ *		results = bootstrapclusters('results')
+ *		bootstrapclusters('cancel')
+ *		bootstrapclusters('wait')
+ *		bootstrapclusters('clear')
+ *
+ * loadShapes is an N x M double matrix and studyIndices the N x 1 (1 based) study of each
+ * shape, e.g. the third output of unique(studyIDs); it may be empty when resampling by day.
+ * settings is a struct with fields numBootstraps, bootstrapSampleName ('studyID' or
+ * 'days'), minClusters, clusterThreshold, initClusterWithPermutation and seed.  Results are
+ * appended to resultsFilename as replicates finish; numResumed replicates of an earlier,
+ * cancelled run of the same shapes and settings in it are not run again.  status is a
+ * struct with fields numDone, numBootstraps and isRunning.  results is a struct with fields
+ * replicate (1 based), seed (uint64), clusterCount, silhouetteIndex and calinskiIndex, one
+ * row per finished replicate in replicate order (NaN where a replicate did not converge).
+ * One run is kept at a time; 'clear' cancels it and frees it.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O bootstrapclusters.c clusterbootstrap.c in_parallel.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "clusterbootstrap.h"
+
+#define SZ_COMMAND 16
+
+static const char * STATUS_FIELDS[] = {"numDone","numBootstraps","isRunning"};
+static const char * RESULT_FIELDS[] = {"replicate","seed","clusterCount","silhouetteIndex","calinskiIndex"};
+
+static bootstrap_run_t * run = NULL;
+
+static void clearRun(void){
+    if(run!=NULL){
+        freeBootstrapRun(run);
+        run = NULL;
+        mexUnlock();
+    }
+}
+
+static bootstrap_run_t * getRun(void){
+    if(run==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:run",
+                "No bootstrap has been started.");
+    }
+    return run;
+}
+
+static double getSettingValue(const mxArray * settings, const char * name){
+    const mxArray * field = mxGetField(settings,0,name);
+    if(field==NULL || mxGetNumberOfElements(field)!=1 || !(mxIsNumeric(field) || mxIsLogical(field))) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:settings",
+                "The settings struct's %s field must be a scalar.",name);
+    }
+    return mxGetScalar(field);
+}
+
+static void getSettings(const mxArray * settings, bootstrap_settings_t * bootSettings){
+    char * sampleName;
+    double value;
+    if(!mxIsStruct(settings)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:settings",
+                "Settings must be a struct.");
+    }
+    sampleName = mxGetField(settings,0,"bootstrapSampleName")==NULL ? NULL : mxArrayToString(mxGetField(settings,0,"bootstrapSampleName"));
+    if(sampleName==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:settings",
+                "The settings struct's bootstrapSampleName field must be a string.");
+    }
+    bootSettings->sample = strcmp(sampleName,BOOTSTRAP_SAMPLE_NAMES[BOOTSTRAP_BY_DAY])==0 ? BOOTSTRAP_BY_DAY : BOOTSTRAP_BY_STUDY;
+    mxFree(sampleName);
+    value = getSettingValue(settings,"numBootstraps");
+    bootSettings->numReplicates = value>0 ? (unsigned int)value : 0;
+    value = getSettingValue(settings,"minClusters");
+    bootSettings->minClusters = value>0 ? (unsigned int)value : 0;
+    bootSettings->clusterThreshold = getSettingValue(settings,"clusterThreshold");
+    bootSettings->initClusterWithPermutation = getSettingValue(settings,"initClusterWithPermutation")!=0;
+    value = getSettingValue(settings,"seed");
+    bootSettings->seed = value>0 ? (uint64_t)value : 0;
+}
+
+static uint32_t * getStudyIndices(const mxArray * studyIndices, size_t numShapes){
+    uint32_t * groups;
+    const double * values;
+    size_t s;
+    if(mxIsEmpty(studyIndices)) {
+        return NULL;
+    }
+    if(!mxIsDouble(studyIndices) || mxGetNumberOfElements(studyIndices)!=numShapes) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:studyIndices",
+                "Study indices must be a double vector with one entry per load shape.");
+    }
+    values = mxGetPr(studyIndices);
+    groups = mxMalloc(numShapes*sizeof(uint32_t));
+    for(s=0;s<numShapes;s++) {
+        if(!(values[s]>=1) || values[s]!=(uint32_t)values[s]) {
+            mxFree(groups);
+            mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:studyIndices",
+                    "Study indices must be positive integers.");
+        }
+        groups[s] = (uint32_t)values[s]-1;
+    }
+    return groups;
+}
+
+static void startRun(int nrhs, const mxArray *prhs[], mxArray *plhs[]){
+    bootstrap_settings_t settings;
+    char * resultsFilename, errorMsg[SZ_BOOTSTRAP_ERROR_MSG];
+    uint32_t * groups;
+    bootstrap_run_t * newRun;
+
+    if(nrhs!=5 || !mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:nrhs",
+                "Load shapes (double), study indices, settings and a results filename are required.");
+    }
+    getSettings(prhs[3],&settings);
+    if((resultsFilename=mxArrayToString(prhs[4]))==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:notString",
+                "The results filename must be a string.");
+    }
+    groups = getStudyIndices(prhs[2],mxGetM(prhs[1]));
+    clearRun();
+    newRun = createBootstrapRun(mxGetPr(prhs[1]),(unsigned int)mxGetM(prhs[1]),(unsigned int)mxGetN(prhs[1]),groups,
+                                &settings,resultsFilename,0,errorMsg,SZ_BOOTSTRAP_ERROR_MSG);
+    mxFree(groups);
+    mxFree(resultsFilename);
+    if(newRun==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:start",
+                "%s",errorMsg);
+    }
+    run = newRun;
+    // the run's thread uses this mex file's code until it is cleared
+    mexLock();
+    if(!startBootstrapRun(run)) {
+        clearRun();
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:start",
+                "Could not start the bootstrap thread.");
+    }
+    plhs[0] = mxCreateDoubleScalar(run->numResumed);
+}
+
+static mxArray * createStatus(void){
+    mxArray * status = mxCreateStructMatrix(1,1,3,STATUS_FIELDS);
+    unsigned int numDone;
+    bool isRunning;
+    getBootstrapProgress(getRun(),&numDone,&isRunning);
+    mxSetField(status,0,"numDone",mxCreateDoubleScalar(numDone));
+    mxSetField(status,0,"numBootstraps",mxCreateDoubleScalar(run->settings.numReplicates));
+    mxSetField(status,0,"isRunning",mxCreateLogicalScalar(isRunning));
+    return status;
+}
+
+static mxArray * createResults(void){
+    mxArray * results = mxCreateStructMatrix(1,1,5,RESULT_FIELDS);
+    mxArray * replicates, * seeds, * counts, * silhouettes, * calinskis;
+    unsigned int r, row = 0, numDone;
+    bool isRunning;
+
+    getBootstrapProgress(getRun(),&numDone,&isRunning);
+    replicates = mxCreateDoubleMatrix(numDone,1,mxREAL);
+    seeds = mxCreateNumericMatrix(numDone,1,mxUINT64_CLASS,mxREAL);
+    counts = mxCreateDoubleMatrix(numDone,1,mxREAL);
+    silhouettes = mxCreateDoubleMatrix(numDone,1,mxREAL);
+    calinskis = mxCreateDoubleMatrix(numDone,1,mxREAL);
+    pthread_mutex_lock(&run->lock);
+    for(r=0;r<run->settings.numReplicates && row<numDone;r++) {
+        if(run->isDone[r]) {
+            mxGetPr(replicates)[row] = r+1;
+            ((uint64_t *)mxGetData(seeds))[row] = run->results[r].seed;
+            mxGetPr(counts)[row] = run->results[r].clusterCount;
+            mxGetPr(silhouettes)[row] = run->results[r].silhouetteIndex;
+            mxGetPr(calinskis)[row] = run->results[r].calinskiIndex;
+            row++;
+        }
+    }
+    pthread_mutex_unlock(&run->lock);
+    mxSetField(results,0,"replicate",replicates);
+    mxSetField(results,0,"seed",seeds);
+    mxSetField(results,0,"clusterCount",counts);
+    mxSetField(results,0,"silhouetteIndex",silhouettes);
+    mxSetField(results,0,"calinskiIndex",calinskis);
+    return results;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char command[SZ_COMMAND];
+
+    if(nrhs<1 || !mxIsChar(prhs[0]) || mxGetString(prhs[0],command,SZ_COMMAND)!=0) {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:nrhs",
+                "The first input must be a command (see bootstrapclusters.c).");
+    }
+    mexAtExit(clearRun);
+    if(strcmp(command,"start")==0) {
+        startRun(nrhs,prhs,plhs);
+    }
+    else if(strcmp(command,"status")==0) {
+        plhs[0] = createStatus();
+    }
+    else if(strcmp(command,"results")==0) {
+        plhs[0] = createResults();
+    }
+    else if(strcmp(command,"cancel")==0) {
+        cancelBootstrapRun(getRun());
+    }
+    else if(strcmp(command,"wait")==0) {
+        waitForBootstrapRun(getRun());
+    }
+    else if(strcmp(command,"clear")==0) {
+        clearRun();
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:bootstrapclusters:command",
+                "Unknown command (%s).",command);
+    }
+}
@@ -0,0 +1,283 @@
+//
+//  calibrate.c
+//  Auto-calibration of raw accelerations.  See calibrate.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "calibrate.h"
+
+#define CALIBRATION_MEAN_FIELDS (CALIBRATION_AXES+1)
+#define CALIBRATION_MAX_WEIGHT 100
+
+void initCalibration(calibration_t * calibration){
+    int axis;
+    memset(calibration,0,sizeof(calibration_t));
+    memcpy(calibration->magic,CALIBRATION_MAGIC,strlen(CALIBRATION_MAGIC));
+    calibration->version = CALIBRATION_VERSION;
+    for(axis=0;axis<CALIBRATION_AXES;axis++){
+        calibration->scale[axis] = 1;
+    }
+}
+
+calibrator_t * createCalibrator(double samplerate, double windowSec, double stdThreshold){
+    calibrator_t * calibrator;
+    if(samplerate<=0){
+        return NULL;
+    }
+    calibrator = calloc(1,sizeof(calibrator_t));
+    calibrator->samplesPerWindow = (unsigned int)((windowSec>0 ? windowSec : CALIBRATION_WINDOW_SEC)*samplerate+0.5);
+    if(calibrator->samplesPerWindow<2){
+        calibrator->samplesPerWindow = 2;
+    }
+    calibrator->stdThreshold = stdThreshold>0 ? stdThreshold : CALIBRATION_STD_THRESHOLD;
+    return calibrator;
+}
+
+void freeCalibrator(calibrator_t * calibrator){
+    if(calibrator!=NULL){
+        free(calibrator->means);
+        free(calibrator);
+    }
+}
+
+// Keeps the window just completed when it is still.
+static void closeWindow(calibrator_t * calibrator){
+    double n = calibrator->windowCount, mean, variance, * windowMeans;
+    int axis;
+    bool isStill = true;
+    for(axis=0;axis<CALIBRATION_AXES && isStill;axis++){
+        mean = calibrator->sum[axis]/n;
+        variance = (calibrator->sumSquares[axis]-n*mean*mean)/(n-1);
+        isStill = variance<calibrator->stdThreshold*calibrator->stdThreshold;
+    }
+    if(isStill){
+        if(calibrator->numWindows==calibrator->capacity){
+            calibrator->capacity = calibrator->capacity>0 ? 2*calibrator->capacity : 256;
+            calibrator->means = realloc(calibrator->means,(size_t)calibrator->capacity*CALIBRATION_MEAN_FIELDS*sizeof(double));
+        }
+        windowMeans = calibrator->means+(size_t)calibrator->numWindows*CALIBRATION_MEAN_FIELDS;
+        for(axis=0;axis<CALIBRATION_AXES;axis++){
+            windowMeans[axis] = calibrator->sum[axis]/n;
+        }
+        windowMeans[CALIBRATION_AXES] = calibrator->sumTemperature/n;
+        calibrator->numWindows++;
+    }
+    calibrator->windowCount = 0;
+    calibrator->sumTemperature = 0;
+    memset(calibrator->sum,0,sizeof(calibrator->sum));
+    memset(calibrator->sumSquares,0,sizeof(calibrator->sumSquares));
+}
+
+void addCalibrationSamples(calibrator_t * calibrator, const float * xyz, const float * temperature, uint64_t numRecords){
+    uint64_t r;
+    int axis;
+    double value;
+    calibrator->hasTemperature = temperature!=NULL;
+    for(r=0;r<numRecords;r++){
+        for(axis=0;axis<CALIBRATION_AXES;axis++){
+            value = xyz[r*CALIBRATION_AXES+axis];
+            calibrator->sum[axis] += value;
+            calibrator->sumSquares[axis] += value*value;
+        }
+        if(temperature!=NULL){
+            calibrator->sumTemperature += temperature[r];
+        }
+        if(++calibrator->windowCount==calibrator->samplesPerWindow){
+            closeWindow(calibrator);
+        }
+    }
+}
+
+// Mean distance of the corrected window means from the unit sphere.
+static double getSphereError(const calibrator_t * calibrator, const calibration_t * calibration){
+    unsigned int w;
+    int axis;
+    double total = 0, length, corrected;
+    const double * windowMeans;
+    for(w=0;w<calibrator->numWindows;w++){
+        windowMeans = calibrator->means+(size_t)w*CALIBRATION_MEAN_FIELDS;
+        length = 0;
+        for(axis=0;axis<CALIBRATION_AXES;axis++){
+            corrected = calibration->offset[axis]+calibration->scale[axis]*windowMeans[axis]+
+                        calibration->temperatureCoef[axis]*(windowMeans[CALIBRATION_AXES]-calibration->meanTemperature);
+            length += corrected*corrected;
+        }
+        total += fabs(sqrt(length)-1);
+    }
+    return total/calibrator->numWindows;
+}
+
+// Solves the numParams x numParams system A*x = b in place (Gaussian elimination with partial pivoting).
+static bool solveLinearSystem(double A[3][3], double b[3], unsigned int numParams, double x[3]){
+    unsigned int i, j, k, pivot;
+    double factor, swap;
+    for(i=0;i<numParams;i++){
+        pivot = i;
+        for(j=i+1;j<numParams;j++){
+            if(fabs(A[j][i])>fabs(A[pivot][i])){
+                pivot = j;
+            }
+        }
+        if(fabs(A[pivot][i])<1e-12){
+            return false;
+        }
+        if(pivot!=i){
+            for(k=0;k<numParams;k++){
+                swap = A[i][k]; A[i][k] = A[pivot][k]; A[pivot][k] = swap;
+            }
+            swap = b[i]; b[i] = b[pivot]; b[pivot] = swap;
+        }
+        for(j=i+1;j<numParams;j++){
+            factor = A[j][i]/A[i][i];
+            for(k=i;k<numParams;k++){
+                A[j][k] -= factor*A[i][k];
+            }
+            b[j] -= factor*b[i];
+        }
+    }
+    for(i=numParams;i-->0;){
+        x[i] = b[i];
+        for(k=i+1;k<numParams;k++){
+            x[i] -= A[i][k]*x[k];
+        }
+        x[i] /= A[i][i];
+    }
+    return true;
+}
+
+bool fitCalibration(const calibrator_t * calibrator, calibration_t * calibration){
+    unsigned int w, numParams, i, j, iteration;
+    int axis;
+    double * corrected, * targets, * weights, minimum[CALIBRATION_AXES], maximum[CALIBRATION_AXES];
+    double A[3][3], b[3], coef[3], regressors[3], length, distance, error, previousError, temperatureSum = 0;
+    const double * windowMeans;
+    bool isCovered = true, didSolve = true;
+
+    initCalibration(calibration);
+    calibration->numWindows = calibrator->numWindows;
+    calibration->usesTemperature = calibrator->hasTemperature;
+    if(calibrator->numWindows<CALIBRATION_MIN_WINDOWS){
+        return false;
+    }
+    for(axis=0;axis<CALIBRATION_AXES;axis++){
+        minimum[axis] = INFINITY;
+        maximum[axis] = -INFINITY;
+    }
+    for(w=0;w<calibrator->numWindows;w++){
+        windowMeans = calibrator->means+(size_t)w*CALIBRATION_MEAN_FIELDS;
+        for(axis=0;axis<CALIBRATION_AXES;axis++){
+            minimum[axis] = fmin(minimum[axis],windowMeans[axis]);
+            maximum[axis] = fmax(maximum[axis],windowMeans[axis]);
+        }
+        temperatureSum += windowMeans[CALIBRATION_AXES];
+    }
+    calibration->meanTemperature = calibrator->hasTemperature ? temperatureSum/calibrator->numWindows : 0;
+    calibration->errorBefore = calibration->errorAfter = getSphereError(calibrator,calibration);
+    for(axis=0;axis<CALIBRATION_AXES;axis++){
+        isCovered = isCovered && minimum[axis]< -CALIBRATION_SPHERE_COVERAGE && maximum[axis]>CALIBRATION_SPHERE_COVERAGE;
+    }
+    if(!isCovered){
+        return false;
+    }
+
+    numParams = calibrator->hasTemperature ? 3 : 2;
+    corrected = malloc((size_t)calibrator->numWindows*CALIBRATION_AXES*sizeof(double));
+    targets = malloc((size_t)calibrator->numWindows*CALIBRATION_AXES*sizeof(double));
+    weights = malloc((size_t)calibrator->numWindows*sizeof(double));
+    previousError = calibration->errorBefore;
+    for(iteration=1;iteration<=CALIBRATION_MAX_ITERATIONS && didSolve;iteration++){
+        // closest points on the unit sphere, weighted against outlying windows
+        for(w=0;w<calibrator->numWindows;w++){
+            windowMeans = calibrator->means+(size_t)w*CALIBRATION_MEAN_FIELDS;
+            length = 0;
+            for(axis=0;axis<CALIBRATION_AXES;axis++){
+                corrected[w*CALIBRATION_AXES+axis] = calibration->offset[axis]+calibration->scale[axis]*windowMeans[axis]+
+                        calibration->temperatureCoef[axis]*(windowMeans[CALIBRATION_AXES]-calibration->meanTemperature);
+                length += corrected[w*CALIBRATION_AXES+axis]*corrected[w*CALIBRATION_AXES+axis];
+            }
+            length = sqrt(length);
+            distance = 0;
+            for(axis=0;axis<CALIBRATION_AXES;axis++){
+                targets[w*CALIBRATION_AXES+axis] = corrected[w*CALIBRATION_AXES+axis]/length;
+                distance += pow(corrected[w*CALIBRATION_AXES+axis]-targets[w*CALIBRATION_AXES+axis],2);
+            }
+            distance = sqrt(distance);
+            weights[w] = distance>1.0/CALIBRATION_MAX_WEIGHT ? 1/distance : CALIBRATION_MAX_WEIGHT;
+        }
+        // target = b0 + b1*corrected (+ b2*temperature) per axis, folded into the correction
+        for(axis=0;axis<CALIBRATION_AXES && didSolve;axis++){
+            memset(A,0,sizeof(A));
+            memset(b,0,sizeof(b));
+            for(w=0;w<calibrator->numWindows;w++){
+                regressors[0] = 1;
+                regressors[1] = corrected[w*CALIBRATION_AXES+axis];
+                regressors[2] = calibrator->means[(size_t)w*CALIBRATION_MEAN_FIELDS+CALIBRATION_AXES]-calibration->meanTemperature;
+                for(i=0;i<numParams;i++){
+                    for(j=0;j<numParams;j++){
+                        A[i][j] += weights[w]*regressors[i]*regressors[j];
+                    }
+                    b[i] += weights[w]*regressors[i]*targets[w*CALIBRATION_AXES+axis];
+                }
+            }
+            coef[2] = 0;
+            if((didSolve=solveLinearSystem(A,b,numParams,coef))){
+                calibration->offset[axis] = coef[0]+coef[1]*calibration->offset[axis];
+                calibration->scale[axis] *= coef[1];
+                calibration->temperatureCoef[axis] = coef[1]*calibration->temperatureCoef[axis]+coef[2];
+            }
+        }
+        error = getSphereError(calibrator,calibration);
+        calibration->numIterations = iteration;
+        if(fabs(previousError-error)<CALIBRATION_TOLERANCE){
+            break;
+        }
+        previousError = error;
+    }
+    free(weights);
+    free(targets);
+    free(corrected);
+
+    calibration->errorAfter = getSphereError(calibrator,calibration);
+    if(!didSolve || !(calibration->errorAfter<CALIBRATION_MAX_ERROR) || calibration->errorAfter>=calibration->errorBefore){
+        error = calibration->errorAfter;
+        iteration = calibration->numIterations;
+        initCalibration(calibration);
+        calibration->numWindows = calibrator->numWindows;
+        calibration->numIterations = iteration;
+        calibration->errorBefore = getSphereError(calibrator,calibration);
+        calibration->errorAfter = error;
+        return false;
+    }
+    calibration->didCalibrate = 1;
+    return true;
+}
+
+void applyCalibration(const calibration_t * calibration, float * xyz, const float * temperature, uint64_t numRecords){
+    uint64_t r;
+    int axis;
+    double temperatureOffset = 0;
+    if(!calibration->didCalibrate){
+        return;
+    }
+    for(r=0;r<numRecords;r++){
+        if(temperature!=NULL && calibration->usesTemperature){
+            temperatureOffset = temperature[r]-calibration->meanTemperature;
+        }
+        for(axis=0;axis<CALIBRATION_AXES;axis++){
+            xyz[r*CALIBRATION_AXES+axis] = (float)(calibration->offset[axis]+calibration->scale[axis]*xyz[r*CALIBRATION_AXES+axis]+
+                                                   calibration->temperatureCoef[axis]*temperatureOffset);
+        }
+    }
+}
+
+bool writeCalibrationTrailer(FILE * fid, const calibration_t * calibration){
+    return fwrite(calibration,sizeof(calibration_t),1,fid)==1;
+}
+
+bool readCalibrationTrailer(FILE * fid, const bin_header_t * header, calibration_t * calibration){
+    return fseek(fid,(long)(sizeof(bin_header_t)+header->sz_remaining),SEEK_SET)==0 &&
+           fread(calibration,sizeof(calibration_t),1,fid)==1 &&
+           memcmp(calibration->magic,CALIBRATION_MAGIC,strlen(CALIBRATION_MAGIC))==0 && calibration->version==CALIBRATION_VERSION;
+}
@@ -0,0 +1,96 @@
+//
+//  calibrate.h
+//  Auto-calibration of raw (g) accelerations against local gravity.
+//
+//  Samples are cut into windows of windowSec seconds in a single streaming pass; windows whose
+//  x, y and z standard deviations are all below stdThreshold are taken to be still, so their
+//  mean vector should have a length of 1 g.  Per axis offset and scale (and, when sample
+//  temperatures are given, a linear temperature term) are then fit to the still window means
+//  by iterative sphere fitting: each corrected mean is projected onto the unit sphere and the
+//  axes are refit to those points by weighted least squares until the mean distance from the
+//  sphere stops improving.  The correction is
+//
+//      corrected = offset + scale*value + temperatureCoef*(temperature-meanTemperature)
+//
+//  Calibration is only accepted when the still windows cover the sphere (each axis has means
+//  beyond +/-CALIBRATION_SPHERE_COVERAGE g) and the fit reduces the error below
+//  CALIBRATION_MAX_ERROR g; otherwise the identity correction is kept.
+//
+//  A Padaco .bin file written with calibrated samples carries the calibration_t as a trailer
+//  after its payload (i.e. sizeof(bin_header_t)+sz_remaining bytes from the start), which
+//  readers of the payload ignore.  Calibrated samples are off the recording's sample grid, so
+//  rawcodec would store them verbatim; rawcsv2rawbin does not calibrate compressed files.
+//
+
+#ifndef in_calibrate_h
+#define in_calibrate_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "rawtools.h"
+
+#define CALIBRATION_MAGIC "PZCAL1"
+#define CALIBRATION_VERSION 1
+#define CALIBRATION_AXES 3
+#define CALIBRATION_WINDOW_SEC 10
+#define CALIBRATION_STD_THRESHOLD 0.013
+#define CALIBRATION_MIN_WINDOWS 10
+#define CALIBRATION_SPHERE_COVERAGE 0.3
+#define CALIBRATION_MAX_ERROR 0.01
+#define CALIBRATION_MAX_ITERATIONS 1000
+#define CALIBRATION_TOLERANCE 1e-10
+
+#pragma pack(push,1)
+typedef struct calibration_t{
+    char magic[8];
+    uint32_t version;
+    uint8_t didCalibrate;       // 0 => identity correction (see above)
+    uint8_t usesTemperature;
+    uint32_t numWindows;        // still windows found
+    uint32_t numIterations;
+    double offset[CALIBRATION_AXES];
+    double scale[CALIBRATION_AXES];
+    double temperatureCoef[CALIBRATION_AXES];
+    double meanTemperature;
+    double errorBefore;         // mean distance (g) of the still window means from the unit sphere
+    double errorAfter;          // the same after correction
+} calibration_t;
+#pragma pack(pop)
+
+typedef struct calibrator_t{
+    unsigned int samplesPerWindow;
+    double stdThreshold;
+    bool hasTemperature;
+
+    // window being accumulated
+    unsigned int windowCount;
+    double sum[CALIBRATION_AXES];
+    double sumSquares[CALIBRATION_AXES];
+    double sumTemperature;
+
+    // means (x, y, z, temperature) of the still windows
+    unsigned int numWindows;
+    unsigned int capacity;
+    double * means;
+} calibrator_t;
+
+void initCalibration(calibration_t * calibration);
+
+// @param windowSec, stdThreshold 0 => CALIBRATION_WINDOW_SEC, CALIBRATION_STD_THRESHOLD
+calibrator_t * createCalibrator(double samplerate, double windowSec, double stdThreshold);
+// @param xyz numRecords interleaved x, y, z samples.
+// @param temperature (may be NULL) numRecords temperatures; give all or none.
+void addCalibrationSamples(calibrator_t * calibrator, const float * xyz, const float * temperature, uint64_t numRecords);
+// @retval true when a calibration was fit and accepted (see calibration->didCalibrate)
+bool fitCalibration(const calibrator_t * calibrator, calibration_t * calibration);
+void freeCalibrator(calibrator_t * calibrator);
+
+void applyCalibration(const calibration_t * calibration, float * xyz, const float * temperature, uint64_t numRecords);
+
+// Writes the trailer at the current position, which should be the end of the payload.
+bool writeCalibrationTrailer(FILE * fid, const calibration_t * calibration);
+// @retval false when the .bin file has no calibration trailer.
+bool readCalibrationTrailer(FILE * fid, const bin_header_t * header, calibration_t * calibration);
+
+#endif /* in_calibrate_h */
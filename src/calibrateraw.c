@@ -0,0 +1,118 @@
+/*
+ * calibrateraw.c - auto-calibrate raw accelerations against gravity (calibrate.c).
+ *
+ * The calling syntax is:
+ *
+ *		[xyz, calibration] = calibrateraw(xyz, samplerate)
+ *		[xyz, calibration] = calibrateraw(xyz, samplerate, temperature)
+ *
+ * xyz is a single precision matrix with x, y and z (g) in its three columns and temperature
+ * an optional vector with one temperature per row.  The returned xyz is corrected when the
+ * fit is accepted and unchanged otherwise.  calibration is a struct with fields didCalibrate,
+ * usesTemperature, numWindows, numIterations, offset, scale, temperatureCoef (1x3 each),
+ * meanTemperature, errorBefore and errorAfter, as in the calibration_t trailer written by
+ * rawcsv2rawbin -k.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O calibrateraw.c calibrate.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "calibrate.h"
+
+static const char * CALIBRATION_FIELDS[] = {"didCalibrate","usesTemperature","numWindows","numIterations","offset","scale",
+                                            "temperatureCoef","meanTemperature","errorBefore","errorAfter"};
+
+static mxArray * createAxesVector(const double * values){
+    mxArray * vector = mxCreateDoubleMatrix(1,CALIBRATION_AXES,mxREAL);
+    memcpy(mxGetPr(vector),values,CALIBRATION_AXES*sizeof(double));
+    return vector;
+}
+
+static mxArray * createCalibrationStruct(const calibration_t * calibration){
+    mxArray * calibrationStruct = mxCreateStructMatrix(1,1,sizeof(CALIBRATION_FIELDS)/sizeof(CALIBRATION_FIELDS[0]),CALIBRATION_FIELDS);
+    mxSetField(calibrationStruct,0,"didCalibrate",mxCreateLogicalScalar(calibration->didCalibrate!=0));
+    mxSetField(calibrationStruct,0,"usesTemperature",mxCreateLogicalScalar(calibration->usesTemperature!=0));
+    mxSetField(calibrationStruct,0,"numWindows",mxCreateDoubleScalar(calibration->numWindows));
+    mxSetField(calibrationStruct,0,"numIterations",mxCreateDoubleScalar(calibration->numIterations));
+    mxSetField(calibrationStruct,0,"offset",createAxesVector(calibration->offset));
+    mxSetField(calibrationStruct,0,"scale",createAxesVector(calibration->scale));
+    mxSetField(calibrationStruct,0,"temperatureCoef",createAxesVector(calibration->temperatureCoef));
+    mxSetField(calibrationStruct,0,"meanTemperature",mxCreateDoubleScalar(calibration->meanTemperature));
+    mxSetField(calibrationStruct,0,"errorBefore",mxCreateDoubleScalar(calibration->errorBefore));
+    mxSetField(calibrationStruct,0,"errorAfter",mxCreateDoubleScalar(calibration->errorAfter));
+    return calibrationStruct;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    const float * columns;
+    float * interleaved, * temperature = NULL, * output;
+    const double * temperatureValues;
+    size_t numRecords, r;
+    int axis;
+    calibrator_t * calibrator;
+    calibration_t calibration;
+
+    if(nrhs < 2 || nrhs > 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:calibrateraw:nrhs",
+                "Accelerations and samplerate are required inputs; temperature is optional.");
+    }
+    if(nlhs > 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:calibrateraw:nlhs",
+                "At most two outputs are produced.");
+    }
+    if(!mxIsSingle(prhs[0]) || mxGetN(prhs[0])!=CALIBRATION_AXES) {
+        mexErrMsgIdAndTxt("PadacoToolbox:calibrateraw:notSingle",
+                "Accelerations must be an Nx3 matrix of class single.");
+    }
+    numRecords = mxGetM(prhs[0]);
+    if(nrhs > 2 && !mxIsEmpty(prhs[2])) {
+        if(!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2])!=numRecords) {
+            mexErrMsgIdAndTxt("PadacoToolbox:calibrateraw:temperature",
+                    "Temperature must be a double vector with one value per acceleration row.");
+        }
+        temperatureValues = mxGetPr(prhs[2]);
+        temperature = mxMalloc(numRecords*sizeof(float));
+        for(r=0;r<numRecords;r++) {
+            temperature[r] = (float)temperatureValues[r];
+        }
+    }
+    calibrator = createCalibrator(mxGetScalar(prhs[1]),0,0);
+    if(calibrator==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:calibrateraw:samplerate",
+                "Samplerate must be positive.");
+    }
+
+    // MATLAB stores the axes column by column; calibrate.c works on interleaved records.
+    columns = (const float*)mxGetData(prhs[0]);
+    interleaved = mxMalloc(numRecords*CALIBRATION_AXES*sizeof(float));
+    for(r=0;r<numRecords;r++) {
+        for(axis=0;axis<CALIBRATION_AXES;axis++) {
+            interleaved[r*CALIBRATION_AXES+axis] = columns[axis*numRecords+r];
+        }
+    }
+    addCalibrationSamples(calibrator,interleaved,temperature,numRecords);
+    if(fitCalibration(calibrator,&calibration)) {
+        applyCalibration(&calibration,interleaved,temperature,numRecords);
+    }
+    freeCalibrator(calibrator);
+
+    plhs[0] = mxCreateNumericMatrix(numRecords,CALIBRATION_AXES,mxSINGLE_CLASS,mxREAL);
+    output = (float*)mxGetData(plhs[0]);
+    for(r=0;r<numRecords;r++) {
+        for(axis=0;axis<CALIBRATION_AXES;axis++) {
+            output[axis*numRecords+r] = interleaved[r*CALIBRATION_AXES+axis];
+        }
+    }
+    if(nlhs > 1) {
+        plhs[1] = createCalibrationStruct(&calibration);
+    }
+    mxFree(interleaved);
+    mxFree(temperature);
+}
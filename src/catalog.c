@@ -0,0 +1,425 @@
+//
+//  catalog.c
+//  Header-only recording catalog.  See catalog.h.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "catalog.h"
+#include "in_parallel.h"
+
+#define SZ_LINE 1024
+#define SZ_TAIL 1024
+#define MAX_DIRECTORY_DEPTH 32
+#define GT3X_INFO_FILENAME "info.txt"
+#define TICKS_PER_SECOND 10000000LL
+#define TICKS_TO_1970 621355968000000000LL  // .NET ticks at 01-Jan-1970 00:00:00
+
+const char * RECORDING_TYPE_NAMES[NUM_RECORDING_TYPES] = {"unknown","bin","csv","raw","gt3x"};
+
+static const char * CATALOG_COLUMNS = "path\tmtime\tsize\ttype\tvalid\tcompressed\tduration_estimated\tserialID\tfirmware\tsamplerate\tstart\tstartDatenum\tduration_sec";
+
+typedef struct{
+    recording_catalog_t * catalog;
+    unsigned int * staleIndices;
+} parse_job_t;
+
+static int compareEntryPaths(const void * a, const void * b){
+    return strcmp(((const catalog_entry_t*)a)->path,((const catalog_entry_t*)b)->path);
+}
+
+static catalog_entry_t * appendEntry(recording_catalog_t * catalog){
+    if(catalog->count==catalog->capacity){
+        catalog->capacity = catalog->capacity ? catalog->capacity*2 : 256;
+        catalog->entries = realloc(catalog->entries,catalog->capacity*sizeof(catalog_entry_t));
+    }
+    memset(&catalog->entries[catalog->count],0,sizeof(catalog_entry_t));
+    catalog->entries[catalog->count].start = UNKNOWN_START;
+    return &catalog->entries[catalog->count++];
+}
+
+void freeCatalog(recording_catalog_t * catalog){
+    unsigned int e;
+    for(e=0;e<catalog->count;e++){
+        free(catalog->entries[e].path);
+    }
+    free(catalog->entries);
+    memset(catalog,0,sizeof(recording_catalog_t));
+}
+
+recording_type_t getRecordingType(const char * filename){
+    const char * extension = strrchr(filename,'.');
+    if(extension==NULL){
+        return RECORDING_UNKNOWN;
+    }
+    if(strcasecmp(extension,".bin")==0) return RECORDING_BIN;
+    if(strcasecmp(extension,".csv")==0) return RECORDING_CSV;
+    if(strcasecmp(extension,".raw")==0) return RECORDING_RAW;
+    return RECORDING_UNKNOWN;
+}
+
+static void copyField(char * destination, const char * source, size_t sz_destination){
+    size_t n = 0;
+    while(n<sz_destination-1 && source[n]!='\0' && source[n]!='\t' && source[n]!='\r' && source[n]!='\n'){
+        destination[n] = source[n];
+        n++;
+    }
+    destination[n] = '\0';
+}
+
+/***************
+ *  Header readers
+ ***************/
+static bool readBinHeader(const char * path, catalog_entry_t * entry){
+    bin_header_t header;
+    struct tm startTime;
+    FILE * fid = fopen(path,"rb");
+    bool didRead;
+    if(fid==NULL){
+        return false;
+    }
+    didRead = fread(&header,sizeof(bin_header_t),1,fid)==1;
+    fclose(fid);
+    if(!didRead || header.num_signals==0 || !parseBinStartTimeStr(header.startTimeStr,&startTime)){
+        return false;
+    }
+    entry->samplerate = header.samplerate;
+    entry->start = tm2wallclock(&startTime);
+    entry->duration_sec = header.duration_sec;
+    entry->isCompressed = header.sz_per_signal==0;
+    copyField(entry->serialID,header.serialID,SZ_SERIALID);
+    copyField(entry->firmware,header.firmware,SZ_FIRMWARE);
+    return true;
+}
+
+// ActiGraph .csv/.raw exports: the ten line header, then (optionally) column names.  The
+// final row is read from the end of the file for the duration; files without timestamps
+// have their duration estimated from the length of the first data row.
+static bool readCSVHeader(const char * path, uint64_t sz_file, catalog_entry_t * entry){
+    char line[SZ_LINE], tail[SZ_TAIL+1], * lastLine;
+    double lastWallclock;
+    long dataOffset, firstRowLength = 0;
+    size_t numRead;
+    actigraph_csv_info_t info;
+    FILE * fid = fopen(path,"r");
+    if(fid==NULL){
+        return false;
+    }
+    if(!readActigraphCSVHeader(fid,&info)){
+        fclose(fid);
+        return false;
+    }
+    dataOffset = ftell(fid);
+    if(fgets(line,SZ_LINE,fid)!=NULL){
+        firstRowLength = (long)strlen(line);
+    }
+    entry->samplerate = info.samplerate;
+    entry->start = info.start;
+    copyField(entry->serialID,info.serialID,SZ_SERIALID);
+    copyField(entry->firmware,info.firmware,SZ_FIRMWARE);
+
+    // last complete row
+    if(sz_file>(uint64_t)dataOffset+SZ_TAIL){
+        fseek(fid,-SZ_TAIL,SEEK_END);
+    }
+    else{
+        fseek(fid,dataOffset,SEEK_SET);
+    }
+    numRead = fread(tail,1,SZ_TAIL,fid);
+    fclose(fid);
+    tail[numRead] = '\0';
+    while(numRead>0 && (tail[numRead-1]=='\n' || tail[numRead-1]=='\r')){
+        tail[--numRead] = '\0';
+    }
+    lastLine = strrchr(tail,'\n');
+    lastLine = lastLine==NULL ? tail : lastLine+1;
+    if(parseCSVRowTimestamp(lastLine,&lastWallclock)){
+        entry->duration_sec = lastWallclock-entry->start+1/entry->samplerate;
+    }
+    else if(firstRowLength>0){
+        entry->duration_sec = floor((double)(sz_file-dataOffset)/firstRowLength)/entry->samplerate;
+        entry->isDurationEstimated = true;
+    }
+    return true;
+}
+
+// Unpacked .gt3x recordings: "Key: value" lines with dates in .NET ticks.
+static bool readInfoTxt(const char * infoFilename, catalog_entry_t * entry){
+    char line[SZ_LINE], * value;
+    long long startTicks = 0, stopTicks = 0, lastSampleTicks = 0;
+    double samplerate = 0;
+    FILE * fid = fopen(infoFilename,"r");
+    if(fid==NULL){
+        return false;
+    }
+    while(fgets(line,SZ_LINE,fid)!=NULL){
+        if((value=strchr(line,':'))==NULL){
+            continue;
+        }
+        *value++ = '\0';
+        while(*value==' '){
+            value++;
+        }
+        if(strcmp(line,"Serial Number")==0) copyField(entry->serialID,value,SZ_SERIALID);
+        else if(strcmp(line,"Firmware")==0) copyField(entry->firmware,value,SZ_FIRMWARE);
+        else if(strcmp(line,"Sample Rate")==0) samplerate = atof(value);
+        else if(strcmp(line,"Start Date")==0) startTicks = atoll(value);
+        else if(strcmp(line,"Stop Date")==0) stopTicks = atoll(value);
+        else if(strcmp(line,"Last Sample Time")==0) lastSampleTicks = atoll(value);
+    }
+    fclose(fid);
+    if(startTicks<=0 || samplerate<=0){
+        return false;
+    }
+    entry->samplerate = samplerate;
+    entry->start = (startTicks-TICKS_TO_1970)/TICKS_PER_SECOND;
+    if(lastSampleTicks>startTicks){
+        entry->duration_sec = (double)(lastSampleTicks-startTicks)/TICKS_PER_SECOND;
+    }
+    else if(stopTicks>startTicks){
+        entry->duration_sec = (double)(stopTicks-startTicks)/TICKS_PER_SECOND;
+        entry->isDurationEstimated = true;
+    }
+    return true;
+}
+
+// @brief Fills the header derived fields of entry; path, mtime and size are left untouched.
+bool readRecordingHeader(const char * path, recording_type_t type, catalog_entry_t * entry){
+    char * infoFilename;
+    entry->isValid = false;
+    entry->isCompressed = false;
+    entry->isDurationEstimated = false;
+    entry->serialID[0] = entry->firmware[0] = '\0';
+    entry->samplerate = 0;
+    entry->start = UNKNOWN_START;
+    entry->duration_sec = 0;
+    switch(type){
+        case RECORDING_BIN:
+            entry->isValid = readBinHeader(path,entry);
+            break;
+        case RECORDING_CSV:
+        case RECORDING_RAW:
+            entry->isValid = readCSVHeader(path,entry->size,entry);
+            break;
+        case RECORDING_GT3X:
+            infoFilename = fullfile((char*)path,GT3X_INFO_FILENAME);
+            entry->isValid = readInfoTxt(infoFilename,entry);
+            free(infoFilename);
+            break;
+        default:
+            break;
+    }
+    return entry->isValid;
+}
+
+/***************
+ *  Scanning
+ ***************/
+static void addCandidate(recording_catalog_t * found, char * path, recording_type_t type, const struct stat * statStruct){
+    catalog_entry_t * entry = appendEntry(found);
+    entry->path = path;
+    entry->type = type;
+    entry->mtime = (int64_t)statStruct->st_mtime;
+    entry->size = (uint64_t)statStruct->st_size;
+}
+
+// Hidden files and directories (leading '.') are skipped, as PABatchTool does.  A directory
+// holding an info.txt is an unpacked .gt3x recording and is not descended into.
+static void walkDirectory(const char * pathname, unsigned int depth, recording_catalog_t * found){
+    DIR * dir;
+    struct dirent * entry;
+    struct stat statStruct;
+    char * childPath, * infoFilename;
+    recording_type_t type;
+
+    infoFilename = fullfile((char*)pathname,GT3X_INFO_FILENAME);
+    if(stat(infoFilename,&statStruct)==0 && S_ISREG(statStruct.st_mode)){
+        addCandidate(found,strdup(pathname),RECORDING_GT3X,&statStruct);
+        free(infoFilename);
+        return;
+    }
+    free(infoFilename);
+    if(depth>MAX_DIRECTORY_DEPTH || (dir=opendir(pathname))==NULL){
+        return;
+    }
+    while((entry=readdir(dir))!=NULL){
+        if(entry->d_name[0]=='.'){
+            continue;
+        }
+        childPath = fullfile((char*)pathname,entry->d_name);
+        if(lstat(childPath,&statStruct)!=0){
+            free(childPath);
+            continue;
+        }
+        if(S_ISDIR(statStruct.st_mode)){
+            walkDirectory(childPath,depth+1,found);
+            free(childPath);
+        }
+        else if(S_ISREG(statStruct.st_mode) && (type=getRecordingType(entry->d_name))!=RECORDING_UNKNOWN){
+            addCandidate(found,childPath,type,&statStruct);
+        }
+        else{
+            free(childPath);
+        }
+    }
+    closedir(dir);
+}
+
+static void parseStaleEntry(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    parse_job_t * job = (parse_job_t*)userData;
+    catalog_entry_t * entry = &job->catalog->entries[job->staleIndices[taskIndex]];
+    (void)workerIndex;
+    readRecordingHeader(entry->path,entry->type,entry);
+}
+
+// @brief Rescans rootPathname.  Entries whose path, mtime and size match the catalog are kept,
+// new or changed recordings have their headers read (in parallel) and missing ones are dropped.
+bool updateCatalog(recording_catalog_t * catalog, const char * rootPathname, unsigned int numWorkers, catalog_update_t * summary){
+    recording_catalog_t found = {NULL,0,0};
+    catalog_entry_t * previous, * current;
+    parse_job_t job;
+    unsigned int e, numStale = 0, numMatched = 0;
+    char * path;
+
+    if(!is_dir((char*)rootPathname)){
+        return false;
+    }
+    walkDirectory(rootPathname,0,&found);
+    qsort(catalog->entries,catalog->count,sizeof(catalog_entry_t),compareEntryPaths);
+
+    job.catalog = &found;
+    job.staleIndices = malloc((found.count>0 ? found.count : 1)*sizeof(unsigned int));
+    for(e=0;e<found.count;e++){
+        current = &found.entries[e];
+        previous = catalog->count ? bsearch(current,catalog->entries,catalog->count,sizeof(catalog_entry_t),compareEntryPaths) : NULL;
+        numMatched += previous!=NULL ? 1 : 0;
+        if(previous!=NULL && previous->mtime==current->mtime && previous->size==current->size && previous->type==current->type){
+            path = current->path;
+            *current = *previous;
+            current->path = path;
+        }
+        else{
+            job.staleIndices[numStale++] = e;
+        }
+    }
+    parallelFor(numStale,numWorkers ? numWorkers : getNumCores(),parseStaleEntry,&job,NULL);
+    free(job.staleIndices);
+
+    if(summary!=NULL){
+        summary->numFound = found.count;
+        summary->numParsed = numStale;
+        summary->numRemoved = catalog->count-numMatched;
+    }
+    freeCatalog(catalog);
+    qsort(found.entries,found.count,sizeof(catalog_entry_t),compareEntryPaths);
+    *catalog = found;
+    return true;
+}
+
+/***************
+ *  Catalog file
+ ***************/
+static char * nextField(char ** cursor){
+    char * field = *cursor, * tab;
+    if(field==NULL){
+        return NULL;
+    }
+    tab = strchr(field,'\t');
+    if(tab!=NULL){
+        *tab = '\0';
+        *cursor = tab+1;
+    }
+    else{
+        field[strcspn(field,"\r\n")] = '\0';
+        *cursor = NULL;
+    }
+    return field;
+}
+
+bool loadCatalog(const char * catalogFilename, recording_catalog_t * catalog){
+    char line[4*SZ_LINE], * cursor, * fields[13];
+    unsigned int f, t;
+    int version = 0;
+    struct tm startTime;
+    catalog_entry_t * entry;
+    FILE * fid = fopen(catalogFilename,"r");
+    memset(catalog,0,sizeof(recording_catalog_t));
+    if(fid==NULL){
+        return false;
+    }
+    if(fgets(line,sizeof(line),fid)==NULL || sscanf(line,"# Padaco recording catalog\t%d",&version)!=1 || version!=CATALOG_VERSION){
+        fclose(fid);
+        return false;
+    }
+    while(fgets(line,sizeof(line),fid)!=NULL){
+        if(line[0]=='#' || strncmp(line,"path\t",5)==0){
+            continue;
+        }
+        cursor = line;
+        for(f=0;f<13 && (fields[f]=nextField(&cursor))!=NULL;f++);
+        if(f<13){
+            continue;
+        }
+        entry = appendEntry(catalog);
+        entry->path = strdup(fields[0]);
+        entry->mtime = strtoll(fields[1],NULL,10);
+        entry->size = strtoull(fields[2],NULL,10);
+        for(t=0;t<NUM_RECORDING_TYPES && strcmp(fields[3],RECORDING_TYPE_NAMES[t])!=0;t++);
+        entry->type = t<NUM_RECORDING_TYPES ? (recording_type_t)t : RECORDING_UNKNOWN;
+        entry->isValid = atoi(fields[4])!=0;
+        entry->isCompressed = atoi(fields[5])!=0;
+        entry->isDurationEstimated = atoi(fields[6])!=0;
+        copyField(entry->serialID,fields[7],SZ_SERIALID);
+        copyField(entry->firmware,fields[8],SZ_FIRMWARE);
+        entry->samplerate = atof(fields[9]);
+        memset(&startTime,0,sizeof(struct tm));
+        if(sscanf(fields[10],"%d-%d-%d %d:%d:%d",&startTime.tm_year,&startTime.tm_mon,&startTime.tm_mday,&startTime.tm_hour,&startTime.tm_min,&startTime.tm_sec)==6){
+            startTime.tm_year -= 1900;
+            startTime.tm_mon -= 1;
+            entry->start = tm2wallclock(&startTime);
+        }
+        entry->duration_sec = atof(fields[12]);
+    }
+    fclose(fid);
+    return true;
+}
+
+// Written to a temporary file first so an interrupted save never leaves a truncated catalog.
+bool saveCatalog(const char * catalogFilename, const recording_catalog_t * catalog){
+    char * tmpFilename = malloc(strlen(catalogFilename)+5), startStr[32];
+    const catalog_entry_t * entry;
+    struct tm startTime;
+    unsigned int e;
+    bool didSave;
+    FILE * fid;
+    sprintf(tmpFilename,"%s.tmp",catalogFilename);
+    if((fid=fopen(tmpFilename,"w"))==NULL){
+        fprintf(stderr,"Could not open catalog for writing: %s\n",tmpFilename);
+        free(tmpFilename);
+        return false;
+    }
+    fprintf(fid,"# Padaco recording catalog\t%d\n%s\n",CATALOG_VERSION,CATALOG_COLUMNS);
+    for(e=0;e<catalog->count;e++){
+        entry = &catalog->entries[e];
+        if(entry->start!=UNKNOWN_START){
+            wallclock2tm(entry->start,&startTime);
+            strftime(startStr,sizeof(startStr),"%Y-%m-%d %H:%M:%S",&startTime);
+        }
+        else{
+            strcpy(startStr,"NA");
+        }
+        fprintf(fid,"%s\t%lld\t%llu\t%s\t%d\t%d\t%d\t%s\t%s\t%.10g\t%s\t%.10f\t%.3f\n",entry->path,(long long)entry->mtime,(unsigned long long)entry->size,
+                RECORDING_TYPE_NAMES[entry->type],entry->isValid,entry->isCompressed,entry->isDurationEstimated,entry->serialID,entry->firmware,entry->samplerate,
+                startStr,entry->start!=UNKNOWN_START ? wallclock2datenum((double)entry->start) : NAN,entry->duration_sec);
+    }
+    didSave = fclose(fid)==0 && rename(tmpFilename,catalogFilename)==0;
+    if(!didSave){
+        fprintf(stderr,"Could not save catalog: %s\n",catalogFilename);
+        remove(tmpFilename);
+    }
+    free(tmpFilename);
+    return didSave;
+}
@@ -0,0 +1,66 @@
+//
+//  catalog.h
+//  Header-only catalog of the recordings found under a directory tree.  Only file headers
+//  are read (ActiGraph .csv/.raw header lines, bin_header_t, unpacked .gt3x info.txt) and
+//  entries are kept on disk, keyed by path, modification time and size, so that rescans
+//  only reopen new or changed recordings.
+//
+
+#ifndef in_catalog_h
+#define in_catalog_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rawtools.h"
+
+#define CATALOG_FILENAME ".padaco_catalog.txt"
+#define CATALOG_VERSION 1
+#define UNKNOWN_START INT64_MIN
+
+typedef enum{
+    RECORDING_UNKNOWN = 0,
+    RECORDING_BIN,
+    RECORDING_CSV,
+    RECORDING_RAW,
+    RECORDING_GT3X,
+    NUM_RECORDING_TYPES
+} recording_type_t;
+
+extern const char * RECORDING_TYPE_NAMES[NUM_RECORDING_TYPES];
+
+typedef struct{
+    char * path;            // file, or directory for unpacked .gt3x recordings
+    int64_t mtime;
+    uint64_t size;
+    recording_type_t type;
+    bool isValid;           // header was recognised
+    bool isCompressed;      // .bin with a compressed payload (see rawcodec.h)
+    bool isDurationEstimated;  // .csv without a parsable final timestamp
+    char serialID[SZ_SERIALID];
+    char firmware[SZ_FIRMWARE];
+    double samplerate;
+    int64_t start;          // wall clock seconds (see tm2wallclock) or UNKNOWN_START
+    double duration_sec;
+} catalog_entry_t;
+
+typedef struct{
+    catalog_entry_t * entries;
+    unsigned int count;
+    unsigned int capacity;
+} recording_catalog_t;
+
+typedef struct{
+    unsigned int numFound;
+    unsigned int numParsed;   // new or changed since the last scan
+    unsigned int numRemoved;
+} catalog_update_t;
+
+bool loadCatalog(const char * catalogFilename, recording_catalog_t * catalog);
+bool saveCatalog(const char * catalogFilename, const recording_catalog_t * catalog);
+bool updateCatalog(recording_catalog_t * catalog, const char * rootPathname, unsigned int numWorkers, catalog_update_t * summary);
+void freeCatalog(recording_catalog_t * catalog);
+
+bool readRecordingHeader(const char * path, recording_type_t type, catalog_entry_t * entry);
+recording_type_t getRecordingType(const char * filename);
+
+#endif /* in_catalog_h */
@@ -0,0 +1,98 @@
+/*
+ * catalogrecordings.c - refresh and return the recording catalog of a directory tree.
+ *
+ * The calling syntax is:
+ *
+ *		catalog = catalogrecordings(pathname)
+ *		catalog = catalogrecordings(pathname, catalogFilename)
+ *
+ * catalog is a struct of column vectors (cell arrays for text) with one row per recording:
+ * path, type, isValid, isCompressed, serialID, firmware, samplerate, startDatenum and
+ * durationSec.  Only recordings that are new or changed since the last call have their
+ * headers read; the catalog is saved to <pathname>/.padaco_catalog.txt by default.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O catalogrecordings.c catalog.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <math.h>
+#include "mex.h"
+#include "catalog.h"
+
+static const char * FIELD_NAMES[] = {"path","type","isValid","isCompressed","serialID","firmware","samplerate","startDatenum","durationSec"};
+#define NUM_FIELDS (sizeof(FIELD_NAMES)/sizeof(FIELD_NAMES[0]))
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * rootPathname, * catalogFilename;
+    recording_catalog_t catalog;
+    catalog_entry_t * entry;
+    mxArray * paths, * types, * serialIDs, * firmwares, * isValid, * isCompressed, * samplerates, * startDatenums, * durations;
+    unsigned int e;
+
+    if(nrhs < 1 || nrhs > 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:catalogrecordings:nrhs",
+                "A pathname, and optionally a catalog filename, are required for input.");
+    }
+    rootPathname = mxArrayToString(prhs[0]);
+    if(rootPathname==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:catalogrecordings:pathname",
+                "The pathname must be a string.");
+    }
+    catalogFilename = nrhs==2 ? mxArrayToString(prhs[1]) : fullfile(rootPathname,CATALOG_FILENAME);
+
+    loadCatalog(catalogFilename,&catalog);
+    if(!updateCatalog(&catalog,rootPathname,0,NULL)) {
+        freeCatalog(&catalog);
+        mexErrMsgIdAndTxt("PadacoToolbox:catalogrecordings:pathname",
+                "The pathname is not a directory.");
+    }
+    if(!saveCatalog(catalogFilename,&catalog)) {
+        mexWarnMsgIdAndTxt("PadacoToolbox:catalogrecordings:save",
+                "The catalog could not be saved.");
+    }
+    if(nrhs==2) {
+        mxFree(catalogFilename);
+    }
+    else {
+        free(catalogFilename);
+    }
+    mxFree(rootPathname);
+
+    paths = mxCreateCellMatrix(catalog.count,1);
+    types = mxCreateCellMatrix(catalog.count,1);
+    serialIDs = mxCreateCellMatrix(catalog.count,1);
+    firmwares = mxCreateCellMatrix(catalog.count,1);
+    isValid = mxCreateDoubleMatrix(catalog.count,1,mxREAL);
+    isCompressed = mxCreateDoubleMatrix(catalog.count,1,mxREAL);
+    samplerates = mxCreateDoubleMatrix(catalog.count,1,mxREAL);
+    startDatenums = mxCreateDoubleMatrix(catalog.count,1,mxREAL);
+    durations = mxCreateDoubleMatrix(catalog.count,1,mxREAL);
+    for(e=0;e<catalog.count;e++) {
+        entry = &catalog.entries[e];
+        mxSetCell(paths,e,mxCreateString(entry->path));
+        mxSetCell(types,e,mxCreateString(RECORDING_TYPE_NAMES[entry->type]));
+        mxSetCell(serialIDs,e,mxCreateString(entry->serialID));
+        mxSetCell(firmwares,e,mxCreateString(entry->firmware));
+        mxGetPr(isValid)[e] = entry->isValid;
+        mxGetPr(isCompressed)[e] = entry->isCompressed;
+        mxGetPr(samplerates)[e] = entry->samplerate;
+        mxGetPr(startDatenums)[e] = entry->start!=UNKNOWN_START ? wallclock2datenum((double)entry->start) : NAN;
+        mxGetPr(durations)[e] = entry->duration_sec;
+    }
+    freeCatalog(&catalog);
+
+    plhs[0] = mxCreateStructMatrix(1,1,NUM_FIELDS,FIELD_NAMES);
+    mxSetField(plhs[0],0,"path",paths);
+    mxSetField(plhs[0],0,"type",types);
+    mxSetField(plhs[0],0,"isValid",isValid);
+    mxSetField(plhs[0],0,"isCompressed",isCompressed);
+    mxSetField(plhs[0],0,"serialID",serialIDs);
+    mxSetField(plhs[0],0,"firmware",firmwares);
+    mxSetField(plhs[0],0,"samplerate",samplerates);
+    mxSetField(plhs[0],0,"startDatenum",startDatenums);
+    mxSetField(plhs[0],0,"durationSec",durations);
+}
@@ -0,0 +1,277 @@
+//
+//  classifyusage.c
+//
+//  Events are [start, stop] sample pairs (inclusive, zero based) - the zero based
+//  equivalent of PAData.thresholdcrossings output.
+//
+
+#include "classifyusage.h"
+#include "in_parallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct{
+    uint64_t start;
+    uint64_t stop;
+} usage_event_t;
+
+typedef struct{
+    usage_event_t * events;
+    uint64_t count;
+} usage_events_t;
+
+void getDefaultUsageRules(usage_rules_t * rules){
+    rules->longFilterLengthMinutes = 5;
+    rules->shortFilterLengthMinutes = 1;
+    rules->workingGravitiesPerMinuteCutoff = 0;
+    rules->excessiveGravitiesPerMinuteCutoff = 4;
+    rules->minMinutesForStuck = 1;
+    rules->mergeWithinHoursForStudyOver = 6;
+    rules->minHoursForStudyOver = 2;
+    rules->mergeWithinHoursOfStudyNotStarted = 4;
+    rules->sampleRate = 1;
+}
+
+// Equivalent of PADataAnalysis.movingSummer: a running sum over filterOrder samples, shifted back
+// by half the filter delay with the tail zero filled.  Sums of float samples are exact in double
+// precision for accelerometer ranges, so the running add/subtract does not drift and equality
+// tests on the result (stuck sensor detection) behave like MATLAB's filter().
+static double * movingSummer(const float * signal, uint64_t numSamples, uint64_t filterOrder){
+    double * summed = calloc(numSamples,sizeof(double));
+    double runningSum = 0;
+    uint64_t delay = filterOrder/2, i;
+    for(i=0;i<numSamples;i++){
+        runningSum += signal[i];
+        if(i>=filterOrder){
+            runningSum -= signal[i-filterOrder];
+        }
+        if(i>=delay){
+            summed[i-delay] = runningSum;
+        }
+    }
+    return summed;
+}
+
+static usage_events_t thresholdCrossings(const bool * isOn, uint64_t numSamples){
+    usage_events_t events = {NULL,0};
+    uint64_t i, capacity = 0;
+    for(i=0;i<numSamples;i++){
+        if(isOn[i]){
+            if(i>0 && isOn[i-1]){
+                events.events[events.count-1].stop = i;
+            }
+            else{
+                if(events.count==capacity){
+                    capacity = capacity ? capacity*2 : 64;
+                    events.events = realloc(events.events,capacity*sizeof(usage_event_t));
+                }
+                events.events[events.count].start = i;
+                events.events[events.count].stop = i;
+                events.count++;
+            }
+        }
+    }
+    return events;
+}
+
+// PAData.merge_nearby_events; merges in place.
+static void mergeNearbyEvents(usage_events_t * events, double minSamples){
+    uint64_t k, numOut = 0;
+    for(k=1;k<events->count;k++){
+        if((double)events->events[k].start-events->events[numOut].stop<minSamples){
+            events->events[numOut].stop = events->events[k].stop;
+        }
+        else{
+            events->events[++numOut] = events->events[k];
+        }
+    }
+    if(events->count>0){
+        events->count = numOut+1;
+    }
+}
+
+static void keepEventsLongerThan(usage_events_t * events, double minDuration, double sampleRate){
+    uint64_t k, numOut = 0;
+    for(k=0;k<events->count;k++){
+        if((events->events[k].stop-events->events[k].start)/sampleRate>=minDuration){
+            events->events[numOut++] = events->events[k];
+        }
+    }
+    events->count = numOut;
+}
+
+static void unrollEvents(const usage_events_t * events, int8_t * usageVec, int8_t usageTag){
+    uint64_t k, i;
+    for(k=0;k<events->count;k++){
+        for(i=events->events[k].start;i<=events->events[k].stop;i++){
+            usageVec[i] = usageTag;
+        }
+    }
+}
+
+bool classifyUsageState(const float * gravityVec, uint64_t numSamples, const usage_rules_t * rules, int8_t * usageVec){
+    double samplesPerMinute = rules->sampleRate*60, samplesPerHour = samplesPerMinute*60;
+    uint64_t longFilterLength = (uint64_t)llround(rules->longFilterLengthMinutes*samplesPerMinute);
+    uint64_t shortFilterLength = (uint64_t)llround(rules->shortFilterLengthMinutes*samplesPerMinute);
+    uint64_t i, halfShort = shortFilterLength/2;
+    double * longSum, * shortSum, burstThreshold, notWorkingThreshold;
+    bool * isOn;
+    usage_events_t stuckEvents, burstEvents, notWorkingEvents, studyOverEvents = {NULL,0}, notStartedEvents = {NULL,0};
+
+    if(numSamples<2 || longFilterLength==0 || shortFilterLength==0){
+        return false;
+    }
+    longSum = movingSummer(gravityVec,numSamples,longFilterLength);
+    shortSum = movingSummer(gravityVec,numSamples,shortFilterLength);
+    isOn = malloc(numSamples*sizeof(bool));
+
+    // Stuck sensor: consecutive short sums that do not change (and are not zero)
+    for(i=0;i<numSamples-1;i++){
+        isOn[i] = shortSum[i+1]==shortSum[i] && shortSum[i+1]!=0;
+    }
+    stuckEvents = thresholdCrossings(isOn,numSamples-1);
+    if(rules->minMinutesForStuck>0){
+        keepEventsLongerThan(&stuckEvents,rules->minMinutesForStuck*60,rules->sampleRate);
+    }
+
+    // Bursts: excessive gravities, padded by half the short filter on either side
+    burstThreshold = rules->excessiveGravitiesPerMinuteCutoff*shortFilterLength;
+    for(i=0;i<numSamples;i++){
+        isOn[i] = shortSum[i]>burstThreshold;
+    }
+    burstEvents = thresholdCrossings(isOn,numSamples);
+    for(i=0;i<burstEvents.count;i++){
+        burstEvents.events[i].start = burstEvents.events[i].start>halfShort ? burstEvents.events[i].start-halfShort : 0;
+        burstEvents.events[i].stop = burstEvents.events[i].stop+halfShort<numSamples ? burstEvents.events[i].stop+halfShort : numSamples-1;
+    }
+
+    // Not working: no gravities over the long filter
+    notWorkingThreshold = rules->shortFilterLengthMinutes*rules->workingGravitiesPerMinuteCutoff;
+    for(i=0;i<numSamples;i++){
+        isOn[i] = !(longSum[i]>notWorkingThreshold);
+    }
+    notWorkingEvents = thresholdCrossings(isOn,numSamples);
+
+    if(notWorkingEvents.count>0){
+        studyOverEvents.events = malloc(notWorkingEvents.count*sizeof(usage_event_t));
+        memcpy(studyOverEvents.events,notWorkingEvents.events,notWorkingEvents.count*sizeof(usage_event_t));
+        studyOverEvents.count = notWorkingEvents.count;
+        mergeNearbyEvents(&studyOverEvents,round(rules->mergeWithinHoursForStudyOver*samplesPerHour*rules->sampleRate));
+        keepEventsLongerThan(&studyOverEvents,rules->minHoursForStudyOver*samplesPerHour,rules->sampleRate);
+
+        if(studyOverEvents.count>0){
+            // Only one section of study over (the last) and of not started (the first), and
+            // only when they are close enough to the end and start of the study respectively.
+            notStartedEvents.events = malloc(sizeof(usage_event_t));
+            notStartedEvents.events[0] = studyOverEvents.events[0];
+            notStartedEvents.count = 1;
+            studyOverEvents.events[0] = studyOverEvents.events[studyOverEvents.count-1];
+            studyOverEvents.count = 1;
+
+            if((numSamples-(studyOverEvents.events[0].stop+1.0))/samplesPerHour<=rules->mergeWithinHoursForStudyOver){
+                studyOverEvents.events[0].stop = numSamples-1;
+            }
+            else{
+                studyOverEvents.count = 0;
+            }
+            if((notStartedEvents.events[0].start+1.0)/samplesPerHour<=rules->mergeWithinHoursOfStudyNotStarted){
+                notStartedEvents.events[0].start = 0;
+            }
+            else{
+                notStartedEvents.count = 0;
+            }
+        }
+    }
+
+    for(i=0;i<numSamples;i++){
+        usageVec[i] = isOn[i] ? USAGE_NOT_WORKING : USAGE_WORKING;
+    }
+    unrollEvents(&studyOverEvents,usageVec,USAGE_STUDYOVER);
+    unrollEvents(&notStartedEvents,usageVec,USAGE_STUDY_NOT_STARTED);
+    unrollEvents(&burstEvents,usageVec,USAGE_SENSOR_BURST);
+    unrollEvents(&stuckEvents,usageVec,USAGE_SENSOR_STUCK);
+
+    free(longSum);
+    free(shortSum);
+    free(isOn);
+    free(stuckEvents.events);
+    free(burstEvents.events);
+    free(notWorkingEvents.events);
+    free(studyOverEvents.events);
+    free(notStartedEvents.events);
+    return true;
+}
+
+void propagateStuckUsage(int8_t * vecMagUsage, const int8_t * xUsage, const int8_t * yUsage, const int8_t * zUsage, uint64_t numSamples){
+    uint64_t i;
+    for(i=0;i<numSamples;i++){
+        if(xUsage[i]==USAGE_SENSOR_STUCK || yUsage[i]==USAGE_SENSOR_STUCK || zUsage[i]==USAGE_SENSOR_STUCK){
+            vecMagUsage[i] = USAGE_SENSOR_STUCK;
+        }
+    }
+}
+
+bool splitRawSignals(const float * accelerations, uint64_t numRecords, float * const signals[USAGE_NUM_SIGNALS], volatile bool * keepRunning){
+    uint64_t i, stop;
+    float x, y, z;
+    for(i=0;i<numRecords;){
+        if(keepRunning!=NULL && !*keepRunning){
+            return false;
+        }
+        stop = i+USAGE_SPLIT_BLOCK_RECORDS<numRecords ? i+USAGE_SPLIT_BLOCK_RECORDS : numRecords;
+        for(;i<stop;i++){
+            x = accelerations[3*i];
+            y = accelerations[3*i+1];
+            z = accelerations[3*i+2];
+            signals[0][i] = x;
+            signals[1][i] = y;
+            signals[2][i] = z;
+            signals[3][i] = sqrtf(x*x+y*y+z*z);
+        }
+    }
+    return true;
+}
+
+typedef struct{
+    float * const * signals;
+    int8_t * const * usage;
+    uint64_t numRecords;
+    usage_rules_t rules;
+    usage_signal_fcn onSignalDone;
+    void * userData;
+} raw_usage_job_t;
+
+static void classifyRawSignal(unsigned int signal, unsigned int workerIndex, void * userData){
+    raw_usage_job_t * job = (raw_usage_job_t*)userData;
+    (void)workerIndex;
+    if(!classifyUsageState(job->signals[signal],job->numRecords,&job->rules,job->usage[signal])){
+        memset(job->usage[signal],0,job->numRecords*sizeof(int8_t));
+    }
+    if(job->onSignalDone!=NULL){
+        job->onSignalDone(signal,job->userData);
+    }
+}
+
+bool classifyRawUsage(float * const signals[USAGE_NUM_SIGNALS], int8_t * const usage[USAGE_NUM_SIGNALS], uint64_t numRecords,
+                      const usage_rules_t * rules, unsigned int numWorkers, usage_signal_fcn onSignalDone, void * userData,
+                      volatile bool * keepRunning){
+    raw_usage_job_t job;
+    job.signals = signals;
+    job.usage = usage;
+    job.numRecords = numRecords;
+    if(rules==NULL){
+        getDefaultUsageRules(&job.rules);
+    }
+    else{
+        job.rules = *rules;
+    }
+    job.onSignalDone = onSignalDone;
+    job.userData = userData;
+    if(parallelFor(USAGE_NUM_SIGNALS,numWorkers==0 ? USAGE_NUM_SIGNALS : numWorkers,classifyRawSignal,&job,keepRunning)<USAGE_NUM_SIGNALS ||
+       (keepRunning!=NULL && !*keepRunning)){
+        return false;
+    }
+    propagateStuckUsage(usage[3],usage[0],usage[1],usage[2],numRecords);
+    return true;
+}
@@ -0,0 +1,69 @@
+//
+//  classifyusage.h
+//
+//  Native port of PAClassifyGravities.classifyUsageState, the usage state rules Padaco
+//  applies to raw (gravity) signals.
+//
+
+#ifndef in_classifyusage_h
+#define in_classifyusage_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// PAClassifyUsage.getActivityTags()
+#define USAGE_WORKING 10
+#define USAGE_NONWEAR 5
+#define USAGE_NOT_WORKING 5
+#define USAGE_STUDYOVER 0
+#define USAGE_STUDY_NOT_STARTED 1
+#define USAGE_UNKNOWN -1
+#define USAGE_SENSOR_BURST 45
+#define USAGE_SENSOR_STUCK 50
+
+// PAClassifyGravities.getDefaults()
+typedef struct{
+    double longFilterLengthMinutes;
+    double shortFilterLengthMinutes;
+    double workingGravitiesPerMinuteCutoff;
+    double excessiveGravitiesPerMinuteCutoff;
+    double minMinutesForStuck;
+    double mergeWithinHoursForStudyOver;
+    double minHoursForStudyOver;
+    double mergeWithinHoursOfStudyNotStarted;
+    // The classifier's own sample rate setting (not the device's); PASensorData does not
+    // override the default of 1 so neither do we.
+    double sampleRate;
+} usage_rules_t;
+
+void getDefaultUsageRules(usage_rules_t * rules);
+
+// Classifies each sample of gravityVec; usageVec must hold numSamples values.
+bool classifyUsageState(const float * gravityVec, uint64_t numSamples, const usage_rules_t * rules, int8_t * usageVec);
+
+// Marks vecMag samples as stuck wherever any of the x, y, z axes is stuck
+// (as done at the end of PASensorData.classifyUsageForAllAxes)
+void propagateStuckUsage(int8_t * vecMagUsage, const int8_t * xUsage, const int8_t * yUsage, const int8_t * zUsage, uint64_t numSamples);
+
+// The decode and classify steps every loader of a raw study shares (padacobatch, the study
+// cache and the background loader), on x, y, z and vector magnitude signals.
+#define USAGE_NUM_SIGNALS 4
+#define USAGE_SPLIT_BLOCK_RECORDS (1<<20)
+
+// Called from a worker as each signal's usage is classified.
+typedef void (*usage_signal_fcn)(unsigned int signal, void * userData);
+
+// Splits interleaved x, y, z accelerations into x, y, z and vector magnitude signals of
+// numRecords floats each.  keepRunning (may be NULL) is checked between blocks of
+// USAGE_SPLIT_BLOCK_RECORDS records.  @retval false if stopped by keepRunning.
+bool splitRawSignals(const float * accelerations, uint64_t numRecords, float * const signals[USAGE_NUM_SIGNALS], volatile bool * keepRunning);
+
+// Classifies the usage of each signal with rules (NULL => getDefaultUsageRules), a signal
+// per worker (numWorkers 0 => USAGE_NUM_SIGNALS), then propagates stuck samples to vecMag.
+// A signal that cannot be classified gets usage 0.  onSignalDone may be NULL.
+// @retval false if stopped by keepRunning (may be NULL) before every signal was classified.
+bool classifyRawUsage(float * const signals[USAGE_NUM_SIGNALS], int8_t * const usage[USAGE_NUM_SIGNALS], uint64_t numRecords,
+                      const usage_rules_t * rules, unsigned int numWorkers, usage_signal_fcn onSignalDone, void * userData,
+                      volatile bool * keepRunning);
+
+#endif /* in_classifyusage_h */
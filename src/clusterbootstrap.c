@@ -0,0 +1,696 @@
+//
+//  clusterbootstrap.c
+//  Parallel bootstrap of adaptive k-means clustering.  See clusterbootstrap.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include "clusterbootstrap.h"
+#include "in_parallel.h"
+
+#define SZ_RESULTS_LINE 512
+#define RESULTS_COLUMNS "replicate,seed,clusterCount,silhouetteIndex,calinskiIndex\n"
+
+const char * BOOTSTRAP_SAMPLE_NAMES[NUM_BOOTSTRAP_SAMPLES] = {"days","studyID"};
+
+// Weighted rows of the shared shapes.
+typedef struct{
+    uint32_t * rows;
+    double * weights;
+    unsigned int numPoints;
+    double totalWeight;
+} point_set_t;
+
+// k-means state of a point set.
+typedef struct{
+    double * centroids;         // capacity x numDims, row by row
+    unsigned int capacity;
+    uint32_t * assignments;
+    double * distances;         // to the assigned centroid
+    double * clusterWeights;
+} kmeans_t;
+
+// splitmix64
+static uint64_t nextRandom(uint64_t * state){
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double nextUniform(uint64_t * state){
+    return (double)(nextRandom(state) >> 11) * (1.0/9007199254740992.0);
+}
+
+static uint32_t nextIndex(uint64_t * state, uint32_t n){
+    uint32_t index = (uint32_t)(nextUniform(state)*n);
+    return index<n ? index : n-1;
+}
+
+uint64_t getReplicateSeed(uint64_t seed, unsigned int replicate){
+    uint64_t state = seed ^ (0xD1B54A32D192ED03ULL*((uint64_t)replicate+1));
+    return nextRandom(&state);
+}
+
+static double squaredDistance(const double * a, const double * b, unsigned int numDims){
+    double sum = 0, difference;
+    unsigned int d;
+    for(d=0;d<numDims;d++){
+        difference = a[d]-b[d];
+        sum += difference*difference;
+    }
+    return sum;
+}
+
+static double squaredNorm(const double * a, unsigned int numDims){
+    double sum = 0;
+    unsigned int d;
+    for(d=0;d<numDims;d++){
+        sum += a[d]*a[d];
+    }
+    return sum;
+}
+
+static const double * getShape(const bootstrap_run_t * run, uint32_t row){
+    return run->shapes+(size_t)row*run->numDims;
+}
+
+static bool reserveCentroids(kmeans_t * km, unsigned int numCentroids, unsigned int numDims){
+    double * centroids;
+    if(numCentroids>km->capacity){
+        centroids = realloc(km->centroids,(size_t)numCentroids*numDims*sizeof(double));
+        if(centroids==NULL){
+            return false;
+        }
+        km->centroids = centroids;
+        km->capacity = numCentroids;
+    }
+    return true;
+}
+
+// Draws a point with probability proportional to scores (which sum to total).
+static unsigned int drawPoint(const double * scores, unsigned int numPoints, double total, uint64_t * rng){
+    double target = nextUniform(rng)*total, cumulative = 0;
+    unsigned int p;
+    for(p=0;p<numPoints;p++){
+        cumulative += scores[p];
+        if(target<cumulative && scores[p]>0){
+            return p;
+        }
+    }
+    for(p=numPoints;p>0;p--){
+        if(scores[p-1]>0){
+            return p-1;
+        }
+    }
+    return 0;
+}
+
+// Starting centroids: k-means++ (kmeans' default 'plus'), or distinct shapes drawn at
+// random when usePermutation.  @retval false if there are fewer distinct points than K.
+static bool seedCentroids(const bootstrap_run_t * run, const point_set_t * points, unsigned int K, bool usePermutation,
+                          double * centroids, double * scores, uint64_t * rng){
+    unsigned int numDims = run->numDims, p, k, chosen;
+    double total;
+    if(K>points->numPoints){
+        return false;
+    }
+    memcpy(scores,points->weights,points->numPoints*sizeof(double));
+    total = points->totalWeight;
+    for(k=0;k<K;k++){
+        if(!(total>0)){
+            return false;
+        }
+        chosen = drawPoint(scores,points->numPoints,total,rng);
+        memcpy(centroids+(size_t)k*numDims,getShape(run,points->rows[chosen]),numDims*sizeof(double));
+        total = 0;
+        for(p=0;p<points->numPoints;p++){
+            if(p==chosen){
+                scores[p] = 0;
+            }
+            else if(!usePermutation){
+                // weight times the squared distance to the nearest chosen centroid
+                double distance = points->weights[p]*squaredDistance(getShape(run,points->rows[p]),centroids+(size_t)k*numDims,numDims);
+                if(k==0 || distance<scores[p]){
+                    scores[p] = distance;
+                }
+            }
+            total += scores[p];
+        }
+    }
+    return true;
+}
+
+static bool assignPoints(const bootstrap_run_t * run, const point_set_t * points, unsigned int K, kmeans_t * km){
+    unsigned int numDims = run->numDims, p, k, best;
+    const double * shape;
+    double distance, bestDistance;
+    bool didChange = false;
+    for(p=0;p<points->numPoints;p++){
+        shape = getShape(run,points->rows[p]);
+        best = 0;
+        bestDistance = squaredDistance(shape,km->centroids,numDims);
+        for(k=1;k<K;k++){
+            distance = squaredDistance(shape,km->centroids+(size_t)k*numDims,numDims);
+            if(distance<bestDistance){
+                bestDistance = distance;
+                best = k;
+            }
+        }
+        didChange = didChange || km->assignments[p]!=best;
+        km->assignments[p] = best;
+        km->distances[p] = bestDistance;
+    }
+    return didChange;
+}
+
+// Weighted means of the assigned points; an empty cluster takes the point farthest from
+// its centroid (kmeans' 'singleton' empty action).
+static void updateCentroids(const bootstrap_run_t * run, const point_set_t * points, unsigned int K, kmeans_t * km){
+    unsigned int numDims = run->numDims, p, k, d, farthest;
+    const double * shape;
+    double * centroid, farthestDistance;
+    memset(km->centroids,0,(size_t)K*numDims*sizeof(double));
+    memset(km->clusterWeights,0,K*sizeof(double));
+    for(p=0;p<points->numPoints;p++){
+        shape = getShape(run,points->rows[p]);
+        centroid = km->centroids+(size_t)km->assignments[p]*numDims;
+        for(d=0;d<numDims;d++){
+            centroid[d] += points->weights[p]*shape[d];
+        }
+        km->clusterWeights[km->assignments[p]] += points->weights[p];
+    }
+    for(k=0;k<K;k++){
+        centroid = km->centroids+(size_t)k*numDims;
+        for(d=0;d<numDims && km->clusterWeights[k]>0;d++){
+            centroid[d] /= km->clusterWeights[k];
+        }
+    }
+    for(k=0;k<K;k++){
+        if(km->clusterWeights[k]>0){
+            continue;
+        }
+        centroid = km->centroids+(size_t)k*numDims;
+        farthest = points->numPoints;
+        farthestDistance = -1;
+        for(p=0;p<points->numPoints;p++){
+            if(km->distances[p]>farthestDistance && km->clusterWeights[km->assignments[p]]>points->weights[p]){
+                farthest = p;
+                farthestDistance = km->distances[p];
+            }
+        }
+        if(farthest<points->numPoints){
+            memcpy(centroid,getShape(run,points->rows[farthest]),numDims*sizeof(double));
+            km->clusterWeights[km->assignments[farthest]] -= points->weights[farthest];
+            km->clusterWeights[k] = points->weights[farthest];
+            km->assignments[farthest] = k;
+            km->distances[farthest] = 0;
+        }
+    }
+}
+
+// Batch k-means from the centroids in km.  Leaves assignments and distances matching the
+// centroids.
+static void runKmeans(const bootstrap_run_t * run, const point_set_t * points, unsigned int K, kmeans_t * km){
+    unsigned int iteration;
+    memset(km->assignments,0xFF,points->numPoints*sizeof(uint32_t));
+    for(iteration=0;assignPoints(run,points,K,km) && iteration<BOOTSTRAP_MAX_ITERATIONS;iteration++){
+        updateCentroids(run,points,K,km);
+    }
+}
+
+static bool allocKmeans(kmeans_t * km, unsigned int numPoints){
+    memset(km,0,sizeof(kmeans_t));
+    km->assignments = malloc(numPoints*sizeof(uint32_t));
+    km->distances = malloc(numPoints*sizeof(double));
+    return km->assignments!=NULL && km->distances!=NULL;
+}
+
+static void freeKmeans(kmeans_t * km){
+    free(km->centroids);
+    free(km->assignments);
+    free(km->distances);
+    free(km->clusterWeights);
+}
+
+// Splits cluster k of km in two with 2-means of its members, writing two centroids to
+// split.  @retval false if the cluster has a single distinct member.
+static bool splitCluster(const bootstrap_run_t * run, const point_set_t * points, const kmeans_t * km, unsigned int k,
+                         double * split, double * scores, uint64_t * rng){
+    point_set_t members;
+    kmeans_t memberKm;
+    unsigned int p, numMembers = 0;
+    bool didSplit = false;
+
+    members.rows = malloc(points->numPoints*sizeof(uint32_t));
+    members.weights = malloc(points->numPoints*sizeof(double));
+    members.totalWeight = 0;
+    for(p=0;p<points->numPoints;p++){
+        if(km->assignments[p]==k){
+            members.rows[numMembers] = points->rows[p];
+            members.weights[numMembers] = points->weights[p];
+            members.totalWeight += points->weights[p];
+            numMembers++;
+        }
+    }
+    members.numPoints = numMembers;
+    if(numMembers>1 && allocKmeans(&memberKm,numMembers)){
+        memberKm.clusterWeights = calloc(2,sizeof(double));
+        if(reserveCentroids(&memberKm,2,run->numDims) && seedCentroids(run,&members,2,run->settings.initClusterWithPermutation,memberKm.centroids,scores,rng)){
+            runKmeans(run,&members,2,&memberKm);
+            memcpy(split,memberKm.centroids,2*run->numDims*sizeof(double));
+            didSplit = true;
+        }
+        freeKmeans(&memberKm);
+    }
+    free(members.rows);
+    free(members.weights);
+    return didSplit;
+}
+
+// PACluster.adaptiveKclusters over a point set.  @retval K, or 0 if it did not converge
+// or was cancelled.
+static unsigned int clusterAdaptively(const bootstrap_run_t * run, const point_set_t * points, kmeans_t * km, uint64_t * rng){
+    unsigned int numDims = run->numDims, K = run->settings.minClusters, maxClusters, numNotCloseEnough, numKept, k, p;
+    double * scores = malloc(points->numPoints*sizeof(double)), * next = NULL, norm;
+    bool * notCloseEnough = NULL, isFirst = true, didFail = false;
+
+    // as PACluster limits K to between 1 and half the shapes
+    maxClusters = (unsigned int)ceil(points->totalWeight/2);
+    if(K>floor(points->totalWeight/2)){
+        K = (unsigned int)floor(points->totalWeight/2);
+    }
+    K = K>0 ? K : 1;
+    numNotCloseEnough = K;
+    while(numNotCloseEnough>0 && K<=maxClusters && run->keepRunning && !didFail){
+        if(!reserveCentroids(km,2*K,numDims) || (km->clusterWeights=realloc(km->clusterWeights,2*K*sizeof(double)))==NULL
+           || (notCloseEnough=realloc(notCloseEnough,K*sizeof(bool)))==NULL || (next=realloc(next,(size_t)2*K*numDims*sizeof(double)))==NULL){
+            didFail = true;
+            break;
+        }
+        if(isFirst){
+            if(!seedCentroids(run,points,K,run->settings.initClusterWithPermutation,km->centroids,scores,rng)){
+                didFail = true;
+                break;
+            }
+            isFirst = false;
+        }
+        runKmeans(run,points,K,km);
+
+        // clusters with a member farther than the threshold times the centroid's squared norm
+        memset(notCloseEnough,0,K*sizeof(bool));
+        for(p=0;p<points->numPoints;p++){
+            k = km->assignments[p];
+            norm = squaredNorm(km->centroids+(size_t)k*numDims,numDims);
+            if(km->distances[p]>run->settings.clusterThreshold*norm){
+                notCloseEnough[k] = true;
+            }
+        }
+        numNotCloseEnough = 0;
+        numKept = 0;
+        for(k=0;k<K;k++){
+            if(notCloseEnough[k]){
+                numNotCloseEnough++;
+            }
+            else{
+                memcpy(next+(size_t)numKept++*numDims,km->centroids+(size_t)k*numDims,numDims*sizeof(double));
+            }
+        }
+        if(numNotCloseEnough>0){
+            for(k=0;k<K;k++){
+                if(!notCloseEnough[k]){
+                    continue;
+                }
+                if(splitCluster(run,points,km,k,next+(size_t)numKept*numDims,scores,rng)){
+                    numKept += 2;
+                }
+                else{
+                    // a lone shape becomes its own centroid
+                    for(p=0;km->assignments[p]!=k;p++);
+                    memcpy(next+(size_t)numKept++*numDims,getShape(run,points->rows[p]),numDims*sizeof(double));
+                    numNotCloseEnough--;
+                }
+            }
+            K += numNotCloseEnough;
+            memcpy(km->centroids,next,(size_t)K*numDims*sizeof(double));
+            if(K>points->numPoints){
+                didFail = true;
+                break;
+            }
+        }
+    }
+    free(scores);
+    free(next);
+    free(notCloseEnough);
+    return didFail || numNotCloseEnough>0 || !run->keepRunning ? 0 : K;
+}
+
+// Calinski-Harabasz index as utility/calinski.m computes it (between cluster scatter about
+// the mean of the centroids), and the mean silhouette with squared euclidean distances.
+static void scoreClusters(const bootstrap_run_t * run, const point_set_t * points, const kmeans_t * km, unsigned int K, bootstrap_result_t * result){
+    unsigned int numDims = run->numDims, p, k, d, own;
+    double * centroidMean = calloc(numDims,sizeof(double));
+    double * weights = calloc(K,sizeof(double)), * sums = calloc((size_t)K*numDims,sizeof(double)), * sumSquares = calloc(K,sizeof(double));
+    double ssWithin = 0, ssBetween = 0, silhouette = 0, shapeNorm, dot, meanDistance, within, between;
+    const double * shape, * centroid;
+
+    for(p=0;p<points->numPoints;p++){
+        k = km->assignments[p];
+        shape = getShape(run,points->rows[p]);
+        shapeNorm = squaredNorm(shape,numDims);
+        weights[k] += points->weights[p];
+        sumSquares[k] += points->weights[p]*shapeNorm;
+        for(d=0;d<numDims;d++){
+            sums[(size_t)k*numDims+d] += points->weights[p]*shape[d];
+        }
+        ssWithin += points->weights[p]*km->distances[p];
+    }
+    for(k=0;k<K;k++){
+        for(d=0;d<numDims;d++){
+            centroidMean[d] += km->centroids[(size_t)k*numDims+d]/K;
+        }
+    }
+    for(k=0;k<K;k++){
+        ssBetween += weights[k]*squaredDistance(km->centroids+(size_t)k*numDims,centroidMean,numDims);
+    }
+    result->calinskiIndex = ssBetween/ssWithin*(points->totalWeight-K)/(K-1.0);
+
+    // sum_j w_j |x - x_j|^2 = W_k |x|^2 - 2 x.S_k + Q_k for each cluster k
+    for(p=0;p<points->numPoints;p++){
+        own = km->assignments[p];
+        shape = getShape(run,points->rows[p]);
+        shapeNorm = squaredNorm(shape,numDims);
+        within = 0;
+        between = INFINITY;
+        for(k=0;k<K;k++){
+            if(weights[k]<=0 || (k==own && weights[k]<=1)){
+                continue;
+            }
+            centroid = sums+(size_t)k*numDims;
+            for(dot=0,d=0;d<numDims;d++){
+                dot += shape[d]*centroid[d];
+            }
+            meanDistance = fmax(weights[k]*shapeNorm-2*dot+sumSquares[k],0)/(k==own ? weights[k]-1 : weights[k]);
+            if(k==own){
+                within = meanDistance;
+            }
+            else if(meanDistance<between){
+                between = meanDistance;
+            }
+        }
+        if(weights[own]>1 && isfinite(between) && fmax(within,between)>0){
+            silhouette += points->weights[p]*(between-within)/fmax(within,between);
+        }
+    }
+    result->silhouetteIndex = silhouette/points->totalWeight;
+    result->clusterCount = K;
+
+    free(centroidMean);
+    free(weights);
+    free(sums);
+    free(sumSquares);
+}
+
+bool runBootstrapReplicate(const bootstrap_run_t * run, unsigned int replicate, bootstrap_result_t * result){
+    uint64_t rng;
+    double * counts = calloc(run->numShapes,sizeof(double));
+    point_set_t points;
+    kmeans_t km;
+    unsigned int draw, s, group, K = 0;
+
+    result->seed = getReplicateSeed(run->settings.seed,replicate);
+    result->clusterCount = result->silhouetteIndex = result->calinskiIndex = NAN;
+    rng = result->seed;
+
+    // the replicate as how often each shape was drawn
+    if(run->settings.sample==BOOTSTRAP_BY_STUDY){
+        for(draw=0;draw<run->numGroups;draw++){
+            group = nextIndex(&rng,run->numGroups);
+            for(s=run->groupStarts[group];s<run->groupStarts[group+1];s++){
+                counts[run->groupMembers[s]]++;
+            }
+        }
+    }
+    else{
+        for(draw=0;draw<run->numShapes;draw++){
+            counts[nextIndex(&rng,run->numShapes)]++;
+        }
+    }
+    points.rows = malloc(run->numShapes*sizeof(uint32_t));
+    points.weights = malloc(run->numShapes*sizeof(double));
+    points.numPoints = 0;
+    points.totalWeight = 0;
+    for(s=0;s<run->numShapes;s++){
+        if(counts[s]>0){
+            points.rows[points.numPoints] = s;
+            points.weights[points.numPoints++] = counts[s];
+            points.totalWeight += counts[s];
+        }
+    }
+    free(counts);
+
+    if(allocKmeans(&km,points.numPoints)){
+        K = clusterAdaptively(run,&points,&km,&rng);
+        if(K>0){
+            scoreClusters(run,&points,&km,K,result);
+        }
+    }
+    freeKmeans(&km);
+    free(points.rows);
+    free(points.weights);
+    return run->keepRunning;
+}
+
+static void formatResultsHeader(const bootstrap_run_t * run, char * header, size_t sz_header){
+    snprintf(header,sz_header,"# padaco cluster bootstrap shapes=%u dims=%u sample=%s minClusters=%u threshold=%.17g permutation=%d seed=%" PRIu64 " checksum=%.17g\n",
+             run->numShapes,run->numDims,BOOTSTRAP_SAMPLE_NAMES[run->settings.sample],run->settings.minClusters,
+             run->settings.clusterThreshold,run->settings.initClusterWithPermutation ? 1 : 0,run->settings.seed,run->checksum);
+}
+
+// Reads the results of an earlier run and opens the file for appending.
+static bool openResultsFile(bootstrap_run_t * run, const char * filename, char * errorMsg, size_t sz_errorMsg){
+    char header[SZ_RESULTS_LINE], line[SZ_RESULTS_LINE];
+    FILE * fid;
+    unsigned int replicate;
+    bootstrap_result_t result;
+    bool endsWithNewline = true;
+
+    formatResultsHeader(run,header,SZ_RESULTS_LINE);
+    if((fid=fopen(filename,"r"))!=NULL){
+        if(fgets(line,SZ_RESULTS_LINE,fid)!=NULL){
+            if(strcmp(line,header)!=0){
+                fclose(fid);
+                snprintf(errorMsg,sz_errorMsg,"%s holds results of a different run",filename);
+                return false;
+            }
+            while(fgets(line,SZ_RESULTS_LINE,fid)!=NULL){
+                endsWithNewline = line[strlen(line)-1]=='\n';
+                if(sscanf(line,"%u,%" SCNu64 ",%lf,%lf,%lf",&replicate,&result.seed,&result.clusterCount,&result.silhouetteIndex,&result.calinskiIndex)==5
+                   && endsWithNewline && replicate<run->settings.numReplicates && !run->isDone[replicate]
+                   && result.seed==getReplicateSeed(run->settings.seed,replicate)){
+                    run->results[replicate] = result;
+                    run->isDone[replicate] = true;
+                    run->numDone++;
+                }
+            }
+            fclose(fid);
+            run->numResumed = run->numDone;
+            if((run->resultsFile=fopen(filename,"a"))!=NULL && !endsWithNewline){
+                fputc('\n',run->resultsFile);  // a line cut short when the run stopped
+            }
+        }
+        else{
+            fclose(fid);
+        }
+    }
+    if(run->resultsFile==NULL && (run->resultsFile=fopen(filename,"w"))!=NULL){
+        fputs(header,run->resultsFile);
+        fputs(RESULTS_COLUMNS,run->resultsFile);
+        fflush(run->resultsFile);
+    }
+    if(run->resultsFile==NULL){
+        snprintf(errorMsg,sz_errorMsg,"Could not open %s for writing",filename);
+        return false;
+    }
+    return true;
+}
+
+// Studies as lists of their shapes, leaving out study numbers with no shapes.
+static bool groupShapes(bootstrap_run_t * run, const uint32_t * groups){
+    uint32_t maxGroup = 0, g, numGroups = 0, * counts, * groupIndex;
+    unsigned int s;
+    for(s=0;s<run->numShapes;s++){
+        maxGroup = groups[s]>maxGroup ? groups[s] : maxGroup;
+    }
+    counts = calloc((size_t)maxGroup+1,sizeof(uint32_t));
+    groupIndex = malloc(((size_t)maxGroup+1)*sizeof(uint32_t));
+    run->groupStarts = calloc((size_t)maxGroup+2,sizeof(uint32_t));
+    run->groupMembers = malloc(run->numShapes*sizeof(uint32_t));
+    if(counts==NULL || groupIndex==NULL || run->groupStarts==NULL || run->groupMembers==NULL){
+        free(counts);
+        free(groupIndex);
+        return false;
+    }
+    for(s=0;s<run->numShapes;s++){
+        counts[groups[s]]++;
+    }
+    for(g=0;g<=maxGroup;g++){
+        if(counts[g]>0){
+            groupIndex[g] = numGroups;
+            run->groupStarts[numGroups+1] = run->groupStarts[numGroups]+counts[g];
+            numGroups++;
+        }
+    }
+    memset(counts,0,((size_t)maxGroup+1)*sizeof(uint32_t));
+    for(s=0;s<run->numShapes;s++){
+        g = groupIndex[groups[s]];
+        run->groupMembers[run->groupStarts[g]+counts[g]++] = s;
+    }
+    run->numGroups = numGroups;
+    free(counts);
+    free(groupIndex);
+    return true;
+}
+
+bootstrap_run_t * createBootstrapRun(const double * shapes, unsigned int numShapes, unsigned int numDims,
+                                     const uint32_t * groups, const bootstrap_settings_t * settings,
+                                     const char * resultsFilename, unsigned int numWorkers,
+                                     char * errorMsg, size_t sz_errorMsg){
+    bootstrap_run_t * run;
+    unsigned int s, d;
+
+    if(numShapes==0 || numDims==0 || settings->numReplicates==0 || settings->minClusters==0){
+        snprintf(errorMsg,sz_errorMsg,"Load shapes, replicates and a minimum number of clusters are required");
+        return NULL;
+    }
+    if(settings->sample==BOOTSTRAP_BY_STUDY && groups==NULL){
+        snprintf(errorMsg,sz_errorMsg,"The study of each load shape is required to resample by study");
+        return NULL;
+    }
+    run = calloc(1,sizeof(bootstrap_run_t));
+    run->settings = *settings;
+    run->numShapes = numShapes;
+    run->numDims = numDims;
+    run->numWorkers = numWorkers;
+    run->keepRunning = true;
+    pthread_mutex_init(&run->lock,NULL);
+    run->shapes = malloc((size_t)numShapes*numDims*sizeof(double));
+    run->results = calloc(settings->numReplicates,sizeof(bootstrap_result_t));
+    run->isDone = calloc(settings->numReplicates,sizeof(bool));
+    if(run->shapes==NULL || run->results==NULL || run->isDone==NULL
+       || (settings->sample==BOOTSTRAP_BY_STUDY && !groupShapes(run,groups))){
+        snprintf(errorMsg,sz_errorMsg,"Not enough memory for %u load shapes",numShapes);
+        freeBootstrapRun(run);
+        return NULL;
+    }
+    // row by row, so a shape's values are contiguous
+    for(s=0;s<numShapes;s++){
+        for(d=0;d<numDims;d++){
+            run->shapes[(size_t)s*numDims+d] = shapes[(size_t)d*numShapes+s];
+            run->checksum += shapes[(size_t)d*numShapes+s];
+        }
+    }
+    if(resultsFilename!=NULL && !openResultsFile(run,resultsFilename,errorMsg,sz_errorMsg)){
+        freeBootstrapRun(run);
+        return NULL;
+    }
+    return run;
+}
+
+typedef struct{
+    bootstrap_run_t * run;
+    uint32_t * pending;         // replicates not yet done when the run started
+} bootstrap_job_t;
+
+static void runReplicateTask(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    bootstrap_job_t * job = (bootstrap_job_t *)userData;
+    bootstrap_run_t * run = job->run;
+    bootstrap_result_t result;
+    unsigned int replicate = job->pending[taskIndex];
+    (void)workerIndex;
+
+    if(runBootstrapReplicate(run,replicate,&result)){
+        pthread_mutex_lock(&run->lock);
+        run->results[replicate] = result;
+        run->isDone[replicate] = true;
+        run->numDone++;
+        if(run->resultsFile!=NULL){
+            fprintf(run->resultsFile,"%u,%" PRIu64 ",%.17g,%.17g,%.17g\n",replicate,result.seed,result.clusterCount,result.silhouetteIndex,result.calinskiIndex);
+            fflush(run->resultsFile);
+        }
+        pthread_mutex_unlock(&run->lock);
+    }
+}
+
+static void * runBootstrapThread(void * userData){
+    bootstrap_job_t job;
+    unsigned int replicate, numPending = 0;
+    job.run = (bootstrap_run_t *)userData;
+    job.pending = malloc(job.run->settings.numReplicates*sizeof(uint32_t));
+    if(job.pending!=NULL){
+        pthread_mutex_lock(&job.run->lock);
+        for(replicate=0;replicate<job.run->settings.numReplicates;replicate++){
+            if(!job.run->isDone[replicate]){
+                job.pending[numPending++] = replicate;
+            }
+        }
+        pthread_mutex_unlock(&job.run->lock);
+        parallelFor(numPending,job.run->numWorkers,runReplicateTask,&job,&job.run->keepRunning);
+        free(job.pending);
+    }
+    pthread_mutex_lock(&job.run->lock);
+    job.run->isRunning = false;
+    pthread_mutex_unlock(&job.run->lock);
+    return NULL;
+}
+
+bool startBootstrapRun(bootstrap_run_t * run){
+    if(run->hasThread){
+        return false;
+    }
+    run->isRunning = true;
+    if(pthread_create(&run->thread,NULL,runBootstrapThread,run)!=0){
+        run->isRunning = false;
+        return false;
+    }
+    run->hasThread = true;
+    return true;
+}
+
+void cancelBootstrapRun(bootstrap_run_t * run){
+    run->keepRunning = false;
+}
+
+void waitForBootstrapRun(bootstrap_run_t * run){
+    if(run->hasThread){
+        pthread_join(run->thread,NULL);
+        run->hasThread = false;
+    }
+}
+
+void getBootstrapProgress(bootstrap_run_t * run, unsigned int * numDone, bool * isRunning){
+    pthread_mutex_lock(&run->lock);
+    *numDone = run->numDone;
+    *isRunning = run->isRunning;
+    pthread_mutex_unlock(&run->lock);
+}
+
+void freeBootstrapRun(bootstrap_run_t * run){
+    if(run==NULL){
+        return;
+    }
+    cancelBootstrapRun(run);
+    waitForBootstrapRun(run);
+    if(run->resultsFile!=NULL){
+        fclose(run->resultsFile);
+    }
+    free(run->shapes);
+    free(run->groupStarts);
+    free(run->groupMembers);
+    free(run->results);
+    free(run->isDone);
+    pthread_mutex_destroy(&run->lock);
+    free(run);
+}
@@ -0,0 +1,116 @@
+//
+//  clusterbootstrap.h
+//  Bootstrap replicates of PACluster's adaptive k-means (kmeans, sqeuclidean distance),
+//  run in parallel over one shared, read-only copy of the load shapes.
+//
+//  A replicate resamples the load shapes with replacement, either by day (each shape) or by
+//  study (every shape of a study, as PAStatTool.bootstrap does), and is kept as the rows it
+//  drew and how often it drew each (an index/weight vector), not as a copy of the shapes.
+//  Clustering a weighted row is the same as clustering that many copies of it.  Each
+//  replicate has its own random stream, seeded from the run's seed and the replicate's
+//  number, so its result does not depend on the number of workers or the order replicates
+//  finish in.
+//
+//  The adaptive loop follows PACluster.adaptiveKclusters: start at minClusters; after each
+//  k-means, every cluster with a member farther than clusterThreshold times the centroid's
+//  squared norm is split in two (2-means of its members) and k-means is run again, until no
+//  cluster is split (converged) or K exceeds half the number of resampled shapes (not
+//  converged; the replicate's results are NaN).  k-means is the batch (Lloyd) phase only,
+//  seeded with k-means++ or, with initClusterWithPermutation, with randomly drawn shapes;
+//  an emptied cluster is moved to the shape farthest from its centroid (kmeans'
+//  'singleton' action).
+//
+//  Each replicate reports its cluster count, silhouette index (mean over shapes, squared
+//  euclidean distance, 0 for shapes alone in a cluster) and Calinski-Harabasz index (as
+//  utility/calinski.m computes it).  Results are appended to a results file as they finish
+//  so a cancelled run can be resumed: the file starts with a line describing the run, and
+//  a run started with a file written by the same run skips the replicates it holds.
+//
+
+#ifndef in_clusterbootstrap_h
+#define in_clusterbootstrap_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define BOOTSTRAP_MAX_ITERATIONS 100    // kmeans' MaxIter
+#define SZ_BOOTSTRAP_ERROR_MSG 256
+
+typedef enum{
+    BOOTSTRAP_BY_DAY = 0,
+    BOOTSTRAP_BY_STUDY,
+    NUM_BOOTSTRAP_SAMPLES
+} bootstrap_sample_t;
+
+extern const char * BOOTSTRAP_SAMPLE_NAMES[NUM_BOOTSTRAP_SAMPLES];
+
+typedef struct bootstrap_settings_t{
+    bootstrap_sample_t sample;
+    unsigned int numReplicates;
+    unsigned int minClusters;
+    double clusterThreshold;
+    bool initClusterWithPermutation;
+    uint64_t seed;
+} bootstrap_settings_t;
+
+typedef struct bootstrap_result_t{
+    uint64_t seed;              // of the replicate's random stream
+    double clusterCount;        // NaN when the replicate did not converge
+    double silhouetteIndex;
+    double calinskiIndex;
+} bootstrap_result_t;
+
+typedef struct bootstrap_run_t{
+    bootstrap_settings_t settings;
+
+    // shared, read-only
+    double * shapes;            // numShapes x numDims, row by row
+    unsigned int numShapes;
+    unsigned int numDims;
+    unsigned int numGroups;     // studies, when sampling by study
+    uint32_t * groupStarts;     // numGroups+1 offsets into groupMembers
+    uint32_t * groupMembers;    // shape indices of each study
+    double checksum;
+
+    // under lock
+    pthread_mutex_t lock;
+    bootstrap_result_t * results;   // numReplicates
+    bool * isDone;
+    unsigned int numDone;
+    unsigned int numResumed;
+    FILE * resultsFile;
+    bool isRunning;
+
+    volatile bool keepRunning;      // cancellation token
+    unsigned int numWorkers;
+    pthread_t thread;
+    bool hasThread;
+} bootstrap_run_t;
+
+// Copies shapes (numShapes x numDims, column-major) once for every replicate.  groups holds
+// the 0 based study of each shape (may be NULL when sampling by day).  Results of an earlier
+// run of the same shapes and settings found in resultsFilename (may be NULL) are resumed and
+// new ones appended; numWorkers 0 => one per core.
+// @retval NULL (with errorMsg) if the arguments are invalid or the results file belongs to
+// a different run or cannot be written.
+bootstrap_run_t * createBootstrapRun(const double * shapes, unsigned int numShapes, unsigned int numDims,
+                                     const uint32_t * groups, const bootstrap_settings_t * settings,
+                                     const char * resultsFilename, unsigned int numWorkers,
+                                     char * errorMsg, size_t sz_errorMsg);
+// Runs the remaining replicates on a background thread.
+bool startBootstrapRun(bootstrap_run_t * run);
+// No new replicates start and those underway stop at their next k-means, unrecorded.
+void cancelBootstrapRun(bootstrap_run_t * run);
+void waitForBootstrapRun(bootstrap_run_t * run);
+void getBootstrapProgress(bootstrap_run_t * run, unsigned int * numDone, bool * isRunning);
+// Cancels and waits for the run, then frees it.
+void freeBootstrapRun(bootstrap_run_t * run);
+
+uint64_t getReplicateSeed(uint64_t seed, unsigned int replicate);
+// Runs one replicate (0 based) in the calling thread.  @retval false if the run was
+// cancelled before the replicate finished.
+bool runBootstrapReplicate(const bootstrap_run_t * run, unsigned int replicate, bootstrap_result_t * result);
+
+#endif /* in_clusterbootstrap_h */
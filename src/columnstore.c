@@ -0,0 +1,367 @@
+//
+//  columnstore.c
+//  Embedded column store for study data.  See columnstore.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "columnstore.h"
+
+typedef struct{
+    double key;
+    uint32_t row;
+} keyed_row_t;
+
+static int compareKeyedRows(const void * a, const void * b){
+    const keyed_row_t * rowA = a, * rowB = b;
+    if(rowA->key!=rowB->key){
+        return rowA->key<rowB->key ? -1 : 1;
+    }
+    return rowA->row<rowB->row ? -1 : (rowA->row>rowB->row);
+}
+
+static int findSpecColumn(const store_table_spec_t * spec, const char * name){
+    unsigned int c;
+    for(c=0;name!=NULL && c<spec->numColumns;c++){
+        if(strcmp(spec->columnNames[c],name)==0){
+            return (int)c;
+        }
+    }
+    return -1;
+}
+
+static bool isWeekday(double value){
+    return value>=0 && value<STORE_NUM_WEEKDAYS && value==floor(value);
+}
+
+static bool writeStoreTable(FILE * fid, const store_table_spec_t * spec){
+    store_table_header_t header;
+    keyed_row_t * sorted;
+    const double * keyValues, * weekdayValues;
+    double * keys;
+    uint64_t * runStarts, numIndexed = 0, r, k, weekdayStarts[STORE_NUM_WEEKDAYS+1] = {0};
+    uint32_t * keyRows, * weekdayRows = NULL;
+    char name[SZ_STORE_NAME];
+    unsigned int c, d;
+    bool didWrite = true;
+
+    memset(&header,0,sizeof(header));
+    strncpy(header.name,spec->name,SZ_STORE_TABLE_NAME-1);
+    header.numRows = spec->numRows;
+    header.numColumns = spec->numColumns;
+    header.keyColumn = findSpecColumn(spec,spec->keyName);
+    header.weekdayColumn = findSpecColumn(spec,spec->weekdayName);
+    if(header.keyColumn<0 || spec->numRows>UINT32_MAX){
+        fprintf(stderr,"Table %s has no %s key column or too many rows.\n",spec->name,spec->keyName);
+        return false;
+    }
+
+    // key index
+    keyValues = spec->columns[header.keyColumn];
+    sorted = malloc((spec->numRows>0 ? spec->numRows : 1)*sizeof(keyed_row_t));
+    for(r=0;r<spec->numRows;r++){
+        if(!isnan(keyValues[r])){
+            sorted[numIndexed].key = keyValues[r];
+            sorted[numIndexed++].row = (uint32_t)r;
+        }
+    }
+    qsort(sorted,numIndexed,sizeof(keyed_row_t),compareKeyedRows);
+    keys = malloc((numIndexed>0 ? numIndexed : 1)*sizeof(double));
+    runStarts = malloc((numIndexed+1)*sizeof(uint64_t));
+    keyRows = malloc((numIndexed>0 ? numIndexed : 1)*sizeof(uint32_t));
+    for(r=0;r<numIndexed;r++){
+        if(r==0 || sorted[r].key!=sorted[r-1].key){
+            keys[header.numKeys] = sorted[r].key;
+            runStarts[header.numKeys++] = r;
+        }
+        keyRows[r] = sorted[r].row;
+    }
+    runStarts[header.numKeys] = numIndexed;
+    free(sorted);
+
+    // weekday index (counting sort keeps rows in order within each day)
+    if(header.weekdayColumn>=0){
+        weekdayValues = spec->columns[header.weekdayColumn];
+        for(r=0;r<spec->numRows;r++){
+            if(isWeekday(weekdayValues[r])){
+                weekdayStarts[(int)weekdayValues[r]+1]++;
+            }
+        }
+        for(d=0;d<STORE_NUM_WEEKDAYS;d++){
+            weekdayStarts[d+1] += weekdayStarts[d];
+        }
+        weekdayRows = malloc((weekdayStarts[STORE_NUM_WEEKDAYS]>0 ? weekdayStarts[STORE_NUM_WEEKDAYS] : 1)*sizeof(uint32_t));
+        {
+            uint64_t next[STORE_NUM_WEEKDAYS];
+            memcpy(next,weekdayStarts,sizeof(next));
+            for(r=0;r<spec->numRows;r++){
+                if(isWeekday(weekdayValues[r])){
+                    weekdayRows[next[(int)weekdayValues[r]]++] = (uint32_t)r;
+                }
+            }
+        }
+    }
+
+    header.dataOffset = (uint64_t)ftell(fid)+sizeof(store_table_header_t)+(uint64_t)spec->numColumns*SZ_STORE_NAME;
+    didWrite = fwrite(&header,sizeof(header),1,fid)==1;
+    for(c=0;c<spec->numColumns && didWrite;c++){
+        memset(name,0,SZ_STORE_NAME);
+        strncpy(name,spec->columnNames[c],SZ_STORE_NAME-1);
+        didWrite = fwrite(name,SZ_STORE_NAME,1,fid)==1;
+    }
+    for(c=0;c<spec->numColumns && didWrite;c++){
+        didWrite = fwrite(spec->columns[c],sizeof(double),spec->numRows,fid)==spec->numRows;
+    }
+    k = header.numKeys;
+    didWrite = didWrite && fwrite(keys,sizeof(double),k,fid)==k && fwrite(runStarts,sizeof(uint64_t),k+1,fid)==k+1 &&
+               fwrite(keyRows,sizeof(uint32_t),numIndexed,fid)==numIndexed;
+    if(didWrite && weekdayRows!=NULL){
+        didWrite = fwrite(weekdayStarts,sizeof(uint64_t),STORE_NUM_WEEKDAYS+1,fid)==STORE_NUM_WEEKDAYS+1 &&
+                   fwrite(weekdayRows,sizeof(uint32_t),weekdayStarts[STORE_NUM_WEEKDAYS],fid)==weekdayStarts[STORE_NUM_WEEKDAYS];
+    }
+    free(weekdayRows);
+    free(keyRows);
+    free(runStarts);
+    free(keys);
+    return didWrite;
+}
+
+bool writeStudyStore(const char * filename, const store_table_spec_t * specs, unsigned int numTables){
+    store_header_t header;
+    unsigned int t;
+    bool didWrite;
+    FILE * fid = fopen(filename,"wb");
+    if(fid==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",filename);
+        return false;
+    }
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,STORE_MAGIC,8);
+    header.version = STORE_VERSION;
+    header.numTables = numTables;
+    didWrite = fwrite(&header,sizeof(header),1,fid)==1;
+    for(t=0;t<numTables && didWrite;t++){
+        didWrite = writeStoreTable(fid,&specs[t]);
+    }
+    didWrite = fclose(fid)==0 && didWrite;
+    return didWrite;
+}
+
+static void freeStoreTable(store_table_t * table){
+    free(table->columnNames);
+    free(table->columns);
+    free(table->keys);
+    free(table->runStarts);
+    free(table->keyRows);
+    free(table->weekdayStarts);
+    free(table->weekdayRows);
+}
+
+static bool readStoreArray(FILE * fid, void ** array, size_t elementSize, uint64_t numElements){
+    *array = malloc(numElements>0 ? numElements*elementSize : 1);
+    return numElements==0 || fread(*array,elementSize,numElements,fid)==numElements;
+}
+
+static bool readStoreTable(FILE * fid, store_table_t * table){
+    store_table_header_t * header = &table->header;
+    bool didRead = fread(header,sizeof(store_table_header_t),1,fid)==1 && header->keyColumn>=0 &&
+                   (uint32_t)header->keyColumn<header->numColumns && header->weekdayColumn<(int32_t)header->numColumns &&
+                   header->numKeys<=header->numRows;
+    didRead = didRead && readStoreArray(fid,(void**)&table->columnNames,SZ_STORE_NAME,header->numColumns) &&
+              fseek(fid,(long)header->dataOffset,SEEK_SET)==0 &&
+              readStoreArray(fid,(void**)&table->columns,sizeof(double),header->numRows*header->numColumns) &&
+              readStoreArray(fid,(void**)&table->keys,sizeof(double),header->numKeys) &&
+              readStoreArray(fid,(void**)&table->runStarts,sizeof(uint64_t),header->numKeys+1) &&
+              table->runStarts[header->numKeys]<=header->numRows &&
+              readStoreArray(fid,(void**)&table->keyRows,sizeof(uint32_t),table->runStarts[header->numKeys]);
+    if(didRead && header->weekdayColumn>=0){
+        didRead = readStoreArray(fid,(void**)&table->weekdayStarts,sizeof(uint64_t),STORE_NUM_WEEKDAYS+1) &&
+                  table->weekdayStarts[STORE_NUM_WEEKDAYS]<=header->numRows &&
+                  readStoreArray(fid,(void**)&table->weekdayRows,sizeof(uint32_t),table->weekdayStarts[STORE_NUM_WEEKDAYS]);
+    }
+    return didRead;
+}
+
+study_store_t * openStudyStore(const char * filename){
+    store_header_t header;
+    study_store_t * store;
+    unsigned int t;
+    bool didRead;
+    FILE * fid = fopen(filename,"rb");
+    if(fid==NULL){
+        return NULL;
+    }
+    if(fread(&header,sizeof(header),1,fid)!=1 || memcmp(header.magic,STORE_MAGIC,8)!=0 || header.version!=STORE_VERSION){
+        fprintf(stderr,"%s is not a study store\n",filename);
+        fclose(fid);
+        return NULL;
+    }
+    store = calloc(1,sizeof(study_store_t));
+    store->tables = calloc(header.numTables>0 ? header.numTables : 1,sizeof(store_table_t));
+    didRead = true;
+    for(t=0;t<header.numTables && didRead;t++){
+        store->numTables++;
+        didRead = readStoreTable(fid,&store->tables[t]);
+    }
+    fclose(fid);
+    if(!didRead){
+        fprintf(stderr,"Could not read table %u of %s\n",t,filename);
+        freeStudyStore(store);
+        return NULL;
+    }
+    return store;
+}
+
+void freeStudyStore(study_store_t * store){
+    unsigned int t;
+    if(store!=NULL){
+        for(t=0;t<store->numTables;t++){
+            freeStoreTable(&store->tables[t]);
+        }
+        free(store->tables);
+        free(store);
+    }
+}
+
+const store_table_t * getStoreTable(const study_store_t * store, const char * name){
+    unsigned int t;
+    for(t=0;t<store->numTables;t++){
+        if(strncmp(store->tables[t].header.name,name,SZ_STORE_TABLE_NAME)==0){
+            return &store->tables[t];
+        }
+    }
+    return NULL;
+}
+
+int getStoreColumn(const store_table_t * table, const char * name){
+    unsigned int c;
+    for(c=0;c<table->header.numColumns;c++){
+        if(strncmp(table->columnNames[c],name,SZ_STORE_NAME)==0){
+            return (int)c;
+        }
+    }
+    return -1;
+}
+
+const double * getStoreColumnValues(const store_table_t * table, int column){
+    return table->columns+(size_t)column*table->header.numRows;
+}
+
+// @retval index of key in table->keys or -1
+static int64_t findKey(const store_table_t * table, double key){
+    uint64_t low = 0, high = table->header.numKeys, middle;
+    while(low<high){
+        middle = low+(high-low)/2;
+        if(table->keys[middle]<key){
+            low = middle+1;
+        }
+        else{
+            high = middle;
+        }
+    }
+    return low<table->header.numKeys && table->keys[low]==key ? (int64_t)low : -1;
+}
+
+uint64_t findKeyRows(const store_table_t * table, double key, const uint32_t ** rows){
+    int64_t k = findKey(table,key);
+    if(k<0){
+        *rows = NULL;
+        return 0;
+    }
+    *rows = table->keyRows+table->runStarts[k];
+    return table->runStarts[k+1]-table->runStarts[k];
+}
+
+void joinStoreColumns(const store_table_t * table, const double * keys, uint64_t numKeys, const int * columns, unsigned int numColumns, double * values){
+    const uint32_t * rows;
+    uint64_t k;
+    unsigned int c;
+    for(k=0;k<numKeys;k++){
+        if(findKeyRows(table,keys[k],&rows)>0){
+            for(c=0;c<numColumns;c++){
+                values[c*numKeys+k] = getStoreColumnValues(table,columns[c])[rows[0]];
+            }
+        }
+        else{
+            for(c=0;c<numColumns;c++){
+                values[c*numKeys+k] = NAN;
+            }
+        }
+    }
+}
+
+// Adds rows to counts; rowKeys maps each row to its key index (UINT32_MAX for NaN keys).
+static void countRows(const uint32_t * rows, uint64_t numRows, const double * clusters, const double * nonwear, unsigned int numClusters,
+                      uint64_t numKeys, const uint32_t * rowKeys, double * counts){
+    uint64_t i;
+    uint32_t row;
+    for(i=0;i<numRows;i++){
+        row = rows[i];
+        if(rowKeys[row]!=UINT32_MAX && (nonwear==NULL || nonwear[row]==0) && clusters[row]>=1 && clusters[row]<=numClusters){
+            counts[((size_t)clusters[row]-1)*numKeys+rowKeys[row]]++;
+        }
+    }
+}
+
+bool countClusterMembership(const store_table_t * table, const double * keys, uint64_t numKeys, unsigned int numClusters,
+                            unsigned int weekdayMask, bool excludeNonwear, double * counts){
+    int clusterColumn = getStoreColumn(table,"cluster"), nonwearColumn = getStoreColumn(table,"nonwear");
+    const double * clusters, * nonwear = NULL, * weekdays = NULL;
+    const uint32_t * rows;
+    uint32_t * rowKeys, row;
+    uint64_t k, r, numRows, i;
+    unsigned int d;
+    double cluster;
+    bool allDays = (weekdayMask&((1u<<STORE_NUM_WEEKDAYS)-1))==(1u<<STORE_NUM_WEEKDAYS)-1;
+
+    if(clusterColumn<0 || (excludeNonwear && nonwearColumn<0) || (!allDays && table->header.weekdayColumn<0)){
+        return false;
+    }
+    clusters = getStoreColumnValues(table,clusterColumn);
+    if(excludeNonwear){
+        nonwear = getStoreColumnValues(table,nonwearColumn);
+    }
+    if(table->header.weekdayColumn>=0){
+        weekdays = getStoreColumnValues(table,table->header.weekdayColumn);
+    }
+    memset(counts,0,(keys==NULL ? table->header.numKeys : numKeys)*numClusters*sizeof(double));
+
+    if(keys!=NULL){
+        // run by run through the key index
+        for(k=0;k<numKeys;k++){
+            numRows = findKeyRows(table,keys[k],&rows);
+            for(i=0;i<numRows;i++){
+                row = rows[i];
+                cluster = clusters[row];
+                if((weekdays==NULL || (isWeekday(weekdays[row]) && (weekdayMask>>(int)weekdays[row]&1))) &&
+                   (nonwear==NULL || nonwear[row]==0) && cluster>=1 && cluster<=numClusters){
+                    counts[((size_t)cluster-1)*numKeys+k]++;
+                }
+            }
+        }
+        return true;
+    }
+
+    // all keys: visit only the selected days' rows through the weekday index
+    numKeys = table->header.numKeys;
+    rowKeys = malloc((table->header.numRows>0 ? table->header.numRows : 1)*sizeof(uint32_t));
+    memset(rowKeys,0xFF,table->header.numRows*sizeof(uint32_t));
+    for(k=0;k<numKeys;k++){
+        for(r=table->runStarts[k];r<table->runStarts[k+1];r++){
+            rowKeys[table->keyRows[r]] = (uint32_t)k;
+        }
+    }
+    if(weekdays==NULL){
+        countRows(table->keyRows,table->runStarts[numKeys],clusters,nonwear,numClusters,numKeys,rowKeys,counts);
+    }
+    for(d=0;d<STORE_NUM_WEEKDAYS && weekdays!=NULL;d++){
+        if(weekdayMask>>d&1){
+            countRows(table->weekdayRows+table->weekdayStarts[d],table->weekdayStarts[d+1]-table->weekdayStarts[d],
+                      clusters,nonwear,numClusters,numKeys,rowKeys,counts);
+        }
+    }
+    free(rowKeys);
+    return true;
+}
@@ -0,0 +1,103 @@
+//
+//  columnstore.h
+//  Embedded, file based column store for study level data: person-day rows (study ID, day
+//  of week, cluster membership, nonwear flag), outcomes and covariates.  No server is needed;
+//  a store is one file, read whole on open.
+//
+//  A store holds named tables of float64 columns (missing values are NaN).  Each table has a
+//  key column (the study ID) and is written with a key index: its unique keys in ascending
+//  order, the rows sorted by key (stable, so rows of a key keep their order) and where each
+//  key's run of rows starts.  Tables with a day of week column (whole numbers 0 to 6)
+//  also get a weekday index listing the rows of each day.  Lookups by study ID are binary
+//  searches and weekday selections only visit the selected days' rows.
+//
+//  File layout (native byte order): store_header_t, then for each table its
+//  store_table_header_t, numColumns names of SZ_STORE_NAME bytes and, at dataOffset, the
+//  columns (numRows doubles each), keys (numKeys doubles), runStarts (numKeys+1 uint64),
+//  keyRows (runStarts[numKeys] uint32) and, when weekdayColumn >= 0, weekdayStarts (8 uint64)
+//  and weekdayRows (weekdayStarts[7] uint32).  Rows whose key is NaN, or whose day is not a
+//  whole number from 0 to 6, are left out of the respective index (and so of any count by day).
+//
+
+#ifndef in_columnstore_h
+#define in_columnstore_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STORE_MAGIC "PASTORE1"
+#define STORE_VERSION 1
+#define SZ_STORE_TABLE_NAME 32
+#define SZ_STORE_NAME 64
+#define STORE_NUM_WEEKDAYS 7
+#define STORE_PERSONDAYS_TABLE "persondays"
+
+#pragma pack(push,1)
+typedef struct store_header_t{
+    char magic[8];
+    uint32_t version;
+    uint32_t numTables;
+} store_header_t;
+
+typedef struct store_table_header_t{
+    char name[SZ_STORE_TABLE_NAME];
+    uint64_t numRows;
+    uint32_t numColumns;
+    int32_t keyColumn;
+    int32_t weekdayColumn;      // -1 => no weekday index
+    uint32_t reserved;
+    uint64_t numKeys;
+    uint64_t dataOffset;
+} store_table_header_t;
+#pragma pack(pop)
+
+typedef struct store_table_t{
+    store_table_header_t header;
+    char (*columnNames)[SZ_STORE_NAME];
+    double * columns;           // numColumns*numRows, column by column
+    double * keys;
+    uint64_t * runStarts;
+    uint32_t * keyRows;
+    uint64_t * weekdayStarts;
+    uint32_t * weekdayRows;
+} store_table_t;
+
+typedef struct study_store_t{
+    unsigned int numTables;
+    store_table_t * tables;
+} study_store_t;
+
+// Input for writeStudyStore: columns are given as numColumns pointers to numRows doubles.
+typedef struct{
+    const char * name;
+    uint64_t numRows;
+    unsigned int numColumns;
+    const char ** columnNames;
+    const double ** columns;
+    const char * keyName;
+    const char * weekdayName;   // NULL => no weekday index
+} store_table_spec_t;
+
+bool writeStudyStore(const char * filename, const store_table_spec_t * specs, unsigned int numTables);
+study_store_t * openStudyStore(const char * filename);
+void freeStudyStore(study_store_t * store);
+
+const store_table_t * getStoreTable(const study_store_t * store, const char * name);
+int getStoreColumn(const store_table_t * table, const char * name);
+const double * getStoreColumnValues(const store_table_t * table, int column);
+
+// @retval number of rows with key; *rows points at their indices (sorted by key index).
+uint64_t findKeyRows(const store_table_t * table, double key, const uint32_t ** rows);
+
+// For each of numKeys study IDs, writes the first matching row's values of the numColumns
+// columns into values (numKeys rows by numColumns, column by column); NaN when not found.
+void joinStoreColumns(const store_table_t * table, const double * keys, uint64_t numKeys, const int * columns, unsigned int numColumns, double * values);
+
+// Counts person-day rows per study and cluster (1 based cluster numbers in the cluster
+// column) over the days set in weekdayMask (bit d => day d) and, when excludeNonwear, rows
+// whose nonwear column is 0.  counts is numKeys by numClusters, column by column.  Keys may
+// be NULL to count the table's own keys (in ascending order; see the table's keys).
+bool countClusterMembership(const store_table_t * table, const double * keys, uint64_t numKeys, unsigned int numClusters,
+                            unsigned int weekdayMask, bool excludeNonwear, double * counts);
+
+#endif /* in_columnstore_h */
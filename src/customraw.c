@@ -0,0 +1,509 @@
+//
+//  customraw.c
+//  Parser for raw accelerations in user described delimited text formats.  See customraw.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include "customraw.h"
+#include "rawtools.h"
+#include "in_parallel.h"
+
+#define CHUNKS_PER_WORKER 8
+#define MIN_CHUNK_BYTES (1<<16)
+
+typedef struct{
+    const char * start;
+    const char * end;
+    uint64_t numLines;
+    uint64_t firstRow;  // of the numLines rows reserved for the chunk
+    uint64_t numRows;   // parsed into the first of them
+    uint64_t numDropped;
+} text_chunk_t;
+
+typedef struct{
+    const custom_raw_format_t * format;
+    text_chunk_t * chunks;
+    uint64_t stride;    // rows reserved per axis
+    int64_t * micros;
+    float * xyz;
+} parse_job_t;
+
+static const double POWERS_OF_TEN[] = {
+    1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+};
+
+static bool isBlank(char c){
+    return c==' ' || c=='\t';
+}
+
+static bool isBlankDelimiter(const custom_raw_format_t * format){
+    return isBlank(format->delimiter);
+}
+
+bool compileDatetimeFormat(const char * datetimeFmtStr, custom_raw_format_t * format){
+    const char * p = datetimeFmtStr;
+    datetime_token_t * token;
+    unsigned int run, offset = 0, hasFields = 0;
+    char c;
+
+    format->numTokens = 0;
+    format->isFixedLayout = true;
+    while(*p!='\0'){
+        if(format->numTokens==CUSTOM_RAW_MAX_TOKENS){
+            return false;
+        }
+        token = format->tokens+format->numTokens;
+        memset(token,0,sizeof(datetime_token_t));
+        token->offset = offset;
+        c = *p;
+        if(c=='\''){
+            // quoted literal text; '' is a quote
+            if(p[1]=='\''){
+                token->literal = '\'';
+                token->width = 1;
+                p += 2;
+            }
+            else{
+                for(p++;*p!='\0' && *p!='\'';p++){
+                    if(format->numTokens==CUSTOM_RAW_MAX_TOKENS){
+                        return false;
+                    }
+                    token = format->tokens+format->numTokens++;
+                    token->id = TOKEN_LITERAL;
+                    token->literal = *p;
+                    token->width = 1;
+                    token->offset = offset++;
+                }
+                if(*p=='\''){
+                    p++;
+                }
+                continue;
+            }
+        }
+        else if(isalpha((unsigned char)c)){
+            for(run=0;p[run]==c;run++);
+            p += run;
+            switch(c){
+                case 'y':
+                    if(run!=4 && run!=2) return false;
+                    token->id = TOKEN_YEAR;
+                    token->width = run;
+                    hasFields |= 1;
+                    break;
+                case 'M': token->id = TOKEN_MONTH; hasFields |= 2; break;
+                case 'd': token->id = TOKEN_DAY; hasFields |= 4; break;
+                case 'H': token->id = TOKEN_HOUR; break;
+                case 'h': token->id = TOKEN_HOUR12; break;
+                case 'm': token->id = TOKEN_MINUTE; break;
+                case 's': token->id = TOKEN_SECOND; break;
+                case 'S':
+                    if(run>9) return false;
+                    token->id = TOKEN_FRACTION;
+                    token->width = run;
+                    break;
+                case 'a':
+                    if(run!=1) return false;
+                    token->id = TOKEN_AMPM;
+                    token->width = 2;
+                    break;
+                default:
+                    return false;
+            }
+            if(c!='y' && c!='S' && c!='a'){
+                if(run>2) return false;   // e.g. MMM month names
+                token->width = run==2 ? 2 : 0;
+            }
+        }
+        else{
+            token->literal = c;
+            token->width = 1;
+            p++;
+        }
+        if(token->width==0){
+            format->isFixedLayout = false;
+        }
+        offset += token->width;
+        format->numTokens++;
+    }
+    format->stampLength = offset;
+    return hasFields==7;
+}
+
+bool compileCustomRawFormat(unsigned int timeColumn, unsigned int xColumn, unsigned int yColumn, unsigned int zColumn,
+                            const char * delimiter, unsigned int headerLines, custom_time_t timeType,
+                            const char * datetimeFmtStr, custom_raw_format_t * format){
+    const unsigned int columns[4] = {timeColumn,xColumn,yColumn,zColumn};
+    unsigned int c;
+
+    memset(format,0,sizeof(custom_raw_format_t));
+    for(c=0;c<4;c++){
+        if(columns[c]<1 || columns[c]>CUSTOM_RAW_MAX_COLUMNS || format->columns[columns[c]-1]!=COLUMN_SKIP){
+            return false;
+        }
+        format->columns[columns[c]-1] = (custom_column_t)(COLUMN_TIME+c);
+        if(columns[c]>format->numColumns){
+            format->numColumns = columns[c];
+        }
+    }
+    if(delimiter==NULL || delimiter[0]=='\0'){
+        return false;
+    }
+    format->delimiter = strcmp(delimiter,"\\t")==0 ? '\t' : delimiter[0];
+    format->headerLines = headerLines;
+    format->timeType = timeType;
+    return timeType==TIME_ELAPSED || (datetimeFmtStr!=NULL && compileDatetimeFormat(datetimeFmtStr,format));
+}
+
+static bool readDigits(const char * text, unsigned int width, int * value){
+    unsigned int i;
+    *value = 0;
+    for(i=0;i<width;i++){
+        if(text[i]<'0' || text[i]>'9'){
+            return false;
+        }
+        *value = *value*10+(text[i]-'0');
+    }
+    return true;
+}
+
+bool parseCustomDatetime(const custom_raw_format_t * format, const char * text, const char ** end, int64_t * micros){
+    const datetime_token_t * token;
+    const char * p = text;
+    int fields[TOKEN_AMPM+1] = {0}, value;
+    unsigned int t, width, digits = 0;
+    bool isPM = false, hasAMPM = false;
+    struct tm timeStruct;
+
+    for(t=0;t<format->numTokens;t++){
+        token = format->tokens+t;
+        if(format->isFixedLayout){
+            p = text+token->offset;
+        }
+        width = token->width;
+        switch(token->id){
+            case TOKEN_LITERAL:
+                if(*p!=token->literal){
+                    return false;
+                }
+                break;
+            case TOKEN_AMPM:
+                if((p[0]!='A' && p[0]!='a' && p[0]!='P' && p[0]!='p') || (p[1]!='M' && p[1]!='m')){
+                    return false;
+                }
+                isPM = p[0]=='P' || p[0]=='p';
+                hasAMPM = true;
+                break;
+            default:
+                if(width==0){
+                    // one or two digits
+                    width = p[1]>='0' && p[1]<='9' ? 2 : 1;
+                }
+                if(!readDigits(p,width,&value)){
+                    return false;
+                }
+                if(token->id==TOKEN_FRACTION){
+                    digits = width;
+                }
+                fields[token->id] = value;
+                break;
+        }
+        p += width;
+    }
+    if(format->isFixedLayout){
+        p = text+format->stampLength;
+    }
+    *end = p;
+
+    memset(&timeStruct,0,sizeof(struct tm));
+    timeStruct.tm_year = (fields[TOKEN_YEAR]<100 ? fields[TOKEN_YEAR]+2000 : fields[TOKEN_YEAR])-1900;
+    timeStruct.tm_mon = fields[TOKEN_MONTH]-1;
+    timeStruct.tm_mday = fields[TOKEN_DAY];
+    timeStruct.tm_hour = fields[TOKEN_HOUR]+(hasAMPM ? fields[TOKEN_HOUR12]%12+(isPM ? 12 : 0) : fields[TOKEN_HOUR12]);
+    timeStruct.tm_min = fields[TOKEN_MINUTE];
+    timeStruct.tm_sec = fields[TOKEN_SECOND];
+    if(timeStruct.tm_mon<0 || timeStruct.tm_mon>11 || timeStruct.tm_mday<1 || timeStruct.tm_mday>31 ||
+       timeStruct.tm_hour>23 || timeStruct.tm_min>59 || timeStruct.tm_sec>60){
+        return false;
+    }
+    // fraction digits past microseconds are truncated
+    value = fields[TOKEN_FRACTION];
+    for(;digits>6;digits--){
+        value /= 10;
+    }
+    for(;digits<6;digits++){
+        value *= 10;
+    }
+    *micros = tm2wallclock(&timeStruct)*MICROS_PER_SECOND+value;
+    return true;
+}
+
+// Decimal numbers are read directly; nan and inf go through strtod.
+static bool parseNumber(const char ** cursor, double * value){
+    const char * p = *cursor, * start = p;
+    uint64_t mantissa = 0;
+    int exponent = 0, numDigits = 0, expSign = 1, expValue = 0;
+    bool isNegative = false;
+    char * end;
+
+    if(*p=='-' || *p=='+'){
+        isNegative = *p=='-';
+        p++;
+    }
+    for(;*p>='0' && *p<='9';p++,numDigits++){
+        if(mantissa<100000000000000000ULL){
+            mantissa = mantissa*10+(uint64_t)(*p-'0');
+        }
+        else{
+            exponent++;
+        }
+    }
+    if(*p=='.'){
+        for(p++;*p>='0' && *p<='9';p++,numDigits++){
+            if(mantissa<100000000000000000ULL){
+                mantissa = mantissa*10+(uint64_t)(*p-'0');
+                exponent--;
+            }
+        }
+    }
+    if(numDigits==0){
+        // only words (nan, inf) go to strtod, which would otherwise skip an empty field's
+        // line end and read the next line's number
+        if(!isalpha((unsigned char)*p)){
+            return false;
+        }
+        *value = strtod(start,&end);
+        if(end==start){
+            return false;
+        }
+        *cursor = end;
+        return true;
+    }
+    if(*p=='e' || *p=='E'){
+        const char * e = p+1;
+        if(*e=='-' || *e=='+'){
+            expSign = *e=='-' ? -1 : 1;
+            e++;
+        }
+        if(*e>='0' && *e<='9'){
+            for(;*e>='0' && *e<='9';e++){
+                if(expValue<10000) expValue = expValue*10+(*e-'0');
+            }
+            exponent += expSign*expValue;
+            p = e;
+        }
+    }
+    if(exponent>=0){
+        *value = (double)mantissa*(exponent<=22 ? POWERS_OF_TEN[exponent] : pow(10,exponent));
+    }
+    else{
+        *value = exponent>=-22 ? (double)mantissa/POWERS_OF_TEN[-exponent] : (double)mantissa*pow(10,exponent);
+    }
+    if(isNegative){
+        *value = -*value;
+    }
+    *cursor = p;
+    return true;
+}
+
+// Blanks around fields, unless blanks are what separate them.
+static const char * skipBlanks(const custom_raw_format_t * format, const char * p){
+    while(isBlank(*p) && !isBlankDelimiter(format)){
+        p++;
+    }
+    return p;
+}
+
+static bool isFieldEnd(const custom_raw_format_t * format, char c){
+    return c==format->delimiter || c=='\n' || c=='\r' || c=='\0' || (isBlankDelimiter(format) && isBlank(c));
+}
+
+// @retval true if the line has the planned columns; only those up to the last one used are read.
+static bool parseLine(const custom_raw_format_t * format, const char * p, int64_t * micros, float * xyz){
+    unsigned int c;
+    double value;
+    for(c=0;c<format->numColumns;c++){
+        if(c>0){
+            if(isBlankDelimiter(format)){
+                if(!isBlank(*p)){
+                    return false;
+                }
+                while(isBlank(*p)) p++;
+            }
+            else if(*p++!=format->delimiter){
+                return false;
+            }
+        }
+        p = skipBlanks(format,p);
+        switch(format->columns[c]){
+            case COLUMN_SKIP:
+                while(!isFieldEnd(format,*p)) p++;
+                break;
+            case COLUMN_TIME:
+                if(format->timeType==TIME_DATETIME){
+                    if(!parseCustomDatetime(format,p,&p,micros)){
+                        return false;
+                    }
+                }
+                else{
+                    if(!parseNumber(&p,&value) || !isfinite(value)){
+                        return false;
+                    }
+                    *micros = CUSTOM_RAW_ELAPSED_ORIGIN*MICROS_PER_SECOND+llround(value*MICROS_PER_SECOND);
+                }
+                break;
+            default:
+                if(!parseNumber(&p,&value)){
+                    return false;
+                }
+                xyz[format->columns[c]-COLUMN_X] = (float)value;
+                break;
+        }
+        p = skipBlanks(format,p);
+        if(!isFieldEnd(format,*p)){
+            return false;
+        }
+    }
+    return true;
+}
+
+static void countChunkLines(unsigned int chunkIndex, unsigned int workerIndex, void * userData){
+    text_chunk_t * chunk = ((parse_job_t*)userData)->chunks+chunkIndex;
+    const char * p = chunk->start, * newline;
+    (void)workerIndex;
+    for(chunk->numLines=0;p<chunk->end;chunk->numLines++){
+        newline = memchr(p,'\n',(size_t)(chunk->end-p));
+        p = newline!=NULL ? newline+1 : chunk->end;
+    }
+}
+
+static void parseChunk(unsigned int chunkIndex, unsigned int workerIndex, void * userData){
+    parse_job_t * job = (parse_job_t*)userData;
+    text_chunk_t * chunk = job->chunks+chunkIndex;
+    const char * p = chunk->start, * newline, * blank;
+    uint64_t row = chunk->firstRow;
+    float xyz[3];
+    (void)workerIndex;
+    for(chunk->numRows=0;p<chunk->end;p = newline!=NULL ? newline+1 : chunk->end){
+        newline = memchr(p,'\n',(size_t)(chunk->end-p));
+        if(parseLine(job->format,p,job->micros+row,xyz)){
+            job->xyz[row] = xyz[0];
+            job->xyz[job->stride+row] = xyz[1];
+            job->xyz[2*job->stride+row] = xyz[2];
+            row++;
+            chunk->numRows++;
+        }
+        else{
+            for(blank=p;blank<chunk->end && (isBlank(*blank) || *blank=='\r');blank++);
+            if(blank<chunk->end && *blank!='\n'){
+                chunk->numDropped++;
+            }
+        }
+    }
+}
+
+static char * readWholeFile(const char * filename, size_t * numBytes){
+    FILE * fid = fopen(filename,"rb");
+    char * text;
+    long length;
+    if(fid==NULL){
+        return NULL;
+    }
+    if(fseek(fid,0,SEEK_END)!=0 || (length=ftell(fid))<0 || fseek(fid,0,SEEK_SET)!=0){
+        fclose(fid);
+        return NULL;
+    }
+    text = malloc((size_t)length+1);
+    if(text!=NULL && fread(text,1,(size_t)length,fid)!=(size_t)length){
+        free(text);
+        text = NULL;
+    }
+    fclose(fid);
+    if(text!=NULL){
+        text[length] = '\0';
+        *numBytes = (size_t)length;
+    }
+    return text;
+}
+
+bool loadCustomRawFile(const char * filename, const custom_raw_format_t * format, unsigned int numWorkers, custom_raw_t * parsed){
+    parse_job_t job;
+    size_t numBytes, chunkBytes;
+    char * text = readWholeFile(filename,&numBytes);
+    const char * body, * end, * newline;
+    unsigned int numChunks, c, h, axis;
+    uint64_t numLines = 0, numRows = 0, row;
+
+    memset(parsed,0,sizeof(custom_raw_t));
+    if(text==NULL){
+        fprintf(stderr,"Could not read %s\n",filename);
+        return false;
+    }
+    end = text+numBytes;
+    for(body=text,h=0;h<format->headerLines && body<end;h++){
+        newline = memchr(body,'\n',(size_t)(end-body));
+        body = newline!=NULL ? newline+1 : end;
+    }
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    numChunks = numWorkers*CHUNKS_PER_WORKER;
+    if((size_t)(end-body)/MIN_CHUNK_BYTES<numChunks){
+        numChunks = (unsigned int)((size_t)(end-body)/MIN_CHUNK_BYTES)+1;
+    }
+    chunkBytes = (size_t)(end-body)/numChunks;
+
+    // chunks start on line boundaries
+    memset(&job,0,sizeof(job));
+    job.format = format;
+    job.chunks = calloc(numChunks,sizeof(text_chunk_t));
+    for(c=0;c<numChunks;c++){
+        job.chunks[c].start = c==0 ? body : job.chunks[c-1].end;
+        job.chunks[c].end = c==numChunks-1 ? end : body+(c+1)*chunkBytes;
+        if(job.chunks[c].end<job.chunks[c].start){
+            job.chunks[c].end = job.chunks[c].start;
+        }
+        else if(c<numChunks-1 && job.chunks[c].end>body && job.chunks[c].end[-1]!='\n'){
+            newline = memchr(job.chunks[c].end,'\n',(size_t)(end-job.chunks[c].end));
+            job.chunks[c].end = newline!=NULL ? newline+1 : end;
+        }
+    }
+    parallelFor(numChunks,numWorkers,countChunkLines,&job,NULL);
+    for(c=0;c<numChunks;c++){
+        job.chunks[c].firstRow = numLines;
+        numLines += job.chunks[c].numLines;
+    }
+    job.stride = numLines;
+    job.micros = malloc((numLines>0 ? numLines : 1)*sizeof(int64_t));
+    job.xyz = malloc((numLines>0 ? numLines : 1)*3*sizeof(float));
+    parallelFor(numChunks,numWorkers,parseChunk,&job,NULL);
+
+    // close the gaps left by dropped lines, axis by axis so no source is overwritten before it moves
+    for(c=0;c<numChunks;c++){
+        numRows += job.chunks[c].numRows;
+        parsed->numDropped += job.chunks[c].numDropped;
+    }
+    for(row=0,c=0;c<numChunks;row+=job.chunks[c].numRows,c++){
+        memmove(job.micros+row,job.micros+job.chunks[c].firstRow,job.chunks[c].numRows*sizeof(int64_t));
+    }
+    for(axis=0;axis<3;axis++){
+        for(row=0,c=0;c<numChunks;row+=job.chunks[c].numRows,c++){
+            memmove(job.xyz+axis*numRows+row,job.xyz+axis*job.stride+job.chunks[c].firstRow,job.chunks[c].numRows*sizeof(float));
+        }
+    }
+    parsed->numRows = numRows;
+    parsed->micros = job.micros;
+    parsed->xyz = job.xyz;
+    free(job.chunks);
+    free(text);
+    return true;
+}
+
+void freeCustomRaw(custom_raw_t * parsed){
+    free(parsed->micros);
+    free(parsed->xyz);
+    memset(parsed,0,sizeof(custom_raw_t));
+}
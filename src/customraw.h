@@ -0,0 +1,99 @@
+//
+//  customraw.h
+//  Parser for raw accelerations in user described delimited text formats (the fmtStruct of
+//  PASensorData.loadCustomRawFile).  The description is compiled once into a column plan:
+//  the role of each column up to the last one used (time, x, y, z or skipped), and, for
+//  datetime stamps, a token plan built from the MATLAB datetime format string (e.g.
+//  'yyyy-MM-dd HH:mm:ss.SSS').  Formats made only of fixed width fields are parsed at fixed
+//  offsets; others walk the tokens.  Columns after the last one used are never parsed.
+//
+//  The file is read whole and cut into chunks on line boundaries that are parsed across
+//  worker threads.  Times come out as integer microseconds of wall clock time since
+//  1970-01-01 (see tm2wallclock); elapsed seconds count from CUSTOM_RAW_ELAPSED_ORIGIN, the
+//  origin loadCustomRawFile has always used.  Lines that do not parse (blank lines included)
+//  are dropped.
+//
+
+#ifndef in_customraw_h
+#define in_customraw_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CUSTOM_RAW_MAX_COLUMNS 64
+#define CUSTOM_RAW_MAX_TOKENS 32
+#define CUSTOM_RAW_ELAPSED_ORIGIN 1000166400LL   // 2001-09-11 00:00:00, in wall clock seconds
+#define MICROS_PER_SECOND 1000000LL
+
+typedef enum{
+    COLUMN_SKIP = 0,
+    COLUMN_TIME,
+    COLUMN_X,
+    COLUMN_Y,
+    COLUMN_Z
+} custom_column_t;
+
+typedef enum{
+    TIME_ELAPSED = 0,   // seconds, as a number
+    TIME_DATETIME       // text laid out by the datetime format string
+} custom_time_t;
+
+typedef enum{
+    TOKEN_LITERAL = 0,
+    TOKEN_YEAR,
+    TOKEN_MONTH,
+    TOKEN_DAY,
+    TOKEN_HOUR,
+    TOKEN_HOUR12,
+    TOKEN_MINUTE,
+    TOKEN_SECOND,
+    TOKEN_FRACTION,
+    TOKEN_AMPM
+} datetime_token_id_t;
+
+typedef struct{
+    datetime_token_id_t id;
+    unsigned int width;   // digits of fixed width fields, 0 when variable (1 or 2 digits)
+    unsigned int offset;  // from the start of the stamp, when isFixedLayout
+    char literal;
+} datetime_token_t;
+
+typedef struct{
+    unsigned int numColumns;  // columns parsed: up to and including the last one used
+    custom_column_t columns[CUSTOM_RAW_MAX_COLUMNS];
+    char delimiter;
+    unsigned int headerLines;
+    custom_time_t timeType;
+    unsigned int numTokens;
+    datetime_token_t tokens[CUSTOM_RAW_MAX_TOKENS];
+    bool isFixedLayout;
+    unsigned int stampLength; // characters in a stamp, when isFixedLayout
+} custom_raw_format_t;
+
+typedef struct{
+    uint64_t numRows;
+    uint64_t numDropped;  // non blank lines that did not parse
+    int64_t * micros;     // numRows
+    float * xyz;          // numRows x, then numRows y, then numRows z
+} custom_raw_t;
+
+// Compiles a datetime format made of yyyy, yy, MM, M, dd, d, HH, H, hh, h, mm, m, ss, s,
+// S (1 to 9), a and literal characters ('quoted' text included).  @retval false if the
+// format uses anything else.
+bool compileDatetimeFormat(const char * datetimeFmtStr, custom_raw_format_t * format);
+
+// Column indices are 1-based, as in fmtStruct.  delimiter "\t" (escaped) means a tab.
+// @retval false on a bad column index, delimiter or datetime format.
+bool compileCustomRawFormat(unsigned int timeColumn, unsigned int xColumn, unsigned int yColumn, unsigned int zColumn,
+                            const char * delimiter, unsigned int headerLines, custom_time_t timeType,
+                            const char * datetimeFmtStr, custom_raw_format_t * format);
+
+// Parses one stamp at text; *end is set past it.  @retval false if it does not fit the format.
+bool parseCustomDatetime(const custom_raw_format_t * format, const char * text, const char ** end, int64_t * micros);
+
+// numWorkers 0 => one per core.  @retval false if filename cannot be read; parsed must be
+// released with freeCustomRaw.
+bool loadCustomRawFile(const char * filename, const custom_raw_format_t * format, unsigned int numWorkers, custom_raw_t * parsed);
+void freeCustomRaw(custom_raw_t * parsed);
+
+#endif /* in_customraw_h */
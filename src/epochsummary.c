@@ -0,0 +1,160 @@
+//
+//  epochsummary.c
+//  Per second summary of raw accelerations.  See epochsummary.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "epochsummary.h"
+
+static void startSecond(epoch_summarizer_t * summarizer){
+    unsigned int axis;
+    summarizer->count = 0;
+    summarizer->sumENMO = 0;
+    memset(&summarizer->current,0,sizeof(epoch_second_t));
+    for(axis=0;axis<EPOCH_AXES;axis++){
+        summarizer->sum[axis] = 0;
+        summarizer->sumSquares[axis] = 0;
+        summarizer->current.min[axis] = INFINITY;
+        summarizer->current.max[axis] = -INFINITY;
+    }
+}
+
+epoch_summarizer_t * createEpochSummarizer(unsigned int samplerate, double clipG){
+    epoch_summarizer_t * summarizer;
+    if(samplerate==0){
+        return NULL;
+    }
+    summarizer = calloc(1,sizeof(epoch_summarizer_t));
+    summarizer->samplerate = samplerate;
+    summarizer->clipG = (float)(clipG>0 ? clipG : EPOCH_DEFAULT_CLIP_G);
+    startSecond(summarizer);
+    return summarizer;
+}
+
+void freeEpochSummarizer(epoch_summarizer_t * summarizer){
+    if(summarizer!=NULL){
+        free(summarizer->seconds);
+        free(summarizer);
+    }
+}
+
+static void finishSecond(epoch_summarizer_t * summarizer){
+    epoch_second_t * second = &summarizer->current;
+    double n = summarizer->count, variance, sumStd = 0;
+    unsigned int axis;
+    for(axis=0;axis<EPOCH_AXES;axis++){
+        second->mean[axis] = (float)(summarizer->sum[axis]/n);
+        variance = n>1 ? (summarizer->sumSquares[axis]-summarizer->sum[axis]*summarizer->sum[axis]/n)/(n-1) : 0;
+        second->std[axis] = (float)sqrt(variance>0 ? variance : 0);
+        sumStd += second->std[axis];
+    }
+    second->enmo = (float)(summarizer->sumENMO/n);
+    second->baiSigma = (float)(sumStd/EPOCH_AXES);
+    if(summarizer->numSeconds==summarizer->capacity){
+        summarizer->capacity = summarizer->capacity>0 ? summarizer->capacity*2 : 3600;
+        summarizer->seconds = realloc(summarizer->seconds,(size_t)summarizer->capacity*sizeof(epoch_second_t));
+    }
+    summarizer->seconds[summarizer->numSeconds++] = *second;
+    startSecond(summarizer);
+}
+
+void addEpochSamples(epoch_summarizer_t * summarizer, const float * xyz, uint64_t numSamples){
+    epoch_second_t * second = &summarizer->current;
+    const float * sample;
+    double magnitude;
+    uint64_t s;
+    unsigned int axis;
+    float value;
+    for(s=0;s<numSamples;s++){
+        sample = xyz+3*s;
+        magnitude = 0;
+        for(axis=0;axis<EPOCH_AXES;axis++){
+            value = sample[axis];
+            summarizer->sum[axis] += value;
+            summarizer->sumSquares[axis] += (double)value*value;
+            if(value<second->min[axis]){
+                second->min[axis] = value;
+            }
+            if(value>second->max[axis]){
+                second->max[axis] = value;
+            }
+            if(fabsf(value)>=summarizer->clipG && second->clipCount[axis]<UINT16_MAX){
+                second->clipCount[axis]++;
+            }
+            if(summarizer->hasPrevious && value==summarizer->previous[axis] && second->stuckCount[axis]<UINT16_MAX){
+                second->stuckCount[axis]++;
+            }
+            summarizer->previous[axis] = value;
+            magnitude += (double)value*value;
+        }
+        summarizer->hasPrevious = true;
+        magnitude = sqrt(magnitude)-1;
+        summarizer->sumENMO += magnitude>0 ? magnitude : 0;
+        if(++summarizer->count==summarizer->samplerate){
+            finishSecond(summarizer);
+        }
+    }
+}
+
+bool writeEpochSummary(const char * filename, const epoch_summarizer_t * summarizer, double startDatenum, uint64_t binSize, double binModifiedDatenum){
+    epoch_summary_header_t header;
+    bool didWrite;
+    FILE * fid = fopen(filename,"wb");
+    if(fid==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",filename);
+        return false;
+    }
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,EPOCH_SUMMARY_MAGIC,sizeof(EPOCH_SUMMARY_MAGIC));
+    header.version = EPOCH_SUMMARY_VERSION;
+    header.samplerate = (uint16_t)summarizer->samplerate;
+    header.numAxes = EPOCH_AXES;
+    header.numSeconds = summarizer->numSeconds;
+    header.clipG = summarizer->clipG;
+    header.startDatenum = startDatenum;
+    header.binSize = binSize;
+    header.binModifiedDatenum = binModifiedDatenum;
+    didWrite = fwrite(&header,sizeof(header),1,fid)==1 &&
+               fwrite(summarizer->seconds,sizeof(epoch_second_t),summarizer->numSeconds,fid)==summarizer->numSeconds;
+    didWrite = fclose(fid)==0 && didWrite;
+    return didWrite;
+}
+
+epoch_second_t * readEpochSummary(const char * filename, epoch_summary_header_t * header){
+    epoch_second_t * seconds;
+    FILE * fid = fopen(filename,"rb");
+    if(fid==NULL){
+        return NULL;
+    }
+    if(fread(header,sizeof(epoch_summary_header_t),1,fid)!=1 || strncmp(header->magic,EPOCH_SUMMARY_MAGIC,8)!=0 ||
+       header->version!=EPOCH_SUMMARY_VERSION || header->numAxes!=EPOCH_AXES){
+        fprintf(stderr,"%s is not an epoch summary\n",filename);
+        fclose(fid);
+        return NULL;
+    }
+    seconds = malloc((header->numSeconds>0 ? header->numSeconds : 1)*sizeof(epoch_second_t));
+    if(fread(seconds,sizeof(epoch_second_t),header->numSeconds,fid)!=header->numSeconds){
+        fprintf(stderr,"%s is shorter than its header states\n",filename);
+        free(seconds);
+        seconds = NULL;
+    }
+    fclose(fid);
+    return seconds;
+}
+
+bool getEpochSummaryFilename(const char * binFilename, char * sidecarFilename, size_t sz_sidecarFilename){
+    const char * extension = strrchr(binFilename,'.'), * separator = strrchr(binFilename,'/');
+    size_t length = strlen(binFilename);
+    if(extension!=NULL && (separator==NULL || extension>separator)){
+        length = (size_t)(extension-binFilename);
+    }
+    if(length+strlen(EPOCH_SUMMARY_EXTENSION)+1>sz_sidecarFilename){
+        return false;
+    }
+    memcpy(sidecarFilename,binFilename,length);
+    strcpy(sidecarFilename+length,EPOCH_SUMMARY_EXTENSION);
+    return true;
+}
@@ -0,0 +1,89 @@
+//
+//  epochsummary.h
+//  Per second summary of raw accelerations, written next to a Padaco .bin file (<name>.sec)
+//  in the same pass that converts it, so that classifiers and cohort summaries that work in
+//  one second blocks do not have to read the raw samples again.
+//
+//  Each whole second of samples gets, per axis: mean, standard deviation (n-1), minimum,
+//  maximum, the number of clipped samples (|value| at or beyond clipG) and the number of
+//  stuck samples (equal to the sample before them); and over the axes: ENMO (mean of
+//  max(0, |xyz|-1)) and the Bai sigma (mean of the three standard deviations, as in
+//  PAClassifyGravities.classifiyBaiActivity).  A trailing partial second is dropped.
+//
+//  File layout (native byte order): epoch_summary_header_t followed by numSeconds
+//  epoch_second_t records.  The header records the size and modification time of the .bin
+//  file summarized, so that a summary left behind when the .bin file is rewritten (e.g.
+//  recalibrated or appended to) is not taken for it.
+//
+
+#ifndef in_epochsummary_h
+#define in_epochsummary_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EPOCH_SUMMARY_MAGIC "PZSEC1"
+#define EPOCH_SUMMARY_VERSION 2
+#define EPOCH_SUMMARY_EXTENSION ".sec"
+#define EPOCH_AXES 3
+#define EPOCH_DEFAULT_CLIP_G 7.95   // just inside the +/-8 g range of current ActiGraph devices
+
+#pragma pack(push,1)
+typedef struct epoch_summary_header_t{
+    char magic[8];
+    uint32_t version;
+    uint16_t samplerate;
+    uint16_t numAxes;
+    uint32_t numSeconds;
+    float clipG;
+    double startDatenum;
+    uint64_t binSize;               // bytes
+    double binModifiedDatenum;      // local time, as MATLAB's dir reports it
+} epoch_summary_header_t;
+
+typedef struct epoch_second_t{
+    float mean[EPOCH_AXES];
+    float std[EPOCH_AXES];
+    float min[EPOCH_AXES];
+    float max[EPOCH_AXES];
+    float enmo;
+    float baiSigma;
+    uint16_t clipCount[EPOCH_AXES];
+    uint16_t stuckCount[EPOCH_AXES];
+} epoch_second_t;
+#pragma pack(pop)
+
+typedef struct epoch_summarizer_t{
+    unsigned int samplerate;
+    float clipG;
+
+    // second being accumulated
+    unsigned int count;
+    double sum[EPOCH_AXES];
+    double sumSquares[EPOCH_AXES];
+    double sumENMO;
+    epoch_second_t current;
+    float previous[EPOCH_AXES];
+    bool hasPrevious;
+
+    uint32_t numSeconds;
+    uint32_t capacity;
+    epoch_second_t * seconds;
+} epoch_summarizer_t;
+
+// clipG <= 0 uses EPOCH_DEFAULT_CLIP_G.  @retval NULL if samplerate is 0.
+epoch_summarizer_t * createEpochSummarizer(unsigned int samplerate, double clipG);
+void freeEpochSummarizer(epoch_summarizer_t * summarizer);
+
+// Adds numSamples interleaved x, y, z samples; may be called block by block.
+void addEpochSamples(epoch_summarizer_t * summarizer, const float * xyz, uint64_t numSamples);
+
+bool writeEpochSummary(const char * filename, const epoch_summarizer_t * summarizer, double startDatenum, uint64_t binSize, double binModifiedDatenum);
+
+// @retval malloc'd seconds (header->numSeconds of them) or NULL.
+epoch_second_t * readEpochSummary(const char * filename, epoch_summary_header_t * header);
+
+// Writes <binFilename less its extension>.sec into sidecarFilename.  @retval false if too long.
+bool getEpochSummaryFilename(const char * binFilename, char * sidecarFilename, size_t sz_sidecarFilename);
+
+#endif /* in_epochsummary_h */
@@ -0,0 +1,116 @@
+/*
+ * exclusionindex.c - packs and queries the time of day bitsets of PAExclusionIndex (see
+ * bitindex.h).
+ *
+ * The calling syntax is:
+ *
+ *		[words, blocks] = exclusionindex('pack', bits)
+ *		rows = exclusionindex('query', words, blocks, numColumns, startColumn, stopColumn)
+ *		rows = exclusionindex('query', words, blocks, numColumns, startColumn, stopColumn, tagIndices)
+ *
+ * bits is a numRows x numColumns logical matrix (numColumns <= 4096).  words is a
+ * numRows x numWords x numTags uint64 array and blocks a numRows x numTags uint64 matrix.
+ * startColumn and stopColumn are 1 based and inclusive; a window with startColumn >
+ * stopColumn wraps past midnight.  rows is a numRows x 1 logical vector that is true where
+ * any of the tags (all tags by default) has a bit set within the window.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O exclusionindex.c bitindex.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "bitindex.h"
+
+static void packBits(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    unsigned int numRows, numColumns, numWords;
+
+    if(nrhs != 2 || !mxIsLogical(prhs[1]) || mxGetNumberOfDimensions(prhs[1]) != 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:pack",
+                "A logical matrix of bits is required for packing.");
+    }
+    numRows = (unsigned int)mxGetM(prhs[1]);
+    numColumns = (unsigned int)mxGetN(prhs[1]);
+    if(numColumns > BITINDEX_MAX_COLUMNS) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:columns",
+                "At most %u columns can be packed.", BITINDEX_MAX_COLUMNS);
+    }
+    numWords = getBitIndexWordCount(numColumns);
+    plhs[0] = mxCreateNumericMatrix(numRows, numWords, mxUINT64_CLASS, mxREAL);
+    plhs[1] = mxCreateNumericMatrix(numRows, 1, mxUINT64_CLASS, mxREAL);
+    packBitRows((const bool*)mxGetData(prhs[1]), numRows, numColumns, (uint64_t*)mxGetData(plhs[0]), (uint64_t*)mxGetData(plhs[1]));
+}
+
+static void queryBits(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    const mwSize * dims;
+    const uint64_t * words, * blocks;
+    unsigned int numRows, numWords, numTags, numColumns, startColumn, stopColumn, t, tag;
+    size_t numTagIndices;
+    double * tagIndices = NULL;
+    bool * rows;
+
+    if(nrhs != 6 && nrhs != 7) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:query",
+                "Words, blocks, column count, start column and stop column are required for a query.");
+    }
+    if(!mxIsUint64(prhs[1]) || !mxIsUint64(prhs[2])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:class",
+                "Words and blocks must be uint64 arrays.");
+    }
+    dims = mxGetDimensions(prhs[1]);
+    numRows = (unsigned int)dims[0];
+    numWords = (unsigned int)dims[1];
+    numTags = mxGetNumberOfDimensions(prhs[1]) > 2 ? (unsigned int)dims[2] : 1;
+    numColumns = (unsigned int)mxGetScalar(prhs[3]);
+    startColumn = (unsigned int)mxGetScalar(prhs[4]);
+    stopColumn = (unsigned int)mxGetScalar(prhs[5]);
+    if(mxGetM(prhs[2]) != numRows || mxGetN(prhs[2]) != numTags || getBitIndexWordCount(numColumns) != numWords ||
+       startColumn < 1 || stopColumn < 1) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:dims",
+                "Words, blocks, column count and window do not agree.");
+    }
+    words = (const uint64_t*)mxGetData(prhs[1]);
+    blocks = (const uint64_t*)mxGetData(prhs[2]);
+    numTagIndices = numTags;
+    if(nrhs == 7) {
+        tagIndices = mxGetPr(prhs[6]);
+        numTagIndices = mxGetNumberOfElements(prhs[6]);
+    }
+
+    plhs[0] = mxCreateLogicalMatrix(numRows, 1);
+    rows = (bool*)mxGetLogicals(plhs[0]);
+    for(t=0; t<numTagIndices; t++) {
+        tag = tagIndices == NULL ? t : (unsigned int)tagIndices[t]-1;
+        if(tag >= numTags) {
+            mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:tag",
+                    "Tag index %u exceeds the %u tags indexed.", tag+1, numTags);
+        }
+        queryBitRows(words+(size_t)tag*numRows*numWords, blocks+(size_t)tag*numRows, numRows, numColumns,
+                     startColumn-1, stopColumn-1, rows);
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char operation[8];
+
+    if(nrhs < 1 || !mxIsChar(prhs[0]) || mxGetString(prhs[0], operation, sizeof(operation)) != 0) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:nrhs",
+                "The first input must be 'pack' or 'query'.");
+    }
+    if(strcmp(operation, "pack") == 0) {
+        packBits(nlhs, plhs, nrhs, prhs);
+    }
+    else if(strcmp(operation, "query") == 0) {
+        queryBits(nlhs, plhs, nrhs, prhs);
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:exclusionindex:operation",
+                "Unknown operation '%s'; use 'pack' or 'query'.", operation);
+    }
+}
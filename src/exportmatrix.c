@@ -0,0 +1,106 @@
+/*
+ * exportmatrix.c - writes a numeric matrix with optional header text, column names and row
+ * names to a delimited text file or a binary columnar file for R (see exportwriter.h).
+ *
+ * The calling syntax is:
+ *
+ *		exportmatrix(filename, values)
+ *		exportmatrix(filename, values, header, columnNames, rowNames, format)
+ *
+ * values is an NxM double matrix.  header is text written ahead of the rows ('' for a line
+ * of column names instead); columnNames a cell of M strings and rowNames a cell of N
+ * strings, either of which may be {}.  format is 'csv' (default; ', ' delimited) or 'bin'
+ * (columnar; read in R with tools/r_scripts/read_padaco_columns.R).  Numbers are written
+ * so they read back exactly (17 significant digits).
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O exportmatrix.c exportwriter.c in_parallel.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "exportwriter.h"
+
+// @retval numStrings strings of names (a cell of strings) or NULL when names is empty.
+static char ** getNames(const mxArray * names, size_t numStrings, const char * description){
+    char ** strings;
+    size_t n;
+    if(names==NULL || mxIsEmpty(names)) {
+        return NULL;
+    }
+    if(!mxIsCell(names) || mxGetNumberOfElements(names)!=numStrings) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:names",
+                "%s must be a cell of %u strings.",description,(unsigned int)numStrings);
+    }
+    strings = mxCalloc(numStrings>0 ? numStrings : 1,sizeof(char*));
+    for(n=0;n<numStrings;n++) {
+        if((strings[n]=mxArrayToString(mxGetCell(names,n)))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:names",
+                    "%s must contain strings only.",description);
+        }
+    }
+    return strings;
+}
+
+static void freeNames(char ** strings, size_t numStrings){
+    size_t n;
+    if(strings!=NULL) {
+        for(n=0;n<numStrings;n++) {
+            mxFree(strings[n]);
+        }
+        mxFree(strings);
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    export_matrix_t matrix;
+    char * filename, * header = NULL, * format = NULL, ** columnNames, ** rowNames;
+    bool didWrite;
+
+    if(nrhs < 2 || nrhs > 6) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:nrhs",
+                "A filename and a matrix are required inputs.");
+    }
+    if(!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]) || mxGetNumberOfDimensions(prhs[1])>2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:notDouble",
+                "Values must be a real double matrix.");
+    }
+    if((filename=mxArrayToString(prhs[0]))==NULL || (nrhs>2 && !mxIsEmpty(prhs[2]) && (header=mxArrayToString(prhs[2]))==NULL) ||
+       (nrhs>5 && (format=mxArrayToString(prhs[5]))==NULL)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:notString",
+                "Filename, header and format must be strings.");
+    }
+    if(format!=NULL && strcmp(format,"csv")!=0 && strcmp(format,"bin")!=0) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:format",
+                "Unknown format (%s); use 'csv' or 'bin'.",format);
+    }
+    memset(&matrix,0,sizeof(export_matrix_t));
+    matrix.values = mxGetPr(prhs[1]);
+    matrix.numRows = mxGetM(prhs[1]);
+    matrix.numColumns = (unsigned int)mxGetN(prhs[1]);
+    matrix.header = header;
+    columnNames = getNames(nrhs>3 ? prhs[3] : NULL,matrix.numColumns,"Column names");
+    rowNames = getNames(nrhs>4 ? prhs[4] : NULL,(size_t)matrix.numRows,"Row names");
+    matrix.columnNames = (const char * const *)columnNames;
+    matrix.rowNames = (const char * const *)rowNames;
+
+    if(format!=NULL && strcmp(format,"bin")==0) {
+        didWrite = writeExportColumns(filename,&matrix);
+    }
+    else {
+        didWrite = writeExportText(filename,&matrix,0);
+    }
+    freeNames(rowNames,(size_t)matrix.numRows);
+    freeNames(columnNames,matrix.numColumns);
+    mxFree(header);
+    mxFree(format);
+    if(!didWrite) {
+        mexErrMsgIdAndTxt("PadacoToolbox:exportmatrix:write",
+                "Could not write %s.",filename);
+    }
+    mxFree(filename);
+}
@@ -0,0 +1,194 @@
+//
+//  exportwriter.c
+//  Bulk writer for numeric export tables.  See exportwriter.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "exportwriter.h"
+#include "in_parallel.h"
+
+#define SZ_WRITE_BUFFER (1<<20)
+#define BLOCKS_PER_WORKER 4
+
+typedef struct{
+    char * text;
+    size_t length;
+    size_t capacity;
+} text_block_t;
+
+typedef struct{
+    const export_matrix_t * matrix;
+    const char * delimiter;
+    size_t sz_delimiter;
+    uint64_t firstBlock;
+    text_block_t * blocks;
+} format_job_t;
+
+static int formatWholeNumber(double value, char * text){
+    char digits[SZ_EXPORT_NUMBER];
+    uint64_t magnitude = (uint64_t)fabs(value);
+    int numDigits = 0, length = 0;
+    if(value<0){
+        text[length++] = '-';
+    }
+    do{
+        digits[numDigits++] = (char)('0'+magnitude%10);
+        magnitude /= 10;
+    }while(magnitude>0);
+    while(numDigits>0){
+        text[length++] = digits[--numDigits];
+    }
+    text[length] = '\0';
+    return length;
+}
+
+int formatExportNumber(double value, char * text){
+    if(isnan(value)){
+        return sprintf(text,"NaN");
+    }
+    if(isinf(value)){
+        return sprintf(text,value>0 ? "Inf" : "-Inf");
+    }
+    // counts, IDs and indices dominate the exports and skip snprintf altogether
+    if(value==floor(value) && fabs(value)<1e15){
+        return formatWholeNumber(value,text);
+    }
+    return snprintf(text,SZ_EXPORT_NUMBER,"%.17g",value);
+}
+
+static void appendText(text_block_t * block, const char * text, size_t length){
+    if(block->length+length+1>block->capacity){
+        block->capacity = (block->length+length+1)*2;
+        block->text = realloc(block->text,block->capacity);
+    }
+    memcpy(block->text+block->length,text,length);
+    block->length += length;
+}
+
+static void formatBlock(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    format_job_t * job = (format_job_t*)userData;
+    const export_matrix_t * matrix = job->matrix;
+    text_block_t * block = &job->blocks[taskIndex];
+    uint64_t row = (job->firstBlock+taskIndex)*EXPORT_ROWS_PER_BLOCK, lastRow = row+EXPORT_ROWS_PER_BLOCK;
+    char number[SZ_EXPORT_NUMBER];
+    unsigned int c;
+    int length;
+    (void)workerIndex;
+
+    if(lastRow>matrix->numRows){
+        lastRow = matrix->numRows;
+    }
+    block->length = 0;
+    for(;row<lastRow;row++){
+        if(matrix->rowNames!=NULL){
+            appendText(block,matrix->rowNames[row],strlen(matrix->rowNames[row]));
+        }
+        for(c=0;c<matrix->numColumns;c++){
+            if(c>0 || matrix->rowNames!=NULL){
+                appendText(block,job->delimiter,job->sz_delimiter);
+            }
+            length = formatExportNumber(matrix->values[(size_t)c*matrix->numRows+row],number);
+            appendText(block,number,(size_t)length);
+        }
+        appendText(block,"\n",1);
+    }
+}
+
+static void writeHeaderText(FILE * fid, const export_matrix_t * matrix, const char * delimiter){
+    size_t length;
+    unsigned int c;
+    if(matrix->header!=NULL && (length=strlen(matrix->header))>0){
+        fwrite(matrix->header,1,length,fid);
+        if(matrix->header[length-1]!='\n'){
+            fputc('\n',fid);
+        }
+    }
+    else if(matrix->columnNames!=NULL){
+        for(c=0;c<matrix->numColumns;c++){
+            if(c>0 || matrix->rowNames!=NULL){
+                fputs(delimiter,fid);
+            }
+            fputs(matrix->columnNames[c],fid);
+        }
+        fputc('\n',fid);
+    }
+}
+
+bool writeExportText(const char * filename, const export_matrix_t * matrix, unsigned int numWorkers){
+    format_job_t job;
+    uint64_t numBlocks = (matrix->numRows+EXPORT_ROWS_PER_BLOCK-1)/EXPORT_ROWS_PER_BLOCK;
+    unsigned int blocksPerBatch, numInBatch, b;
+    bool didWrite = true;
+    FILE * fid = fopen(filename,"wb");
+    if(fid==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",filename);
+        return false;
+    }
+    setvbuf(fid,NULL,_IOFBF,SZ_WRITE_BUFFER);
+    job.matrix = matrix;
+    job.delimiter = matrix->delimiter!=NULL ? matrix->delimiter : ", ";
+    job.sz_delimiter = strlen(job.delimiter);
+    writeHeaderText(fid,matrix,job.delimiter);
+
+    // A batch of blocks is formatted in parallel and then written in order, which bounds
+    // the text held in memory to the batch.
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    blocksPerBatch = numWorkers*BLOCKS_PER_WORKER;
+    job.blocks = calloc(blocksPerBatch,sizeof(text_block_t));
+    for(job.firstBlock=0;job.firstBlock<numBlocks && didWrite;job.firstBlock+=numInBatch){
+        numInBatch = numBlocks-job.firstBlock<blocksPerBatch ? (unsigned int)(numBlocks-job.firstBlock) : blocksPerBatch;
+        parallelFor(numInBatch,numWorkers,formatBlock,&job,NULL);
+        for(b=0;b<numInBatch && didWrite;b++){
+            didWrite = fwrite(job.blocks[b].text,1,job.blocks[b].length,fid)==job.blocks[b].length;
+        }
+    }
+    for(b=0;b<blocksPerBatch;b++){
+        free(job.blocks[b].text);
+    }
+    free(job.blocks);
+    didWrite = fclose(fid)==0 && didWrite;
+    return didWrite;
+}
+
+static bool writeColumnString(FILE * fid, const char * text){
+    int32_t length = text!=NULL ? (int32_t)strlen(text) : 0;
+    return fwrite(&length,sizeof(int32_t),1,fid)==1 && (length==0 || fwrite(text,1,(size_t)length,fid)==(size_t)length);
+}
+
+bool writeExportColumns(const char * filename, const export_matrix_t * matrix){
+    int32_t header[4];
+    char magic[8] = EXPORT_COLUMNS_MAGIC;
+    uint64_t r;
+    unsigned int c;
+    bool didWrite;
+    FILE * fid;
+
+    if(matrix->numRows>INT32_MAX || matrix->numColumns>INT32_MAX){
+        fprintf(stderr,"Too many rows or columns for %s\n",filename);
+        return false;
+    }
+    if((fid=fopen(filename,"wb"))==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",filename);
+        return false;
+    }
+    setvbuf(fid,NULL,_IOFBF,SZ_WRITE_BUFFER);
+    header[0] = EXPORT_COLUMNS_VERSION;
+    header[1] = (int32_t)matrix->numColumns;
+    header[2] = (int32_t)matrix->numRows;
+    header[3] = matrix->rowNames!=NULL;
+    didWrite = fwrite(magic,1,8,fid)==8 && fwrite(header,sizeof(int32_t),4,fid)==4 && writeColumnString(fid,matrix->header);
+    for(c=0;c<matrix->numColumns && didWrite;c++){
+        didWrite = writeColumnString(fid,matrix->columnNames!=NULL ? matrix->columnNames[c] : NULL);
+    }
+    for(r=0;r<matrix->numRows && didWrite && matrix->rowNames!=NULL;r++){
+        didWrite = writeColumnString(fid,matrix->rowNames[r]);
+    }
+    didWrite = didWrite && fwrite(matrix->values,sizeof(double),(size_t)matrix->numRows*matrix->numColumns,fid)==(size_t)matrix->numRows*matrix->numColumns;
+    didWrite = fclose(fid)==0 && didWrite;
+    return didWrite;
+}
@@ -0,0 +1,48 @@
+//
+//  exportwriter.h
+//  Bulk writer for numeric export tables (cluster shapes, load shapes, covariates): a matrix
+//  of doubles with optional row and column names, written either as delimited text or as a
+//  binary columnar file for R (see tools/r_scripts/read_padaco_columns.R).
+//
+//  Numbers are written so they read back to the same double: whole numbers as integers,
+//  others with 17 significant digits ("%.17g", so 0.1 is written 0.10000000000000001).
+//  NaN and infinities are written as NaN, Inf and -Inf.  Text is formatted in
+//  blocks of rows across worker threads and written block by block in order.
+//
+//  Columnar layout (native byte order, counts are int32 so R's readBin can read them):
+//  magic "PADCOL1\0", version, numColumns, numRows, hasRowNames, then the header text,
+//  numColumns column names and, if hasRowNames, numRows row names (each an int32 byte
+//  count followed by the bytes), then numColumns columns of numRows float64 values.
+//
+
+#ifndef in_exportwriter_h
+#define in_exportwriter_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EXPORT_COLUMNS_MAGIC "PADCOL1"
+#define EXPORT_COLUMNS_VERSION 1
+#define SZ_EXPORT_NUMBER 32
+#define EXPORT_ROWS_PER_BLOCK 2048
+
+typedef struct{
+    const double * values;              // numRows by numColumns, column by column
+    uint64_t numRows;
+    unsigned int numColumns;
+    const char * const * columnNames;   // NULL or numColumns names
+    const char * const * rowNames;      // NULL or numRows names, written as the first field
+    const char * header;                // NULL or text written ahead of the rows
+    const char * delimiter;             // NULL => ", "
+} export_matrix_t;
+
+// Writes value into text (at least SZ_EXPORT_NUMBER bytes).  @retval length written.
+int formatExportNumber(double value, char * text);
+
+// Delimited text: the header (newline terminated if it is not already) or, without one,
+// a line of column names; then one line per row.  numWorkers 0 => one per core.
+bool writeExportText(const char * filename, const export_matrix_t * matrix, unsigned int numWorkers);
+
+bool writeExportColumns(const char * filename, const export_matrix_t * matrix);
+
+#endif /* in_exportwriter_h */
@@ -0,0 +1,127 @@
+/*
+ * featurereduce.c - computes row reductions of a load shape matrix in one pass (see
+ * rowreduce.h).  Used by PAStatTool.featureSetAdjustment and normalizeLoadShapes.
+ *
+ * The calling syntax is:
+ *
+ *		reduced = featurereduce(featureSet, reductions)
+ *		reduced = featurereduce(featureSet, reductions, sectionEdges)
+ *		reduced = featurereduce(featureSet, reductions, sectionEdges, bands)
+ *		[reduced, nonzeroRows] = featurereduce(featureSet, 'normalize', ...)
+ *
+ * featureSet is an N x M double matrix with one load shape per row.  reductions is a
+ * string or cell of strings: 'sort' (descending), 'sum', 'mean', 'median', 'max', 'min',
+ * 'above_<threshold>' (e.g. 'above_100'), 'bands' or 'normalize'.  sectionEdges are the
+ * column edges of consecutive sections ([0, ..., M], as PAStatTool's chunk sections); the
+ * default is a single section.  bands is a K x 2 matrix of inclusive [low, high] cutpoints
+ * counted by 'bands'.  reduced holds, for each section in turn, the columns of each
+ * reduction in turn.  nonzeroRows is true where a normalized row did not sum to zero.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O featurereduce.c rowreduce.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "rowreduce.h"
+
+static void parseRequest(const mxArray * nameArray, rowreduce_request_t * request)
+{
+    char * name = mxIsChar(nameArray) ? mxArrayToString(nameArray) : NULL;
+    bool isValid = name!=NULL && parseRowReduction(name, request);
+    mxFree(name);
+    if(!isValid) {
+        mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:reduction",
+                "Unknown reduction; see featurereduce.c for those supported.");
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    rowreduce_plan_t plan;
+    rowreduce_request_t * requests;
+    unsigned int * sectionEdges, singleSection[2], s, q;
+    const double * edges, * bands;
+    bool * nonzeroRows = NULL;
+
+    if(nrhs < 2 || nrhs > 4) {
+        mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:nrhs",
+                "A feature set and reductions are required; section edges and bands are optional.");
+    }
+    if(nlhs > 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:nlhs",
+                "At most two outputs are produced.");
+    }
+    if(!mxIsDouble(prhs[0]) || mxIsComplex(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:notDouble",
+                "The feature set must be a real double matrix.");
+    }
+
+    memset(&plan, 0, sizeof(plan));
+    plan.featureSet = mxGetPr(prhs[0]);
+    plan.numRows = (unsigned int)mxGetM(prhs[0]);
+    plan.numColumns = (unsigned int)mxGetN(prhs[0]);
+
+    if(mxIsCell(prhs[1])) {
+        plan.numRequests = (unsigned int)mxGetNumberOfElements(prhs[1]);
+        requests = mxMalloc((plan.numRequests+1)*sizeof(rowreduce_request_t));
+        for(q=0; q<plan.numRequests; q++) {
+            parseRequest(mxGetCell(prhs[1], q), requests+q);
+        }
+    }
+    else {
+        plan.numRequests = 1;
+        requests = mxMalloc(sizeof(rowreduce_request_t));
+        parseRequest(prhs[1], requests);
+    }
+    plan.requests = requests;
+
+    if(nrhs > 2 && !mxIsEmpty(prhs[2])) {
+        plan.numSections = (unsigned int)mxGetNumberOfElements(prhs[2])-1;
+        if(!mxIsDouble(prhs[2]) || plan.numSections < 1) {
+            mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:sections",
+                    "Section edges must be a double vector of at least two column edges.");
+        }
+        edges = mxGetPr(prhs[2]);
+        sectionEdges = mxMalloc((plan.numSections+1)*sizeof(unsigned int));
+        for(s=0; s<=plan.numSections; s++) {
+            if(edges[s] < 0 || edges[s] > plan.numColumns || (s > 0 && edges[s] < edges[s-1])) {
+                mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:sections",
+                        "Section edges must be nondecreasing and within the %u columns.", plan.numColumns);
+            }
+            sectionEdges[s] = (unsigned int)edges[s];
+        }
+    }
+    else {
+        plan.numSections = 1;
+        singleSection[0] = 0;
+        singleSection[1] = plan.numColumns;
+        sectionEdges = singleSection;
+    }
+    plan.sectionEdges = sectionEdges;
+
+    if(nrhs > 3 && !mxIsEmpty(prhs[3])) {
+        if(!mxIsDouble(prhs[3]) || mxGetN(prhs[3]) != 2) {
+            mexErrMsgIdAndTxt("PadacoToolbox:featurereduce:bands",
+                    "Bands must be a K x 2 double matrix of [low, high] cutpoints.");
+        }
+        bands = mxGetPr(prhs[3]);
+        plan.numBands = (unsigned int)mxGetM(prhs[3]);
+        plan.bandLows = bands;
+        plan.bandHighs = bands+plan.numBands;
+    }
+
+    plhs[0] = mxCreateDoubleMatrix(plan.numRows, getRowReduceWidth(&plan), mxREAL);
+    if(nlhs > 1) {
+        plhs[1] = mxCreateLogicalMatrix(plan.numRows, 1);
+        nonzeroRows = (bool*)mxGetLogicals(plhs[1]);
+    }
+    reduceRows(&plan, mxGetPr(plhs[0]), nonzeroRows, 0);
+    if(sectionEdges != singleSection) {
+        mxFree(sectionEdges);
+    }
+    mxFree(requests);
+}
@@ -0,0 +1,60 @@
+/*
+ * followraw.c - appends the rows written to a growing ActiGraph raw .csv file since the
+ * previous call to its Padaco .bin file (see rawfollow.h).  Used by PASensorData.followFile.
+ *
+ * The calling syntax is:
+ *
+ *		[firstRecord, numRecords, restarted] = followraw(csvFilename, binFilename)
+ *
+ * firstRecord is the (1 based) index of the first record appended by this call and
+ * numRecords the number of records now in the .bin file, so records firstRecord:numRecords
+ * are new (none when firstRecord > numRecords).  restarted is true when the .bin file was
+ * rebuilt from the start of the .csv file.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O followraw.c rawfollow.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include "mex.h"
+#include "rawfollow.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * csvFilename, * binFilename;
+    raw_follow_result_t result;
+    bool didFollow;
+
+    if(nrhs != 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:followraw:nrhs",
+                "A .csv filename and a .bin filename are required for input.");
+    }
+    if(nlhs > 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:followraw:nlhs",
+                "At most three outputs are produced.");
+    }
+    csvFilename = mxArrayToString(prhs[0]);
+    binFilename = mxArrayToString(prhs[1]);
+    if(csvFilename==NULL || binFilename==NULL) {
+        mxFree(csvFilename);
+        mxFree(binFilename);
+        mexErrMsgIdAndTxt("PadacoToolbox:followraw:notString",
+                "Filenames must be strings.");
+    }
+    didFollow = followRawCSVFile(csvFilename, binFilename, &result);
+    mxFree(csvFilename);
+    mxFree(binFilename);
+    if(!didFollow) {
+        mexErrMsgIdAndTxt("PadacoToolbox:followraw:follow",
+                "Could not append the new rows of the .csv file to the .bin file.");
+    }
+    plhs[0] = mxCreateDoubleScalar((double)result.firstNewRecord+1);
+    if(nlhs > 1) {
+        plhs[1] = mxCreateDoubleScalar((double)result.numRecords);
+    }
+    if(nlhs > 2) {
+        plhs[2] = mxCreateLogicalScalar(result.restarted);
+    }
+}
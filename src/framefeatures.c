@@ -0,0 +1,272 @@
+//
+//  framefeatures.c
+//
+//  Frame features follow MATLAB's column conventions: var and std are normalized by n-1,
+//  mode returns the smallest of the most frequent values, and median averages the two
+//  middle values of even length frames.
+//
+
+#include "framefeatures.h"
+#include "rawtools.h"
+#include <math.h>
+
+const char * FEATURE_NAMES[NUM_FEATURES] = {
+    "mean","medianad","meanad","median","std","rms","sum","var","mode","usagestate"
+};
+
+const char * FEATURE_DESCRIPTIONS[NUM_FEATURES] = {
+    "Mean","Median Absolute Deviation","Mean Absolute Deviation","Median","Standard Deviation",
+    "Root mean square","Sum","Variance","Mode","Activity Categories"
+};
+
+feature_id_t getFeatureID(const char * nameOrDescription){
+    int f;
+    for(f=0;f<NUM_FEATURES;f++){
+        if(strcasecmp(nameOrDescription,FEATURE_NAMES[f])==0 || strcasecmp(nameOrDescription,FEATURE_DESCRIPTIONS[f])==0){
+            return (feature_id_t)f;
+        }
+    }
+    return FEATURE_UNKNOWN;
+}
+
+static int compareDoubles(const void * a, const void * b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x>y)-(x<y);
+}
+
+// Wirth's selection; partially reorders values so that values[k] holds the k-th smallest
+// with everything before it no larger and everything after it no smaller.
+double selectKth(double * values, unsigned int numValues, unsigned int k){
+    long left = 0, right = (long)numValues-1, i, j;
+    double pivot, tmp;
+    while(left<right){
+        pivot = values[k];
+        i = left;
+        j = right;
+        do{
+            while(values[i]<pivot) i++;
+            while(pivot<values[j]) j--;
+            if(i<=j){
+                tmp = values[i];
+                values[i] = values[j];
+                values[j] = tmp;
+                i++;
+                j--;
+            }
+        }while(i<=j);
+        if(j<(long)k) left = i;
+        if((long)k<i) right = j;
+    }
+    return values[k];
+}
+
+// Median of values, which are reordered in the process.
+double medianInPlace(double * values, unsigned int numValues){
+    unsigned int k = numValues/2, i;
+    double upper, lower;
+    if(numValues==0){
+        return NAN;
+    }
+    upper = selectKth(values,numValues,k);
+    if(numValues%2){
+        return upper;
+    }
+    // Everything below k is <= upper after selection; the lower middle is their maximum.
+    lower = values[0];
+    for(i=1;i<k;i++){
+        if(values[i]>lower) lower = values[i];
+    }
+    return (lower+upper)/2;
+}
+
+static double sortedMode(double * values, unsigned int numValues){
+    unsigned int i, runLength = 1, bestLength = 0;
+    double bestValue = NAN;
+    qsort(values,numValues,sizeof(double),compareDoubles);
+    for(i=1;i<=numValues;i++){
+        if(i<numValues && values[i]==values[i-1]){
+            runLength++;
+        }
+        else{
+            if(runLength>bestLength){  // strictly greater keeps the smallest value on ties
+                bestLength = runLength;
+                bestValue = values[i-1];
+            }
+            runLength = 1;
+        }
+    }
+    return bestValue;
+}
+
+double calcFrameMode(const int8_t * frame, unsigned int numSamples){
+    unsigned int counts[256] = {0}, i, bestCount = 0;
+    int value, bestValue = 0;
+    for(i=0;i<numSamples;i++){
+        counts[frame[i]+128]++;
+    }
+    for(value=-128;value<128;value++){
+        if(counts[value+128]>bestCount){
+            bestCount = counts[value+128];
+            bestValue = value;
+        }
+    }
+    return numSamples>0 ? bestValue : NAN;
+}
+
+double calcFrameFeature(feature_id_t featureID, const float * frame, unsigned int numSamples, double * scratch){
+    unsigned int i;
+    double sum = 0, sumSq = 0, mean, center;
+
+    if(numSamples==0){
+        return NAN;
+    }
+    switch(featureID){
+        case FEATURE_MEAN:
+        case FEATURE_SUM:
+            for(i=0;i<numSamples;i++) sum += frame[i];
+            return featureID==FEATURE_SUM ? sum : sum/numSamples;
+        case FEATURE_RMS:
+            for(i=0;i<numSamples;i++) sumSq += (double)frame[i]*frame[i];
+            return sqrt(sumSq/numSamples);
+        case FEATURE_VAR:
+        case FEATURE_STD:
+            // two pass for numerical stability on long frames of near constant gravity
+            for(i=0;i<numSamples;i++) sum += frame[i];
+            mean = sum/numSamples;
+            for(i=0;i<numSamples;i++) sumSq += (frame[i]-mean)*(frame[i]-mean);
+            sumSq = numSamples>1 ? sumSq/(numSamples-1) : 0;
+            return featureID==FEATURE_STD ? sqrt(sumSq) : sumSq;
+        case FEATURE_MEANAD:
+            for(i=0;i<numSamples;i++) sum += frame[i];
+            mean = sum/numSamples;
+            for(i=0;i<numSamples;i++) sumSq += fabs(frame[i]-mean);
+            return sumSq/numSamples;
+        case FEATURE_MEDIAN:
+        case FEATURE_MEDIANAD:
+            for(i=0;i<numSamples;i++) scratch[i] = frame[i];
+            center = medianInPlace(scratch,numSamples);
+            if(featureID==FEATURE_MEDIAN){
+                return center;
+            }
+            for(i=0;i<numSamples;i++) scratch[i] = fabs(frame[i]-center);
+            return medianInPlace(scratch,numSamples);
+        case FEATURE_MODE:
+        case FEATURE_USAGESTATE:
+            for(i=0;i<numSamples;i++) scratch[i] = frame[i];
+            return sortedMode(scratch,numSamples);
+        default:
+            return NAN;
+    }
+}
+
+void calcFeatureVector(feature_id_t featureID, const float * signal, unsigned int samplesPerFrame, unsigned int numFrames, double * featureVec){
+    unsigned int f;
+    double * scratch = NULL;
+    if(featureID==FEATURE_MEDIAN || featureID==FEATURE_MEDIANAD || featureID==FEATURE_MODE || featureID==FEATURE_USAGESTATE){
+        scratch = malloc(samplesPerFrame*sizeof(double));
+    }
+    for(f=0;f<numFrames;f++){
+        featureVec[f] = calcFrameFeature(featureID,signal+(size_t)f*samplesPerFrame,samplesPerFrame,scratch);
+    }
+    free(scratch);
+}
+
+static int64_t secondOfDay(int64_t wallclock){
+    int64_t sec = wallclock%SECONDS_PER_DAY;
+    return sec<0 ? sec+SECONDS_PER_DAY : sec;
+}
+
+bool alignFeatureVec(const double * featureVec, unsigned int numFrames, int64_t startWallclock, unsigned int frameDurationSec,
+                     double elapsedStartHour, double intervalDurationHours, aligned_features_t * aligned){
+    int64_t elapsedStartSec = (int64_t)llround(elapsedStartHour*3600);
+    int64_t intervalSec = (int64_t)llround(intervalDurationHours*3600), intervalStart, remainingSec;
+    unsigned int startIndex, i;
+    struct tm intervalTime;
+
+    memset(aligned,0,sizeof(aligned_features_t));
+    if(numFrames==0 || frameDurationSec==0 || intervalSec<=0 || intervalSec%frameDurationSec!=0){
+        return false;
+    }
+
+    // find the first frame that starts at the elapsed start hour
+    for(startIndex=0;startIndex<numFrames;startIndex++){
+        if(secondOfDay(startWallclock+(int64_t)startIndex*frameDurationSec)==elapsedStartSec){
+            break;
+        }
+    }
+    if(startIndex==numFrames){
+        return false;
+    }
+
+    // from the start of the first aligned frame to the stop of the last frame
+    remainingSec = (int64_t)(numFrames-startIndex)*frameDurationSec;
+    aligned->numIntervals = (unsigned int)(remainingSec/intervalSec);
+    aligned->framesPerInterval = (unsigned int)(intervalSec/frameDurationSec);
+    if(aligned->numIntervals==0){
+        return false;
+    }
+
+    aligned->startDatenums = malloc(aligned->numIntervals*sizeof(double));
+    aligned->startWeekdays = malloc(aligned->numIntervals*sizeof(uint8_t));
+    aligned->values = malloc((size_t)aligned->numIntervals*aligned->framesPerInterval*sizeof(double));
+    memcpy(aligned->values,featureVec+startIndex,(size_t)aligned->numIntervals*aligned->framesPerInterval*sizeof(double));
+    for(i=0;i<aligned->numIntervals;i++){
+        intervalStart = startWallclock+(int64_t)startIndex*frameDurationSec+i*intervalSec;
+        wallclock2tm(intervalStart,&intervalTime);
+        aligned->startDatenums[i] = wallclock2datenum((double)intervalStart);
+        aligned->startWeekdays[i] = (uint8_t)intervalTime.tm_wday;
+    }
+    return true;
+}
+
+void freeAlignedFeatures(aligned_features_t * aligned){
+    free(aligned->startDatenums);
+    free(aligned->startWeekdays);
+    free(aligned->values);
+    memset(aligned,0,sizeof(aligned_features_t));
+}
+
+void getDayCount(unsigned int numFrames, int64_t startWallclock, unsigned int frameDurationSec, double elapsedStartHour, double intervalDurationHours,
+                 unsigned int * completeDayCount, unsigned int * incompleteDayCount, unsigned int * totalDayCount){
+    int64_t elapsedStartSec = (int64_t)llround(elapsedStartHour*3600);
+    int64_t elapsedStopSec = (int64_t)llround(fmod(elapsedStartHour+intervalDurationHours-frameDurationSec/3600.0,24)*3600);
+    int64_t firstStart = -1, firstStop = -1, lastStart = -1, lastStop = -1, frameStart, lastStartWallclock, sec;
+    double firstDatenum, lastDatenum;
+    unsigned int f;
+
+    *completeDayCount = *incompleteDayCount = *totalDayCount = 0;
+    if(numFrames==0){
+        return;
+    }
+    firstDatenum = wallclock2datenum((double)startWallclock);
+    lastDatenum = wallclock2datenum((double)(startWallclock+(int64_t)(numFrames-1)*frameDurationSec));
+    *totalDayCount = (unsigned int)(ceil(lastDatenum)-floor(firstDatenum));
+
+    for(f=0;f<numFrames;f++){
+        frameStart = startWallclock+(int64_t)f*frameDurationSec;
+        sec = secondOfDay(frameStart);
+        if(sec==elapsedStartSec){
+            if(firstStart<0) firstStart = f;
+            lastStart = f;
+        }
+        if(sec==elapsedStopSec){
+            if(firstStop<0) firstStop = f;
+            lastStop = f;
+        }
+    }
+    if(firstStart<0 || firstStop<0){
+        return;
+    }
+    if(firstStop<firstStart){
+        (*incompleteDayCount)++;
+    }
+    if(lastStop<lastStart){
+        (*incompleteDayCount)++;
+        lastStartWallclock = startWallclock+lastStop*frameDurationSec-(int64_t)llround(intervalDurationHours*3600)+frameDurationSec;
+    }
+    else{
+        lastStartWallclock = startWallclock+lastStart*frameDurationSec;
+    }
+    sec = lastStartWallclock-(startWallclock+firstStart*frameDurationSec);
+    *completeDayCount = sec>0 ? (unsigned int)(sec/SECONDS_PER_DAY) : 0;
+}
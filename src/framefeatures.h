@@ -0,0 +1,65 @@
+//
+//  framefeatures.h
+//
+//  Native versions of PASensorData's frame feature functions (calcFeatureVectorFromFrames)
+//  and of the 24 hour alignment done in getAlignedFeatureVecs.
+//
+
+#ifndef in_framefeatures_h
+#define in_framefeatures_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Same order as PASensorData.getFeatureDescriptionStruct() (sans psd), which is the
+// column order PABatchTool uses when 'All' features are requested.
+typedef enum{
+    FEATURE_MEAN = 0,
+    FEATURE_MEDIANAD,
+    FEATURE_MEANAD,
+    FEATURE_MEDIAN,
+    FEATURE_STD,
+    FEATURE_RMS,
+    FEATURE_SUM,
+    FEATURE_VAR,
+    FEATURE_MODE,
+    FEATURE_USAGESTATE,
+    NUM_FEATURES,
+    FEATURE_UNKNOWN = -1
+} feature_id_t;
+
+extern const char * FEATURE_NAMES[NUM_FEATURES];
+extern const char * FEATURE_DESCRIPTIONS[NUM_FEATURES];
+
+typedef struct{
+    unsigned int numIntervals;
+    unsigned int framesPerInterval;
+    double * startDatenums;  // numIntervals
+    uint8_t * startWeekdays; // numIntervals, 0 = Sunday (PABatchTool's dateMap)
+    double * values;         // numIntervals x framesPerInterval, row major
+} aligned_features_t;
+
+feature_id_t getFeatureID(const char * nameOrDescription);
+
+// @param frame Samples of a single frame.  Left untouched.
+// @param scratch Work space of at least numSamples doubles (for sorting based features).
+double calcFrameFeature(feature_id_t featureID, const float * frame, unsigned int numSamples, double * scratch);
+double selectKth(double * values, unsigned int numValues, unsigned int k);
+double medianInPlace(double * values, unsigned int numValues);
+double calcFrameMode(const int8_t * frame, unsigned int numSamples);
+
+// Fills featureVec[numFrames] with the feature of consecutive, non-overlapping frames of signal.
+void calcFeatureVector(feature_id_t featureID, const float * signal, unsigned int samplesPerFrame, unsigned int numFrames, double * featureVec);
+
+// Equivalent of PASensorData.getAlignedFeatureVecs for frames beginning at startWallclock
+// (see rawtools.h) and frameDurationSec apart.
+// @retval true if at least one interval was aligned; aligned must be released with freeAlignedFeatures
+bool alignFeatureVec(const double * featureVec, unsigned int numFrames, int64_t startWallclock, unsigned int frameDurationSec,
+                     double elapsedStartHour, double intervalDurationHours, aligned_features_t * aligned);
+void freeAlignedFeatures(aligned_features_t * aligned);
+
+// Equivalent of PASensorData.getDayCount
+void getDayCount(unsigned int numFrames, int64_t startWallclock, unsigned int frameDurationSec, double elapsedStartHour, double intervalDurationHours,
+                 unsigned int * completeDayCount, unsigned int * incompleteDayCount, unsigned int * totalDayCount);
+
+#endif /* in_framefeatures_h */
@@ -0,0 +1,128 @@
+//
+//  framestore.c
+//  Mergeable base level summaries of a signal.  See framestore.h.
+//
+
+#include <stdlib.h>
+#include <math.h>
+#include "framestore.h"
+#include "in_parallel.h"
+
+typedef struct{
+    const float * signal;
+    frame_store_t * store;
+} store_task_t;
+
+static void summarizeBase(unsigned int baseIndex, unsigned int workerIndex, void * userData){
+    store_task_t * task = (store_task_t*)userData;
+    frame_store_t * store = task->store;
+    unsigned int n = store->samplesPerBase, i;
+    const float * base = task->signal+(uint64_t)baseIndex*n;
+    frame_moments_t * moments = store->moments+baseIndex;
+    double sum = 0, sumSquares = 0, mean, m2 = 0, minValue = base[0], maxValue = base[0];
+    (void)workerIndex;
+
+    for(i=0;i<n;i++){
+        sum += base[i];
+        sumSquares += (double)base[i]*base[i];
+        if(base[i]<minValue) minValue = base[i];
+        if(base[i]>maxValue) maxValue = base[i];
+    }
+    mean = sum/n;
+    for(i=0;i<n;i++){
+        m2 += (base[i]-mean)*(base[i]-mean);
+    }
+    moments->count = n;
+    moments->mean = mean;
+    moments->m2 = m2;
+    moments->sum = sum;
+    moments->sumSquares = sumSquares;
+    moments->min = minValue;
+    moments->max = maxValue;
+}
+
+frame_store_t * createFrameStore(const float * signal, uint64_t numSamples, unsigned int samplesPerBase, unsigned int numWorkers){
+    frame_store_t * store;
+    store_task_t task;
+
+    if(samplesPerBase==0 || numSamples<samplesPerBase){
+        return NULL;
+    }
+    store = calloc(1,sizeof(frame_store_t));
+    store->samplesPerBase = samplesPerBase;
+    store->numBases = (unsigned int)(numSamples/samplesPerBase);
+    store->moments = malloc((size_t)store->numBases*sizeof(frame_moments_t));
+
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    task.signal = signal;
+    task.store = store;
+    parallelFor(store->numBases,numWorkers,summarizeBase,&task,NULL);
+    return store;
+}
+
+void freeFrameStore(frame_store_t * store){
+    if(store!=NULL){
+        free(store->moments);
+        free(store);
+    }
+}
+
+void mergeFrameMoments(frame_moments_t * into, const frame_moments_t * from){
+    double count = into->count+from->count, delta = from->mean-into->mean;
+    if(from->count==0){
+        return;
+    }
+    if(into->count==0){
+        *into = *from;
+        return;
+    }
+    into->m2 += from->m2+delta*delta*into->count*from->count/count;
+    into->mean += delta*from->count/count;
+    into->count = count;
+    into->sum += from->sum;
+    into->sumSquares += from->sumSquares;
+    if(from->min<into->min) into->min = from->min;
+    if(from->max>into->max) into->max = from->max;
+}
+
+bool calcMergedFeatureVector(const frame_store_t * store, feature_id_t featureID, unsigned int basesPerFrame, unsigned int numFrames, double * featureVec){
+    frame_moments_t moments;
+    unsigned int f, b, base;
+    double value = NAN;
+
+    if(basesPerFrame==0 || (uint64_t)basesPerFrame*numFrames>store->numBases){
+        return false;
+    }
+    switch(featureID){
+        case FEATURE_MEAN: case FEATURE_STD: case FEATURE_RMS: case FEATURE_SUM: case FEATURE_VAR:
+            break;
+        default:
+            return false;
+    }
+    for(f=0;f<numFrames;f++){
+        base = f*basesPerFrame;
+        moments = store->moments[base];
+        for(b=1;b<basesPerFrame;b++){
+            mergeFrameMoments(&moments,store->moments+base+b);
+        }
+        switch(featureID){
+            case FEATURE_MEAN:
+                value = moments.mean;
+                break;
+            case FEATURE_SUM:
+                value = moments.sum;
+                break;
+            case FEATURE_RMS:
+                value = sqrt(moments.sumSquares/moments.count);
+                break;
+            default:
+                value = moments.count>1 ? moments.m2/(moments.count-1) : 0;
+                value = featureID==FEATURE_STD ? sqrt(value) : value;
+                break;
+        }
+        featureVec[f] = value;
+    }
+    return true;
+}
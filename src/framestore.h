@@ -0,0 +1,49 @@
+//
+//  framestore.h
+//  Mergeable base level summaries of a signal, from which the frame features of any frame
+//  duration that is a whole number of base blocks are produced without rescanning the
+//  samples (see calcMergedFeatureVector and framefeatures.h for the features).
+//
+//  Each base block (e.g. one minute of samples) keeps its count, mean, M2 (sum of squared
+//  deviations), sum, sum of squares, min and max.  These merge exactly (Chan et al.), so
+//  rms, mean, sum, var and std of merged frames are exact up to rounding.  Medians,
+//  absolute deviations and modes do not merge exactly and are left to the frames.
+//
+
+#ifndef in_framestore_h
+#define in_framestore_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "framefeatures.h"
+
+typedef struct frame_moments_t{
+    double count;
+    double mean;
+    double m2;
+    double sum;
+    double sumSquares;
+    double min;
+    double max;
+} frame_moments_t;
+
+typedef struct frame_store_t{
+    unsigned int samplesPerBase;
+    unsigned int numBases;
+    frame_moments_t * moments;       // numBases
+} frame_store_t;
+
+// Summarizes floor(numSamples/samplesPerBase) base blocks of signal (NaN samples are not
+// expected).  numWorkers 0 => one per core.  @retval NULL if there is not one whole block.
+frame_store_t * createFrameStore(const float * signal, uint64_t numSamples, unsigned int samplesPerBase, unsigned int numWorkers);
+// Takes ownership of allocated arrays (e.g. a store read back from MATLAB); see freeFrameStore.
+void freeFrameStore(frame_store_t * store);
+
+void mergeFrameMoments(frame_moments_t * into, const frame_moments_t * from);
+
+// Features of numFrames consecutive frames of basesPerFrame base blocks each.  Supports
+// FEATURE_MEAN, _STD, _RMS, _SUM and _VAR.  @retval false for other features or if the
+// frames exceed the store.
+bool calcMergedFeatureVector(const frame_store_t * store, feature_id_t featureID, unsigned int basesPerFrame, unsigned int numFrames, double * featureVec);
+
+#endif /* in_framestore_h */
@@ -0,0 +1,130 @@
+/*
+ * framesummary.c - summarizes a signal once per base block (e.g. a minute) and produces the
+ * frame features of any frame duration that is a whole number of blocks from the summary,
+ * without going back to the samples (see framestore.h).  Used by PASensorData.extractFeature.
+ *
+ * The calling syntax is:
+ *
+ *		summary = framesummary(signal, samplesPerBase)
+ *		featureVec = framesummary(summary, featureName, basesPerFrame, numFrames)
+ *
+ * signal is a single or double vector; a trailing partial block is not summarized.  summary
+ * is a struct with fields samplesPerBase, numBases and moments (7 x numBases: count, mean,
+ * m2, sum, sumSquares, min, max).  featureName is one of mean, std, rms, sum or var.
+ * featureVec is a numFrames x 1 vector, or empty when the feature cannot be merged from the
+ * summary.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O framesummary.c framestore.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "framestore.h"
+
+static const char * SUMMARY_FIELDS[] = {
+    "samplesPerBase","numBases","moments"
+};
+#define NUM_SUMMARY_FIELDS (sizeof(SUMMARY_FIELDS)/sizeof(SUMMARY_FIELDS[0]))
+
+static mxArray * createSummary(const frame_store_t * store){
+    mxArray * summary = mxCreateStructMatrix(1,1,NUM_SUMMARY_FIELDS,SUMMARY_FIELDS), * field;
+    mxSetField(summary,0,"samplesPerBase",mxCreateDoubleScalar(store->samplesPerBase));
+    mxSetField(summary,0,"numBases",mxCreateDoubleScalar(store->numBases));
+
+    field = mxCreateDoubleMatrix(sizeof(frame_moments_t)/sizeof(double),store->numBases,mxREAL);
+    memcpy(mxGetData(field),store->moments,store->numBases*sizeof(frame_moments_t));
+    mxSetField(summary,0,"moments",field);
+    return summary;
+}
+
+static const mxArray * getSummaryField(const mxArray * summary, const char * name, mxClassID classID, size_t numElements){
+    const mxArray * field = mxGetField(summary,0,name);
+    if(field==NULL || mxGetClassID(field)!=classID || mxGetNumberOfElements(field)!=numElements) {
+        mexErrMsgIdAndTxt("PadacoToolbox:framesummary:summary",
+                "The summary's %s field is missing or malformed; rebuild the summary.",name);
+    }
+    return field;
+}
+
+// Points store at the summary's arrays; nothing is copied and store must not be freed.
+static void viewSummary(const mxArray * summary, frame_store_t * store){
+    memset(store,0,sizeof(frame_store_t));
+    store->samplesPerBase = (unsigned int)mxGetScalar(getSummaryField(summary,"samplesPerBase",mxDOUBLE_CLASS,1));
+    store->numBases = (unsigned int)mxGetScalar(getSummaryField(summary,"numBases",mxDOUBLE_CLASS,1));
+    store->moments = mxGetData(getSummaryField(summary,"moments",mxDOUBLE_CLASS,
+            store->numBases*sizeof(frame_moments_t)/sizeof(double)));
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    frame_store_t * store, view;
+    const float * signal;
+    float * converted = NULL;
+    const double * values;
+    char * featureName;
+    feature_id_t featureID;
+    size_t numSamples, s;
+    double samplesPerBase, basesPerFrame, numFrames;
+
+    if(nlhs > 1) {
+        mexErrMsgIdAndTxt("PadacoToolbox:framesummary:nlhs",
+                "One output is produced.");
+    }
+    if(nrhs==2) {
+        if((!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0])) || mxIsComplex(prhs[0]) ||
+           (mxGetM(prhs[0])!=1 && mxGetN(prhs[0])!=1)) {
+            mexErrMsgIdAndTxt("PadacoToolbox:framesummary:signal",
+                    "The signal must be a real single or double vector.");
+        }
+        samplesPerBase = mxGetScalar(prhs[1]);
+        numSamples = mxGetNumberOfElements(prhs[0]);
+        if(samplesPerBase<1 || samplesPerBase!=(unsigned int)samplesPerBase || samplesPerBase>numSamples) {
+            mexErrMsgIdAndTxt("PadacoToolbox:framesummary:samplesPerBase",
+                    "Samples per base must be a whole number no larger than the signal.");
+        }
+        if(mxIsSingle(prhs[0])) {
+            signal = mxGetData(prhs[0]);
+        }
+        else {
+            values = mxGetPr(prhs[0]);
+            converted = mxMalloc(numSamples*sizeof(float));
+            for(s=0;s<numSamples;s++) {
+                converted[s] = (float)values[s];
+            }
+            signal = converted;
+        }
+        store = createFrameStore(signal,numSamples,(unsigned int)samplesPerBase,0);
+        mxFree(converted);
+        plhs[0] = createSummary(store);
+        freeFrameStore(store);
+    }
+    else if(nrhs==4) {
+        if(!mxIsStruct(prhs[0]) || (featureName=mxArrayToString(prhs[1]))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:framesummary:nrhs",
+                    "A summary struct and a feature name are required.");
+        }
+        viewSummary(prhs[0],&view);
+        featureID = getFeatureID(featureName);
+        mxFree(featureName);
+        basesPerFrame = mxGetScalar(prhs[2]);
+        numFrames = mxGetScalar(prhs[3]);
+        if(basesPerFrame<1 || basesPerFrame!=(unsigned int)basesPerFrame || numFrames<0 || numFrames!=(unsigned int)numFrames) {
+            mexErrMsgIdAndTxt("PadacoToolbox:framesummary:frames",
+                    "Bases per frame and the number of frames must be whole numbers.");
+        }
+        plhs[0] = mxCreateDoubleMatrix((mwSize)numFrames,1,mxREAL);
+        if(featureID==FEATURE_UNKNOWN ||
+           !calcMergedFeatureVector(&view,featureID,(unsigned int)basesPerFrame,(unsigned int)numFrames,mxGetPr(plhs[0]))) {
+            mxDestroyArray(plhs[0]);
+            plhs[0] = mxCreateDoubleMatrix(0,0,mxREAL);
+        }
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:framesummary:nrhs",
+                "Use framesummary(signal, samplesPerBase) or framesummary(summary, featureName, basesPerFrame, numFrames).");
+    }
+}
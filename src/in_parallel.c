@@ -0,0 +1,97 @@
+//
+//  in_parallel.c
+//
+
+#include "in_parallel.h"
+#include <stdlib.h>
+#include <unistd.h> // for sysconf
+
+typedef struct{
+    unsigned int numTasks;
+    unsigned int nextTask;
+    unsigned int tasksStarted;
+    in_task_fcn taskFcn;
+    void * userData;
+    volatile bool * keepRunning;
+    pthread_mutex_t lock;
+} in_pool_t;
+
+typedef struct{
+    in_pool_t * pool;
+    unsigned int workerIndex;
+} in_worker_t;
+
+unsigned int getNumCores(void){
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return numCores>0 ? (unsigned int)numCores : 1;
+}
+
+static void * workerLoop(void * arg){
+    in_worker_t * worker = (in_worker_t*)arg;
+    in_pool_t * pool = worker->pool;
+    unsigned int taskIndex;
+    while(true){
+        pthread_mutex_lock(&pool->lock);
+        if(pool->nextTask>=pool->numTasks || (pool->keepRunning!=NULL && !*pool->keepRunning)){
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        taskIndex = pool->nextTask++;
+        pool->tasksStarted++;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->taskFcn(taskIndex, worker->workerIndex, pool->userData);
+    }
+    return NULL;
+}
+
+unsigned int parallelFor(unsigned int numTasks, unsigned int numWorkers, in_task_fcn taskFcn, void * userData, volatile bool * keepRunning){
+    unsigned int w, numStarted = 0;
+    in_pool_t pool;
+    in_worker_t * workers;
+    pthread_t * threads;
+
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    if(numWorkers>numTasks){
+        numWorkers = numTasks;
+    }
+    if(numTasks==0){
+        return 0;
+    }
+
+    pool.numTasks = numTasks;
+    pool.nextTask = 0;
+    pool.tasksStarted = 0;
+    pool.taskFcn = taskFcn;
+    pool.userData = userData;
+    pool.keepRunning = keepRunning;
+    pthread_mutex_init(&pool.lock,NULL);
+
+    workers = malloc(numWorkers*sizeof(in_worker_t));
+    threads = malloc(numWorkers*sizeof(pthread_t));
+
+    // The calling thread works as worker 0 so single threaded runs do not spawn anything.
+    for(w=1;w<numWorkers;w++){
+        workers[w].pool = &pool;
+        workers[w].workerIndex = w;
+        if(pthread_create(&threads[w],NULL,workerLoop,&workers[w])!=0){
+            workers[w].pool = NULL; // could not start; the others will pick up its share.
+        }
+    }
+    workers[0].pool = &pool;
+    workers[0].workerIndex = 0;
+    workerLoop(&workers[0]);
+
+    for(w=1;w<numWorkers;w++){
+        if(workers[w].pool!=NULL){
+            pthread_join(threads[w],NULL);
+        }
+    }
+    numStarted = pool.tasksStarted;
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+    free(threads);
+    return numStarted;
+}
@@ -0,0 +1,24 @@
+//
+//  in_parallel.h
+//
+//  Small worker pool helpers shared by the command line tools and mex files.
+//  Workers pull the next task index from a shared counter, so long and short
+//  tasks balance themselves across the available cores.
+//
+
+#ifndef in_parallel_h
+#define in_parallel_h
+
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef void (*in_task_fcn)(unsigned int taskIndex, unsigned int workerIndex, void * userData);
+
+unsigned int getNumCores(void);
+
+// Runs taskFcn(0..numTasks-1) across numWorkers threads (0 => one per core).
+// Workers stop picking up new tasks once *keepRunning goes false (keepRunning may be NULL).
+// Returns the number of tasks that were started.
+unsigned int parallelFor(unsigned int numTasks, unsigned int numWorkers, in_task_fcn taskFcn, void * userData, volatile bool * keepRunning);
+
+#endif /* in_parallel_h */
@@ -10,8 +10,12 @@
 
 
 // For statfs calls
+#ifdef __linux__
+#include <sys/vfs.h>
+#else
 #include <sys/param.h>
 #include <sys/mount.h>
+#endif
 
 const char PATH_SEPARATOR =
 #ifdef WIN32
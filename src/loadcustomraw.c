@@ -0,0 +1,118 @@
+/*
+ * loadcustomraw.c - loads raw accelerations from a delimited text file described by a
+ * PASensorData custom format struct (see customraw.h).  Used by loadCustomRawFile.
+ *
+ * The calling syntax is:
+ *
+ *		[micros, xyz, numDropped] = loadcustomraw(filename, fmtStruct)
+ *
+ * fmtStruct has the fields of PASensorData.getDefaultCustomFmtStruct: datetime, x, y and z
+ * (1-based column numbers), datetimeType ('elapsed' or 'datetime'), datetimeFmtStr (a
+ * MATLAB datetime format, e.g. 'MM/dd/yyyy HH:mm:ss.SSS'), headerLines and delimiter.
+ * micros is an Nx1 int64 vector of wall clock microseconds since 1970-01-01 (elapsed seconds
+ * count from 2001-09-11, as loadCustomRawFile does), xyz an Nx3 single matrix and
+ * numDropped the number of non blank lines that did not parse.  Formats the parser cannot
+ * compile raise PadacoToolbox:loadcustomraw:format.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O loadcustomraw.c customraw.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "customraw.h"
+
+static const mxArray * getFormatField(const mxArray * fmtStruct, const char * name){
+    const mxArray * field = mxGetField(fmtStruct,0,name);
+    if(field==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:fmtStruct",
+                "The format struct has no %s field.",name);
+    }
+    return field;
+}
+
+static unsigned int getFormatColumn(const mxArray * fmtStruct, const char * name){
+    const mxArray * field = getFormatField(fmtStruct,name);
+    double value = mxIsNumeric(field) && mxGetNumberOfElements(field)==1 ? mxGetScalar(field) : 0;
+    if(value<1 || value!=(unsigned int)value) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:fmtStruct",
+                "The format struct's %s field must be a column number.",name);
+    }
+    return (unsigned int)value;
+}
+
+static char * getFormatString(const mxArray * fmtStruct, const char * name){
+    char * value = mxArrayToString(getFormatField(fmtStruct,name));
+    if(value==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:fmtStruct",
+                "The format struct's %s field must be a string.",name);
+    }
+    return value;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    custom_raw_format_t format;
+    custom_raw_t parsed;
+    custom_time_t timeType;
+    char * filename, * delimiter, * datetimeType, * datetimeFmtStr = NULL;
+    const mxArray * fmtStruct;
+    bool isCompiled;
+
+    if(nrhs != 2 || !mxIsStruct(prhs[1])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:nrhs",
+                "A filename and a format struct are required.");
+    }
+    if(nlhs > 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:nlhs",
+                "At most three outputs are produced.");
+    }
+    if((filename=mxArrayToString(prhs[0]))==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:notString",
+                "The filename must be a string.");
+    }
+    fmtStruct = prhs[1];
+    delimiter = getFormatString(fmtStruct,"delimiter");
+    datetimeType = getFormatString(fmtStruct,"datetimeType");
+    if(strcmp(datetimeType,"datetime")==0) {
+        timeType = TIME_DATETIME;
+        datetimeFmtStr = getFormatString(fmtStruct,"datetimeFmtStr");
+    }
+    else if(strcmp(datetimeType,"elapsed")==0) {
+        timeType = TIME_ELAPSED;
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:format",
+                "Unhandled date time type (%s).",datetimeType);
+    }
+    isCompiled = compileCustomRawFormat(getFormatColumn(fmtStruct,"datetime"),getFormatColumn(fmtStruct,"x"),
+                                        getFormatColumn(fmtStruct,"y"),getFormatColumn(fmtStruct,"z"),delimiter,
+                                        (unsigned int)mxGetScalar(getFormatField(fmtStruct,"headerLines")),timeType,datetimeFmtStr,&format);
+    mxFree(delimiter);
+    mxFree(datetimeType);
+    if(!isCompiled) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:format",
+                "The format cannot be parsed natively (datetime format '%s').",datetimeFmtStr!=NULL ? datetimeFmtStr : "");
+    }
+    mxFree(datetimeFmtStr);
+
+    if(!loadCustomRawFile(filename,&format,0,&parsed)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadcustomraw:read",
+                "Could not read %s.",filename);
+    }
+    mxFree(filename);
+
+    plhs[0] = mxCreateNumericMatrix((mwSize)parsed.numRows,1,mxINT64_CLASS,mxREAL);
+    memcpy(mxGetData(plhs[0]),parsed.micros,parsed.numRows*sizeof(int64_t));
+    if(nlhs>1) {
+        plhs[1] = mxCreateNumericMatrix((mwSize)parsed.numRows,3,mxSINGLE_CLASS,mxREAL);
+        memcpy(mxGetData(plhs[1]),parsed.xyz,parsed.numRows*3*sizeof(float));
+    }
+    if(nlhs>2) {
+        plhs[2] = mxCreateDoubleScalar((double)parsed.numDropped);
+    }
+    freeCustomRaw(&parsed);
+}
@@ -0,0 +1,105 @@
+/*
+ * loadrawbin.c - load raw acceleration values from a Padaco .bin file, decoding
+ * compressed payloads (see rawcodec.h) when present.
+ *
+ * The calling syntax is:
+ *
+ *		xyz = loadrawbin(binFilename)
+ *		xyz = loadrawbin(binFilename, startRecord, numRecords)
+ *
+ * xyz is a numRecords x num_signals single precision matrix.  startRecord is 1 based; the
+ * second form only decodes the compressed blocks covering the requested records.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O loadrawbin.c rawcodec.c rawtools.c in_parallel.c in_system.c
+ */
+
+#include "mex.h"
+#include "rawtools.h"
+#include "rawcodec.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * binFilename;
+    bin_header_t header;
+    FILE * fid;
+    uint8_t * payload;
+    float * samples, * xyz;
+    codec_header_t codecHeader;
+    uint64_t numRecords, startRecord = 0, r;
+    unsigned int s;
+    bool didLoad = false;
+
+    if(nrhs != 1 && nrhs != 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadrawbin:nrhs",
+                "A filename, and optionally a start record and record count, are required for input.");
+    }
+    if(nlhs > 1) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadrawbin:nlhs",
+                "One output is produced.");
+    }
+    binFilename = mxArrayToString(prhs[0]);
+    if(binFilename==NULL || (fid=fopen(binFilename,"rb"))==NULL) {
+        mxFree(binFilename);
+        mexErrMsgIdAndTxt("PadacoToolbox:loadrawbin:fopen",
+                "Unable to open the binary file.");
+    }
+    mxFree(binFilename);
+    if(!parseBinaryFileHeader(fid,&header) || header.num_signals==0) {
+        fclose(fid);
+        mexErrMsgIdAndTxt("PadacoToolbox:loadrawbin:header",
+                "Could not parse header information from the binary file.");
+    }
+
+    if(isCompressedBinHeader(&header)) {
+        payload = malloc(header.sz_remaining>0 ? header.sz_remaining : 1);
+        if(fread(payload,header.sz_remaining,1,fid)==1 && getEncodedPayloadHeader(payload,header.sz_remaining,&codecHeader)) {
+            numRecords = codecHeader.numRecords;
+            if(nrhs==3) {
+                startRecord = (uint64_t)mxGetScalar(prhs[1])-1;
+                numRecords = (uint64_t)mxGetScalar(prhs[2]);
+            }
+            samples = malloc((size_t)numRecords*header.num_signals*sizeof(float)+1);
+            didLoad = nrhs==3 ? decodeRawRecords(payload,header.sz_remaining,startRecord,numRecords,samples) :
+                                decodeRawPayload(payload,header.sz_remaining,samples,0);
+        }
+        else {
+            samples = NULL;
+            numRecords = 0;
+        }
+        free(payload);
+    }
+    else {
+        numRecords = header.sz_remaining/header.num_signals/header.sz_per_signal;
+        if(nrhs==3) {
+            startRecord = (uint64_t)mxGetScalar(prhs[1])-1;
+            numRecords = startRecord<numRecords ? numRecords-startRecord : 0;
+            if((uint64_t)mxGetScalar(prhs[2])<numRecords) {
+                numRecords = (uint64_t)mxGetScalar(prhs[2]);
+            }
+        }
+        samples = malloc((size_t)numRecords*header.num_signals*sizeof(float)+1);
+        didLoad = header.sz_per_signal==sizeof(float) &&
+                  fseek(fid,(long)(startRecord*header.num_signals*sizeof(float)),SEEK_CUR)==0 &&
+                  fread(samples,sizeof(float)*header.num_signals,numRecords,fid)==numRecords;
+    }
+    fclose(fid);
+    if(!didLoad) {
+        free(samples);
+        mexErrMsgIdAndTxt("PadacoToolbox:loadrawbin:payload",
+                "The binary data records are incomplete or corrupted.");
+    }
+
+    // records are interleaved on disk; MATLAB wants one signal per column
+    plhs[0] = mxCreateNumericMatrix(numRecords,header.num_signals,mxSINGLE_CLASS,mxREAL);
+    xyz = (float*)mxGetData(plhs[0]);
+    for(s=0;s<header.num_signals;s++) {
+        for(r=0;r<numRecords;r++) {
+            xyz[s*numRecords+r] = samples[r*header.num_signals+s];
+        }
+    }
+    free(samples);
+}
@@ -0,0 +1,75 @@
+/*
+ * loadshapedescriptors.c - computes load shape descriptors (see shapedescriptors.h) for
+ * every row of a load shape matrix in parallel.  Used by extractLoadShapeFeatures.m.
+ *
+ * The calling syntax is:
+ *
+ *		descriptors = loadshapedescriptors(loadShapes, names)
+ *		descriptors = loadshapedescriptors(loadShapes, names, parameters)
+ *
+ * loadShapes is an N x M double matrix with one load shape per row.  names is a string or
+ * cell of strings: 'sum', 'sumsqr', 'std', 'greaterthancount', 'peakcount',
+ * 'peakduration', 'fft' or 'wavelet'.  parameters holds one value per name (the
+ * greaterthancount threshold, the number of fft bins or wavelet levels; NaN for the
+ * default).  descriptors holds the columns of each name in turn.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O loadshapedescriptors.c shapedescriptors.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <math.h>
+#include "mex.h"
+#include "shapedescriptors.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    descriptor_request_t * requests;
+    const mxArray * nameArray;
+    const double * parameters = NULL;
+    char * name;
+    unsigned int numRows, numColumns, numRequests, q, width = 0;
+
+    if(nrhs < 2 || nrhs > 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadshapedescriptors:nrhs",
+                "Load shapes and descriptor names are required; parameters are optional.");
+    }
+    if(!mxIsDouble(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 2) {
+        mexErrMsgIdAndTxt("PadacoToolbox:loadshapedescriptors:notDouble",
+                "Load shapes must be a double matrix.");
+    }
+    numRows = (unsigned int)mxGetM(prhs[0]);
+    numColumns = (unsigned int)mxGetN(prhs[0]);
+    numRequests = mxIsCell(prhs[1]) ? (unsigned int)mxGetNumberOfElements(prhs[1]) : 1;
+    if(nrhs > 2) {
+        if(!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2]) != numRequests) {
+            mexErrMsgIdAndTxt("PadacoToolbox:loadshapedescriptors:parameters",
+                    "One parameter is required per descriptor name.");
+        }
+        parameters = mxGetPr(prhs[2]);
+    }
+
+    requests = mxMalloc((numRequests+1)*sizeof(descriptor_request_t));
+    for(q=0; q<numRequests; q++) {
+        nameArray = mxIsCell(prhs[1]) ? mxGetCell(prhs[1], q) : prhs[1];
+        name = nameArray!=NULL && mxIsChar(nameArray) ? mxArrayToString(nameArray) : NULL;
+        requests[q].id = name==NULL ? DESCRIPTOR_UNKNOWN : getDescriptorID(name);
+        requests[q].parameter = parameters==NULL ? NAN : parameters[q];
+        mxFree(name);
+        if(requests[q].id == DESCRIPTOR_UNKNOWN) {
+            mexErrMsgIdAndTxt("PadacoToolbox:loadshapedescriptors:name",
+                    "Unknown descriptor name (descriptor %u).", q+1);
+        }
+        if(requests[q].id == DESCRIPTOR_GREATERTHANCOUNT && isnan(requests[q].parameter)) {
+            mexErrMsgIdAndTxt("PadacoToolbox:loadshapedescriptors:threshold",
+                    "The greaterthancount descriptor requires a threshold parameter.");
+        }
+        width += getDescriptorWidth(requests+q, numColumns);
+    }
+
+    plhs[0] = mxCreateDoubleMatrix(numRows, width, mxREAL);
+    calcShapeDescriptors(mxGetPr(prhs[0]), numRows, numColumns, requests, numRequests, mxGetPr(plhs[0]), 0);
+    mxFree(requests);
+}
@@ -0,0 +1,64 @@
+// Merges the raw recordings of a split study (e.g. 702343t00c1RAW.csv and 702343t00c2RAW.csv)
+// into a single Padaco .bin file.  Inputs may be ActiGraph raw .csv/.raw exports or .bin
+// files (compressed or not) and are streamed in chunks, so memory does not grow with the
+// length of the recordings.  See rawmerge.h.
+// gcc -O2 mergeraw.c rawmerge.c rawstream.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o mergeraw
+#include <unistd.h> // for getopt
+#include "rawtools.h"
+#include "rawmerge.h"
+
+void printUsage(char * programName){
+    fprintf(stdout,"Usage: %s [options] <merged .bin filename> <raw .csv/.bin filename 1> <raw .csv/.bin filename 2> [...]\n",programName);
+    fprintf(stdout,"Options:\n"
+            "  -p <policy>  Which recording to keep where recordings overlap: first, last or mean.  Default: last\n"
+            "               (first and last refer to the order the inputs are listed in)\n"
+            "  -m <value>   Value written for samples that no recording covers.  Default: 0\n");
+}
+
+int main(int argc, char * argv[]){
+    overlap_policy_t policy = OVERLAP_LAST;
+    float missingValue = 0;
+    raw_merge_report_t report;
+    unsigned int numInputs, i;
+    bool didMerge;
+    int opt;
+    while((opt=getopt(argc,argv,"p:m:"))!=-1){
+        switch(opt){
+            case 'p':
+                if(strcasecmp(optarg,"first")==0) policy = OVERLAP_FIRST;
+                else if(strcasecmp(optarg,"last")==0) policy = OVERLAP_LAST;
+                else if(strcasecmp(optarg,"mean")==0) policy = OVERLAP_MEAN;
+                else{
+                    fprintf(stderr,"Unrecognized overlap policy: %s\n",optarg);
+                    printUsage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'm': missingValue = strtof(optarg,NULL); break;
+            default:
+                printUsage(argv[0]);
+                return -1;
+        }
+    }
+    if(argc-optind<3){
+        printUsage(argv[0]);
+        return -1;
+    }
+    numInputs = argc-optind-1;
+    report.numUsed = calloc(numInputs,sizeof(uint64_t));
+    report.numDropped = calloc(numInputs,sizeof(uint64_t));
+
+    fprintf(stdout,"Merging %u recordings into %s\n",numInputs,argv[optind]);
+    didMerge = mergeRawRecordings(argv[optind],(const char * const *)(argv+optind+1),numInputs,policy,missingValue,&report);
+    if(didMerge){
+        for(i=0;i<numInputs;i++){
+            fprintf(stdout,"  %s: %llu samples kept, %llu overlapping or out of order samples dropped\n",argv[optind+1+i],
+                    (unsigned long long)report.numUsed[i],(unsigned long long)report.numDropped[i]);
+        }
+        fprintf(stdout,"Wrote %llu samples (%u seconds), %llu of them filled with %g.\n",(unsigned long long)report.numRecords,report.duration_sec,
+                (unsigned long long)report.numGapRecords,missingValue);
+    }
+    free(report.numUsed);
+    free(report.numDropped);
+    return didMerge ? 0 : 1;
+}
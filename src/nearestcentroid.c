@@ -0,0 +1,185 @@
+//
+//  nearestcentroid.c
+//  Nearest centroid assignment.  See nearestcentroid.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "nearestcentroid.h"
+#include "in_parallel.h"
+
+#define CENTROID_BLOCK_ROWS 128
+
+const char * CENTROID_METRIC_NAMES[NUM_CENTROID_METRICS] = {
+    "sqeuclidean","cityblock","cosine","correlation","hamming"
+};
+
+typedef struct{
+    const double * shapes;
+    unsigned int numShapes;
+    unsigned int numDims;
+    double * centroids;     // numCentroids x numDims, row major (prepared for the metric)
+    unsigned int numCentroids;
+    centroid_metric_t metric;
+    bool * isCentroidValid; // false for centroids of zero length under cosine or correlation
+    uint32_t * assignments;
+    double * distances;
+    double * workspace;     // numDims doubles per worker
+} centroid_job_t;
+
+centroid_metric_t getCentroidMetric(const char * name){
+    int m;
+    for(m=0;m<NUM_CENTROID_METRICS;m++){
+        if(strcasecmp(name,CENTROID_METRIC_NAMES[m])==0){
+            return (centroid_metric_t)m;
+        }
+    }
+    return CENTROID_UNKNOWN;
+}
+
+// Centers (correlation) and scales to unit length (cosine, correlation) in place.
+// @retval false if the vector has no length to scale.
+static bool prepareVector(double * values, unsigned int numDims, centroid_metric_t metric){
+    unsigned int d;
+    double mean = 0, norm = 0;
+    if(metric==CENTROID_CORRELATION){
+        for(d=0;d<numDims;d++){
+            mean += values[d];
+        }
+        mean /= numDims;
+        for(d=0;d<numDims;d++){
+            values[d] -= mean;
+        }
+    }
+    if(metric==CENTROID_COSINE || metric==CENTROID_CORRELATION){
+        for(d=0;d<numDims;d++){
+            norm += values[d]*values[d];
+        }
+        norm = sqrt(norm);
+        if(norm==0){
+            return false;
+        }
+        for(d=0;d<numDims;d++){
+            values[d] /= norm;
+        }
+    }
+    return true;
+}
+
+static double distanceTo(const double * x, const double * c, unsigned int numDims, centroid_metric_t metric){
+    unsigned int d;
+    double total = 0, diff;
+    switch(metric){
+        case CENTROID_SQEUCLIDEAN:
+            for(d=0;d<numDims;d++){
+                diff = x[d]-c[d];
+                total += diff*diff;
+            }
+            return total;
+        case CENTROID_CITYBLOCK:
+            for(d=0;d<numDims;d++){
+                total += fabs(x[d]-c[d]);
+            }
+            return total;
+        case CENTROID_COSINE:
+        case CENTROID_CORRELATION:
+            for(d=0;d<numDims;d++){
+                total += x[d]*c[d];
+            }
+            return 1-total;
+        case CENTROID_HAMMING:
+            for(d=0;d<numDims;d++){
+                total += x[d]!=c[d];
+            }
+            return total/numDims;
+        default:
+            return NAN;
+    }
+}
+
+static void assignRowBlock(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    const centroid_job_t * job = (const centroid_job_t*)userData;
+    unsigned int row = taskIndex*CENTROID_BLOCK_ROWS, last = row+CENTROID_BLOCK_ROWS, d, k, best;
+    double * x = job->workspace+(size_t)workerIndex*job->numDims, distance, bestDistance;
+    if(last>job->numShapes){
+        last = job->numShapes;
+    }
+    for(;row<last;row++){
+        for(d=0;d<job->numDims;d++){
+            x[d] = job->shapes[(size_t)d*job->numShapes+row];
+        }
+        if(!prepareVector(x,job->numDims,job->metric)){
+            job->assignments[row] = CENTROID_UNASSIGNED;
+            if(job->distances!=NULL){
+                job->distances[row] = NAN;
+            }
+            continue;
+        }
+        best = CENTROID_UNASSIGNED;
+        bestDistance = INFINITY;
+        for(k=0;k<job->numCentroids;k++){
+            if(!job->isCentroidValid[k]){
+                continue;
+            }
+            distance = distanceTo(x,job->centroids+(size_t)k*job->numDims,job->numDims,job->metric);
+            if(distance<bestDistance){
+                bestDistance = distance;
+                best = k;
+            }
+        }
+        job->assignments[row] = best;
+        if(job->distances!=NULL){
+            job->distances[row] = best!=CENTROID_UNASSIGNED ? bestDistance : NAN;
+        }
+    }
+}
+
+bool assignNearestCentroids(const double * shapes, unsigned int numShapes, unsigned int numDims,
+                            const double * centroids, unsigned int numCentroids, centroid_metric_t metric,
+                            uint32_t * assignments, double * distances, unsigned int numWorkers,
+                            unsigned int * numUnassigned){
+    centroid_job_t job;
+    unsigned int k, d, n, numTasks;
+    if(metric<0 || metric>=NUM_CENTROID_METRICS || numCentroids==0 || numDims==0){
+        return false;
+    }
+    memset(&job,0,sizeof(job));
+    job.shapes = shapes;
+    job.numShapes = numShapes;
+    job.numDims = numDims;
+    job.numCentroids = numCentroids;
+    job.metric = metric;
+    job.assignments = assignments;
+    job.distances = distances;
+
+    // Row major centroids keep the inner distance loops contiguous.
+    job.centroids = malloc((size_t)numCentroids*numDims*sizeof(double));
+    job.isCentroidValid = malloc(numCentroids*sizeof(bool));
+    for(k=0;k<numCentroids;k++){
+        for(d=0;d<numDims;d++){
+            job.centroids[(size_t)k*numDims+d] = centroids[(size_t)d*numCentroids+k];
+        }
+        job.isCentroidValid[k] = prepareVector(job.centroids+(size_t)k*numDims,numDims,metric);
+    }
+
+    numTasks = (numShapes+CENTROID_BLOCK_ROWS-1)/CENTROID_BLOCK_ROWS;
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    if(numWorkers>numTasks){
+        numWorkers = numTasks;
+    }
+    job.workspace = malloc((numWorkers>0 ? numWorkers : 1)*(size_t)numDims*sizeof(double));
+    parallelFor(numTasks,numWorkers,assignRowBlock,&job,NULL);
+    free(job.workspace);
+    free(job.isCentroidValid);
+    free(job.centroids);
+    if(numUnassigned!=NULL){
+        for(*numUnassigned=0,n=0;n<numShapes;n++){
+            *numUnassigned += assignments[n]==CENTROID_UNASSIGNED;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+//
+//  nearestcentroid.h
+//  Assigns load shapes to the nearest of a set of frozen centroids (a saved PAClusterModel)
+//  using the distance metrics PACluster clusters with, as kmeans defines them:
+//  - sqeuclidean: sum of squared differences
+//  - cityblock: sum of absolute differences
+//  - cosine: 1 - cosine of the angle between the shape and the centroid
+//  - correlation: 1 - correlation, i.e. cosine after removing each vector's mean
+//  - hamming: fraction of coordinates that differ
+//  Ties go to the lower centroid index.  Matrices are column-major (MATLAB layout).
+//  Cosine and correlation are undefined for a shape of zero length (all zeros, or constant
+//  for correlation), as kmeans and pdist2 leave them: such shapes are not assigned.
+//
+
+#ifndef in_nearestcentroid_h
+#define in_nearestcentroid_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum{
+    CENTROID_SQEUCLIDEAN = 0,
+    CENTROID_CITYBLOCK,
+    CENTROID_COSINE,
+    CENTROID_CORRELATION,
+    CENTROID_HAMMING,
+    NUM_CENTROID_METRICS,
+    CENTROID_UNKNOWN = -1
+} centroid_metric_t;
+
+#define CENTROID_UNASSIGNED UINT32_MAX
+
+extern const char * CENTROID_METRIC_NAMES[NUM_CENTROID_METRICS];
+
+centroid_metric_t getCentroidMetric(const char * name);
+
+// @param shapes numShapes x numDims
+// @param centroids numCentroids x numDims
+// @param assignments numShapes 0 based centroid indices, CENTROID_UNASSIGNED for shapes of
+// zero length under cosine or correlation.
+// @param distances (may be NULL) numShapes distances to the assigned centroid (NAN if
+// unassigned).
+// @param numWorkers Threads to use (0 => one per core).
+// @param numUnassigned (may be NULL) number of shapes not assigned.
+bool assignNearestCentroids(const double * shapes, unsigned int numShapes, unsigned int numDims,
+                            const double * centroids, unsigned int numCentroids, centroid_metric_t metric,
+                            uint32_t * assignments, double * distances, unsigned int numWorkers,
+                            unsigned int * numUnassigned);
+
+#endif /* in_nearestcentroid_h */
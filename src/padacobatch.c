@@ -0,0 +1,667 @@
+// Headless equivalent of PABatchTool: raw .bin/.csv files in a directory are loaded,
+// classified for usage state, framed, reduced to features and aligned into 24 hour
+// intervals on a pool of worker threads.  Output files match those of the batch tool:
+//   <output>/features/<fcn>/features.<fcn>.<signal>.txt
+//   <output>/features/<summary filename>
+//   <output>/<log filename>
+//   <output>/unaligned_features/<study>.<fcn>.csv  (-u only)
+//
+// gcc -O2 -Wall padacobatch.c framefeatures.c classifyusage.c in_parallel.c rawtools.c rawcodec.c in_system.c -lm -lpthread -o padacobatch
+#include <signal.h>
+#include <unistd.h> // for getopt
+#include <stdarg.h>
+#include <math.h>
+#include <pthread.h>
+#include "rawtools.h"
+#include "framefeatures.h"
+#include "classifyusage.h"
+#include "in_parallel.h"
+#include "in_system.h"
+
+#define NUM_SIGNALS 4
+#define SZ_SETTING 1024
+#define SZ_OUTPUT_PATHNAME (SZ_SETTING+32)   // outputDirectory and a subdirectory name
+#define BATCH_SETTINGS_PREFIX "BATCH."
+
+static const char * SIGNAL_NAMES[NUM_SIGNALS] = {"accel.raw.x","accel.raw.y","accel.raw.z","accel.raw.vecMag"};
+static volatile bool keepRunning = true;
+
+typedef struct{
+    char sourceDirectory[SZ_SETTING];
+    char outputDirectory[SZ_SETTING];
+    double elapsedStartHours;
+    double intervalLengthHours;
+    double frameDurationMinutes;
+    unsigned int numDaysAllowed;
+    char featureLabel[SZ_SETTING];
+    char logFilename[SZ_SETTING];
+    char summaryFilename[SZ_SETTING];
+    bool exportAligned;
+    bool exportUnaligned;
+    unsigned int numWorkers;
+    usage_rules_t usageRules;
+} batch_settings_t;
+
+typedef struct{
+    char * text;
+    size_t length;
+    size_t capacity;
+} text_buffer_t;
+
+typedef struct{
+    bool isDone;
+    bool didFail;
+    text_buffer_t aligned[NUM_FEATURES][NUM_SIGNALS];
+    text_buffer_t errorMsg;
+    char summaryLine[2*SZ_SETTING];
+    unsigned int totalDayCount, completeDayCount, incompleteDayCount;
+    double elapsedSec;
+} file_result_t;
+
+typedef struct{
+    batch_settings_t * settings;
+    char ** filenames;
+    char ** fullFilenames;
+    unsigned int fileCount;
+    bool featureSelected[NUM_FEATURES];
+    char featuresPathname[SZ_OUTPUT_PATHNAME];
+    char unalignedPathname[SZ_OUTPUT_PATHNAME];
+    FILE * alignedFiles[NUM_FEATURES][NUM_SIGNALS];
+    FILE * logFID;
+    FILE * summaryFID;
+    file_result_t * results;
+    unsigned int nextToWrite;
+    unsigned int numCompleted;
+    unsigned int numFailed;
+    unsigned int totalDayCount, completeDayCount, incompleteDayCount;
+    time_t startTime;
+    pthread_mutex_t writeLock;
+} batch_job_t;
+
+void printUsage(char * programName){
+    fprintf(stdout,"Usage: %s [options] <source directory> <output directory>\n"
+            "Options:\n"
+            "  -s <settings file>  Padaco settings file (BATCH.* keys are used)\n"
+            "  -f <feature>        Feature function or label (e.g. mean, 'Standard Deviation', all).  Default: All\n"
+            "  -m <minutes>        Frame duration in minutes.  Default: 15\n"
+            "  -d <days>           Maximum number of days allowed per study.  Default: 7\n"
+            "  -e <hour>           Elapsed start hour for alignment.  Default: 0\n"
+            "  -l <hours>          Interval length in hours for alignment.  Default: 24\n"
+            "  -j <workers>        Number of worker threads.  Default: number of cores\n"
+            "  -u                  Also export unaligned features\n"
+            "  -a                  Do not export aligned features\n"
+            "Raw .csv files must be ActiGraph RAW exports; .raw and count files are not supported.\n",programName);
+}
+
+static void handleInterrupt(int signalNumber){
+    (void)signalNumber;
+    keepRunning = false;
+}
+
+static void appendText(text_buffer_t * buffer, const char * format, ...){
+    va_list args;
+    int needed;
+    while(true){
+        va_start(args,format);
+        needed = vsnprintf(buffer->text==NULL ? NULL : buffer->text+buffer->length,buffer->capacity-buffer->length,format,args);
+        va_end(args);
+        if(needed<0){
+            return;
+        }
+        if(buffer->length+needed<buffer->capacity){
+            buffer->length += needed;
+            return;
+        }
+        buffer->capacity = (buffer->capacity+needed+1)*2;
+        buffer->text = realloc(buffer->text,buffer->capacity);
+    }
+}
+
+static void freeText(text_buffer_t * buffer){
+    free(buffer->text);
+    memset(buffer,0,sizeof(text_buffer_t));
+}
+
+static void getDefaultBatchSettings(batch_settings_t * settings){
+    memset(settings,0,sizeof(batch_settings_t));
+    settings->elapsedStartHours = 0;
+    settings->intervalLengthHours = 24;
+    settings->frameDurationMinutes = 15;
+    settings->numDaysAllowed = 7;
+    strcpy(settings->featureLabel,"All");
+    strcpy(settings->logFilename,"batchRun_@TIMESTAMP.txt");
+    strcpy(settings->summaryFilename,"batchRun_@TIMESTAMP.txt");
+    settings->exportAligned = true;
+    settings->exportUnaligned = false;
+    settings->numWorkers = 0;
+    getDefaultUsageRules(&settings->usageRules);
+}
+
+// Reads the tab delimited key/value pairs of a Padaco settings file.  Keys may carry the
+// 'BATCH.' prefix used by PAAppSettings; keys for other sections are ignored.
+static bool loadBatchSettings(const char * settingsFilename, batch_settings_t * settings){
+    char line[2*SZ_SETTING], * key, * value, * end;
+    FILE * fid = fopen(settingsFilename,"r");
+    if(fid==NULL){
+        fprintf(stderr,"Could not open settings file %s\n",settingsFilename);
+        return false;
+    }
+    while(fgets(line,sizeof(line),fid)!=NULL){
+        key = line;
+        value = strchr(line,'\t');
+        if(value==NULL || line[0]=='-' || line[0]=='#'){
+            continue;
+        }
+        *value++ = '\0';
+        for(end=value+strlen(value);end>value && (end[-1]=='\n' || end[-1]=='\r');*--end='\0');
+        if(strncmp(key,BATCH_SETTINGS_PREFIX,strlen(BATCH_SETTINGS_PREFIX))==0){
+            key += strlen(BATCH_SETTINGS_PREFIX);
+        }
+        else if(strchr(key,'.')!=NULL && strncmp(key,"alignment.",strlen("alignment."))!=0 && strncmp(key,"usageStateRules.",strlen("usageStateRules."))!=0){
+            continue;
+        }
+
+        if(strcmp(key,"sourceDirectory")==0) strncpy(settings->sourceDirectory,value,SZ_SETTING-1);
+        else if(strcmp(key,"outputDirectory")==0) strncpy(settings->outputDirectory,value,SZ_SETTING-1);
+        else if(strcmp(key,"alignment.elapsedStartHours")==0) settings->elapsedStartHours = atof(value);
+        else if(strcmp(key,"alignment.intervalLengthHours")==0) settings->intervalLengthHours = atof(value);
+        else if(strcmp(key,"frameDurationMinutes")==0) settings->frameDurationMinutes = atof(value);
+        else if(strcmp(key,"numDaysAllowed")==0) settings->numDaysAllowed = (unsigned int)atoi(value);
+        else if(strcmp(key,"featureLabel")==0) strncpy(settings->featureLabel,value,SZ_SETTING-1);
+        else if(strcmp(key,"logFilename")==0) strncpy(settings->logFilename,value,SZ_SETTING-1);
+        else if(strcmp(key,"summaryFilename")==0) strncpy(settings->summaryFilename,value,SZ_SETTING-1);
+        else if(strcmp(key,"usageStateRules.longFilterLengthMinutes")==0) settings->usageRules.longFilterLengthMinutes = atof(value);
+        else if(strcmp(key,"usageStateRules.shortFilterLengthMinutes")==0) settings->usageRules.shortFilterLengthMinutes = atof(value);
+        else if(strcmp(key,"usageStateRules.workingGravitiesPerMinuteCutoff")==0) settings->usageRules.workingGravitiesPerMinuteCutoff = atof(value);
+        else if(strcmp(key,"usageStateRules.excessiveGravitiesPerMinuteCutoff")==0) settings->usageRules.excessiveGravitiesPerMinuteCutoff = atof(value);
+        else if(strcmp(key,"usageStateRules.minMinutesForStuck")==0) settings->usageRules.minMinutesForStuck = atof(value);
+        else if(strcmp(key,"usageStateRules.mergeWithinHoursForStudyOver")==0) settings->usageRules.mergeWithinHoursForStudyOver = atof(value);
+        else if(strcmp(key,"usageStateRules.minHoursForStudyOver")==0) settings->usageRules.minHoursForStudyOver = atof(value);
+        else if(strcmp(key,"usageStateRules.mergeWithinHoursOfStudyNotStarted")==0) settings->usageRules.mergeWithinHoursOfStudyNotStarted = atof(value);
+        else if(strcmp(key,"usageStateRules.sampleRate")==0) settings->usageRules.sampleRate = atof(value);
+    }
+    fclose(fid);
+    return true;
+}
+
+// Mirrors the 'All', 'all_sans_psd' and 'all_sans_psd_usagestate' choices of the batch tool.
+// The power spectral density bands are not computed natively, so 'All' behaves as 'all_sans_psd'.
+static bool selectFeatures(const char * featureLabel, bool * featureSelected){
+    feature_id_t featureID;
+    int f;
+    for(f=0;f<NUM_FEATURES;f++){
+        featureSelected[f] = false;
+    }
+    if(strcasecmp(featureLabel,"all")==0 || strcasecmp(featureLabel,"all_sans_psd")==0 || strcasecmp(featureLabel,"all_sans_psd_usagestate")==0){
+        for(f=0;f<NUM_FEATURES;f++){
+            featureSelected[f] = true;
+        }
+        featureSelected[FEATURE_USAGESTATE] = strcasecmp(featureLabel,"all_sans_psd_usagestate")!=0;
+        return true;
+    }
+    featureID = getFeatureID(featureLabel);
+    if(featureID==FEATURE_UNKNOWN){
+        fprintf(stderr,"Unsupported feature function: %s\n",featureLabel);
+        return false;
+    }
+    featureSelected[featureID] = true;
+    return true;
+}
+
+static char * replaceTimestamp(const char * filenameConvention, const char * timestamp){
+    const char * token = "@TIMESTAMP";
+    const char * match = strstr(filenameConvention,token);
+    char * filename = calloc(strlen(filenameConvention)+strlen(timestamp)+1,1);
+    if(match==NULL){
+        strcpy(filename,filenameConvention);
+    }
+    else{
+        strncpy(filename,filenameConvention,match-filenameConvention);
+        strcat(filename,timestamp);
+        strcat(filename,match+strlen(token));
+    }
+    return filename;
+}
+
+// datestr(datenum) default format, e.g. 07-Feb-2013 00:15:00
+static void wallclock2datestr(int64_t wallclock, char * dateStr, size_t sz_dateStr){
+    struct tm timeStruct;
+    wallclock2tm(wallclock,&timeStruct);
+    strftime(dateStr,sz_dateStr,"%d-%b-%Y %H:%M:%S",&timeStruct);
+}
+
+static double getStudyID(const char * filename, unsigned int fileIndex){
+    char idStr[7], * end;
+    double studyID;
+    strncpy(idStr,filename,6);
+    idStr[6] = '\0';
+    studyID = strtod(idStr,&end);
+    // PABatchTool uses the file's position when the study ID is not numeric
+    return (end==idStr || *end!='\0') ? fileIndex+1 : studyID;
+}
+
+static bool isRawFilename(const char * filename){
+    const char * extension = strrchr(filename,'.');
+    return filename[0]!='.' && extension!=NULL && (strcasecmp(extension,".bin")==0 || strcasecmp(extension,".csv")==0);
+}
+
+static void processFile(unsigned int fileIndex, unsigned int workerIndex, void * userData){
+    batch_job_t * job = (batch_job_t*)userData;
+    batch_settings_t * settings = job->settings;
+    file_result_t * result = &job->results[fileIndex];
+    const char * filename = job->filenames[fileIndex];
+    raw_info_t info;
+    float * accelerations, * signals[NUM_SIGNALS] = {NULL};
+    int8_t * usage[NUM_SIGNALS] = {NULL};
+    double studyID, * featureVec = NULL, * unaligned[NUM_FEATURES] = {NULL};
+    unsigned int frameDurationSec, samplesPerFrame, numFrames, maxNumIntervals, i, s, f, row, col;
+    aligned_features_t aligned;
+    time_t fileStart = time(NULL);
+    char studyName[SZ_SETTING], * extension, * unalignedFilename, dateStr[32];
+    FILE * fid;
+    (void)workerIndex;
+
+    fprintf(stdout,"Processing %s\n",filename);
+    accelerations = loadRawAccelerations(job->fullFilenames[fileIndex],&info);
+    if(accelerations==NULL || info.recordCount==0){
+        result->didFail = true;
+        appendText(&result->errorMsg,"No data loaded from file (%s)\n",filename);
+        free(accelerations);
+        return;
+    }
+    studyID = getStudyID(filename,fileIndex);
+    frameDurationSec = (unsigned int)llround(settings->frameDurationMinutes*60);
+    if(frameDurationSec==0 || frameDurationSec>info.duration_sec){
+        result->didFail = true;
+        appendText(&result->errorMsg,"There was an error in setting the frame duration.\n");
+        free(accelerations);
+        return;
+    }
+
+    for(s=0;s<NUM_SIGNALS;s++){
+        signals[s] = malloc(info.recordCount*sizeof(float));
+    }
+    splitRawSignals(accelerations,info.recordCount,signals,NULL);
+    free(accelerations);
+
+    samplesPerFrame = frameDurationSec*info.samplerate;
+    numFrames = info.duration_sec/frameDurationSec;
+    if((size_t)numFrames*samplesPerFrame>info.recordCount){
+        numFrames = info.recordCount/samplesPerFrame;
+    }
+
+    if(job->featureSelected[FEATURE_USAGESTATE]){
+        for(s=0;s<NUM_SIGNALS;s++){
+            usage[s] = malloc(info.recordCount*sizeof(int8_t));
+        }
+        // files are already processed in parallel, so one worker classifies every signal
+        classifyRawUsage(signals,usage,info.recordCount,&settings->usageRules,1,NULL,NULL,NULL);
+    }
+
+    maxNumIntervals = (unsigned int)(24/settings->intervalLengthHours*settings->numDaysAllowed);
+    featureVec = malloc((numFrames>0 ? numFrames : 1)*sizeof(double));
+    for(f=0;f<NUM_FEATURES;f++){
+        if(job->featureSelected[f] && settings->exportUnaligned){
+            unaligned[f] = malloc((size_t)(numFrames>0 ? numFrames : 1)*NUM_SIGNALS*sizeof(double));
+        }
+    }
+    for(s=0;s<NUM_SIGNALS && keepRunning;s++){
+        for(f=0;f<NUM_FEATURES;f++){
+            if(!job->featureSelected[f]){
+                continue;
+            }
+            if(f==FEATURE_USAGESTATE){
+                for(i=0;i<numFrames;i++){
+                    featureVec[i] = calcFrameMode(usage[s]+(size_t)i*samplesPerFrame,samplesPerFrame);
+                }
+            }
+            else{
+                calcFeatureVector((feature_id_t)f,signals[s],samplesPerFrame,numFrames,featureVec);
+            }
+            if(unaligned[f]!=NULL){
+                memcpy(unaligned[f]+(size_t)s*numFrames,featureVec,numFrames*sizeof(double));
+            }
+            if(settings->exportAligned && alignFeatureVec(featureVec,numFrames,info.start,frameDurationSec,settings->elapsedStartHours,settings->intervalLengthHours,&aligned)){
+                for(row=0;row<aligned.numIntervals && row<maxNumIntervals;row++){
+                    // save -ascii -tabs formatting
+                    appendText(&result->aligned[f][s],"%16.7e\t%16.7e\t%16.7e",studyID,aligned.startDatenums[row],(double)aligned.startWeekdays[row]);
+                    for(col=0;col<aligned.framesPerInterval;col++){
+                        appendText(&result->aligned[f][s],"\t%16.7e",aligned.values[(size_t)row*aligned.framesPerInterval+col]);
+                    }
+                    appendText(&result->aligned[f][s],"\n");
+                }
+                freeAlignedFeatures(&aligned);
+            }
+        }
+    }
+
+    if(settings->exportUnaligned){
+        strncpy(studyName,filename,SZ_SETTING-1);
+        studyName[SZ_SETTING-1] = '\0';
+        if((extension=strrchr(studyName,'.'))!=NULL){
+            *extension = '\0';
+        }
+        for(f=0;f<NUM_FEATURES;f++){
+            if(unaligned[f]==NULL){
+                continue;
+            }
+            snprintf(dateStr,sizeof(dateStr),".%s.csv",FEATURE_NAMES[f]);
+            unalignedFilename = malloc(strlen(job->unalignedPathname)+strlen(studyName)+strlen(dateStr)+2);
+            sprintf(unalignedFilename,"%s/%s%s",job->unalignedPathname,studyName,dateStr);
+            if((fid=fopen(unalignedFilename,"w"))!=NULL){
+                fprintf(fid,"# datenum");
+                for(s=0;s<NUM_SIGNALS;s++){
+                    fprintf(fid,", %s",SIGNAL_NAMES[s]);
+                }
+                for(i=0;i<numFrames;i++){
+                    wallclock2datestr(info.start+(int64_t)i*frameDurationSec,dateStr,sizeof(dateStr));
+                    fprintf(fid,"\n%s",dateStr);
+                    for(s=0;s<NUM_SIGNALS;s++){
+                        fprintf(fid,", %f",unaligned[f][(size_t)s*numFrames+i]);
+                    }
+                }
+                fclose(fid);
+            }
+            else{
+                result->didFail = true;
+                appendText(&result->errorMsg,"Unable to open unaligned feature output file for writing: %s\n",unalignedFilename);
+            }
+            free(unalignedFilename);
+        }
+    }
+
+    getDayCount(numFrames,info.start,frameDurationSec,settings->elapsedStartHours,settings->intervalLengthHours,
+                &result->completeDayCount,&result->incompleteDayCount,&result->totalDayCount);
+    // Raw data carries no counts, so the counts per minute columns are not available.
+    snprintf(result->summaryLine,sizeof(result->summaryLine),"%.0f, %s, %u, %u, %u, NaN, NaN, NaN, NaN\n",
+             studyID,job->fullFilenames[fileIndex],result->totalDayCount,result->completeDayCount,result->incompleteDayCount);
+
+    for(s=0;s<NUM_SIGNALS;s++){
+        free(signals[s]);
+        free(usage[s]);
+    }
+    for(f=0;f<NUM_FEATURES;f++){
+        free(unaligned[f]);
+    }
+    free(featureVec);
+    result->elapsedSec = difftime(time(NULL),fileStart);
+    if(!keepRunning){
+        result->didFail = true;
+        appendText(&result->errorMsg,"Canceled before completion.\n");
+    }
+}
+
+// Appends finished results to the shared output files in file order, so the feature files
+// come out identical regardless of which worker finished first.
+static void commitResults(unsigned int fileIndex, unsigned int workerIndex, void * userData){
+    batch_job_t * job = (batch_job_t*)userData;
+    file_result_t * result;
+    unsigned int f, s;
+    double elapsedTotal, remaining;
+
+    processFile(fileIndex,workerIndex,userData);
+
+    pthread_mutex_lock(&job->writeLock);
+    job->results[fileIndex].isDone = true;
+    job->numCompleted++;
+    while(job->nextToWrite<job->fileCount && job->results[job->nextToWrite].isDone){
+        result = &job->results[job->nextToWrite];
+        if(result->didFail){
+            job->numFailed++;
+            fprintf(stdout,"\t%s\tFAILED.\n",job->fullFilenames[job->nextToWrite]);
+            fprintf(job->logFID,"\n=======================================\n");
+            fprintf(job->logFID,"\t%s\tFAILED.\n",job->fullFilenames[job->nextToWrite]);
+            if(result->errorMsg.text!=NULL){
+                fprintf(job->logFID,"%s",result->errorMsg.text);
+            }
+        }
+        else{
+            for(f=0;f<NUM_FEATURES;f++){
+                for(s=0;s<NUM_SIGNALS;s++){
+                    if(job->alignedFiles[f][s]!=NULL && result->aligned[f][s].text!=NULL){
+                        fwrite(result->aligned[f][s].text,1,result->aligned[f][s].length,job->alignedFiles[f][s]);
+                    }
+                }
+            }
+            fprintf(job->summaryFID,"%s",result->summaryLine);
+            job->totalDayCount += result->totalDayCount;
+            job->completeDayCount += result->completeDayCount;
+            job->incompleteDayCount += result->incompleteDayCount;
+        }
+        for(f=0;f<NUM_FEATURES;f++){
+            for(s=0;s<NUM_SIGNALS;s++){
+                freeText(&result->aligned[f][s]);
+            }
+        }
+        freeText(&result->errorMsg);
+        job->nextToWrite++;
+    }
+    elapsedTotal = difftime(time(NULL),job->startTime);
+    remaining = elapsedTotal/job->numCompleted*(job->fileCount-job->numCompleted);
+    fprintf(stdout,"File %u of %u (%0.2f%%) Completed in %0.2f seconds\n"
+            "Time Remaining: %01ihrs %01imin %01isec\n",job->numCompleted,job->fileCount,100.0*job->numCompleted/job->fileCount,
+            job->results[fileIndex].elapsedSec,(int)(remaining/3600),(int)fmod(remaining/60,60),(int)fmod(remaining,60));
+    pthread_mutex_unlock(&job->writeLock);
+}
+
+static unsigned int getRawFilenames(const char * sourcePathname, char *** filenames, char *** fullFilenames){
+    DIR * dir = opendir(sourcePathname);
+    struct dirent * entry;
+    unsigned int count = 0, capacity = 0, i, j;
+    char * tmp;
+    *filenames = NULL;
+    *fullFilenames = NULL;
+    if(dir==NULL){
+        return 0;
+    }
+    while((entry=readdir(dir))!=NULL){
+        if(!isRawFilename(entry->d_name)){
+            continue;
+        }
+        if(count==capacity){
+            capacity = capacity ? capacity*2 : 64;
+            *filenames = realloc(*filenames,capacity*sizeof(char*));
+        }
+        (*filenames)[count++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+
+    // getFilenamesi returns names sorted; keep that order for the output files.
+    for(i=1;i<count;i++){
+        for(j=i;j>0 && strcmp((*filenames)[j-1],(*filenames)[j])>0;j--){
+            tmp = (*filenames)[j];
+            (*filenames)[j] = (*filenames)[j-1];
+            (*filenames)[j-1] = tmp;
+        }
+    }
+    *fullFilenames = malloc((count>0 ? count : 1)*sizeof(char*));
+    for(i=0;i<count;i++){
+        (*fullFilenames)[i] = fullfile((char*)sourcePathname,(*filenames)[i]);
+    }
+    return count;
+}
+
+static bool prepOutputFiles(batch_job_t * job, const char * timestamp){
+    batch_settings_t * settings = job->settings;
+    unsigned int f, s, t, framesPerInterval;
+    char * filename, * featurePath, timeStr[16];
+    int64_t frameDurationSec = llround(settings->frameDurationMinutes*60), sec;
+
+    snprintf(job->featuresPathname,sizeof(job->featuresPathname),"%s/features",settings->outputDirectory);
+    snprintf(job->unalignedPathname,sizeof(job->unalignedPathname),"%s/unaligned_features",settings->outputDirectory);
+    mkdir(settings->outputDirectory,0755);
+    mkdir(job->featuresPathname,0755);
+    if(settings->exportUnaligned){
+        mkdir(job->unalignedPathname,0755);
+    }
+
+    filename = replaceTimestamp(settings->summaryFilename,timestamp);
+    featurePath = fullfile(job->featuresPathname,filename);
+    if((job->summaryFID=fopen(featurePath,"w"))==NULL){
+        fprintf(stdout,"Cannot open or create summary file: %s\nSending summary output to the console.\n",featurePath);
+        job->summaryFID = stdout;
+    }
+    fprintf(job->summaryFID,"studyID, study_filename, total day count, complete day count, incomplete day count, counts per minute (x), counts per minute (y), counts per minute (z), counts per minute (vec magnitude)\n");
+    free(filename);
+
+    filename = replaceTimestamp(settings->logFilename,timestamp);
+    free(featurePath);
+    featurePath = fullfile(settings->outputDirectory,filename);
+    if((job->logFID=fopen(featurePath,"w"))==NULL){
+        fprintf(stdout,"Cannot open or create the log file: %s\nSending log output to the console.\n",featurePath);
+        job->logFID = stdout;
+    }
+    fprintf(job->logFID,"Padaco batch processing log\nStart time:\t%s\n",timestamp);
+    fprintf(job->logFID,"Padaco version %s\n","(native batch)");
+    fprintf(job->logFID,"Source directory:\t%s\n",settings->sourceDirectory);
+    fprintf(job->logFID,"Output directory:\t%s\n",settings->outputDirectory);
+    fprintf(job->logFID,"Aligned features (for clustering):\t%s\n",job->featuresPathname);
+    fprintf(job->logFID,"Original features (for clustering):\t%s\n",job->unalignedPathname);
+    fprintf(job->logFID,"Features:\t%s\n",settings->featureLabel);
+    fprintf(job->logFID,"Frame duration (minutes):\t%0.2f\n",settings->frameDurationMinutes);
+    fprintf(job->logFID,"Alignment settings:\n");
+    fprintf(job->logFID,"\tElapsed start (hours):\t%u\n",(unsigned int)settings->elapsedStartHours);
+    fprintf(job->logFID,"\tInterval length (hours):\t%u\n",(unsigned int)settings->intervalLengthHours);
+    fprintf(job->logFID,"Summary file:\t%s/%s\n",job->featuresPathname,filename);
+    fprintf(job->logFID,"Worker threads:\t%u\n",settings->numWorkers);
+    fprintf(job->logFID,"File count:\t%u",job->fileCount);
+    free(filename);
+    free(featurePath);
+
+    if(!settings->exportAligned){
+        return true;
+    }
+    framesPerInterval = (unsigned int)(llround(settings->intervalLengthHours*3600)/frameDurationSec);
+    for(f=0;f<NUM_FEATURES;f++){
+        if(!job->featureSelected[f]){
+            continue;
+        }
+        featurePath = fullfile(job->featuresPathname,(char*)FEATURE_NAMES[f]);
+        mkdir(featurePath,0755);
+        for(s=0;s<NUM_SIGNALS;s++){
+            filename = malloc(strlen(featurePath)+strlen(FEATURE_NAMES[f])+strlen(SIGNAL_NAMES[s])+32);
+            sprintf(filename,"%s/features.%s.%s.txt",featurePath,FEATURE_NAMES[f],SIGNAL_NAMES[s]);
+            if((job->alignedFiles[f][s]=fopen(filename,"w"))==NULL){
+                fprintf(stderr,"Unable create output path for storing batch process features: %s\n",filename);
+                free(filename);
+                free(featurePath);
+                return false;
+            }
+            fprintf(job->alignedFiles[f][s],"# Feature:\t%s\n",FEATURE_DESCRIPTIONS[f]);
+            fprintf(job->alignedFiles[f][s],"# Length:\t%u\n",framesPerInterval);
+            fprintf(job->alignedFiles[f][s],"# Study_ID\tStart_Datenum\tStart_Day");
+            for(t=0;t<framesPerInterval;t++){
+                sec = (llround(settings->elapsedStartHours*3600)+t*frameDurationSec)%SECONDS_PER_DAY;
+                snprintf(timeStr,sizeof(timeStr),"%02d:%02d:%02d",(int)(sec/3600),(int)(sec%3600/60),(int)(sec%60));
+                fprintf(job->alignedFiles[f][s],"\t%s",timeStr);
+            }
+            fprintf(job->alignedFiles[f][s],"\n");
+            free(filename);
+        }
+        free(featurePath);
+    }
+    return true;
+}
+
+int main(int argc, char * argv[]){
+    batch_settings_t settings;
+    batch_job_t job;
+    int opt;
+    unsigned int f, s, numStarted, skipCount, successCount;
+    char timestamp[32];
+    double elapsedSec;
+    struct tm nowStruct;
+
+    getDefaultBatchSettings(&settings);
+    memset(&job,0,sizeof(batch_job_t));
+
+    // settings file first so the remaining options override it
+    for(opt=1;opt<argc-1;opt++){
+        if(strcmp(argv[opt],"-s")==0 && !loadBatchSettings(argv[opt+1],&settings)){
+            return -1;
+        }
+    }
+    while((opt=getopt(argc,argv,"s:f:m:d:e:l:j:uah"))!=-1){
+        switch(opt){
+            case 's': break;
+            case 'f': strncpy(settings.featureLabel,optarg,SZ_SETTING-1); break;
+            case 'm': settings.frameDurationMinutes = atof(optarg); break;
+            case 'd': settings.numDaysAllowed = (unsigned int)atoi(optarg); break;
+            case 'e': settings.elapsedStartHours = atof(optarg); break;
+            case 'l': settings.intervalLengthHours = atof(optarg); break;
+            case 'j': settings.numWorkers = (unsigned int)atoi(optarg); break;
+            case 'u': settings.exportUnaligned = true; break;
+            case 'a': settings.exportAligned = false; break;
+            default:
+                printUsage(argv[0]);
+                return -1;
+        }
+    }
+    if(optind+2==argc){
+        strncpy(settings.sourceDirectory,argv[optind],SZ_SETTING-1);
+        strncpy(settings.outputDirectory,argv[optind+1],SZ_SETTING-1);
+    }
+    if(!is_dir(settings.sourceDirectory) || strlen(settings.outputDirectory)==0 || settings.intervalLengthHours<=0 || settings.frameDurationMinutes<=0){
+        printUsage(argv[0]);
+        return -1;
+    }
+    if(!selectFeatures(settings.featureLabel,job.featureSelected)){
+        return -1;
+    }
+    if(settings.numWorkers==0){
+        settings.numWorkers = getNumCores();
+    }
+
+    job.settings = &settings;
+    job.fileCount = getRawFilenames(settings.sourceDirectory,&job.filenames,&job.fullFilenames);
+    if(job.fileCount==0){
+        fprintf(stderr,"0 files found.\n");
+        return -1;
+    }
+    job.results = calloc(job.fileCount,sizeof(file_result_t));
+    pthread_mutex_init(&job.writeLock,NULL);
+
+    job.startTime = time(NULL);
+    localtime_r(&job.startTime,&nowStruct);
+    strftime(timestamp,sizeof(timestamp),"%d%b%Y_%H%M",&nowStruct);
+    if(!prepOutputFiles(&job,timestamp)){
+        return -1;
+    }
+
+    signal(SIGINT,handleInterrupt);
+    numStarted = parallelFor(job.fileCount,settings.numWorkers,commitResults,&job,&keepRunning);
+    elapsedSec = difftime(time(NULL),job.startTime);
+
+    skipCount = job.fileCount-numStarted;
+    successCount = numStarted-job.numFailed;
+    snprintf(timestamp,sizeof(timestamp),"%02d:%02d:%02d",(int)(elapsedSec/3600),(int)fmod(elapsedSec/60,60),(int)fmod(elapsedSec,60));
+    fprintf(job.logFID,"\n====================SUMMARY===============\n");
+    fprintf(job.logFID,"%sProcessed %u files in (hh:mm:ss)\t %s.\n"
+            "\tSucceeded:\t%5u\n"
+            "\tSkipped:\t%5u\n"
+            "\tFailed:\t%5u\n\n",keepRunning ? "" : "User canceled batch operation before completion.\n\n",job.fileCount,timestamp,successCount,skipCount,job.numFailed);
+    fprintf(job.logFID,"Total day count:\t%5u\n"
+            "Complete day count:\t%5u\n"
+            "Incomplete day count:\t%5u\n",job.totalDayCount,job.completeDayCount,job.incompleteDayCount);
+    fprintf(stdout,"Processed %u files in (hh:mm:ss)\t %s.\n\tSucceeded:\t%5u\n\tSkipped:\t%5u\n\tFailed:\t%5u\n",
+            job.fileCount,timestamp,successCount,skipCount,job.numFailed);
+
+    for(f=0;f<NUM_FEATURES;f++){
+        for(s=0;s<NUM_SIGNALS;s++){
+            if(job.alignedFiles[f][s]!=NULL){
+                fclose(job.alignedFiles[f][s]);
+            }
+        }
+    }
+    if(job.logFID!=stdout) fclose(job.logFID);
+    if(job.summaryFID!=stdout) fclose(job.summaryFID);
+    for(f=0;f<job.fileCount;f++){
+        free(job.filenames[f]);
+        free(job.fullFilenames[f]);
+    }
+    free(job.filenames);
+    free(job.fullFilenames);
+    free(job.results);
+    pthread_mutex_destroy(&job.writeLock);
+    return job.numFailed>0 ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+// Builds or refreshes the recording catalog for a directory tree (see catalog.h).
+// gcc -O2 padacocatalog.c catalog.c rawtools.c rawcodec.c in_parallel.c in_system.c tictoc.c -lm -lpthread -o padacocatalog
+#include <unistd.h> // for getopt
+#include "catalog.h"
+#include "tictoc.h"
+#include "in_system.h"
+
+void printUsage(char * programName){
+    fprintf(stdout,"Usage: %s [-j <workers>] [-c <catalog filename>] [-l] <pathname containing recordings>\n",programName);
+    fprintf(stdout,"  -j  Number of worker threads.  Default: number of cores\n"
+                   "  -c  Catalog file.  Default: <pathname>/%s\n"
+                   "  -l  List the catalog after updating it\n",CATALOG_FILENAME);
+}
+
+int main(int argc, char * argv[]){
+    recording_catalog_t catalog;
+    catalog_update_t summary;
+    char * catalogFilename = NULL, * rootPathname;
+    unsigned int numWorkers = 0, e, numValid = 0;
+    bool shouldList = false, ownsFilename = false;
+    double totalDays = 0;
+    int opt;
+    while((opt=getopt(argc,argv,"j:c:l"))!=-1){
+        switch(opt){
+            case 'j': numWorkers = (unsigned int)atoi(optarg); break;
+            case 'c': catalogFilename = optarg; break;
+            case 'l': shouldList = true; break;
+            default:
+                printUsage(argv[0]);
+                return -1;
+        }
+    }
+    if(argc-optind!=1 || !is_dir(argv[optind])){
+        printUsage(argv[0]);
+        return -1;
+    }
+    rootPathname = argv[optind];
+    if(catalogFilename==NULL){
+        catalogFilename = fullfile(rootPathname,CATALOG_FILENAME);
+        ownsFilename = true;
+    }
+
+    tic();
+    loadCatalog(catalogFilename,&catalog);
+    if(!updateCatalog(&catalog,rootPathname,numWorkers,&summary) || !saveCatalog(catalogFilename,&catalog)){
+        freeCatalog(&catalog);
+        fprintf(stderr,"FAIL\n");
+        return -1;
+    }
+    for(e=0;e<catalog.count;e++){
+        if(catalog.entries[e].isValid){
+            numValid++;
+            totalDays += catalog.entries[e].duration_sec/86400;
+        }
+        if(shouldList){
+            fprintf(stdout,"%s\t%s\t%s\t%g Hz\t%0.2f days%s\n",catalog.entries[e].path,RECORDING_TYPE_NAMES[catalog.entries[e].type],catalog.entries[e].serialID,
+                    catalog.entries[e].samplerate,catalog.entries[e].duration_sec/86400,catalog.entries[e].isValid ? "" : "\t(unrecognised header)");
+        }
+    }
+    fprintf(stdout,"Recordings found:\t %u\n"
+            "Headers read:\t %u\n"
+            "Entries removed:\t %u\n"
+            "Unrecognised:\t %u\n"
+            "Total duration:\t %0.1f days\n",summary.numFound,summary.numParsed,summary.numRemoved,catalog.count-numValid,totalDays);
+    printToc();
+    freeCatalog(&catalog);
+    if(ownsFilename){
+        free(catalogFilename);
+    }
+    return 0;
+}
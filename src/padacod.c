@@ -0,0 +1,217 @@
+// Local study server: keeps decoded studies in shared memory so that several MATLAB sessions
+// (PASingleStudyController, PAStatTool, PABatchTool) on one machine share a single decoded
+// copy of each recording instead of each decoding it from disk.  Clients talk to it over a
+// Unix domain socket (see studysocket.h) through the sharedstudy mex file.  Decoded studies
+// are kept in a least recently used cache bounded by -m megabytes (see studycache.h).
+//
+// gcc -O2 -Wall padacod.c studycache.c studysocket.c classifyusage.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -lrt -o padacod
+#include <signal.h>
+#include <unistd.h> // for getopt
+#include <poll.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "rawtools.h"
+#include "framefeatures.h"
+#include "in_parallel.h"
+#include "studycache.h"
+#include "studysocket.h"
+
+#define DEFAULT_CACHE_MB 4096
+#define POLL_INTERVAL_MS 1000
+
+static volatile bool keepRunning = true;
+
+typedef struct{
+    int fd;
+    study_cache_t * cache;
+} connection_t;
+
+typedef struct{
+    const study_segment_t * segment;
+    feature_id_t featureID;
+    unsigned int samplesPerFrame;
+    unsigned int numFrames;
+    double * features;
+} feature_job_t;
+
+void printUsage(char * programName){
+    fprintf(stdout,"Usage: %s [options]\n"
+            "Options:\n"
+            "  -s <socket>     Socket to listen on.  Default: $%s or /tmp/padacod.<uid>.sock\n"
+            "  -m <megabytes>  Shared memory allowed for decoded studies before the least recently used are dropped.  Default: %u\n",
+            programName,STUDY_SOCKET_ENV,DEFAULT_CACHE_MB);
+}
+
+static void handleInterrupt(int signalNumber){
+    (void)signalNumber;
+    keepRunning = false;
+}
+
+static void calcSignalFeatures(unsigned int signal, unsigned int workerIndex, void * userData){
+    feature_job_t * job = (feature_job_t*)userData;
+    double * features = job->features+(size_t)signal*job->numFrames;
+    const int8_t * usage;
+    unsigned int frame;
+    (void)workerIndex;
+    if(job->featureID==FEATURE_USAGESTATE){
+        usage = getStudyUsage(job->segment,signal);
+        for(frame=0;frame<job->numFrames;frame++){
+            features[frame] = calcFrameMode(usage+(size_t)frame*job->samplesPerFrame,job->samplesPerFrame);
+        }
+    }
+    else{
+        calcFeatureVector(job->featureID,getStudySignal(job->segment,signal),job->samplesPerFrame,job->numFrames,features);
+    }
+}
+
+// Frames are cut as padacobatch cuts them: whole frames within both the recorded duration
+// and the records loaded.
+static double * getStudyFeatures(const study_segment_t * segment, const study_request_t * request, study_response_t * response){
+    feature_job_t job;
+    if(request->featureID<0 || request->featureID>=NUM_FEATURES || request->frameDurationSec==0){
+        snprintf(response->message,SZ_STUDY_MESSAGE,"Unknown feature or zero frame duration.");
+        return NULL;
+    }
+    job.segment = segment;
+    job.featureID = (feature_id_t)request->featureID;
+    job.samplesPerFrame = request->frameDurationSec*segment->samplerate;
+    job.numFrames = segment->duration_sec/request->frameDurationSec;
+    if((uint64_t)job.numFrames*job.samplesPerFrame>segment->numRecords){
+        job.numFrames = (unsigned int)(segment->numRecords/job.samplesPerFrame);
+    }
+    job.features = malloc((size_t)STUDY_NUM_SIGNALS*(job.numFrames>0 ? job.numFrames : 1)*sizeof(double));
+    parallelFor(STUDY_NUM_SIGNALS,STUDY_NUM_SIGNALS,calcSignalFeatures,&job,NULL);
+    response->numFrames = job.numFrames;
+    response->payloadSize = (uint64_t)STUDY_NUM_SIGNALS*job.numFrames*sizeof(double);
+    return job.features;
+}
+
+static void * serveConnection(void * userData){
+    connection_t * connection = (connection_t*)userData;
+    study_request_t request;
+    study_response_t response;
+    study_entry_t * entry;
+    double * features;
+    bool keepServing = true;
+
+    while(keepServing && recvStudyBytes(connection->fd,&request,sizeof(study_request_t))){
+        memset(&response,0,sizeof(study_response_t));
+        response.magic = STUDY_PROTOCOL_MAGIC;
+        features = NULL;
+        request.filename[SZ_STUDY_FILENAME-1] = '\0';
+        if(request.magic!=STUDY_PROTOCOL_MAGIC || request.command<0 || request.command>=NUM_STUDY_COMMANDS){
+            snprintf(response.message,SZ_STUDY_MESSAGE,"Unrecognized request.");
+        }
+        else if(request.command==STUDY_PING){
+            response.didSucceed = true;
+        }
+        else if((entry=acquireStudy(connection->cache,request.filename,response.message,SZ_STUDY_MESSAGE))!=NULL){
+            memcpy(response.segmentName,entry->segmentName,SZ_STUDY_SEGMENT_NAME);
+            if(request.command==STUDY_FEATURES){
+                features = getStudyFeatures(entry->segment,&request,&response);
+                response.didSucceed = features!=NULL;
+            }
+            else{
+                response.didSucceed = true;
+            }
+            releaseStudy(connection->cache,entry);
+        }
+        keepServing = sendStudyBytes(connection->fd,&response,sizeof(study_response_t)) &&
+                      (response.payloadSize==0 || sendStudyBytes(connection->fd,features,response.payloadSize));
+        free(features);
+    }
+    close(connection->fd);
+    free(connection);
+    return NULL;
+}
+
+// Binds socketPath, replacing a stale socket file but not a live server.
+static int listenStudySocket(const char * socketPath){
+    struct sockaddr_un address;
+    mode_t oldMask;
+    int fd, result;
+    if((fd=connectStudyServer(socketPath))>=0){
+        fprintf(stderr,"A study server is already listening on %s\n",socketPath);
+        close(fd);
+        return -1;
+    }
+    if(strlen(socketPath)>=sizeof(address.sun_path) || (fd=socket(AF_UNIX,SOCK_STREAM,0))<0){
+        fprintf(stderr,"Could not create socket %s\n",socketPath);
+        return -1;
+    }
+    unlink(socketPath);
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path,socketPath);
+    // Only the user may connect, as only the user may map the studies served (0600).
+    oldMask = umask(S_IRWXG|S_IRWXO);
+    result = bind(fd,(struct sockaddr*)&address,sizeof(address));
+    umask(oldMask);
+    if(result!=0 || listen(fd,SOMAXCONN)!=0){
+        fprintf(stderr,"Could not listen on %s (%s)\n",socketPath,strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char * argv[]){
+    char socketPath[SZ_STUDY_FILENAME];
+    double cacheMB = DEFAULT_CACHE_MB;
+    study_cache_t * cache;
+    connection_t * connection;
+    struct pollfd listener;
+    pthread_t thread;
+    int opt, fd;
+
+    getStudySocketPath(socketPath,sizeof(socketPath));
+    while((opt=getopt(argc,argv,"s:m:h"))!=-1){
+        switch(opt){
+            case 's': snprintf(socketPath,sizeof(socketPath),"%s",optarg); break;
+            case 'm': cacheMB = atof(optarg); break;
+            default:
+                printUsage(argv[0]);
+                return -1;
+        }
+    }
+    if(optind!=argc || cacheMB<=0){
+        printUsage(argv[0]);
+        return -1;
+    }
+    if((listener.fd=listenStudySocket(socketPath))<0){
+        return -1;
+    }
+    listener.events = POLLIN;
+    cache = createStudyCache((uint64_t)(cacheMB*1024*1024));
+
+    signal(SIGINT,handleInterrupt);
+    signal(SIGTERM,handleInterrupt);
+    signal(SIGPIPE,SIG_IGN);
+    fprintf(stdout,"Serving studies on %s (%0.0f MB cache)\n",socketPath,cacheMB);
+    fflush(stdout);
+    while(keepRunning){
+        if(poll(&listener,1,POLL_INTERVAL_MS)<=0 || (fd=accept(listener.fd,NULL,NULL))<0){
+            continue;
+        }
+        connection = malloc(sizeof(connection_t));
+        connection->fd = fd;
+        connection->cache = cache;
+        if(pthread_create(&thread,NULL,serveConnection,connection)!=0){
+            close(fd);
+            free(connection);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    // Segments are unlinked; sessions that still map them keep their copy until they close.
+    close(listener.fd);
+    unlink(socketPath);
+    freeStudyCache(cache);
+    fprintf(stdout,"Study server stopped.\n");
+    return 0;
+}
@@ -0,0 +1,418 @@
+//
+//  prefilter.c
+//  Streaming prefilter stage for raw acceleration signals (see PASensorData.prefilter).
+//
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "prefilter.h"
+#include "framefeatures.h"
+
+const char * PREFILTER_NAMES[NUM_PREFILTERS] = {"none","rms","sum","median","mean","lowpass","bandpass"};
+
+// Number of independent accumulators used by the block reductions.  Keeping the partial
+// sums apart removes the loop carried dependency so the compiler can vectorize them.
+#define NUM_LANES 8
+
+prefilter_method_t getPrefilterMethod(const char * name){
+    int m;
+    for(m=0;m<NUM_PREFILTERS;m++){
+        if(strcasecmp(name,PREFILTER_NAMES[m])==0){
+            return (prefilter_method_t)m;
+        }
+    }
+    return PREFILTER_UNKNOWN;
+}
+
+/***************
+ *  Block reductions
+ ***************/
+// Lanes are double, as MATLAB sums, so long bins keep double precision; the float samples
+// are widened as they are added.
+static double blockSum(const float * restrict values, unsigned int numValues){
+    double lanes[NUM_LANES] = {0}, total = 0;
+    unsigned int i, k, numFull = numValues-numValues%NUM_LANES;
+    for(i=0;i<numFull;i+=NUM_LANES){
+        for(k=0;k<NUM_LANES;k++){
+            lanes[k] += values[i+k];
+        }
+    }
+    for(k=0;k<NUM_LANES;k++){
+        total += lanes[k];
+    }
+    for(i=numFull;i<numValues;i++){
+        total += values[i];
+    }
+    return total;
+}
+
+static double blockSumOfSquares(const float * restrict values, unsigned int numValues){
+    double lanes[NUM_LANES] = {0}, total = 0;
+    unsigned int i, k, numFull = numValues-numValues%NUM_LANES;
+    for(i=0;i<numFull;i+=NUM_LANES){
+        for(k=0;k<NUM_LANES;k++){
+            lanes[k] += (double)values[i+k]*values[i+k];
+        }
+    }
+    for(k=0;k<NUM_LANES;k++){
+        total += lanes[k];
+    }
+    for(i=numFull;i<numValues;i++){
+        total += (double)values[i]*values[i];
+    }
+    return total;
+}
+
+/***************
+ *  Biquads
+ ***************/
+static void designSection(biquad_t * section, double samplerate, double cutoffHz, bool isHighpass){
+    const double Q = M_SQRT1_2;  // Butterworth
+    double w0 = 2*M_PI*cutoffHz/samplerate, cosw0 = cos(w0), alpha = sin(w0)/(2*Q), a0 = 1+alpha;
+    if(isHighpass){
+        section->b0 = (1+cosw0)/2/a0;
+        section->b1 = -(1+cosw0)/a0;
+    }
+    else{
+        section->b0 = (1-cosw0)/2/a0;
+        section->b1 = (1-cosw0)/a0;
+    }
+    section->b2 = section->b0;
+    section->a1 = -2*cosw0/a0;
+    section->a2 = (1-alpha)/a0;
+    section->z1 = section->z2 = 0;
+}
+
+void designLowpass(biquad_t * section, double samplerate, double cutoffHz){
+    designSection(section,samplerate,cutoffHz,false);
+}
+
+void designHighpass(biquad_t * section, double samplerate, double cutoffHz){
+    designSection(section,samplerate,cutoffHz,true);
+}
+
+static void biquadBlock(biquad_t * section, const float * input, unsigned int numSamples, float * output){
+    double b0 = section->b0, b1 = section->b1, b2 = section->b2, a1 = section->a1, a2 = section->a2;
+    double z1 = section->z1, z2 = section->z2, x, y;
+    unsigned int i;
+    for(i=0;i<numSamples;i++){
+        x = input[i];
+        y = b0*x+z1;
+        z1 = b1*x-a1*y+z2;
+        z2 = b2*x-a2*y;
+        output[i] = (float)y;
+    }
+    section->z1 = z1;
+    section->z2 = z2;
+}
+
+/***************
+ *  Sliding median
+ ***************/
+#define LOW(m,i) ((m)->heap[i])
+#define HIGH(m,i) ((m)->heap[(m)->lowCapacity+(i)])
+
+static void setLow(sliding_median_t * m, unsigned int i, unsigned int ringPos){
+    LOW(m,i) = ringPos;
+    m->heapPos[ringPos] = (int)i;
+}
+
+static void setHigh(sliding_median_t * m, unsigned int i, unsigned int ringPos){
+    HIGH(m,i) = ringPos;
+    m->heapPos[ringPos] = -(int)i-1;
+}
+
+static void lowSiftUp(sliding_median_t * m, unsigned int i){
+    unsigned int r = LOW(m,i), parent;
+    while(i>0 && m->ring[LOW(m,parent=(i-1)/2)]<m->ring[r]){
+        setLow(m,i,LOW(m,parent));
+        i = parent;
+    }
+    setLow(m,i,r);
+}
+
+static void lowSiftDown(sliding_median_t * m, unsigned int i){
+    unsigned int r = LOW(m,i), child;
+    while((child=2*i+1)<m->lowSize){
+        if(child+1<m->lowSize && m->ring[LOW(m,child+1)]>m->ring[LOW(m,child)]){
+            child++;
+        }
+        if(m->ring[LOW(m,child)]<=m->ring[r]){
+            break;
+        }
+        setLow(m,i,LOW(m,child));
+        i = child;
+    }
+    setLow(m,i,r);
+}
+
+static void highSiftUp(sliding_median_t * m, unsigned int i){
+    unsigned int r = HIGH(m,i), parent;
+    while(i>0 && m->ring[HIGH(m,parent=(i-1)/2)]>m->ring[r]){
+        setHigh(m,i,HIGH(m,parent));
+        i = parent;
+    }
+    setHigh(m,i,r);
+}
+
+static void highSiftDown(sliding_median_t * m, unsigned int i){
+    unsigned int r = HIGH(m,i), child;
+    while((child=2*i+1)<m->highSize){
+        if(child+1<m->highSize && m->ring[HIGH(m,child+1)]<m->ring[HIGH(m,child)]){
+            child++;
+        }
+        if(m->ring[HIGH(m,child)]>=m->ring[r]){
+            break;
+        }
+        setHigh(m,i,HIGH(m,child));
+        i = child;
+    }
+    setHigh(m,i,r);
+}
+
+// A single changed or added value can leave at most one element on the wrong side, so
+// exchanging the two tops restores max(lower half) <= min(upper half).
+static void rebalanceMedian(sliding_median_t * m){
+    unsigned int lowTop, highTop;
+    if(m->lowSize>0 && m->highSize>0 && m->ring[LOW(m,0)]>m->ring[HIGH(m,0)]){
+        lowTop = LOW(m,0);
+        highTop = HIGH(m,0);
+        setLow(m,0,highTop);
+        setHigh(m,0,lowTop);
+        lowSiftDown(m,0);
+        highSiftDown(m,0);
+    }
+}
+
+static sliding_median_t * createSlidingMedian(unsigned int windowLength){
+    sliding_median_t * m = calloc(1,sizeof(sliding_median_t));
+    m->windowLength = windowLength;
+    m->lowCapacity = (windowLength+1)/2;
+    m->ring = calloc(windowLength,sizeof(float));
+    m->heap = calloc(windowLength,sizeof(unsigned int));
+    m->heapPos = calloc(windowLength,sizeof(int));
+    return m;
+}
+
+static void freeSlidingMedian(sliding_median_t * m){
+    if(m!=NULL){
+        free(m->ring);
+        free(m->heap);
+        free(m->heapPos);
+        free(m);
+    }
+}
+
+static float pushSlidingMedian(sliding_median_t * m, float value){
+    unsigned int r;
+    int p;
+    if(m->count<m->windowLength){
+        r = m->count++;
+        m->ring[r] = value;
+        // keep lowSize == ceil(count/2)
+        if(m->lowSize<=m->highSize){
+            setLow(m,m->lowSize,r);
+            lowSiftUp(m,m->lowSize++);
+        }
+        else{
+            setHigh(m,m->highSize,r);
+            highSiftUp(m,m->highSize++);
+        }
+    }
+    else{
+        r = m->oldest;
+        m->oldest = (m->oldest+1)%m->windowLength;
+        m->ring[r] = value;
+        p = m->heapPos[r];
+        if(p>=0){
+            lowSiftUp(m,(unsigned int)p);
+            lowSiftDown(m,(unsigned int)m->heapPos[r]);
+        }
+        else{
+            highSiftUp(m,(unsigned int)(-p-1));
+            highSiftDown(m,(unsigned int)(-m->heapPos[r]-1));
+        }
+    }
+    rebalanceMedian(m);
+    // Even counts average the two middle values, as MATLAB's median does.
+    return m->count%2 ? m->ring[LOW(m,0)] : (m->ring[LOW(m,0)]+m->ring[HIGH(m,0)])/2;
+}
+
+/***************
+ *  Prefilter
+ ***************/
+
+// @brief Creates a streaming prefilter.
+// @param windowLength Window length in samples for the rms, sum, median and mean methods.
+// @param lowHz Lower cutoff for the band-pass method.
+// @param highHz Cutoff for the low-pass method and upper cutoff for the band-pass method.
+// @retval Filter to pass to prefilterBlock() and freePrefilter(), or NULL for invalid arguments.
+prefilter_t * createPrefilter(prefilter_method_t method, unsigned int windowLength, double samplerate, double lowHz, double highHz){
+    prefilter_t * filter;
+    double nyquist = samplerate/2;
+    if(method<=PREFILTER_UNKNOWN || method>=NUM_PREFILTERS){
+        return NULL;
+    }
+    if(method>=PREFILTER_RMS && method<=PREFILTER_MEAN && windowLength==0){
+        return NULL;
+    }
+    if((method==PREFILTER_LOWPASS && (highHz<=0 || highHz>=nyquist)) ||
+       (method==PREFILTER_BANDPASS && (lowHz<=0 || highHz<=lowHz || highHz>=nyquist))){
+        return NULL;
+    }
+    filter = calloc(1,sizeof(prefilter_t));
+    filter->method = method;
+    filter->windowLength = windowLength;
+    switch(method){
+        case PREFILTER_RMS:
+        case PREFILTER_SUM:
+        case PREFILTER_MEAN:
+            filter->ring = calloc(windowLength,sizeof(float));
+            break;
+        case PREFILTER_MEDIAN:
+            filter->median = createSlidingMedian(windowLength);
+            break;
+        case PREFILTER_LOWPASS:
+            designLowpass(&filter->sections[0],samplerate,highHz);
+            filter->numSections = 1;
+            break;
+        case PREFILTER_BANDPASS:
+            designHighpass(&filter->sections[0],samplerate,lowHz);
+            designLowpass(&filter->sections[1],samplerate,highHz);
+            filter->numSections = 2;
+            break;
+        default:
+            break;
+    }
+    return filter;
+}
+
+void resetPrefilter(prefilter_t * filter){
+    unsigned int s;
+    filter->count = filter->next = 0;
+    filter->runningSum = 0;
+    for(s=0;s<filter->numSections;s++){
+        filter->sections[s].z1 = filter->sections[s].z2 = 0;
+    }
+    if(filter->median!=NULL){
+        filter->median->count = filter->median->oldest = 0;
+        filter->median->lowSize = filter->median->highSize = 0;
+    }
+}
+
+void freePrefilter(prefilter_t * filter){
+    if(filter!=NULL){
+        free(filter->ring);
+        freeSlidingMedian(filter->median);
+        free(filter);
+    }
+}
+
+static void runningStatBlock(prefilter_t * filter, const float * input, unsigned int numSamples, float * output){
+    unsigned int i, L = filter->windowLength;
+    bool isRMS = filter->method==PREFILTER_RMS;
+    double sum = filter->runningSum, value;
+    for(i=0;i<numSamples;i++){
+        value = isRMS ? (double)input[i]*input[i] : input[i];
+        if(filter->count==L){
+            sum -= isRMS ? (double)filter->ring[filter->next]*filter->ring[filter->next] : filter->ring[filter->next];
+        }
+        else{
+            filter->count++;
+        }
+        filter->ring[filter->next] = input[i];
+        sum += value;
+        if(++filter->next==L){
+            filter->next = 0;
+            // Resum once per window so rounding from the subtractions cannot accumulate.
+            sum = isRMS ? blockSumOfSquares(filter->ring,filter->count) : blockSum(filter->ring,filter->count);
+        }
+        switch(filter->method){
+            case PREFILTER_RMS:
+                output[i] = (float)sqrt((sum>0 ? sum : 0)/filter->count);
+                break;
+            case PREFILTER_MEAN:
+                output[i] = (float)(sum/filter->count);
+                break;
+            default:
+                output[i] = (float)sum;
+                break;
+        }
+    }
+    filter->runningSum = sum;
+}
+
+// @brief Filters the next block of a signal.  Windowed statistics are causal: output[i] is
+// computed from the windowLength samples ending at input[i] (fewer at the very start).
+// input and output may be the same buffer.
+void prefilterBlock(prefilter_t * filter, const float * input, unsigned int numSamples, float * output){
+    unsigned int i, s;
+    switch(filter->method){
+        case PREFILTER_RMS:
+        case PREFILTER_SUM:
+        case PREFILTER_MEAN:
+            runningStatBlock(filter,input,numSamples,output);
+            break;
+        case PREFILTER_MEDIAN:
+            for(i=0;i<numSamples;i++){
+                output[i] = pushSlidingMedian(filter->median,input[i]);
+            }
+            break;
+        case PREFILTER_LOWPASS:
+        case PREFILTER_BANDPASS:
+            for(s=0;s<filter->numSections;s++){
+                biquadBlock(&filter->sections[s],s==0 ? input : output,numSamples,output);
+            }
+            break;
+        default:
+            if(output!=input){
+                memcpy(output,input,numSamples*sizeof(float));
+            }
+            break;
+    }
+}
+
+// @brief Aggregates a signal into consecutive, non-overlapping bins of samplesPerBin samples
+// (PASensorData's numBins/aggregateDurMin).  Bins without a full complement of samples are NaN.
+// @retval Number of bins filled, or 0 if the method cannot be used for aggregation.
+unsigned int aggregateBins(prefilter_method_t method, const float * signal, unsigned int numSamples, unsigned int samplesPerBin, unsigned int numBins, float * bins){
+    unsigned int b, i, numFilled;
+    const float * bin;
+    double * scratch = NULL;
+    if(samplesPerBin==0 || method==PREFILTER_LOWPASS || method==PREFILTER_BANDPASS || method<=PREFILTER_UNKNOWN || method>=NUM_PREFILTERS){
+        return 0;
+    }
+    numFilled = numSamples/samplesPerBin<numBins ? numSamples/samplesPerBin : numBins;
+    if(method==PREFILTER_MEDIAN){
+        scratch = malloc(samplesPerBin*sizeof(double));
+    }
+    for(b=0;b<numFilled;b++){
+        bin = signal+(size_t)b*samplesPerBin;
+        switch(method){
+            case PREFILTER_RMS:
+                bins[b] = (float)sqrt(blockSumOfSquares(bin,samplesPerBin)/samplesPerBin);
+                break;
+            case PREFILTER_SUM:
+                bins[b] = (float)blockSum(bin,samplesPerBin);
+                break;
+            case PREFILTER_MEAN:
+                bins[b] = (float)(blockSum(bin,samplesPerBin)/samplesPerBin);
+                break;
+            case PREFILTER_MEDIAN:
+                for(i=0;i<samplesPerBin;i++){
+                    scratch[i] = bin[i];
+                }
+                bins[b] = (float)medianInPlace(scratch,samplesPerBin);
+                break;
+            default:
+                bins[b] = bin[0];
+                break;
+        }
+    }
+    for(b=numFilled;b<numBins;b++){
+        bins[b] = NAN;
+    }
+    free(scratch);
+    return numFilled;
+}
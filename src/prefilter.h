@@ -0,0 +1,70 @@
+//
+//  prefilter.h
+//  Streaming prefilter stage for raw acceleration signals.  Filters keep their state
+//  between calls so a signal may be passed through in blocks of any size (e.g. as it is
+//  parsed from a .csv file) and produce the same output as a single pass.
+//
+
+#ifndef in_prefilter_h
+#define in_prefilter_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum{
+    PREFILTER_NONE = 0,
+    PREFILTER_RMS,
+    PREFILTER_SUM,
+    PREFILTER_MEDIAN,
+    PREFILTER_MEAN,
+    PREFILTER_LOWPASS,
+    PREFILTER_BANDPASS,
+    NUM_PREFILTERS,
+    PREFILTER_UNKNOWN = -1
+} prefilter_method_t;
+
+extern const char * PREFILTER_NAMES[NUM_PREFILTERS];
+
+// Second order section, direct form II transposed.
+typedef struct{
+    double b0, b1, b2, a1, a2;
+    double z1, z2;
+} biquad_t;
+
+// Sliding median over the last windowLength samples; a max heap holds the lower half of
+// the window and a min heap the upper half so each new sample costs O(log windowLength).
+typedef struct{
+    unsigned int windowLength;
+    unsigned int count;      // samples currently in the window
+    unsigned int oldest;     // ring position of the oldest sample
+    float * ring;
+    unsigned int * heap;     // ring positions; lower half [0,lowSize), upper half after lowCapacity
+    int * heapPos;           // heap position for each ring position; negative values index the upper half
+    unsigned int lowSize, highSize, lowCapacity;
+} sliding_median_t;
+
+typedef struct{
+    prefilter_method_t method;
+    unsigned int windowLength;  // samples, for the windowed statistics
+    unsigned int count;
+    unsigned int next;
+    float * ring;
+    double runningSum;          // sum (or sum of squares for rms) of the ring contents
+    sliding_median_t * median;
+    biquad_t sections[2];
+    unsigned int numSections;
+} prefilter_t;
+
+prefilter_method_t getPrefilterMethod(const char * name);
+
+prefilter_t * createPrefilter(prefilter_method_t method, unsigned int windowLength, double samplerate, double lowHz, double highHz);
+void resetPrefilter(prefilter_t * filter);
+void freePrefilter(prefilter_t * filter);
+void prefilterBlock(prefilter_t * filter, const float * input, unsigned int numSamples, float * output);
+
+void designLowpass(biquad_t * section, double samplerate, double cutoffHz);
+void designHighpass(biquad_t * section, double samplerate, double cutoffHz);
+
+unsigned int aggregateBins(prefilter_method_t method, const float * signal, unsigned int numSamples, unsigned int samplesPerBin, unsigned int numBins, float * bins);
+
+#endif /* in_prefilter_h */
@@ -0,0 +1,113 @@
+/*
+ * prefiltersignal.c - run the streaming prefilter (prefilter.c) over raw acceleration signals.
+ *
+ * The calling syntax is:
+ *
+ *		filtered = prefiltersignal(signals, method, samplerate, windowSec, cutoffsHz)
+ *		bins = prefiltersignal(signals, method, samplerate, 'bins', samplesPerBin, numBins)
+ *
+ * signals is a single precision matrix with one signal per column (e.g. [x, y, z, vecMag]).
+ * method is one of 'rms', 'sum', 'median', 'mean', 'lowpass' or 'bandpass'.  windowSec is
+ * used by the windowed statistics and cutoffsHz ([low, high]) by the biquad filters.  The
+ * 'bins' form aggregates each column into numBins consecutive bins of samplesPerBin samples
+ * instead (rms, sum, median or mean); incomplete bins are NaN.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O prefiltersignal.c prefilter.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "prefilter.h"
+
+#define FILTER_BLOCK_SIZE 4096
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * methodName, * mode = NULL;
+    prefilter_method_t method;
+    prefilter_t * filter;
+    const float * signals;
+    float * output;
+    double samplerate, windowSec = 1, lowHz = 0.25, highHz = 2.5;
+    const double * cutoffs;
+    size_t numSamples, numSignals, c, start, blockSize;
+    unsigned int samplesPerBin, numBins;
+
+    if(nrhs < 3) {
+        mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:nrhs",
+                "Signals, method and samplerate are required inputs.");
+    }
+    if(nlhs > 1) {
+        mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:nlhs",
+                "One output is produced.");
+    }
+    if(!mxIsSingle(prhs[0])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:notSingle",
+                "Signals must be of class single.");
+    }
+    methodName = mxArrayToString(prhs[1]);
+    method = methodName==NULL ? PREFILTER_UNKNOWN : getPrefilterMethod(methodName);
+    mxFree(methodName);
+    if(method==PREFILTER_UNKNOWN) {
+        mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:method",
+                "Unknown prefilter method.");
+    }
+
+    signals = (const float*)mxGetData(prhs[0]);
+    numSamples = mxGetM(prhs[0]);
+    numSignals = mxGetN(prhs[0]);
+    samplerate = mxGetScalar(prhs[2]);
+
+    if(nrhs > 3 && mxIsChar(prhs[3])) {
+        mode = mxArrayToString(prhs[3]);
+    }
+    if(mode != NULL && strcmp(mode,"bins")==0) {
+        mxFree(mode);
+        if(nrhs < 6) {
+            mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:nrhs",
+                    "samplesPerBin and numBins are required for aggregation.");
+        }
+        if(method==PREFILTER_LOWPASS || method==PREFILTER_BANDPASS) {
+            mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:bins",
+                    "The %s method cannot be used to aggregate bins.",PREFILTER_NAMES[method]);
+        }
+        samplesPerBin = (unsigned int)mxGetScalar(prhs[4]);
+        numBins = (unsigned int)mxGetScalar(prhs[5]);
+        plhs[0] = mxCreateNumericMatrix(numBins,numSignals,mxSINGLE_CLASS,mxREAL);
+        output = (float*)mxGetData(plhs[0]);
+        for(c=0;c<numSignals;c++) {
+            aggregateBins(method,signals+c*numSamples,(unsigned int)numSamples,samplesPerBin,numBins,output+c*numBins);
+        }
+        return;
+    }
+    mxFree(mode);
+
+    if(nrhs > 3) {
+        windowSec = mxGetScalar(prhs[3]);
+    }
+    if(nrhs > 4 && mxGetNumberOfElements(prhs[4])==2) {
+        cutoffs = mxGetPr(prhs[4]);
+        lowHz = cutoffs[0];
+        highHz = cutoffs[1];
+    }
+
+    plhs[0] = mxCreateNumericMatrix(numSamples,numSignals,mxSINGLE_CLASS,mxREAL);
+    output = (float*)mxGetData(plhs[0]);
+    for(c=0;c<numSignals;c++) {
+        filter = createPrefilter(method,(unsigned int)(windowSec*samplerate+0.5),samplerate,lowHz,highHz);
+        if(filter==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:prefiltersignal:settings",
+                    "Invalid window or cutoff frequencies for the %s prefilter.",PREFILTER_NAMES[method]);
+        }
+        // block by block, as the converter streams it
+        for(start=0;start<numSamples;start+=blockSize) {
+            blockSize = numSamples-start<FILTER_BLOCK_SIZE ? numSamples-start : FILTER_BLOCK_SIZE;
+            prefilterBlock(filter,signals+c*numSamples+start,(unsigned int)blockSize,output+c*numSamples+start);
+        }
+        freePrefilter(filter);
+    }
+}
@@ -0,0 +1,90 @@
+// gcc rawbin2rawcsv.c rawcsvwriter.c in_system.c rawtools.c rawcodec.c in_parallel.c tictoc.c -lm -lpthread -o rawbin2rawcsv
+#include <unistd.h> // for getopt
+#include "rawtools.h"
+#include "rawcsvwriter.h"
+#include "tictoc.h"
+
+void printUsage(char * programName){
+    fprintf(stdout,"Usage: %s [options] <raw accelerations .bin filename> <raw accelerations .csv filename>\n",programName);
+    fprintf(stdout,"Writes an ActiLife raw .csv export of a Padaco .bin file (see rawcsvwriter.h).\n"
+            "Options:\n"
+            "  -t              Lead each row with a timestamp (ActiLife %s)\n"
+            "  -v <version>    ActiLife version of the export; versions before %s have timestamps.  Default: %s\n"
+            "  -s <datetime>   First row, as \"mm/dd/yyyy HH:MM:SS\".  Rows before the recording are zeros.  Default: first sample\n"
+            "  -e <datetime>   Last row, as \"mm/dd/yyyy HH:MM:SS\".  Rows after the recording are zeros.  Default: last sample\n"
+            "  -a              Append rows to the .csv file, without a header (e.g. to merge recordings)\n"
+            "  -n              Dry run: write to standard output instead of the .csv file\n",
+            RAW_CSV_DEFAULT_TIMESTAMP_VERSION,RAW_CSV_TIMESTAMP_VERSION,RAW_CSV_DEFAULT_VERSION);
+}
+
+int main(int argc, char * argv[]){
+    raw_csv_options_t options;
+    bool isDryRun = false, isValid = true, didWrite;
+    uint64_t numRows = 0;
+    raw_info_t info;
+    raw_csv_source_t source;
+    float * accelerations;
+    int opt;
+
+    initRawCSVOptions(&options);
+    while((opt=getopt(argc,argv,"tv:s:e:an"))!=-1){
+        switch(opt){
+            case 't':
+                options.exportTimestamp = true;
+                break;
+            case 'v':
+                snprintf(options.actilifeVersion,SZ_RAW_CSV_VERSION,"%s",optarg);
+                break;
+            case 's':
+                isValid = isValid && (options.hasStart=parseCSVRowTimestamp(optarg,&options.start));
+                break;
+            case 'e':
+                isValid = isValid && (options.hasStop=parseCSVRowTimestamp(optarg,&options.stop));
+                break;
+            case 'a':
+                options.includeHeader = false;
+                break;
+            case 'n':
+                isDryRun = true;
+                break;
+            default:
+                isValid = false;
+                break;
+        }
+    }
+    if(!isValid || argc-optind!=(isDryRun ? 1 : 2)){
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    tic();
+    if(isDryRun){
+        if((accelerations=loadRawAccelerations(argv[optind],&info))==NULL){
+            fprintf(stderr,"FAIL\n");
+            return -1;
+        }
+        source.axes[0] = accelerations;
+        source.axes[1] = accelerations+1;
+        source.axes[2] = accelerations+2;
+        source.stride = 3;
+        source.isDouble = false;
+        source.numRecords = info.recordCount;
+        source.samplerate = info.samplerate;
+        source.start = (double)info.start;
+        source.serialID = info.serialID;
+        didWrite = writeActigraphRawRows(stdout,&source,&options,0,&numRows);
+        free(accelerations);
+    }
+    else{
+        didWrite = exportActigraphRawCSV(argv[optind],argv[optind+1],&options,0,&numRows);
+        printf("%llu rows written to %s\n",(unsigned long long)numRows,argv[optind+1]);
+    }
+    if(!didWrite){
+        fprintf(stderr,"FAIL\n");
+        return -1;
+    }
+    if(!isDryRun){
+        printToc();
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Converts Padaco .bin files between the float32 and compressed payloads (see rawcodec.h).
+// gcc -O2 rawbinpack.c rawcodec.c rawtools.c in_parallel.c in_system.c tictoc.c calibrate.c -lm -lpthread -o rawbinpack
+#include <unistd.h> // for getopt
+#include "rawtools.h"
+#include "rawcodec.h"
+#include "calibrate.h"
+#include "tictoc.h"
+#include "in_system.h"
+
+void printUsage(char * programName){
+    fprintf(stdout,"Usage: %s [-d] [-j <workers>] <input .bin filename> <output .bin filename>\n",programName);
+    fprintf(stdout,"  -d  Decompress to float32 payload (default compresses)\n"
+                   "  -j  Number of worker threads.  Default: number of cores\n");
+}
+
+int main(int argc, char * argv[]){
+    bool decompress = false, didWrite = false, hasCalibration = false;
+    unsigned int numWorkers = 0, recordCount = 0;
+    int opt;
+    bin_header_t header;
+    calibration_t calibration;
+    float * samples;
+    FILE * fid;
+    while((opt=getopt(argc,argv,"dj:"))!=-1){
+        switch(opt){
+            case 'd': decompress = true; break;
+            case 'j': numWorkers = (unsigned int)atoi(optarg); break;
+            default:
+                printUsage(argv[0]);
+                return -1;
+        }
+    }
+    if(argc-optind!=2){
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    tic();
+    samples = parseRawBinFile(argv[optind],&header,&recordCount);
+    if(samples==NULL || recordCount==0){
+        fprintf(stderr,"Could not load %s\n",argv[optind]);
+        free(samples);
+        return -1;
+    }
+    // carry over the auto-calibration record that follows the input payload, if any
+    if((fid=fopen(argv[optind],"rb"))!=NULL){
+        hasCalibration = readCalibrationTrailer(fid,&header,&calibration);
+        fclose(fid);
+    }
+    if((fid=fopen(argv[optind+1],"wb"))==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",argv[optind+1]);
+        free(samples);
+        return -1;
+    }
+    if(decompress){
+        header.sz_per_signal = sizeof(float);
+        header.sz_remaining = (uint64_t)recordCount*header.num_signals*sizeof(float);
+        didWrite = fwrite(&header,sizeof(bin_header_t),1,fid)==1 && fwrite(samples,header.sz_remaining,1,fid)==1;
+    }
+    else{
+        didWrite = writeCompressedBin(fid,&header,samples,recordCount,numWorkers);
+        if(didWrite){
+            fprintf(stdout,"Compressed %u records to %llu bytes (%0.2fx)\n",recordCount,(unsigned long long)header.sz_remaining,
+                    (double)recordCount*header.num_signals*sizeof(float)/header.sz_remaining);
+        }
+    }
+    if(didWrite && hasCalibration){
+        didWrite = writeCalibrationTrailer(fid,&calibration);
+    }
+    fclose(fid);
+    free(samples);
+    if(!didWrite){
+        fprintf(stderr,"FAIL\n");
+        return -1;
+    }
+    printToc();
+    return 0;
+}
@@ -0,0 +1,461 @@
+//
+//  rawcodec.c
+//  Lossless compression of raw acceleration payloads.  See rawcodec.h for the layout.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rawcodec.h"
+#include "in_parallel.h"
+
+#define BLOCK_MODE_PACKED 0
+#define BLOCK_MODE_VERBATIM 1
+
+// Integer grids tried, in order, when mapping a block back to quantised values: three
+// decimal .csv exports, 12 bit +/-6 g and +/-8 g devices, then coarser decimal grids.
+static const double GRID_DIVISORS[] = {1000.0, 341.0, 256.0, 100.0, 10.0, 1.0};
+#define NUM_GRID_DIVISORS (sizeof(GRID_DIVISORS)/sizeof(GRID_DIVISORS[0]))
+#define MAX_QUANTISED_MAGNITUDE (1<<29)
+
+typedef struct{
+    const float * samples;
+    unsigned int numSignals;
+    uint64_t numRecords;
+    uint32_t recordsPerBlock;
+    uint8_t ** blocks;
+    uint64_t * blockSizes;
+} encode_job_t;
+
+typedef struct{
+    const uint8_t * blocks;
+    const uint64_t * offsets;
+    const codec_header_t * header;
+    float * samples;
+    volatile bool didFail;
+} decode_job_t;
+
+static inline uint32_t zigzag(int32_t value){
+    return ((uint32_t)value<<1)^(uint32_t)(value>>31);
+}
+
+static inline int32_t unzigzag(uint32_t value){
+    return (int32_t)(value>>1)^-(int32_t)(value&1);
+}
+
+static inline unsigned int bitWidth(uint32_t value){
+    unsigned int width = 0;
+    while(value){
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+static bool sameBits(float a, float b){
+    return memcmp(&a,&b,sizeof(float))==0;
+}
+
+// Quantises one signal of a block onto the grid 1/divisor; fails unless every value
+// decodes back to exactly the same float.  Negative zeros (e.g. "-0.000" in .csv exports)
+// quantise to 0 and their positions are listed so the sign can be restored.
+static bool quantiseSignal(const float * samples, unsigned int stride, unsigned int numValues, double divisor, int32_t * quantised, uint16_t * negativeZeros, unsigned int * numNegativeZeros){
+    unsigned int i;
+    double scaled;
+    float value;
+    *numNegativeZeros = 0;
+    for(i=0;i<numValues;i++){
+        value = samples[(size_t)i*stride];
+        scaled = value*divisor;
+        if(!(fabs(scaled)<MAX_QUANTISED_MAGNITUDE)){
+            return false;
+        }
+        quantised[i] = (int32_t)llrint(scaled);
+        if(value==0 && signbit(value)){
+            negativeZeros[(*numNegativeZeros)++] = (uint16_t)i;
+        }
+        else if(!sameBits((float)(quantised[i]/divisor),value)){
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t * packDeltas(const int32_t * quantised, unsigned int numValues, uint8_t * out){
+    unsigned int start, i, count, width;
+    uint32_t deltas[RAW_CODEC_MINIBLOCK], maxDelta;
+    uint64_t accumulator;
+    unsigned int numBits;
+    for(start=1;start<numValues;start+=RAW_CODEC_MINIBLOCK){
+        count = numValues-start<RAW_CODEC_MINIBLOCK ? numValues-start : RAW_CODEC_MINIBLOCK;
+        maxDelta = 0;
+        for(i=0;i<count;i++){
+            deltas[i] = zigzag(quantised[start+i]-quantised[start+i-1]);
+            maxDelta |= deltas[i];
+        }
+        width = bitWidth(maxDelta);
+        *out++ = (uint8_t)width;
+        accumulator = 0;
+        numBits = 0;
+        for(i=0;i<count && width>0;i++){
+            accumulator |= (uint64_t)deltas[i]<<numBits;
+            numBits += width;
+            while(numBits>=8){
+                *out++ = (uint8_t)accumulator;
+                accumulator >>= 8;
+                numBits -= 8;
+            }
+        }
+        if(numBits>0){
+            *out++ = (uint8_t)accumulator;
+        }
+    }
+    return out;
+}
+
+static const uint8_t * unpackDeltas(const uint8_t * in, const uint8_t * end, int32_t first, unsigned int numValues, float * samples, unsigned int stride, double divisor){
+    unsigned int start, i, count, width, numBits;
+    uint64_t accumulator, mask;
+    int32_t value = first;
+    samples[0] = (float)(value/divisor);
+    for(start=1;start<numValues;start+=RAW_CODEC_MINIBLOCK){
+        count = numValues-start<RAW_CODEC_MINIBLOCK ? numValues-start : RAW_CODEC_MINIBLOCK;
+        if(in>=end || (width=*in++)>32 || (uint64_t)(end-in)<((uint64_t)count*width+7)/8){
+            return NULL;
+        }
+        mask = width==32 ? 0xFFFFFFFFu : ((uint64_t)1<<width)-1;
+        accumulator = 0;
+        numBits = 0;
+        for(i=0;i<count;i++){
+            while(numBits<width){
+                accumulator |= (uint64_t)*in++<<numBits;
+                numBits += 8;
+            }
+            value += unzigzag((uint32_t)(accumulator&mask));
+            accumulator >>= width;
+            numBits -= width;
+            samples[(size_t)(start+i)*stride] = (float)(value/divisor);
+        }
+    }
+    return in;
+}
+
+static uint8_t * encodeBlock(const float * samples, unsigned int numSignals, unsigned int numRecords, uint64_t * sz_block){
+    uint64_t capacity = (uint64_t)numSignals*(1+sizeof(double)+sizeof(int32_t)+sizeof(uint16_t)+(uint64_t)numRecords*(sizeof(float)+sizeof(uint16_t))+numRecords/RAW_CODEC_MINIBLOCK+2);
+    uint8_t * block = malloc(capacity), * out = block, * signalStart;
+    int32_t * quantised = malloc(numRecords*sizeof(int32_t));
+    uint16_t * negativeZeros = malloc(numRecords*sizeof(uint16_t));
+    uint16_t count16;
+    unsigned int s, d, g = 0, numNegativeZeros = 0;
+    bool onGrid;
+    double divisor;
+    for(s=0;s<numSignals;s++){
+        signalStart = out;
+        onGrid = false;
+        // the grid that worked for the previous signal is the most likely one
+        for(d=0;d<NUM_GRID_DIVISORS && !onGrid;d++){
+            onGrid = quantiseSignal(samples+s,numSignals,numRecords,GRID_DIVISORS[(g+d)%NUM_GRID_DIVISORS],quantised,negativeZeros,&numNegativeZeros);
+            if(onGrid){
+                g = (g+d)%NUM_GRID_DIVISORS;
+            }
+        }
+        if(onGrid){
+            divisor = GRID_DIVISORS[g];
+            *out++ = BLOCK_MODE_PACKED;
+            memcpy(out,&divisor,sizeof(double));
+            out += sizeof(double);
+            memcpy(out,&quantised[0],sizeof(int32_t));
+            out += sizeof(int32_t);
+            count16 = (uint16_t)numNegativeZeros;
+            memcpy(out,&count16,sizeof(uint16_t));
+            out += sizeof(uint16_t);
+            memcpy(out,negativeZeros,numNegativeZeros*sizeof(uint16_t));
+            out += numNegativeZeros*sizeof(uint16_t);
+            out = packDeltas(quantised,numRecords,out);
+        }
+        // noisy or unquantised data can pack larger than it started
+        if(!onGrid || (uint64_t)(out-signalStart)>=1+(uint64_t)numRecords*sizeof(float)){
+            out = signalStart;
+            *out++ = BLOCK_MODE_VERBATIM;
+            for(d=0;d<numRecords;d++){
+                memcpy(out,&samples[(size_t)d*numSignals+s],sizeof(float));
+                out += sizeof(float);
+            }
+        }
+    }
+    free(quantised);
+    free(negativeZeros);
+    *sz_block = out-block;
+    return block;
+}
+
+static bool decodeBlock(const uint8_t * in, const uint8_t * end, unsigned int numSignals, unsigned int numRecords, float * samples){
+    unsigned int s, i;
+    double divisor;
+    int32_t first;
+    uint16_t numNegativeZeros, index;
+    const uint8_t * negativeZeros;
+    for(s=0;s<numSignals;s++){
+        if(in>=end){
+            return false;
+        }
+        if(*in==BLOCK_MODE_VERBATIM){
+            in++;
+            if((uint64_t)(end-in)<(uint64_t)numRecords*sizeof(float)){
+                return false;
+            }
+            for(i=0;i<numRecords;i++){
+                memcpy(&samples[(size_t)i*numSignals+s],in,sizeof(float));
+                in += sizeof(float);
+            }
+        }
+        else if(*in==BLOCK_MODE_PACKED){
+            in++;
+            if((uint64_t)(end-in)<sizeof(double)+sizeof(int32_t)){
+                return false;
+            }
+            memcpy(&divisor,in,sizeof(double));
+            in += sizeof(double);
+            memcpy(&first,in,sizeof(int32_t));
+            in += sizeof(int32_t);
+            if((uint64_t)(end-in)<sizeof(uint16_t)){
+                return false;
+            }
+            memcpy(&numNegativeZeros,in,sizeof(uint16_t));
+            in += sizeof(uint16_t);
+            negativeZeros = in;
+            if((uint64_t)(end-in)<numNegativeZeros*sizeof(uint16_t)){
+                return false;
+            }
+            in += numNegativeZeros*sizeof(uint16_t);
+            if((in=unpackDeltas(in,end,first,numRecords,samples+s,numSignals,divisor))==NULL){
+                return false;
+            }
+            for(i=0;i<numNegativeZeros;i++){
+                memcpy(&index,negativeZeros+i*sizeof(uint16_t),sizeof(uint16_t));
+                if(index>=numRecords){
+                    return false;
+                }
+                samples[(size_t)index*numSignals+s] = -0.0f;
+            }
+        }
+        else{
+            return false;
+        }
+    }
+    return true;
+}
+
+static unsigned int getBlockRecordCount(const codec_header_t * header, uint32_t b){
+    uint64_t start = (uint64_t)b*header->recordsPerBlock;
+    return (unsigned int)(header->numRecords-start<header->recordsPerBlock ? header->numRecords-start : header->recordsPerBlock);
+}
+
+static void encodeBlockTask(unsigned int b, unsigned int workerIndex, void * userData){
+    encode_job_t * job = (encode_job_t*)userData;
+    uint64_t start = (uint64_t)b*job->recordsPerBlock;
+    unsigned int numRecords = (unsigned int)(job->numRecords-start<job->recordsPerBlock ? job->numRecords-start : job->recordsPerBlock);
+    (void)workerIndex;
+    job->blocks[b] = encodeBlock(job->samples+start*job->numSignals,job->numSignals,numRecords,&job->blockSizes[b]);
+}
+
+static void decodeBlockTask(unsigned int b, unsigned int workerIndex, void * userData){
+    decode_job_t * job = (decode_job_t*)userData;
+    (void)workerIndex;
+    if(!decodeBlock(job->blocks+job->offsets[b],job->blocks+job->offsets[b+1],job->header->numSignals,getBlockRecordCount(job->header,b),
+                    job->samples+(uint64_t)b*job->header->recordsPerBlock*job->header->numSignals)){
+        job->didFail = true;
+    }
+}
+
+// @brief Compresses interleaved samples (numRecords x numSignals).
+// @param numWorkers Threads used to encode blocks; 0 uses every core.
+// @retval Newly allocated payload of *sz_encoded bytes, or NULL on failure.
+uint8_t * encodeRawPayload(const float * samples, unsigned int numSignals, uint64_t numRecords, unsigned int numWorkers, uint64_t * sz_encoded){
+    codec_header_t header;
+    encode_job_t job;
+    uint64_t * offsets, total = 0, numBlocks64 = (numRecords+RAW_CODEC_RECORDS_PER_BLOCK-1)/RAW_CODEC_RECORDS_PER_BLOCK;
+    uint8_t * payload, * out;
+    uint32_t b;
+
+    if(numSignals==0 || numBlocks64>UINT32_MAX){
+        return NULL;
+    }
+    memcpy(header.magic,RAW_CODEC_MAGIC,4);
+    header.version = RAW_CODEC_VERSION;
+    header.numSignals = numSignals;
+    header.recordsPerBlock = RAW_CODEC_RECORDS_PER_BLOCK;
+    header.numRecords = numRecords;
+    header.numBlocks = (uint32_t)numBlocks64;
+    header.reserved = 0;
+
+    job.samples = samples;
+    job.numSignals = numSignals;
+    job.numRecords = numRecords;
+    job.recordsPerBlock = header.recordsPerBlock;
+    job.blocks = calloc(header.numBlocks+1,sizeof(uint8_t*));
+    job.blockSizes = calloc(header.numBlocks+1,sizeof(uint64_t));
+    parallelFor(header.numBlocks,numWorkers ? numWorkers : getNumCores(),encodeBlockTask,&job,NULL);
+
+    offsets = malloc((header.numBlocks+1)*sizeof(uint64_t));
+    for(b=0;b<header.numBlocks;b++){
+        offsets[b] = total;
+        total += job.blockSizes[b];
+    }
+    offsets[header.numBlocks] = total;
+
+    *sz_encoded = sizeof(codec_header_t)+(header.numBlocks+1)*sizeof(uint64_t)+total;
+    payload = malloc(*sz_encoded);
+    if(payload!=NULL){
+        out = payload;
+        memcpy(out,&header,sizeof(codec_header_t));
+        out += sizeof(codec_header_t);
+        memcpy(out,offsets,(header.numBlocks+1)*sizeof(uint64_t));
+        out += (header.numBlocks+1)*sizeof(uint64_t);
+        for(b=0;b<header.numBlocks;b++){
+            memcpy(out,job.blocks[b],job.blockSizes[b]);
+            out += job.blockSizes[b];
+        }
+    }
+    for(b=0;b<header.numBlocks;b++){
+        free(job.blocks[b]);
+    }
+    free(job.blocks);
+    free(job.blockSizes);
+    free(offsets);
+    return payload;
+}
+
+// @brief Validates a payload's codec header and block table.
+bool getEncodedPayloadHeader(const uint8_t * payload, uint64_t sz_payload, codec_header_t * codecHeader){
+    const uint64_t * offsets;
+    uint64_t sz_table, sz_blocks;
+    uint32_t b;
+    if(sz_payload<sizeof(codec_header_t)){
+        return false;
+    }
+    memcpy(codecHeader,payload,sizeof(codec_header_t));
+    if(memcmp(codecHeader->magic,RAW_CODEC_MAGIC,4)!=0 || codecHeader->version!=RAW_CODEC_VERSION || codecHeader->numSignals==0 || codecHeader->recordsPerBlock==0 ||
+       (codecHeader->numRecords+codecHeader->recordsPerBlock-1)/codecHeader->recordsPerBlock!=codecHeader->numBlocks){
+        return false;
+    }
+    sz_table = ((uint64_t)codecHeader->numBlocks+1)*sizeof(uint64_t);
+    if(sz_payload-sizeof(codec_header_t)<sz_table){
+        return false;
+    }
+    sz_blocks = sz_payload-sizeof(codec_header_t)-sz_table;
+    offsets = (const uint64_t*)(payload+sizeof(codec_header_t));
+    for(b=0;b<codecHeader->numBlocks;b++){
+        if(offsets[b]>offsets[b+1]){
+            return false;
+        }
+    }
+    return offsets[0]==0 && offsets[codecHeader->numBlocks]<=sz_blocks;
+}
+
+// @brief Decodes a complete payload into interleaved samples (numRecords x numSignals).
+bool decodeRawPayload(const uint8_t * payload, uint64_t sz_payload, float * samples, unsigned int numWorkers){
+    codec_header_t header;
+    decode_job_t job;
+    if(!getEncodedPayloadHeader(payload,sz_payload,&header)){
+        return false;
+    }
+    job.header = &header;
+    job.offsets = (const uint64_t*)(payload+sizeof(codec_header_t));
+    job.blocks = payload+sizeof(codec_header_t)+((uint64_t)header.numBlocks+1)*sizeof(uint64_t);
+    job.samples = samples;
+    job.didFail = false;
+    parallelFor(header.numBlocks,numWorkers ? numWorkers : getNumCores(),decodeBlockTask,&job,NULL);
+    return !job.didFail;
+}
+
+// @brief Decodes records [startRecord, startRecord+numRecords) touching only the blocks that hold them.
+bool decodeRawRecords(const uint8_t * payload, uint64_t sz_payload, uint64_t startRecord, uint64_t numRecords, float * samples){
+    codec_header_t header;
+    const uint64_t * offsets;
+    const uint8_t * blocks;
+    float * scratch;
+    uint64_t stopRecord = startRecord+numRecords, blockStart, copyStart, copyStop;
+    uint32_t b;
+    unsigned int blockRecords;
+    bool didDecode = true;
+    if(!getEncodedPayloadHeader(payload,sz_payload,&header) || stopRecord>header.numRecords || stopRecord<startRecord){
+        return false;
+    }
+    if(numRecords==0){
+        return true;
+    }
+    offsets = (const uint64_t*)(payload+sizeof(codec_header_t));
+    blocks = payload+sizeof(codec_header_t)+((uint64_t)header.numBlocks+1)*sizeof(uint64_t);
+    scratch = malloc((size_t)header.recordsPerBlock*header.numSignals*sizeof(float));
+    for(b=(uint32_t)(startRecord/header.recordsPerBlock);didDecode && (uint64_t)b*header.recordsPerBlock<stopRecord;b++){
+        blockStart = (uint64_t)b*header.recordsPerBlock;
+        blockRecords = getBlockRecordCount(&header,b);
+        didDecode = decodeBlock(blocks+offsets[b],blocks+offsets[b+1],header.numSignals,blockRecords,scratch);
+        copyStart = startRecord>blockStart ? startRecord : blockStart;
+        copyStop = stopRecord<blockStart+blockRecords ? stopRecord : blockStart+blockRecords;
+        memcpy(samples+(copyStart-startRecord)*header.numSignals,scratch+(copyStart-blockStart)*header.numSignals,(copyStop-copyStart)*header.numSignals*sizeof(float));
+    }
+    free(scratch);
+    return didDecode;
+}
+
+// @brief Decodes one block, given its bytes [block, block+sz_block), for callers that stream
+// blocks from disk rather than holding the whole payload (see rawstream.c).
+bool decodeRawBlock(const uint8_t * block, uint64_t sz_block, const codec_header_t * codecHeader, uint32_t blockIndex, float * samples){
+    if(blockIndex>=codecHeader->numBlocks){
+        return false;
+    }
+    return decodeBlock(block,block+sz_block,codecHeader->numSignals,getBlockRecordCount(codecHeader,blockIndex),samples);
+}
+
+/***************
+ *  Padaco .bin files
+ ***************/
+bool isCompressedBinHeader(const bin_header_t * header){
+    return header->sz_per_signal==RAW_CODEC_SZ_PER_SIGNAL;
+}
+
+// @brief Writes header and compressed payload.  The header's sz_per_signal and
+// sz_remaining fields are updated to describe the compressed payload.
+bool writeCompressedBin(FILE * fid, bin_header_t * header, const float * samples, uint64_t numRecords, unsigned int numWorkers){
+    uint64_t sz_encoded = 0;
+    uint8_t * payload = encodeRawPayload(samples,header->num_signals,numRecords,numWorkers,&sz_encoded);
+    bool didWrite;
+    if(payload==NULL){
+        fprintf(stderr,"Unable to compress the binary data records.\n");
+        return false;
+    }
+    header->sz_per_signal = RAW_CODEC_SZ_PER_SIGNAL;
+    header->sz_remaining = sz_encoded;
+    didWrite = fwrite(header,sizeof(bin_header_t),1,fid)==1 && fwrite(payload,sz_encoded,1,fid)==1;
+    if(!didWrite){
+        fprintf(stderr,"Incomplete streaming of compressed binary data (did not write all %llu bytes).\n",(unsigned long long)sz_encoded);
+    }
+    free(payload);
+    return didWrite;
+}
+
+// @brief Reads and decodes the compressed payload that follows a bin_header_t.
+// @retval Interleaved samples (recordCount x header->num_signals), or NULL on failure.
+float * loadCompressedBinPayload(FILE * fid, const bin_header_t * header, unsigned int * recordCount, unsigned int numWorkers){
+    codec_header_t codecHeader;
+    uint8_t * payload = malloc(header->sz_remaining>0 ? header->sz_remaining : 1);
+    float * samples = NULL;
+    *recordCount = 0;
+    if(fread(payload,header->sz_remaining,1,fid)!=1 || !getEncodedPayloadHeader(payload,header->sz_remaining,&codecHeader) || codecHeader.numRecords>UINT32_MAX){
+        fprintf(stderr,"Compressed payload is incomplete or corrupted.\n");
+    }
+    else{
+        samples = malloc((size_t)codecHeader.numRecords*codecHeader.numSignals*sizeof(float)+1);
+        if(decodeRawPayload(payload,header->sz_remaining,samples,numWorkers)){
+            *recordCount = (unsigned int)codecHeader.numRecords;
+        }
+        else{
+            fprintf(stderr,"Compressed payload is corrupted.\n");
+            free(samples);
+            samples = NULL;
+        }
+    }
+    free(payload);
+    return samples;
+}
@@ -0,0 +1,62 @@
+//
+//  rawcodec.h
+//  Lossless compression of raw acceleration payloads.
+//
+//  Samples are mapped back onto the integer grid they were recorded on (e.g. 1/341 g steps
+//  from the device or 1/1000 g from three decimal .csv exports), delta and zig-zag encoded
+//  per signal, and bit-packed in mini blocks of RAW_CODEC_MINIBLOCK values.  The payload is
+//  cut into blocks of recordsPerBlock records that decode independently, so blocks can be
+//  decoded in parallel or individually for random access.  A block whose values do not sit
+//  exactly on any known grid is stored verbatim, so decoding is always bit exact.
+//
+//  Payload layout (little endian):
+//      codec_header_t
+//      uint64_t blockOffsets[numBlocks+1]   byte offsets from the end of the offset table
+//      blocks, each holding numSignals streams of either
+//          uint8_t mode (0), double divisor, int32_t first value, uint16_t negative zero count,
+//          uint16_t negative zero positions, then per mini block a uint8_t bit width and the
+//          packed zig-zag deltas
+//      or
+//          uint8_t mode (1), float values
+//
+//  A Padaco .bin file carrying a compressed payload sets bin_header_t.sz_per_signal to
+//  RAW_CODEC_SZ_PER_SIGNAL (0) and sz_remaining to the size of the compressed payload.
+//
+
+#ifndef in_rawcodec_h
+#define in_rawcodec_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "rawtools.h"
+
+#define RAW_CODEC_MAGIC "PZC1"
+#define RAW_CODEC_VERSION 1
+#define RAW_CODEC_SZ_PER_SIGNAL 0
+#define RAW_CODEC_RECORDS_PER_BLOCK 4096
+#define RAW_CODEC_MINIBLOCK 128
+
+#pragma pack(push,1)
+typedef struct codec_header_t{
+    char magic[4];
+    uint32_t version;
+    uint32_t numSignals;
+    uint32_t recordsPerBlock;
+    uint64_t numRecords;
+    uint32_t numBlocks;
+    uint32_t reserved;
+} codec_header_t;
+#pragma pack(pop)
+
+uint8_t * encodeRawPayload(const float * samples, unsigned int numSignals, uint64_t numRecords, unsigned int numWorkers, uint64_t * sz_encoded);
+bool getEncodedPayloadHeader(const uint8_t * payload, uint64_t sz_payload, codec_header_t * codecHeader);
+bool decodeRawPayload(const uint8_t * payload, uint64_t sz_payload, float * samples, unsigned int numWorkers);
+bool decodeRawRecords(const uint8_t * payload, uint64_t sz_payload, uint64_t startRecord, uint64_t numRecords, float * samples);
+bool decodeRawBlock(const uint8_t * block, uint64_t sz_block, const codec_header_t * codecHeader, uint32_t blockIndex, float * samples);
+
+bool isCompressedBinHeader(const bin_header_t * header);
+bool writeCompressedBin(FILE * fid, bin_header_t * header, const float * samples, uint64_t numRecords, unsigned int numWorkers);
+float * loadCompressedBinPayload(FILE * fid, const bin_header_t * header, unsigned int * recordCount, unsigned int numWorkers);
+
+#endif /* in_rawcodec_h */
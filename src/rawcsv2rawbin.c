@@ -1,11 +1,197 @@
-// gcc rawcsv2rawbin.c in_system.c rawtools.c tictoc.c -o rawcsv2rawbin
+// gcc rawcsv2rawbin.c in_system.c rawtools.c rawcodec.c in_parallel.c tictoc.c prefilter.c framefeatures.c rawfollow.c calibrate.c epochsummary.c -lm -lpthread -o rawcsv2rawbin
+#include <unistd.h> // for getopt
+#include <sys/stat.h>
 #include "rawtools.h"
 #include "tictoc.h"
 #include "in_system.h"
+#include "prefilter.h"
+#include "rawcodec.h"
+#include "rawfollow.h"
+#include "calibrate.h"
+#include "epochsummary.h"
+
+#define FILTER_BLOCK_SIZE 4096
+
+typedef struct{
+    prefilter_method_t method;
+    double windowSec;
+    double lowHz;
+    double highHz;
+    bool compress;
+    double followSec;   // < 0 converts closed files; otherwise see followFile
+    bool calibrate;
+    bool summarize;     // write a per second summary sidecar (see epochsummary.h)
+    double clipG;
+} convert_options_t;
 
 void printUsage(char * programName){
-    fprintf(stdout,"Usage: %s <raw accelerations .csv filename> <raw accelerations .bin filename>\n",programName);   
-    fprintf(stdout,"Usage: %s <pathname containing raw .csv files> <pathname to place raw .bin files>\n",programName);
+    fprintf(stdout,"Usage: %s [options] <raw accelerations .csv filename> <raw accelerations .bin filename>\n",programName);   
+    fprintf(stdout,"Usage: %s [options] <pathname containing raw .csv files> <pathname to place raw .bin files>\n",programName);
+    fprintf(stdout,"Options:\n"
+            "  -f <method>     Also write a prefiltered copy (<name>.<method>.bin): rms, sum, median, mean, lowpass or bandpass\n"
+            "  -w <seconds>    Window duration for the rms, sum, median and mean prefilters.  Default: 1\n"
+            "  -c <low,high>   Cutoff frequencies (Hz); lowpass uses <high>.  Default: 0.25,2.5\n"
+            "  -z              Write compressed payloads (see rawbinpack)\n"
+            "  -k              Auto-calibrate accelerations against gravity (see calibrate.h); the fit is stored after the payload.\n"
+            "                  Not with -z: calibrated samples are off the recording's sample grid and would be stored\n"
+            "                  verbatim, larger than an uncompressed file.\n"
+            "  -e              Also write a per second summary (<name>%s) of the samples written (see epochsummary.h)\n"
+            "  -g <g>          Acceleration counted as clipped by -e.  Default: %0.2f\n"
+            "  -t <seconds>    Follow a growing .csv file: append the rows written since the last run to the .bin file,\n"
+            "                  then repeat every <seconds> (0 appends once).  Single files only; not with -f, -z, -k or -e.\n",
+            EPOCH_SUMMARY_EXTENSION,EPOCH_DEFAULT_CLIP_G);
+}
+
+static bool writeBinFile(const char * rawBinFilename, csv_header_t * csvFileHeader, float * accelerations, unsigned int rowCount, const calibration_t * calibration, convert_options_t * options){
+    bin_header_t binFileHeader;
+    bool didWrite = false;
+    FILE * binFID = fopen(rawBinFilename,"wb");
+    if(binFID==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",rawBinFilename);
+        return false;
+    }
+    if(options->compress){
+        csvHeader2binHeader(csvFileHeader,&binFileHeader);
+        didWrite = writeCompressedBin(binFID,&binFileHeader,accelerations,rowCount,0);
+    }
+    else{
+        didWrite = write2bin(binFID,csvFileHeader,accelerations);
+    }
+    if(didWrite && calibration!=NULL){
+        didWrite = writeCalibrationTrailer(binFID,calibration);
+    }
+    fclose(binFID);
+    return didWrite;
+}
+
+// Runs x, y and z through their own streaming filter in blocks, so the filtered copy is
+// produced from the same parse as the unfiltered .bin file.
+static bool writeFilteredBin(const char * rawBinFilename, csv_header_t * csvFileHeader, const float * accelerations, unsigned int rowCount, const calibration_t * calibration, convert_options_t * options){
+    prefilter_t * filters[3] = {NULL};
+    float * filtered, block[FILTER_BLOCK_SIZE];
+    unsigned int axis, start, i, blockSize;
+    bool didWrite = false;
+    char * filteredFilename, * extension;
+
+    for(axis=0;axis<3;axis++){
+        filters[axis] = createPrefilter(options->method,(unsigned int)(options->windowSec*csvFileHeader->samplerate+0.5),csvFileHeader->samplerate,options->lowHz,options->highHz);
+        if(filters[axis]==NULL){
+            fprintf(stderr,"Invalid %s prefilter settings for a %u Hz signal.\n",PREFILTER_NAMES[options->method],csvFileHeader->samplerate);
+            for(i=0;i<axis;i++){
+                freePrefilter(filters[i]);
+            }
+            return false;
+        }
+    }
+    filtered = malloc((size_t)rowCount*3*sizeof(float));
+    for(start=0;start<rowCount;start+=FILTER_BLOCK_SIZE){
+        blockSize = rowCount-start<FILTER_BLOCK_SIZE ? rowCount-start : FILTER_BLOCK_SIZE;
+        for(axis=0;axis<3;axis++){
+            for(i=0;i<blockSize;i++){
+                block[i] = accelerations[3*(start+i)+axis];
+            }
+            prefilterBlock(filters[axis],block,blockSize,block);
+            for(i=0;i<blockSize;i++){
+                filtered[3*(start+i)+axis] = block[i];
+            }
+        }
+    }
+
+    filteredFilename = malloc(strlen(rawBinFilename)+strlen(PREFILTER_NAMES[options->method])+6);
+    strcpy(filteredFilename,rawBinFilename);
+    if((extension=strrchr(filteredFilename,'.'))!=NULL && strchr(extension,'/')==NULL){
+        *extension = '\0';
+    }
+    sprintf(filteredFilename+strlen(filteredFilename),".%s.bin",PREFILTER_NAMES[options->method]);
+    didWrite = writeBinFile(filteredFilename,csvFileHeader,filtered,rowCount,calibration,options);
+    for(axis=0;axis<3;axis++){
+        freePrefilter(filters[axis]);
+    }
+    free(filteredFilename);
+    free(filtered);
+    return didWrite;
+}
+
+static double time2datenum(time_t time){
+    struct tm localTime = *localtime(&time);
+    return wallclock2datenum((double)tm2wallclock(&localTime));
+}
+
+// Summarizes the samples as written to the .bin file, i.e. after any calibration.
+static bool writeEpochSidecar(const char * rawBinFilename, csv_header_t * csvFileHeader, const float * accelerations, unsigned int rowCount, convert_options_t * options){
+    epoch_summarizer_t * summarizer;
+    char sidecarFilename[FILENAME_MAX];
+    struct stat binStat;
+    bool didWrite;
+    if(stat(rawBinFilename,&binStat)!=0 || !getEpochSummaryFilename(rawBinFilename,sidecarFilename,sizeof(sidecarFilename)) ||
+       (summarizer=createEpochSummarizer(csvFileHeader->samplerate,options->clipG))==NULL){
+        fprintf(stderr,"Could not summarize %s\n",rawBinFilename);
+        return false;
+    }
+    addEpochSamples(summarizer,accelerations,rowCount);
+    didWrite = writeEpochSummary(sidecarFilename,summarizer,time2datenum(csvFileHeader->start),(uint64_t)binStat.st_size,time2datenum(binStat.st_mtime));
+    freeEpochSummarizer(summarizer);
+    return didWrite;
+}
+
+// Appends new rows of a .csv that is still being written; see rawfollow.h.
+static bool followFile(const char * rawCSVFilename, const char * rawBinFilename, double followSec){
+    raw_follow_result_t result;
+    do{
+        if(!followRawCSVFile(rawCSVFilename,rawBinFilename,&result)){
+            return false;
+        }
+        if(result.restarted || result.numNewRecords>0){
+            printf("%s%llu records appended (%llu total)\n",result.restarted ? "Started .bin file.  " : "",
+                   (unsigned long long)result.numNewRecords,(unsigned long long)result.numRecords);
+            fflush(stdout);
+        }
+        if(followSec>0){
+            usleep((useconds_t)(followSec*1e6));
+        }
+    } while(followSec>0);
+    return true;
+}
+
+static bool convertFile(char * rawCSVFilename, char * rawBinFilename, convert_options_t * options){
+    csv_header_t csvFileHeader;
+    unsigned int rowCount = 0;
+    float * accelerations;
+    bool didWrite = false;
+    calibrator_t * calibrator;
+    calibration_t calibration;
+    if(options->method==PREFILTER_NONE && !options->compress && !options->calibrate && !options->summarize){
+        return writeRaw2Bin(rawCSVFilename,rawBinFilename);
+    }
+    accelerations = parseRawCSVFile(rawCSVFilename,&csvFileHeader,true,&rowCount);
+    if(accelerations==NULL){
+        return false;
+    }
+    if(options->calibrate){
+        // Still windows are gathered in one pass over the parsed samples, which are then
+        // corrected in place before anything is written.
+        calibrator = createCalibrator(csvFileHeader.samplerate,0,0);
+        if(calibrator==NULL){
+            free(accelerations);
+            return false;
+        }
+        addCalibrationSamples(calibrator,accelerations,NULL,rowCount);
+        if(fitCalibration(calibrator,&calibration)){
+            applyCalibration(&calibration,accelerations,NULL,rowCount);
+        }
+        printf("Calibration %s: %u still windows, error %0.4f g -> %0.4f g\n",calibration.didCalibrate ? "applied" : "not applied",
+               calibration.numWindows,calibration.errorBefore,calibration.errorAfter);
+        freeCalibrator(calibrator);
+    }
+    didWrite = writeBinFile(rawBinFilename,&csvFileHeader,accelerations,rowCount,options->calibrate ? &calibration : NULL,options);
+    if(didWrite && options->summarize){
+        didWrite = writeEpochSidecar(rawBinFilename,&csvFileHeader,accelerations,rowCount,options);
+    }
+    if(didWrite && options->method!=PREFILTER_NONE){
+        didWrite = writeFilteredBin(rawBinFilename,&csvFileHeader,accelerations,rowCount,options->calibrate ? &calibration : NULL,options);
+    }
+    free(accelerations);
+    return didWrite;
 }
 
 int main(int argc, char * argv[]){
@@ -16,11 +202,59 @@ int main(int argc, char * argv[]){
     in_file_structPtr fileStructPtr;
     int fileCount = 0, skipCount=0;
     double timeElapsed=0;
-    if(argc==3){
-        srcPathOrFile = argv[1];
-        destPathOrFile = argv[2];
-        dir = opendir(srcPathOrFile);
-        if(dir!=NULL){
+    convert_options_t filterOptions = {PREFILTER_NONE,1,0.25,2.5,false,-1,false,false,EPOCH_DEFAULT_CLIP_G};
+    int opt;
+    while((opt=getopt(argc,argv,"f:w:c:zket:g:"))!=-1){
+        switch(opt){
+            case 'f':
+                filterOptions.method = getPrefilterMethod(optarg);
+                break;
+            case 'w':
+                filterOptions.windowSec = atof(optarg);
+                break;
+            case 'z':
+                filterOptions.compress = true;
+                break;
+            case 'k':
+                filterOptions.calibrate = true;
+                break;
+            case 'e':
+                filterOptions.summarize = true;
+                break;
+            case 'g':
+                filterOptions.clipG = atof(optarg);
+                break;
+            case 't':
+                filterOptions.followSec = atof(optarg);
+                break;
+            case 'c':
+                if(sscanf(optarg,"%lf,%lf",&filterOptions.lowHz,&filterOptions.highHz)!=2){
+                    filterOptions.method = PREFILTER_UNKNOWN;
+                }
+                break;
+            default:
+                filterOptions.method = PREFILTER_UNKNOWN;
+                break;
+        }
+    }
+    if(filterOptions.method==PREFILTER_UNKNOWN || (filterOptions.calibrate && filterOptions.compress) ||
+       (filterOptions.followSec>=0 && (filterOptions.method!=PREFILTER_NONE || filterOptions.compress || filterOptions.calibrate || filterOptions.summarize))){
+        printUsage(argv[0]);
+        return -1;
+    }
+    if(argc-optind==2){
+        srcPathOrFile = argv[optind];
+        destPathOrFile = argv[optind+1];
+        dir = filterOptions.followSec>=0 ? NULL : opendir(srcPathOrFile);
+        if(filterOptions.followSec>=0){
+            if(followFile(srcPathOrFile,destPathOrFile,filterOptions.followSec)){
+                shouldPrintUsage = false;
+            }
+            else{
+                fprintf(stderr,"FAIL\n");
+            }
+        }
+        else if(dir!=NULL){
             srcPath = srcPathOrFile;
             destPath = is_dir(destPathOrFile)?destPathOrFile:srcPath;
             // process files
@@ -41,7 +275,7 @@ int main(int argc, char * argv[]){
                     destFilename = fullfile(destPath,fileStructPtr->filename);
                     tic();
                     printf("%s --> %s\n",srcFilename,destFilename);                    
-                    if(writeRaw2Bin(srcFilename,destFilename)){
+                    if(convertFile(srcFilename,destFilename,&filterOptions)){
                         printf("File %i completed (%s):\t",++fileCount,entry->d_name);
                     }
                     else{
@@ -62,7 +296,7 @@ int main(int argc, char * argv[]){
         }
         else{
             tic();
-            if(writeRaw2Bin(srcFilename=srcPathOrFile, destFilename=destPathOrFile)){
+            if(convertFile(srcFilename=srcPathOrFile, destFilename=destPathOrFile, &filterOptions)){
                 printToc();
                 shouldPrintUsage = false;
             }
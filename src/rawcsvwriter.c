@@ -0,0 +1,366 @@
+//
+//  rawcsvwriter.c
+//  Writes raw accelerations as an ActiLife raw .csv export.  See rawcsvwriter.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "rawcsvwriter.h"
+#include "rawtools.h"
+#include "in_parallel.h"
+
+#define SZ_WRITE_BUFFER (1<<20)
+#define BLOCKS_PER_WORKER 2
+#define SZ_STAMP 32
+#define SZ_RAW_CSV_NUMBER 336     // "%0.3f" of the largest double
+#define SZ_RAW_CSV_ROW (SZ_STAMP+3*SZ_RAW_CSV_NUMBER+8)
+#define SZ_TYPICAL_ROW 48
+
+// "mm/dd/yyyy HH:MM:SS" of a wall clock second
+typedef struct{
+    int64_t second;
+    int length;
+    char text[SZ_STAMP];
+} stamp_t;
+
+typedef struct{
+    char * text;
+    size_t length;
+    size_t capacity;
+} text_block_t;
+
+typedef struct{
+    const raw_csv_source_t * source;
+    bool exportTimestamp;
+    int64_t firstTick;          // samples from the source's first sample to the first row
+    uint64_t numRows;
+    int64_t startSecond;        // whole wall clock second of the source's first sample
+    unsigned int * milliseconds;    // of each sample of a second, from startSecond
+    uint64_t firstBlock;
+    text_block_t * blocks;
+} rows_job_t;
+
+void initRawCSVOptions(raw_csv_options_t * options){
+    memset(options,0,sizeof(raw_csv_options_t));
+    options->includeHeader = true;
+}
+
+bool isActiLifeVersionLessThan(const char * version, const char * otherVersion){
+    int numbers[2][3] = {{0}}, n;
+    const char * versions[2] = {version,otherVersion};
+    for(n=0;n<2;n++){
+        if(versions[n][0]=='v' || versions[n][0]=='V'){
+            versions[n]++;
+        }
+        sscanf(versions[n],"%d.%d.%d",&numbers[n][0],&numbers[n][1],&numbers[n][2]);
+    }
+    for(n=0;n<3;n++){
+        if(numbers[0][n]!=numbers[1][n]){
+            return numbers[0][n]<numbers[1][n];
+        }
+    }
+    return false;
+}
+
+void resolveRawCSVOptions(raw_csv_options_t * options){
+    if(options->actilifeVersion[0]=='\0'){
+        strncpy(options->actilifeVersion,options->exportTimestamp ? RAW_CSV_DEFAULT_TIMESTAMP_VERSION : RAW_CSV_DEFAULT_VERSION,SZ_RAW_CSV_VERSION-1);
+    }
+    else{
+        options->exportTimestamp = isActiLifeVersionLessThan(options->actilifeVersion,RAW_CSV_TIMESTAMP_VERSION);
+    }
+}
+
+int formatActigraphRawHeader(char * text, size_t sz_text, int64_t startWallclock, uint16_t samplerate, const raw_csv_options_t * options){
+    char serialNumber[SZ_SERIALID+8], downloadTime[16], downloadDate[16];
+    struct tm start, now;
+    time_t nowTimer = time(NULL);
+    int length;
+
+    localtime_r(&nowTimer,&now);
+    wallclock2tm(startWallclock,&start);
+    strftime(downloadTime,sizeof(downloadTime),"%H:%M:%S",&now);
+    strftime(downloadDate,sizeof(downloadDate),"%m/%d/%Y",&now);
+    if(options->serialNumber!=NULL){
+        snprintf(serialNumber,sizeof(serialNumber),"%s",options->serialNumber);
+    }
+    else{
+        strftime(serialNumber,sizeof(serialNumber),"NEO1C15%y%m%d",&now);
+    }
+    length = snprintf(text,sz_text,
+                      "------------ Data File Created By ActiGraph GT3X+ ActiLife %s Firmware %s date format M/d/yyyy at %u Hz  Filter Normal -----------\n"
+                      "Serial Number: %s\n"
+                      "Start Time %02d:%02d:%02d\n"
+                      "Start Date %02d/%02d/%04d\n"
+                      "Epoch Period (hh:mm:ss) 00:00:00\n"
+                      "Download Time %s\n"
+                      "Download Date %s\n"
+                      "Current Memory Address: 0\n"
+                      "Current Battery Voltage: 3.9     Mode = 12\n"
+                      "--------------------------------------------------\n"
+                      "%s\n",
+                      options->actilifeVersion,options->firmware!=NULL ? options->firmware : RAW_CSV_DEFAULT_FIRMWARE,samplerate,
+                      serialNumber,start.tm_hour,start.tm_min,start.tm_sec,start.tm_mon+1,start.tm_mday,start.tm_year+1900,
+                      downloadTime,downloadDate,
+                      isActiLifeVersionLessThan(options->actilifeVersion,RAW_CSV_TIMESTAMP_VERSION) ? "Timestamp,Axis1,Axis2,Axis3" : "Accelerometer X,Accelerometer Y,Accelerometer Z");
+    return length>=0 && (size_t)length<sz_text ? length : -1;
+}
+
+static void setStamp(stamp_t * stamp, int64_t second){
+    struct tm timeStruct;
+    wallclock2tm(second,&timeStruct);
+    stamp->second = second;
+    stamp->length = snprintf(stamp->text,SZ_STAMP,"%02d/%02d/%04d %02d:%02d:%02d",timeStruct.tm_mon+1,timeStruct.tm_mday,
+                             timeStruct.tm_year+1900,timeStruct.tm_hour,timeStruct.tm_min,timeStruct.tm_sec);
+}
+
+// Carries one second through the seconds, minutes and hours digits; the date is
+// reformatted at midnight only.
+static void advanceStamp(stamp_t * stamp){
+    char * hhmmss = stamp->text+stamp->length-8;
+    stamp->second++;
+    if(++hhmmss[7]<='9'){
+        return;
+    }
+    hhmmss[7] = '0';
+    if(++hhmmss[6]<'6'){
+        return;
+    }
+    hhmmss[6] = '0';
+    if(++hhmmss[4]<='9'){
+        return;
+    }
+    hhmmss[4] = '0';
+    if(++hhmmss[3]<'6'){
+        return;
+    }
+    hhmmss[3] = '0';
+    if(hhmmss[0]=='2' && hhmmss[1]=='3'){
+        setStamp(stamp,stamp->second);
+    }
+    else if(++hhmmss[1]>'9'){
+        hhmmss[1] = '0';
+        hhmmss[0]++;
+    }
+}
+
+static int64_t floorDivide(int64_t numerator, int64_t denominator){
+    int64_t quotient = numerator/denominator;
+    return quotient*denominator>numerator ? quotient-1 : quotient;
+}
+
+// "%0.3f" of value; values are scaled exactly for floats, so ties round to even as printf does.
+static int formatThousandths(double value, char * text){
+    char digits[24];
+    double scaled;
+    uint64_t whole;
+    unsigned int thousandths;
+    int length = 0, numDigits = 0;
+    if(isnan(value)){
+        memcpy(text,"NaN",3);
+        return 3;
+    }
+    scaled = nearbyint(fabs(value)*1000.0);
+    if(!(scaled<1e18)){
+        return isinf(value) ? snprintf(text,SZ_RAW_CSV_NUMBER,value<0 ? "-Inf" : "Inf") : snprintf(text,SZ_RAW_CSV_NUMBER,"%0.3f",value);
+    }
+    if(signbit(value)){
+        text[length++] = '-';
+    }
+    whole = (uint64_t)scaled;
+    thousandths = (unsigned int)(whole%1000);
+    whole /= 1000;
+    do{
+        digits[numDigits++] = (char)('0'+whole%10);
+        whole /= 10;
+    } while(whole>0);
+    while(numDigits>0){
+        text[length++] = digits[--numDigits];
+    }
+    text[length++] = '.';
+    text[length++] = (char)('0'+thousandths/100);
+    text[length++] = (char)('0'+thousandths/10%10);
+    text[length++] = (char)('0'+thousandths%10);
+    return length;
+}
+
+static double getSample(const raw_csv_source_t * source, unsigned int axis, uint64_t record){
+    size_t index = (size_t)record*source->stride;
+    return source->isDouble ? ((const double *)source->axes[axis])[index] : (double)((const float *)source->axes[axis])[index];
+}
+
+static void formatRowsBlock(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    rows_job_t * job = (rows_job_t*)userData;
+    const raw_csv_source_t * source = job->source;
+    text_block_t * block = &job->blocks[taskIndex];
+    uint64_t row = (job->firstBlock+taskIndex)*RAW_CSV_ROWS_PER_BLOCK, lastRow = row+RAW_CSV_ROWS_PER_BLOCK;
+    int64_t tick = job->firstTick+(int64_t)row, second = floorDivide(tick,source->samplerate);
+    unsigned int subsample = (unsigned int)(tick-second*source->samplerate), milliseconds, axis;
+    stamp_t stamps[2];
+    char * text;
+    (void)workerIndex;
+
+    if(lastRow>job->numRows){
+        lastRow = job->numRows;
+    }
+    // one calendar conversion per block; stamps[1] is the next second, for milliseconds
+    // past the end of the sample's second (sub-second starts)
+    if(job->exportTimestamp){
+        setStamp(&stamps[0],job->startSecond+second);
+        stamps[1] = stamps[0];
+        advanceStamp(&stamps[1]);
+    }
+    if(block->capacity<(lastRow-row)*SZ_TYPICAL_ROW+SZ_RAW_CSV_ROW){
+        block->capacity = (lastRow-row)*SZ_TYPICAL_ROW+SZ_RAW_CSV_ROW;
+        block->text = realloc(block->text,block->capacity);
+    }
+    block->length = 0;
+    for(;row<lastRow;row++,tick++){
+        if(block->length+SZ_RAW_CSV_ROW>block->capacity){
+            block->capacity *= 2;
+            block->text = realloc(block->text,block->capacity);
+        }
+        text = block->text+block->length;
+        if(job->exportTimestamp){
+            milliseconds = job->milliseconds[subsample];
+            if(milliseconds>=1000){
+                memcpy(text,stamps[1].text,(size_t)stamps[1].length);
+                text += stamps[1].length;
+                milliseconds -= 1000;
+            }
+            else{
+                memcpy(text,stamps[0].text,(size_t)stamps[0].length);
+                text += stamps[0].length;
+            }
+            *text++ = '.';
+            *text++ = (char)('0'+milliseconds/100);
+            *text++ = (char)('0'+milliseconds/10%10);
+            *text++ = (char)('0'+milliseconds%10);
+            *text++ = ',';
+            if(++subsample==source->samplerate){
+                subsample = 0;
+                stamps[0] = stamps[1];
+                advanceStamp(&stamps[1]);
+            }
+        }
+        if(tick<0 || (uint64_t)tick>=source->numRecords){
+            memcpy(text,"0,0,0\n",6);
+            text += 6;
+        }
+        else{
+            for(axis=0;axis<3;axis++){
+                text += formatThousandths(getSample(source,axis,(uint64_t)tick),text);
+                *text++ = axis<2 ? ',' : '\n';
+            }
+        }
+        block->length = (size_t)(text-block->text);
+    }
+}
+
+bool writeActigraphRawRows(FILE * fid, const raw_csv_source_t * source, const raw_csv_options_t * options, unsigned int numWorkers, uint64_t * numRowsWritten){
+    raw_csv_options_t resolved = *options;
+    rows_job_t job;
+    char header[SZ_RAW_CSV_HEADER];
+    int64_t lastTick, firstSecond;
+    uint64_t numBlocks;
+    unsigned int blocksPerBatch, numInBatch, b, startMilliseconds;
+    bool didWrite = true;
+    int length;
+
+    *numRowsWritten = 0;
+    if(source->samplerate==0){
+        fprintf(stderr,"No sample rate given for the raw .csv export\n");
+        return false;
+    }
+    resolveRawCSVOptions(&resolved);
+    if(resolved.serialNumber==NULL && source->serialID!=NULL && source->serialID[0]!='\0'){
+        resolved.serialNumber = source->serialID;
+    }
+    job.source = source;
+    job.exportTimestamp = resolved.exportTimestamp;
+    job.firstTick = resolved.hasStart ? llround((resolved.start-source->start)*source->samplerate) : 0;
+    lastTick = resolved.hasStop ? llround((resolved.stop-source->start)*source->samplerate) : (int64_t)source->numRecords-1;
+    job.numRows = lastTick>=job.firstTick ? (uint64_t)(lastTick-job.firstTick+1) : 0;
+
+    // Milliseconds past startSecond of each sample of a second, rounded half up; a source
+    // starting past a whole second carries into the next second.
+    job.startSecond = (int64_t)floor(source->start);
+    startMilliseconds = (unsigned int)llround((source->start-(double)job.startSecond)*1000);
+    if(startMilliseconds>=1000){
+        job.startSecond++;
+        startMilliseconds -= 1000;
+    }
+    job.milliseconds = malloc(source->samplerate*sizeof(unsigned int));
+    for(b=0;b<source->samplerate;b++){
+        job.milliseconds[b] = startMilliseconds+(2000u*b+source->samplerate)/(2u*source->samplerate);
+    }
+
+    if(resolved.includeHeader){
+        firstSecond = job.startSecond+floorDivide(job.firstTick,source->samplerate);
+        if(job.milliseconds[(unsigned int)(job.firstTick-floorDivide(job.firstTick,source->samplerate)*source->samplerate)]>=1000){
+            firstSecond++;
+        }
+        length = formatActigraphRawHeader(header,sizeof(header),firstSecond,source->samplerate,&resolved);
+        didWrite = length>0 && fwrite(header,1,(size_t)length,fid)==(size_t)length;
+    }
+
+    // A batch of blocks is formatted in parallel and then written in order, which bounds
+    // the text held in memory to the batch.
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    numBlocks = (job.numRows+RAW_CSV_ROWS_PER_BLOCK-1)/RAW_CSV_ROWS_PER_BLOCK;
+    blocksPerBatch = numWorkers*BLOCKS_PER_WORKER;
+    job.blocks = calloc(blocksPerBatch,sizeof(text_block_t));
+    for(job.firstBlock=0;job.firstBlock<numBlocks && didWrite;job.firstBlock+=numInBatch){
+        numInBatch = numBlocks-job.firstBlock<blocksPerBatch ? (unsigned int)(numBlocks-job.firstBlock) : blocksPerBatch;
+        parallelFor(numInBatch,numWorkers,formatRowsBlock,&job,NULL);
+        for(b=0;b<numInBatch && didWrite;b++){
+            didWrite = fwrite(job.blocks[b].text,1,job.blocks[b].length,fid)==job.blocks[b].length;
+        }
+        if(didWrite){
+            *numRowsWritten = (job.firstBlock+numInBatch)*RAW_CSV_ROWS_PER_BLOCK<job.numRows ? (job.firstBlock+numInBatch)*RAW_CSV_ROWS_PER_BLOCK : job.numRows;
+        }
+    }
+    for(b=0;b<blocksPerBatch;b++){
+        free(job.blocks[b].text);
+    }
+    free(job.blocks);
+    free(job.milliseconds);
+    return didWrite;
+}
+
+bool exportActigraphRawCSV(const char * rawFilename, const char * csvFilename, const raw_csv_options_t * options, unsigned int numWorkers, uint64_t * numRowsWritten){
+    raw_info_t info;
+    raw_csv_source_t source;
+    float * accelerations;
+    bool didWrite;
+    FILE * fid;
+
+    *numRowsWritten = 0;
+    if((accelerations=loadRawAccelerations(rawFilename,&info))==NULL){
+        return false;
+    }
+    if((fid=fopen(csvFilename,options->includeHeader ? "wb" : "ab"))==NULL){
+        fprintf(stderr,"Could not open file for writing: %s\n",csvFilename);
+        free(accelerations);
+        return false;
+    }
+    setvbuf(fid,NULL,_IOFBF,SZ_WRITE_BUFFER);
+    source.axes[0] = accelerations;
+    source.axes[1] = accelerations+1;
+    source.axes[2] = accelerations+2;
+    source.stride = 3;
+    source.isDouble = false;
+    source.numRecords = info.recordCount;
+    source.samplerate = info.samplerate;
+    source.start = (double)info.start;
+    source.serialID = info.serialID;
+    didWrite = writeActigraphRawRows(fid,&source,options,numWorkers,numRowsWritten);
+    didWrite = fclose(fid)==0 && didWrite;
+    free(accelerations);
+    return didWrite;
+}
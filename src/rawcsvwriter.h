@@ -0,0 +1,76 @@
+//
+//  rawcsvwriter.h
+//  Writes raw accelerations as an ActiLife raw .csv export (the inverse of rawcsv2rawbin),
+//  as PASensorData.writeActigraphRawCSV does, for MIMS and other tools that read ActiLife
+//  files.
+//
+//  The file starts with the 10 line ActiLife header and column names of
+//  utility/generateActigraphRawHeader.m, followed by one "x,y,z" row per sample, each value
+//  with three decimals as "%0.3f" writes it.  Exports for ActiLife versions before v6.12.0
+//  lead each row with a "mm/dd/yyyy HH:MM:SS.FFF" timestamp.  Timestamps are not converted
+//  from a calendar time per row: the milliseconds of each sample within its second are
+//  tabulated once, and the date and time text is carried forward a second at a time, with
+//  a calendar conversion only at midnight and at the start of each block of rows.
+//
+//  Rows lie on the sample grid of the recording.  A start before the first sample or a stop
+//  after the last is filled with rows of zeros, as ActiLife fills time the device was not
+//  recording.  Rows are formatted in blocks across worker threads and written in order.
+//
+
+#ifndef in_rawcsvwriter_h
+#define in_rawcsvwriter_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define RAW_CSV_TIMESTAMP_VERSION "v6.12.0"   // ActiLife exports before it carry timestamps
+#define RAW_CSV_DEFAULT_VERSION "v6.13.3"
+#define RAW_CSV_DEFAULT_TIMESTAMP_VERSION "v6.11.4"
+#define RAW_CSV_DEFAULT_FIRMWARE "v2.5.0"
+#define RAW_CSV_ROWS_PER_BLOCK 4096
+#define SZ_RAW_CSV_HEADER 1024
+#define SZ_RAW_CSV_VERSION 16
+
+// x, y and z samples of a regularly sampled recording: either interleaved (x, y, z with a
+// stride of 3, as in a .bin file) or three separate vectors (stride 1).
+typedef struct{
+    const void * axes[3];
+    size_t stride;
+    bool isDouble;              // double values, otherwise float
+    uint64_t numRecords;
+    uint16_t samplerate;
+    double start;               // wall clock seconds (see tm2wallclock) of the first sample
+    const char * serialID;      // of the recording device; NULL or "" when not known
+} raw_csv_source_t;
+
+typedef struct{
+    bool hasStart;              // otherwise the first sample
+    double start;               // wall clock seconds of the first row
+    bool hasStop;               // otherwise the last sample
+    double stop;                // wall clock seconds of the last row
+    bool includeHeader;
+    bool exportTimestamp;       // ignored when actilifeVersion is given
+    char actilifeVersion[SZ_RAW_CSV_VERSION];   // "" => by exportTimestamp
+    const char * firmware;      // NULL => RAW_CSV_DEFAULT_FIRMWARE
+    const char * serialNumber;  // NULL => the source's serialID, else "NEO1C15" and the download date (yymmdd)
+} raw_csv_options_t;
+
+void initRawCSVOptions(raw_csv_options_t * options);
+// Fills in the ActiLife version from exportTimestamp, or exportTimestamp from the version.
+void resolveRawCSVOptions(raw_csv_options_t * options);
+bool isActiLifeVersionLessThan(const char * version, const char * otherVersion);
+
+// The header lines and column names, newline terminated, as of now for the download time.
+// @retval length written or -1 if text (sz_text bytes) is too short.
+int formatActigraphRawHeader(char * text, size_t sz_text, int64_t startWallclock, uint16_t samplerate, const raw_csv_options_t * options);
+
+// Writes the header (with includeHeader) and rows to fid; a stop before the start writes no
+// rows.  numWorkers 0 => one per core.  @retval false if the rows could not be written.
+bool writeActigraphRawRows(FILE * fid, const raw_csv_source_t * source, const raw_csv_options_t * options, unsigned int numWorkers, uint64_t * numRowsWritten);
+
+// Exports a .bin (or raw .csv) file; csvFilename is overwritten with includeHeader and
+// appended to otherwise, e.g. to merge recordings.
+bool exportActigraphRawCSV(const char * rawFilename, const char * csvFilename, const raw_csv_options_t * options, unsigned int numWorkers, uint64_t * numRowsWritten);
+
+#endif /* in_rawcsvwriter_h */
@@ -0,0 +1,227 @@
+//
+//  rawfollow.c
+//  Follow mode conversion of growing raw .csv files.  See rawfollow.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rawfollow.h"
+#include "rawcodec.h"
+
+#define FOLLOW_SIGNALS 3
+#define FOLLOW_RECORD_SIZE (FOLLOW_SIGNALS*sizeof(float))
+#define FOLLOW_BUFFER_SIZE (1<<20)
+#define FOLLOW_MIN_ROW_SIZE 6   // "0,0,0\n"
+
+static char * getFollowStateFilename(const char * binFilename){
+    char * stateFilename = malloc(strlen(binFilename)+strlen(RAW_FOLLOW_EXTENSION)+1);
+    strcpy(stateFilename,binFilename);
+    strcat(stateFilename,RAW_FOLLOW_EXTENSION);
+    return stateFilename;
+}
+
+static bool loadFollowState(const char * stateFilename, raw_follow_state_t * state){
+    bool didLoad = false;
+    FILE * fid = fopen(stateFilename,"rb");
+    if(fid!=NULL){
+        didLoad = fread(state,sizeof(raw_follow_state_t),1,fid)==1 && memcmp(state->magic,RAW_FOLLOW_MAGIC,8)==0 &&
+                  state->version==RAW_FOLLOW_VERSION;
+        fclose(fid);
+    }
+    return didLoad;
+}
+
+static bool saveFollowState(const char * stateFilename, const raw_follow_state_t * state){
+    bool didSave = false;
+    FILE * fid = fopen(stateFilename,"wb");
+    if(fid!=NULL){
+        didSave = fwrite(state,sizeof(raw_follow_state_t),1,fid)==1;
+        didSave = fclose(fid)==0 && didSave;
+    }
+    if(!didSave){
+        fprintf(stderr,"Could not save the follow state to %s\n",stateFilename);
+    }
+    return didSave;
+}
+
+// Parses "[M/d/yyyy HH:MM:SS.fff,]x,y,z" into xyz.
+static bool parseFollowRow(const char * line, float * xyz){
+    const char * cursor = line, * comma = strchr(line,',');
+    char * end;
+    int axis;
+    if(comma==NULL){
+        return false;
+    }
+    if(memchr(line,'/',comma-line)!=NULL){
+        cursor = comma+1;
+    }
+    for(axis=0;axis<FOLLOW_SIGNALS;axis++){
+        xyz[axis] = strtof(cursor,&end);
+        if(end==cursor){
+            return false;
+        }
+        cursor = end;
+        if(axis<FOLLOW_SIGNALS-1){
+            if(*cursor!=','){
+                return false;
+            }
+            cursor++;
+        }
+    }
+    return true;
+}
+
+static bool isBlankRow(const char * line){
+    for(;*line!='\0';line++){
+        if(*line!='\r' && *line!=' ' && *line!='\t'){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the header of an empty .bin file for the .csv described by info.
+static bool startBinFile(FILE * binFID, const actigraph_csv_info_t * info, bin_header_t * header){
+    memset(header,0,sizeof(bin_header_t));
+    header->samplerate = (uint16_t)info->samplerate;
+    wallclock2binStartTimeStr(info->start,header->startTimeStr);
+    memcpy(header->firmware,info->firmware,SZ_FIRMWARE);
+    memcpy(header->serialID,info->serialID,SZ_SERIALID);
+    header->num_signals = FOLLOW_SIGNALS;
+    header->sz_per_signal = sizeof(float);
+    return fwrite(header,sizeof(bin_header_t),1,binFID)==1;
+}
+
+bool followRawCSVFile(const char * csvFilename, const char * binFilename, raw_follow_result_t * result){
+    FILE * csvFID, * binFID = NULL;
+    actigraph_csv_info_t info;
+    raw_follow_state_t state;
+    bin_header_t header;
+    char * stateFilename, * buffer, * newline;
+    float * records;
+    long dataOffset, csvSize;
+    uint64_t bufferOffset, committedOffset, totalRecords;
+    size_t numRead, numBuffered = 0, lineStart;
+    unsigned int samplerate, numPending = 0, numCommittable = 0, pendingSkipped = 0, committableSkipped = 0;
+    bool restart, didFollow = true;
+
+    memset(result,0,sizeof(raw_follow_result_t));
+    if((csvFID=fopen(csvFilename,"rb"))==NULL){
+        fprintf(stderr,"Unable to open the csv file '%s'\n",csvFilename);
+        return false;
+    }
+    if(!readActigraphCSVHeader(csvFID,&info) || info.samplerate<1 || info.samplerate>UINT16_MAX || info.samplerate!=floor(info.samplerate)){
+        fprintf(stderr,"Could not read a whole number sample rate from the header of %s\n",csvFilename);
+        fclose(csvFID);
+        return false;
+    }
+    dataOffset = ftell(csvFID);
+    fseek(csvFID,0,SEEK_END);
+    csvSize = ftell(csvFID);
+
+    stateFilename = getFollowStateFilename(binFilename);
+    restart = !loadFollowState(stateFilename,&state) || state.start!=info.start || strncmp(state.serialID,info.serialID,SZ_SERIALID)!=0 ||
+              state.sourceOffset<(uint64_t)dataOffset || state.sourceOffset>(uint64_t)csvSize;
+    if(!restart){
+        binFID = fopen(binFilename,"r+b");
+        restart = binFID==NULL || !parseBinaryFileHeader(binFID,&header) || isCompressedBinHeader(&header) ||
+                  header.num_signals!=FOLLOW_SIGNALS || header.sz_per_signal!=sizeof(float) ||
+                  header.samplerate!=(uint16_t)info.samplerate || header.sz_remaining!=state.numRecords*FOLLOW_RECORD_SIZE;
+    }
+    if(restart){
+        if(binFID!=NULL){
+            fclose(binFID);
+        }
+        if((binFID=fopen(binFilename,"w+b"))==NULL || !startBinFile(binFID,&info,&header)){
+            fprintf(stderr,"Could not open file for writing: %s\n",binFilename);
+            if(binFID!=NULL){
+                fclose(binFID);
+            }
+            fclose(csvFID);
+            free(stateFilename);
+            return false;
+        }
+        memset(&state,0,sizeof(raw_follow_state_t));
+        memcpy(state.magic,RAW_FOLLOW_MAGIC,8);
+        state.version = RAW_FOLLOW_VERSION;
+        state.start = info.start;
+        memcpy(state.serialID,info.serialID,SZ_SERIALID);
+        state.sourceOffset = (uint64_t)dataOffset;
+        result->restarted = true;
+    }
+
+    samplerate = header.samplerate;
+    totalRecords = state.numRecords;
+    result->firstNewRecord = totalRecords;
+    bufferOffset = committedOffset = state.sourceOffset;
+    buffer = malloc(FOLLOW_BUFFER_SIZE+1);
+    records = malloc(((size_t)FOLLOW_BUFFER_SIZE/FOLLOW_MIN_ROW_SIZE+samplerate)*FOLLOW_RECORD_SIZE);
+    fseek(csvFID,(long)state.sourceOffset,SEEK_SET);
+    fseek(binFID,(long)(sizeof(bin_header_t)+totalRecords*FOLLOW_RECORD_SIZE),SEEK_SET);
+
+    // Rows are parsed as complete lines arrive; records are written through the last whole
+    // second and anything after it is parsed again on the next call.
+    do{
+        numRead = fread(buffer+numBuffered,1,FOLLOW_BUFFER_SIZE-numBuffered,csvFID);
+        numBuffered += numRead;
+        lineStart = 0;
+        while((newline=memchr(buffer+lineStart,'\n',numBuffered-lineStart))!=NULL){
+            *newline = '\0';
+            if(parseFollowRow(buffer+lineStart,records+(size_t)numPending*FOLLOW_SIGNALS)){
+                numPending++;
+            }
+            else if(!isBlankRow(buffer+lineStart)){
+                pendingSkipped++;
+            }
+            lineStart = newline-buffer+1;
+            if((totalRecords+numPending)%samplerate==0){
+                numCommittable = numPending;
+                committableSkipped = pendingSkipped;
+                committedOffset = bufferOffset+lineStart;
+            }
+        }
+        if(numCommittable>0){
+            if(fwrite(records,FOLLOW_RECORD_SIZE,numCommittable,binFID)!=numCommittable){
+                fprintf(stderr,"Incomplete streaming of binary data records to %s\n",binFilename);
+                didFollow = false;
+                break;
+            }
+            totalRecords += numCommittable;
+            numPending -= numCommittable;
+            memmove(records,records+(size_t)numCommittable*FOLLOW_SIGNALS,(size_t)numPending*FOLLOW_RECORD_SIZE);
+            numCommittable = 0;
+        }
+        state.numSkippedRows += committableSkipped;
+        pendingSkipped -= committableSkipped;
+        committableSkipped = 0;
+
+        if(lineStart==0 && numBuffered==FOLLOW_BUFFER_SIZE){
+            fprintf(stderr,"%s has a row longer than %u bytes at byte %llu\n",csvFilename,FOLLOW_BUFFER_SIZE,(unsigned long long)bufferOffset);
+            break;
+        }
+        memmove(buffer,buffer+lineStart,numBuffered-lineStart);
+        numBuffered -= lineStart;
+        bufferOffset += lineStart;
+    } while(numRead>0);
+
+    // Patch the header only after the records it counts are written, and save the state last,
+    // so an interrupted call leaves a header that either matches the state or forces a rebuild.
+    header.sz_remaining = totalRecords*FOLLOW_RECORD_SIZE;
+    header.duration_sec = (uint32_t)(totalRecords/samplerate);
+    didFollow = didFollow && fflush(binFID)==0 && fseek(binFID,0,SEEK_SET)==0 && fwrite(&header,sizeof(bin_header_t),1,binFID)==1;
+    didFollow = fclose(binFID)==0 && didFollow;
+    if(didFollow){
+        state.sourceOffset = committedOffset;
+        state.numRecords = totalRecords;
+        didFollow = saveFollowState(stateFilename,&state);
+    }
+    result->numRecords = totalRecords;
+    result->numNewRecords = totalRecords-result->firstNewRecord;
+
+    free(records);
+    free(buffer);
+    free(stateFilename);
+    fclose(csvFID);
+    return didFollow;
+}
@@ -0,0 +1,49 @@
+//
+//  rawfollow.h
+//  Follow (tail) mode conversion of ActiGraph raw .csv exports that are still being written
+//  into Padaco .bin files.
+//
+//  Each call parses only the rows appended to the .csv since the previous call, appends them
+//  to the .bin payload and patches the header's sz_remaining and duration_sec.  The parser
+//  state (byte offset of the first unconsumed row and the record count it corresponds to) is
+//  kept next to the .bin file in <binFilename>.follow.  Rows are committed in whole seconds,
+//  as parseRawCSVFile does for closed files, and a row is only consumed once its newline has
+//  been written, so a partially flushed row is picked up on the next call.
+//
+//  The .bin file is rebuilt from the start of the .csv when the follow state is missing or no
+//  longer matches (the .csv was truncated or replaced, or the .bin was rewritten).
+//
+
+#ifndef in_rawfollow_h
+#define in_rawfollow_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rawtools.h"
+
+#define RAW_FOLLOW_MAGIC "PAFOLLOW"
+#define RAW_FOLLOW_VERSION 1
+#define RAW_FOLLOW_EXTENSION ".follow"
+
+#pragma pack(push,1)
+typedef struct raw_follow_state_t{
+    char magic[8];
+    uint32_t version;
+    int64_t start;              // wall clock start of the .csv (see tm2wallclock)
+    char serialID[SZ_SERIALID];
+    uint64_t sourceOffset;      // byte offset of the first row not yet in the .bin
+    uint64_t numRecords;        // records in the .bin payload
+    uint64_t numSkippedRows;    // malformed rows passed over so far
+} raw_follow_state_t;
+#pragma pack(pop)
+
+typedef struct raw_follow_result_t{
+    uint64_t firstNewRecord;    // 0 based index of the first record appended by this call
+    uint64_t numNewRecords;
+    uint64_t numRecords;        // records in the .bin after this call
+    bool restarted;             // the .bin was rebuilt from the start of the .csv
+} raw_follow_result_t;
+
+bool followRawCSVFile(const char * csvFilename, const char * binFilename, raw_follow_result_t * result);
+
+#endif /* in_rawfollow_h */
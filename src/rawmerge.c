@@ -0,0 +1,222 @@
+//
+//  rawmerge.c
+//  Streaming merge of split raw recordings.  See rawmerge.h.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rawmerge.h"
+#include "rawstream.h"
+
+typedef struct{
+    raw_stream_t * stream;
+    float * samples;
+    int64_t * ticks;
+    unsigned int numBuffered;
+    unsigned int cursor;
+    uint64_t numUsed;
+    uint64_t numDropped;    // lost to the overlap policy, duplicate or out of order timestamps
+} merge_input_t;
+
+typedef struct{
+    FILE * fid;
+    float buffer[MERGE_CHUNK_RECORDS*RAW_STREAM_SIGNALS];
+    unsigned int numBuffered;
+    uint64_t numRecords;
+    bool didFail;
+} merge_output_t;
+
+// @brief Ensures the input's cursor points at a buffered record, reading the next chunk when needed.
+// @retval false once the input is exhausted.
+static bool fillInput(merge_input_t * input){
+    if(input->stream==NULL){
+        return false;
+    }
+    if(input->cursor==input->numBuffered){
+        input->numBuffered = readRawStream(input->stream,input->samples,input->ticks,MERGE_CHUNK_RECORDS);
+        input->cursor = 0;
+        if(input->numBuffered==0){
+            if(input->stream->numSkippedRows>0){
+                fprintf(stderr,"Skipped %llu malformed rows in %s\n",(unsigned long long)input->stream->numSkippedRows,input->stream->filename);
+            }
+            closeRawStream(input->stream);
+            input->stream = NULL;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeRecord(merge_output_t * output, const float * record){
+    memcpy(output->buffer+(size_t)output->numBuffered*RAW_STREAM_SIGNALS,record,RAW_STREAM_SIGNALS*sizeof(float));
+    output->numRecords++;
+    if(++output->numBuffered==MERGE_CHUNK_RECORDS){
+        output->didFail |= fwrite(output->buffer,RAW_STREAM_SIGNALS*sizeof(float),output->numBuffered,output->fid)!=output->numBuffered;
+        output->numBuffered = 0;
+    }
+}
+
+static void flushOutput(merge_output_t * output){
+    if(output->numBuffered>0){
+        output->didFail |= fwrite(output->buffer,RAW_STREAM_SIGNALS*sizeof(float),output->numBuffered,output->fid)!=output->numBuffered;
+        output->numBuffered = 0;
+    }
+}
+
+// Single pass over all inputs, starting from the earliest start time: at every tick each input first discards records that fall
+// before it (already covered, or out of order), then the inputs sitting on the tick are
+// resolved by the policy.  Runs with no input present are written as missing values up to
+// the next tick any input holds.
+static bool mergeInputs(merge_input_t * inputs, unsigned int numInputs, int64_t tick, overlap_policy_t policy, float missingValue, merge_output_t * output, uint64_t * numGapRecords){
+    const float missingRecord[RAW_STREAM_SIGNALS] = {missingValue,missingValue,missingValue};
+    float record[RAW_STREAM_SIGNALS];
+    int64_t nextTick, headTick;
+    unsigned int i, s, numPresent, chosen;
+    merge_input_t * input;
+    *numGapRecords = 0;
+    while(!output->didFail){
+        numPresent = 0;
+        chosen = numInputs;
+        nextTick = INT64_MAX;
+        for(i=0;i<numInputs;i++){
+            input = &inputs[i];
+            while(fillInput(input) && input->ticks[input->cursor]<tick){
+                input->cursor++;
+                input->numDropped++;
+            }
+            if(input->stream==NULL){
+                continue;
+            }
+            headTick = input->ticks[input->cursor];
+            if(headTick!=tick){
+                nextTick = headTick<nextTick ? headTick : nextTick;
+                continue;
+            }
+            numPresent++;
+            if(policy==OVERLAP_MEAN){
+                // the first value is copied rather than added to zero so that -0 survives
+                for(s=0;s<RAW_STREAM_SIGNALS;s++){
+                    record[s] = numPresent==1 ? input->samples[(size_t)input->cursor*RAW_STREAM_SIGNALS+s] : record[s]+input->samples[(size_t)input->cursor*RAW_STREAM_SIGNALS+s];
+                }
+                input->numUsed++;
+            }
+            else if(chosen==numInputs || policy==OVERLAP_LAST){
+                if(chosen<numInputs){
+                    inputs[chosen].numUsed--;
+                    inputs[chosen].numDropped++;
+                }
+                chosen = i;
+                input->numUsed++;
+            }
+            else{
+                input->numDropped++;
+            }
+            input->cursor++;
+        }
+        if(numPresent==0){
+            // gap: fill up to the next record any input holds
+            for(;tick<nextTick && nextTick!=INT64_MAX;tick++){
+                writeRecord(output,missingRecord);
+                (*numGapRecords)++;
+            }
+            if(nextTick==INT64_MAX){
+                break;
+            }
+            continue;
+        }
+        if(policy==OVERLAP_MEAN){
+            for(s=0;s<RAW_STREAM_SIGNALS;s++){
+                record[s] /= numPresent;
+            }
+            writeRecord(output,record);
+        }
+        else{
+            writeRecord(output,inputs[chosen].samples+(size_t)(inputs[chosen].cursor-1)*RAW_STREAM_SIGNALS);
+        }
+        tick++;
+    }
+    return !output->didFail;
+}
+
+bool mergeRawRecordings(const char * binFilename, const char * const * filenames, unsigned int numInputs, overlap_policy_t policy, float missingValue,
+                        raw_merge_report_t * report){
+    const float missingRecord[RAW_STREAM_SIGNALS] = {missingValue,missingValue,missingValue};
+    merge_input_t * inputs = calloc(numInputs,sizeof(merge_input_t));
+    merge_output_t * output = calloc(1,sizeof(merge_output_t));
+    bin_header_t header;
+    unsigned int i, first = 0, samplerate = 0;
+    uint64_t numGapRecords = 0;
+    bool didMerge = numInputs>0;
+
+    for(i=0;i<numInputs && didMerge;i++){
+        if((inputs[i].stream=openRawStream(filenames[i]))==NULL){
+            didMerge = false;
+        }
+        else if(inputs[i].stream->samplerate!=inputs[0].stream->samplerate || floor(inputs[i].stream->samplerate)!=inputs[i].stream->samplerate){
+            fprintf(stderr,"Sample rates must be whole numbers and agree (%g Hz in %s, %g Hz in %s)\n",inputs[0].stream->samplerate,filenames[0],
+                    inputs[i].stream->samplerate,filenames[i]);
+            didMerge = false;
+        }
+        else{
+            if(inputs[i].stream->start<inputs[first].stream->start){
+                first = i;
+            }
+            inputs[i].samples = malloc((size_t)MERGE_CHUNK_RECORDS*RAW_STREAM_SIGNALS*sizeof(float));
+            inputs[i].ticks = malloc((size_t)MERGE_CHUNK_RECORDS*sizeof(int64_t));
+        }
+    }
+    if(didMerge && (output->fid=fopen(binFilename,"wb"))==NULL){
+        fprintf(stderr,"Could not open %s for writing.\n",binFilename);
+        didMerge = false;
+    }
+
+    if(didMerge){
+        samplerate = (unsigned int)inputs[0].stream->samplerate;
+        // The header is rewritten with the final duration once all records are known.
+        memset(&header,0,sizeof(bin_header_t));
+        header.samplerate = (uint16_t)samplerate;
+        wallclock2binStartTimeStr(inputs[first].stream->start,header.startTimeStr);
+        strncpy(header.firmware,inputs[first].stream->firmware,SZ_FIRMWARE);
+        strncpy(header.serialID,inputs[first].stream->serialID,SZ_SERIALID);
+        header.num_signals = RAW_STREAM_SIGNALS;
+        header.sz_per_signal = sizeof(float);
+        output->didFail = fwrite(&header,sizeof(bin_header_t),1,output->fid)!=1;
+        didMerge = !output->didFail && mergeInputs(inputs,numInputs,inputs[first].stream->startTick,policy,missingValue,output,&numGapRecords);
+
+        // pad the final second so duration_sec describes every record
+        if(didMerge){
+            while(output->numRecords%samplerate!=0){
+                writeRecord(output,missingRecord);
+                numGapRecords++;
+            }
+            flushOutput(output);
+            header.duration_sec = (uint32_t)(output->numRecords/samplerate);
+            header.sz_remaining = output->numRecords*RAW_STREAM_SIGNALS*sizeof(float);
+            didMerge = !output->didFail && fseek(output->fid,0,SEEK_SET)==0 && fwrite(&header,sizeof(bin_header_t),1,output->fid)==1;
+        }
+        didMerge = fclose(output->fid)==0 && didMerge;
+        if(!didMerge){
+            fprintf(stderr,"Failed to write %s\n",binFilename);
+        }
+    }
+
+    if(report!=NULL){
+        report->numRecords = output->numRecords;
+        report->numGapRecords = numGapRecords;
+        report->duration_sec = samplerate>0 ? (uint32_t)(output->numRecords/samplerate) : 0;
+    }
+    for(i=0;i<numInputs;i++){
+        if(report!=NULL && report->numUsed!=NULL){
+            report->numUsed[i] = inputs[i].numUsed;
+        }
+        if(report!=NULL && report->numDropped!=NULL){
+            report->numDropped[i] = inputs[i].numDropped;
+        }
+        closeRawStream(inputs[i].stream);
+        free(inputs[i].samples);
+        free(inputs[i].ticks);
+    }
+    free(output);
+    free(inputs);
+    return didMerge;
+}
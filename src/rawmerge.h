@@ -0,0 +1,43 @@
+//
+//  rawmerge.h
+//  Streaming merge of the raw recordings of a split study (e.g. 702343t00c1RAW.csv and
+//  702343t00c2RAW.csv) into a single uncompressed Padaco .bin file, as mergeraw runs it.
+//
+//  Inputs are read through rawstream.h in chunks, so memory does not grow with the length
+//  of the recordings.  Records are placed on the common sample grid by their tick, starting
+//  from the earliest start time; where recordings overlap the policy picks, per sample,
+//  which of them is kept, and samples no recording covers (including those padding the
+//  final second) are filled with the missing value.  The header takes its firmware and
+//  serial ID from the earliest recording and is rewritten with the final duration once all
+//  records are known.
+//
+
+#ifndef in_rawmerge_h
+#define in_rawmerge_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MERGE_CHUNK_RECORDS 16384
+
+typedef enum{
+    OVERLAP_FIRST,  // the earliest listed input wins (fileToUseForOverlap = 1)
+    OVERLAP_LAST,   // the latest listed input wins (fileToUseForOverlap = 2)
+    OVERLAP_MEAN    // overlapping samples are averaged
+} overlap_policy_t;
+
+typedef struct{
+    uint64_t numRecords;        // written, gap records included
+    uint64_t numGapRecords;     // filled with the missing value
+    uint32_t duration_sec;
+    uint64_t * numUsed;         // (may be NULL) numInputs, samples kept from each input
+    uint64_t * numDropped;      // (may be NULL) numInputs, samples lost to the overlap policy, duplicate or out of order timestamps
+} raw_merge_report_t;
+
+// @brief Merges numInputs raw .csv/.raw or .bin recordings, which must share a whole number
+// sample rate, into binFilename.  Problems are reported on stderr.
+// @param report (may be NULL) Counts of the merge.
+bool mergeRawRecordings(const char * binFilename, const char * const * filenames, unsigned int numInputs, overlap_policy_t policy, float missingValue,
+                        raw_merge_report_t * report);
+
+#endif /* in_rawmerge_h */
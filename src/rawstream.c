@@ -0,0 +1,240 @@
+//
+//  rawstream.c
+//  Chunked sequential reading of raw recordings.  See rawstream.h.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "rawstream.h"
+
+#define SZ_LINE 256
+
+static bool openBinStream(raw_stream_t * stream){
+    bin_header_t header;
+    struct tm startTime;
+    uint64_t sz_table;
+    if(!parseBinaryFileHeader(stream->fid,&header) || !parseBinStartTimeStr(header.startTimeStr,&startTime)){
+        fprintf(stderr,"Could not read the header of %s\n",stream->filename);
+        return false;
+    }
+    if(header.num_signals!=RAW_STREAM_SIGNALS || (header.sz_per_signal!=sizeof(float) && !isCompressedBinHeader(&header))){
+        fprintf(stderr,"Unsupported layout in %s (%u signals of %u bytes)\n",stream->filename,header.num_signals,header.sz_per_signal);
+        return false;
+    }
+    stream->samplerate = header.samplerate;
+    stream->start = tm2wallclock(&startTime);
+    stream->duration_sec = header.duration_sec;
+    memcpy(stream->firmware,header.firmware,SZ_FIRMWARE);
+    memcpy(stream->serialID,header.serialID,SZ_SERIALID);
+    stream->firmware[SZ_FIRMWARE-1] = stream->serialID[SZ_SERIALID-1] = '\0';
+    if(!isCompressedBinHeader(&header)){
+        stream->numRecords = header.sz_remaining/(RAW_STREAM_SIGNALS*sizeof(float));
+        return true;
+    }
+
+    // Only the codec header and block table are held; blocks are read as they are reached.
+    stream->isCompressed = true;
+    if(fread(&stream->codecHeader,sizeof(codec_header_t),1,stream->fid)!=1 || memcmp(stream->codecHeader.magic,RAW_CODEC_MAGIC,4)!=0 ||
+       stream->codecHeader.numSignals!=RAW_STREAM_SIGNALS){
+        fprintf(stderr,"Compressed payload of %s is corrupted.\n",stream->filename);
+        return false;
+    }
+    sz_table = ((uint64_t)stream->codecHeader.numBlocks+1)*sizeof(uint64_t);
+    stream->blockOffsets = malloc(sz_table);
+    if(fread(stream->blockOffsets,sz_table,1,stream->fid)!=1){
+        fprintf(stderr,"Compressed payload of %s is incomplete.\n",stream->filename);
+        return false;
+    }
+    stream->blocksOffset = ftell(stream->fid);
+    stream->numRecords = stream->codecHeader.numRecords;
+    stream->blockSamples = malloc((size_t)stream->codecHeader.recordsPerBlock*RAW_STREAM_SIGNALS*sizeof(float));
+    return true;
+}
+
+static bool openCSVStream(raw_stream_t * stream){
+    actigraph_csv_info_t info;
+    if(!readActigraphCSVHeader(stream->fid,&info)){
+        fprintf(stderr,"Could not read the ActiGraph header of %s\n",stream->filename);
+        return false;
+    }
+    stream->isCSV = true;
+    stream->samplerate = info.samplerate;
+    stream->start = info.start;
+    memcpy(stream->firmware,info.firmware,SZ_FIRMWARE);
+    memcpy(stream->serialID,info.serialID,SZ_SERIALID);
+    stream->line = malloc(SZ_LINE);
+    return true;
+}
+
+// @brief Opens a .bin, .csv or .raw recording for reading.
+// @retval Stream to be closed with closeRawStream(), or NULL on failure.
+raw_stream_t * openRawStream(const char * filename){
+    const char * extension = strrchr(filename,'.');
+    raw_stream_t * stream;
+    bool didOpen;
+    if(extension==NULL || (strcasecmp(extension,".bin")!=0 && strcasecmp(extension,".csv")!=0 && strcasecmp(extension,".raw")!=0)){
+        fprintf(stderr,"Unsupported raw file type: %s\n",filename);
+        return NULL;
+    }
+    stream = calloc(1,sizeof(raw_stream_t));
+    stream->filename = strdup(filename);
+    if((stream->fid=fopen(filename,strcasecmp(extension,".bin")==0 ? "rb" : "r"))==NULL){
+        fprintf(stderr,"Could not open %s for reading.\n",filename);
+        closeRawStream(stream);
+        return NULL;
+    }
+    didOpen = strcasecmp(extension,".bin")==0 ? openBinStream(stream) : openCSVStream(stream);
+    if(!didOpen || stream->samplerate<=0){
+        closeRawStream(stream);
+        return NULL;
+    }
+    stream->startTick = llround(stream->start*stream->samplerate);
+    return stream;
+}
+
+void closeRawStream(raw_stream_t * stream){
+    if(stream==NULL){
+        return;
+    }
+    if(stream->fid!=NULL){
+        fclose(stream->fid);
+    }
+    free(stream->filename);
+    free(stream->line);
+    free(stream->blockOffsets);
+    free(stream->blockBytes);
+    free(stream->blockSamples);
+    free(stream);
+}
+
+// Timestamps only change in their seconds field from one row to the next, so the date and
+// hour:minute prefix is parsed once and reused until it changes.
+static bool parseRowTick(raw_stream_t * stream, const char * line, int64_t * tick, const char ** values){
+    const char * secondsStr = strchr(line,':');
+    char * end;
+    double wallclock, seconds;
+    size_t sz_prefix;
+    if(secondsStr==NULL || (secondsStr=strchr(secondsStr+1,':'))==NULL){
+        return false;
+    }
+    secondsStr++;
+    sz_prefix = secondsStr-line;
+    if(sz_prefix>=sizeof(stream->timestampPrefix)){
+        return false;
+    }
+    seconds = strtod(secondsStr,&end);
+    if(end==secondsStr || *end!=','){
+        return false;
+    }
+    if(strncmp(stream->timestampPrefix,line,sz_prefix)!=0 || stream->timestampPrefix[sz_prefix]!='\0'){
+        if(!parseCSVRowTimestamp(line,&wallclock)){
+            return false;
+        }
+        memcpy(stream->timestampPrefix,line,sz_prefix);
+        stream->timestampPrefix[sz_prefix] = '\0';
+        stream->timestampPrefixWallclock = wallclock-seconds;
+    }
+    *tick = llround((stream->timestampPrefixWallclock+seconds)*stream->samplerate);
+    *values = end+1;
+    return true;
+}
+
+static unsigned int readCSVRecords(raw_stream_t * stream, float * samples, int64_t * ticks, unsigned int maxRecords){
+    unsigned int numRead = 0, s;
+    const char * values;
+    char * end;
+    const char * slash, * comma;
+    int64_t tick;
+    while(numRead<maxRecords && fgets(stream->line,SZ_LINE,stream->fid)!=NULL){
+        if(stream->line[0]=='\n' || stream->line[0]=='\r' || stream->line[0]=='\0'){
+            continue;
+        }
+        slash = strchr(stream->line,'/');
+        comma = strchr(stream->line,',');
+        if(slash!=NULL && (comma==NULL || slash<comma)){
+            if(!parseRowTick(stream,stream->line,&tick,&values)){
+                stream->numSkippedRows++;
+                continue;
+            }
+        }
+        else{
+            tick = stream->startTick+(int64_t)stream->nextRecord;
+            values = stream->line;
+        }
+        for(s=0;s<RAW_STREAM_SIGNALS;s++){
+            samples[(size_t)numRead*RAW_STREAM_SIGNALS+s] = strtof(values,&end);
+            if(end==values){
+                break;
+            }
+            values = *end==',' ? end+1 : end;
+        }
+        if(s<RAW_STREAM_SIGNALS){
+            stream->numSkippedRows++;
+            continue;
+        }
+        ticks[numRead++] = tick;
+        stream->nextRecord++;
+    }
+    return numRead;
+}
+
+static bool loadNextBlock(raw_stream_t * stream){
+    uint64_t sz_block;
+    uint32_t b = stream->nextBlock;
+    if(b>=stream->codecHeader.numBlocks){
+        return false;
+    }
+    sz_block = stream->blockOffsets[b+1]-stream->blockOffsets[b];
+    free(stream->blockBytes);
+    stream->blockBytes = malloc(sz_block>0 ? sz_block : 1);
+    if(fseek(stream->fid,stream->blocksOffset+(long)stream->blockOffsets[b],SEEK_SET)!=0 || fread(stream->blockBytes,1,sz_block,stream->fid)!=sz_block ||
+       !decodeRawBlock(stream->blockBytes,sz_block,&stream->codecHeader,b,stream->blockSamples)){
+        fprintf(stderr,"Compressed block %u of %s is corrupted.\n",b,stream->filename);
+        return false;
+    }
+    stream->blockRecords = (unsigned int)((uint64_t)(b+1)*stream->codecHeader.recordsPerBlock<=stream->numRecords ?
+                                          stream->codecHeader.recordsPerBlock : stream->numRecords-(uint64_t)b*stream->codecHeader.recordsPerBlock);
+    stream->blockCursor = 0;
+    stream->nextBlock++;
+    return true;
+}
+
+static unsigned int readBinRecords(raw_stream_t * stream, float * samples, unsigned int maxRecords){
+    unsigned int numRead = 0, numCopy;
+    if(!stream->isCompressed){
+        if(stream->numRecords-stream->nextRecord<maxRecords){
+            maxRecords = (unsigned int)(stream->numRecords-stream->nextRecord);
+        }
+        return (unsigned int)fread(samples,RAW_STREAM_SIGNALS*sizeof(float),maxRecords,stream->fid);
+    }
+    while(numRead<maxRecords){
+        if(stream->blockCursor==stream->blockRecords && !loadNextBlock(stream)){
+            break;
+        }
+        numCopy = stream->blockRecords-stream->blockCursor;
+        if(numCopy>maxRecords-numRead){
+            numCopy = maxRecords-numRead;
+        }
+        memcpy(samples+(size_t)numRead*RAW_STREAM_SIGNALS,stream->blockSamples+(size_t)stream->blockCursor*RAW_STREAM_SIGNALS,
+               (size_t)numCopy*RAW_STREAM_SIGNALS*sizeof(float));
+        stream->blockCursor += numCopy;
+        numRead += numCopy;
+    }
+    return numRead;
+}
+
+// @brief Reads up to maxRecords x,y,z records into samples (interleaved) and their sample ticks.
+// @retval Number of records read; 0 once the recording is exhausted.
+unsigned int readRawStream(raw_stream_t * stream, float * samples, int64_t * ticks, unsigned int maxRecords){
+    unsigned int numRead, r;
+    if(stream->isCSV){
+        return readCSVRecords(stream,samples,ticks,maxRecords);
+    }
+    numRead = readBinRecords(stream,samples,maxRecords);
+    for(r=0;r<numRead;r++){
+        ticks[r] = stream->startTick+(int64_t)(stream->nextRecord+r);
+    }
+    stream->nextRecord += numRead;
+    return numRead;
+}
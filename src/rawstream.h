@@ -0,0 +1,58 @@
+//
+//  rawstream.h
+//  Sequential, bounded memory reading of raw recordings (ActiGraph .csv/.raw exports and
+//  Padaco .bin files, including compressed payloads) in chunks of records.
+//
+//  Each record is returned with its sample tick: the record's wall clock time multiplied by
+//  the sample rate and rounded, so that records from different recordings at the same rate
+//  can be lined up on a common grid.  Rows of timestamped .csv files take their tick from
+//  the timestamp; all other records are placed one tick apart from the start time.
+//
+
+#ifndef in_rawstream_h
+#define in_rawstream_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "rawtools.h"
+#include "rawcodec.h"
+
+#define RAW_STREAM_SIGNALS 3
+
+typedef struct raw_stream_t{
+    FILE * fid;
+    char * filename;
+    bool isCSV;
+    bool isCompressed;
+    double samplerate;
+    int64_t start;          // wall clock seconds of the first sample (see tm2wallclock)
+    int64_t startTick;
+    uint32_t duration_sec;  // as recorded in the header (.bin) or 0
+    char firmware[SZ_FIRMWARE];
+    char serialID[SZ_SERIALID];
+    uint64_t numRecords;    // total records when known from the header, otherwise 0
+    uint64_t nextRecord;    // records returned so far
+    uint64_t numSkippedRows;  // malformed .csv rows
+
+    // .csv rows
+    char * line;
+    char timestampPrefix[32];   // "M/d/yyyy HH:MM:" of the previous row
+    double timestampPrefixWallclock;
+
+    // compressed .bin blocks
+    codec_header_t codecHeader;
+    uint64_t * blockOffsets;
+    long blocksOffset;
+    uint8_t * blockBytes;
+    float * blockSamples;
+    uint32_t nextBlock;
+    unsigned int blockRecords;
+    unsigned int blockCursor;
+} raw_stream_t;
+
+raw_stream_t * openRawStream(const char * filename);
+unsigned int readRawStream(raw_stream_t * stream, float * samples, int64_t * ticks, unsigned int maxRecords);
+void closeRawStream(raw_stream_t * stream);
+
+#endif /* in_rawstream_h */
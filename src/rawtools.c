@@ -1,6 +1,8 @@
 #include <stdbool.h>
 #include "rawtools.h"
 #include "in_system.h"
+#include "rawcodec.h"
+#include <ctype.h> // for isdigit
 
 
 /***************
@@ -46,6 +48,14 @@ float * parseRawBinFile(const char * binFilename, bin_header_t* fileHeader, unsi
         fclose(fid);
         return NULL;
     }
+    else if(isCompressedBinHeader(fileHeader)){
+        accelerations = loadCompressedBinPayload(fid,fileHeader,recordCount,0);
+        if(accelerations!=NULL){
+            fprintf(stdout,"Read %u records.\n",*recordCount);
+        }
+        fclose(fid);
+        return accelerations;
+    }
     else{
         *recordCount = fileHeader->sz_remaining/3/sizeof(float);
         
@@ -102,6 +112,18 @@ bool writeRaw2Bin(char * rawCSVFilename, char * rawBinFilename){
 }
 
 
+// @brief Fills a .bin header for the float32 x, y, z records of a parsed .csv file.
+void csvHeader2binHeader(csv_header_t * csvFileHeader, bin_header_t * binFileHeader){
+    binFileHeader->samplerate = csvFileHeader->samplerate;
+    strncpy(binFileHeader->startTimeStr,ctime(&csvFileHeader->start),SZ_TIME_STR);
+    strncpy(binFileHeader->firmware,csvFileHeader->firmware,SZ_FIRMWARE);
+    strncpy(binFileHeader->serialID,csvFileHeader->serialID,SZ_SERIALID);
+    binFileHeader->duration_sec = csvFileHeader->duration_sec;
+    binFileHeader->num_signals = 3;
+    binFileHeader->sz_per_signal = sizeof(float);
+    binFileHeader->sz_remaining = binFileHeader->num_signals*binFileHeader->sz_per_signal*binFileHeader->samplerate*binFileHeader->duration_sec;
+}
+
 bool write2bin(FILE *fid, csv_header_t*csvFileHeader, float * data){
     bin_header_t binFileHeader;
     bool goodFile = fseek(fid,0,SEEK_SET)==0; // https://www-s.acm.illinois.edu/webmonkeys/book/c_guide/2.12.html#fopen
@@ -112,17 +134,10 @@ bool write2bin(FILE *fid, csv_header_t*csvFileHeader, float * data){
         return false;
     }
     
-    binFileHeader.samplerate = csvFileHeader->samplerate;
-    strncpy(binFileHeader.startTimeStr,ctime(&csvFileHeader->start),SZ_TIME_STR);
+    csvHeader2binHeader(csvFileHeader,&binFileHeader);
     //binFileHeader.start_tm = *localtime(&csvFileHeader->start);
     //binFileHeader.start_tm = *localtime(&csvFileHeader->start);
     //binFileHeader.stopTime = csvFileHeader->stop;
-    strncpy(binFileHeader.firmware,csvFileHeader->firmware,SZ_FIRMWARE);
-    strncpy(binFileHeader.serialID,csvFileHeader->serialID,SZ_SERIALID);
-    binFileHeader.duration_sec = csvFileHeader->duration_sec;
-    binFileHeader.num_signals = 3;
-    binFileHeader.sz_per_signal = sizeof(float);
-    binFileHeader.sz_remaining = binFileHeader.num_signals*binFileHeader.sz_per_signal*binFileHeader.samplerate*binFileHeader.duration_sec;
     
     /*
     fprintf(stdout,"sizeof(binFileHeader)=%lu\n"
@@ -325,6 +340,217 @@ float * parseRawCSVFile(const char * csvFilename, csv_header_t* fileHeader,bool
  *  Utility methods
  ***************/
 
+// Days since 1970-01-01 for a proleptic Gregorian date.  Ref: http://howardhinnant.github.io/date_algorithms.html
+static int64_t daysFromCivil(int64_t year, unsigned int month, unsigned int day){
+    int64_t era;
+    unsigned int yearOfEra, dayOfYear, dayOfEra;
+    year -= month<=2;
+    era = (year>=0 ? year : year-399)/400;
+    yearOfEra = (unsigned int)(year-era*400);
+    dayOfYear = (153*(month+(month>2 ? -3 : 9))+2)/5+day-1;
+    dayOfEra = yearOfEra*365+yearOfEra/4-yearOfEra/100+dayOfYear;
+    return era*146097+(int64_t)dayOfEra-719468;
+}
+
+int64_t tm2wallclock(const struct tm * timeStruct){
+    // mktime style normalization: let month overflow roll into the year.
+    int64_t year = timeStruct->tm_year+1900+timeStruct->tm_mon/12;
+    int month = timeStruct->tm_mon%12;
+    if(month<0){
+        month+=12;
+        year--;
+    }
+    return daysFromCivil(year,month+1,1)*SECONDS_PER_DAY
+        +(int64_t)(timeStruct->tm_mday-1)*SECONDS_PER_DAY
+        +timeStruct->tm_hour*3600+timeStruct->tm_min*60+timeStruct->tm_sec;
+}
+
+void wallclock2tm(int64_t wallclock, struct tm * timeStruct){
+    int64_t days = wallclock/SECONDS_PER_DAY, secOfDay = wallclock%SECONDS_PER_DAY, era;
+    unsigned int dayOfEra, yearOfEra, dayOfYear, mp;
+    if(secOfDay<0){
+        secOfDay+=SECONDS_PER_DAY;
+        days--;
+    }
+    memset(timeStruct,0,sizeof(struct tm));
+    timeStruct->tm_wday = (int)((days%7+11)%7); // 1970-01-01 was a Thursday
+    timeStruct->tm_hour = (int)(secOfDay/3600);
+    timeStruct->tm_min = (int)(secOfDay%3600/60);
+    timeStruct->tm_sec = (int)(secOfDay%60);
+
+    days += 719468;
+    era = (days>=0 ? days : days-146096)/146097;
+    dayOfEra = (unsigned int)(days-era*146097);
+    yearOfEra = (dayOfEra-dayOfEra/1460+dayOfEra/36524-dayOfEra/146096)/365;
+    dayOfYear = dayOfEra-(365*yearOfEra+yearOfEra/4-yearOfEra/100);
+    mp = (5*dayOfYear+2)/153;
+    timeStruct->tm_mday = dayOfYear-(153*mp+2)/5+1;
+    timeStruct->tm_mon = mp<10 ? mp+2 : mp-10;
+    timeStruct->tm_year = (int)(yearOfEra+era*400+(timeStruct->tm_mon<=1))-1900;
+    timeStruct->tm_isdst = -1;
+}
+
+double wallclock2datenum(double wallclock){
+    return DATENUM_1970+wallclock/SECONDS_PER_DAY;
+}
+
+// Parses the ctime() formatted start time of a Padaco .bin header (e.g. 'Thu Feb  7 00:00:00 2013')
+bool parseBinStartTimeStr(const char * startTimeStr, struct tm * startTime){
+    const char * monthNames = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char timeStr[SZ_TIME_STR+1], monthStr[4];
+    const char * monthMatch;
+    memcpy(timeStr,startTimeStr,SZ_TIME_STR);
+    timeStr[SZ_TIME_STR] = '\0';
+    memset(startTime,0,sizeof(struct tm));
+    if(sscanf(timeStr,"%*3s %3s %d %d:%d:%d %d",monthStr,&startTime->tm_mday,&startTime->tm_hour,&startTime->tm_min,&startTime->tm_sec,&startTime->tm_year)!=6){
+        return false;
+    }
+    monthMatch = strstr(monthNames,monthStr);
+    if(monthMatch==NULL || strlen(monthStr)!=3){
+        return false;
+    }
+    startTime->tm_mon = (int)(monthMatch-monthNames)/3;
+    startTime->tm_year -= 1900;
+    startTime->tm_isdst = -1;
+    return true;
+}
+
+// Writes wallclock in the ctime layout used by bin_header_t.startTimeStr (e.g. "Thu Feb  7 00:00:00 2013").
+void wallclock2binStartTimeStr(int64_t wallclock, char * startTimeStr){
+    static const char * dayNames[] = {"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
+    static const char * monthNames[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+    char timeStr[64];
+    struct tm timeStruct;
+    wallclock2tm(wallclock,&timeStruct);
+    snprintf(timeStr,sizeof(timeStr),"%s %s %2d %02d:%02d:%02d %d",dayNames[timeStruct.tm_wday],monthNames[timeStruct.tm_mon],
+             timeStruct.tm_mday,timeStruct.tm_hour,timeStruct.tm_min,timeStruct.tm_sec,timeStruct.tm_year+1900);
+    memset(startTimeStr,0,SZ_TIME_STR);
+    strncpy(startTimeStr,timeStr,SZ_TIME_STR);
+}
+
+// Parses a leading "M/d/yyyy HH:MM:SS[.fff]" (space or comma separated) timestamp.
+bool parseCSVRowTimestamp(const char * line, double * wallclock){
+    unsigned int month, day, year, hour, minute;
+    double second;
+    struct tm timeStruct;
+    if(sscanf(line,"%u/%u/%u%*[ ,]%u:%u:%lf",&month,&day,&year,&hour,&minute,&second)!=6){
+        return false;
+    }
+    memset(&timeStruct,0,sizeof(struct tm));
+    timeStruct.tm_year = year-1900;
+    timeStruct.tm_mon = month-1;
+    timeStruct.tm_mday = day;
+    timeStruct.tm_hour = hour;
+    timeStruct.tm_min = minute;
+    *wallclock = tm2wallclock(&timeStruct)+second;
+    return true;
+}
+
+// Reads the header lines of an ActiGraph .csv/.raw export and, when present, the column
+// name row that follows them, leaving fid at the first data row.  Unlike parseCSVFileHeader
+// this does not assume a fixed line count, so exports without column names are handled.
+bool readActigraphCSVHeader(FILE * fid, actigraph_csv_info_t * info){
+    char line[SZ_CSV_HEADER_LINE], * match;
+    unsigned int lineNumber, hour = 0, minute = 0, second = 0, month = 0, day = 0, year = 0, samplerate = 0;
+    unsigned int periodHour, periodMinute, periodSecond;
+    double epochPeriod = 0;
+    long dataOffset = -1;
+    bool hasStart = false, hasDate = false;
+    struct tm startTime;
+    memset(info,0,sizeof(actigraph_csv_info_t));
+    if(fgets(line,SZ_CSV_HEADER_LINE,fid)==NULL || strncmp(line,"------------",12)!=0){
+        return false;
+    }
+    if((match=strstr(line,"Firmware "))!=NULL){
+        sscanf(match,"Firmware %9s",info->firmware); // kept as written (e.g. v1.5.0), as parseCSVFileHeader does
+    }
+    if((match=strstr(line," at "))!=NULL){
+        sscanf(match," at %u Hz",&samplerate);
+    }
+    for(lineNumber=1;lineNumber<MAX_CSV_HEADER_LINES && fgets(line,SZ_CSV_HEADER_LINE,fid)!=NULL;lineNumber++){
+        if(sscanf(line,"Serial Number: %19s",info->serialID)==1){
+            continue;
+        }
+        if(sscanf(line,"Start Time %u:%u:%u",&hour,&minute,&second)==3){
+            hasStart = true;
+        }
+        else if(sscanf(line,"Start Date %u/%u/%u",&month,&day,&year)==3){
+            hasDate = true;
+        }
+        else if((match=strstr(line,"(hh:mm:ss)"))!=NULL && sscanf(match,"(hh:mm:ss) %u:%u:%u",&periodHour,&periodMinute,&periodSecond)==3){
+            epochPeriod = periodHour*3600.0+periodMinute*60.0+periodSecond;
+        }
+        else if(strncmp(line,"----------",10)==0){
+            dataOffset = ftell(fid);
+            break;
+        }
+    }
+    // skip a column name row
+    if(dataOffset>=0 && fgets(line,SZ_CSV_HEADER_LINE,fid)!=NULL && (isdigit((unsigned char)line[0]) || line[0]=='-')){
+        fseek(fid,dataOffset,SEEK_SET);
+    }
+    info->samplerate = samplerate>0 ? samplerate : (epochPeriod>0 ? 1/epochPeriod : 0);
+    if(!hasStart || !hasDate || dataOffset<0 || info->samplerate<=0){
+        return false;
+    }
+    memset(&startTime,0,sizeof(struct tm));
+    startTime.tm_year = year-1900;
+    startTime.tm_mon = month-1;
+    startTime.tm_mday = day;
+    startTime.tm_hour = hour;
+    startTime.tm_min = minute;
+    startTime.tm_sec = second;
+    info->start = tm2wallclock(&startTime);
+    return true;
+}
+
+// Loads x,y,z triplets from either a Padaco .bin file or an ActiGraph raw .csv file.
+// @retval Interleaved x,y,z accelerations which must be freed by the caller, or NULL on failure.
+float * loadRawAccelerations(const char * filename, raw_info_t * info){
+    const char * extension = strrchr(filename,'.');
+    float * accelerations = NULL;
+    bin_header_t binHeader;
+    csv_header_t csvHeader;
+    struct tm startTime;
+    time_t startTimer;
+
+    memset(info,0,sizeof(raw_info_t));
+    if(extension!=NULL && strcasecmp(extension,".bin")==0){
+        accelerations = parseRawBinFile(filename,&binHeader,&info->recordCount);
+        if(accelerations!=NULL){
+            if(!parseBinStartTimeStr(binHeader.startTimeStr,&startTime)){
+                fprintf(stderr,"Could not parse the start time found in %s\n",filename);
+                free(accelerations);
+                return NULL;
+            }
+            info->samplerate = binHeader.samplerate;
+            info->start = tm2wallclock(&startTime);
+            info->duration_sec = binHeader.duration_sec;
+            strncpy(info->serialID,binHeader.serialID,SZ_SERIALID);
+        }
+    }
+    else if(extension!=NULL && strcasecmp(extension,".csv")==0){
+        accelerations = parseRawCSVFile(filename,&csvHeader,true,&info->recordCount);
+        if(accelerations!=NULL){
+            startTimer = csvHeader.start;
+            localtime_r(&startTimer,&startTime);
+            info->samplerate = csvHeader.samplerate;
+            info->start = tm2wallclock(&startTime);
+            info->duration_sec = csvHeader.duration_sec;
+            strncpy(info->serialID,csvHeader.serialID,SZ_SERIALID);
+        }
+    }
+    else{
+        fprintf(stderr,"Unsupported raw file type: %s\n",filename);
+    }
+    if(accelerations!=NULL && info->samplerate==0){
+        fprintf(stderr,"No sample rate found in %s\n",filename);
+        free(accelerations);
+        accelerations = NULL;
+    }
+    return accelerations;
+}
+
 
 void printBinHeader(bin_header_t *binHeader)
 {
@@ -10,16 +10,20 @@
 #define SZ_SERIALID 20
 #define SZ_TIME_STR 26-2 // Includes newline and string terminating characters; And -2 to exclude newline and terminating character
 
-#pragma pack(1)  /* Do this to avoid padding being added to our fwrite struct blobs
-                    Ref: http://stackoverflow.com/questions/3318410/pragma-pack-effect
-                         http://www.catb.org/esr/structure-packing/
-                */
-
 #include <stdlib.h> // for malloc
 #include <stdio.h>
+#include <stdint.h> // for uint16_t and friends (not pulled in implicitly on Linux)
 #include <time.h>
 #include <stdbool.h>
 #include <string.h> // for strncpy
+#include <strings.h> // for strcasecmp
+
+#pragma pack(push,1)  /* Do this to avoid padding being added to our fwrite struct blobs
+                    Ref: http://stackoverflow.com/questions/3318410/pragma-pack-effect
+                         http://www.catb.org/esr/structure-packing/
+                    push/pop keeps the packing from leaking into system headers (e.g. pthread types)
+                    included after this one.
+                */
 typedef struct csv_header_t {
 	uint16_t samplerate;
 	time_t start;
@@ -39,15 +43,53 @@ typedef struct bin_header_t{
     uint8_t sz_per_signal;
     uint64_t sz_remaining;
 } bin_header_t;
+#pragma pack(pop)
+
+// Device agnostic summary of a loaded raw file; see loadRawAccelerations().
+typedef struct raw_info_t{
+    uint16_t samplerate;
+    int64_t start;  // wall clock seconds of the first sample (see tm2wallclock)
+    uint32_t duration_sec;
+    unsigned int recordCount;  // number of x,y,z triplets
+    char serialID[SZ_SERIALID];
+} raw_info_t;
+
+#define DATENUM_1970 719529.0 // MATLAB datenum of 01-Jan-1970 00:00:00
+#define SECONDS_PER_DAY 86400
+#define MAX_CSV_HEADER_LINES 16
+#define SZ_CSV_HEADER_LINE 1024
+
+// Header fields of an ActiGraph .csv/.raw export; see readActigraphCSVHeader().
+typedef struct actigraph_csv_info_t{
+    double samplerate;
+    int64_t start;  // wall clock seconds (see tm2wallclock)
+    char firmware[SZ_FIRMWARE];
+    char serialID[SZ_SERIALID];
+} actigraph_csv_info_t;
 
 float * parseRawBinFile(const char * binFilename, bin_header_t* fileHeader, unsigned int * recordCount);
 bool parseBinaryFileHeader(FILE * fid, bin_header_t *header);
 void parseCSVFileHeader(FILE * fid, csv_header_t *header);
 float * parseRawCSVFile(const char * csvFilename, csv_header_t *, bool, unsigned int * rowCount);
 bool write2bin(FILE *fid, csv_header_t*, float * data);
+void csvHeader2binHeader(csv_header_t * csvFileHeader, bin_header_t * binFileHeader);
 bool writeRaw2Bin(char * rawCSVFilename, char * rawBinFilename);
 
 void printBinHeader(bin_header_t *binHeader);
 
+// Wall clock time is the number of seconds since 1970-01-01 00:00:00 for the date and time
+// fields as the device recorded them, with no time zone or daylight savings applied.  It is
+// what MATLAB's datenum represents, so conversions between the two are exact.
+int64_t tm2wallclock(const struct tm * timeStruct);
+void wallclock2tm(int64_t wallclock, struct tm * timeStruct);
+double wallclock2datenum(double wallclock);
+bool parseBinStartTimeStr(const char * startTimeStr, struct tm * startTime);
+void wallclock2binStartTimeStr(int64_t wallclock, char * startTimeStr);
+
+bool readActigraphCSVHeader(FILE * fid, actigraph_csv_info_t * info);
+bool parseCSVRowTimestamp(const char * line, double * wallclock);
+
+float * loadRawAccelerations(const char * filename, raw_info_t * info);
+
 
 #endif /* in_rawtools_h */
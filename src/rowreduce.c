@@ -0,0 +1,349 @@
+//
+//  rowreduce.c
+//  Fused row reductions of load shape matrices.  See rowreduce.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "rowreduce.h"
+#include "framefeatures.h"
+#include "in_parallel.h"
+
+const char * ROWREDUCE_NAMES[NUM_ROWREDUCTIONS] = {
+    "sort","sum","mean","median","max","min","above","bands","normalize"
+};
+
+typedef struct{
+    const rowreduce_plan_t * plan;
+    double * reduced;
+    bool * nonzeroRows;
+    unsigned int * columnOffsets;  // numSections x numRequests, first output column of each request
+    unsigned int * countOffsets;   // numRequests, first count accumulator of each counting request
+    unsigned int numCounts;
+    unsigned int maxSectionWidth;
+    bool needsSum, needsExtrema, needsNaNs, needsRows;
+    double * workspace;
+    size_t workspaceSize;          // doubles per worker
+} rowreduce_job_t;
+
+bool parseRowReduction(const char * name, rowreduce_request_t * request){
+    char * end;
+    int r;
+    request->threshold = 0;
+    if(strncasecmp(name,"above_",6)==0){
+        request->id = ROWREDUCE_ABOVE;
+        request->threshold = strtod(name+6,&end);
+        return end!=name+6 && *end=='\0';
+    }
+    for(r=0;r<NUM_ROWREDUCTIONS;r++){
+        if(r!=ROWREDUCE_ABOVE && strcasecmp(name,ROWREDUCE_NAMES[r])==0){
+            request->id = (rowreduce_id_t)r;
+            return true;
+        }
+    }
+    request->id = ROWREDUCE_UNKNOWN;
+    return false;
+}
+
+static unsigned int getRequestWidth(const rowreduce_plan_t * plan, rowreduce_id_t id, unsigned int sectionWidth){
+    switch(id){
+        case ROWREDUCE_SORT:
+        case ROWREDUCE_NORMALIZE:
+            return sectionWidth;
+        case ROWREDUCE_BANDS:
+            return plan->numBands;
+        default:
+            return 1;
+    }
+}
+
+unsigned int getRowReduceWidth(const rowreduce_plan_t * plan){
+    unsigned int s, q, width = 0;
+    for(s=0;s<plan->numSections;s++){
+        for(q=0;q<plan->numRequests;q++){
+            width += getRequestWidth(plan,plan->requests[q].id,plan->sectionEdges[s+1]-plan->sectionEdges[s]);
+        }
+    }
+    return width;
+}
+
+// true when a comes before b in a descending sort; NaN comes first as in MATLAB.
+static inline bool precedes(double a, double b){
+    return a>b || (a!=a && b==b);
+}
+
+static int compareDescending(const void * a, const void * b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return (int)precedes(y,x)-(int)precedes(x,y);
+}
+
+static inline void compareExchange(double * a, double * b){
+    double tmp;
+    if(precedes(*b,*a)){
+        tmp = *a;
+        *a = *b;
+        *b = tmp;
+    }
+}
+
+// Batcher's odd-even merge sort network, which holds for any numValues; wider rows use qsort.
+static void sortDescending(double * values, unsigned int numValues){
+    unsigned int p, k, j, i;
+    if(numValues>ROWREDUCE_NETWORK_MAX){
+        qsort(values,numValues,sizeof(double),compareDescending);
+        return;
+    }
+    for(p=1;p<numValues;p<<=1){
+        for(k=p;k>=1;k>>=1){
+            for(j=k%p;j+k<numValues;j+=2*k){
+                for(i=0;i<k && i+j+k<numValues;i++){
+                    if((i+j)/(2*p)==(i+j+k)/(2*p)){
+                        compareExchange(values+i+j,values+i+j+k);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Reduces columns first..last-1 of rows firstRow..firstRow+numRows-1 into the section's outputs.
+static void reduceSection(const rowreduce_job_t * job, unsigned int section, unsigned int firstRow, unsigned int numRows, double * workspace){
+    const rowreduce_plan_t * plan = job->plan;
+    const unsigned int first = plan->sectionEdges[section], last = plan->sectionEdges[section+1], width = last-first;
+    const size_t N = plan->numRows;
+    double * sums = workspace, * maxs = sums+ROWREDUCE_BLOCK_ROWS, * mins = maxs+ROWREDUCE_BLOCK_ROWS;
+    double * nans = mins+ROWREDUCE_BLOCK_ROWS, * counts = nans+ROWREDUCE_BLOCK_ROWS;
+    double * rowValues = counts+(size_t)job->numCounts*ROWREDUCE_BLOCK_ROWS;
+    double * count, * out, low, high, threshold, range, median;
+    const double * x;
+    const rowreduce_request_t * request;
+    unsigned int c, i, q, b, k, half;
+    bool isSorted;
+
+    for(i=0;i<numRows;i++){
+        sums[i] = 0;
+        maxs[i] = NAN;
+        mins[i] = NAN;
+        nans[i] = 0;
+    }
+    memset(counts,0,(size_t)job->numCounts*ROWREDUCE_BLOCK_ROWS*sizeof(double));
+
+    // One pass down the section's columns; each inner loop runs over contiguous rows.
+    for(c=first;c<last;c++){
+        x = plan->featureSet+(size_t)c*N+firstRow;
+        if(job->needsSum){
+            for(i=0;i<numRows;i++){
+                sums[i] += x[i];
+            }
+        }
+        if(job->needsExtrema){
+            for(i=0;i<numRows;i++){
+                maxs[i] = (x[i]>maxs[i] || maxs[i]!=maxs[i]) ? x[i] : maxs[i];
+                mins[i] = (x[i]<mins[i] || mins[i]!=mins[i]) ? x[i] : mins[i];
+            }
+        }
+        if(job->needsNaNs){
+            for(i=0;i<numRows;i++){
+                nans[i] += x[i]!=x[i];
+            }
+        }
+        for(q=0;q<plan->numRequests;q++){
+            request = plan->requests+q;
+            if(request->id==ROWREDUCE_ABOVE){
+                count = counts+(size_t)job->countOffsets[q]*ROWREDUCE_BLOCK_ROWS;
+                threshold = request->threshold;
+                for(i=0;i<numRows;i++){
+                    count[i] += x[i]>threshold;
+                }
+            }
+            else if(request->id==ROWREDUCE_BANDS){
+                for(b=0;b<plan->numBands;b++){
+                    count = counts+(size_t)(job->countOffsets[q]+b)*ROWREDUCE_BLOCK_ROWS;
+                    low = plan->bandLows[b];
+                    high = plan->bandHighs[b];
+                    for(i=0;i<numRows;i++){
+                        count[i] += x[i]>=low && x[i]<=high;
+                    }
+                }
+            }
+        }
+    }
+
+    for(q=0;q<plan->numRequests;q++){
+        request = plan->requests+q;
+        out = job->reduced+(size_t)job->columnOffsets[section*plan->numRequests+q]*N+firstRow;
+        switch(request->id){
+            case ROWREDUCE_SUM:
+                memcpy(out,sums,numRows*sizeof(double));
+                break;
+            case ROWREDUCE_MEAN:
+                for(i=0;i<numRows;i++){
+                    out[i] = sums[i]/width;
+                }
+                break;
+            case ROWREDUCE_MAX:
+                memcpy(out,maxs,numRows*sizeof(double));
+                break;
+            case ROWREDUCE_MIN:
+                memcpy(out,mins,numRows*sizeof(double));
+                break;
+            case ROWREDUCE_ABOVE:
+                memcpy(out,counts+(size_t)job->countOffsets[q]*ROWREDUCE_BLOCK_ROWS,numRows*sizeof(double));
+                break;
+            case ROWREDUCE_BANDS:
+                for(b=0;b<plan->numBands;b++){
+                    memcpy(out+(size_t)b*N,counts+(size_t)(job->countOffsets[q]+b)*ROWREDUCE_BLOCK_ROWS,numRows*sizeof(double));
+                }
+                break;
+            case ROWREDUCE_NORMALIZE:
+                // As normalizeLoadShapes: rows whose shifted sum is zero stay shifted (all zero).
+                for(i=0;i<numRows;i++){
+                    if(nans[i]>0 || maxs[i]>mins[i]){
+                        if(job->nonzeroRows!=NULL){
+                            job->nonzeroRows[firstRow+i] = true;
+                        }
+                    }
+                }
+                for(k=0;k<width;k++){
+                    x = plan->featureSet+(size_t)(first+k)*N+firstRow;
+                    for(i=0;i<numRows;i++){
+                        range = (nans[i]>0 || maxs[i]>mins[i]) ? maxs[i]-mins[i] : 1;
+                        out[(size_t)k*N+i] = (x[i]-mins[i])/range;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(!job->needsRows){
+        return;
+    }
+    // Sorting and median need each row of the section gathered.
+    for(i=0;i<numRows;i++){
+        for(k=0;k<width;k++){
+            rowValues[k] = plan->featureSet[(size_t)(first+k)*N+firstRow+i];
+        }
+        isSorted = false;
+        median = NAN;
+        for(q=0;q<plan->numRequests;q++){
+            out = job->reduced+(size_t)job->columnOffsets[section*plan->numRequests+q]*N+firstRow+i;
+            if(plan->requests[q].id==ROWREDUCE_SORT){
+                if(!isSorted){
+                    sortDescending(rowValues,width);
+                    isSorted = true;
+                }
+                for(k=0;k<width;k++){
+                    out[(size_t)k*N] = rowValues[k];
+                }
+            }
+            else if(plan->requests[q].id==ROWREDUCE_MEDIAN){
+                if(nans[i]>0 || width==0){
+                    median = NAN;
+                }
+                else if(isSorted){
+                    half = width/2;
+                    median = width%2 ? rowValues[half] : (rowValues[half-1]+rowValues[half])/2;
+                }
+                else{
+                    median = medianInPlace(rowValues,width);
+                }
+                *out = median;
+            }
+        }
+    }
+}
+
+static void reduceRowBlock(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    const rowreduce_job_t * job = (const rowreduce_job_t*)userData;
+    unsigned int firstRow = taskIndex*ROWREDUCE_BLOCK_ROWS, numRows = job->plan->numRows-firstRow, s;
+    if(numRows>ROWREDUCE_BLOCK_ROWS){
+        numRows = ROWREDUCE_BLOCK_ROWS;
+    }
+    for(s=0;s<job->plan->numSections;s++){
+        reduceSection(job,s,firstRow,numRows,job->workspace+(size_t)workerIndex*job->workspaceSize);
+    }
+}
+
+bool reduceRows(const rowreduce_plan_t * plan, double * reduced, bool * nonzeroRows, unsigned int numWorkers){
+    rowreduce_job_t job;
+    unsigned int s, q, column = 0, numTasks;
+    bool isValid = true;
+
+    for(s=0;s<plan->numSections;s++){
+        if(plan->sectionEdges[s]>plan->sectionEdges[s+1] || plan->sectionEdges[s+1]>plan->numColumns){
+            return false;
+        }
+    }
+    memset(&job,0,sizeof(job));
+    job.plan = plan;
+    job.reduced = reduced;
+    job.nonzeroRows = nonzeroRows;
+    job.columnOffsets = malloc(((size_t)plan->numSections*plan->numRequests+1)*sizeof(unsigned int));
+    job.countOffsets = malloc((plan->numRequests+1)*sizeof(unsigned int));
+    for(q=0;q<plan->numRequests;q++){
+        job.countOffsets[q] = job.numCounts;
+        switch(plan->requests[q].id){
+            case ROWREDUCE_SUM:
+            case ROWREDUCE_MEAN:
+                job.needsSum = true;
+                break;
+            case ROWREDUCE_MAX:
+            case ROWREDUCE_MIN:
+                job.needsExtrema = true;
+                break;
+            case ROWREDUCE_NORMALIZE:
+                job.needsExtrema = true;
+                job.needsNaNs = true;
+                break;
+            case ROWREDUCE_MEDIAN:
+                job.needsNaNs = true;
+                job.needsRows = true;
+                break;
+            case ROWREDUCE_SORT:
+                job.needsRows = true;
+                break;
+            case ROWREDUCE_ABOVE:
+                job.numCounts++;
+                break;
+            case ROWREDUCE_BANDS:
+                job.numCounts += plan->numBands;
+                break;
+            default:
+                isValid = false;
+                break;
+        }
+    }
+    for(s=0;s<plan->numSections;s++){
+        if(plan->sectionEdges[s+1]-plan->sectionEdges[s]>job.maxSectionWidth){
+            job.maxSectionWidth = plan->sectionEdges[s+1]-plan->sectionEdges[s];
+        }
+        for(q=0;q<plan->numRequests;q++){
+            job.columnOffsets[s*plan->numRequests+q] = column;
+            column += getRequestWidth(plan,plan->requests[q].id,plan->sectionEdges[s+1]-plan->sectionEdges[s]);
+        }
+    }
+
+    if(isValid){
+        if(nonzeroRows!=NULL){
+            memset(nonzeroRows,0,plan->numRows*sizeof(bool));
+        }
+        numTasks = (plan->numRows+ROWREDUCE_BLOCK_ROWS-1)/ROWREDUCE_BLOCK_ROWS;
+        if(numWorkers==0){
+            numWorkers = getNumCores();
+        }
+        if(numWorkers>numTasks){
+            numWorkers = numTasks;
+        }
+        job.workspaceSize = (size_t)(4+job.numCounts)*ROWREDUCE_BLOCK_ROWS+job.maxSectionWidth;
+        job.workspace = malloc((numWorkers>0 ? numWorkers : 1)*job.workspaceSize*sizeof(double));
+        parallelFor(numTasks,numWorkers,reduceRowBlock,&job,NULL);
+        free(job.workspace);
+    }
+    free(job.columnOffsets);
+    free(job.countOffsets);
+    return isValid;
+}
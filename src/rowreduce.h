@@ -0,0 +1,73 @@
+//
+//  rowreduce.h
+//  Fused row reductions of load shape matrices (PAStatTool.featureSetAdjustment and
+//  normalizeLoadShapes).  Every requested reduction of every section of columns is
+//  computed from a single pass over the matrix: rows are processed in blocks, and the
+//  accumulating reductions (sum, mean, max, min, threshold and cutpoint band counts) are
+//  updated column by column over a block's contiguous rows.  Sorting and median gather
+//  one row of a section at a time; short sections are sorted with a sorting network.
+//
+//  Input and output follow MATLAB's column-major layout.  The output holds, for each
+//  section in turn, the columns of each request in turn: one column for scalar
+//  reductions, numBands columns for 'bands', and the section's width for 'sort' and
+//  'normalize'.  NaN handling follows MATLAB defaults: sum, mean and median return NaN,
+//  max and min omit NaN, counts treat NaN as outside, and descending sorts put NaN first.
+//
+
+#ifndef in_rowreduce_h
+#define in_rowreduce_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ROWREDUCE_BLOCK_ROWS 256
+#define ROWREDUCE_NETWORK_MAX 32  // widest section sorted with a sorting network
+
+typedef enum{
+    ROWREDUCE_SORT = 0,     // descending
+    ROWREDUCE_SUM,
+    ROWREDUCE_MEAN,
+    ROWREDUCE_MEDIAN,
+    ROWREDUCE_MAX,
+    ROWREDUCE_MIN,
+    ROWREDUCE_ABOVE,        // count of values > threshold
+    ROWREDUCE_BANDS,        // count of values within each [low, high] band
+    ROWREDUCE_NORMALIZE,    // (x-min)/(max-min), as normalizeLoadShapes
+    NUM_ROWREDUCTIONS,
+    ROWREDUCE_UNKNOWN = -1
+} rowreduce_id_t;
+
+extern const char * ROWREDUCE_NAMES[NUM_ROWREDUCTIONS];
+
+typedef struct{
+    rowreduce_id_t id;
+    double threshold;       // ROWREDUCE_ABOVE
+} rowreduce_request_t;
+
+typedef struct{
+    const double * featureSet;          // numRows x numColumns
+    unsigned int numRows;
+    unsigned int numColumns;
+    const unsigned int * sectionEdges;  // numSections+1 column edges, 0 .. numColumns
+    unsigned int numSections;
+    const rowreduce_request_t * requests;
+    unsigned int numRequests;
+    const double * bandLows;            // numBands inclusive band limits for ROWREDUCE_BANDS
+    const double * bandHighs;
+    unsigned int numBands;
+} rowreduce_plan_t;
+
+// @brief Parses 'sort', 'sum', 'mean', 'median', 'max', 'min', 'bands', 'normalize' or
+// 'above_<threshold>' (e.g. 'above_100').
+bool parseRowReduction(const char * name, rowreduce_request_t * request);
+
+// @brief Number of output columns the plan produces.
+unsigned int getRowReduceWidth(const rowreduce_plan_t * plan);
+
+// @param reduced numRows x getRowReduceWidth(plan) output.
+// @param nonzeroRows (may be NULL) numRows flags set where a 'normalize' section had a
+// non-zero sum after subtracting its minimum (normalizeLoadShapes' nzi).
+// @param numWorkers Threads to use (0 => one per core).
+bool reduceRows(const rowreduce_plan_t * plan, double * reduced, bool * nonzeroRows, unsigned int numWorkers);
+
+#endif /* in_rowreduce_h */
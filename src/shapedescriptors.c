@@ -0,0 +1,217 @@
+//
+//  shapedescriptors.c
+//  Load shape descriptors.  See shapedescriptors.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "shapedescriptors.h"
+#include "framefeatures.h"
+#include "in_parallel.h"
+
+#define DESCRIPTOR_BLOCK_ROWS 64
+
+const char * DESCRIPTOR_NAMES[NUM_DESCRIPTORS] = {
+    "sum","sumsqr","std","greaterthancount","peakcount","peakduration","fft","wavelet"
+};
+
+typedef struct{
+    const double * shapes;
+    unsigned int numRows;
+    unsigned int numColumns;
+    const descriptor_request_t * requests;
+    unsigned int numRequests;
+    unsigned int * columnOffsets;   // first output column of each request
+    double * descriptors;
+    double * cosines;               // maxHarmonics x numColumns DFT tables, harmonic major
+    double * sines;
+    unsigned int maxHarmonics;
+    unsigned int maxLevels;
+    double * workspace;
+    size_t workspaceSize;           // doubles per worker: row values, scratch and level energies
+} descriptor_job_t;
+
+descriptor_id_t getDescriptorID(const char * name){
+    int d;
+    for(d=0;d<NUM_DESCRIPTORS;d++){
+        if(strcasecmp(name,DESCRIPTOR_NAMES[d])==0){
+            return (descriptor_id_t)d;
+        }
+    }
+    return DESCRIPTOR_UNKNOWN;
+}
+
+static unsigned int getHarmonics(const descriptor_request_t * request, unsigned int numColumns){
+    unsigned int harmonics = isnan(request->parameter) ? DEFAULT_FFT_HARMONICS : (unsigned int)request->parameter;
+    return numColumns>0 && harmonics>numColumns-1 ? numColumns-1 : harmonics;
+}
+
+unsigned int getDescriptorWidth(const descriptor_request_t * request, unsigned int numColumns){
+    switch(request->id){
+        case DESCRIPTOR_FFT:
+            return getHarmonics(request,numColumns);
+        case DESCRIPTOR_WAVELET:
+            return isnan(request->parameter) ? DEFAULT_WAVELET_LEVELS : (unsigned int)request->parameter;
+        default:
+            return 1;
+    }
+}
+
+// Energy of the Haar detail coefficients at each level; approximation is overwritten.
+static void haarEnergies(double * approximation, unsigned int numValues, unsigned int numLevels, double * energies){
+    unsigned int level, i, half;
+    double detail;
+    for(level=0;level<numLevels;level++){
+        half = numValues/2;
+        energies[level] = 0;
+        for(i=0;i<half;i++){
+            detail = (approximation[2*i]-approximation[2*i+1])/M_SQRT2;
+            approximation[i] = (approximation[2*i]+approximation[2*i+1])/M_SQRT2;
+            energies[level] += detail*detail;
+        }
+        numValues = half;  // an odd trailing value is dropped
+    }
+}
+
+static void describeRow(const descriptor_job_t * job, unsigned int row, double * workspace){
+    const unsigned int M = job->numColumns;
+    const size_t N = job->numRows;
+    double * values = workspace, * scratch = workspace+M, * energies = scratch+M, sum = 0, sumSqr = 0, mean, median, re, im, value;
+    unsigned int c, q, k, count, width;
+    double * out;
+
+    for(c=0;c<M;c++){
+        values[c] = job->shapes[(size_t)c*N+row];
+        sum += values[c];
+        sumSqr += values[c]*values[c];
+    }
+    for(q=0;q<job->numRequests;q++){
+        out = job->descriptors+(size_t)job->columnOffsets[q]*N+row;
+        switch(job->requests[q].id){
+            case DESCRIPTOR_SUM:
+                *out = sum;
+                break;
+            case DESCRIPTOR_SUMSQR:
+                *out = sumSqr;
+                break;
+            case DESCRIPTOR_STD:
+                mean = sum/M;
+                value = 0;
+                for(c=0;c<M;c++){
+                    value += (values[c]-mean)*(values[c]-mean);
+                }
+                *out = M>1 ? sqrt(value/(M-1)) : 0;
+                break;
+            case DESCRIPTOR_GREATERTHANCOUNT:
+                count = 0;
+                for(c=0;c<M;c++){
+                    count += values[c]>=job->requests[q].parameter;
+                }
+                *out = count;
+                break;
+            case DESCRIPTOR_PEAKCOUNT:
+            case DESCRIPTOR_PEAKDURATION:
+                memcpy(scratch,values,M*sizeof(double));
+                median = medianInPlace(scratch,M);
+                count = 0;
+                for(c=0;c<M;c++){
+                    count += values[c]>=median;
+                }
+                *out = job->requests[q].id==DESCRIPTOR_PEAKCOUNT ? count : count*15.0/60.0;
+                break;
+            case DESCRIPTOR_FFT:
+                width = getHarmonics(job->requests+q,M);
+                for(k=0;k<width;k++){
+                    re = 0;
+                    im = 0;
+                    for(c=0;c<M;c++){
+                        re += values[c]*job->cosines[(size_t)k*M+c];
+                        im -= values[c]*job->sines[(size_t)k*M+c];
+                    }
+                    out[(size_t)k*N] = sqrt(re*re+im*im);
+                }
+                break;
+            case DESCRIPTOR_WAVELET:
+                width = getDescriptorWidth(job->requests+q,M);
+                memcpy(scratch,values,M*sizeof(double));
+                haarEnergies(scratch,M,width,energies);
+                for(k=0;k<width;k++){
+                    out[(size_t)k*N] = energies[k];
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void describeRowBlock(unsigned int taskIndex, unsigned int workerIndex, void * userData){
+    const descriptor_job_t * job = (const descriptor_job_t*)userData;
+    unsigned int row = taskIndex*DESCRIPTOR_BLOCK_ROWS, last = row+DESCRIPTOR_BLOCK_ROWS;
+    double * workspace = job->workspace+(size_t)workerIndex*job->workspaceSize;
+    if(last>job->numRows){
+        last = job->numRows;
+    }
+    for(;row<last;row++){
+        describeRow(job,row,workspace);
+    }
+}
+
+bool calcShapeDescriptors(const double * shapes, unsigned int numRows, unsigned int numColumns,
+                          const descriptor_request_t * requests, unsigned int numRequests,
+                          double * descriptors, unsigned int numWorkers){
+    descriptor_job_t job;
+    unsigned int q, k, c, column = 0, numTasks;
+
+    memset(&job,0,sizeof(job));
+    job.shapes = shapes;
+    job.numRows = numRows;
+    job.numColumns = numColumns;
+    job.requests = requests;
+    job.numRequests = numRequests;
+    job.descriptors = descriptors;
+    job.columnOffsets = malloc((numRequests+1)*sizeof(unsigned int));
+    for(q=0;q<numRequests;q++){
+        if(requests[q].id<0 || requests[q].id>=NUM_DESCRIPTORS){
+            free(job.columnOffsets);
+            return false;
+        }
+        job.columnOffsets[q] = column;
+        column += getDescriptorWidth(requests+q,numColumns);
+        if(requests[q].id==DESCRIPTOR_FFT && getHarmonics(requests+q,numColumns)>job.maxHarmonics){
+            job.maxHarmonics = getHarmonics(requests+q,numColumns);
+        }
+        if(requests[q].id==DESCRIPTOR_WAVELET && getDescriptorWidth(requests+q,numColumns)>job.maxLevels){
+            job.maxLevels = getDescriptorWidth(requests+q,numColumns);
+        }
+    }
+    if(job.maxHarmonics>0){
+        job.cosines = malloc((size_t)job.maxHarmonics*numColumns*sizeof(double));
+        job.sines = malloc((size_t)job.maxHarmonics*numColumns*sizeof(double));
+        for(k=0;k<job.maxHarmonics;k++){
+            for(c=0;c<numColumns;c++){
+                // reduce k*c modulo numColumns first to keep the angle exact
+                job.cosines[(size_t)k*numColumns+c] = cos(2*M_PI*(double)(((k+1)*(size_t)c)%numColumns)/numColumns);
+                job.sines[(size_t)k*numColumns+c] = sin(2*M_PI*(double)(((k+1)*(size_t)c)%numColumns)/numColumns);
+            }
+        }
+    }
+    numTasks = (numRows+DESCRIPTOR_BLOCK_ROWS-1)/DESCRIPTOR_BLOCK_ROWS;
+    if(numWorkers==0){
+        numWorkers = getNumCores();
+    }
+    if(numWorkers>numTasks){
+        numWorkers = numTasks;
+    }
+    job.workspaceSize = 2*(size_t)numColumns+job.maxLevels;
+    job.workspace = malloc((numWorkers>0 ? numWorkers : 1)*job.workspaceSize*sizeof(double));
+    parallelFor(numTasks,numWorkers,describeRowBlock,&job,NULL);
+
+    free(job.workspace);
+    free(job.cosines);
+    free(job.sines);
+    free(job.columnOffsets);
+    return true;
+}
@@ -0,0 +1,54 @@
+//
+//  shapedescriptors.h
+//  Native versions of the load shape descriptors of extractLoadShapeFeatures.m, computed
+//  for all rows of a load shape matrix (MATLAB column-major layout) in parallel.
+//
+//  Descriptors and their parameter (NaN selects the default):
+//  - sum, sumsqr, std (normalized by n-1)
+//  - greaterthancount: values >= parameter
+//  - peakcount: values >= the row's median; peakduration is peakcount*15/60 hours
+//  - fft: magnitudes of DFT bins 1..parameter (default 8) of the row
+//  - wavelet: Haar detail energy of levels 1..parameter (default 4)
+//
+
+#ifndef in_shapedescriptors_h
+#define in_shapedescriptors_h
+
+#include <stdbool.h>
+
+#define DEFAULT_FFT_HARMONICS 8
+#define DEFAULT_WAVELET_LEVELS 4
+
+typedef enum{
+    DESCRIPTOR_SUM = 0,
+    DESCRIPTOR_SUMSQR,
+    DESCRIPTOR_STD,
+    DESCRIPTOR_GREATERTHANCOUNT,
+    DESCRIPTOR_PEAKCOUNT,
+    DESCRIPTOR_PEAKDURATION,
+    DESCRIPTOR_FFT,
+    DESCRIPTOR_WAVELET,
+    NUM_DESCRIPTORS,
+    DESCRIPTOR_UNKNOWN = -1
+} descriptor_id_t;
+
+extern const char * DESCRIPTOR_NAMES[NUM_DESCRIPTORS];
+
+typedef struct{
+    descriptor_id_t id;
+    double parameter;
+} descriptor_request_t;
+
+descriptor_id_t getDescriptorID(const char * name);
+
+// @brief Output columns of a request, for shapes of numColumns values.
+unsigned int getDescriptorWidth(const descriptor_request_t * request, unsigned int numColumns);
+
+// @param shapes numRows x numColumns load shapes.
+// @param descriptors numRows x (sum of request widths) output, requests in order.
+// @param numWorkers Threads to use (0 => one per core).
+bool calcShapeDescriptors(const double * shapes, unsigned int numRows, unsigned int numColumns,
+                          const descriptor_request_t * requests, unsigned int numRequests,
+                          double * descriptors, unsigned int numWorkers);
+
+#endif /* in_shapedescriptors_h */
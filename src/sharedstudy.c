@@ -0,0 +1,262 @@
+/*
+ * sharedstudy.c - thin client of the padacod study server (padacod.c).  Studies are decoded
+ * once by the server and read here straight from its shared memory (see studycache.h).
+ *
+ * The calling syntax is:
+ *
+ *		info = sharedstudy('open', filename)
+ *		signals = sharedstudy('window', handle, firstRecord, numRecords)
+ *		usage = sharedstudy('usage', handle, firstRecord, numRecords)
+ *		[minimums, maximums] = sharedstudy('envelope', handle, level, firstBin, numBins)
+ *		features = sharedstudy('features', handle, featureName, frameDurationSec)
+ *		sharedstudy('close', handle)
+ *
+ * info is empty when no server is running; otherwise a struct with fields handle,
+ * samplerate, startDatenum, durationSec, numRecords, serialID and samplesPerBin (one value
+ * per envelope level, level 1 being one second bins).  Records and bins are 1 based.
+ * signals (single), usage (int8), minimums, maximums (single) and features (double) have
+ * four columns: x, y, z and vecMag.  Usage is classified with the default
+ * PAClassifyGravities rules.  featureName is a feature function name or description (see
+ * framefeatures.c).
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O sharedstudy.c studysocket.c studycache.c classifyusage.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "studycache.h"
+#include "studysocket.h"
+#include "framefeatures.h"
+
+#define MAX_SHARED_STUDIES 256
+
+typedef struct{
+    const study_segment_t * segment;
+    char segmentName[SZ_STUDY_SEGMENT_NAME];
+    char * filename;
+} shared_study_t;
+
+static const char * INFO_FIELDS[] = {"handle","samplerate","startDatenum","durationSec","numRecords","serialID","samplesPerBin"};
+static shared_study_t studies[MAX_SHARED_STUDIES];
+
+static void closeStudy(unsigned int handle){
+    unmapStudySegment(studies[handle].segment);
+    mxFree(studies[handle].filename);
+    memset(&studies[handle],0,sizeof(shared_study_t));
+}
+
+static void closeAllStudies(void){
+    unsigned int handle;
+    for(handle=0;handle<MAX_SHARED_STUDIES;handle++){
+        if(studies[handle].segment!=NULL){
+            closeStudy(handle);
+        }
+    }
+}
+
+static unsigned int getHandle(const mxArray * handleArray){
+    double value = mxGetScalar(handleArray);
+    if(value<1 || value>MAX_SHARED_STUDIES || studies[(unsigned int)value-1].segment==NULL){
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:handle",
+                "Unknown or closed study handle.");
+    }
+    return (unsigned int)value-1;
+}
+
+// Checks 1 based [first, first+count) against numAvailable and returns the 0 based start.
+static uint64_t getStart(const mxArray * firstArray, const mxArray * countArray, uint64_t numAvailable, size_t * count){
+    double first = mxGetScalar(firstArray), numRequested = mxGetScalar(countArray);
+    if(first<1 || numRequested<0 || first-1+numRequested>(double)numAvailable) {
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:range",
+                "Requested range exceeds the %llu available.",(unsigned long long)numAvailable);
+    }
+    *count = (size_t)numRequested;
+    return (uint64_t)first-1;
+}
+
+static mxArray * openStudy(const char * filename){
+    study_request_t request;
+    study_response_t response;
+    const study_segment_t * segment;
+    void * payload;
+    unsigned int handle, level;
+    mxArray * info, * samplesPerBin;
+    char serialID[SZ_SERIALID+1], * resolvedFilename;
+
+    memset(&request,0,sizeof(study_request_t));
+    request.magic = STUDY_PROTOCOL_MAGIC;
+    request.command = STUDY_OPEN;
+    // relative to MATLAB's current folder, not the server's
+    resolvedFilename = realpath(filename,NULL);
+    if(resolvedFilename!=NULL) {
+        filename = resolvedFilename;
+    }
+    if(strlen(filename)>=SZ_STUDY_FILENAME) {
+        free(resolvedFilename);
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:filename",
+                "Filename is too long.");
+    }
+    strcpy(request.filename,filename);
+    free(resolvedFilename);
+    filename = request.filename;
+    if(!requestStudyServer(&request,&response,&payload)) {
+        return mxCreateDoubleMatrix(0,0,mxREAL);
+    }
+    free(payload);
+    if(!response.didSucceed) {
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:open",
+                "%s",response.message);
+    }
+
+    for(handle=0;handle<MAX_SHARED_STUDIES && !(studies[handle].segment!=NULL && strcmp(studies[handle].segmentName,response.segmentName)==0);handle++);
+    if(handle==MAX_SHARED_STUDIES) {
+        for(handle=0;handle<MAX_SHARED_STUDIES && studies[handle].segment!=NULL;handle++);
+        if(handle==MAX_SHARED_STUDIES) {
+            mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:handles",
+                    "%u studies are open; close some first.",MAX_SHARED_STUDIES);
+        }
+        if((segment=mapStudySegment(response.segmentName))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:map",
+                    "Could not map the shared memory of %s.",filename);
+        }
+        studies[handle].segment = segment;
+        memcpy(studies[handle].segmentName,response.segmentName,SZ_STUDY_SEGMENT_NAME);
+        studies[handle].filename = mxMalloc(strlen(filename)+1);
+        mexMakeMemoryPersistent(studies[handle].filename);
+        strcpy(studies[handle].filename,filename);
+    }
+    segment = studies[handle].segment;
+
+    info = mxCreateStructMatrix(1,1,sizeof(INFO_FIELDS)/sizeof(INFO_FIELDS[0]),INFO_FIELDS);
+    mxSetField(info,0,"handle",mxCreateDoubleScalar(handle+1));
+    mxSetField(info,0,"samplerate",mxCreateDoubleScalar(segment->samplerate));
+    mxSetField(info,0,"startDatenum",mxCreateDoubleScalar(wallclock2datenum((double)segment->start)));
+    mxSetField(info,0,"durationSec",mxCreateDoubleScalar(segment->duration_sec));
+    mxSetField(info,0,"numRecords",mxCreateDoubleScalar((double)segment->numRecords));
+    memcpy(serialID,segment->serialID,SZ_SERIALID);
+    serialID[SZ_SERIALID] = '\0';
+    mxSetField(info,0,"serialID",mxCreateString(serialID));
+    samplesPerBin = mxCreateDoubleMatrix(1,segment->numLevels,mxREAL);
+    for(level=0;level<segment->numLevels;level++) {
+        mxGetPr(samplesPerBin)[level] = (double)segment->samplesPerBin[level];
+    }
+    mxSetField(info,0,"samplesPerBin",samplesPerBin);
+    return info;
+}
+
+static mxArray * getFeatures(unsigned int handle, const char * featureName, double frameDurationSec){
+    study_request_t request;
+    study_response_t response;
+    void * payload;
+    mxArray * features;
+
+    memset(&request,0,sizeof(study_request_t));
+    request.magic = STUDY_PROTOCOL_MAGIC;
+    request.command = STUDY_FEATURES;
+    strcpy(request.filename,studies[handle].filename);
+    request.featureID = getFeatureID(featureName);
+    request.frameDurationSec = frameDurationSec>0 ? (uint32_t)(frameDurationSec+0.5) : 0;
+    if(request.featureID==FEATURE_UNKNOWN) {
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:feature",
+                "Unknown feature (%s).",featureName);
+    }
+    if(!requestStudyServer(&request,&response,&payload)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:server",
+                "The study server could not be reached.");
+    }
+    if(!response.didSucceed) {
+        free(payload);
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:features",
+                "%s",response.message);
+    }
+    features = mxCreateDoubleMatrix((size_t)response.numFrames,STUDY_NUM_SIGNALS,mxREAL);
+    if(response.payloadSize>0) {
+        memcpy(mxGetPr(features),payload,response.payloadSize);
+    }
+    free(payload);
+    return features;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * command, * text;
+    const study_segment_t * segment;
+    const float * envelope;
+    unsigned int handle, signal, level;
+    uint64_t start;
+    size_t count;
+
+    mexAtExit(closeAllStudies);
+    if(nrhs < 2 || !mxIsChar(prhs[0])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:nrhs",
+                "A command and a filename or study handle are required inputs.");
+    }
+    command = mxArrayToString(prhs[0]);
+    if(strcmp(command,"open")==0) {
+        mxFree(command);
+        if((text=mxArrayToString(prhs[1]))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:notString",
+                    "Filename must be a string.");
+        }
+        plhs[0] = openStudy(text);
+        mxFree(text);
+        return;
+    }
+
+    handle = getHandle(prhs[1]);
+    segment = studies[handle].segment;
+    if(strcmp(command,"close")==0) {
+        closeStudy(handle);
+    }
+    else if(strcmp(command,"window")==0 && nrhs==4) {
+        start = getStart(prhs[2],prhs[3],segment->numRecords,&count);
+        plhs[0] = mxCreateNumericMatrix(count,STUDY_NUM_SIGNALS,mxSINGLE_CLASS,mxREAL);
+        for(signal=0;signal<STUDY_NUM_SIGNALS;signal++) {
+            memcpy((float*)mxGetData(plhs[0])+signal*count,getStudySignal(segment,signal)+start,count*sizeof(float));
+        }
+    }
+    else if(strcmp(command,"usage")==0 && nrhs==4) {
+        start = getStart(prhs[2],prhs[3],segment->numRecords,&count);
+        plhs[0] = mxCreateNumericMatrix(count,STUDY_NUM_SIGNALS,mxINT8_CLASS,mxREAL);
+        for(signal=0;signal<STUDY_NUM_SIGNALS;signal++) {
+            memcpy((int8_t*)mxGetData(plhs[0])+signal*count,getStudyUsage(segment,signal)+start,count*sizeof(int8_t));
+        }
+    }
+    else if(strcmp(command,"envelope")==0 && nrhs==5) {
+        if(mxGetScalar(prhs[2])<1 || mxGetScalar(prhs[2])>segment->numLevels) {
+            mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:level",
+                    "Envelope level must be between 1 and %u.",segment->numLevels);
+        }
+        level = (unsigned int)mxGetScalar(prhs[2])-1;
+        start = getStart(prhs[3],prhs[4],segment->levelBins[level],&count);
+        plhs[0] = mxCreateNumericMatrix(count,STUDY_NUM_SIGNALS,mxSINGLE_CLASS,mxREAL);
+        if(nlhs > 1) {
+            plhs[1] = mxCreateNumericMatrix(count,STUDY_NUM_SIGNALS,mxSINGLE_CLASS,mxREAL);
+        }
+        for(signal=0;signal<STUDY_NUM_SIGNALS;signal++) {
+            envelope = getStudyEnvelope(segment,level,signal);
+            memcpy((float*)mxGetData(plhs[0])+signal*count,envelope+start,count*sizeof(float));
+            if(nlhs > 1) {
+                memcpy((float*)mxGetData(plhs[1])+signal*count,envelope+segment->levelBins[level]+start,count*sizeof(float));
+            }
+        }
+    }
+    else if(strcmp(command,"features")==0 && nrhs==4) {
+        if((text=mxArrayToString(prhs[2]))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:notString",
+                    "Feature name must be a string.");
+        }
+        plhs[0] = getFeatures(handle,text,mxGetScalar(prhs[3]));
+        mxFree(text);
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:sharedstudy:command",
+                "Unknown command (%s) or wrong number of inputs.",command);
+    }
+    mxFree(command);
+}
@@ -0,0 +1,319 @@
+//
+//  studycache.c
+//  Decoded studies kept in POSIX shared memory.  See studycache.h.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "studycache.h"
+#include "classifyusage.h"
+
+#define STUDY_ALIGNMENT 64
+
+static uint64_t alignOffset(uint64_t offset){
+    return (offset+STUDY_ALIGNMENT-1)/STUDY_ALIGNMENT*STUDY_ALIGNMENT;
+}
+
+// Fills in the pyramid level sizes and array offsets; returns the segment size.
+static uint64_t layoutStudySegment(study_segment_t * segment){
+    uint64_t offset, numBins, samplesPerBin = segment->samplerate;
+    unsigned int level;
+    segment->signalsOffset = alignOffset(sizeof(study_segment_t));
+    segment->usageOffset = alignOffset(segment->signalsOffset+STUDY_NUM_SIGNALS*segment->numRecords*sizeof(float));
+    offset = alignOffset(segment->usageOffset+STUDY_NUM_SIGNALS*segment->numRecords*sizeof(int8_t));
+    numBins = (segment->numRecords+samplesPerBin-1)/samplesPerBin;
+    for(level=0;level<STUDY_MAX_LEVELS && numBins>0;level++){
+        segment->levelOffsets[level] = offset;
+        segment->levelBins[level] = numBins;
+        segment->samplesPerBin[level] = samplesPerBin;
+        offset = alignOffset(offset+STUDY_NUM_SIGNALS*2*numBins*sizeof(float));
+        if(numBins==1){
+            level++;
+            break;
+        }
+        numBins = (numBins+STUDY_PYRAMID_FACTOR-1)/STUDY_PYRAMID_FACTOR;
+        samplesPerBin *= STUDY_PYRAMID_FACTOR;
+    }
+    segment->numLevels = level;
+    return offset;
+}
+
+const float * getStudySignal(const study_segment_t * segment, unsigned int signal){
+    return (const float*)((const uint8_t*)segment+segment->signalsOffset)+(size_t)signal*segment->numRecords;
+}
+
+const int8_t * getStudyUsage(const study_segment_t * segment, unsigned int signal){
+    return (const int8_t*)((const uint8_t*)segment+segment->usageOffset)+(size_t)signal*segment->numRecords;
+}
+
+const float * getStudyEnvelope(const study_segment_t * segment, unsigned int level, unsigned int signal){
+    return (const float*)((const uint8_t*)segment+segment->levelOffsets[level])+(size_t)signal*2*segment->levelBins[level];
+}
+
+static void buildStudyPyramid(study_segment_t * segment){
+    unsigned int level, signal;
+    uint64_t bin, numBins, start, stop, i;
+    const float * samples;
+    float * minimums, * maximums, * below, low, high;
+    for(signal=0;signal<STUDY_NUM_SIGNALS;signal++){
+        samples = getStudySignal(segment,signal);
+        for(level=0;level<segment->numLevels;level++){
+            numBins = segment->levelBins[level];
+            minimums = (float*)getStudyEnvelope(segment,level,signal);
+            maximums = minimums+numBins;
+            for(bin=0;bin<numBins;bin++){
+                low = INFINITY;
+                high = -INFINITY;
+                if(level==0){
+                    start = bin*segment->samplesPerBin[0];
+                    stop = start+segment->samplesPerBin[0]<segment->numRecords ? start+segment->samplesPerBin[0] : segment->numRecords;
+                    for(i=start;i<stop;i++){
+                        low = fminf(low,samples[i]);
+                        high = fmaxf(high,samples[i]);
+                    }
+                }
+                else{
+                    below = (float*)getStudyEnvelope(segment,level-1,signal);
+                    start = bin*STUDY_PYRAMID_FACTOR;
+                    stop = start+STUDY_PYRAMID_FACTOR<segment->levelBins[level-1] ? start+STUDY_PYRAMID_FACTOR : segment->levelBins[level-1];
+                    for(i=start;i<stop;i++){
+                        low = fminf(low,below[i]);
+                        high = fmaxf(high,below[segment->levelBins[level-1]+i]);
+                    }
+                }
+                minimums[bin] = low;
+                maximums[bin] = high;
+            }
+        }
+    }
+}
+
+study_segment_t * createStudySegment(const char * filename, const char * segmentName, char * errorMsg, size_t sz_errorMsg){
+    raw_info_t info;
+    study_segment_t layout, * segment;
+    float * accelerations, * signals[STUDY_NUM_SIGNALS];
+    int8_t * usage[STUDY_NUM_SIGNALS];
+    uint64_t segmentSize;
+    unsigned int s;
+    int fd;
+
+    accelerations = loadRawAccelerations(filename,&info);
+    if(accelerations==NULL || info.recordCount==0){
+        snprintf(errorMsg,sz_errorMsg,"No data loaded from file (%s)",filename);
+        free(accelerations);
+        return NULL;
+    }
+    memset(&layout,0,sizeof(study_segment_t));
+    memcpy(layout.magic,STUDY_SEGMENT_MAGIC,strlen(STUDY_SEGMENT_MAGIC));
+    layout.version = STUDY_SEGMENT_VERSION;
+    layout.samplerate = info.samplerate;
+    layout.start = info.start;
+    layout.duration_sec = info.duration_sec;
+    layout.numRecords = info.recordCount;
+    memcpy(layout.serialID,info.serialID,SZ_SERIALID);
+    layout.segmentSize = segmentSize = layoutStudySegment(&layout);
+
+    fd = shm_open(segmentName,O_CREAT|O_EXCL|O_RDWR,S_IRUSR|S_IWUSR);  // decoded recordings are private to the user
+    if(fd<0 || ftruncate(fd,(off_t)segmentSize)!=0 ||
+       (segment=mmap(NULL,segmentSize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0))==MAP_FAILED){
+        snprintf(errorMsg,sz_errorMsg,"Could not create a %llu byte shared memory segment for %s",(unsigned long long)segmentSize,filename);
+        if(fd>=0){
+            close(fd);
+            shm_unlink(segmentName);
+        }
+        free(accelerations);
+        return NULL;
+    }
+    close(fd);
+    memcpy(segment,&layout,sizeof(study_segment_t));
+
+    for(s=0;s<STUDY_NUM_SIGNALS;s++){
+        signals[s] = (float*)getStudySignal(segment,s);
+        usage[s] = (int8_t*)getStudyUsage(segment,s);
+    }
+    splitRawSignals(accelerations,segment->numRecords,signals,NULL);
+    free(accelerations);
+    classifyRawUsage(signals,usage,segment->numRecords,NULL,STUDY_NUM_SIGNALS,NULL,NULL,NULL);
+    buildStudyPyramid(segment);
+    return segment;
+}
+
+const study_segment_t * mapStudySegment(const char * segmentName){
+    study_segment_t * segment = NULL;
+    struct stat status;
+    int fd = shm_open(segmentName,O_RDONLY,0);
+    if(fd<0){
+        return NULL;
+    }
+    if(fstat(fd,&status)==0 && (size_t)status.st_size>=sizeof(study_segment_t)){
+        segment = mmap(NULL,(size_t)status.st_size,PROT_READ,MAP_SHARED,fd,0);
+        if(segment==MAP_FAILED){
+            segment = NULL;
+        }
+        else if(memcmp(segment->magic,STUDY_SEGMENT_MAGIC,strlen(STUDY_SEGMENT_MAGIC))!=0 || segment->version!=STUDY_SEGMENT_VERSION ||
+                segment->segmentSize!=(uint64_t)status.st_size){
+            munmap(segment,(size_t)status.st_size);
+            segment = NULL;
+        }
+    }
+    close(fd);
+    return segment;
+}
+
+void unmapStudySegment(const study_segment_t * segment){
+    if(segment!=NULL){
+        munmap((void*)segment,segment->segmentSize);
+    }
+}
+
+study_cache_t * createStudyCache(uint64_t maxBytes){
+    study_cache_t * cache = calloc(1,sizeof(study_cache_t));
+    pthread_mutex_init(&cache->lock,NULL);
+    pthread_cond_init(&cache->didLoad,NULL);
+    cache->maxBytes = maxBytes;
+    return cache;
+}
+
+// Caller holds the lock.
+static void removeStudy(study_cache_t * cache, unsigned int index){
+    study_entry_t * entry = cache->entries[index];
+    if(entry->segment!=NULL){
+        cache->usedBytes -= entry->segment->segmentSize;
+        shm_unlink(entry->segmentName);
+        unmapStudySegment(entry->segment);
+    }
+    free(entry->filename);
+    free(entry);
+    cache->entries[index] = cache->entries[--cache->numEntries];
+}
+
+// Drops least recently used studies that no request is using until the budget is met.
+// Caller holds the lock.
+static void evictStudies(study_cache_t * cache){
+    unsigned int e, oldest;
+    while(cache->usedBytes>cache->maxBytes){
+        oldest = cache->numEntries;
+        for(e=0;e<cache->numEntries;e++){
+            if(cache->entries[e]->refCount==0 && !cache->entries[e]->isLoading &&
+               (oldest==cache->numEntries || cache->entries[e]->lastUsed<cache->entries[oldest]->lastUsed)){
+                oldest = e;
+            }
+        }
+        if(oldest==cache->numEntries){
+            break;
+        }
+        fprintf(stdout,"Evicting %s\n",cache->entries[oldest]->filename);
+        removeStudy(cache,oldest);
+    }
+}
+
+study_entry_t * acquireStudy(study_cache_t * cache, const char * requestedFilename, char * errorMsg, size_t sz_errorMsg){
+    struct stat status;
+    study_entry_t * entry = NULL;
+    study_segment_t * segment;
+    unsigned int e;
+    bool isWaiting;
+    // keyed by the canonical path, so relative paths and links share one entry
+    char * filename = realpath(requestedFilename,NULL);
+
+    if(filename==NULL || stat(filename,&status)!=0){
+        snprintf(errorMsg,sz_errorMsg,"File not found (%s)",requestedFilename);
+        free(filename);
+        return NULL;
+    }
+    pthread_mutex_lock(&cache->lock);
+    do{
+        isWaiting = false;
+        entry = NULL;
+        for(e=0;e<cache->numEntries;){
+            if(strcmp(cache->entries[e]->filename,filename)!=0){
+                e++;
+            }
+            else if(cache->entries[e]->isLoading){
+                isWaiting = true;
+                e++;
+            }
+            else if(cache->entries[e]->mtime==(int64_t)status.st_mtime && cache->entries[e]->fileSize==(uint64_t)status.st_size){
+                entry = cache->entries[e++];
+            }
+            else if(cache->entries[e]->refCount==0){
+                // the file has changed since it was decoded
+                removeStudy(cache,e);
+            }
+            else{
+                e++;
+            }
+        }
+        if(entry==NULL && isWaiting){
+            pthread_cond_wait(&cache->didLoad,&cache->lock);
+        }
+    } while(entry==NULL && isWaiting);
+
+    if(entry!=NULL){
+        entry->refCount++;
+        entry->lastUsed = ++cache->clock;
+        pthread_mutex_unlock(&cache->lock);
+        free(filename);
+        return entry;
+    }
+
+    entry = calloc(1,sizeof(study_entry_t));
+    entry->filename = filename;
+    entry->mtime = (int64_t)status.st_mtime;
+    entry->fileSize = (uint64_t)status.st_size;
+    entry->refCount = 1;
+    entry->isLoading = true;
+    snprintf(entry->segmentName,SZ_STUDY_SEGMENT_NAME,"/padaco.%d.%llu",(int)getpid(),(unsigned long long)++cache->numSegmentsCreated);
+    if(cache->numEntries==cache->capacity){
+        cache->capacity = cache->capacity>0 ? 2*cache->capacity : 16;
+        cache->entries = realloc(cache->entries,cache->capacity*sizeof(study_entry_t*));
+    }
+    cache->entries[cache->numEntries++] = entry;
+    pthread_mutex_unlock(&cache->lock);
+
+    // Decode without holding the lock so other studies are served meanwhile.
+    segment = createStudySegment(filename,entry->segmentName,errorMsg,sz_errorMsg);
+
+    pthread_mutex_lock(&cache->lock);
+    entry->isLoading = false;
+    if(segment==NULL){
+        for(e=0;cache->entries[e]!=entry;e++);
+        removeStudy(cache,e);
+        entry = NULL;
+    }
+    else{
+        entry->segment = segment;
+        entry->lastUsed = ++cache->clock;
+        cache->usedBytes += segment->segmentSize;
+        evictStudies(cache);
+    }
+    pthread_cond_broadcast(&cache->didLoad);
+    pthread_mutex_unlock(&cache->lock);
+    return entry;
+}
+
+void releaseStudy(study_cache_t * cache, study_entry_t * entry){
+    pthread_mutex_lock(&cache->lock);
+    entry->refCount--;
+    evictStudies(cache);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void freeStudyCache(study_cache_t * cache){
+    if(cache!=NULL){
+        pthread_mutex_lock(&cache->lock);
+        while(cache->numEntries>0){
+            removeStudy(cache,cache->numEntries-1);
+        }
+        pthread_mutex_unlock(&cache->lock);
+        pthread_mutex_destroy(&cache->lock);
+        pthread_cond_destroy(&cache->didLoad);
+        free(cache->entries);
+        free(cache);
+    }
+}
@@ -0,0 +1,95 @@
+//
+//  studycache.h
+//  Decoded studies kept in POSIX shared memory for the padacod study server.
+//
+//  A study segment holds everything a session needs to display and summarize a recording
+//  without decoding it again: the x, y, z and vector magnitude signals, their usage state
+//  vectors (classifyUsageState with the default rules, stuck axes propagated to vecMag) and
+//  a min/max envelope pyramid.  Pyramid level 0 has one bin per second and each level above
+//  it combines STUDY_PYRAMID_FACTOR bins of the level below; the last bin of a level may be
+//  partial.  Arrays are stored signal by signal (all of x, then all of y, ...), so a column
+//  of a MATLAB matrix is one memcpy.
+//
+//  The server creates each segment once, under a unique name, and sessions map it read
+//  only.  The server's study cache evicts the least recently used studies once their
+//  segments exceed its memory budget; an evicted segment is unlinked, so it disappears once
+//  the last session mapping it lets go.  Studies are keyed by filename, modification time
+//  and size, so a rewritten file is decoded again.
+//
+
+#ifndef in_studycache_h
+#define in_studycache_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "rawtools.h"
+
+#define STUDY_SEGMENT_MAGIC "PASTUDY"
+#define STUDY_SEGMENT_VERSION 1
+#define STUDY_NUM_SIGNALS 4     // x, y, z, vecMag
+#define STUDY_MAX_LEVELS 16
+#define STUDY_PYRAMID_FACTOR 4
+#define SZ_STUDY_SEGMENT_NAME 32
+
+typedef struct study_segment_t{
+    char magic[8];
+    uint32_t version;
+    uint64_t segmentSize;
+    uint16_t samplerate;
+    int64_t start;              // wall clock seconds of the first sample (see tm2wallclock)
+    uint32_t duration_sec;
+    uint64_t numRecords;
+    char serialID[SZ_SERIALID];
+    uint32_t numLevels;
+    uint64_t signalsOffset;     // STUDY_NUM_SIGNALS*numRecords floats
+    uint64_t usageOffset;       // STUDY_NUM_SIGNALS*numRecords int8_t
+    uint64_t levelOffsets[STUDY_MAX_LEVELS];   // per signal: levelBins minimums, then levelBins maximums
+    uint64_t levelBins[STUDY_MAX_LEVELS];
+    uint64_t samplesPerBin[STUDY_MAX_LEVELS];
+} study_segment_t;
+
+typedef struct study_entry_t{
+    char * filename;
+    int64_t mtime;
+    uint64_t fileSize;
+    char segmentName[SZ_STUDY_SEGMENT_NAME];
+    study_segment_t * segment;
+    uint64_t lastUsed;
+    unsigned int refCount;      // requests using the server's own mapping
+    bool isLoading;
+} study_entry_t;
+
+typedef struct study_cache_t{
+    pthread_mutex_t lock;
+    pthread_cond_t didLoad;
+    study_entry_t ** entries;
+    unsigned int numEntries;
+    unsigned int capacity;
+    uint64_t maxBytes;
+    uint64_t usedBytes;
+    uint64_t clock;
+    uint64_t numSegmentsCreated;
+} study_cache_t;
+
+// Decodes filename into a new shared memory segment, mapped read/write.
+study_segment_t * createStudySegment(const char * filename, const char * segmentName, char * errorMsg, size_t sz_errorMsg);
+// Maps an existing segment read only.  @retval NULL if it is gone or not a study segment.
+const study_segment_t * mapStudySegment(const char * segmentName);
+void unmapStudySegment(const study_segment_t * segment);
+
+const float * getStudySignal(const study_segment_t * segment, unsigned int signal);
+const int8_t * getStudyUsage(const study_segment_t * segment, unsigned int signal);
+// Bin minimums of a signal at a pyramid level; the maximums follow levelBins[level] later.
+const float * getStudyEnvelope(const study_segment_t * segment, unsigned int level, unsigned int signal);
+
+study_cache_t * createStudyCache(uint64_t maxBytes);
+// Returns the cached study for filename (keyed by its canonical path, see realpath),
+// decoding it first when it is not cached or the file has changed.  Concurrent requests for a study being decoded wait for it.  Each
+// successful call must be matched by releaseStudy.
+study_entry_t * acquireStudy(study_cache_t * cache, const char * filename, char * errorMsg, size_t sz_errorMsg);
+void releaseStudy(study_cache_t * cache, study_entry_t * entry);
+// Unlinks every segment.
+void freeStudyCache(study_cache_t * cache);
+
+#endif /* in_studycache_h */
@@ -0,0 +1,352 @@
+//
+//  studyloader.c
+//  Background loading of raw studies.  See studyloader.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "studyloader.h"
+#include "classifyusage.h"
+#include "in_parallel.h"
+
+#define DEFAULT_LOAD_WORKERS 2
+
+const char * LOAD_STATE_NAMES[NUM_LOAD_STATES] = {
+    "queued","decoding","summarizing","classifying","done","cancelled","failed"
+};
+
+typedef struct{
+    study_loader_t * loader;
+    loaded_study_t * study;
+} usage_job_t;
+
+static bool isFinished(load_state_t state){
+    return state==LOAD_DONE || state==LOAD_CANCELLED || state==LOAD_FAILED;
+}
+
+static void freeLoadedStudy(loaded_study_t * study){
+    free(study->filename);
+    free(study->signals);
+    free(study->usage);
+    free(study->overview.minimums);
+    free(study->overview.maximums);
+    free(study->overview.means);
+    free(study);
+}
+
+// Caller holds the lock.
+static void removeLoadedStudy(study_loader_t * loader, unsigned int index){
+    freeLoadedStudy(loader->studies[index]);
+    loader->studies[index] = loader->studies[--loader->numStudies];
+}
+
+// Drops finished studies no one holds: cancelled and failed ones, then the least recently
+// used done ones beyond maxKept.  Caller holds the lock.
+static void trimStudies(study_loader_t * loader){
+    unsigned int s, numKept = 0, oldest;
+    loaded_study_t * study;
+    for(s=0;s<loader->numStudies;){
+        study = loader->studies[s];
+        if(study->refCount==0 && (study->state==LOAD_CANCELLED || study->state==LOAD_FAILED)){
+            removeLoadedStudy(loader,s);
+        }
+        else{
+            numKept += study->refCount==0 && study->state==LOAD_DONE;
+            s++;
+        }
+    }
+    for(;numKept>loader->maxKept;numKept--){
+        oldest = loader->numStudies;
+        for(s=0;s<loader->numStudies;s++){
+            study = loader->studies[s];
+            if(study->refCount==0 && study->state==LOAD_DONE &&
+               (oldest==loader->numStudies || study->lastUsed<loader->studies[oldest]->lastUsed)){
+                oldest = s;
+            }
+        }
+        removeLoadedStudy(loader,oldest);
+    }
+}
+
+static void setLoadStage(study_loader_t * loader, loaded_study_t * study, load_state_t state, double progress){
+    pthread_mutex_lock(&loader->lock);
+    study->state = state;
+    study->progress = progress;
+    pthread_cond_broadcast(&loader->didChange);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+static void onSignalClassified(unsigned int signal, void * userData){
+    usage_job_t * job = (usage_job_t*)userData;
+    loaded_study_t * study = job->study;
+    (void)signal;
+    pthread_mutex_lock(&job->loader->lock);
+    study->progress += (1-LOAD_PROGRESS_SUMMARIZED)/LOAD_NUM_SIGNALS;
+    pthread_cond_broadcast(&job->loader->didChange);
+    pthread_mutex_unlock(&job->loader->lock);
+}
+
+static void buildOverview(loaded_study_t * study){
+    study_overview_t * overview = &study->overview;
+    uint64_t numRecords = study->info.recordCount, bin, i, stop;
+    unsigned int signal;
+    const float * samples;
+    float low, high;
+    double sum;
+
+    overview->secondsPerBin = LOAD_OVERVIEW_SECONDS;
+    overview->samplesPerBin = (uint64_t)study->info.samplerate*LOAD_OVERVIEW_SECONDS;
+    overview->numBins = (numRecords+overview->samplesPerBin-1)/overview->samplesPerBin;
+    overview->minimums = malloc(LOAD_NUM_SIGNALS*overview->numBins*sizeof(float));
+    overview->maximums = malloc(LOAD_NUM_SIGNALS*overview->numBins*sizeof(float));
+    overview->means = malloc(LOAD_NUM_SIGNALS*overview->numBins*sizeof(float));
+    for(signal=0;signal<LOAD_NUM_SIGNALS && study->keepRunning;signal++){
+        samples = study->signals+signal*numRecords;
+        for(bin=0;bin<overview->numBins;bin++){
+            low = INFINITY;
+            high = -INFINITY;
+            sum = 0;
+            stop = (bin+1)*overview->samplesPerBin<numRecords ? (bin+1)*overview->samplesPerBin : numRecords;
+            for(i=bin*overview->samplesPerBin;i<stop;i++){
+                low = fminf(low,samples[i]);
+                high = fmaxf(high,samples[i]);
+                sum += samples[i];
+            }
+            overview->minimums[signal*overview->numBins+bin] = low;
+            overview->maximums[signal*overview->numBins+bin] = high;
+            overview->means[signal*overview->numBins+bin] = (float)(sum/(double)(stop-bin*overview->samplesPerBin));
+        }
+    }
+}
+
+// Runs the stages of a load outside the lock; see studyloader.h.
+static void loadStudy(study_loader_t * loader, loaded_study_t * study){
+    float * accelerations, * signals[LOAD_NUM_SIGNALS];
+    int8_t * usage[LOAD_NUM_SIGNALS];
+    uint64_t numRecords;
+    unsigned int s;
+    usage_job_t job;
+
+    accelerations = loadRawAccelerations(study->filename,&study->info);
+    if(accelerations==NULL || study->info.recordCount==0){
+        free(accelerations);
+        pthread_mutex_lock(&loader->lock);
+        snprintf(study->errorMsg,SZ_LOAD_ERROR_MSG,"No data loaded from file (%s)",study->filename);
+        pthread_mutex_unlock(&loader->lock);
+        setLoadStage(loader,study,LOAD_FAILED,0);
+        return;
+    }
+    if(!study->keepRunning){
+        free(accelerations);
+        setLoadStage(loader,study,LOAD_CANCELLED,0);
+        return;
+    }
+    setLoadStage(loader,study,LOAD_SUMMARIZING,LOAD_PROGRESS_DECODED);
+
+    numRecords = study->info.recordCount;
+    study->signals = malloc(LOAD_NUM_SIGNALS*numRecords*sizeof(float));
+    study->usage = malloc(LOAD_NUM_SIGNALS*numRecords*sizeof(int8_t));
+    for(s=0;s<LOAD_NUM_SIGNALS;s++){
+        signals[s] = study->signals+s*numRecords;
+        usage[s] = study->usage+s*numRecords;
+    }
+    splitRawSignals(accelerations,numRecords,signals,&study->keepRunning);
+    free(accelerations);
+    if(study->keepRunning){
+        buildOverview(study);
+    }
+    if(!study->keepRunning){
+        setLoadStage(loader,study,LOAD_CANCELLED,0);
+        return;
+    }
+    pthread_mutex_lock(&loader->lock);
+    study->hasOverview = true;
+    pthread_mutex_unlock(&loader->lock);
+    setLoadStage(loader,study,LOAD_CLASSIFYING,LOAD_PROGRESS_SUMMARIZED);
+
+    job.loader = loader;
+    job.study = study;
+    if(!classifyRawUsage(signals,usage,numRecords,NULL,LOAD_NUM_SIGNALS,onSignalClassified,&job,&study->keepRunning)){
+        setLoadStage(loader,study,LOAD_CANCELLED,0);
+        return;
+    }
+    setLoadStage(loader,study,LOAD_DONE,1);
+}
+
+// Foreground loads first, then in order of request.  Caller holds the lock.
+static loaded_study_t * getNextQueued(study_loader_t * loader){
+    loaded_study_t * next = NULL, * study;
+    unsigned int s;
+    for(s=0;s<loader->numStudies;s++){
+        study = loader->studies[s];
+        if(study->state==LOAD_QUEUED && (next==NULL || (next->isPrefetch && !study->isPrefetch) ||
+                                         (next->isPrefetch==study->isPrefetch && study->sequence<next->sequence))){
+            next = study;
+        }
+    }
+    return next;
+}
+
+static void * runLoadWorker(void * userData){
+    study_loader_t * loader = (study_loader_t*)userData;
+    loaded_study_t * study;
+    pthread_mutex_lock(&loader->lock);
+    while(!loader->isShuttingDown){
+        if((study=getNextQueued(loader))==NULL){
+            pthread_cond_wait(&loader->hasWork,&loader->lock);
+            continue;
+        }
+        study->state = LOAD_DECODING;
+        study->refCount++;  // so it is not trimmed while it loads
+        pthread_cond_broadcast(&loader->didChange);
+        pthread_mutex_unlock(&loader->lock);
+
+        loadStudy(loader,study);
+
+        pthread_mutex_lock(&loader->lock);
+        study->refCount--;
+        study->lastUsed = ++loader->clock;
+        trimStudies(loader);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+study_loader_t * createStudyLoader(unsigned int numWorkers, unsigned int maxKept){
+    study_loader_t * loader = calloc(1,sizeof(study_loader_t));
+    unsigned int w;
+    pthread_mutex_init(&loader->lock,NULL);
+    pthread_cond_init(&loader->hasWork,NULL);
+    pthread_cond_init(&loader->didChange,NULL);
+    loader->maxKept = maxKept;
+    loader->numWorkers = numWorkers>0 ? numWorkers : DEFAULT_LOAD_WORKERS;
+    loader->workers = calloc(loader->numWorkers,sizeof(pthread_t));
+    for(w=0;w<loader->numWorkers;w++){
+        pthread_create(&loader->workers[w],NULL,runLoadWorker,loader);
+    }
+    return loader;
+}
+
+void freeStudyLoader(study_loader_t * loader){
+    unsigned int s, w;
+    if(loader==NULL){
+        return;
+    }
+    pthread_mutex_lock(&loader->lock);
+    loader->isShuttingDown = true;
+    for(s=0;s<loader->numStudies;s++){
+        loader->studies[s]->keepRunning = false;
+    }
+    pthread_cond_broadcast(&loader->hasWork);
+    pthread_mutex_unlock(&loader->lock);
+    for(w=0;w<loader->numWorkers;w++){
+        pthread_join(loader->workers[w],NULL);
+    }
+    for(s=0;s<loader->numStudies;s++){
+        freeLoadedStudy(loader->studies[s]);
+    }
+    free(loader->studies);
+    free(loader->workers);
+    pthread_cond_destroy(&loader->didChange);
+    pthread_cond_destroy(&loader->hasWork);
+    pthread_mutex_destroy(&loader->lock);
+    free(loader);
+}
+
+loaded_study_t * requestStudyLoad(study_loader_t * loader, const char * filename, bool isPrefetch, char * errorMsg, size_t sz_errorMsg){
+    struct stat status;
+    loaded_study_t * study = NULL, * candidate;
+    unsigned int s;
+    bool isCurrent;
+
+    if(stat(filename,&status)!=0){
+        snprintf(errorMsg,sz_errorMsg,"File not found (%s)",filename);
+        return NULL;
+    }
+    pthread_mutex_lock(&loader->lock);
+    for(s=0;s<loader->numStudies;){
+        candidate = loader->studies[s];
+        isCurrent = candidate->mtime==(int64_t)status.st_mtime && candidate->fileSize==(uint64_t)status.st_size;
+        if(strcmp(candidate->filename,filename)!=0){
+            s++;
+        }
+        else if(!isCurrent && candidate->refCount==0 && isFinished(candidate->state)){
+            // the file has changed since it was loaded
+            removeLoadedStudy(loader,s);
+        }
+        else{
+            if(isCurrent && candidate->keepRunning && candidate->state!=LOAD_FAILED){
+                study = candidate;
+            }
+            s++;
+        }
+    }
+    if(study==NULL){
+        study = calloc(1,sizeof(loaded_study_t));
+        study->filename = strdup(filename);
+        study->mtime = (int64_t)status.st_mtime;
+        study->fileSize = (uint64_t)status.st_size;
+        study->isPrefetch = true;
+        study->keepRunning = true;
+        study->state = LOAD_QUEUED;
+        study->sequence = ++loader->clock;
+        if(loader->numStudies==loader->capacity){
+            loader->capacity = loader->capacity>0 ? 2*loader->capacity : 16;
+            loader->studies = realloc(loader->studies,loader->capacity*sizeof(loaded_study_t*));
+        }
+        loader->studies[loader->numStudies++] = study;
+        pthread_cond_signal(&loader->hasWork);
+    }
+    study->lastUsed = ++loader->clock;
+    if(isPrefetch){
+        study = NULL;
+    }
+    else{
+        study->isPrefetch = false;  // a queued prefetch moves ahead of the others
+        study->refCount++;
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return study;
+}
+
+void releaseStudyLoad(study_loader_t * loader, loaded_study_t * study){
+    pthread_mutex_lock(&loader->lock);
+    study->refCount--;
+    study->lastUsed = ++loader->clock;
+    trimStudies(loader);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+void cancelStudyLoad(study_loader_t * loader, loaded_study_t * study){
+    pthread_mutex_lock(&loader->lock);
+    if(!isFinished(study->state)){
+        study->keepRunning = false;
+        if(study->state==LOAD_QUEUED){
+            study->state = LOAD_CANCELLED;
+            pthread_cond_broadcast(&loader->didChange);
+        }
+    }
+    pthread_mutex_unlock(&loader->lock);
+}
+
+void getStudyLoadStatus(study_loader_t * loader, const loaded_study_t * study, load_state_t * state, double * progress, bool * hasOverview){
+    pthread_mutex_lock(&loader->lock);
+    *state = study->state;
+    *progress = study->progress;
+    *hasOverview = study->hasOverview;
+    pthread_mutex_unlock(&loader->lock);
+}
+
+bool waitForStudyLoad(study_loader_t * loader, const loaded_study_t * study){
+    bool isDone;
+    pthread_mutex_lock(&loader->lock);
+    while(!isFinished(study->state)){
+        pthread_cond_wait(&loader->didChange,&loader->lock);
+    }
+    isDone = study->state==LOAD_DONE;
+    pthread_mutex_unlock(&loader->lock);
+    return isDone;
+}
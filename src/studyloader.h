@@ -0,0 +1,113 @@
+//
+//  studyloader.h
+//  Background loading of raw studies (Padaco .bin or ActiGraph raw .csv files) on a small
+//  pool of worker threads, so a session can keep working, show partial results, cancel a
+//  load or have the next studies of a folder decoded before they are opened.
+//
+//  A load goes through these stages, each published as soon as it completes:
+//  - decoding: the file is decoded with loadRawAccelerations (progress cannot be reported
+//    inside this stage; it moves from 0 to LOAD_PROGRESS_DECODED when it finishes).
+//  - summarizing: the x, y, z and vector magnitude signals are laid out signal by signal
+//    and a coarse overview is built: minimum, maximum and mean of each signal per
+//    LOAD_OVERVIEW_SECONDS bin (the last bin may be partial).  The overview can be read
+//    from here on.
+//  - classifying: usage states of each signal (classifyUsageState with the default rules,
+//    stuck axes propagated to vecMag), as the study server does (see studycache.h).
+//  A load's cancellation token (keepRunning) is checked between stages and between the
+//  blocks and signals within them.
+//
+//  Requests for the same file share one load.  Foreground requests are started before
+//  prefetches.  Finished studies no one holds are kept, least recently used first out,
+//  up to maxKept of them, so a prefetched study is ready when it is opened.
+//
+
+#ifndef in_studyloader_h
+#define in_studyloader_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "rawtools.h"
+
+#define LOAD_NUM_SIGNALS 4          // x, y, z, vecMag
+#define LOAD_OVERVIEW_SECONDS 3600
+#define LOAD_PROGRESS_DECODED 0.5
+#define LOAD_PROGRESS_SUMMARIZED 0.6
+#define SZ_LOAD_ERROR_MSG 256
+
+typedef enum{
+    LOAD_QUEUED = 0,
+    LOAD_DECODING,
+    LOAD_SUMMARIZING,
+    LOAD_CLASSIFYING,
+    LOAD_DONE,
+    LOAD_CANCELLED,
+    LOAD_FAILED,
+    NUM_LOAD_STATES
+} load_state_t;
+
+extern const char * LOAD_STATE_NAMES[NUM_LOAD_STATES];
+
+typedef struct study_overview_t{
+    uint32_t secondsPerBin;
+    uint64_t samplesPerBin;
+    uint64_t numBins;
+    float * minimums;   // LOAD_NUM_SIGNALS*numBins, signal by signal
+    float * maximums;
+    float * means;
+} study_overview_t;
+
+typedef struct loaded_study_t{
+    char * filename;
+    int64_t mtime;
+    uint64_t fileSize;
+    bool isPrefetch;
+    volatile bool keepRunning;  // cancellation token
+    unsigned int refCount;
+    uint64_t lastUsed;
+    uint64_t sequence;          // order of request, for the queue
+
+    // under the loader's lock
+    load_state_t state;
+    double progress;
+    bool hasOverview;
+    char errorMsg[SZ_LOAD_ERROR_MSG];
+
+    // complete once state is LOAD_DONE (overview once hasOverview)
+    raw_info_t info;
+    float * signals;            // LOAD_NUM_SIGNALS*info.recordCount, signal by signal
+    int8_t * usage;             // same layout
+    study_overview_t overview;
+} loaded_study_t;
+
+typedef struct study_loader_t{
+    pthread_mutex_t lock;
+    pthread_cond_t hasWork;
+    pthread_cond_t didChange;
+    pthread_t * workers;
+    unsigned int numWorkers;
+    loaded_study_t ** studies;
+    unsigned int numStudies;
+    unsigned int capacity;
+    unsigned int maxKept;
+    uint64_t clock;
+    bool isShuttingDown;
+} study_loader_t;
+
+// numWorkers 0 => 2 (one foreground load alongside one prefetch).
+study_loader_t * createStudyLoader(unsigned int numWorkers, unsigned int maxKept);
+// Cancels every load, waits for the workers and frees every study.
+void freeStudyLoader(study_loader_t * loader);
+
+// Queues filename unless a load of the file as it is now is already queued, running or
+// done.  Foreground requests hold the study until releaseStudyLoad; prefetches hold
+// nothing and return NULL.  @retval NULL (with errorMsg) if filename cannot be read.
+loaded_study_t * requestStudyLoad(study_loader_t * loader, const char * filename, bool isPrefetch, char * errorMsg, size_t sz_errorMsg);
+void releaseStudyLoad(study_loader_t * loader, loaded_study_t * study);
+void cancelStudyLoad(study_loader_t * loader, loaded_study_t * study);
+
+void getStudyLoadStatus(study_loader_t * loader, const loaded_study_t * study, load_state_t * state, double * progress, bool * hasOverview);
+// Blocks until the load finishes.  @retval true if the study is done (not cancelled or failed).
+bool waitForStudyLoad(study_loader_t * loader, const loaded_study_t * study);
+
+#endif /* in_studyloader_h */
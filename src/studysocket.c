@@ -0,0 +1,95 @@
+//
+//  studysocket.c
+//  Study server protocol helpers.  See studysocket.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "studysocket.h"
+
+void getStudySocketPath(char * socketPath, size_t sz_socketPath){
+    const char * environmentPath = getenv(STUDY_SOCKET_ENV);
+    if(environmentPath!=NULL && environmentPath[0]!='\0'){
+        snprintf(socketPath,sz_socketPath,"%s",environmentPath);
+    }
+    else{
+        snprintf(socketPath,sz_socketPath,"/tmp/padacod.%u.sock",(unsigned int)getuid());
+    }
+}
+
+int connectStudyServer(const char * socketPath){
+    struct sockaddr_un address;
+    int fd;
+    if(strlen(socketPath)>=sizeof(address.sun_path) || (fd=socket(AF_UNIX,SOCK_STREAM,0))<0){
+        return -1;
+    }
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path,socketPath);
+    if(connect(fd,(struct sockaddr*)&address,sizeof(address))!=0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendStudyBytes(int fd, const void * bytes, size_t numBytes){
+    const uint8_t * cursor = bytes;
+    ssize_t numSent;
+    while(numBytes>0){
+        numSent = send(fd,cursor,numBytes,0);
+        if(numSent<0 && errno==EINTR){
+            continue;
+        }
+        if(numSent<=0){
+            return false;
+        }
+        cursor += numSent;
+        numBytes -= (size_t)numSent;
+    }
+    return true;
+}
+
+bool recvStudyBytes(int fd, void * bytes, size_t numBytes){
+    uint8_t * cursor = bytes;
+    ssize_t numReceived;
+    while(numBytes>0){
+        numReceived = recv(fd,cursor,numBytes,0);
+        if(numReceived<0 && errno==EINTR){
+            continue;
+        }
+        if(numReceived<=0){
+            return false;
+        }
+        cursor += numReceived;
+        numBytes -= (size_t)numReceived;
+    }
+    return true;
+}
+
+bool requestStudyServer(const study_request_t * request, study_response_t * response, void ** payload){
+    char socketPath[SZ_STUDY_FILENAME];
+    bool didRequest;
+    int fd;
+    *payload = NULL;
+    getStudySocketPath(socketPath,sizeof(socketPath));
+    if((fd=connectStudyServer(socketPath))<0){
+        return false;
+    }
+    didRequest = sendStudyBytes(fd,request,sizeof(study_request_t)) && recvStudyBytes(fd,response,sizeof(study_response_t)) &&
+                 response->magic==STUDY_PROTOCOL_MAGIC;
+    if(didRequest && response->payloadSize>0){
+        *payload = malloc(response->payloadSize);
+        if(!(didRequest=recvStudyBytes(fd,*payload,response->payloadSize))){
+            free(*payload);
+            *payload = NULL;
+        }
+    }
+    close(fd);
+    return didRequest;
+}
@@ -0,0 +1,61 @@
+//
+//  studysocket.h
+//  Unix domain socket protocol between the padacod study server and its clients.
+//
+//  Each request is one study_request_t and is answered by one study_response_t, followed by
+//  payloadSize bytes of results.  STUDY_OPEN makes sure the study is decoded and returns the
+//  name of its shared memory segment (see studycache.h), which the client maps to read
+//  window slices, envelopes and usage vectors directly.  STUDY_FEATURES returns the frame
+//  features of all four signals (numFrames doubles per signal, signal by signal).
+//
+//  The socket is $PADACO_STUDY_SOCKET when set, otherwise /tmp/padacod.<uid>.sock.
+//
+
+#ifndef in_studysocket_h
+#define in_studysocket_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "studycache.h"
+
+#define STUDY_SOCKET_ENV "PADACO_STUDY_SOCKET"
+#define STUDY_PROTOCOL_MAGIC 0x50414453  // "PADS"
+#define SZ_STUDY_FILENAME 4096
+#define SZ_STUDY_MESSAGE 512
+
+typedef enum{
+    STUDY_PING = 0,
+    STUDY_OPEN,
+    STUDY_FEATURES,
+    NUM_STUDY_COMMANDS,
+    STUDY_UNKNOWN = -1
+} study_command_t;
+
+typedef struct{
+    uint32_t magic;
+    int32_t command;
+    char filename[SZ_STUDY_FILENAME];
+    int32_t featureID;          // feature_id_t (STUDY_FEATURES)
+    uint32_t frameDurationSec;  // (STUDY_FEATURES)
+} study_request_t;
+
+typedef struct{
+    uint32_t magic;
+    bool didSucceed;
+    char message[SZ_STUDY_MESSAGE];     // error description when !didSucceed
+    char segmentName[SZ_STUDY_SEGMENT_NAME];
+    uint64_t numFrames;
+    uint64_t payloadSize;
+} study_response_t;
+
+void getStudySocketPath(char * socketPath, size_t sz_socketPath);
+// @retval -1 when no server is listening.
+int connectStudyServer(const char * socketPath);
+bool sendStudyBytes(int fd, const void * bytes, size_t numBytes);
+bool recvStudyBytes(int fd, void * bytes, size_t numBytes);
+// Connects, sends request and receives the response and payload (malloc'd; may be NULL).
+// @retval false when the server could not be reached; response->didSucceed reports errors.
+bool requestStudyServer(const study_request_t * request, study_response_t * response, void ** payload);
+
+#endif /* in_studysocket_h */
@@ -0,0 +1,247 @@
+/*
+ * studystore.c - reads and writes embedded study stores (see columnstore.h): person-day
+ * cluster membership, outcomes and covariates in one indexed file per study.
+ *
+ * The calling syntax is:
+ *
+ *		studystore('write', filename, tables)
+ *		names = studystore('columns', filename, tableName)
+ *		values = studystore('join', filename, tableName, keys, columnNames)
+ *		[counts, keys] = studystore('memberships', filename, numClusters, keys, weekdays, excludeNonwear)
+ *
+ * tables is a struct whose fields are tables; each table is a struct of equal length numeric
+ * column vectors, one of which is studyID (the key).  A dayOfWeek column, when present, is
+ * indexed as well.  'join' returns, for each key, the first matching row of the named
+ * columns (cell of strings) of tableName; NaN where no row matches.  'memberships' counts
+ * the person-days of each study (rows) in each cluster (columns) from the persondays table,
+ * using its cluster and nonwear columns, over the given weekdays (0 to 6).  Pass keys as []
+ * for every study in the store, in which case the studies counted are returned as keys.
+ *
+ * The last store opened is kept until its file changes.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O studystore.c columnstore.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "mex.h"
+#include "columnstore.h"
+
+#define KEY_COLUMN_NAME "studyID"
+#define WEEKDAY_COLUMN_NAME "dayOfWeek"
+
+static study_store_t * openStore = NULL;
+static char * openFilename = NULL;
+static struct stat openStat;
+
+static void closeStore(void){
+    freeStudyStore(openStore);
+    openStore = NULL;
+    mxFree(openFilename);
+    openFilename = NULL;
+}
+
+static const study_store_t * getStore(const char * filename){
+    struct stat fileStat;
+    if(stat(filename,&fileStat)!=0) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:missing",
+                "Study store not found (%s).",filename);
+    }
+    if(openStore!=NULL && strcmp(openFilename,filename)==0 && fileStat.st_mtime==openStat.st_mtime && fileStat.st_size==openStat.st_size) {
+        return openStore;
+    }
+    closeStore();
+    if((openStore=openStudyStore(filename))==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:open",
+                "Could not read study store %s.",filename);
+    }
+    openFilename = mxMalloc(strlen(filename)+1);
+    mexMakeMemoryPersistent(openFilename);
+    strcpy(openFilename,filename);
+    openStat = fileStat;
+    return openStore;
+}
+
+static const store_table_t * getTable(const study_store_t * store, const mxArray * nameArray){
+    const store_table_t * table;
+    char * name = mxArrayToString(nameArray);
+    if(name==NULL || (table=getStoreTable(store,name))==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:table",
+                "Study store has no table named %s.",name==NULL ? "" : name);
+    }
+    mxFree(name);
+    return table;
+}
+
+static void writeStore(const char * filename, const mxArray * tables){
+    store_table_spec_t * specs;
+    const mxArray * table, * column;
+    unsigned int t, c, numTables;
+    bool didWrite;
+
+    if(!mxIsStruct(tables) || mxGetNumberOfElements(tables)!=1) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:tables",
+                "Tables must be a scalar struct of table structs.");
+    }
+    numTables = (unsigned int)mxGetNumberOfFields(tables);
+    specs = mxCalloc(numTables>0 ? numTables : 1,sizeof(store_table_spec_t));
+    for(t=0;t<numTables;t++) {
+        table = mxGetFieldByNumber(tables,0,(int)t);
+        if(table==NULL || !mxIsStruct(table) || mxGetNumberOfElements(table)!=1) {
+            mexErrMsgIdAndTxt("PadacoToolbox:studystore:tables",
+                    "Table %s must be a scalar struct of column vectors.",mxGetFieldNameByNumber(tables,(int)t));
+        }
+        specs[t].name = mxGetFieldNameByNumber(tables,(int)t);
+        specs[t].numColumns = (unsigned int)mxGetNumberOfFields(table);
+        specs[t].columnNames = mxCalloc(specs[t].numColumns>0 ? specs[t].numColumns : 1,sizeof(char*));
+        specs[t].columns = mxCalloc(specs[t].numColumns>0 ? specs[t].numColumns : 1,sizeof(double*));
+        specs[t].keyName = KEY_COLUMN_NAME;
+        for(c=0;c<specs[t].numColumns;c++) {
+            column = mxGetFieldByNumber(table,0,(int)c);
+            specs[t].columnNames[c] = mxGetFieldNameByNumber(table,(int)c);
+            if(column==NULL || !mxIsDouble(column) || mxIsComplex(column) ||
+               (c>0 && mxGetNumberOfElements(column)!=specs[t].numRows)) {
+                mexErrMsgIdAndTxt("PadacoToolbox:studystore:column",
+                        "Column %s.%s must be a real double vector as long as the table's other columns.",specs[t].name,specs[t].columnNames[c]);
+            }
+            specs[t].numRows = mxGetNumberOfElements(column);
+            specs[t].columns[c] = mxGetPr(column);
+            if(strcmp(specs[t].columnNames[c],WEEKDAY_COLUMN_NAME)==0) {
+                specs[t].weekdayName = WEEKDAY_COLUMN_NAME;
+            }
+        }
+    }
+    didWrite = writeStudyStore(filename,specs,numTables);
+    for(t=0;t<numTables;t++) {
+        mxFree(specs[t].columnNames);
+        mxFree(specs[t].columns);
+    }
+    mxFree(specs);
+    if(!didWrite) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:write",
+                "Could not write study store %s (each table needs a %s column).",filename,KEY_COLUMN_NAME);
+    }
+}
+
+static mxArray * getColumnNames(const store_table_t * table){
+    mxArray * names = mxCreateCellMatrix(table->header.numColumns,1);
+    char name[SZ_STORE_NAME+1];
+    unsigned int c;
+    for(c=0;c<table->header.numColumns;c++) {
+        memcpy(name,table->columnNames[c],SZ_STORE_NAME);
+        name[SZ_STORE_NAME] = '\0';
+        mxSetCell(names,c,mxCreateString(name));
+    }
+    return names;
+}
+
+static mxArray * joinColumns(const store_table_t * table, const mxArray * keys, const mxArray * columnNames){
+    unsigned int c, numColumns;
+    int * columns;
+    char * name;
+    mxArray * values;
+
+    if(!mxIsDouble(keys) || !mxIsCell(columnNames)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:join",
+                "Keys must be double and column names a cell of strings.");
+    }
+    numColumns = (unsigned int)mxGetNumberOfElements(columnNames);
+    columns = mxCalloc(numColumns>0 ? numColumns : 1,sizeof(int));
+    for(c=0;c<numColumns;c++) {
+        name = mxArrayToString(mxGetCell(columnNames,c));
+        if(name==NULL || (columns[c]=getStoreColumn(table,name))<0) {
+            mexErrMsgIdAndTxt("PadacoToolbox:studystore:column",
+                    "Table %s has no column named %s.",table->header.name,name==NULL ? "" : name);
+        }
+        mxFree(name);
+    }
+    values = mxCreateDoubleMatrix(mxGetNumberOfElements(keys),numColumns,mxREAL);
+    joinStoreColumns(table,mxGetPr(keys),mxGetNumberOfElements(keys),columns,numColumns,mxGetPr(values));
+    mxFree(columns);
+    return values;
+}
+
+static void countMemberships(const study_store_t * store, int nlhs, mxArray * plhs[], const mxArray * prhs[]){
+    const store_table_t * table = getStoreTable(store,STORE_PERSONDAYS_TABLE);
+    double numClusters = mxGetScalar(prhs[2]), * weekdays, * keys = NULL;
+    uint64_t numKeys;
+    unsigned int weekdayMask = 0;
+    size_t d;
+
+    if(table==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:table",
+                "Study store has no %s table.",STORE_PERSONDAYS_TABLE);
+    }
+    if(numClusters<1 || !mxIsDouble(prhs[3]) || !mxIsDouble(prhs[4])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:memberships",
+                "numClusters must be positive and keys and weekdays double.");
+    }
+    weekdays = mxGetPr(prhs[4]);
+    for(d=0;d<mxGetNumberOfElements(prhs[4]);d++) {
+        if(weekdays[d]>=0 && weekdays[d]<STORE_NUM_WEEKDAYS) {
+            weekdayMask |= 1u<<(unsigned int)weekdays[d];
+        }
+    }
+    if(mxIsEmpty(prhs[3])) {
+        numKeys = table->header.numKeys;
+    }
+    else {
+        keys = mxGetPr(prhs[3]);
+        numKeys = mxGetNumberOfElements(prhs[3]);
+    }
+    plhs[0] = mxCreateDoubleMatrix((size_t)numKeys,(size_t)numClusters,mxREAL);
+    if(!countClusterMembership(table,keys,numKeys,(unsigned int)numClusters,weekdayMask,mxGetScalar(prhs[5])!=0,mxGetPr(plhs[0]))) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:memberships",
+                "The %s table needs cluster, nonwear and %s columns for this count.",STORE_PERSONDAYS_TABLE,WEEKDAY_COLUMN_NAME);
+    }
+    if(nlhs > 1) {
+        plhs[1] = mxCreateDoubleMatrix((size_t)numKeys,1,mxREAL);
+        memcpy(mxGetPr(plhs[1]),keys==NULL ? table->keys : keys,(size_t)numKeys*sizeof(double));
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    char * command, * filename;
+    const study_store_t * store;
+
+    mexAtExit(closeStore);
+    if(nrhs < 3 || !mxIsChar(prhs[0])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:nrhs",
+                "A command, a filename and the command's arguments are required inputs.");
+    }
+    command = mxArrayToString(prhs[0]);
+    if((filename=mxArrayToString(prhs[1]))==NULL) {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:notString",
+                "Filename must be a string.");
+    }
+    if(strcmp(command,"write")==0 && nrhs==3) {
+        if(openFilename!=NULL && strcmp(openFilename,filename)==0) {
+            closeStore();
+        }
+        writeStore(filename,prhs[2]);
+    }
+    else if(strcmp(command,"columns")==0 && nrhs==3) {
+        store = getStore(filename);
+        plhs[0] = getColumnNames(getTable(store,prhs[2]));
+    }
+    else if(strcmp(command,"join")==0 && nrhs==5) {
+        store = getStore(filename);
+        plhs[0] = joinColumns(getTable(store,prhs[2]),prhs[3],prhs[4]);
+    }
+    else if(strcmp(command,"memberships")==0 && nrhs==6) {
+        store = getStore(filename);
+        countMemberships(store,nlhs,plhs,prhs);
+    }
+    else {
+        mexErrMsgIdAndTxt("PadacoToolbox:studystore:command",
+                "Unknown command (%s) or wrong number of inputs.",command);
+    }
+    mxFree(filename);
+    mxFree(command);
+}
@@ -0,0 +1,79 @@
+// gcc testcalibrate.c calibrate.c rawcodec.c rawtools.c in_parallel.c in_system.c -lm -lpthread -o testcalibrate
+// Regression tests for auto-calibration (see calibrate.h): a known per axis offset and scale
+// are recovered from still windows, and calibrated samples no longer compress, which is why
+// rawcsv2rawbin refuses -k with -z.  Prints each check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "calibrate.h"
+#include "rawcodec.h"
+#include "testcheck.h"
+
+#define SAMPLERATE 30
+#define NUM_ORIENTATIONS 26
+#define WINDOWS_PER_ORIENTATION 2
+#define NUM_RECORDS (NUM_ORIENTATIONS*WINDOWS_PER_ORIENTATION*CALIBRATION_WINDOW_SEC*SAMPLERATE)
+
+static const double OFFSET[CALIBRATION_AXES] = {0.02, -0.03, 0.015};
+static const double SCALE[CALIBRATION_AXES] = {1.01, 0.98, 1.02};
+
+// Still recordings in orientations spread over the unit sphere, as a device measuring with
+// the errors OFFSET and SCALE would report them on the three decimal .csv grid.
+static void simulateStillRecording(float * xyz){
+    unsigned int o, r, axis, recordsPerOrientation = NUM_RECORDS/NUM_ORIENTATIONS;
+    double theta, phi, gravity[CALIBRATION_AXES], noise;
+    srand(11);
+    for(o=0;o<NUM_ORIENTATIONS;o++){
+        theta = acos(1-2*(o+0.5)/NUM_ORIENTATIONS);
+        phi = o*2.399963;  // golden angle
+        gravity[0] = sin(theta)*cos(phi);
+        gravity[1] = sin(theta)*sin(phi);
+        gravity[2] = cos(theta);
+        for(r=0;r<recordsPerOrientation;r++){
+            for(axis=0;axis<CALIBRATION_AXES;axis++){
+                noise = ((double)rand()/RAND_MAX-0.5)*0.01;
+                xyz[(o*recordsPerOrientation+r)*3+axis] = (float)(round((gravity[axis]+noise-OFFSET[axis])/SCALE[axis]*1000)/1000);
+            }
+        }
+    }
+}
+
+static bool isRecovered(const calibration_t * calibration){
+    unsigned int axis;
+    for(axis=0;axis<CALIBRATION_AXES;axis++){
+        if(fabs(calibration->offset[axis]-OFFSET[axis])>0.002 || fabs(calibration->scale[axis]-SCALE[axis])>0.002){
+            fprintf(stderr,"axis %u: offset %g (%g), scale %g (%g)\n",axis,calibration->offset[axis],OFFSET[axis],
+                    calibration->scale[axis],SCALE[axis]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void){
+    float * xyz = malloc(NUM_RECORDS*3*sizeof(float));
+    calibrator_t * calibrator;
+    calibration_t calibration;
+    uint8_t * encoded;
+    uint64_t sz_raw = 0, sz_calibrated = 0, sz_verbatim = (uint64_t)NUM_RECORDS*3*sizeof(float);
+
+    simulateStillRecording(xyz);
+    calibrator = createCalibrator(SAMPLERATE,0,0);
+    addCalibrationSamples(calibrator,xyz,NULL,NUM_RECORDS);
+    check(calibrator->numWindows==NUM_ORIENTATIONS*WINDOWS_PER_ORIENTATION,"every window is still");
+    check(fitCalibration(calibrator,&calibration) && calibration.didCalibrate,"calibration accepted");
+    check(isRecovered(&calibration) && calibration.errorAfter<calibration.errorBefore,"offset and scale recovered");
+    freeCalibrator(calibrator);
+
+    encoded = encodeRawPayload(xyz,3,NUM_RECORDS,1,&sz_raw);
+    free(encoded);
+    applyCalibration(&calibration,xyz,NULL,NUM_RECORDS);
+    encoded = encodeRawPayload(xyz,3,NUM_RECORDS,1,&sz_calibrated);
+    free(encoded);
+    check(sz_raw>0 && sz_raw<sz_verbatim/2,"samples on the .csv grid compress");
+    check(sz_calibrated>sz_verbatim,"calibrated samples are stored verbatim, larger than uncompressed");
+
+    free(xyz);
+    return numFailed;
+}
@@ -0,0 +1,108 @@
+// gcc testcatalog.c catalog.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testcatalog
+// Regression tests for the recording catalog (see catalog.h): header parsing, saving and
+// loading paths with spaces, and rescans that reparse only new or changed recordings.
+// Prints each check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "catalog.h"
+#include "testcheck.h"
+
+#define NUM_ROWS 80
+
+static bool writeCSV(const char * filename, unsigned int numRows){
+    unsigned int r;
+    FILE * fid = fopen(filename,"w");
+    if(fid==NULL){
+        return false;
+    }
+    fprintf(fid,"------------ Data File Created By ActiGraph GT3X+ ActiLife v6.11.8 Firmware v1.5.0 date format M/d/yyyy at 40 Hz  Filter Normal -----------\n"
+            "Serial Number: MOS2B21140207\n"
+            "Start Time 00:00:00\n"
+            "Start Date 12/9/2015\n"
+            "Epoch Period (hh:mm:ss) 00:00:00\n"
+            "Download Time 10:07:01\n"
+            "Download Date 12/17/2015\n"
+            "Current Memory Address: 0\n"
+            "Current Battery Voltage: 3.93     Mode = 12\n"
+            "--------------------------------------------------\n"
+            "Timestamp,Accelerometer X,Accelerometer Y,Accelerometer Z\n");
+    for(r=0;r<numRows;r++){
+        fprintf(fid,"12/9/2015 00:00:%02u.%03u,0.359,-0.106,0.890\n",r/40,(r%40)*25);
+    }
+    return fclose(fid)==0;
+}
+
+static catalog_entry_t * findEntry(recording_catalog_t * catalog, const char * path){
+    unsigned int e;
+    for(e=0;e<catalog->count;e++){
+        if(strcmp(catalog->entries[e].path,path)==0){
+            return &catalog->entries[e];
+        }
+    }
+    return NULL;
+}
+
+int main(void){
+    char root[] = "/tmp/padaco catalog XXXXXX", studyDir[64], csvFilename[128], junkFilename[128], catalogFilename[128];
+    recording_catalog_t catalog, loaded;
+    catalog_update_t summary;
+    catalog_entry_t * csv, * junk, * loadedCSV, * loadedJunk;
+    struct tm startTime;
+    FILE * fid;
+
+    if(mkdtemp(root)==NULL){
+        fprintf(stderr,"Could not create a temporary directory\n");
+        return -1;
+    }
+    snprintf(studyDir,sizeof(studyDir),"%s/study one",root);
+    snprintf(csvFilename,sizeof(csvFilename),"%s/day 1.csv",studyDir);
+    snprintf(junkFilename,sizeof(junkFilename),"%s/junk.bin",root);
+    snprintf(catalogFilename,sizeof(catalogFilename),"%s/%s",root,CATALOG_FILENAME);
+    mkdir(studyDir,0700);
+    writeCSV(csvFilename,NUM_ROWS);
+    if((fid=fopen(junkFilename,"w"))!=NULL){
+        fprintf(fid,"not a recording");
+        fclose(fid);
+    }
+
+    memset(&catalog,0,sizeof(catalog));
+    check(updateCatalog(&catalog,root,2,&summary) && summary.numFound==2 && summary.numParsed==2,"first scan parses every recording");
+    csv = findEntry(&catalog,csvFilename);
+    junk = findEntry(&catalog,junkFilename);
+    memset(&startTime,0,sizeof(startTime));
+    startTime.tm_year = 2015-1900;
+    startTime.tm_mon = 11;
+    startTime.tm_mday = 9;
+    check(csv!=NULL && csv->isValid && csv->type==RECORDING_CSV && csv->samplerate==40 &&
+          strcmp(csv->serialID,"MOS2B21140207")==0 && csv->start==tm2wallclock(&startTime),".csv header");
+    check(csv!=NULL && !csv->isDurationEstimated && csv->duration_sec>1.999 && csv->duration_sec<2.001,".csv duration from its last timestamp");
+    check(junk!=NULL && !junk->isValid && junk->start==UNKNOWN_START,"unrecognised .bin header");
+
+    check(saveCatalog(catalogFilename,&catalog) && loadCatalog(catalogFilename,&loaded) && loaded.count==catalog.count,"save and load");
+    loadedCSV = findEntry(&loaded,csvFilename);
+    loadedJunk = findEntry(&loaded,junkFilename);
+    check(loadedCSV!=NULL && csv!=NULL && loadedCSV->mtime==csv->mtime && loadedCSV->size==csv->size && loadedCSV->isValid &&
+          loadedCSV->start==csv->start && loadedCSV->samplerate==csv->samplerate && strcmp(loadedCSV->serialID,csv->serialID)==0,
+          "loaded entry with spaces in its path");
+    check(loadedJunk!=NULL && !loadedJunk->isValid && loadedJunk->start==UNKNOWN_START,"loaded entry without a start");
+    freeCatalog(&catalog);
+
+    check(updateCatalog(&loaded,root,2,&summary) && summary.numFound==2 && summary.numParsed==0 && summary.numRemoved==0,
+          "unchanged recordings are not reparsed");
+    writeCSV(csvFilename,2*NUM_ROWS);
+    remove(junkFilename);
+    check(updateCatalog(&loaded,root,2,&summary) && summary.numFound==1 && summary.numParsed==1 && summary.numRemoved==1,
+          "changed recordings are reparsed and removed ones dropped");
+    loadedCSV = findEntry(&loaded,csvFilename);
+    check(loadedCSV!=NULL && loadedCSV->duration_sec>3.999 && loadedCSV->duration_sec<4.001,"changed .csv duration");
+    freeCatalog(&loaded);
+
+    remove(csvFilename);
+    remove(catalogFilename);
+    rmdir(studyDir);
+    rmdir(root);
+    return numFailed;
+}
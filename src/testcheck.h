@@ -0,0 +1,21 @@
+//
+//  testcheck.h
+//  Check reporting shared by the regression tests (test*.c), each a single translation
+//  unit: check prints PASS or FAIL with its description and counts the failures, which
+//  main returns.
+//
+
+#ifndef in_testcheck_h
+#define in_testcheck_h
+
+#include <stdbool.h>
+#include <stdio.h>
+
+static int numFailed = 0;
+
+static void check(bool passed, const char * description){
+    printf("%s\t%s\n",passed ? "PASS" : "FAIL",description);
+    numFailed += passed ? 0 : 1;
+}
+
+#endif /* in_testcheck_h */
@@ -0,0 +1,59 @@
+// gcc testcustomraw.c customraw.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testcustomraw
+// Regression tests for the custom raw format parser (see customraw.h).  Prints each check
+// and returns the number that failed.
+#include <math.h>
+#include "customraw.h"
+#include "rawtools.h"
+#include "testcheck.h"
+
+static bool parseText(const char * text, unsigned int numWorkers, custom_raw_t * parsed){
+    custom_raw_format_t format;
+    char filename[] = "/tmp/testcustomrawXXXXXX";
+    int fd = mkstemp(filename);
+    FILE * fid = fd<0 ? NULL : fdopen(fd,"w");
+    bool didParse;
+    if(fid==NULL){
+        return false;
+    }
+    fputs(text,fid);
+    fclose(fid);
+    didParse = compileCustomRawFormat(1,2,3,4,",",1,TIME_ELAPSED,NULL,&format) &&
+               loadCustomRawFile(filename,&format,numWorkers,parsed);
+    remove(filename);
+    return didParse;
+}
+
+static bool hasRow(const custom_raw_t * parsed, uint64_t row, double seconds, float x, float y, float z){
+    return parsed->micros[row]==CUSTOM_RAW_ELAPSED_ORIGIN*MICROS_PER_SECOND+llround(seconds*MICROS_PER_SECOND) &&
+           parsed->xyz[row]==x && parsed->xyz[parsed->numRows+row]==y && parsed->xyz[2*parsed->numRows+row]==z;
+}
+
+int main(void){
+    custom_raw_t parsed;
+    unsigned int numWorkers;
+
+    for(numWorkers=1;numWorkers<=4;numWorkers+=3){
+        check(parseText("time,x,y,z\n0.0,1,2,3\n0.0125,4,5,6\n",numWorkers,&parsed) && parsed.numRows==2 &&
+              hasRow(&parsed,0,0,1,2,3) && hasRow(&parsed,1,0.0125,4,5,6),"well formed rows");
+        freeCustomRaw(&parsed);
+
+        // an empty trailing field must not read the next line's first number
+        check(parseText("time,x,y,z\n0.0,1,2,\n0.0125,4,5,6\n",numWorkers,&parsed) && parsed.numRows==1 &&
+              parsed.numDropped==1 && hasRow(&parsed,0,0.0125,4,5,6),"empty trailing field drops its row");
+        freeCustomRaw(&parsed);
+
+        check(parseText("time,x,y,z\n0.0,,2,3\n0.0125,4,5,6\n",numWorkers,&parsed) && parsed.numRows==1 &&
+              hasRow(&parsed,0,0.0125,4,5,6),"empty middle field drops its row");
+        freeCustomRaw(&parsed);
+
+        // blank lines are dropped, not merged with the line that follows
+        check(parseText("time,x,y,z\n0.0,1,2,3\n\n0.0125,4,5,6\n\r\n0.025,7,8,9\n",numWorkers,&parsed) && parsed.numRows==3 &&
+              hasRow(&parsed,0,0,1,2,3) && hasRow(&parsed,1,0.0125,4,5,6) && hasRow(&parsed,2,0.025,7,8,9),"blank lines are dropped");
+        freeCustomRaw(&parsed);
+
+        check(parseText("time,x,y,z\r\n0.0,-1.5e-1,nan,3\r\n",numWorkers,&parsed) && parsed.numRows==1 &&
+              parsed.xyz[0]==-0.15f && isnan(parsed.xyz[1]) && parsed.xyz[2]==3,"exponents, nan and CRLF");
+        freeCustomRaw(&parsed);
+    }
+    return numFailed;
+}
@@ -0,0 +1,79 @@
+// gcc testepochsummary.c epochsummary.c -lm -o testepochsummary
+// Regression tests for the per second summary (see epochsummary.h): the statistics of known
+// seconds, samples added block by block, the dropped partial second and the .sec file
+// round trip.  Prints each check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "epochsummary.h"
+#include "testcheck.h"
+
+#define SAMPLERATE 4
+#define NUM_SAMPLES (3*SAMPLERATE+2)
+
+static bool isNear(double value, double expected){
+    return fabs(value-expected)<1e-5;
+}
+
+int main(void){
+    float xyz[3*NUM_SAMPLES];
+    char filename[] = "/tmp/testepochsummaryXXXXXX", sidecarFilename[64];
+    epoch_summarizer_t * summarizer, * blockwise;
+    epoch_summary_header_t header;
+    epoch_second_t * seconds, * second;
+    unsigned int s;
+    int fd;
+
+    // Second 1: still, x = 1 g.  Second 2: x alternates 0 and 2 g, y clips at 8 g, z is stuck.
+    // Second 3: x ramps 0, 1, 2, 3 g.  Two samples of a fourth second are dropped.
+    for(s=0;s<NUM_SAMPLES;s++){
+        xyz[3*s] = s<4 ? 1.0f : s<8 ? (float)(2*(s%2)) : (float)(s-8);
+        xyz[3*s+1] = s>=4 && s<8 ? 8.0f : 0.0f;
+        xyz[3*s+2] = s>=4 && s<8 ? 0.5f : 0.0f;
+    }
+    check(createEpochSummarizer(0,0)==NULL,"a sample rate of 0 is refused");
+    summarizer = createEpochSummarizer(SAMPLERATE,0);
+    blockwise = createEpochSummarizer(SAMPLERATE,0);
+    addEpochSamples(summarizer,xyz,NUM_SAMPLES);
+    addEpochSamples(blockwise,xyz,3);
+    addEpochSamples(blockwise,xyz+3*3,NUM_SAMPLES-3);
+    check(summarizer->numSeconds==3,"whole seconds only");
+    check(blockwise->numSeconds==3 && memcmp(summarizer->seconds,blockwise->seconds,3*sizeof(epoch_second_t))==0,"blocks give the same summary");
+
+    second = &summarizer->seconds[0];
+    check(isNear(second->mean[0],1) && isNear(second->std[0],0) && isNear(second->enmo,0) && isNear(second->baiSigma,0) &&
+          second->stuckCount[0]==3,"still second");
+    second = &summarizer->seconds[1];
+    check(isNear(second->mean[0],1) && isNear(second->std[0],sqrt(4.0/3)) && isNear(second->min[0],0) && isNear(second->max[0],2) &&
+          second->clipCount[1]==4 && second->clipCount[0]==0 && second->stuckCount[1]==3 && second->stuckCount[2]==3 && second->stuckCount[0]==0,
+          "clipped and stuck samples");
+    check(isNear(second->baiSigma,sqrt(4.0/3)/3),"Bai sigma is the mean of the axis deviations");
+    second = &summarizer->seconds[2];
+    check(isNear(second->mean[0],1.5) && isNear(second->enmo,(0+0+1+2)/4.0),"ENMO");
+
+    if((fd=mkstemp(filename))<0){
+        fprintf(stderr,"Could not create a temporary file\n");
+        return -1;
+    }
+    close(fd);
+    check(writeEpochSummary(filename,summarizer,736000.5,1234,736001.25),"write");
+    memset(&header,0,sizeof(header));
+    seconds = readEpochSummary(filename,&header);
+    check(seconds!=NULL && header.numSeconds==3 && header.samplerate==SAMPLERATE && header.startDatenum==736000.5 &&
+          header.binSize==1234 && header.binModifiedDatenum==736001.25 && isNear(header.clipG,EPOCH_DEFAULT_CLIP_G) &&
+          memcmp(seconds,summarizer->seconds,3*sizeof(epoch_second_t))==0,"read back");
+    free(seconds);
+    remove(filename);
+
+    check(getEpochSummaryFilename("/data/study.v2/day 1.bin",sidecarFilename,sizeof(sidecarFilename)) &&
+          strcmp(sidecarFilename,"/data/study.v2/day 1.sec")==0,"sidecar filename");
+    check(getEpochSummaryFilename("/data/study.v2/day1",sidecarFilename,sizeof(sidecarFilename)) &&
+          strcmp(sidecarFilename,"/data/study.v2/day1.sec")==0,"sidecar filename without an extension");
+    check(!getEpochSummaryFilename("/data/day1.bin",sidecarFilename,8),"sidecar filename too long");
+
+    freeEpochSummarizer(summarizer);
+    freeEpochSummarizer(blockwise);
+    return numFailed;
+}
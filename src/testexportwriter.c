@@ -0,0 +1,95 @@
+// gcc testexportwriter.c exportwriter.c in_parallel.c -lm -lpthread -o testexportwriter
+// Regression tests for the bulk export writer (see exportwriter.h): round trip
+// numbers and rows written in order across blocks and workers.  Prints each check and
+// returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "exportwriter.h"
+#include "testcheck.h"
+
+#define NUM_ROWS (2*EXPORT_ROWS_PER_BLOCK+300)
+#define NUM_COLUMNS 2
+#define NUM_RANDOM 100000
+
+static bool isFormatted(double value, const char * expected){
+    char text[SZ_EXPORT_NUMBER];
+    int length = formatExportNumber(value,text);
+    return length==(int)strlen(expected) && strcmp(text,expected)==0;
+}
+
+static char * readFile(const char * filename, long * length){
+    char * text = NULL;
+    FILE * fid = fopen(filename,"rb");
+    if(fid!=NULL){
+        fseek(fid,0,SEEK_END);
+        *length = ftell(fid);
+        rewind(fid);
+        text = malloc((size_t)*length+1);
+        *length = (long)fread(text,1,(size_t)*length,fid);
+        text[*length] = '\0';
+        fclose(fid);
+    }
+    return text;
+}
+
+int main(void){
+    char text[SZ_EXPORT_NUMBER], filename[] = "/tmp/testexportwriterXXXXXX", line[64];
+    char * rowNames[NUM_ROWS], * oneWorker, * severalWorkers, * cursor;
+    const char * columnNames[NUM_COLUMNS] = {"count","ratio"};
+    double * values = malloc(NUM_ROWS*NUM_COLUMNS*sizeof(double)), value;
+    export_matrix_t matrix;
+    long length1 = 0, length2 = 0, numLines;
+    unsigned int r, numRoundTrips = 0;
+    int fd;
+
+    check(isFormatted(3,"3") && isFormatted(-42,"-42") && isFormatted(0,"0") && isFormatted(123456789012345.0,"123456789012345"),"whole numbers");
+    check(isFormatted(0.1,"0.10000000000000001") && isFormatted(-2.5,"-2.5") && isFormatted(1e-7,"9.9999999999999995e-08"),"decimals to 17 digits");
+    check(isFormatted(NAN,"NaN") && isFormatted(INFINITY,"Inf") && isFormatted(-INFINITY,"-Inf"),"NaN and infinities");
+    srand(3);
+    for(r=0;r<NUM_RANDOM;r++){
+        value = ((double)rand()/RAND_MAX-0.5)*pow(10,rand()%40-20);
+        formatExportNumber(value,text);
+        numRoundTrips += strtod(text,NULL)==value ? 1 : 0;
+    }
+    check(numRoundTrips==NUM_RANDOM,"random values read back exactly");
+
+    for(r=0;r<NUM_ROWS;r++){
+        values[r] = r;
+        values[NUM_ROWS+r] = r/8.0;
+        rowNames[r] = malloc(16);
+        snprintf(rowNames[r],16,"s%u",r);
+    }
+    memset(&matrix,0,sizeof(matrix));
+    matrix.values = values;
+    matrix.numRows = NUM_ROWS;
+    matrix.numColumns = NUM_COLUMNS;
+    matrix.columnNames = columnNames;
+    matrix.rowNames = (const char * const *)rowNames;
+    if((fd=mkstemp(filename))<0){
+        fprintf(stderr,"Could not create a temporary file\n");
+        return -1;
+    }
+    close(fd);
+    check(writeExportText(filename,&matrix,1),"text with one worker");
+    oneWorker = readFile(filename,&length1);
+    check(writeExportText(filename,&matrix,3),"text with several workers");
+    severalWorkers = readFile(filename,&length2);
+    check(oneWorker!=NULL && severalWorkers!=NULL && length1==length2 && memcmp(oneWorker,severalWorkers,(size_t)length1)==0,
+          "workers write the same text");
+    for(numLines=0,cursor=oneWorker;cursor!=NULL && (cursor=strchr(cursor,'\n'))!=NULL;cursor++,numLines++);
+    snprintf(line,sizeof(line),"\ns%u, %u, %g\n",NUM_ROWS-1,NUM_ROWS-1,(NUM_ROWS-1)/8.0);
+    check(oneWorker!=NULL && strncmp(oneWorker,", count, ratio\ns0, 0, 0\n",24)==0 && numLines==NUM_ROWS+1 &&
+          strstr(oneWorker,line)!=NULL,"column names, row names and the last row");
+
+    remove(filename);
+    free(oneWorker);
+    free(severalWorkers);
+    for(r=0;r<NUM_ROWS;r++){
+        free(rowNames[r]);
+    }
+    free(values);
+    return numFailed;
+}
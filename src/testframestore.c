@@ -0,0 +1,64 @@
+// gcc testframestore.c framestore.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testframestore
+// Regression tests for merged frame features (see framestore.h): the moments features
+// match frames calculated from the samples and features that do not merge exactly are
+// refused.  Prints each check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "framestore.h"
+#include "testcheck.h"
+
+#define SAMPLES_PER_BASE 2400
+#define NUM_BASES 30
+#define BASES_PER_FRAME 5
+#define NUM_FRAMES (NUM_BASES/BASES_PER_FRAME)
+#define NUM_SAMPLES (NUM_BASES*SAMPLES_PER_BASE+SAMPLES_PER_BASE/2)
+
+static bool isMergedExact(const frame_store_t * store, const float * signal, feature_id_t featureID){
+    double merged[NUM_FRAMES], direct[NUM_FRAMES];
+    unsigned int f;
+    if(!calcMergedFeatureVector(store,featureID,BASES_PER_FRAME,NUM_FRAMES,merged)){
+        return false;
+    }
+    calcFeatureVector(featureID,signal,BASES_PER_FRAME*SAMPLES_PER_BASE,NUM_FRAMES,direct);
+    for(f=0;f<NUM_FRAMES;f++){
+        if(fabs(merged[f]-direct[f])>1e-9*(1+fabs(direct[f]))){
+            fprintf(stderr,"%s frame %u: merged %.17g, from samples %.17g\n",FEATURE_NAMES[featureID],f,merged[f],direct[f]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void){
+    float * signal = malloc(NUM_SAMPLES*sizeof(float));
+    double merged[NUM_FRAMES];
+    frame_store_t * store;
+    feature_id_t exactFeatures[] = {FEATURE_MEAN,FEATURE_RMS,FEATURE_SUM,FEATURE_VAR,FEATURE_STD};
+    feature_id_t framedFeatures[] = {FEATURE_MEDIAN,FEATURE_MEDIANAD,FEATURE_MEANAD,FEATURE_MODE};
+    unsigned int s, f;
+    bool isExact = true, isRefused = true;
+
+    srand(7);
+    for(s=0;s<NUM_SAMPLES;s++){
+        signal[s] = (float)(sin(s/500.0)+(double)rand()/RAND_MAX-0.5+1.0);
+    }
+    check(createFrameStore(signal,SAMPLES_PER_BASE-1,SAMPLES_PER_BASE,1)==NULL,"no whole block");
+
+    store = createFrameStore(signal,NUM_SAMPLES,SAMPLES_PER_BASE,3);
+    check(store!=NULL && store->numBases==NUM_BASES,"partial block dropped");
+    for(f=0;f<sizeof(exactFeatures)/sizeof(exactFeatures[0]);f++){
+        isExact = isExact && store!=NULL && isMergedExact(store,signal,exactFeatures[f]);
+    }
+    check(isExact,"mean, rms, sum, var and std match the samples");
+    for(f=0;f<sizeof(framedFeatures)/sizeof(framedFeatures[0]);f++){
+        isRefused = isRefused && store!=NULL && !calcMergedFeatureVector(store,framedFeatures[f],BASES_PER_FRAME,NUM_FRAMES,merged);
+    }
+    check(isRefused,"median, absolute deviations and mode are left to the frames");
+    check(store!=NULL && !calcMergedFeatureVector(store,FEATURE_MEAN,BASES_PER_FRAME,NUM_FRAMES+1,merged),"frames past the store are refused");
+
+    freeFrameStore(store);
+    free(signal);
+    return numFailed;
+}
@@ -0,0 +1,45 @@
+// gcc testnearestcentroid.c nearestcentroid.c in_parallel.c -lm -lpthread -o testnearestcentroid
+// Regression tests for nearest centroid assignment (see nearestcentroid.h).  Prints each
+// check and returns the number that failed.
+#include <stdio.h>
+#include <math.h>
+#include "nearestcentroid.h"
+#include "testcheck.h"
+
+#define NUM_SHAPES 4
+#define NUM_DIMS 2
+#define NUM_CENTROIDS 2
+
+int main(void){
+    // column-major: shapes (1,0.1), (0,0), (0.1,2), (3,3); centroids (1,0), (0,1)
+    const double shapes[NUM_SHAPES*NUM_DIMS] = {1,0,0.1,3, 0.1,0,2,3};
+    const double centroids[NUM_CENTROIDS*NUM_DIMS] = {1,0, 0,1};
+    const double zeroCentroid[NUM_CENTROIDS*NUM_DIMS] = {0,0, 0,1};
+    uint32_t assignments[NUM_SHAPES];
+    double distances[NUM_SHAPES];
+    unsigned int numUnassigned, numWorkers;
+
+    for(numWorkers=1;numWorkers<=4;numWorkers+=3){
+        check(assignNearestCentroids(shapes,NUM_SHAPES,NUM_DIMS,centroids,NUM_CENTROIDS,CENTROID_SQEUCLIDEAN,
+                                     assignments,distances,numWorkers,&numUnassigned) && numUnassigned==0 &&
+              assignments[0]==0 && assignments[1]==0 && assignments[2]==1 && assignments[3]==0 &&
+              fabs(distances[0]-0.01)<1e-12 && fabs(distances[1]-1)<1e-12,"sqeuclidean assigns every shape (ties to the lower index)");
+
+        // a zero shape has no angle to any centroid
+        check(assignNearestCentroids(shapes,NUM_SHAPES,NUM_DIMS,centroids,NUM_CENTROIDS,CENTROID_COSINE,
+                                     assignments,distances,numWorkers,&numUnassigned) && numUnassigned==1 &&
+              assignments[0]==0 && assignments[1]==CENTROID_UNASSIGNED && isnan(distances[1]) &&
+              assignments[2]==1 && assignments[3]==0 && fabs(distances[3]-(1-sqrt(0.5)))<1e-12,"cosine leaves zero shapes unassigned");
+
+        // constant shapes have no length once centered
+        check(assignNearestCentroids(shapes,NUM_SHAPES,NUM_DIMS,centroids,NUM_CENTROIDS,CENTROID_CORRELATION,
+                                     assignments,distances,numWorkers,&numUnassigned) && numUnassigned==2 &&
+              assignments[1]==CENTROID_UNASSIGNED && assignments[3]==CENTROID_UNASSIGNED && isnan(distances[3]) &&
+              assignments[0]==0 && fabs(distances[0])<1e-12 && assignments[2]==1,"correlation leaves constant shapes unassigned");
+
+        check(assignNearestCentroids(shapes,NUM_SHAPES,NUM_DIMS,zeroCentroid,NUM_CENTROIDS,CENTROID_COSINE,
+                                     assignments,distances,numWorkers,&numUnassigned) && numUnassigned==1 &&
+              assignments[0]==1 && assignments[2]==1 && assignments[3]==1 && !isnan(distances[0]),"cosine skips zero centroids");
+    }
+    return numFailed;
+}
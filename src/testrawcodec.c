@@ -0,0 +1,90 @@
+// gcc testrawcodec.c rawcodec.c rawtools.c in_parallel.c in_system.c -lm -lpthread -o testrawcodec
+// Round trip tests for the compressed raw payload (see rawcodec.h).  Prints each check and
+// returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rawcodec.h"
+#include "testcheck.h"
+
+#define NUM_SIGNALS 3
+#define NUM_RECORDS (3*RAW_CODEC_RECORDS_PER_BLOCK+77)
+
+// Bit exact, so that -0.0 and 0.0 differ.
+static bool isSame(const float * samples, const float * decoded, uint64_t numValues){
+    return memcmp(samples,decoded,numValues*sizeof(float))==0;
+}
+
+static bool roundTrip(const float * samples, uint64_t numRecords, unsigned int numWorkers){
+    uint64_t sz_encoded = 0;
+    uint8_t * payload = encodeRawPayload(samples,NUM_SIGNALS,numRecords,numWorkers,&sz_encoded);
+    float * decoded = calloc(numRecords*NUM_SIGNALS+1,sizeof(float));
+    bool didPass = payload!=NULL && decoded!=NULL &&
+                   decodeRawPayload(payload,sz_encoded,decoded,numWorkers) &&
+                   isSame(samples,decoded,numRecords*NUM_SIGNALS);
+    free(payload);
+    free(decoded);
+    return didPass;
+}
+
+int main(void){
+    float * samples = malloc(NUM_RECORDS*NUM_SIGNALS*sizeof(float));
+    float * decoded = malloc(NUM_RECORDS*NUM_SIGNALS*sizeof(float));
+    codec_header_t codecHeader;
+    uint8_t * payload;
+    uint64_t r, sz_encoded = 0;
+    unsigned int s, numWorkers;
+
+    if(samples==NULL || decoded==NULL){
+        fprintf(stderr,"Out of memory\n");
+        return -1;
+    }
+    // Device samples on the 1/341 g grid, with negative zeros as (float)(-k/341.0) rounds them
+    for(r=0;r<NUM_RECORDS;r++){
+        for(s=0;s<NUM_SIGNALS;s++){
+            samples[r*NUM_SIGNALS+s] = (float)((double)((long)((r*(s+3))%1400)-700)/341.0);
+        }
+    }
+    samples[5] = -0.0f;
+    samples[NUM_RECORDS*NUM_SIGNALS-1] = -0.0f;
+
+    for(numWorkers=1;numWorkers<=4;numWorkers+=3){
+        check(roundTrip(samples,NUM_RECORDS,numWorkers),numWorkers==1 ? "1/341 g grid, one worker" : "1/341 g grid, several workers");
+    }
+
+    payload = encodeRawPayload(samples,NUM_SIGNALS,NUM_RECORDS,0,&sz_encoded);
+    check(payload!=NULL && sz_encoded<NUM_RECORDS*NUM_SIGNALS*sizeof(float)/2,"grid samples compress to less than half");
+    check(payload!=NULL && getEncodedPayloadHeader(payload,sz_encoded,&codecHeader) &&
+          codecHeader.numRecords==NUM_RECORDS && codecHeader.numSignals==NUM_SIGNALS &&
+          codecHeader.numBlocks==(NUM_RECORDS+RAW_CODEC_RECORDS_PER_BLOCK-1)/RAW_CODEC_RECORDS_PER_BLOCK,"payload header");
+    // Records spanning a block boundary and the short final block
+    check(payload!=NULL && decodeRawRecords(payload,sz_encoded,RAW_CODEC_RECORDS_PER_BLOCK-10,20,decoded) &&
+          isSame(samples+(RAW_CODEC_RECORDS_PER_BLOCK-10)*NUM_SIGNALS,decoded,20*NUM_SIGNALS),"records across a block boundary");
+    check(payload!=NULL && decodeRawRecords(payload,sz_encoded,NUM_RECORDS-5,5,decoded) &&
+          isSame(samples+(NUM_RECORDS-5)*NUM_SIGNALS,decoded,5*NUM_SIGNALS),"records of the final block");
+    check(payload!=NULL && !decodeRawRecords(payload,sz_encoded,NUM_RECORDS-5,6,decoded),"records past the end are refused");
+    check(payload!=NULL && !decodeRawPayload(payload,sz_encoded/2,decoded,1),"truncated payload is refused");
+    free(payload);
+
+    // Three decimal .csv exports (1/1000 g)
+    for(r=0;r<NUM_RECORDS*NUM_SIGNALS;r++){
+        samples[r] = (float)((double)((long)((r*7919)%4001)-2000)/1000.0);
+    }
+    check(roundTrip(samples,NUM_RECORDS,0),"1/1000 g grid");
+
+    // Off any grid: stored verbatim
+    srand(1);
+    for(r=0;r<NUM_RECORDS*NUM_SIGNALS;r++){
+        samples[r] = (float)rand()/(float)RAND_MAX*8.0f-4.0f;
+    }
+    samples[7] = NAN;
+    samples[8] = INFINITY;
+    check(roundTrip(samples,NUM_RECORDS,0),"samples off the grid, NaN and Inf");
+
+    check(roundTrip(samples,1,1),"a single record");
+
+    free(samples);
+    free(decoded);
+    return numFailed;
+}
@@ -0,0 +1,171 @@
+// gcc testrawcsvwriter.c rawcsvwriter.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testrawcsvwriter
+// Regression tests for the ActiLife raw .csv writer (see rawcsvwriter.h).  Rows are checked
+// against timestamps converted from the calendar row by row and values printed with
+// "%0.3f", across midnight and the end of a year, a start within a second and zero rows
+// before and after the recording.  Prints each check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rawcsvwriter.h"
+#include "rawtools.h"
+#include "testcheck.h"
+
+#define SAMPLERATE 30
+#define NUM_RECORDS (SAMPLERATE*300)
+#define PADDING_SEC 1
+
+static char * readAll(FILE * fid, long * length){
+    char * text;
+    fflush(fid);
+    fseek(fid,0,SEEK_END);
+    *length = ftell(fid);
+    rewind(fid);
+    text = malloc((size_t)*length+1);
+    *length = (long)fread(text,1,(size_t)*length,fid);
+    text[*length] = '\0';
+    return text;
+}
+
+// Row for tick (samples from the first sample) as the calendar gives it.
+static int formatExpectedRow(char * text, const float * xyz, double start, int64_t tick, bool exportTimestamp){
+    int64_t startSecond = (int64_t)floor(start), sampleSecond, subsample;
+    int64_t milliseconds;
+    struct tm timeStruct;
+    int length = 0;
+    if(exportTimestamp){
+        sampleSecond = tick>=0 ? tick/SAMPLERATE : -((-tick+SAMPLERATE-1)/SAMPLERATE);
+        subsample = tick-sampleSecond*SAMPLERATE;
+        milliseconds = (startSecond+sampleSecond)*1000+llround((start-(double)startSecond)*1000)+(int64_t)floor(1000.0*subsample/SAMPLERATE+0.5);
+        wallclock2tm(milliseconds/1000,&timeStruct);
+        length = sprintf(text,"%02d/%02d/%04d %02d:%02d:%02d.%03d,",timeStruct.tm_mon+1,timeStruct.tm_mday,timeStruct.tm_year+1900,
+                         timeStruct.tm_hour,timeStruct.tm_min,timeStruct.tm_sec,(int)(milliseconds%1000));
+    }
+    if(tick<0 || tick>=NUM_RECORDS){
+        return length+sprintf(text+length,"0,0,0\n");
+    }
+    return length+sprintf(text+length,"%0.3f,%0.3f,%0.3f\n",xyz[3*tick],xyz[3*tick+1],xyz[3*tick+2]);
+}
+
+static bool isExpected(const char * rows, const float * xyz, double start, int64_t firstTick, int64_t lastTick, bool exportTimestamp){
+    char expected[128];
+    int64_t tick;
+    int length;
+    for(tick=firstTick;tick<=lastTick;tick++){
+        length = formatExpectedRow(expected,xyz,start,tick,exportTimestamp);
+        if(strncmp(rows,expected,(size_t)length)!=0){
+            fprintf(stderr,"Row %lld: expected %.*s", (long long)(tick-firstTick),length,expected);
+            return false;
+        }
+        rows += length;
+    }
+    return *rows=='\0';
+}
+
+// Rows follow the header's eleventh line.
+static const char * skipHeader(const char * text){
+    int line;
+    for(line=0;line<11 && text!=NULL;line++){
+        text = strchr(text,'\n');
+        text = text!=NULL ? text+1 : NULL;
+    }
+    return text;
+}
+
+int main(void){
+    float xyz[3*NUM_RECORDS];
+    raw_csv_source_t source;
+    raw_csv_options_t options;
+    struct tm startTime;
+    uint64_t numRows, r;
+    unsigned int numWorkers;
+    char * text;
+    const char * rows;
+    long length;
+    FILE * fid;
+
+    srand(5);
+    for(r=0;r<3*NUM_RECORDS;r++){
+        xyz[r] = (float)rand()/RAND_MAX*16.0f-8.0f;
+    }
+    xyz[0] = -0.0004f;  // prints as -0.000
+    xyz[1] = 0.0005f;   // a float just off the tie
+    xyz[2] = -0.0f;
+
+    // 12/31/2015 23:57:30.5 on, through midnight and into the new year
+    memset(&startTime,0,sizeof(startTime));
+    startTime.tm_year = 2015-1900;
+    startTime.tm_mon = 11;
+    startTime.tm_mday = 31;
+    startTime.tm_hour = 23;
+    startTime.tm_min = 57;
+    startTime.tm_sec = 30;
+    memset(&source,0,sizeof(source));
+    source.axes[0] = xyz;
+    source.axes[1] = xyz+1;
+    source.axes[2] = xyz+2;
+    source.stride = 3;
+    source.numRecords = NUM_RECORDS;
+    source.samplerate = SAMPLERATE;
+    source.start = (double)tm2wallclock(&startTime)+0.5;
+
+    for(numWorkers=1;numWorkers<=3;numWorkers+=2){
+        initRawCSVOptions(&options);
+        options.exportTimestamp = true;
+        options.hasStart = options.hasStop = true;
+        options.start = source.start-PADDING_SEC;
+        options.stop = source.start+(double)(NUM_RECORDS-1)/SAMPLERATE+PADDING_SEC;
+        fid = tmpfile();
+        check(fid!=NULL && writeActigraphRawRows(fid,&source,&options,numWorkers,&numRows) && numRows==NUM_RECORDS+2*PADDING_SEC*SAMPLERATE,
+              numWorkers==1 ? "timestamped rows, one worker" : "timestamped rows, several workers");
+        text = readAll(fid,&length);
+        fclose(fid);
+        check(strstr(text,"ActiLife " RAW_CSV_DEFAULT_TIMESTAMP_VERSION " ")!=NULL && strstr(text,"at 30 Hz")!=NULL &&
+              strstr(text,"\nStart Time 23:57:29\nStart Date 12/31/2015\n")!=NULL && strstr(text,"\nTimestamp,Axis1,Axis2,Axis3\n")!=NULL,
+              "timestamped header");
+        rows = skipHeader(text);
+        check(rows!=NULL && isExpected(rows,xyz,source.start,-PADDING_SEC*SAMPLERATE,NUM_RECORDS-1+PADDING_SEC*SAMPLERATE,true),
+              "timestamps across midnight and padding rows");
+        free(text);
+    }
+
+    initRawCSVOptions(&options);
+    strcpy(options.actilifeVersion,RAW_CSV_DEFAULT_VERSION);
+    fid = tmpfile();
+    check(fid!=NULL && writeActigraphRawRows(fid,&source,&options,0,&numRows) && numRows==NUM_RECORDS,"rows without timestamps");
+    text = readAll(fid,&length);
+    fclose(fid);
+    rows = skipHeader(text);
+    check(strstr(text,"\nStart Time 23:57:30\n")!=NULL && strstr(text,"\nAccelerometer X,Accelerometer Y,Accelerometer Z\n")!=NULL &&
+          rows!=NULL && isExpected(rows,xyz,source.start,0,NUM_RECORDS-1,false),"values as %0.3f prints them");
+    free(text);
+
+    source.serialID = "MOS2B21140207";
+    initRawCSVOptions(&options);
+    fid = tmpfile();
+    check(fid!=NULL && writeActigraphRawRows(fid,&source,&options,0,&numRows),"rows of a recording with a serial number");
+    text = readAll(fid,&length);
+    fclose(fid);
+    check(strstr(text,"\nSerial Number: MOS2B21140207\n")!=NULL,"the serial number of the recording device");
+    free(text);
+    options.serialNumber = "CLE2B21130054";
+    fid = tmpfile();
+    check(fid!=NULL && writeActigraphRawRows(fid,&source,&options,0,&numRows),"rows with a given serial number");
+    text = readAll(fid,&length);
+    fclose(fid);
+    check(strstr(text,"\nSerial Number: CLE2B21130054\n")!=NULL,"a given serial number over the device's");
+    free(text);
+
+    initRawCSVOptions(&options);
+    options.includeHeader = false;
+    options.hasStart = options.hasStop = true;
+    options.start = source.start+10;
+    options.stop = source.start+9;
+    fid = tmpfile();
+    check(fid!=NULL && writeActigraphRawRows(fid,&source,&options,0,&numRows) && numRows==0 && ftell(fid)==0,"a stop before the start writes nothing");
+    fclose(fid);
+
+    check(isActiLifeVersionLessThan("v6.11.4",RAW_CSV_TIMESTAMP_VERSION) && !isActiLifeVersionLessThan("6.12.0",RAW_CSV_TIMESTAMP_VERSION) &&
+          isActiLifeVersionLessThan("v6.9.10","v6.10.0"),"ActiLife version order");
+    return numFailed;
+}
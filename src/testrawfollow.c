@@ -0,0 +1,155 @@
+// gcc testrawfollow.c rawfollow.c rawcsvwriter.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testrawfollow
+// Regression tests for follow mode conversion (see rawfollow.h): rows appended to a growing
+// raw .csv are added to the .bin a whole second at a time, a row without its newline waits
+// for the next call, malformed rows are passed over, and a replaced .csv rebuilds the .bin.
+// Prints each check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rawfollow.h"
+#include "rawcsvwriter.h"
+#include "testcheck.h"
+
+#define SAMPLERATE 30
+#define MAX_RECORDS (10*SAMPLERATE)
+
+static char root[] = "/tmp/testrawfollowXXXXXX";
+static char csvFilename[64], binFilename[64], stateFilename[80];
+
+static void formatRow(unsigned int record, char * row, size_t sz_row){
+    snprintf(row,sz_row,"%0.3f,%0.3f,%0.3f\n",(double)(record%97)/25-2,(double)(record%89)/-30,(double)(record%83)/40);
+}
+
+static void createCSV(int64_t start){
+    char header[SZ_RAW_CSV_HEADER];
+    raw_csv_options_t options;
+    FILE * fid = fopen(csvFilename,"w");
+    initRawCSVOptions(&options);
+    options.serialNumber = "MOS2B21140207";
+    resolveRawCSVOptions(&options);
+    formatActigraphRawHeader(header,sizeof(header),start,SAMPLERATE,&options);
+    fputs(header,fid);
+    fclose(fid);
+}
+
+static void appendText(const char * text){
+    FILE * fid = fopen(csvFilename,"a");
+    fputs(text,fid);
+    fclose(fid);
+}
+
+// Appends rows first..first+numRows-1; every 50th is written with a timestamp.
+static void appendRows(unsigned int first, unsigned int numRows){
+    char row[64];
+    unsigned int r;
+    FILE * fid = fopen(csvFilename,"a");
+    for(r=first;r<first+numRows;r++){
+        formatRow(r,row,sizeof(row));
+        if(r%50==0){
+            fprintf(fid,"3/1/2016 10:00:%02u.%03u,",r/SAMPLERATE,(r%SAMPLERATE)*1000/SAMPLERATE);
+        }
+        fputs(row,fid);
+    }
+    fclose(fid);
+}
+
+// The .bin holds records 0..numRecords-1 and its header counts them.
+static bool isBinExpected(uint64_t numRecords){
+    float xyz[3*MAX_RECORDS], expected[3];
+    char row[64];
+    bin_header_t header;
+    unsigned int r;
+    bool isExpected;
+    FILE * fid = fopen(binFilename,"rb");
+    if(fid==NULL){
+        return false;
+    }
+    isExpected = parseBinaryFileHeader(fid,&header) && header.sz_remaining==numRecords*3*sizeof(float) &&
+                 header.duration_sec==numRecords/SAMPLERATE && header.samplerate==SAMPLERATE &&
+                 fread(xyz,3*sizeof(float),numRecords+1,fid)==numRecords;
+    fclose(fid);
+    for(r=0;r<numRecords && isExpected;r++){
+        formatRow(r,row,sizeof(row));
+        sscanf(row,"%f,%f,%f",expected,expected+1,expected+2);
+        isExpected = memcmp(xyz+3*r,expected,sizeof(expected))==0;
+    }
+    return isExpected;
+}
+
+static uint64_t getNumSkippedRows(void){
+    raw_follow_state_t state;
+    FILE * fid = fopen(stateFilename,"rb");
+    memset(&state,0,sizeof(state));
+    if(fid!=NULL){
+        if(fread(&state,sizeof(state),1,fid)!=1){
+            state.numSkippedRows = UINT64_MAX;
+        }
+        fclose(fid);
+    }
+    return state.numSkippedRows;
+}
+
+int main(void){
+    raw_follow_result_t result;
+    struct tm startTime;
+    char row[64], cut;
+    size_t half;
+    int64_t start;
+
+    if(mkdtemp(root)==NULL){
+        fprintf(stderr,"Could not create %s\n",root);
+        return 1;
+    }
+    snprintf(csvFilename,sizeof(csvFilename),"%s/growing.csv",root);
+    snprintf(binFilename,sizeof(binFilename),"%s/growing.bin",root);
+    snprintf(stateFilename,sizeof(stateFilename),"%s%s",binFilename,RAW_FOLLOW_EXTENSION);
+    memset(&startTime,0,sizeof(startTime));
+    startTime.tm_year = 2016-1900;
+    startTime.tm_mon = 2;
+    startTime.tm_mday = 1;
+    startTime.tm_hour = 10;
+    start = tm2wallclock(&startTime);
+
+    createCSV(start);
+    check(followRawCSVFile(csvFilename,binFilename,&result) && result.restarted && result.numRecords==0 && isBinExpected(0),
+          "a header without rows starts an empty .bin");
+
+    appendRows(0,SAMPLERATE+SAMPLERATE/2);
+    check(followRawCSVFile(csvFilename,binFilename,&result) && !result.restarted && result.firstNewRecord==0 &&
+          result.numNewRecords==SAMPLERATE && isBinExpected(SAMPLERATE),"rows are added a whole second at a time");
+    check(followRawCSVFile(csvFilename,binFilename,&result) && result.numNewRecords==0 && result.numRecords==SAMPLERATE,
+          "nothing new until the second completes");
+
+    // the rest of the second, a malformed row, and the start of a row still being flushed
+    appendRows(SAMPLERATE+SAMPLERATE/2,SAMPLERATE/2);
+    appendText("x,y,z\n");
+    appendRows(2*SAMPLERATE,2*SAMPLERATE-1);
+    formatRow(4*SAMPLERATE-1,row,sizeof(row));
+    half = strlen(row)/2;
+    cut = row[half];
+    row[half] = '\0';
+    appendText(row);
+    check(followRawCSVFile(csvFilename,binFilename,&result) && result.firstNewRecord==SAMPLERATE && result.numNewRecords==2*SAMPLERATE &&
+          isBinExpected(3*SAMPLERATE) && getNumSkippedRows()==1,"malformed rows are passed over");
+    row[half] = cut;
+    appendText(row+half);
+    appendRows(4*SAMPLERATE,SAMPLERATE);
+    check(followRawCSVFile(csvFilename,binFilename,&result) && result.firstNewRecord==3*SAMPLERATE && result.numNewRecords==2*SAMPLERATE &&
+          isBinExpected(5*SAMPLERATE),"a row is consumed once its newline is written");
+
+    // the recording is replaced by one starting a minute later
+    createCSV(start+60);
+    appendRows(0,2*SAMPLERATE);
+    check(followRawCSVFile(csvFilename,binFilename,&result) && result.restarted && result.numRecords==2*SAMPLERATE && isBinExpected(2*SAMPLERATE),
+          "a replaced .csv rebuilds the .bin");
+    remove(stateFilename);
+    check(followRawCSVFile(csvFilename,binFilename,&result) && result.restarted && result.numRecords==2*SAMPLERATE && isBinExpected(2*SAMPLERATE),
+          "a missing follow state rebuilds the .bin");
+
+    remove(csvFilename);
+    remove(binFilename);
+    remove(stateFilename);
+    rmdir(root);
+    return numFailed;
+}
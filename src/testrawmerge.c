@@ -0,0 +1,166 @@
+// gcc testrawmerge.c rawmerge.c rawstream.c rawcsvwriter.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testrawmerge
+// Regression tests for merging split raw recordings (see rawmerge.h): a recording split
+// into .bin or timestamped .csv pieces, adjacent or overlapping and listed in any order,
+// merges into a file byte-identical to the .bin of the whole recording.  Overlaps follow
+// the policy and gaps and the final second are filled with the missing value.  Prints each
+// check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rawmerge.h"
+#include "rawcsvwriter.h"
+#include "rawtools.h"
+#include "testcheck.h"
+
+#define SAMPLERATE 30
+#define NUM_SEC 20
+#define NUM_RECORDS (NUM_SEC*SAMPLERATE)
+#define SERIAL_ID "MOS2B21140207"
+#define MISSING_VALUE -1.0f
+
+static char root[] = "/tmp/testrawmergeXXXXXX";
+static int64_t start;
+
+static char * getFilename(const char * name){
+    static char filenames[8][128];
+    static unsigned int next = 0;
+    char * filename = filenames[next++%8];
+    snprintf(filename,128,"%s/%s",root,name);
+    return filename;
+}
+
+// Writes records first..first+numRecords-1 of xyz as an uncompressed .bin, as mergeraw does.
+static void writeBin(const char * filename, const float * xyz, unsigned int first, unsigned int numRecords){
+    bin_header_t header;
+    FILE * fid = fopen(filename,"wb");
+    memset(&header,0,sizeof(bin_header_t));
+    header.samplerate = SAMPLERATE;
+    wallclock2binStartTimeStr(start+first/SAMPLERATE,header.startTimeStr);
+    strncpy(header.firmware,RAW_CSV_DEFAULT_FIRMWARE,SZ_FIRMWARE);
+    strncpy(header.serialID,SERIAL_ID,SZ_SERIALID);
+    header.num_signals = 3;
+    header.sz_per_signal = sizeof(float);
+    header.duration_sec = (numRecords+SAMPLERATE-1)/SAMPLERATE;
+    header.sz_remaining = (uint64_t)numRecords*3*sizeof(float);
+    fwrite(&header,sizeof(bin_header_t),1,fid);
+    fwrite(xyz+(size_t)first*3,3*sizeof(float),numRecords,fid);
+    fclose(fid);
+}
+
+// Writes records first..first+numRecords-1 of xyz as a timestamped ActiLife raw .csv.
+static void writeCSV(const char * filename, const float * xyz, unsigned int first, unsigned int numRecords){
+    raw_csv_source_t source;
+    raw_csv_options_t options;
+    uint64_t numRows;
+    FILE * fid = fopen(filename,"w");
+    memset(&source,0,sizeof(source));
+    source.axes[0] = xyz+(size_t)first*3;
+    source.axes[1] = xyz+(size_t)first*3+1;
+    source.axes[2] = xyz+(size_t)first*3+2;
+    source.stride = 3;
+    source.numRecords = numRecords;
+    source.samplerate = SAMPLERATE;
+    source.start = (double)start+(double)first/SAMPLERATE;
+    source.serialID = SERIAL_ID;
+    initRawCSVOptions(&options);
+    options.exportTimestamp = true;
+    writeActigraphRawRows(fid,&source,&options,1,&numRows);
+    fclose(fid);
+}
+
+static bool isSameFile(const char * filename, const char * otherFilename){
+    FILE * fids[2] = {fopen(filename,"rb"),fopen(otherFilename,"rb")};
+    int a = 0, b = 0;
+    bool isSame = fids[0]!=NULL && fids[1]!=NULL;
+    while(isSame && a!=EOF){
+        a = fgetc(fids[0]);
+        b = fgetc(fids[1]);
+        isSame = a==b;
+    }
+    if(fids[0]!=NULL) fclose(fids[0]);
+    if(fids[1]!=NULL) fclose(fids[1]);
+    return isSame;
+}
+
+static bool merge(const char * a, const char * b, overlap_policy_t policy, raw_merge_report_t * report){
+    const char * filenames[2] = {a,b};
+    return mergeRawRecordings(getFilename("merged.bin"),filenames,2,policy,MISSING_VALUE,report);
+}
+
+int main(void){
+    static float whole[NUM_RECORDS*3], other[NUM_RECORDS*3], expected[NUM_RECORDS*3];
+    const char * names[] = {"whole.bin","a.bin","b.bin","a.csv","b.csv","expected.bin","merged.bin"};
+    char value[16];
+    struct tm startTime;
+    raw_merge_report_t report;
+    uint64_t numUsed[2], numDropped[2];
+    unsigned int r, n;
+
+    if(mkdtemp(root)==NULL){
+        fprintf(stderr,"Could not create %s\n",root);
+        return 1;
+    }
+    srand(3);
+    for(r=0;r<NUM_RECORDS*3;r++){
+        // on the three decimal grid of a .csv export, so .csv pieces read back exactly
+        snprintf(value,sizeof(value),"%0.3f",(double)rand()/RAND_MAX*8-4);
+        whole[r] = strtof(value,NULL);
+        snprintf(value,sizeof(value),"%0.3f",(double)rand()/RAND_MAX*8-4);
+        other[r] = strtof(value,NULL);
+    }
+    memset(&startTime,0,sizeof(startTime));
+    startTime.tm_year = 2016-1900;
+    startTime.tm_mon = 2;
+    startTime.tm_mday = 1;
+    startTime.tm_hour = 10;
+    start = tm2wallclock(&startTime);
+    writeBin(getFilename("whole.bin"),whole,0,NUM_RECORDS);
+    memset(&report,0,sizeof(report));
+    report.numUsed = numUsed;
+    report.numDropped = numDropped;
+
+    writeBin(getFilename("a.bin"),whole,0,12*SAMPLERATE);
+    writeBin(getFilename("b.bin"),whole,12*SAMPLERATE,8*SAMPLERATE);
+    check(merge(getFilename("a.bin"),getFilename("b.bin"),OVERLAP_LAST,&report) && isSameFile(getFilename("merged.bin"),getFilename("whole.bin")) &&
+          report.numGapRecords==0 && numDropped[0]+numDropped[1]==0,"adjacent .bin pieces merge to the whole recording");
+    check(merge(getFilename("b.bin"),getFilename("a.bin"),OVERLAP_LAST,NULL) && isSameFile(getFilename("merged.bin"),getFilename("whole.bin")),
+          "pieces listed out of order");
+
+    writeCSV(getFilename("a.csv"),whole,0,12*SAMPLERATE);
+    writeCSV(getFilename("b.csv"),whole,8*SAMPLERATE,12*SAMPLERATE);
+    check(merge(getFilename("a.csv"),getFilename("b.csv"),OVERLAP_FIRST,&report) && isSameFile(getFilename("merged.bin"),getFilename("whole.bin")) &&
+          numUsed[0]==12*SAMPLERATE && numDropped[1]==4*SAMPLERATE,"overlapping .csv pieces, first kept");
+    check(merge(getFilename("a.csv"),getFilename("b.csv"),OVERLAP_MEAN,NULL) && isSameFile(getFilename("merged.bin"),getFilename("whole.bin")),
+          "overlapping .csv pieces, identical samples averaged");
+
+    // overlaps that disagree: 8 s to 12 s come from whichever piece the policy keeps
+    writeBin(getFilename("b.bin"),other,8*SAMPLERATE,12*SAMPLERATE);
+    for(n=0;n<2;n++){
+        memcpy(expected,whole,sizeof(expected));
+        memcpy(expected+(n==0 ? 12 : 8)*SAMPLERATE*3,other+(n==0 ? 12 : 8)*SAMPLERATE*3,(n==0 ? 8 : 12)*SAMPLERATE*3*sizeof(float));
+        writeBin(getFilename("expected.bin"),expected,0,NUM_RECORDS);
+        check(merge(getFilename("a.bin"),getFilename("b.bin"),n==0 ? OVERLAP_FIRST : OVERLAP_LAST,NULL) &&
+              isSameFile(getFilename("merged.bin"),getFilename("expected.bin")),n==0 ? "first policy keeps the first piece" : "last policy keeps the last piece");
+    }
+
+    // 6 s to 10 s missing and the last half second cut: both filled
+    writeBin(getFilename("a.bin"),whole,0,6*SAMPLERATE);
+    writeBin(getFilename("b.bin"),whole,10*SAMPLERATE,10*SAMPLERATE-SAMPLERATE/2);
+    memcpy(expected,whole,sizeof(expected));
+    for(r=6*SAMPLERATE*3;r<10*SAMPLERATE*3;r++){
+        expected[r] = MISSING_VALUE;
+    }
+    for(r=(NUM_RECORDS-SAMPLERATE/2)*3;r<NUM_RECORDS*3;r++){
+        expected[r] = MISSING_VALUE;
+    }
+    writeBin(getFilename("expected.bin"),expected,0,NUM_RECORDS);
+    check(merge(getFilename("a.bin"),getFilename("b.bin"),OVERLAP_LAST,&report) && isSameFile(getFilename("merged.bin"),getFilename("expected.bin")) &&
+          report.numGapRecords==4*SAMPLERATE+SAMPLERATE/2 && report.duration_sec==NUM_SEC,"gaps and the final second filled");
+
+    for(n=0;n<sizeof(names)/sizeof(names[0]);n++){
+        remove(getFilename(names[n]));
+    }
+    rmdir(root);
+    return numFailed;
+}
@@ -0,0 +1,176 @@
+// gcc testrowreduce.c rowreduce.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -o testrowreduce
+// Regression tests for fused row reductions (see rowreduce.h): every reduction of every
+// section matches a naive reduction of each row on its own, across row blocks, sections
+// sorted with the sorting network and with qsort, NaNs and constant rows.  Prints each
+// check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rowreduce.h"
+#include "testcheck.h"
+
+#define NUM_ROWS (2*ROWREDUCE_BLOCK_ROWS+89)
+#define NUM_COLUMNS 96
+#define NUM_SECTIONS 3
+#define NUM_BANDS 2
+
+static const unsigned int SECTION_EDGES[NUM_SECTIONS+1] = {0, 7, 7+ROWREDUCE_NETWORK_MAX, NUM_COLUMNS};
+static const char * REQUEST_NAMES[] = {"sort","sum","mean","median","max","min","above_100","bands","normalize"};
+#define NUM_REQUESTS (sizeof(REQUEST_NAMES)/sizeof(REQUEST_NAMES[0]))
+static const double BAND_LOWS[NUM_BANDS] = {0, 50};
+static const double BAND_HIGHS[NUM_BANDS] = {49, 200};
+
+static bool isSame(double a, double b){
+    return (a!=a && b!=b) || a==b || fabs(a-b)<=1e-12*(1+fabs(b));
+}
+
+// Descending with NaN first, as MATLAB's sort(...,'descend').
+static void naiveSort(double * values, unsigned int numValues){
+    unsigned int i, j;
+    double value;
+    for(i=1;i<numValues;i++){
+        value = values[i];
+        for(j=i;j>0 && (value!=value ? values[j-1]==values[j-1] : values[j-1]==values[j-1] && values[j-1]<value);j--){
+            values[j] = values[j-1];
+        }
+        values[j] = value;
+    }
+}
+
+// Fills expected (1 x width of the request) for one row of one section.
+static void naiveReduce(const double * row, unsigned int width, const rowreduce_request_t * request, double * expected, bool * isNonzero){
+    double sorted[NUM_COLUMNS], sum = 0, maxValue = NAN, minValue = NAN, range;
+    unsigned int k, b, numNaNs = 0;
+    for(k=0;k<width;k++){
+        sum += row[k];
+        numNaNs += row[k]!=row[k];
+        if(row[k]==row[k]){
+            maxValue = maxValue!=maxValue || row[k]>maxValue ? row[k] : maxValue;
+            minValue = minValue!=minValue || row[k]<minValue ? row[k] : minValue;
+        }
+        sorted[k] = row[k];
+    }
+    naiveSort(sorted,width);
+    switch(request->id){
+        case ROWREDUCE_SORT:
+            memcpy(expected,sorted,width*sizeof(double));
+            break;
+        case ROWREDUCE_SUM:
+            expected[0] = sum;
+            break;
+        case ROWREDUCE_MEAN:
+            expected[0] = sum/width;
+            break;
+        case ROWREDUCE_MEDIAN:
+            expected[0] = numNaNs>0 ? NAN : width%2 ? sorted[width/2] : (sorted[width/2-1]+sorted[width/2])/2;
+            break;
+        case ROWREDUCE_MAX:
+            expected[0] = maxValue;
+            break;
+        case ROWREDUCE_MIN:
+            expected[0] = minValue;
+            break;
+        case ROWREDUCE_ABOVE:
+            expected[0] = 0;
+            for(k=0;k<width;k++){
+                expected[0] += row[k]>request->threshold;
+            }
+            break;
+        case ROWREDUCE_BANDS:
+            for(b=0;b<NUM_BANDS;b++){
+                expected[b] = 0;
+                for(k=0;k<width;k++){
+                    expected[b] += row[k]>=BAND_LOWS[b] && row[k]<=BAND_HIGHS[b];
+                }
+            }
+            break;
+        case ROWREDUCE_NORMALIZE:
+            // normalizeLoadShapes: x-min, divided by max-min unless the shifted row sums to 0
+            *isNonzero = *isNonzero || numNaNs>0 || maxValue>minValue;
+            range = numNaNs>0 || maxValue>minValue ? maxValue-minValue : 1;
+            for(k=0;k<width;k++){
+                expected[k] = (row[k]-minValue)/range;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Reduces featureSet with numWorkers and compares each output column to the naive reduction.
+static bool isNaiveMatch(const rowreduce_plan_t * plan, unsigned int numWorkers){
+    unsigned int width = getRowReduceWidth(plan), r, s, q, k, column, sectionWidth;
+    double * reduced = malloc((size_t)NUM_ROWS*width*sizeof(double));
+    bool nonzeroRows[NUM_ROWS], isNonzero, isMatch = reduceRows(plan,reduced,nonzeroRows,numWorkers);
+    double row[NUM_COLUMNS], expected[NUM_COLUMNS];
+    for(r=0;r<NUM_ROWS && isMatch;r++){
+        column = 0;
+        isNonzero = false;
+        for(s=0;s<NUM_SECTIONS && isMatch;s++){
+            sectionWidth = SECTION_EDGES[s+1]-SECTION_EDGES[s];
+            for(k=0;k<sectionWidth;k++){
+                row[k] = plan->featureSet[(size_t)(SECTION_EDGES[s]+k)*NUM_ROWS+r];
+            }
+            for(q=0;q<NUM_REQUESTS && isMatch;q++){
+                naiveReduce(row,sectionWidth,plan->requests+q,expected,&isNonzero);
+                width = plan->requests[q].id==ROWREDUCE_SORT || plan->requests[q].id==ROWREDUCE_NORMALIZE ? sectionWidth :
+                        plan->requests[q].id==ROWREDUCE_BANDS ? NUM_BANDS : 1;
+                for(k=0;k<width && isMatch;k++,column++){
+                    if(!isSame(reduced[(size_t)column*NUM_ROWS+r],expected[k])){
+                        fprintf(stderr,"row %u, section %u, %s[%u]: %.17g, naive %.17g\n",r,s,REQUEST_NAMES[q],k,
+                                reduced[(size_t)column*NUM_ROWS+r],expected[k]);
+                        isMatch = false;
+                    }
+                }
+            }
+        }
+        if(isMatch && nonzeroRows[r]!=isNonzero){
+            fprintf(stderr,"row %u: nonzero %d, naive %d\n",r,nonzeroRows[r],isNonzero);
+            isMatch = false;
+        }
+    }
+    free(reduced);
+    return isMatch;
+}
+
+int main(void){
+    double * featureSet = malloc((size_t)NUM_ROWS*NUM_COLUMNS*sizeof(double));
+    rowreduce_request_t requests[NUM_REQUESTS], request;
+    rowreduce_plan_t plan;
+    unsigned int r, c, q;
+    bool isParsed = true;
+
+    srand(5);
+    for(r=0;r<NUM_ROWS;r++){
+        for(c=0;c<NUM_COLUMNS;c++){
+            // counts with ties, a few NaNs, and every 50th row constant
+            featureSet[(size_t)c*NUM_ROWS+r] = r%50==0 ? 12 : rand()%100==0 ? NAN : (double)(rand()%300);
+        }
+    }
+    for(q=0;q<NUM_REQUESTS;q++){
+        isParsed = parseRowReduction(REQUEST_NAMES[q],requests+q) && isParsed;
+    }
+    check(isParsed && requests[6].id==ROWREDUCE_ABOVE && requests[6].threshold==100,"requests parsed");
+    check(!parseRowReduction("above_",&request) && !parseRowReduction("mode",&request),"unknown requests refused");
+
+    memset(&plan,0,sizeof(plan));
+    plan.featureSet = featureSet;
+    plan.numRows = NUM_ROWS;
+    plan.numColumns = NUM_COLUMNS;
+    plan.sectionEdges = SECTION_EDGES;
+    plan.numSections = NUM_SECTIONS;
+    plan.requests = requests;
+    plan.numRequests = NUM_REQUESTS;
+    plan.bandLows = BAND_LOWS;
+    plan.bandHighs = BAND_HIGHS;
+    plan.numBands = NUM_BANDS;
+    check(getRowReduceWidth(&plan)==NUM_SECTIONS*6+NUM_SECTIONS*NUM_BANDS+2*NUM_COLUMNS,"output width");
+    check(isNaiveMatch(&plan,1),"matches the naive reduction, one worker");
+    check(isNaiveMatch(&plan,3),"matches the naive reduction, three workers");
+    plan.numColumns = NUM_COLUMNS-1;
+    check(!reduceRows(&plan,featureSet,NULL,1),"sections past the last column refused");
+
+    free(featureSet);
+    return numFailed;
+}
@@ -0,0 +1,79 @@
+// gcc teststudycache.c studycache.c classifyusage.c framefeatures.c rawtools.c rawcodec.c in_parallel.c in_system.c -lm -lpthread -lrt -o teststudycache
+// Regression tests for the study cache (see studycache.h): studies are decoded once per
+// file, whatever path names them, and decoded again when the file changes.  Prints each
+// check and returns the number that failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "studycache.h"
+#include "testcheck.h"
+
+#define SAMPLERATE 40
+
+static bool writeCSV(const char * filename, unsigned int numRows){
+    unsigned int r;
+    FILE * fid = fopen(filename,"w");
+    if(fid==NULL){
+        return false;
+    }
+    fprintf(fid,"------------ Data File Created By ActiGraph GT3X+ ActiLife v6.11.8 Firmware v1.5.0 date format M/d/yyyy at 40 Hz  Filter Normal -----------\n"
+            "Serial Number: MOS2B21140207\n"
+            "Start Time 00:00:00\n"
+            "Start Date 12/9/2015\n"
+            "Epoch Period (hh:mm:ss) 00:00:00\n"
+            "Download Time 10:07:01\n"
+            "Download Date 12/17/2015\n"
+            "Current Memory Address: 0\n"
+            "Current Battery Voltage: 3.93     Mode = 12\n"
+            "--------------------------------------------------\n"
+            "Timestamp,Accelerometer X,Accelerometer Y,Accelerometer Z\n");
+    for(r=0;r<numRows;r++){
+        fprintf(fid,"12/9/2015 00:%02u:%02u.%03u,0.%03u,-0.106,0.890\n",r/SAMPLERATE/60,r/SAMPLERATE%60,(r%SAMPLERATE)*25,r%1000);
+    }
+    return fclose(fid)==0;
+}
+
+int main(void){
+    char root[] = "/tmp/teststudycacheXXXXXX", absoluteFilename[64], linkFilename[64], errorMsg[256];
+    study_cache_t * cache;
+    study_entry_t * relative, * absolute, * linked, * rewritten, * missing;
+
+    if(mkdtemp(root)==NULL || chdir(root)!=0){
+        fprintf(stderr,"Could not create a temporary directory\n");
+        return -1;
+    }
+    snprintf(absoluteFilename,sizeof(absoluteFilename),"%s/study.csv",root);
+    snprintf(linkFilename,sizeof(linkFilename),"%s/link.csv",root);
+    writeCSV(absoluteFilename,60*SAMPLERATE);
+    check(symlink(absoluteFilename,linkFilename)==0,"link");
+
+    cache = createStudyCache(1<<30);
+    relative = acquireStudy(cache,"study.csv",errorMsg,sizeof(errorMsg));
+    check(relative!=NULL && relative->segment->numRecords==60*SAMPLERATE && relative->segment->samplerate==SAMPLERATE,"decoded");
+    absolute = acquireStudy(cache,absoluteFilename,errorMsg,sizeof(errorMsg));
+    linked = acquireStudy(cache,"./link.csv",errorMsg,sizeof(errorMsg));
+    check(relative!=NULL && absolute==relative && linked==relative && cache->numEntries==1,"relative, absolute and linked paths share one entry");
+    check(relative!=NULL && strcmp(relative->filename,absoluteFilename)==0,"keyed by the canonical path");
+    missing = acquireStudy(cache,"missing.csv",errorMsg,sizeof(errorMsg));
+    check(missing==NULL && strstr(errorMsg,"missing.csv")!=NULL,"missing file");
+    if(relative!=NULL){
+        releaseStudy(cache,relative);
+        releaseStudy(cache,absolute);
+        releaseStudy(cache,linked);
+    }
+
+    writeCSV(absoluteFilename,90*SAMPLERATE);
+    rewritten = acquireStudy(cache,"study.csv",errorMsg,sizeof(errorMsg));
+    check(rewritten!=NULL && rewritten->segment->numRecords==90*SAMPLERATE && cache->numEntries==1,"a changed file is decoded again");
+    if(rewritten!=NULL){
+        releaseStudy(cache,rewritten);
+    }
+
+    freeStudyCache(cache);
+    remove(linkFilename);
+    remove(absoluteFilename);
+    rmdir(root);
+    return numFailed;
+}
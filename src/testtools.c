@@ -1,5 +1,5 @@
-// gcc testtools.c rawtools.c tictoc.c -o rawcsv2rawbin
-// gcc -std=iso9899:1990 -pedantic testtools.c rawtools.c tictoc.c in_system.c -o testtools
+// gcc testtools.c rawtools.c rawcodec.c in_parallel.c tictoc.c in_system.c -lm -lpthread -o testtools
+// gcc -std=c99 -pedantic testtools.c rawtools.c rawcodec.c in_parallel.c tictoc.c in_system.c -lm -lpthread -o testtools
 #include "rawtools.h"
 #include "tictoc.h"
 #include "in_system.h"
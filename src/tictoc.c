@@ -1,4 +1,5 @@
 #include "tictoc.h"
+time_t tic_startTime, tic_stopTime;
 void tic(){
     tic_startTime = time(NULL);
 }
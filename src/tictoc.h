@@ -1,6 +1,6 @@
 #include <time.h>
 #include <stdio.h> /* For fprintf, stdout */
-time_t tic_startTime, tic_stopTime;
+extern time_t tic_startTime, tic_stopTime;
 void tic();
 double toc();
 double printToc();
@@ -0,0 +1,188 @@
+/*
+ * writerawcsv.c - writes raw accelerations as an ActiLife raw .csv export (see
+ * rawcsvwriter.h).  Used by PASensorData.writeActigraphRawCSV.
+ *
+ * The calling syntax is:
+ *
+ *		numRows = writerawcsv(csvFilename, binFilename)
+ *		numRows = writerawcsv(csvFilename, binFilename, params)
+ *		numRows = writerawcsv(csvFilename, x, y, z, samplerate, startDatenum, params)
+ *
+ * The second form exports a Padaco .bin file; the third exports x, y and z vectors (single
+ * or double) sampled at samplerate from startDatenum on.  params is an optional struct with
+ * any of the fields of writeActigraphRawCSV's parameters:
+ *   start_datenum, stop_datenum   datenums of the first and last rows ([] => first and last
+ *                                 samples); rows outside the recording are zeros
+ *   include_header                write the ActiLife header and overwrite csvFilename
+ *                                 (default), otherwise append rows to it
+ *   dry_run                       print the rows instead of writing csvFilename
+ *   actilife_version              ActiLife version of the export ('' => by export_timestamp)
+ *   export_timestamp              lead rows with a timestamp (versions before v6.12.0)
+ * numRows is the number of rows written.
+ *
+ * This is a MEX file for MATLAB.
+
+ * Build instrctions using mex compiler:
+ * mex -O writerawcsv.c rawcsvwriter.c rawtools.c rawcodec.c in_parallel.c in_system.c
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "rawtools.h"
+#include "rawcsvwriter.h"
+
+#define SZ_PRINT_BUFFER 4096
+
+static double datenum2wallclock(double datenum){
+    return (datenum-DATENUM_1970)*SECONDS_PER_DAY;
+}
+
+static bool getParam(const mxArray * params, const char * name, double * value){
+    const mxArray * field = params==NULL ? NULL : mxGetField(params,0,name);
+    if(field==NULL || mxIsEmpty(field)) {
+        return false;
+    }
+    if(mxGetNumberOfElements(field)!=1 || !(mxIsNumeric(field) || mxIsLogical(field))) {
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:params",
+                "The %s parameter must be a scalar.",name);
+    }
+    *value = mxGetScalar(field);
+    return true;
+}
+
+static bool getOptions(const mxArray * params, raw_csv_options_t * options){
+    const mxArray * version;
+    double value;
+    bool isDryRun = false;
+
+    initRawCSVOptions(options);
+    if(params==NULL || mxIsEmpty(params)) {
+        return false;
+    }
+    if(!mxIsStruct(params)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:params",
+                "Parameters must be a struct.");
+    }
+    if((options->hasStart=getParam(params,"start_datenum",&value))) {
+        options->start = datenum2wallclock(value);
+    }
+    if((options->hasStop=getParam(params,"stop_datenum",&value))) {
+        options->stop = datenum2wallclock(value);
+    }
+    if(getParam(params,"include_header",&value)) {
+        options->includeHeader = value!=0;
+    }
+    if(getParam(params,"export_timestamp",&value)) {
+        options->exportTimestamp = value!=0;
+    }
+    if(getParam(params,"dry_run",&value)) {
+        isDryRun = value!=0;
+    }
+    version = mxGetField(params,0,"actilife_version");
+    if(version!=NULL && !mxIsEmpty(version) &&
+       (!mxIsChar(version) || mxGetString(version,options->actilifeVersion,SZ_RAW_CSV_VERSION)!=0)) {
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:params",
+                "The actilife_version parameter must be a version string (e.g. 'v6.13.3').");
+    }
+    return isDryRun;
+}
+
+static void getAxes(const mxArray *prhs[], raw_csv_source_t * source){
+    unsigned int axis;
+    mxClassID classID = mxGetClassID(prhs[1]);
+    size_t numRecords = mxGetNumberOfElements(prhs[1]);
+
+    for(axis=0;axis<3;axis++) {
+        if(mxGetClassID(prhs[1+axis])!=classID || mxGetNumberOfElements(prhs[1+axis])!=numRecords ||
+           !(classID==mxDOUBLE_CLASS || classID==mxSINGLE_CLASS) || mxIsComplex(prhs[1+axis])) {
+            mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:axes",
+                    "x, y and z must be real vectors of the same length and class (single or double).");
+        }
+        source->axes[axis] = mxGetData(prhs[1+axis]);
+    }
+    if(mxGetNumberOfElements(prhs[4])!=1 || !mxIsNumeric(prhs[4]) || mxGetScalar(prhs[4])<1 || mxGetScalar(prhs[4])>UINT16_MAX ||
+       mxGetNumberOfElements(prhs[5])!=1 || !mxIsNumeric(prhs[5])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:axes",
+                "The sample rate and start datenum must be scalars.");
+    }
+    source->stride = 1;
+    source->isDouble = classID==mxDOUBLE_CLASS;
+    source->numRecords = numRecords;
+    source->samplerate = (uint16_t)(mxGetScalar(prhs[4])+0.5);
+    source->start = datenum2wallclock(mxGetScalar(prhs[5]));
+    source->serialID = NULL;
+}
+
+// Prints rows written to a temporary file, as fprintf(1,...) would.
+static void printRows(FILE * fid){
+    char buffer[SZ_PRINT_BUFFER+1];
+    size_t length;
+    rewind(fid);
+    while((length=fread(buffer,1,SZ_PRINT_BUFFER,fid))>0) {
+        buffer[length] = '\0';
+        mexPrintf("%s",buffer);
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+    raw_csv_options_t options;
+    raw_csv_source_t source;
+    raw_info_t info;
+    char * csvFilename, * binFilename;
+    float * accelerations = NULL;
+    uint64_t numRows = 0;
+    bool isDryRun, didWrite;
+    FILE * fid;
+
+    if(!(nrhs==2 || nrhs==3 || nrhs==6 || nrhs==7) || !mxIsChar(prhs[0])) {
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:nrhs",
+                "A .csv filename and either a .bin filename or x, y, z, samplerate and startDatenum are required.");
+    }
+    isDryRun = getOptions(nrhs==3 || nrhs==7 ? prhs[nrhs-1] : NULL,&options);
+    if(nrhs<6) {
+        if((binFilename=mxArrayToString(prhs[1]))==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:notString",
+                    "The .bin filename must be a string.");
+        }
+        accelerations = loadRawAccelerations(binFilename,&info);
+        mxFree(binFilename);
+        if(accelerations==NULL) {
+            mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:load",
+                    "Could not load the raw accelerations.");
+        }
+        source.axes[0] = accelerations;
+        source.axes[1] = accelerations+1;
+        source.axes[2] = accelerations+2;
+        source.stride = 3;
+        source.isDouble = false;
+        source.numRecords = info.recordCount;
+        source.samplerate = info.samplerate;
+        source.start = (double)info.start;
+        source.serialID = info.serialID;
+    }
+    else {
+        getAxes(prhs,&source);
+    }
+
+    csvFilename = mxArrayToString(prhs[0]);
+    fid = isDryRun ? tmpfile() : fopen(csvFilename,options.includeHeader ? "wb" : "ab");
+    if(fid==NULL) {
+        free(accelerations);
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:open",
+                "Could not open %s for writing.",csvFilename);
+    }
+    mxFree(csvFilename);
+    didWrite = writeActigraphRawRows(fid,&source,&options,0,&numRows);
+    if(isDryRun && didWrite) {
+        printRows(fid);
+    }
+    didWrite = fclose(fid)==0 && didWrite;
+    free(accelerations);
+    if(!didWrite) {
+        mexErrMsgIdAndTxt("PadacoToolbox:writerawcsv:write",
+                "Could not write the raw .csv rows (%llu written).",(unsigned long long)numRows);
+    }
+    plhs[0] = mxCreateDoubleScalar((double)numRows);
+}
@@ -1,6 +1,8 @@
 function mergeActigraphFiles(file1, file2, fileToUseForOverlap, destinationPath, datesOnly)  
     % fileToUserForOverlap = 1 for the first file, 2 for the second file.
     %   Default is 2, i.e. the second file is used when there is overlap.
+    % For a merged Padaco .bin without loading either recording into memory
+    % see src/mergeraw.c (mergeraw -p first|last <merged.bin> <file1> <file2>).
     if nargin==0
         srcPath = '/home/??/data/split_studies/';
         srcPath = '/Volumes/Accel/t_1/raw_split_studies/';
@@ -84,7 +86,7 @@ function mergeActigraphFiles(file1, file2, fileToUseForOverlap, destinationPath,
             return
         end
         
-        if f2.dateTimeNum(1) < f1.dateTimeNum(1)
+        if f2.getDatenum(1) < f1.getDatenum(1)
             error('Second file given starts before first file given.  Swap the order and verify fileToUseForOverlap is correct.');
             % don't both swapping them as we don't know what to do with the file to use for overlap: Should it be swapped as well if the
             % person made a mistake on the input?
@@ -100,7 +102,7 @@ function mergeActigraphFiles(file1, file2, fileToUseForOverlap, destinationPath,
         actilife_version = fileHeader.actilife;
         
         % no merge necessary
-        if f2.dateTimeNum(1) > f1.dateTimeNum(end) || fileToUseForOverlap==1
+        if f2.getDatenum(1) > f1.getDatenum(f1.getDurationSamples()) || fileToUseForOverlap==1
             fprintf(1,'Copying %s to %s\n', file1, merged_filename);
             tic
             copyfile(file1, merged_filename);
@@ -110,14 +112,14 @@ function mergeActigraphFiles(file1, file2, fileToUseForOverlap, destinationPath,
             %         write_actigraph_zeros_to_file(merged_filename, end_to_start_datestr);
             fprintf(1,'Appending %s to %s with zero padding if applicable\n', file2, merged_filename);
             tic
-            f2.writeActigraphRawCSV(merged_filename, 'include_header', false, 'dry_run', false, 'start_datenum',f1.dateTimeNum(end)+datenum_delta, 'actilife_version', actilife_version);
+            f2.writeActigraphRawCSV(merged_filename, 'include_header', false, 'dry_run', false, 'start_datenum',f1.getDatenum(f1.getDurationSamples())+datenum_delta, 'actilife_version', actilife_version);
             toc
         else
             %need to merge then
             %copyfile_actigraph_until(file1, file_merge, f2.start);
             fprintf(1,'Writing %s to %s until merge point\n', file1, merged_filename);
             tic
-            f1.writeActigraphRawCSV(merged_filename, 'include_header', true, 'dry_run', false, 'stop_datenum', f2.dateTimeNum(1)-datenum_delta, 'actilife_version', actilife_version);
+            f1.writeActigraphRawCSV(merged_filename, 'include_header', true, 'dry_run', false, 'stop_datenum', f2.getDatenum(1)-datenum_delta, 'actilife_version', actilife_version);
             toc
             fprintf(1,'Appending %s to %s\n', file2, merged_filename);
             tic
@@ -0,0 +1,94 @@
+% ======================================================================
+%> @file testExclusionIndex.m
+%> @brief Checks that PAStatTool.getNonwearRows answers the same from a
+%> PAExclusionIndex of the whole day and all rows as it does from the
+%> padaco and choi nonwear structs cut to a time window and a subset of
+%> rows, the way PAStatTool.calcFeatureStruct cuts them.
+%> @param numRows (optional) Number of simulated person-days.  Default is 210.
+%> @retval numFailed Number of checks that failed.
+% ======================================================================
+function numFailed = testExclusionIndex(numRows)
+    if(nargin<1)
+        numRows = 210;
+    end
+    numFailed = 0;
+    rng(7);
+    tags = PASensorData.getActivityTags();
+    nonwearStates = [tags.NOT_WORKING, tags.STUDY_NOT_STARTED, tags.STUDYOVER, tags.SENSOR_STUCK, tags.SENSOR_BURST];
+    numColumns = 96;
+    columnMinutes = (0:numColumns-1)*15;
+
+    featureStruct.studyIDs = ceil((1:numRows)'/7);
+    featureStruct.startDatenums = datenum(2020,1,1)+mod((0:numRows-1)',7);
+    featureStruct.startDaysOfWeek = weekday(featureStruct.startDatenums)-1;
+    featureStruct.startTimes = arrayfun(@(m) sprintf('%02d:%02d',floor(m/60),mod(m,60)),columnMinutes,'uniformoutput',false);
+
+    padaco = featureStruct;
+    padaco.srcDataType = 'raw';
+    padaco.shapes = repmat(tags.WORKING,numRows,numColumns);
+    isTagged = rand(numRows,numColumns)<0.004;
+    padaco.shapes(isTagged) = nonwearStates(randi(numel(nonwearStates),nnz(isTagged),1));
+    choi = featureStruct;
+    choi.srcDataType = 'count';
+    choi.shapes = double(rand(numRows,numColumns)<0.004);
+
+    index = PAExclusionIndex.fromNonwearStruct(struct('padaco',padaco,'choi',choi), featureStruct);
+    nonwearMethods = {'padaco','choi'};
+    windows = {[1 numColumns], [25 72], [81 22]};  % whole day, daytime, past midnight
+    rowSubsets = {[], sort(randperm(numRows,numRows/3))};
+    for w=1:numel(windows)
+        startStop = windows{w};
+        if(startStop(1)<=startStop(2))
+            columns = startStop(1):startStop(2);
+        else
+            columns = [startStop(1):numColumns, 1:startStop(2)];
+        end
+        startEndTimes = featureStruct.startTimes(startStop);
+        for r=1:numel(rowSubsets)
+            indicesToUse = rowSubsets{r};
+            windowed.padaco = cutStruct(padaco, columns, indicesToUse);
+            windowed.choi = cutStruct(choi, columns, indicesToUse);
+            indexed = windowed;
+            indexed.index = index;
+            indexed.startEndTimes = startEndTimes;
+            indexed.indicesToUse = indicesToUse;
+            description = sprintf('%s to %s, %d rows',startEndTimes{1},startEndTimes{2},numel(windowed.padaco.studyIDs));
+
+            % as exportExclusions asks, without a time window
+            [expectedRows, expectedMalfunction] = PAStatTool.getNonwearRows(nonwearMethods, windowed);
+            [rows, malfunction] = PAStatTool.getNonwearRows(nonwearMethods, indexed);
+            numFailed = numFailed + check(isequal(rows(:),expectedRows(:)) && isequal(malfunction(:),expectedMalfunction(:)), ...
+                ['cut window and rows, ', description]);
+
+            % as calcFeatureStruct asks; the structs do not handle windows past midnight
+            if(startStop(1)<=startStop(2))
+                [expectedRows, expectedMalfunction] = PAStatTool.getNonwearRows(nonwearMethods, windowed, startEndTimes);
+                [rows, malfunction] = PAStatTool.getNonwearRows(nonwearMethods, indexed, startEndTimes);
+                numFailed = numFailed + check(isequal(rows(:),expectedRows(:)) && isequal(malfunction(:),expectedMalfunction(:)), ...
+                    ['given window, ', description]);
+            end
+        end
+    end
+end
+
+function cut = cutStruct(nonwearStruct, columns, indicesToUse)
+    cut = nonwearStruct;
+    if(~isempty(indicesToUse))
+        fieldsToParse = {'studyIDs','startDatenums','startDaysOfWeek','shapes'};
+        for f=1:numel(fieldsToParse)
+            cut.(fieldsToParse{f}) = cut.(fieldsToParse{f})(indicesToUse,:);
+        end
+    end
+    cut.startTimes = cut.startTimes(columns);
+    cut.shapes = cut.shapes(:,columns);
+    cut.totalCount = numel(cut.startTimes);
+end
+
+function didFail = check(didPass, description)
+    if(didPass)
+        fprintf(1,'PASS\t%s\n',description);
+    else
+        fprintf(1,'FAIL\t%s\n',description);
+    end
+    didFail = ~didPass;
+end
@@ -1,36 +1,56 @@
 %> @brief Determines load shape features.  
 %> @param loadShapes MxN matrix of M load shapes of N elements.
-%> @param featureName String name of the feature to extract.  Can be
-%> - FFT magnitude
+%> @param featureName String name of the feature to extract, or a cell
+%> of names whose features are returned side by side.  Can be
+%> - FFT magnitude ('fft': bins 1 to parameter, default 8)
 %> - Peak values
 %> - Peak duration (hours above some threshold)
 %> - width of Peaks
-%> - Wavelets
+%> - Wavelets ('wavelet': Haar detail energy of levels 1 to parameter,
+%> default 4)
 %> - Others
 %> @param parameter Optional parameter that can can be supplied for some
-%> featureName inputs (e.g. 'greaterthancount').
+%> featureName inputs (e.g. 'greaterthancount').  One value per name when
+%> featureName is a cell; NaN selects the default.
 %> @retval loadShapeFeatures
+%> @note The loadshapedescriptors mex file computes the features of all
+%> rows in parallel when it is compiled.
 function loadShapeFeatures = extractLoadShapeFeatures(loadShapes,featureName,parameter)
 
-switch(lower(featureName))
-    case 'sumsqr'
-        loadShapeFeatures = extractSumSqr(loadShapes);
-    case 'fft'
-        loadShapeFeatures = extractSumSqr(loadShapes);
-    case 'peakcount'
-        loadShapeFeatures = extractPeakCount(loadShapes);
-    case 'peakduration'
-        loadShapeFeatures = extractPeakCount(loadShapes)*15/60;
-    case 'greaterthancount'
-        loadShapeFeatures = extractGreaterThanCount(loadShapes,parameter);
-    case 'wavelet'
-        loadShapeFeatures = extractWavelet(loadShapes);
-    case 'sum'
-        loadShapeFeatures = extractSum(loadShapes);
-    case 'std'
-        loadShapeFeatures = extractStd(loadShapes);
-    otherwise
-        fprintf('The feature provided (%s) was not recognized.\n',featureName);
+featureNames = cellstr(featureName);
+if(nargin<3 || isempty(parameter))
+    parameter = nan(1,numel(featureNames));
+end
+
+if(exist('loadshapedescriptors','file')==3 && all(ismember(lower(featureNames),{'sum','sumsqr','std','greaterthancount','peakcount','peakduration','fft','wavelet'})))
+    loadShapeFeatures = loadshapedescriptors(double(loadShapes),featureNames,double(parameter));
+elseif(iscell(featureName))
+    loadShapeFeatures = cell(1,numel(featureNames));
+    for f=1:numel(featureNames)
+        loadShapeFeatures{f} = extractLoadShapeFeatures(loadShapes,featureNames{f},parameter(f));
+    end
+    loadShapeFeatures = [loadShapeFeatures{:}];
+else
+    switch(lower(featureName))
+        case 'sumsqr'
+            loadShapeFeatures = extractSumSqr(loadShapes);
+        case 'fft'
+            loadShapeFeatures = extractFFT(loadShapes,parameter);
+        case 'peakcount'
+            loadShapeFeatures = extractPeakCount(loadShapes);
+        case 'peakduration'
+            loadShapeFeatures = extractPeakCount(loadShapes)*15/60;
+        case 'greaterthancount'
+            loadShapeFeatures = extractGreaterThanCount(loadShapes,parameter);
+        case 'wavelet'
+            loadShapeFeatures = extractWavelet(loadShapes,parameter);
+        case 'sum'
+            loadShapeFeatures = extractSum(loadShapes);
+        case 'std'
+            loadShapeFeatures = extractStd(loadShapes);
+        otherwise
+            fprintf('The feature provided (%s) was not recognized.\n',featureName);
+    end
 end
 end
 
@@ -53,5 +73,32 @@ function feature = extractPeakCount(loadShapes)
    % y = 10;
    % feature = sum(loadShapes>=y,2);
 end
-    
-    
+
+function feature = extractStd(loadShapes)
+    feature = std(loadShapes,0,2);
+end
+
+function feature = extractFFT(loadShapes,numBins)
+    if(isnan(numBins))
+        numBins = 8;
+    end
+    numBins = min(numBins,size(loadShapes,2)-1);
+    magnitudes = abs(fft(loadShapes,[],2));
+    feature = magnitudes(:,2:numBins+1);
+end
+
+% Energy of the Haar wavelet detail coefficients at each level.
+function feature = extractWavelet(loadShapes,numLevels)
+    if(isnan(numLevels))
+        numLevels = 4;
+    end
+    feature = zeros(size(loadShapes,1),numLevels);
+    approximation = loadShapes;
+    for level=1:numLevels
+        half = floor(size(approximation,2)/2);
+        odd = approximation(:,1:2:2*half);
+        even = approximation(:,2:2:2*half);
+        feature(:,level) = sum(((odd-even)/sqrt(2)).^2,2);
+        approximation = (odd+even)/sqrt(2);
+    end
+end
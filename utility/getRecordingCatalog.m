@@ -0,0 +1,130 @@
+function catalog = getRecordingCatalog(pathname, catalogFilename)
+    %> function catalog = getRecordingCatalog(pathname, catalogFilename)
+    %> Returns the header catalog of the .bin, .csv, .raw and unpacked .gt3x
+    %> recordings found under pathname (subdirectories included).
+    %> @param pathname is a string of the folder to catalog
+    %> @param catalogFilename (string, optional) Catalog file.  Default is
+    %> pathname/.padaco_catalog.txt
+    %> @retval catalog Struct of column vectors with one row per recording:
+    %> - @c path
+    %> - @c type 'bin','csv','raw','gt3x' or 'unknown'
+    %> - @c isValid 1 when the header was recognised
+    %> - @c isCompressed 1 for .bin files with a compressed payload
+    %> - @c serialID
+    %> - @c firmware
+    %> - @c samplerate
+    %> - @c startDatenum
+    %> - @c durationSec
+    %> Empty when no catalog is available.
+    %> @note When the catalogrecordings mex file is compiled the catalog is
+    %> refreshed first, reading only the headers of new or changed files.
+    %> Otherwise the last catalog written (e.g. by padacocatalog) is read
+    %> and checked against the .bin, .csv and .raw files now found: entries
+    %> whose file is gone are dropped, and only new files and those whose
+    %> modification time or size changed have their headers read again.
+    %> The catalog file itself is not rewritten.
+    if(nargin<2 || isempty(catalogFilename))
+        catalogFilename = fullfile(pathname,'.padaco_catalog.txt');
+    end
+    
+    catalog = [];
+    if(exist('catalogrecordings','file')==3)
+        catalog = catalogrecordings(pathname, catalogFilename);
+    elseif(exist(catalogFilename,'file'))
+        fid = fopen(catalogFilename,'rt');
+        if(fid>0)
+            % path mtime size type valid compressed duration_estimated serialID firmware samplerate start startDatenum duration_sec
+            % Fields are tab separated only: paths and the start time may
+            % contain spaces and serial IDs may be empty.
+            c = textscan(fid,'%q %f %f %q %f %f %*f %q %q %f %*q %f %f','Delimiter','\t','Whitespace','','HeaderLines',2);
+            fclose(fid);
+            catalog.path = c{1};
+            catalog.type = c{4};
+            catalog.isValid = c{5};
+            catalog.isCompressed = c{6};
+            catalog.serialID = c{7};
+            catalog.firmware = c{8};
+            catalog.samplerate = c{9};
+            catalog.startDatenum = c{10};
+            catalog.durationSec = c{11};
+            catalog = refreshCatalog(catalog, c{2}, c{3}, pathname);
+        end
+    end
+end
+
+% Brings a catalog read from file up to date with the .bin, .csv and .raw
+% files under pathname.  mtime is in seconds since 1970 (UTC).
+function catalog = refreshCatalog(catalog, mtime, sz, pathname)
+    fields = fieldnames(catalog);
+    isGT3X = strcmp(catalog.type,'gt3x');
+    keep = isGT3X & cellfun(@(p)exist(p,'dir')==7,catalog.path);
+    
+    found = dir(fullfile(pathname,'**','*.*'));
+    found = found(~[found.isdir]);
+    foundPaths = fullfile({found.folder},{found.name})';
+    [~,~,ext] = cellfun(@fileparts,foundPaths,'uniformoutput',false);
+    isCandidate = ismember(lower(ext),{'.bin','.csv','.raw'}) & ~contains(foundPaths,[filesep,'.']);
+    found = found(isCandidate);
+    foundPaths = foundPaths(isCandidate);
+    foundMtime = posixtime(datetime([found.datenum]','ConvertFrom','datenum','TimeZone','local'));
+    
+    [isCataloged, row] = ismember(foundPaths,catalog.path);
+    isCataloged(isCataloged) = ~isGT3X(row(isCataloged));
+    isUnchanged = isCataloged;
+    isUnchanged(isCataloged) = abs(mtime(row(isCataloged))-foundMtime(isCataloged))<1 & sz(row(isCataloged))==[found(isCataloged).bytes]';
+    keep(row(isUnchanged)) = true;
+    
+    changedPaths = foundPaths(~isUnchanged);
+    for f=1:numel(fields)
+        catalog.(fields{f}) = catalog.(fields{f})(keep);
+    end
+    for n=1:numel(changedPaths)
+        entry = readRecordingHeader(changedPaths{n});
+        for f=1:numel(fields)
+            if(iscell(catalog.(fields{f})))
+                catalog.(fields{f}){end+1,1} = entry.(fields{f});
+            else
+                catalog.(fields{f})(end+1,1) = entry.(fields{f});
+            end
+        end
+    end
+end
+
+% Reads the header of a .bin, .csv or .raw file as catalogrecordings does.
+% The duration of .csv and .raw files runs to the download time given in
+% the header rather than to their last sample.
+function entry = readRecordingHeader(fullFilename)
+    [~,~,ext] = fileparts(fullFilename);
+    entry = struct('path',fullFilename,'type',lower(ext(2:end)),'isValid',0,'isCompressed',0,...
+        'serialID','','firmware','','samplerate',0,'startDatenum',0,'durationSec',0);
+    try
+        if(strcmp(entry.type,'bin'))
+            fid = fopen(fullFilename,'r');
+            if(fid>0)
+                binHeader = PASensorData.loadPadacoRawBinFileHeader(fid);
+                fclose(fid);
+                if(~isempty(binHeader))
+                    entry.serialID = strtrim(deblank(binHeader.serialID));
+                    entry.firmware = strtrim(deblank(binHeader.firmware));
+                    entry.samplerate = binHeader.samplerate;
+                    entry.startDatenum = datenum(binHeader.startDateTimeStr,'ddd mmm dd HH:MM:SS yyyy');
+                    entry.durationSec = binHeader.duration_sec;
+                    entry.isCompressed = double(binHeader.sz_per_signal==0);
+                    entry.isValid = 1;
+                end
+            end
+        else
+            fileHeader = PASensorData.getActigraphCSVFileHeader(fullFilename);
+            if(isfield(fileHeader,'sampleRate') && isfield(fileHeader,'downloadDate'))
+                entry.firmware = fileHeader.firmware;
+                entry.samplerate = fileHeader.sampleRate;
+                entry.startDatenum = datenum([fileHeader.startDate,' ',fileHeader.startTime],'mm/dd/yyyy HH:MM:SS');
+                downloadDatenum = datenum([fileHeader.downloadDate,' ',fileHeader.downloadTime],'mm/dd/yyyy HH:MM:SS');
+                entry.durationSec = max(0,(downloadDatenum-entry.startDatenum)*86400);
+                entry.isValid = 1;
+            end
+        end
+    catch me
+        showME(me);
+    end
+end